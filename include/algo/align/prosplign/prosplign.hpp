@@ -47,6 +47,7 @@ BEGIN_NCBI_SCOPE
 
 BEGIN_SCOPE(objects)
     class CScope;
+    class CSeq_annot;
 END_SCOPE(objects)
 
 /// Scoring parameters object
@@ -121,6 +122,21 @@ public:
     CProSplignScoring& SetInvertedIntronExtensionCost(int);
     int GetInvertedIntronExtensionCost() const;
 
+    /// Max memory for back tracking, in megabytes
+    /// bigger back tracking matrices are replaced by checkpoint rows,
+    /// spaced to use the least memory, which costs one more
+    /// dynamic programming pass; a warning is posted if even these do
+    /// not fit. 0 means always use the checkpoint rows
+    CProSplignScoring& SetMaxBackAlignMemory(int);
+    int GetMaxBackAlignMemory() const;
+
+    /// Band width, in residues, for the intron search
+    /// when a compartment is given to FindAlignment, the two-stage search
+    /// for introns only looks at cells within band_width residues of the
+    /// compartment hits and of the gaps between them. 0 searches everything
+    CProSplignScoring& SetBandWidth(int);
+    int GetBandWidth() const;
+
 public:
     static const int default_min_intron_len = 30;
 
@@ -134,6 +150,9 @@ public:
     static const int default_intron_non_consensus = 34;
     static const int default_inverted_intron_extension = 1000;
 
+    static const int default_max_back_align_memory = 256;
+    static const int default_band_width = 0;
+
 private:
     int min_intron_len;
     int gap_opening;
@@ -144,6 +163,8 @@ private:
     int intron_AT;
     int intron_non_consensus;
     int inverted_intron_extension;
+    int max_back_align_memory;
+    int band_width;
 };
 
 /// Output filtering parameters
@@ -333,6 +354,21 @@ public:
         return align_ref;
     }
 
+    /// Same, the search for introns is banded around the hits of the compartment
+    /// (as made by SelectCompartmentsHits) if the scoring sets a band width
+    CRef<objects::CSeq_align>
+    FindAlignment(objects::CScope& scope,
+                  const objects::CSeq_id& protein,
+                  const objects::CSeq_loc& genomic,
+                  const objects::CSeq_annot& compartment,
+                  CProSplignOutputOptions output_options = CProSplignOutputOptions())
+    {
+        CRef<objects::CSeq_align> align_ref;
+        align_ref = FindGlobalAlignment(scope, protein, genomic, compartment);
+        align_ref = RefineAlignment(scope, *align_ref, output_options);
+        return align_ref;
+    }
+
     /// Globally aligns protein to a region on genomic sequence.
     /// genomic seq_loc should be a continuous region - an interval or a whole sequence
     ///
@@ -342,6 +378,14 @@ public:
                         const objects::CSeq_id& protein,
                         const objects::CSeq_loc& genomic);
 
+    /// Same, banded around the compartment hits, see FindAlignment.
+    /// Only the default two-stage mode uses the band
+    CRef<objects::CSeq_align>
+    FindGlobalAlignment(objects::CScope& scope,
+                        const objects::CSeq_id& protein,
+                        const objects::CSeq_loc& genomic,
+                        const objects::CSeq_annot& compartment);
+
     /// Refines Spliced-seg alignment by removing bad pieces according to output_options.
     /// This is irreversible action - more relaxed parameters will not change the alignment back
     CRef<objects::CSeq_align>
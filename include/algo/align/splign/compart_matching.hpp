@@ -44,13 +44,12 @@
 
 
 
+BEGIN_NCBI_SCOPE
+
 BEGIN_SCOPE(objects)
     class CSeq_id;
 END_SCOPE(objects)
 
-
-BEGIN_NCBI_SCOPE
-
 USING_SCOPE(objects);
 
 
@@ -205,6 +204,20 @@ public:
     int    GetDropOff(void) const { return m_XDropOff; }
     static int s_GetDefaultDropOff(void) { return 5; }
 
+    /// Sets the number of threads used to sort the index volumes
+    /// and to build and sort the elementary hits. The results do not
+    /// depend on it.
+
+    void   SetNumThreads(size_t num_threads) {
+        m_NumThreads = num_threads > 0? num_threads: 1;
+    }
+    size_t GetNumThreads(void) const { return m_NumThreads; }
+
+    /// Sorts the vector on up to num_threads threads, giving each at least
+    /// min_chunk elements; the sorted chunks are then merged pairwise.
+
+    static void s_Sort(vector<Uint8>& v, size_t num_threads, size_t min_chunk);
+
     void Run(void);
     
 private:
@@ -385,6 +398,8 @@ private:
 
     int                       m_XDropOff;
 
+    size_t                    m_NumThreads;
+
     CBoolVector               m_Mers;
 
     bool m_OutputMethod;
@@ -413,6 +428,16 @@ private:
 
     void   x_Search(bool strand);
 
+    // Builds the elementary hits of the hit index entries [cnt_from, cnt_to)
+    // starting at hits; returns the number of hits built.
+    static Uint8 x_FillHits(const string& filename_hit_index,
+                            size_t cnt_from, size_t cnt_to,
+                            const string& filename_pos_q,
+                            const string& filename_pos_s,
+                            Uint8* hits);
+
+    class CFillHitsThread;
+
     void   x_CreateRemapData(const string& db, EIndexMode mode);
     void   x_CreateRemapData(ISequenceSource *m_qsrc, EIndexMode mode);
     void   x_LoadRemapData  (ISequenceSource *m_qsrc, const string& sdb);
@@ -303,6 +303,31 @@ public:
         return m_result;
     }
 
+    // results of one hit set processed with RunBatch()
+    struct SBatchResult {
+        TResults m_Results; // as retrieved with GetResult() after Run()
+        string   m_Error;   // message of the exception thrown by Run(), if any
+    };
+    typedef vector<SBatchResult> TBatchResults;
+
+    /// Run() the independent hit sets of a batch, one query/subject pair
+    /// each, on several threads.
+    ///
+    /// Each thread uses its own copy of this object and of the aligner;
+    /// the scope is shared and its history is preserved while the batch
+    /// is processed. The model ids are assigned as if Run() were called
+    /// on each hit set in turn, whatever the number of threads; a hit set
+    /// on which Run() throws gets no results and uses no model ids.
+    ///
+    /// @param batch
+    ///   [IN/OUT] Hit sets; each is modified as by Run().
+    /// @param results
+    ///   [OUT] Results of each hit set, in the input order.
+    /// @param num_threads
+    ///   [IN] Max number of threads to use.
+    void RunBatch(vector<THitRefs>& batch, TBatchResults* results,
+                  size_t num_threads);
+
     // align single compartment within given genomic bounds
     bool AlignSingleCompartment(THitRefs* hitrefs,
                                 size_t range_left, size_t range_right,
@@ -484,6 +484,32 @@ private:
     TSeqLocInfoVector m_QueryMasks;
 };
 
+/// Receiver of search results, one query at a time.
+///
+/// Searches that accept an object of this type hand over each query's
+/// CSearchResults in query order, instead of accumulating all of them into a
+/// CSearchResultSet. This allows the caller to format (and release) the
+/// results of a query while the remaining ones are still being produced.
+/// In a database search a query's results are handed over as soon as the
+/// last subject sequence it hits has been aligned. With composition based
+/// statistics, Smith-Waterman traceback, RPS-BLAST, traceback pipes,
+/// bl2seq and PHI-BLAST the traceback of all queries is completed first (see
+/// Blast_TracebackCanStreamPerQuery), and the results are then handed over
+/// one query at a time.
+
+class NCBI_XBLAST_EXPORT ISearchResultsSink : public CObject {
+public:
+    /// Our virtual destructor
+    virtual ~ISearchResultsSink() {}
+
+    /// Accept the results for one query
+    /// @param results results for the next query in the batch [in]
+    virtual void Put(CRef<CSearchResults> results) = 0;
+
+    /// Called once after the results of the last query have been put
+    virtual void Finish() {}
+};
+
 END_SCOPE(blast)
 END_NCBI_SCOPE
 
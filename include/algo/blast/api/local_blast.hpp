@@ -47,11 +47,50 @@ class CBlastFilterTest;
 BEGIN_NCBI_SCOPE
 BEGIN_SCOPE(blast)
 
-/// Returns the optimal chunk size for a given task
+/// Returns the optimal chunk size for a given task; if the CHUNK_SIZE
+/// environment variable is set to kAdaptiveQuerySize the chunk size is
+/// scaled to the memory and cache available (@sa GetAdaptiveQuerySize)
 /// @param program BLAST task [in]
+/// @param options Options of the search, used to size adaptive chunks of
+/// protein queries [in]
 NCBI_XBLAST_EXPORT
 size_t
-SplitQuery_GetChunkSize(EProgram program);
+SplitQuery_GetChunkSize(EProgram program,
+                        const CBlastOptions* options = NULL);
+
+/// Memory and cache available to a BLAST search, used to size query
+/// batches and split-query chunks
+struct NCBI_XBLAST_EXPORT SBlastMemoryLimits {
+    Uint8 available_memory;  ///< Bytes of memory the process may still use
+    Uint8 cache_size;        ///< Bytes of last level cache
+
+    /// Measure the limits of the running process; on Linux the memory
+    /// limit and usage of the process' cgroup are taken into account
+    static SBlastMemoryLimits Measure(void);
+};
+
+/// Value of the BATCH_SIZE and CHUNK_SIZE environment variables which
+/// requests query batches and chunks sized by GetAdaptiveQuerySize
+NCBI_XBLAST_EXPORT extern const char* kAdaptiveQuerySize;
+
+/// Scale a query batch or split-query chunk size so that the part of the
+/// lookup table that grows with the query stays within the last level
+/// cache, and the search as a whole within the available memory.
+/// The size of a protein lookup table depends on the scoring matrix,
+/// word size and threshold, and is only known for BLOSUM62 with word size
+/// 3 and threshold 11; for other settings, or without options, searches
+/// with a protein lookup table keep the fixed size.
+/// @param program BLAST task [in]
+/// @param default_size Fixed size used for this task, in letters [in]
+/// @param limits Memory and cache available to the search [in]
+/// @param options Options of the search [in]
+/// @return Size to use, in letters; a multiple of 3 if the query is
+/// translated
+NCBI_XBLAST_EXPORT
+size_t
+GetAdaptiveQuerySize(EProgram program, size_t default_size,
+                     const SBlastMemoryLimits& limits,
+                     const CBlastOptions* options = NULL);
 
 /// Class to perform a BLAST search on local BLAST databases
 /// Note that PHI-BLAST can be run using this class also, one only need to
@@ -89,6 +128,13 @@ public:
     
     /// Executes the search
     CRef<CSearchResultSet> Run();
+
+    /// Executes the search, handing the results for each query to sink as
+    /// soon as they are available rather than returning them all at once
+    /// (see ISearchResultsSink for the searches where that is only after
+    /// the traceback of all queries)
+    /// @param sink receives the results in query order [in]
+    void Run(ISearchResultsSink& sink);
     
     /// Set a function callback to be invoked by the CORE of BLAST to allow
     /// interrupting a BLAST search in progress.
@@ -113,6 +159,10 @@ public:
     BlastDiagnostics* GetDiagnostics();
 
 private:
+    /// Runs the preliminary stage and sets up m_TbackSearch for the
+    /// traceback stage
+    void x_RunPreliminarySearch();
+
     /// Query factory from which to obtain the query sequence data
     CRef<IQueryFactory> m_QueryFactory;
     
@@ -223,6 +223,12 @@ public:
     /// Initialize the lookup table. Note that for the case of PSI-BLAST the
     /// PSSM must be initialized in the BlastScoreBlk for it to be recognized
     /// properly by the lookup table code. Caller owns the return value.
+    /// If the environment variable BLAST_LOOKUP_TABLE_CACHE names a
+    /// directory, the table is mapped from an image there that another
+    /// process saved for the same queries and options, or built and saved
+    /// there as an image. The images in that directory are limited to
+    /// BLAST_LOOKUP_TABLE_CACHE_MB megabytes (4096 by default); the least
+    /// recently used ones are removed to make room for a new image.
     /// @param query_data source of query sequence data [in]
     /// @param opts_memento Memento options object [in]
     /// @param score_blk BlastScoreBlk structure, as obtained in
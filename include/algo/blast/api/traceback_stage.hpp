@@ -77,7 +77,17 @@ public:
     
     /// Run the traceback search.
     CRef<CSearchResultSet> Run();
-    
+
+    /// Run the traceback search, handing the results for each query to
+    /// sink as soon as they are converted to Seq-aligns, and calling
+    /// sink.Finish() after the last one. For database searches the core
+    /// results of a query are released as soon as they are handed over, so
+    /// only one query's Seq-align-set is materialized at a time.
+    /// @param sink receives the results in query order [in]
+    /// @param query_masks masked query regions to attach to the results [in]
+    void Run(ISearchResultsSink& sink,
+             const TSeqLocInfoVector& query_masks = TSeqLocInfoVector());
+
     /// Runs the traceback but only returns the HSP's and not the Seq-Align.
     BlastHSPResults* RunSimple();
 
@@ -99,6 +109,22 @@ private:
                 const string        & dbname,
                 CRef<TBlastHSPStream> hsps);
     
+    /// Convert the core results of one query to a CSearchResults
+    /// @param hit_list core results of the query, may be NULL [in]
+    /// @param index index of the query [in]
+    /// @param qdata the queries of this search [in]
+    /// @param query_masks masked query regions to attach to the results [in]
+    CRef<CSearchResults> x_MakeQueryResults(BlastHitList* hit_list,
+                                            int index,
+                                            ILocalQueryData& qdata,
+                                            const TSeqLocInfoVector& query_masks);
+
+    /// Callback for Blast_RunTracebackSearchPerQuery, puts the results of
+    /// one query into the sink passed to Run
+    static Int2 x_PutQueryResults(BlastHSPResults* results,
+                                  Int4 query_index,
+                                  void* user_data);
+
     /// Prohibit copy constructor
     CBlastTracebackSearch(CBlastTracebackSearch &);
     /// Prohibit assignment operator
@@ -183,9 +183,15 @@ public:
     ESubjectMaskingType GetMaskType() const;
 
     /// Mutator for the seqdb
+    ///
+    /// The database is used as given; in particular it is not switched
+    /// to CSeqDB immutable mode.
     /// @param seqdb reference to an initialized db [in]
     void SetSeqDb(CRef<CSeqDB> seqdb);
     /// Obtain a reference to the database
+    ///
+    /// A database opened by this object is put in CSeqDB immutable
+    /// mode, so the files must not change while it is in use.
     CRef<CSeqDB> GetSeqDb() const;
 
 private:
@@ -1065,6 +1065,9 @@ public:
         ///igblast AIRR rearrangement, 19
         eAirrRearrangement,
 
+        /// Binary columnar tabular output, 20
+        eColumnarTabular,
+
         /// unaligned reads in magicblast
         eFasta,
         /// Sentinel value for error checking
@@ -247,7 +247,12 @@ NCBI_BLASTINPUT_EXPORT
 TSeqRange
 ParseSequenceRangeOpenEnd(const string& range_str, const char* error_prefix = NULL);
 
-/** Retrieve the appropriate batch size for the specified task 
+/** Retrieve the appropriate batch size for the specified task. If the
+ * BATCH_SIZE environment variable is set to "auto", the batch size is
+ * scaled to the memory and cache available (@sa GetAdaptiveQuerySize) and
+ * returned for local searches even if use_default is false. The search
+ * options are not known here, so tasks with a protein lookup table keep
+ * the fixed batch size; their query chunks are still sized adaptively.
  * @param program BLAST task [in]
  * @param is_ungapped true if ungapped BLAST search is requested [in]
  * @param remote true if remote BLAST search is requested [in]
@@ -407,6 +407,8 @@ NCBI_BLASTINPUT_EXPORT extern const string kArgShowDomainHits;
 NCBI_BLASTINPUT_EXPORT extern const string kArgRid;
 /// Argument to blast_formatter to request BLAST archive file name
 NCBI_BLASTINPUT_EXPORT extern const string kArgArchive;
+/// Argument to blast_formatter to convert a binary columnar tabular file
+NCBI_BLASTINPUT_EXPORT extern const string kArgColumnarInput;
 
 /// Argument to specify min query coverage percentage for each hsp
 NCBI_BLASTINPUT_EXPORT extern const string kArgQueryCovHspPerc;
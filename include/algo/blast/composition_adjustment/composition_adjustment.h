@@ -80,6 +80,9 @@ typedef struct Blast_MatrixInfo {
     int    **startMatrix;     /**< Rescaled values of the original matrix */
     double **startFreqRatios;  /**< frequency ratios used to calculate matrix
                                     scores */
+    double **startLogFreqRatios; /**< natural logarithms of startFreqRatios,
+                                      or NULL if they have not been
+                                      computed */
     int      rows;             /**< the number of rows in the scoring
                                     matrix. */
     int      cols;             /**< the number of columns in the scoring
@@ -108,6 +111,23 @@ NCBI_XBLAST_EXPORT
 void Blast_MatrixInfoFree(Blast_MatrixInfo ** ss);
 
 
+/**
+ * Compute the logarithms of the frequency ratios of a Blast_MatrixInfo
+ * object, so that rescaling the matrix for a new Lambda does not need to
+ * evaluate any logarithms. Must be called after startFreqRatios has been
+ * filled in.
+ *
+ * @param ss     the matrix information [in|out]
+ * @return 0 on success, -1 on out-of-memory
+ */
+NCBI_XBLAST_EXPORT
+int Blast_MatrixInfoSetLogFreqRatios(Blast_MatrixInfo * ss);
+
+
+/** A cache of recently adjusted score matrices, see Blast_AdjustScores */
+typedef struct Blast_AdjustedMatrixCache Blast_AdjustedMatrixCache;
+
+
 /** Work arrays used to perform composition-based matrix adjustment */
 typedef struct Blast_CompositionWorkspace {
     double ** mat_b;       /**< joint probabilities for the matrix in
@@ -118,6 +138,10 @@ typedef struct Blast_CompositionWorkspace {
                                            of the first sequence */
     double * second_standard_freq;    /**< background frequency vector of
                                            the second sequence */
+    Blast_AdjustedMatrixCache *
+        matrix_cache;      /**< matrices adjusted recently with this
+                                workspace, keyed by the compositions they
+                                were adjusted for */
 } Blast_CompositionWorkspace;
 
 
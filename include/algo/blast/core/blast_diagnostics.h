@@ -78,11 +78,42 @@ typedef struct BlastGappedStats {
                             e-value threshold. */
 } BlastGappedStats;
 
+/** Work done by a single preliminary search thread */
+typedef struct BlastThreadLoad {
+   Int8 num_subjects; /**< Number of subject sequences searched */
+   Int8 num_residues; /**< Number of subject residues searched */
+   double busy_time; /**< Seconds spent searching */
+   double idle_time; /**< Seconds spent waiting for the slowest thread to
+                        finish */
+} BlastThreadLoad;
+
+/** Structure containing work distribution counts from the preliminary
+ * search threads of a BLAST search. The subject and residue counts are filled
+ * by the preliminary search engine; the times are measured by the caller that
+ * owns the threads. */
+typedef struct BlastThreadStats {
+   Int4 num_threads; /**< Number of preliminary search threads that reported
+                        to this structure */
+   Int8 num_subjects; /**< Number of subject sequences searched, summed over
+                         all threads */
+   Int8 num_residues; /**< Number of subject residues searched, summed over
+                         all threads */
+   Int8 max_thread_residues; /**< Largest number of subject residues searched
+                                by a single thread */
+   double busy_time; /**< Seconds spent searching, summed over all threads */
+   double idle_time; /**< Seconds spent waiting for the slowest thread to
+                        finish, summed over all threads */
+   BlastThreadLoad* loads; /**< Work done by each thread, num_threads
+                              entries in the order the threads reported */
+} BlastThreadStats;
+
 /** Return statistics from the BLAST search */
 typedef struct BlastDiagnostics {
    BlastUngappedStats* ungapped_stat; /**< Ungapped extension counts */
    BlastGappedStats* gapped_stat; /**< Gapped extension counts */
    BlastRawCutoffs* cutoffs; /**< Various raw values for the cutoffs */
+   BlastThreadStats* thread_stat; /**< Work distribution between the 
+                                     preliminary search threads */
    MT_LOCK mt_lock; /**< Mutex for updating diagnostics data in a 
                        multi-threaded search. */
 } BlastDiagnostics;
@@ -115,6 +146,29 @@ void
 Blast_DiagnosticsUpdate(BlastDiagnostics* diag_global,
                         BlastDiagnostics* diag_local);
 
+/** Record the subjects searched by one preliminary search thread. This adds
+ * an entry to thread_stat->loads and to the totals.
+ * @param diagnostics Diagnostics the thread reports to [in] [out]
+ * @param num_subjects Number of subject sequences searched [in]
+ * @param num_residues Number of subject residues searched [in]
+ * @return 0 on success, -1 if memory could not be allocated
+ */
+Int2
+Blast_DiagnosticsAddThreadLoad(BlastDiagnostics* diagnostics,
+                               Int8 num_subjects, Int8 num_residues);
+
+/** Record the wall clock time spent by one preliminary search thread. The
+ * times are added to the totals and to the most recent entry of 
+ * thread_stat->loads.
+ * @param diagnostics Diagnostics the thread reported to [in] [out]
+ * @param busy_time Seconds the thread spent searching [in]
+ * @param idle_time Seconds the thread then waited for the other threads 
+ *                  to finish [in]
+ */
+void
+Blast_DiagnosticsUpdateThreadTimes(BlastDiagnostics* diagnostics,
+                                   double busy_time, double idle_time);
+
 #ifdef __cplusplus
 }
 #endif
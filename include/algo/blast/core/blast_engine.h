@@ -209,6 +209,79 @@ Blast_RunPreliminarySearchWithInterrupt(EBlastProgramType program,
    BlastHSPStream* hsp_stream, BlastDiagnostics* diagnostics,
    TInterruptFnPtr interrupt_search, SBlastProgress* progress_info);
 
+/** Queue through which the threads of a multi-threaded preliminary search
+ * share the chunks of subject sequences longer than MAX_DBSEQ_LEN, so that
+ * one long subject does not keep a single thread busy after the others have
+ * run out of work. The contents are private to the engine.
+ */
+typedef struct BlastSubjectSplitQueue BlastSubjectSplitQueue;
+
+/** Blocks the calling thread until the matching signal function is called.
+ * It is called with the queue lock held, and must release the lock while
+ * blocked and hold it again on return, as a condition variable does.
+ * Spurious returns are allowed.
+ * @param data The data passed to BlastSubjectSplitQueueNew [in]
+ */
+typedef void (*TBlastSplitWaitFn)(void* data);
+
+/** Wakes every thread blocked in the matching wait function. It is called
+ * with the queue lock held.
+ * @param data The data passed to BlastSubjectSplitQueueNew [in]
+ */
+typedef void (*TBlastSplitSignalFn)(void* data);
+
+/** Allocates an empty queue.
+ * @param lock Mutex protecting the queue; the queue takes ownership of it
+ *             and deletes it even if the allocation fails [in]
+ * @param wait_fn Lets a thread sleep while the chunks of its subject are
+ *             searched by other threads; if NULL, the thread polls the
+ *             queue instead [in, optional]
+ * @param signal_fn Wakes the sleeping threads, must be given together
+ *             with @a wait_fn [in, optional]
+ * @param wait_data Passed to both functions; owned by the caller, and
+ *             usually the data the lock operates on [in, optional]
+ * @return The new queue, NULL if out of memory
+ */
+NCBI_XBLAST_EXPORT
+BlastSubjectSplitQueue* BlastSubjectSplitQueueNew(MT_LOCK lock,
+                                                  TBlastSplitWaitFn wait_fn,
+                                                  TBlastSplitSignalFn signal_fn,
+                                                  void* wait_data);
+
+/** Deallocates a queue. All threads using it must have returned.
+ * @param queue The queue to free [in]
+ * @return NULL
+ */
+NCBI_XBLAST_EXPORT
+BlastSubjectSplitQueue* BlastSubjectSplitQueueFree(BlastSubjectSplitQueue* queue);
+
+/** Same as Blast_RunPreliminarySearchWithInterrupt, for one of several threads
+ * searching the same database. The chunks of long subjects are posted to the
+ * queue and searched by whichever threads are free; the HSPs are merged by
+ * the thread that fetched the subject, in the same order as in a serial
+ * search, so the results do not depend on which thread searched a chunk.
+ * Not done for searches against individual subjects (the database length is
+ * 0), with a database index, for out-of-frame or mapping searches, or for
+ * ungapped searches with sum statistics.
+ * @param split_queue Queue shared by all threads of the search; NULL to
+ *                    search every subject within one thread [in]
+ * See Blast_RunPreliminarySearchWithInterrupt for the other parameters.
+ */
+NCBI_XBLAST_EXPORT
+Int2
+Blast_RunPreliminarySearchWithSplitQueue(EBlastProgramType program,
+   BLAST_SequenceBlk* query, BlastQueryInfo* query_info,
+   const BlastSeqSrc* seq_src, const BlastScoringOptions* score_options,
+   BlastScoreBlk* sbp, LookupTableWrap* lookup_wrap,
+   const BlastInitialWordOptions* word_options,
+   const BlastExtensionOptions* ext_options,
+   const BlastHitSavingOptions* hit_options,
+   const BlastEffectiveLengthsOptions* eff_len_options,
+   const PSIBlastOptions* psi_options, const BlastDatabaseOptions* db_options,
+   BlastHSPStream* hsp_stream, BlastDiagnostics* diagnostics,
+   TInterruptFnPtr interrupt_search, SBlastProgress* progress_info,
+   BlastSubjectSplitQueue* split_queue);
+
 /** Gapped extension function pointer type */
 typedef Int2 (*BlastGetGappedScoreType) 
      (EBlastProgramType, /**< @todo comment function pointer types */
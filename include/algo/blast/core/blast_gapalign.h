@@ -77,6 +77,12 @@ typedef struct BlastGapAlignStruct {
                                          gapped extension */
    BlastGapDP* dp_mem; /**< scratch structures for dynamic programming */
    Int4 dp_mem_alloc;  /**< current number of structures allocated */
+   void* sw_mem;       /**< scratch memory for the striped Smith-Waterman
+                            kernels */
+   size_t sw_mem_alloc; /**< current number of bytes in sw_mem */
+   Int4 sw_engine;     /**< widest Smith-Waterman score-only engine the CPU
+                            supports (an ESmithWatermanEngine), chosen
+                            when the structure is created */
    BlastScoreBlk* sbp; /**< Pointer to the scoring information block */
    Int4 gap_x_dropoff; /**< X-dropoff parameter to use */
    Int4 max_mismatches;  /**< Max number of mismatches for jumper */
@@ -74,6 +74,8 @@ typedef struct BlastSmallNaLookupTable {
     Int2 * overflow;       /**< the overflow array for the compacted 
                                 lookup table */
     Int4  overflow_size;   /**< Number of elements in the overflow array */
+    Boolean scan_avx2;     /**< Can the AVX2 subject scanner be used; set
+                                when the table is built */
     void *scansub_callback; /**< function for scanning subject sequences */
     void *extend_callback;  /**< function for extending hits */
     BlastSeqLoc* masked_locations; /**< masked locations, only non-NULL for soft-masking. */
@@ -260,6 +262,8 @@ typedef struct BlastMBLookupTable {
                            the backbone */
     Int4 longest_chain; /**< Largest number of query positions for a given 
                            word */
+    Boolean scan_avx2;  /**< Can the AVX2 subject scanner be used; set when
+                           the table is built */
     void *scansub_callback; /**< function for scanning subject sequences */
     void *extend_callback;  /**< function for extending hits */
 
@@ -53,6 +53,14 @@ typedef Int4 (*TNaScanSubjectFunction)(const LookupTableWrap* lookup_wrap,
 NCBI_XBLAST_EXPORT
 void BlastChooseNucleotideScanSubject(LookupTableWrap *lookup_wrap);
 
+/** Report whether the AVX2 subject scanners can run on this CPU.
+ * Lookup tables call this once when they are built and keep the answer,
+ * so choosing a scanning routine never probes the CPU
+ * @return TRUE if this build has the AVX2 scanners and the CPU supports them
+ */
+NCBI_XBLAST_EXPORT
+Boolean BlastNaScanHaveAVX2(void);
+
 /** Return the most generic function to scan through
  * nucleotide subject sequences
  * @param lookup_wrap Structure containing lookup table [in][out]
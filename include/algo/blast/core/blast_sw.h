@@ -52,6 +52,69 @@
 extern "C" {
 #endif
 
+/** Implementations of the score-only Smith-Waterman kernels. Values
+ * are ordered by increasing vector width; a request for an engine the
+ * CPU does not support falls back to the widest one it does support.
+ */
+typedef enum ESmithWatermanEngine {
+    eSWEngineAuto = 0,  /**< Widest engine supported by the CPU */
+    eSWEngineScalar,    /**< Portable reference implementation */
+    eSWEngineSSE2,      /**< Striped kernel, 8 x 16-bit lanes */
+    eSWEngineAVX2       /**< Striped kernel, 16 x 16-bit lanes */
+} ESmithWatermanEngine;
+
+/** Report the engine that eSWEngineAuto resolves to on this CPU. This
+ * probes the CPU on every call; BLAST_GapAlignStructNew calls it once
+ * and keeps the answer in BlastGapAlignStruct::sw_engine.
+ * @return The widest score-only engine available
+ */
+NCBI_XBLAST_EXPORT
+ESmithWatermanEngine Blast_SmithWatermanGetEngine(void);
+
+/** Compute the score of the best local alignment between two protein
+ * sequences (or between a PSSM and a protein sequence, if
+ * gap_align->positionBased is set). The striped (Farrar) kernels compute
+ * 16-bit scores and fall back to the scalar kernel whenever the score
+ * would saturate, so every engine returns the same value.
+ * @param A The first sequence, or the sequence described by the PSSM [in]
+ * @param a_size Length of the first sequence [in]
+ * @param B The second sequence [in]
+ * @param b_size Length of the second sequence [in]
+ * @param gap_open Gap open penalty [in]
+ * @param gap_extend Gap extension penalty [in]
+ * @param gap_align Auxiliary data for gapped alignment
+ *             (used for score matrix info) [in]
+ * @param engine Kernel to use [in]
+ * @return The score of the best local alignment between A and B
+ */
+NCBI_XBLAST_EXPORT
+Int4 Blast_SmithWatermanScoreOnly(const Uint1 *A, Int4 a_size,
+                                  const Uint1 *B, Int4 b_size,
+                                  Int4 gap_open, Int4 gap_extend,
+                                  BlastGapAlignStruct *gap_align,
+                                  ESmithWatermanEngine engine);
+
+/** Compute the score of the best local alignment between two nucleotide
+ * sequences, the first of which is in ncbi2na format. See
+ * Blast_SmithWatermanScoreOnly for the choice of engine.
+ * @param B The first sequence (must be in ncbi2na format) [in]
+ * @param b_size Length of the first sequence [in]
+ * @param A The second sequence (in blastna format) [in]
+ * @param a_size Length of the second sequence [in]
+ * @param gap_open Gap open penalty [in]
+ * @param gap_extend Gap extension penalty [in]
+ * @param gap_align Auxiliary data for gapped alignment
+ *             (used for score matrix info) [in]
+ * @param engine Kernel to use [in]
+ * @return The score of the best local alignment between A and B
+ */
+NCBI_XBLAST_EXPORT
+Int4 Blast_NuclSmithWatermanScoreOnly(const Uint1 *B, Int4 b_size,
+                                      const Uint1 *A, Int4 a_size,
+                                      Int4 gap_open, Int4 gap_extend,
+                                      BlastGapAlignStruct *gap_align,
+                                      ESmithWatermanEngine engine);
+
 /** Find all local alignments between two (unpacked) sequences, using 
  *  the Smith-Waterman algorithm, then save the list of alignments found. 
  *  The algorithm to recover all high-scoring local alignments, and not
@@ -218,6 +218,78 @@ Blast_RunTracebackSearchWithInterrupt(EBlastProgramType program,
    TInterruptFnPtr interrupt_search, SBlastProgress* progress_info,
                                       size_t num_threads);
 
+/** Callback receiving the final traceback results of one query.
+ * @param results Results structure in which only the hit list of
+ *                query_index is meaningful; the hit list is freed when the
+ *                callback returns, unless the callback takes it over by
+ *                setting it to NULL [in|out]
+ * @param query_index Index of the query whose results are final [in]
+ * @param user_data Argument given to Blast_RunTracebackSearchPerQuery [in]
+ * @return zero to continue the traceback, otherwise a status that stops it
+ */
+typedef Int2 (*TBlastQueryResultsFnPtr)(BlastHSPResults* results,
+                                        Int4 query_index, void* user_data);
+
+/** Tells whether Blast_RunTracebackSearchPerQuery can hand over the results
+ * of a query before the traceback of the other queries is complete.
+ * Composition based statistics, Smith-Waterman traceback, RPS-BLAST and
+ * traceback pipes need the results of all queries together.
+ * @param program BLAST program type [in]
+ * @param ext_options Word extension options [in]
+ * @param hsp_stream Source of HSP lists [in]
+ */
+NCBI_XBLAST_EXPORT
+Boolean
+Blast_TracebackCanStreamPerQuery(EBlastProgramType program,
+                                 const BlastExtensionOptions* ext_options,
+                                 const BlastHSPStream* hsp_stream);
+
+/** Same as Blast_RunTracebackSearchWithInterrupt, but instead of returning
+ * the results of all queries at once, passes the results of each query, in
+ * query order, to results_fn as soon as they are final and frees them right
+ * after. When Blast_TracebackCanStreamPerQuery is true, the subject sequences
+ * are aligned in OID order, each of them once for all the queries that hit
+ * it, and a query's results are final as soon as its last subject sequence
+ * is aligned; otherwise the traceback of all queries is completed first.
+ * @param program BLAST program type [in]
+ * @param query Query sequence(s) structure [in]
+ * @param query_info Additional query information [in]
+ * @param seq_src Source of subject sequences [in]
+ * @param score_options Scoring options [in]
+ * @param ext_options Word extension options, needed for cutoff scores 
+ *                    calculation only [in]
+ * @param hit_options Hit saving options [in]
+ * @param eff_len_options Options for calculating effective lengths [in]
+ * @param db_options Database options (database genetic code) [in]
+ * @param psi_options PSI BLAST options [in]
+ * @param sbp Scoring block with statistical parameters and matrix [in]
+ * @param hsp_stream Source of HSP lists. [in]
+ * @param rps_info RPS database information structure [in]
+ * @param pattern_blk PHI BLAST auxiliary data structure [in]
+ * @param results_fn Receives the results of each query [in]
+ * @param user_data Passed to results_fn [in]
+ * @param interrupt_search User specified function to interrupt search [in]
+ * @param progress_info User supplied data structure to aid interrupt [in]
+ * @param num_threads Maximum number of threads to spawn [in]
+ * @return zero on success, otherwise the first error status, which may be
+ *         the one returned by results_fn
+ */
+NCBI_XBLAST_EXPORT
+Int2 
+Blast_RunTracebackSearchPerQuery(EBlastProgramType program, 
+   BLAST_SequenceBlk* query, BlastQueryInfo* query_info, 
+   const BlastSeqSrc* seq_src, const BlastScoringOptions* score_options,
+   const BlastExtensionOptions* ext_options,
+   const BlastHitSavingOptions* hit_options,
+   const BlastEffectiveLengthsOptions* eff_len_options,
+   const BlastDatabaseOptions* db_options, 
+   const PSIBlastOptions* psi_options, BlastScoreBlk* sbp,
+   BlastHSPStream* hsp_stream, const BlastRPSInfo* rps_info, 
+   SPHIPatternSearchBlk* pattern_blk,
+   TBlastQueryResultsFnPtr results_fn, void* user_data,
+   TInterruptFnPtr interrupt_search, SBlastProgress* progress_info,
+   size_t num_threads);
+
 NCBI_XBLAST_EXPORT
 BlastSeqSrcSetRangesArg *
 BLAST_SetupPartialFetching(EBlastProgramType program_number,
@@ -60,11 +60,20 @@ typedef struct LookupTableWrap {
                                       search */
    void* lookup_callback;    /**< function used to look up an
                                   index->q_off pair */
+   const void* image;        /**< serialized lookup table that the arrays
+                                  of lut point into, or NULL if lut owns
+                                  its arrays (see LookupTableWrapAttachImage) */
+   void* image_release;      /**< function used to release image when the
+                                  lookup table is freed */
+   void* image_handle;       /**< argument passed to image_release */
 } LookupTableWrap;
 
 /** Function pointer type to check the presence of index->q_off pair */
 typedef Boolean (*T_Lookup_Callback)(const LookupTableWrap *, Int4, Int4);
 
+/** Function pointer type to release the storage behind a lookup table image */
+typedef void (*T_LookupImageRelease)(void* image_handle);
+
 /** Create the lookup table for all query words.
  * @param query The query sequence [in]
  * @param lookup_options What kind of lookup table to build? [in]
@@ -115,6 +124,74 @@ Int2 LookupTableWrapInit_MT(BLAST_SequenceBlk* query,
 NCBI_XBLAST_EXPORT
 LookupTableWrap* LookupTableWrapFree(LookupTableWrap* lookup);
 
+/** Compute a key identifying the lookup table that LookupTableWrapInit
+ * would build from the given inputs. Two searches whose keys match can
+ * share one lookup table image.
+ * @param query The query sequence [in]
+ * @param lookup_options Lookup table options [in]
+ * @param query_options Options for query setup [in]
+ * @param lookup_segments Locations on query to be used for lookup table
+ *                        construction [in]
+ * @param sbp Scoring block containing matrix [in]
+ * @return The key, or 0 if the lookup table cannot be stored as an image
+ *         (e.g. it depends on the database being searched)
+ */
+NCBI_XBLAST_EXPORT
+Uint8 LookupTableWrapImageKey(const BLAST_SequenceBlk* query,
+        const LookupTableOptions* lookup_options,
+        const QuerySetUpOptions* query_options,
+        const BlastSeqLoc* lookup_segments,
+        const BlastScoreBlk* sbp);
+
+/** Determine the number of bytes needed to serialize a lookup table.
+ * Only the protein, small nucleotide, nucleotide and megablast lookup
+ * tables can be serialized.
+ * @param lookup The lookup table [in]
+ * @param query The query sequence the table was built from [in]
+ * @return Size of the image in bytes, or 0 if the table cannot be serialized
+ */
+NCBI_XBLAST_EXPORT
+size_t LookupTableWrapImageSize(const LookupTableWrap* lookup,
+                                const BLAST_SequenceBlk* query);
+
+/** Serialize a finished lookup table into a contiguous, position
+ * independent buffer, suitable for writing to a file that other processes
+ * map read-only. The image is only valid on hosts with the same
+ * architecture as the one that wrote it.
+ * @param lookup The lookup table [in]
+ * @param query The query sequence the table was built from [in]
+ * @param key Key from LookupTableWrapImageKey, stored in the image [in]
+ * @param buffer Storage for the image, must be 8-byte aligned [out]
+ * @param buffer_size Size of buffer, at least LookupTableWrapImageSize [in]
+ * @return zero on success, -1 if the table cannot be serialized
+ */
+NCBI_XBLAST_EXPORT
+Int2 LookupTableWrapWriteImage(const LookupTableWrap* lookup,
+                               const BLAST_SequenceBlk* query, Uint8 key,
+                               void* buffer, size_t buffer_size);
+
+/** Create a lookup table whose arrays point into an image written by
+ * LookupTableWrapWriteImage, without copying them. The image must stay
+ * valid and unmodified until the lookup table is freed, at which point
+ * release (if not NULL) is called with release_handle.
+ * @param image The serialized lookup table, 8-byte aligned [in]
+ * @param image_size Size of the image in bytes [in]
+ * @param key Expected key of the image [in]
+ * @param query The query sequence; auxiliary query data the lookup table
+ *              needs at search time is computed here [in][out]
+ * @param release Function to call when the lookup table is freed [in]
+ * @param release_handle Argument for release [in]
+ * @param lookup_wrap_ptr The initialized lookup table [out]
+ * @return zero on success, -1 if the image is invalid or does not match
+ *         key and query; in that case release is not called
+ */
+NCBI_XBLAST_EXPORT
+Int2 LookupTableWrapAttachImage(const void* image, size_t image_size,
+                                Uint8 key, BLAST_SequenceBlk* query,
+                                T_LookupImageRelease release,
+                                void* release_handle,
+                                LookupTableWrap** lookup_wrap_ptr);
+
 /** Default size of offset arrays filled in a single ScanSubject call. */
 #define OFFSET_ARRAY_SIZE 4096
 
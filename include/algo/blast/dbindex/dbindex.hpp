@@ -476,6 +476,11 @@ class NCBI_XBLAST_EXPORT CDbIndex : public CObject
             unsigned long chunk_overlap;        /**< Amount by which individual chunks overlap. */
             unsigned long report_level;         /**< Verbose index creation. */
             unsigned long max_index_size;       /**< Maximum index size in megabytes. */
+            unsigned long num_threads;          /**< Number of threads used to build
+                                                     the offset lists; with more than
+                                                     one, the per-thread buckets make
+                                                     the peak memory about twice
+                                                     max_index_size. */
 
             std::string stat_file_name;         /**< File to write index statistics into. */
         };
@@ -746,13 +751,33 @@ class NCBI_XBLAST_EXPORT CDbIndex : public CObject
                 const SOptions & options
         );
 
+        /** Index memory usage statistics. */
+        struct SMemoryStats
+        {
+            Uint8 mapped;       /**< Bytes of index data mapped or allocated. */
+            Uint8 resident;     /**< Bytes of index data currently in RAM;
+                                     0 if resident_known is false. */
+            bool resident_known;/**< false if the resident size could not
+                                     be measured on this platform. */
+        };
+
         /** Load index.
 
-          @param fname  [I]     file containing index data
+          By default the index file is memory mapped read only and shared,
+          so that pages are brought in on first access and the OS page
+          cache is shared by all processes using the same index volume.
+
+          @param fname   [I]    file containing index data
+          @param nomap   [I]    if 'true', then read the file instead of
+                                mmap()'ing it
+          @param preload [I]    if 'true', then fault in the whole mapped
+                                index right away instead of on demand
 
           @return CRef to the loaded index
           */
-        static CRef< CDbIndex > Load( const std::string & fname, bool nomap = false );
+        static CRef< CDbIndex > Load( 
+                const std::string & fname, 
+                bool nomap = false, bool preload = false );
 
         /** Search the index.
 
@@ -824,6 +849,21 @@ class NCBI_XBLAST_EXPORT CDbIndex : public CObject
         */
         virtual void Remap() {}
 
+        /** Get the amount of memory used by the index data.
+
+            For memory mapped indices the resident size counts only
+            the pages currently present in physical memory.  It is
+            measured with mincore() and is unknown on other platforms
+            or if that call fails.
+
+            @return index memory usage statistics
+        */
+        virtual SMemoryStats GetMemoryStats() const
+        {
+            SMemoryStats result = { 0, 0, false };
+            return result;
+        }
+
     private:
 
         /** Load index from an open stream.
@@ -838,11 +878,14 @@ class NCBI_XBLAST_EXPORT CDbIndex : public CObject
             @param fname        [I]     index file name
             @param nomap        [I]     if 'true', then read the the file
                                         instead of mmap()'ing it
+            @param preload      [I]     if 'true', then fault in all pages
+                                        of the mapped file
             @return object containing loaded index data
         */
         template< bool LEGACY >
         static CRef< CDbIndex > LoadIndex( 
-                const std::string & fname, bool nomap = false );
+                const std::string & fname, 
+                bool nomap = false, bool preload = false );
 
         /** Actual implementation of seed searching.
             Must be implemented by child classes.
@@ -352,12 +352,13 @@ class CDbIndex_Impl : public CDbIndex
             @param idmap        [I]     mapping from ordinal source ids to bioseq ids
             @param data         [I]     index data read from the file in
                                             the case mmap() is not selected.
+            @param data_size    [I]     size of data in bytes
         */
         CDbIndex_Impl( 
                 CMemoryFile * map, 
                 const SIndexHeader & header,
                 const vector< string > & idmap,
-                TWord * data = 0 );
+                TWord * data = 0, size_t data_size = 0 );
 
         /** Object destructor. */
         ~CDbIndex_Impl() 
@@ -439,6 +440,11 @@ class CDbIndex_Impl : public CDbIndex
         */
         virtual void Remap();
 
+        /** Get the amount of memory used by the index data.
+            @sa CDbIndex::GetMemoryStats()
+        */
+        virtual SMemoryStats GetMemoryStats() const;
+
     private:
 
         /** The search procedure for this specialized index implementation.
@@ -456,6 +462,7 @@ class CDbIndex_Impl : public CDbIndex
         CMemoryFile * mapfile_;         /**< Memory mapped file. */
         TWord * map_;                   /**< Start of memory mapped file data. */
         TWord * map_start_;             /**< Start of the index data, when not mapped. */
+        size_t data_size_;              /**< Size of the index data, when not mapped. */
         TOffsetData * offset_data_;     /**< Offset lists. */
         size_t subject_map_offset_;     /**< Offset of the subject map in the index file. */
         unsigned long version_;         /**< Index format version. */
@@ -466,8 +473,9 @@ class CDbIndex_Impl : public CDbIndex
 template< bool LEGACY >
 CDbIndex_Impl< LEGACY >::CDbIndex_Impl(
         CMemoryFile * map, const SIndexHeader & header, 
-        const vector< string > & idmap, TWord * data )
-    : mapfile_( map ), map_start_( 0 ), version_( VERSION ),
+        const vector< string > & idmap, TWord * data, size_t data_size )
+    : mapfile_( map ), map_start_( 0 ), data_size_( data_size ), 
+      version_( VERSION ),
       stride_( GetIndexStride< LEGACY >( header ) )
 {
     header_ = header;
@@ -513,6 +521,27 @@ void CDbIndex_Impl< LEGACY >::Remap()
     }
 }
 
+//-------------------------------------------------------------------------
+bool GetResidentSize( const void * addr, size_t len, Uint8 & resident );
+
+template< bool LEGACY >
+CDbIndex::SMemoryStats CDbIndex_Impl< LEGACY >::GetMemoryStats() const
+{
+    SMemoryStats result = { 0, 0, false };
+
+    if( mapfile_ != 0 ) {
+        result.mapped = mapfile_->GetSize();
+        result.resident_known = GetResidentSize( 
+                mapfile_->GetPtr(), mapfile_->GetSize(), result.resident );
+    }
+    else if( map_start_ != 0 ) {
+        result.mapped = result.resident = data_size_;
+        result.resident_known = true;
+    }
+
+    return result;
+}
+
 //-------------------------------------------------------------------------
 template< bool LEGACY >
 CConstRef< CDbIndex::CSearchResults > 
@@ -525,11 +554,11 @@ CDbIndex_Impl< LEGACY >::DoSearch(
 }
 
 //-------------------------------------------------------------------------
-CMemoryFile * MapFile( const std::string & fname );
+CMemoryFile * MapFile( const std::string & fname, bool preload = false );
 
 template< bool LEGACY >
 CRef< CDbIndex > CDbIndex::LoadIndex( 
-        const std::string & fname, bool nomap )
+        const std::string & fname, bool nomap, bool preload )
 {
     vector< string > idmap;
     string idmap_fname = fname + ".map";
@@ -545,6 +574,7 @@ CRef< CDbIndex > CDbIndex::LoadIndex(
     CMemoryFile * map = 0;
     SIndexHeader header;
     TWord * data = 0;
+    size_t data_size = 0;
 
     if( nomap ) {
         Int8 l = CFile( fname ).GetLength();
@@ -561,16 +591,18 @@ CRef< CDbIndex > CDbIndex::LoadIndex(
         }
 
         s.read( (char *)data, l );
+        data_size = (size_t)l;
         header = ReadIndexHeader< LEGACY >( data );
     }
     else {
-        map = MapFile( fname );
+        map = MapFile( fname, preload );
         if( map != 0 ) {
             header = ReadIndexHeader< LEGACY >( map->GetPtr() );
         }
     }
 
-    result.Reset( new CDbIndex_Impl< LEGACY >( map, header, idmap, data ) );
+    result.Reset( new CDbIndex_Impl< LEGACY >( 
+                map, header, idmap, data, data_size ) );
     return result;
 }
 
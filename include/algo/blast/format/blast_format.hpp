@@ -408,6 +408,9 @@ private:
     /// Pointer to the SAM formatting object
     auto_ptr<CBlast_SAM_Formatter> m_SamFormatter;
 
+    /// Writer for the binary columnar tabular output, shared by all queries
+    CRef<CBlastColumnarTabularInfo> m_ColumnarTabular;
+
     string m_Cmdline;
 
     /// If true, print long sequence ids (database|accession)
@@ -37,6 +37,7 @@ Contents: Interface for k-mer counting
 ******************************************************************************/
 
 
+#include <corelib/ncbithr.hpp>
 #include <util/math/matrix.hpp>
 #include <objects/seqloc/Seq_loc.hpp>
 #include <objmgr/scope.hpp>
@@ -200,17 +201,24 @@ public:
                      bool repetitions = true);
 
     /// Perform preparations before k-mer counting common to all sequences.
-    /// Allocate buffer for storing temporary counts
+    /// Allocate buffer for storing temporary counts. The buffer belongs to
+    /// the calling thread, so several threads may count k-mers at the same
+    /// time, each between its own PreCount() and PostCount() calls
     ///
     static void PreCount(void);
 
-    /// Perform post-kmer counting tasks. Free buffer.
+    /// Perform post-kmer counting tasks. Free the calling thread's buffer.
     ///
     static void PostCount(void);
 
 
 private:
-    static TCount* ReserveCountsMem(unsigned int num_bits);
+    /// Allocate memory for counts of all possible k-mers
+    /// @param num_bits Number of bits needed to represent a letter [in]
+    /// @param smaller_mem Set to true if counts are indexed as numbers in
+    /// system with base alphabet size rather than as bit vectors [out]
+    /// @return Allocated array, must be freed with delete []
+    static TCount* ReserveCountsMem(unsigned int num_bits, bool& smaller_mem);
 
     static Uint4 GetAALetter(Uint1 letter)
     {
@@ -236,13 +244,15 @@ private:
 
 protected:
     vector<SVectorElement> m_Counts;
+    /// Positions of m_Counts elements kept as a plain array, so that
+    /// common k-mers can be found by comparing several positions at a time
+    vector<Uint4> m_Positions;
     unsigned int m_SeqLength;
     unsigned int m_NumCounts;
     static unsigned int sm_KmerLength;
     static unsigned int sm_AlphabetSize;
     static vector<Uint1> sm_TransTable;
     static bool sm_UseCompressed;
-    static TCount* sm_Buffer;
     static bool sm_ForceSmallerMem;
     static const unsigned int kLengthBitsThreshold = 32;
 };
@@ -555,10 +565,12 @@ public:
     /// @param counts List of k-mer counts vectors [in]
     /// @param fsim Function that computes distance betwee two vectors [in]
     /// @param dmat Distance matrix [out]
+    /// @param num_threads Number of threads used to compute distances, fsim
+    /// must be thread-safe if greater than 1 [in]
     ///
     static void ComputeDistMatrix(const vector<TKmerCounts>& counts,
                   double(*fsim)(const TKmerCounts&, const TKmerCounts&),
-                  TDistMatrix& dmat)
+                  TDistMatrix& dmat, unsigned int num_threads = 1)
         
     {
         if (counts.empty()) {
@@ -567,11 +579,28 @@ public:
         }
 
         dmat.Resize(counts.size(), counts.size(), 0.0);
-        for (int i=0;i < (int)counts.size() - 1;i++) {
-            for (int j=i+1;j < (int)counts.size();j++) {
-                dmat(i, j) = fsim(counts[i], counts[j]);
-                dmat(j, i) = dmat(i, j);
+
+        // Rows of the upper triangle are handed out to threads one at a time,
+        // each thread writes only the elements of its rows and their
+        // symmetric counterparts
+        if (num_threads > 1 && counts.size() > 2) {
+            int next_row = 0;
+            CFastMutex mutex;
+            vector< CRef<CDistMatrixThread> > threads;
+            for (unsigned int i=0;i < num_threads;i++) {
+                threads.push_back(CRef<CDistMatrixThread>(
+                          new CDistMatrixThread(counts, fsim, dmat, next_row,
+                                                mutex)));
+                threads.back()->Run();
             }
+            for (size_t i=0;i < threads.size();i++) {
+                threads[i]->Join();
+            }
+            return;
+        }
+
+        for (int i=0;i < (int)counts.size() - 1;i++) {
+            x_ComputeDistRow(counts, fsim, dmat, i);
         }
     }
 
@@ -592,21 +621,23 @@ public:
     /// @param counts List of k-mer counts vecotrs [in]
     /// @param dist_method Distance measure [in]
     /// @param dmat Distance matrix [out]
+    /// @param num_threads Number of threads used to compute distances [in]
     ///
     static void ComputeDistMatrix(const vector<TKmerCounts>& counts,
                                   EDistMeasures dist_method,
-                                  TDistMatrix& dmat)
+                                  TDistMatrix& dmat,
+                                  unsigned int num_threads = 1)
     {
         switch (dist_method) {
         case eFractionCommonKmersLocal:
             ComputeDistMatrix(counts, TKmerCounts::FractionCommonKmersDist, 
-                              dmat);
+                              dmat, num_threads);
             break;
         
         case eFractionCommonKmersGlobal:
             ComputeDistMatrix(counts, 
                               TKmerCounts::FractionCommonKmersGlobalDist, 
-                              dmat);
+                              dmat, num_threads);
             break;
         
         default:
@@ -620,15 +651,17 @@ public:
     /// and avoid copying
     /// @param counts List of k-mer counts vecotrs [in]
     /// @param dist_method Distance measure [in]
+    /// @param num_threads Number of threads used to compute distances [in]
     /// @return Distance matrix
     ///
     static auto_ptr<TDistMatrix> ComputeDistMatrix(
                                           const vector<TKmerCounts>& counts,
-                                          EDistMeasures dist_method)
+                                          EDistMeasures dist_method,
+                                          unsigned int num_threads = 1)
     {
         auto_ptr<TDistMatrix> dmat(new TDistMatrix(counts.size(), 
                                                    counts.size(), 0));
-        ComputeDistMatrix(counts, dist_method, *dmat.get());
+        ComputeDistMatrix(counts, dist_method, *dmat.get(), num_threads);
         return dmat;
     }
 
@@ -674,6 +707,61 @@ public:
         
         return links;
     }
+
+private:
+    typedef double(*TDistFunc)(const TKmerCounts&, const TKmerCounts&);
+
+    /// Compute distances between a counts vector and all vectors that
+    /// follow it
+    /// @param counts List of k-mer counts vectors [in]
+    /// @param fsim Function that computes distance betwee two vectors [in]
+    /// @param dmat Distance matrix [out]
+    /// @param row Index of the counts vector [in]
+    ///
+    static void x_ComputeDistRow(const vector<TKmerCounts>& counts,
+                                 TDistFunc fsim, TDistMatrix& dmat, int row)
+    {
+        for (int j=row+1;j < (int)counts.size();j++) {
+            dmat(row, j) = fsim(counts[row], counts[j]);
+            dmat(j, row) = dmat(row, j);
+        }
+    }
+
+    /// Thread that computes rows of distance matrix taking the next row
+    /// index from a counter shared by all threads
+    class CDistMatrixThread : public CThread
+    {
+    public:
+        CDistMatrixThread(const vector<TKmerCounts>& counts, TDistFunc fsim,
+                          TDistMatrix& dmat, int& next_row, CFastMutex& mutex)
+            : m_Counts(counts), m_Fsim(fsim), m_Dmat(dmat),
+              m_NextRow(next_row), m_Mutex(mutex)
+        {}
+
+    protected:
+        virtual void* Main(void)
+        {
+            for (;;) {
+                int row;
+                {{
+                    CFastMutexGuard guard(m_Mutex);
+                    row = m_NextRow++;
+                }}
+                if (row >= (int)m_Counts.size() - 1) {
+                    break;
+                }
+                x_ComputeDistRow(m_Counts, m_Fsim, m_Dmat, row);
+            }
+            return NULL;
+        }
+
+    private:
+        const vector<TKmerCounts>& m_Counts;
+        TDistFunc m_Fsim;
+        TDistMatrix& m_Dmat;
+        int& m_NextRow;
+        CFastMutex& m_Mutex;
+    };
 };
 
 
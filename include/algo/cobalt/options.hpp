@@ -691,6 +691,19 @@ public:
     ///   - false otherwise
     bool GetVerbose(void) const {return m_Verbose;}
 
+    /// Set number of threads used for computing k-mer distances between
+    /// sequences in query clustering
+    ///
+    /// Does not change the results
+    /// @param num_threads Number of threads [in]
+    ///
+    void SetNumThreads(unsigned int num_threads) {m_NumThreads = num_threads;}
+
+    /// Get number of threads used for computing k-mer distances
+    /// @return Number of threads
+    ///
+    unsigned int GetNumThreads(void) const {return m_NumThreads;}
+
     void SetInClustAlnMethod(EInClustAlnMethod method)
     {m_InClustAlnMethod = method;}
 
@@ -833,6 +846,8 @@ private:
 
     bool m_Verbose;
 
+    unsigned int m_NumThreads;
+
     vector<string> m_Messages;
 
     static const int kDefaultUserConstraintsScore = 1000000;
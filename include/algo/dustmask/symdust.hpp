@@ -139,6 +139,21 @@ class NCBI_XALGODUSTMASK_EXPORT CSymDustMasker
         /**\brief Selects the significant bits in triplet_type. */
         static const triplet_type TRIPLET_MASK = 0x3F;
 
+        /**\brief Encodings of sequence data stored in a contiguous buffer. */
+        enum ECoding
+        {
+            eIupacna,   /**< IUPACNA letters, one per byte. */
+            eNcbi2na    /**< Unpacked NCBI2NA values (0-3), one per byte. */
+        };
+
+        /**\brief Sequence data stored in a contiguous buffer. */
+        struct SSeqBuffer
+        {
+            const char * data_; /**< The sequence data. */
+            size_type len_;     /**< Sequence length in bases. */
+            ECoding coding_;    /**< Encoding of the sequence data. */
+        };
+
         /**
             \brief Object constructor.
             \param level score threshold
@@ -168,6 +183,43 @@ class NCBI_XALGODUSTMASK_EXPORT CSymDustMasker
         std::auto_ptr< TMaskList > operator()( const sequence_type & seq,
                                                size_type start, size_type stop );
 
+        /**
+            \brief Mask a part of the sequence stored in a contiguous buffer.
+
+            This avoids the per base overhead of CSeqVector access and
+            produces the same intervals as masking the same sequence data
+            through a CSeqVector.
+
+            \param seq the sequence to mask
+            \param start beginning position of the subsequence to mask
+            \param stop ending position of the subsequence to mask
+            \return list of masked intervals
+         */
+        std::auto_ptr< TMaskList > operator()( const SSeqBuffer & seq,
+                                               size_type start, size_type stop );
+
+        /**
+            \brief Mask a sequence stored in a contiguous buffer.
+            \param seq the sequence to mask
+            \return list of masked intervals
+         */
+        std::auto_ptr< TMaskList > operator()( const SSeqBuffer & seq );
+
+        /**
+            \brief Mask a set of sequences using several threads.
+
+            Each sequence is masked by a separate masker object with the
+            parameters of this one, so the results are the same as masking
+            every sequence with a freshly constructed masker.
+
+            \param seqs the sequences to mask
+            \param [out] res lists of masked intervals, one per sequence
+            \param num_threads number of threads to use
+         */
+        void MaskBuffers( const std::vector< SSeqBuffer > & seqs,
+                          std::vector< TMaskList > & res,
+                          unsigned int num_threads );
+
         /**
             \brief Mask a sequence and return result as a sequence of CSeq_loc
                    objects.
@@ -193,6 +245,8 @@ class NCBI_XALGODUSTMASK_EXPORT CSymDustMasker
         /**\internal Sequence iterator type. */
         typedef sequence_type::const_iterator seq_citer_type;
 
+        class CBufferSource;
+
         /** \internal
             \brief Class representing the set of triplets in a window.
          */
@@ -257,10 +311,37 @@ class NCBI_XALGODUSTMASK_EXPORT CSymDustMasker
 
             private:
                 
-                /**\internal Implementation type for triplets list. */
-                typedef std::deque< triplet_type > impl_type;
-                /**\internal Triplets list iterator type. */
-                typedef impl_type::const_iterator impl_citer_type;
+                /** \internal
+                    \brief Fixed capacity ring buffer holding the triplets
+                           of the window, the most recent one first.
+                 */
+                class impl_type
+                {
+                    public:
+
+                        impl_type() : head_( 0 ), size_( 0 ) {}
+
+                        Uint4 size() const { return size_; }
+                        triplet_type operator[]( Uint4 i ) const
+                        { return data_[(head_ + i)&MASK]; }
+                        triplet_type back() const 
+                        { return (*this)[size_ - 1]; }
+
+                        void push_front( triplet_type t )
+                        { head_ = (head_ - 1)&MASK; data_[head_] = t; ++size_; }
+                        void pop_back() { --size_; }
+
+                    private:
+
+                        /** Window sizes are limited to 64, so at most
+                            62 triplets are stored. */
+                        static const Uint4 MASK = 63;
+
+                        triplet_type data_[MASK + 1];
+                        Uint4 head_;
+                        Uint4 size_;
+                };
+
                 /**\internal Type for triplet counts tables. */
                 typedef Uint1 counts_type[64];
 
@@ -319,6 +400,16 @@ class NCBI_XALGODUSTMASK_EXPORT CSymDustMasker
         void save_masked_regions( 
                 TMaskList & res, size_type w, size_type start );
 
+        /** \internal
+            \brief Mask a part of the sequence.
+            \param src source of NCBI2NA bases by position
+            \param start beginning position of the subsequence to mask
+            \param stop ending position of the subsequence to mask
+            \param res the result list
+        */
+        void x_Mask( CBufferSource & src, size_type start, size_type stop,
+                     TMaskList & res );
+
         Uint4 level_;       /**<\internal Score threshold. */
         size_type window_;  /**<\internal Max window size. */
         size_type linker_;  /**<\internal Max distance at which consequtive masked intervals should be merged. */
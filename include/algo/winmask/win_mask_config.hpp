@@ -368,6 +368,14 @@ public:
      **/
     Uint4 Mem() const { return mem; }
 
+    /**
+     **\brief Number of threads used for n-mer frequency counting.
+     **
+     **\return number of threads
+     **
+     **/
+    Uint4 NumThreads() const { return num_threads; }
+
     /**
      **\brief n-mer size used for n-mer frequency counting.
      **
@@ -645,6 +653,7 @@ private:
     Uint1 merge_unit_step;          /**< unit step to use when merging intervals */
     bool fa_list;                   /**< indicates whether input is a list of fasta file names */
     Uint4 mem;                      /**< memory available for unit counts generator */
+    Uint4 num_threads;              /**< number of threads used by unit counts generator */
     Uint1 unit_size;                /**< unit size (used in unit counts generator */
     Uint8 genome_size;              /**< total size of the genome in bases */
     string input;                   /**< input file name */
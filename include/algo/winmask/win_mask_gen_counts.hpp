@@ -113,6 +113,7 @@ public:
      **\param use_ba use bit array optimization for optimized binary
      **              unit counts format
      **\param metadata the metadata string
+     **\param num_threads number of threads used for n-mer counting
      **
      **/
     CWinMaskCountsGenerator( const string & input,
@@ -130,7 +131,8 @@ public:
                              const CWinMaskUtil::CIdSet * ids,
                              const CWinMaskUtil::CIdSet * exclude_ids,
                              bool use_ba,
-                             string const & metadata );
+                             string const & metadata,
+                             Uint4 num_threads = 1 );
 
     /**
      **\brief Constructor.
@@ -161,6 +163,7 @@ public:
      **\param use_ba use bit array optimization for optimized binary
      **              unit counts format
      **\param metadata the metadata string
+     **\param num_threads number of threads used for n-mer counting
      **
      **/
     CWinMaskCountsGenerator( const string & input,
@@ -178,7 +181,8 @@ public:
                              const CWinMaskUtil::CIdSet * ids,
                              const CWinMaskUtil::CIdSet * exclude_ids,
                              bool use_ba,
-                             string const & metadata );
+                             string const & metadata,
+                             Uint4 num_threads = 1 );
 
     /**
      **\brief Object destructor.
@@ -200,15 +204,32 @@ private:
     /**\internal
      **\brief Compute n-mer frequency counts for a given prefix.
      **
-     **\param prefix the prefix string
+     ** The input is read once, in chunks of bounded size. The pieces
+     ** of each chunk are encoded in parallel, and each thread then
+     ** counts its own slice of the suffix range.
+     **
+     **\param prefix the prefix value
      **\param prefix_size the prefix length in base pairs
      **\param input list of input fasta files
+     **\param do_output whether to output the unit counts
      **
      **/
     void process( Uint4 prefix, Uint1 prefix_size, 
                   const vector< string > & input,
                   bool do_output );
 
+    /**\internal
+     **\brief Update the statistics with the counts for a prefix and
+     **       output the counts if requested.
+     **
+     **\param prefix the prefix value shifted to its position in the unit
+     **\param counts n-mer counts indexed by suffix
+     **\param do_output whether to output the unit counts
+     **
+     **/
+    void save_counts( Uint4 prefix, const vector< Uint4 > & counts,
+                      bool do_output );
+
     /**\internal
      **\brief Return the total length of all sequences in a
      **       fasta file.
@@ -240,6 +261,7 @@ private:
     const CWinMaskUtil::CIdSet * exclude_ids; /**<\internal set of ids to ignore */
 
     string infmt;                   /**<\internal input format */
+    Uint4 num_threads;              /**<\internal number of counting threads */
 };
 
 END_NCBI_SCOPE
@@ -35,6 +35,7 @@
 #define OBJTOOLS_ALIGN_FORMAT___TABULAR_HPP
 
 #include <corelib/ncbistre.hpp>
+#include <corelib/ncbifile.hpp>
 #include <objects/seqalign/Seq_align.hpp>
 #include <objects/seqloc/Seq_id.hpp>
 #include <objmgr/scope.hpp>
@@ -104,7 +105,7 @@ public:
     /// @param score Raw score [in]
     /// @param bit_score Bit score [in]
     /// @param evalue Expect value [in]
-    void SetScores(int score, double bit_score, double evalue);
+    virtual void SetScores(int score, double bit_score, double evalue);
     /// Set the HSP endpoints. Note that if alignment is on opposite strands,
     /// the subject offsets must be reversed.
     /// @param q_start Starting offset in query [in]
@@ -369,6 +370,8 @@ private:
 
     TSeqRange m_QueryRange;
     string m_CustomDelim;
+
+    friend class CBlastColumnarTabularInfo;
 };
 
 
@@ -750,6 +753,214 @@ private:
     int m_QueryAlignSeqEnd;
 };
 
+
+/// Binary, column oriented counterpart of the tabular output.
+///
+/// Each HSP becomes one row with the values behind the default tabular
+/// fields.  Rows are buffered and appended to the output stream in blocks
+/// of up to kRowsPerBlock rows; within a block each column is stored as a
+/// contiguous array of fixed width values, so a program that maps the file
+/// into memory can filter on a column without parsing any text.  Query and
+/// subject ids are kept in per-block string dictionaries: each distinct id
+/// is written once per block, and rows refer to ids by their index in the
+/// dictionary of their block, so the writer's memory use does not grow
+/// with the number of distinct ids in the file.
+///
+/// Rows are filled directly from the scores, identity count and Dense-seg
+/// of each HSP; the ids are looked up only when the query or subject
+/// changes.  Alignments of other kinds, or without a stored identity
+/// count, go through CBlastTabularInfo::SetFields.
+///
+/// File layout, in host byte order with every section padded to a
+/// multiple of 8 bytes:
+///   SFileHeader
+///   for each block:
+///     SBlockHeader
+///     the query ids, then the subject ids of the block, NUL-terminated
+///     the columns, in EColumn order
+///
+/// Use CBlastColumnarTabularReader to read the file or to convert it back
+/// to tabular text.
+class NCBI_ALIGN_FORMAT_EXPORT CBlastColumnarTabularInfo 
+    : public CBlastTabularInfo
+{
+public:
+    /// Columns of the file, in the order they are stored in each block
+    enum EColumn {
+        eQueryIndex = 0,     ///< Index of the query id (Int4)
+        eSubjectIndex,       ///< Index of the subject id (Int4)
+        eAlignLength,        ///< Alignment length (Int4)
+        eNumIdentical,       ///< Number of identities (Int4)
+        eNumGaps,            ///< Total number of gaps (Int4)
+        eNumGapOpenings,     ///< Number of gap openings (Int4)
+        eQueryStart,         ///< Starting offset in query (Int4)
+        eQueryEnd,           ///< Ending offset in query (Int4)
+        eSubjectStart,       ///< Starting offset in subject (Int4)
+        eSubjectEnd,         ///< Ending offset in subject (Int4)
+        eRawScore,           ///< Raw score (Int4)
+        eBitScoreValue,      ///< Bit score (double)
+        eEvalueValue,        ///< Expect value (double)
+        eNumColumns          ///< Sentinel value
+    };
+
+    /// Header at the start of the file
+    struct SFileHeader {
+        char  magic[8];      ///< kMagic
+        Uint4 version;       ///< kVersion
+        Uint4 byte_order;    ///< kByteOrderMark as written by the host
+        Uint4 num_columns;   ///< eNumColumns
+        Uint4 reserved;      ///< Always 0
+    };
+
+    /// Header at the start of each block
+    struct SBlockHeader {
+        Uint4 num_rows;          ///< Number of HSPs in this block
+        Uint4 num_query_ids;     ///< Distinct query ids in this block
+        Uint4 num_subject_ids;   ///< Distinct subject ids in this block
+        Uint4 id_bytes;          ///< Size of the ids, with padding
+    };
+
+    /// Identifies the file format
+    static const char kMagic[8];
+    /// Version of the file format
+    static const Uint4 kVersion = 2;
+    /// Used to detect a file written with a different byte order
+    static const Uint4 kByteOrderMark = 0x01020304;
+    /// Number of rows buffered before a block is written
+    static const size_t kRowsPerBlock = 65536;
+
+    /// Constructor; writes the file header
+    /// @param ostr Stream to write output to, opened in binary mode [in]
+    /// @param parse_local_ids Should the query deflines be parsed for local
+    /// IDs? [in]
+    CBlastColumnarTabularInfo(CNcbiOstream& ostr, bool parse_local_ids = false);
+
+    /// Destructor; writes any buffered rows
+    ~CBlastColumnarTabularInfo();
+
+    /// @inheritDoc
+    virtual void SetScores(int score, double bit_score, double evalue);
+
+    /// Set the values of the columns from an HSP
+    /// @param sal Seq-align of the HSP [in]
+    /// @param scope Scope used to look up the query and subject ids [in]
+    /// @param matrix Only used for alignments that are not Dense-segs [in]
+    /// @return 0 on success, -1 if a sequence was not found in the scope
+    int SetFields(const objects::CSeq_align& sal,
+                  objects::CScope& scope,
+                  CNcbiMatrix<int>* matrix=0);
+
+    /// Add the current HSP to the buffered rows
+    virtual void Print(void);
+
+    /// Write the buffered rows as a block
+    void Flush(void);
+
+private:
+    /// Look up an id in a dictionary, adding it if it is new
+    /// @param id Id to look up [in]
+    /// @param dict Dictionary of ids [in|out]
+    /// @param ids Ids of the dictionary in index order [in|out]
+    /// @return Index of id in dict
+    static Int4 x_GetIdIndex(const string& id, map<string, Int4>& dict,
+                             vector<string>& ids);
+
+    /// Set the index of the query or subject id of the current HSP,
+    /// looking the id up only if it differs from that of the last HSP
+    /// @param id Seq-id from the alignment [in]
+    /// @param scope Scope to look the sequence up in [in]
+    /// @param query Whether id is the query id [in]
+    /// @return false if the sequence was not found in the scope
+    bool x_SetIdIndex(const objects::CSeq_id& id, objects::CScope& scope,
+                      bool query);
+
+    /// Query ids of the buffered rows, with their index
+    map<string, Int4> m_QueryIds;
+    /// Subject ids of the buffered rows, with their index
+    map<string, Int4> m_SubjectIds;
+    /// Query ids of the buffered rows, in index order
+    vector<string> m_QueryIdList;
+    /// Subject ids of the buffered rows, in index order
+    vector<string> m_SubjectIdList;
+    /// Alignment Seq-id of the last query looked up
+    CConstRef<objects::CSeq_id> m_LastQuerySeqId;
+    /// Alignment Seq-id of the last subject looked up
+    CConstRef<objects::CSeq_id> m_LastSubjectSeqId;
+    /// Index of the query id of the current HSP
+    Int4 m_QueryIndex;
+    /// Index of the subject id of the current HSP
+    Int4 m_SubjectIndex;
+    /// Integer columns of the buffered rows
+    vector<Int4> m_IntColumns[eBitScoreValue];
+    /// Floating point columns of the buffered rows
+    vector<double> m_DoubleColumns[eNumColumns - eBitScoreValue];
+    /// Bit score of the current HSP
+    double m_BitScoreValue;
+    /// Expect value of the current HSP
+    double m_EvalueValue;
+};
+
+
+/// Reads a file written by CBlastColumnarTabularInfo.  The file is mapped
+/// into memory and the columns of each block are returned in place.
+class NCBI_ALIGN_FORMAT_EXPORT CBlastColumnarTabularReader
+{
+public:
+    /// Open a file and check its header
+    /// @param filename Name of the file [in]
+    /// @throw CException if the file is not in the expected format
+    CBlastColumnarTabularReader(const string& filename);
+
+    /// Advance to the next block
+    /// @return false if there are no more blocks
+    bool NextBlock(void);
+
+    /// Number of rows in the current block
+    size_t GetNumRows(void) const { return m_NumRows; }
+
+    /// Get an integer column of the current block
+    /// @param column Which column, one of eQueryIndex to eRawScore [in]
+    const Int4* GetIntColumn(CBlastColumnarTabularInfo::EColumn column) const;
+
+    /// Get a floating point column of the current block
+    /// @param column eBitScoreValue or eEvalueValue [in]
+    const double*
+    GetDoubleColumn(CBlastColumnarTabularInfo::EColumn column) const;
+
+    /// Get a query id by its index in the eQueryIndex column of the
+    /// current block
+    const string& GetQueryId(Int4 index) const;
+
+    /// Get a subject id by its index in the eSubjectIndex column of the
+    /// current block
+    const string& GetSubjectId(Int4 index) const;
+
+    /// Write the remaining blocks as tabular output with the default fields
+    /// (output format 6)
+    /// @param ostr Stream to write to [in]
+    void PrintTabular(CNcbiOstream& ostr);
+
+private:
+    /// Read ids from the current block into a dictionary
+    const char* x_ReadIds(const char* p, const char* end, Uint4 num_ids,
+                          vector<string>& ids);
+
+    /// The mapped file
+    auto_ptr<CMemoryFile> m_File;
+    /// Start of the unread part of the file
+    const char* m_Next;
+    /// End of the file
+    const char* m_End;
+    /// Number of rows in the current block
+    size_t m_NumRows;
+    /// Columns of the current block
+    const char* m_Columns[CBlastColumnarTabularInfo::eNumColumns];
+    /// Query ids of the current block
+    vector<string> m_QueryIds;
+    /// Subject ids of the current block
+    vector<string> m_SubjectIds;
+};
+
 END_SCOPE(align_format)
 END_NCBI_SCOPE
 
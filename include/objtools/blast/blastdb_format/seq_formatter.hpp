@@ -70,12 +70,33 @@ struct CBlastDB_FormatterConfig {
 class NCBI_BLASTDB_FORMAT_EXPORT CBlastDB_Formatter
 {
 public:
-    CBlastDB_Formatter() {}
+    CBlastDB_Formatter() : m_Batch(NULL) {}
 
     virtual int Write(CSeqDB::TOID oid, const CBlastDB_FormatterConfig & config, string target_id = kEmptyStr) = 0;
     virtual void DumpAll(const CBlastDB_FormatterConfig & config) = 0;
     virtual ~CBlastDB_Formatter() {}
 
+    /// Returns true if Write() reads the sequence data, i.e. if a
+    /// batch set with SetSequenceBatch() would be used
+    virtual bool UsesSequenceBatch() const { return false; }
+
+    /// Set the sequences fetched with CSeqDB::GetAmbigSeqBatch()
+    /// (kSeqDBNuclNcbiNA8 encoding) that Write() should use instead of
+    /// reading them one at a time from the database.  OIDs not in the
+    /// batch are still read from the database.  The batch is not
+    /// copied and must outlive the Write() calls; pass NULL to stop
+    /// using it.
+    /// @param batch sequences of the OIDs about to be written [in]
+    void SetSequenceBatch(const CSeqDB::SSequenceBatch * batch) { m_Batch = batch; }
+
+protected:
+    /// Returns the index of the oid in the sequence batch, or -1 if
+    /// there is no batch or the oid is not in it
+    int x_FindInBatch(CSeqDB::TOID oid) const;
+
+    /// Sequences to write, may be NULL
+    const CSeqDB::SSequenceBatch * m_Batch;
+
 private:
     /// Prohibit copy constructor
     CBlastDB_Formatter(const CBlastDB_Formatter& rhs);
@@ -96,6 +117,7 @@ public:
 
     int Write(CSeqDB::TOID oid, const CBlastDB_FormatterConfig & config, string target_id = kEmptyStr);
     void DumpAll(const CBlastDB_FormatterConfig & config);
+    bool UsesSequenceBatch() const { return (m_OtherFields & (1 << e_seq)) != 0; }
 
 private:
     /// Fields not in defline
@@ -150,6 +172,7 @@ public:
 
     /// Retun 0 if Sucess otherwise -1
     int Write(CSeqDB::TOID oid, const CBlastDB_FormatterConfig & config, string target_id = kEmptyStr);
+    bool UsesSequenceBatch() const { return true; }
 
 private:
 
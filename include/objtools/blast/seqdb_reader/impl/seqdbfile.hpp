@@ -565,6 +565,41 @@ public:
         return m_MinLen;
     }
     
+    /// Get the address of an OID's sequence offset entry.
+    ///
+    /// @param oid
+    ///   The sequence to get the entry for.
+    /// @return
+    ///   A pointer into the mapped index file.
+    const char * GetSeqOffsetAddr(int oid) const
+    {
+        if(!m_Lease.IsMapped()) m_Lease.Init();
+        return (const char *) & x_GetSeq()[oid];
+    }
+    
+    /// Get the address of an OID's ambiguity offset entry.
+    ///
+    /// This is only valid for nucleotide volumes.
+    ///
+    /// @param oid
+    ///   The sequence to get the entry for.
+    /// @return
+    ///   A pointer into the mapped index file.
+    const char * GetAmbOffsetAddr(int oid) const
+    {
+        if(!m_Lease.IsMapped()) m_Lease.Init();
+        return (const char *) & x_GetAmb()[oid];
+    }
+    
+    /// Pin the sequence and ambiguity offset arrays.
+    ///
+    /// Index files are owned by the atlas and stay mapped for its
+    /// lifetime, so the raw offset arrays can be resolved once and
+    /// then read by any number of threads without synchronization.
+    /// After this call the Get*StartEnd() lookups for sequence and
+    /// ambiguity data are wait-free.
+    inline void PinOffsets();
+
     /// Release any memory leases temporarily held here.
     void UnLease()
     {
@@ -688,11 +723,31 @@ private:
     string m_LMDBFile;
     /// Volume number (only set in version 5 DBs)
     Uint4 m_Volume;
+
+    /// Pinned sequence offset array (NULL unless PinOffsets was called).
+    const Uint4 * m_SeqOffsets;
+
+    /// Pinned ambiguity offset array (NULL for protein volumes).
+    const Uint4 * m_AmbOffsets;
 };
 
+void
+CSeqDBIdxFile::PinOffsets()
+{
+    if(!m_Lease.IsMapped()) m_Lease.Init();
+    m_SeqOffsets = x_GetSeq();
+    m_AmbOffsets = ('n' == x_GetSeqType()) ? x_GetAmb() : NULL;
+}
+
 bool
 CSeqDBIdxFile::GetAmbStartEnd(int oid, TIndx & start, TIndx & end) const
 {
+    if (m_AmbOffsets) {
+        start = SeqDB_GetStdOrd(& m_AmbOffsets[oid]);
+        end   = SeqDB_GetStdOrd(& m_SeqOffsets[oid+1]);
+        return (start <= end);
+    }
+    
     if(!m_Lease.IsMapped()) m_Lease.Init();
     if ('n' == x_GetSeqType()) {
         start = SeqDB_GetStdOrd(& x_GetAmb()[oid]);
@@ -715,6 +770,17 @@ CSeqDBIdxFile::GetHdrStartEnd(int oid, TIndx & start, TIndx & end) const
 void
 CSeqDBIdxFile::GetSeqStartEnd(int oid, TIndx & start, TIndx & end) const
 {
+    if (m_SeqOffsets) {
+        start = SeqDB_GetStdOrd(& m_SeqOffsets[oid]);
+        
+        if (m_AmbOffsets) {
+            end = SeqDB_GetStdOrd(& m_AmbOffsets[oid]);
+        } else {
+            end = SeqDB_GetStdOrd(& m_SeqOffsets[oid+1]);
+        }
+        return;
+    }
+    
     if(!m_Lease.IsMapped()) m_Lease.Init();
     start = SeqDB_GetStdOrd(& x_GetSeq()[oid]);
     
@@ -728,6 +794,11 @@ CSeqDBIdxFile::GetSeqStartEnd(int oid, TIndx & start, TIndx & end) const
 void
 CSeqDBIdxFile::GetSeqStart(int oid, TIndx & start) const
 {
+    if (m_SeqOffsets) {
+        start = SeqDB_GetStdOrd(& m_SeqOffsets[oid]);
+        return;
+    }
+    
     if(!m_Lease.IsMapped()) m_Lease.Init();
     start = SeqDB_GetStdOrd(& x_GetSeq()[oid]);
 }
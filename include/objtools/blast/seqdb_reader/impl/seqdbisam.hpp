@@ -34,7 +34,7 @@
 /// ISAM index database access object.
 ///
 /// Defines classes:
-///     CSeqDBIsam
+///     CSeqDBAccessionHash, CSeqDBIsam
 ///
 /// Implemented for: UNIX, MS-Windows
 
@@ -114,6 +114,118 @@ s_SetTranslation(CSeqDBGiList & gis,
     }
 }
 
+/// ISeqDBKeyVerifier
+///
+/// Checks string ISAM keys against the Seq-ids of a sequence.  The
+/// accession hash index stores fingerprints rather than keys, so each
+/// OID it returns is confirmed through this interface before use.
+
+class NCBI_XOBJREAD_EXPORT ISeqDBKeyVerifier {
+public:
+    /// Destructor
+    virtual ~ISeqDBKeyVerifier() {}
+
+    /// Check whether a string ISAM key was stored for an OID.
+    ///
+    /// @param oid
+    ///   The OID, relative to the volume. [in]
+    /// @param key
+    ///   The key; case is ignored. [in]
+    /// @return
+    ///   true if one of the sequence's Seq-ids produces the key.
+    virtual bool HasStringKey(int oid, const string & key) const = 0;
+};
+
+/// CSeqDBAccessionHash
+///
+/// Reader for the accession hash index (".pai" or ".nai" file), an
+/// optional companion of the string ISAM written by makeblastdb
+/// -accession_hash.  Each lookup hashes the key and probes a memory
+/// mapped open-addressing table, so its cost does not depend on the
+/// size of the volume.  See CWriteDB_AccessionHash for the format.
+
+class NCBI_XOBJREAD_EXPORT CSeqDBAccessionHash : public CObject {
+public:
+    /// Import the type representing one OID.
+    typedef int TOid;
+
+    /// Constructor
+    ///
+    /// @param atlas
+    ///   The memory management layer object. [in]
+    /// @param dbname
+    ///   The name of the volume. [in]
+    /// @param prot_nucl
+    ///   'p' for protein or 'n' for nucleotide. [in]
+    CSeqDBAccessionHash(CSeqDBAtlas  & atlas,
+                        const string & dbname,
+                        char           prot_nucl);
+
+    /// Destructor
+    ~CSeqDBAccessionHash();
+
+    /// Find the OIDs of every entry stored under a key's fingerprint.
+    ///
+    /// Keys are compared case-insensitively, like string ISAM keys.
+    /// The OIDs are appended in increasing order.  A different key
+    /// with the same fingerprint also matches, so callers must check
+    /// the OIDs (see ISeqDBKeyVerifier).  This may be called
+    /// from several threads at once; the file is mapped again if
+    /// UnLease() has released it.
+    ///
+    /// @param key
+    ///   The string ISAM key to look up. [in]
+    /// @param oids
+    ///   Matching OIDs are appended here. [out]
+    /// @return
+    ///   true if at least one OID was found.
+    bool Lookup(const string & key, vector<TOid> & oids);
+
+    /// Release the memory mapping.
+    void UnLease();
+
+    /// Check whether a volume has an accession hash index.
+    ///
+    /// @param dbname
+    ///   The name of the volume. [in]
+    /// @param prot_nucl
+    ///   'p' for protein or 'n' for nucleotide. [in]
+    /// @return
+    ///   true if the file exists.
+    static bool Exists(const string & dbname, char prot_nucl);
+
+    /// Check whether accession hash indices should be used.
+    ///
+    /// Setting BLASTDB_ACCESSION_HASH to 0 in the environment forces
+    /// string ISAM lookups, which is mainly useful for comparisons.
+    static bool Enabled();
+
+private:
+    /// Map the file and validate its header.
+    void x_Init();
+
+    /// Append the OIDs stored under a fingerprint; the file must be mapped.
+    bool x_Probe(Uint8 fp, vector<TOid> & oids) const;
+
+    /// Name of the file.
+    string m_Fname;
+
+    /// Lease on the file.
+    CSeqDBFileMemMap m_Lease;
+
+    /// Number of slots minus one.
+    Uint8 m_Mask;
+
+    /// Fingerprint of each slot, big-endian.
+    const Uint8 * m_Keys;
+
+    /// OID of each slot, big-endian.
+    const Int4 * m_Oids;
+
+    /// Held shared by lookups and exclusively to unmap or remap the file.
+    CRWLock m_Lock;
+};
+
 /// CSeqDBIsam
 ///
 /// Manages one ISAM file, which will translate either PIGs, GIs, or
@@ -355,6 +467,18 @@ public:
     /// Return any memory held by this object to the atlas.
     void UnLease();
 
+    /// Set the object that confirms accession hash matches.
+    ///
+    /// String lookups use the accession hash index only when a
+    /// verifier is set; otherwise they search the ISAM.
+    ///
+    /// @param verifier
+    ///   Checks keys against Seq-ids; must outlive this object. [in]
+    void SetKeyVerifier(const ISeqDBKeyVerifier * verifier)
+    {
+        m_KeyVerifier = verifier;
+    }
+
     /// Get Numeric Bounds.
     ///
     /// Fetch the lowest, highest, and total number of numeric keys in
@@ -817,6 +941,50 @@ private:
     bool x_SparseStringToOids(const string   & acc,
                               vector<int>    & oids,
                               bool             adjusted);
+
+    /// Look up one key in the accession hash index.
+    ///
+    /// OIDs whose Seq-ids do not produce the key (fingerprint
+    /// collisions) are dropped by m_KeyVerifier.
+    ///
+    /// @param key
+    ///   The string ISAM key to look up. [in]
+    /// @param oids
+    ///   Confirmed OIDs are appended here. [out]
+    /// @return
+    ///   true if at least one OID was confirmed.
+    bool x_HashLookup(const string & key, vector<TOid> & oids);
+
+    /// String translation using the accession hash index.
+    ///
+    /// This tries the same keys in the same order as StringToOids()
+    /// but probes m_AccessionHash instead of searching the ISAM.
+    ///
+    /// @param acc
+    ///   The string to look up. [in]
+    /// @param oids
+    ///   The returned oids. [out]
+    /// @param adjusted
+    ///   Whether the simplification adjusted the string. [in]
+    /// @param version_check
+    ///   If the version can be stripped [in] and if it was [out].
+    void x_HashStringToOids(const string   & acc,
+                            vector<TOid>   & oids,
+                            bool             adjusted,
+                            bool           & version_check);
+
+    /// Seq-id list translation using the accession hash index.
+    ///
+    /// Does what x_TranslateGiList<string>() does with the string
+    /// ISAM: each ID in the list that is a key of this volume gets
+    /// its OID.  A key stored for several OIDs gets the lowest one.
+    ///
+    /// @param vol_start
+    ///   The starting OID for this ISAM file's database volume.
+    /// @param ids
+    ///   The Seq-id list to translate.
+    void x_HashTranslateSeqIdList(int            vol_start,
+                                  CSeqDBGiList & ids);
                               
 
     /// Find the first character to differ in two strings
@@ -1259,6 +1427,12 @@ private:
     /// Last volume key
     SIsamKey m_LastKey;
 
+    /// Accession hash index for string ISAMs, if present and enabled.
+    CRef<CSeqDBAccessionHash> m_AccessionHash;
+
+    /// Confirms accession hash matches; the hash is unused without it.
+    const ISeqDBKeyVerifier * m_KeyVerifier;
+
     /// Use Uint8 for the key
     bool m_LongId;
 
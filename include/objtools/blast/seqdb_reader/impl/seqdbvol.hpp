@@ -166,7 +166,7 @@ private:
 /// extensions (pin, phr, psq, nin, nhr, and nsq), plus the optional
 /// ISAM objects via the CSeqDBIsam class.
 
-class CSeqDBVol {
+class CSeqDBVol : public ISeqDBKeyVerifier {
 public:
     /// Import TIndx definition from the CSeqDBAtlas class.
     typedef CSeqDBAtlas::TIndx   TIndx;
@@ -210,6 +210,45 @@ public:
     ///     The lock holder object for this thread. [in]
     void OpenSeqFile(CSeqDBLockHold &locked) const;
 
+    /// Prepare this volume for lock-free sequence retrieval.
+    ///
+    /// Opens the sequence file and pins the index file's offset
+    /// arrays, so that subsequent sequence fetches do not modify any
+    /// state shared between threads.  Must be called before the
+    /// volume is accessed from multiple threads.
+    void PrepareImmutable();
+
+    /// Hint that the given sequences will be read soon.
+    ///
+    /// Computes the byte ranges of the index offsets and sequence
+    /// data (including ambiguity data) of the given OIDs, merges
+    /// nearby ranges, and advises the kernel with MADV_WILLNEED so
+    /// that it starts reading them in before they are accessed.
+    ///
+    /// @param oids
+    ///     Sorted OIDs, local to this volume. [in]
+    void PrefetchSequences(const vector<int> & oids) const;
+
+    /// Append a whole decoded sequence to a caller-owned buffer.
+    ///
+    /// The sequence is decoded by the same code as GetAmbigSeq(),
+    /// including the offset ranges set by SetOffsetRanges(), but
+    /// without masks, and appended to buffer, which can be reused
+    /// between calls to avoid per-sequence allocations.  For
+    /// kSeqDBNuclBlastNA8 the residues are surrounded by sentinel
+    /// bytes, as with GetAmbigSeq().  Empty sequences are rejected
+    /// with an exception, as GetAmbigSeq() does.
+    ///
+    /// @param oid
+    ///     The OID of the sequence within this volume. [in]
+    /// @param nucl_code
+    ///     The encoding for nucleotide sequences. [in]
+    /// @param buffer
+    ///     The buffer to append the sequence to. [in|out]
+    /// @return
+    ///     The length of the sequence, not counting sentinels.
+    int AppendAmbigSeq(int oid, int nucl_code, vector<char> & buffer) const;
+
     /// Sequence length for protein databases.
     ///
     /// This method returns the length of the sequence in bases, and
@@ -412,6 +451,20 @@ public:
     ///   The list of Seq-id objects for this sequences.
     list< CRef<CSeq_id> > GetSeqIDs(int  oid) const;
 
+    /// Check whether a string ISAM key was stored for a sequence.
+    ///
+    /// The keys that CWriteDB stores for each of the sequence's
+    /// Seq-ids are rebuilt and compared to the given key.  This
+    /// confirms matches found through the accession hash index.
+    ///
+    /// @param oid
+    ///   The OID of the sequence. [in]
+    /// @param key
+    ///   The key; case is ignored. [in]
+    /// @return
+    ///   true if one of the Seq-ids produces the key.
+    virtual bool HasStringKey(int oid, const string & key) const;
+
     /// Get the GI of a sequence
     /// This method returns the gi of the sequence
     ///
@@ -1152,6 +1205,34 @@ private:
                       CSeqDB::TSequenceRanges *masks,
                       CSeqDBLockHold   & locked) const;
 
+    /// Decode a sequence into a buffer.
+    ///
+    /// This is the decoding part of x_GetAmbigSeq(), shared with
+    /// AppendAmbigSeq().  The buffer must have room for the range
+    /// and, for kSeqDBNuclBlastNA8, the two sentinel bytes.
+    ///
+    /// @param oid
+    ///     The OID of the sequence within this volume. [in]
+    /// @param tmp
+    ///     The packed sequence data from x_GetSequence(). [in]
+    /// @param buffer
+    ///     The buffer to decode the sequence into. [out]
+    /// @param nucl_code
+    ///     The encoding for nucleotide sequences. [in]
+    /// @param has_region
+    ///     True if the caller asked for a region of the sequence. [in]
+    /// @param range
+    ///     The range of the sequence to decode. [in]
+    /// @param masks
+    ///     The ranges of the sequence to mask, or NULL. [in]
+    void x_DecodeAmbigSeq(int                       oid,
+                          const char              * tmp,
+                          char                    * buffer,
+                          int                       nucl_code,
+                          bool                      has_region,
+                          const SSeqDBSlice       & range,
+                          CSeqDB::TSequenceRanges * masks) const;
+
     /// Allocate memory in one of several ways.
     ///
     /// This method provides functionality to allocate memory with the
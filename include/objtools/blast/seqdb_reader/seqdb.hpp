@@ -799,6 +799,77 @@ public:
     ///   A pointer to the sequence data to release.
     void RetAmbigSeq(const char ** buffer) const;
 
+    /// Sequences fetched by GetAmbigSeqBatch().
+    ///
+    /// All residues live in one arena which is reused (not freed)
+    /// between calls, so fetching many batches through the same
+    /// object does not allocate per sequence.
+    struct SSequenceBatch {
+        /// OIDs of the sequences in the batch.
+        vector<int> oids;
+
+        /// Offset of the first residue of each sequence in the arena.
+        vector<size_t> offsets;
+
+        /// Length of each sequence (not counting sentinels).
+        vector<int> lengths;
+
+        /// Storage for the residues of all sequences.
+        vector<char> arena;
+
+        /// Number of sequences in the batch.
+        size_t Size() const { return oids.size(); }
+
+        /// Residues of the i-th sequence of the batch.
+        const char * GetSequence(size_t i) const
+        {
+            return arena.data() + offsets[i];
+        }
+
+        /// Empty the batch, keeping its storage.
+        void Clear()
+        {
+            oids.clear();
+            offsets.clear();
+            lengths.clear();
+            arena.clear();
+        }
+    };
+
+    /// Hint that a set of sequences will be read soon.
+    ///
+    /// The byte ranges of the sequence data and index offsets of the
+    /// given OIDs are merged and passed to the kernel as
+    /// MADV_WILLNEED, so that the pages are read in (in parallel, and
+    /// in file order) before the sequences are actually fetched.
+    /// This mainly helps cold-cache and network file system access to
+    /// scattered OIDs.  Invalid OIDs are ignored.
+    ///
+    /// @param oids
+    ///   The OIDs to prefetch, sorted in increasing order.
+    void PrefetchSequences(const vector<int> & oids) const;
+
+    /// Fetch a batch of sequences with ambiguities.
+    ///
+    /// The sequences are prefetched as by PrefetchSequences() and
+    /// then decoded by the same code as GetAmbigSeq() into the arena
+    /// of the given batch object, replacing its previous contents.
+    /// Offset ranges set with SetOffsetRanges() are honored; residues
+    /// outside them are left as zero bytes.  For kSeqDBNuclBlastNA8
+    /// each sequence is surrounded by sentinel bytes.  No
+    /// RetAmbigSeq() call is needed.  As with GetAmbigSeq(), an
+    /// exception is thrown for an empty sequence.
+    ///
+    /// @param oids
+    ///   The OIDs to fetch, sorted in increasing order.
+    /// @param nucl_code
+    ///   The encoding to use for nucleotide sequences.
+    /// @param batch
+    ///   The fetched sequences are returned here.
+    void GetAmbigSeqBatch(const vector<int> & oids,
+                          int                 nucl_code,
+                          SSequenceBatch    & batch) const;
+
     /// Gets a list of sequence identifiers.
     ///
     /// This returns the list of CSeq_id identifiers associated with
@@ -1484,6 +1555,19 @@ public:
     /// @param num_threads   Number of threads
     void SetNumberOfThreads(int num_threads, bool force_mt = false);
 
+    /// Treat the database as immutable for lock-free retrieval
+    ///
+    /// Maps all sequence files and pins the index offsets up front,
+    /// after which GetSequence, GetAmbigSeq, GetSeqLength and their
+    /// Ret* counterparts no longer take the atlas lock, so one CSeqDB
+    /// object can be shared by many threads.  The database files must
+    /// not change while the object is open.  This should be called by
+    /// the master thread before multiple threads run.  BLAST searches
+    /// enable it on the databases they open themselves.
+    ///
+    /// @param immutable True to enable immutable mode.
+    void SetImmutableMode(bool immutable = true);
+
     /// Retrieve the disk usage in bytes for this BLAST database
     Int8 GetDiskUsage() const;
 
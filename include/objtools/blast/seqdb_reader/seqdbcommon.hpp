@@ -2031,6 +2031,19 @@ bool IsStringId(const CSeq_id & id);
 NCBI_XOBJREAD_EXPORT
 string GetBlastSeqIdString(const CSeq_id & seqid, bool version);
 
+/// Fingerprint of a string identifier for the accession hash index.
+///
+/// The key is hashed case-insensitively (ASCII), matching the string
+/// ISAM's key comparison.  The result is never zero, because zero
+/// marks an empty slot in the index file.  This function is part of
+/// the file format and must not change.
+///
+/// @param key Start of the key. [in]
+/// @param length Length of the key in bytes. [in]
+/// @return Nonzero 64 bit fingerprint.
+NCBI_XOBJREAD_EXPORT
+Uint8 SeqDB_AccessionHash(const char * key, size_t length);
+
 END_NCBI_SCOPE
 
 #endif // OBJTOOLS_BLAST_SEQDB_READER___SEQDBCOMMON__HPP
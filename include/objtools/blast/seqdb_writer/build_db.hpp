@@ -398,6 +398,15 @@ public:
     /// @param max_file_size Maximum file size in bytes.
     void SetMaxFileSize(Uint8 max_file_size);
 
+    /// Set the number of threads used to prepare sequences.
+    ///
+    /// Sequence packing and header serialization are done on up to
+    /// this many threads, overlapping with reading of the input.  The
+    /// database produced does not depend on the number of threads.
+    ///
+    /// @param num_threads Number of threads to use.
+    void SetNumberOfThreads(int num_threads);
+
     /// Define a masking algorithm.
     ///
     /// The returned integer ID will be defined as corresponding to the
@@ -123,7 +123,11 @@ public:
         // Specialized ISAMs; these can be ORred into the above.
 
         /// Add an index from sequence hash to OID.
-        eAddHash = 0x100
+        eAddHash = 0x100,
+
+        /// Add a compact hash index from string identifiers to OID
+        /// alongside the string ISAM (BLAST database version 4 only).
+        eAddAccessionHash = 0x200
     };
     typedef int TIndexType; ///< Bitwise OR of "EIndexType"
 
@@ -346,6 +350,34 @@ public:
     /// @param letters Maximum letters to pack in one volume. [in]
     void SetMaxVolumeLetters(Uint8 letters);
 
+    /// Set the number of threads used to prepare sequences.
+    ///
+    /// With more than one thread, sequences are collected in batches
+    /// and their headers and packed sequence data are computed in
+    /// parallel, in the background, while the caller continues to add
+    /// sequences.  Sequences are still written in the order they were
+    /// added, and the files produced are identical to those of a
+    /// single threaded build.  In this mode, objects provided to
+    /// WriteDB must not be modified after they are added.  The default
+    /// is one thread.
+    ///
+    /// @param num_threads Number of threads to use. [in]
+    void SetNumberOfThreads(int num_threads);
+
+    /// Append to the existing database with this name.
+    ///
+    /// The database must have been built by WriteDB with the same
+    /// sequence type and format version.  New sequences are written
+    /// to new volumes numbered after the existing ones (a single
+    /// volume database is first renamed to volume 00), and the alias
+    /// file is rewritten to list all volumes with the updated
+    /// sequence count and length.  For version 5 databases the LMDB
+    /// accession index is updated in place and the tax id and OID
+    /// lookup files are extended to cover the new OIDs.  Existing
+    /// volumes are not modified.  This must be called before any
+    /// sequences are added.
+    void AppendToExisting();
+
     /// Extract Deflines From Bioseq.
     ///
     /// Deflines are extracted from the CBioseq and returned to the
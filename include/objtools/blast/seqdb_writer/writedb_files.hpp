@@ -277,6 +277,12 @@ public:
         m_Amb.push_back(seq); // Also not a bug.
     }
 
+    /// Get the number of sequence letters added so far.
+    Uint8 GetLetters() const
+    {
+        return m_Letters;
+    }
+
 private:
     /// Compute index file overhead.  This is the overhead used by all
     /// fields of the index file, and does account for padding.
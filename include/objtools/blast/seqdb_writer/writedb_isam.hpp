@@ -34,7 +34,8 @@
 /// Code for database isam construction.
 ///
 /// Defines classes:
-///     CWriteDB_IsamIndex, CWriteDB_IsamData, CWriteDB_Isam
+///     CWriteDB_IsamIndex, CWriteDB_IsamData, CWriteDB_AccessionHash,
+///     CWriteDB_Isam
 ///
 /// Implemented for: UNIX, MS-Windows
 
@@ -69,6 +70,9 @@ enum EWriteDBIsamType {
 /// Forward definition for CWriteDB_IsamData class.
 class CWriteDB_IsamData;
 
+/// Forward definition for CWriteDB_AccessionHash class.
+class CWriteDB_AccessionHash;
+
 /// CWriteDB_IsamIndex class
 /// 
 /// Manufacture an isam index file from sequence IDs.
@@ -91,12 +95,16 @@ public:
     /// @param index    Index of the associated volume. [in]
     /// @param datafile Corresponding ISAM data file. [in]
     /// @param sparse   Set to true if sparse mode should be used. [in]
-    CWriteDB_IsamIndex(EIsamType               itype,
-                       const string          & dbname,
-                       bool                    protein,
-                       int                     index,
-                       CRef<CWriteDB_IsamData> datafile,
-                       bool                    sparse);
+    /// @param hashfile Accession hash index fed with every string key,
+    ///                 or null for none. [in]
+    CWriteDB_IsamIndex(EIsamType                    itype,
+                       const string               & dbname,
+                       bool                         protein,
+                       int                          index,
+                       CRef<CWriteDB_IsamData>      datafile,
+                       bool                         sparse,
+                       CRef<CWriteDB_AccessionHash> hashfile
+                           = CRef<CWriteDB_AccessionHash>());
     
     /// Destructor.
     ~CWriteDB_IsamIndex();
@@ -355,6 +363,9 @@ private:
     /// The data file associated with this index file.
     CRef<CWriteDB_IsamData> m_DataFile;
 
+    /// Accession hash index receiving the same keys, if any.
+    CRef<CWriteDB_AccessionHash> m_HashFile;
+
     /// OID being to which seqid strings are being added
     int                     m_Oid;  
     /// Keep track of string seqids associated with current value of m_Oid
@@ -392,6 +403,67 @@ private:
     void x_Flush();
 };
 
+/// CWriteDB_AccessionHash class
+///
+/// Builds the accession hash index (".pai" or ".nai" file), a compact
+/// alternative to the string ISAM for exact key lookups.  The file is
+/// an open-addressing hash table of 64 bit key fingerprints (see
+/// SeqDB_AccessionHash) and OIDs, so a lookup is one or two probes of
+/// a memory mapped array instead of a binary search over samples and
+/// a scan of a data page.  Keys themselves are not stored, so readers
+/// confirm each match against the sequence's Seq-ids.
+///
+/// Format (all integers big-endian):
+///     Int4 format version (1)
+///     Int4 number of entries
+///     Int4 number of slots (a power of two)
+///     Int4 reserved (0)
+///     Uint8 fingerprint[slots]  (0 marks an empty slot)
+///     Int4  oid[slots]
+///
+/// Entry i lives at the first empty slot at or after (fingerprint &
+/// (slots-1)), wrapping around; duplicate keys occupy several slots.
+
+class NCBI_XOBJWRITE_EXPORT CWriteDB_AccessionHash : public CWriteDB_File {
+public:
+    /// Version number written to the file header.
+    static const int kFormatVersion = 1;
+
+    /// Constructor.
+    ///
+    /// @param dbname  Database name (same for all volumes). [in]
+    /// @param protein True for protein, false for nucleotide. [in]
+    /// @param index   Index of the associated volume. [in]
+    CWriteDB_AccessionHash(const string & dbname,
+                           bool           protein,
+                           int            index);
+
+    /// Destructor.
+    ~CWriteDB_AccessionHash();
+
+    /// Add one string key.
+    ///
+    /// @param oid OID of the sequence. [in]
+    /// @param key Key data, as stored in the string ISAM. [in]
+    /// @param size Length of the key. [in]
+    void AddKey(int oid, const char * key, int size);
+
+    /// Tests whether any keys were added.
+    bool Empty() const
+    {
+        return m_Entries.empty() && ! m_Created;
+    }
+
+private:
+    void x_Flush();
+
+    /// Fingerprint and OID pairs.
+    typedef vector< pair<Uint8, Int4> > TEntries;
+
+    /// Fingerprint and OID of each key, in insertion order.
+    TEntries m_Entries;
+};
+
 
 /// CWriteDB_Isam class
 /// 
@@ -415,12 +487,15 @@ public:
     /// @param index         Index of the associated volume. [in]
     /// @param max_file_size Maximum size of any generated file in bytes. [in]
     /// @param sparse        Set to true if sparse mode should be used. [in]
+    /// @param acc_hash      Also build an accession hash index; only
+    ///                      meaningful for eAcc. [in]
     CWriteDB_Isam(EIsamType      itype,
                   const string & dbname,
                   bool           protein,
                   int            index,
                   Uint8          max_file_size,
-                  bool           sparse);
+                  bool           sparse,
+                  bool           acc_hash = false);
     
     /// Destructor.
     ~CWriteDB_Isam();
@@ -500,6 +575,9 @@ private:
     
     /// Data file, contains one record for each key/oid pair.
     CRef<CWriteDB_IsamData> m_DFile;
+
+    /// Accession hash index file, or null if not requested.
+    CRef<CWriteDB_AccessionHash> m_HFile;
 };
 
 END_NCBI_SCOPE
@@ -51,6 +51,13 @@ BEGIN_NCBI_SCOPE
 
 /// This class supports creation of a string accession to integer OID
 /// lmdb database
+///
+/// Entries are collected in memory and loaded, in key order, when the
+/// object is destroyed.  Once the collected entries exceed a memory
+/// budget (4GB by default, or the LMDB_SORT_MEMORY environment
+/// variable, e.g. "512MB"), they are sorted and spilled to a temporary
+/// run file next to the database; the runs are merged at the end, so
+/// peak memory stays bounded for any number of accessions.
 
 class NCBI_XOBJREAD_EXPORT CWriteDB_LMDB : public CObject
 {
@@ -88,21 +95,53 @@ public:
     /// @see InsertEntry
     int InsertEntries(const vector<CRef<CSeq_id>> & seqids, const blastdb::TOid oid);
 
+    /// Prepare to add entries to an existing database
+    /// The new accessions are added to the existing database in place,
+    /// and the entries of the new oids are appended to the oid to seqids
+    /// lookup file.  This api must be called before any entries are
+    /// inserted, and the first oid inserted must be num_oids.
+    /// @param num_oids number of oids already in the database
+    void PrepareAppend(blastdb::TOid num_oids);
+
 private:
     void x_CommitTransaction();
     void x_InsertEntry(const CRef<CSeq_id> &seqid, const blastdb::TOid oid);
     void x_CreateOidToSeqidsLookupFile();
     void x_Resize();
+    /// Sort m_list in key order
+    void x_SortList();
+    /// Spill m_list to disk if it has outgrown the memory budget
+    void x_CheckSortMemory(size_t first_new_entry);
+    /// Append the oid to seqids data of m_list to the spill body file
+    void x_AppendOidToSeqids();
+    /// Sort m_list, write it as a run file and clear it
+    void x_WriteSortedRun();
 
     string m_Db;
     lmdb::env  &m_Env;
     Uint8 m_ListCapacity;
     unsigned int m_MaxEntryPerTxn;
+    /// Memory budget for m_list in bytes (0 means unlimited)
+    Uint8 m_MaxSortMemory;
+    /// Approximate memory used by m_list in bytes
+    Uint8 m_ListBytes;
+    /// Sorted runs spilled to disk
+    vector<string> m_SortRuns;
+    /// Oid to seqids data for spilled entries, and its size per oid
+    unique_ptr<CNcbiOfstream> m_OidToSeqidsBody;
+    vector<Uint4> m_OidToSeqidsSizes;
+    /// True if adding to an existing database
+    bool m_Append;
+    /// Number of oids already in the database
+    blastdb::TOid m_BaseOid;
     struct SKeyValuePair {
     	string id;
     	blastdb::TOid oid;
     	bool saveToOidList;
     	SKeyValuePair() : id(kEmptyStr), oid(kSeqDBEntryNotFound), saveToOidList(false) {}
+    	/// Run file i/o (saveToOidList is not kept)
+    	static void Write(CNcbiOstream & os, const SKeyValuePair & kv);
+    	static bool Read(CNcbiIstream & is, SKeyValuePair & kv);
     	static bool cmp_key(const SKeyValuePair & v, const SKeyValuePair & k) {
    			if(v.id == k.id) {
 				blastdb::TOid mask = 0xFF;
@@ -122,6 +161,9 @@ private:
 
 
 /// This class supports creation of tax id list lookup files
+///
+/// The tax id to oid pairs are subject to the same memory budget as
+/// CWriteDB_LMDB, and are spilled to sorted runs in the same way.
 
 class NCBI_XOBJREAD_EXPORT CWriteDB_TaxID : public CObject
 {
@@ -145,27 +187,74 @@ public:
     /// @see InsertEntry
     int InsertEntries(const set<Int4> & tax_ids, const blastdb::TOid oid);
 
+    /// Prepare to add entries to an existing database
+    /// Only the new oids are written: their tax id to oids lists are
+    /// appended to the lookup file and indexed in place, next to those
+    /// of the existing oids.  This api must be called before any entries
+    /// are inserted, and the first oid inserted must be num_oids.
+    /// @param num_oids number of oids already in the database
+    void PrepareAppend(blastdb::TOid num_oids);
+
 private:
     void x_CommitTransaction();
     void x_CreateOidToTaxIdsLookupFile();
     void x_CreateTaxIdToOidsLookupFile();
+    /// Open mode of the tax id to oids lookup file
+    IOS_BASE::openmode x_TaxIdToOidsOpenMode() const;
     void x_Resize();
+    /// Spill m_TaxId2OidList to disk if it has outgrown the memory budget
+    void x_CheckSortMemory();
+    /// Append the oid to tax ids data of the list to the spill body file
+    void x_AppendOidToTaxIds();
+    /// Sort m_TaxId2OidList, write it as a run file and clear it
+    void x_WriteSortedRun();
 
     string m_Db;
     lmdb::env  &m_Env;
     Uint8 m_ListCapacity;
     unsigned int m_MaxEntryPerTxn;
+    /// Memory budget for m_TaxId2OidList in bytes (0 means unlimited)
+    Uint8 m_MaxSortMemory;
+    /// Sorted runs spilled to disk
+    vector<string> m_SortRuns;
+    /// Oid to tax ids data for spilled entries, and its size per oid
+    unique_ptr<CNcbiOfstream> m_OidToTaxIdsBody;
+    vector<Uint4> m_OidToTaxIdsSizes;
+    /// True if adding to an existing database
+    bool m_Append;
+    /// Number of oids already in the database
+    blastdb::TOid m_BaseOid;
+    /// Size of the existing tax id to oids lookup file
+    Uint8 m_TaxIdToOidsBase;
     template <class valueType>
     struct SKeyValuePair {
     	Int4 tax_id;
     	valueType value;
-    	SKeyValuePair(int t, valueType v) : tax_id(t), value(v) {}
+    	SKeyValuePair(int t = 0, valueType v = 0) : tax_id(t), value(v) {}
+    	/// Run file i/o
+    	static void Write(CNcbiOstream & os, const SKeyValuePair & kv) {
+    		os.write((const char *) &kv.tax_id, sizeof(kv.tax_id));
+    		os.write((const char *) &kv.value, sizeof(kv.value));
+    	}
+    	static bool Read(CNcbiIstream & is, SKeyValuePair & kv) {
+    		is.read((char *) &kv.tax_id, sizeof(kv.tax_id));
+    		is.read((char *) &kv.value, sizeof(kv.value));
+    		return is.good();
+    	}
     	static bool cmp_key(const SKeyValuePair & v, const SKeyValuePair & k) {
    			if(v.tax_id == k.tax_id) {
    				return v.value < k.value;
    			}
     	    return v.tax_id < k.tax_id;
     	}
+    	/// Order in which LMDB stores keys and dup values (bytewise)
+    	static bool cmp_lmdb_key(const SKeyValuePair & v, const SKeyValuePair & k) {
+    		int rc = memcmp(&v.tax_id, &k.tax_id, sizeof(v.tax_id));
+    		if (rc == 0) {
+    			rc = memcmp(&v.value, &k.value, sizeof(v.value));
+    		}
+    		return rc < 0;
+    	}
     };
     vector<SKeyValuePair<blastdb::TOid> > m_TaxId2OidList;
     vector<SKeyValuePair<Uint8> > m_TaxId2OffsetsList;
@@ -730,7 +730,7 @@ x_CleanupProsplignCompartment(const CSeq_annot &compartment,
 	{
 		CRef<CSeq_align> prosplign_output = m_ProSplign->FindAlignment(
 				*m_Scope, *protein.GetSeqId(),
-				*genomic_loc, *m_ProSplignOutputOptions);
+				*genomic_loc, compartment, *m_ProSplignOutputOptions);
 		if (!prosplign_output->GetSegs().GetSpliced().GetExons().empty()) {
 			x_AddStandardAlignmentScores(*prosplign_output);
 			cleaned_aligns.push_back(prosplign_output);
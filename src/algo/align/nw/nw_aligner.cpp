@@ -35,6 +35,7 @@
 #include <ncbi_pch.hpp>
 
 #include "nw_aligner_threads.hpp"
+#include "nw_aligner_simd.hpp"
 #include "messages.hpp"
 
 #include <corelib/ncbi_system.hpp>
@@ -305,6 +306,74 @@ CNWAligner::TScore CNWAligner::x_Align(SAlignInOut* data)
 
     --k;
 
+    // Use the vectorized row kernel when available. The kernel relies on 
+    // opening a gap never being better than extending it.
+    const SNWRowKernel * kernel (m_Wg <= 0? NW_GetRowKernel(): 0);
+    if(kernel && N2 > 1) {
+
+        const size_t n2 = N2 - 1;
+        const bool later = m_GapPreference == eLater;
+        const char * seq2 = m_Seq2 + data->m_offset2;
+
+        CNWRowProfile prof (sm, seq2, n2);
+        vector<TScore> G (n2), E (n2), Vp (n2);
+        vector<Uint4> trc (n2);
+        TScore * rowV = &stl_rowV[0];
+
+        for(;  seq1 != seq1_end && !m_terminate;  ++seq1) {
+
+            backtrace_matrix.SetAt(++k, kMaskFc);
+
+            if( seq1 + 1 == seq1_end && bFreeGapRight1) {
+                wg1 = ws1 = 0;
+            }
+
+            // pass 1: diagonal and vertical gap scores
+            NW_RowPass1(kernel, rowV, &stl_rowF[0],
+                        prof.GetRow((unsigned char)*seq1), &G[0], &Vp[0],
+                        &trc[0], n2, m_Wg, m_Ws, bFreeGapRight2,
+                        m_SmithWaterman);
+
+            // pass 2: horizontal gap scores
+            V = V0 += wsleft2;
+            TScore Ecur = kInfMinus;
+            TScore Vleft = V;
+            for(size_t j = 0; j < n2; ++j) {
+                const TScore n0 = Vleft + wg1;
+                if(Ecur >= n0) {
+                    Ecur += ws1;
+                    trc[j] |= kMaskEc;
+                }
+                else {
+                    Ecur = n0 + ws1;
+                }
+                E[j] = Ecur;
+                Vleft = Vp[j];
+            }
+
+            // pass 3: best scores and backtrace
+            rowV[0] = V;
+            kernel->m_Pass3(&G[0], &stl_rowF[1], &E[0], rowV + 1, &trc[0],
+                            n2, later, m_SmithWaterman);
+
+            for(size_t j = 0; j < n2; ++j) {
+                backtrace_matrix.SetAt(++k, (unsigned char)trc[j]);
+                if (rowV[j + 1] > best_V) {
+                    best_V = rowV[j + 1];
+                    backtrace_matrix.SetBestPos(k);
+                }
+            }
+            V = rowV[n2];
+
+            if(m_prg_callback) {
+                m_prg_info.m_iter_done = k;
+                if( (m_terminate = m_prg_callback(&m_prg_info)) ) {
+                    break;
+                }
+            }
+        }
+    }
+
     for(;  seq1 != seq1_end && !m_terminate;  ++seq1) {
 
         backtrace_matrix.SetAt(++k, kMaskFc);
@@ -0,0 +1,326 @@
+/* $Id: nw_aligner_simd.cpp $
+ * ===========================================================================
+ *
+ *                            PUBLIC DOMAIN NOTICE                          
+ *               National Center for Biotechnology Information
+ *                                                                          
+ *  This software/database is a "United States Government Work" under the   
+ *  terms of the United States Copyright Act.  It was written as part of    
+ *  the author's official duties as a United States Government employee and 
+ *  thus cannot be copyrighted.  This software/database is freely available 
+ *  to the public for use. The National Library of Medicine and the U.S.    
+ *  Government have not placed any restriction on its use or reproduction.  
+ *                                                                          
+ *  Although all reasonable efforts have been taken to ensure the accuracy  
+ *  and reliability of the software and data, the NLM and the U.S.           
+ *  Government do not and cannot warrant the performance or results that    
+ *  may be obtained by using this software or data. The NLM and the U.S.    
+ *  Government disclaim all warranties, express or implied, including       
+ *  warranties of performance, merchantability or fitness for any particular
+ *  purpose.                                                                
+ *                                                                          
+ *  Please cite the author in any work or product based on this material.   
+ *
+ * ===========================================================================
+ *
+ * Authors:  Yuri Kapustin
+ *
+ * File Description:  Vectorized row kernels for CNWAligner
+ *                   
+ * ===========================================================================
+ *
+ */
+
+
+#include <ncbi_pch.hpp>
+#include "nw_aligner_simd.hpp"
+
+#include <stdlib.h>
+#include <atomic>
+
+#if defined(NCBI_SSE)  &&  NCBI_SSE >= 20  &&                          \
+    ((defined(__GNUC__)  &&  (__GNUC__ > 4  ||                          \
+                              (__GNUC__ == 4  &&  __GNUC_MINOR__ >= 9))) \
+     ||  defined(__clang__))
+#  define NW_HAVE_SIMD
+#  include <immintrin.h>
+#endif
+
+
+BEGIN_NCBI_SCOPE
+
+#ifdef NW_HAVE_SIMD
+
+typedef CNWAligner::TScore TScore;
+
+
+// Scalar versions of the passes, used for the elements
+// that do not fill a whole vector
+
+static inline void s_Pass1Scalar(const TScore* vdiag, const TScore* vup,
+                                 const TScore* prof, TScore* f, TScore* g,
+                                 TScore* vp, Uint4* trc, size_t i, size_t n,
+                                 TScore wg, TScore ws, bool sw)
+{
+    for(; i < n; ++i) {
+        g[i] = vdiag[i] + prof[i];
+        const TScore n0 = vup[i] + wg;
+        if(f[i] >= n0) {
+            f[i] += ws;
+            trc[i] = SNWRowKernel::fMaskFc;
+        }
+        else {
+            f[i] = n0 + ws;
+            trc[i] = 0;
+        }
+        TScore v = max(g[i], f[i]);
+        vp[i] = sw && v < 0? 0: v;
+    }
+}
+
+
+static inline void s_Pass3Scalar(const TScore* g, const TScore* f,
+                                 const TScore* e, TScore* v, Uint4* trc,
+                                 size_t i, size_t n, bool later, bool sw)
+{
+    for(; i < n; ++i) {
+        const TScore G = g[i], F = f[i], E = e[i];
+        TScore V;
+        if( G < F || ( G == F && later) ) {
+            if( E <= F ) {
+                V = F;
+            } else {
+                V = E;
+                trc[i] |= SNWRowKernel::fMaskE;
+            }
+        } else if( E > G || ( E == G && later) ) {
+            V = E;
+            trc[i] |= SNWRowKernel::fMaskE;
+        } else {
+            V = G;
+            trc[i] |= SNWRowKernel::fMaskD;
+        }
+        v[i] = sw && V < 0? 0: V;
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////
+// SSE4.1 kernel, four cells per vector
+
+__attribute__((target("sse4.1")))
+static void s_Pass1SSE41(const TScore* vdiag, const TScore* vup,
+                         const TScore* prof, TScore* f, TScore* g,
+                         TScore* vp, Uint4* trc, size_t n,
+                         TScore wg, TScore ws, bool sw)
+{
+    const __m128i vwg = _mm_set1_epi32(wg);
+    const __m128i vws = _mm_set1_epi32(ws);
+    const __m128i vfc = _mm_set1_epi32(SNWRowKernel::fMaskFc);
+    const __m128i vzero = _mm_setzero_si128();
+
+    size_t i = 0;
+    for(; i + 4 <= n; i += 4) {
+        __m128i G = _mm_add_epi32(_mm_loadu_si128((const __m128i*)(vdiag + i)),
+                                  _mm_loadu_si128((const __m128i*)(prof + i)));
+        __m128i n0 = _mm_add_epi32(_mm_loadu_si128((const __m128i*)(vup + i)),
+                                   vwg);
+        __m128i F = _mm_loadu_si128((const __m128i*)(f + i));
+        // f >= n0  <=>  !(n0 > f)
+        __m128i ext = _mm_andnot_si128(_mm_cmpgt_epi32(n0, F), vfc);
+        F = _mm_add_epi32(_mm_max_epi32(F, n0), vws);
+        _mm_storeu_si128((__m128i*)(g + i), G);
+        _mm_storeu_si128((__m128i*)(f + i), F);
+        _mm_storeu_si128((__m128i*)(trc + i), ext);
+        __m128i V = _mm_max_epi32(G, F);
+        _mm_storeu_si128((__m128i*)(vp + i), sw? _mm_max_epi32(V, vzero): V);
+    }
+
+    s_Pass1Scalar(vdiag, vup, prof, f, g, vp, trc, i, n, wg, ws, sw);
+}
+
+
+__attribute__((target("sse4.1")))
+static void s_Pass3SSE41(const TScore* g, const TScore* f, const TScore* e,
+                         TScore* v, Uint4* trc, size_t n, bool later, bool sw)
+{
+    const __m128i vlater = _mm_set1_epi32(later? -1: 0);
+    const __m128i ve = _mm_set1_epi32(SNWRowKernel::fMaskE);
+    const __m128i vd = _mm_set1_epi32(SNWRowKernel::fMaskD);
+    const __m128i vzero = _mm_setzero_si128();
+
+    size_t i = 0;
+    for(; i + 4 <= n; i += 4) {
+        __m128i G = _mm_loadu_si128((const __m128i*)(g + i));
+        __m128i F = _mm_loadu_si128((const __m128i*)(f + i));
+        __m128i E = _mm_loadu_si128((const __m128i*)(e + i));
+        __m128i T = _mm_loadu_si128((const __m128i*)(trc + i));
+
+        __m128i isF = _mm_or_si128(_mm_cmpgt_epi32(F, G),
+                          _mm_and_si128(vlater, _mm_cmpeq_epi32(G, F)));
+        __m128i eOverF = _mm_cmpgt_epi32(E, F);
+        __m128i eOverG = _mm_or_si128(_mm_cmpgt_epi32(E, G),
+                          _mm_and_si128(vlater, _mm_cmpeq_epi32(E, G)));
+        __m128i takeE = _mm_blendv_epi8(eOverG, eOverF, isF);
+
+        __m128i V = _mm_blendv_epi8(_mm_blendv_epi8(G, F, isF), E, takeE);
+        T = _mm_or_si128(T, _mm_and_si128(takeE, ve));
+        T = _mm_or_si128(T, _mm_andnot_si128(_mm_or_si128(takeE, isF), vd));
+
+        _mm_storeu_si128((__m128i*)(v + i), sw? _mm_max_epi32(V, vzero): V);
+        _mm_storeu_si128((__m128i*)(trc + i), T);
+    }
+
+    s_Pass3Scalar(g, f, e, v, trc, i, n, later, sw);
+}
+
+
+///////////////////////////////////////////////////////////////////////////
+// AVX2 kernel, eight cells per vector
+
+__attribute__((target("avx2")))
+static void s_Pass1AVX2(const TScore* vdiag, const TScore* vup,
+                        const TScore* prof, TScore* f, TScore* g,
+                        TScore* vp, Uint4* trc, size_t n,
+                        TScore wg, TScore ws, bool sw)
+{
+    const __m256i vwg = _mm256_set1_epi32(wg);
+    const __m256i vws = _mm256_set1_epi32(ws);
+    const __m256i vfc = _mm256_set1_epi32(SNWRowKernel::fMaskFc);
+    const __m256i vzero = _mm256_setzero_si256();
+
+    size_t i = 0;
+    for(; i + 8 <= n; i += 8) {
+        __m256i G = _mm256_add_epi32(
+                        _mm256_loadu_si256((const __m256i*)(vdiag + i)),
+                        _mm256_loadu_si256((const __m256i*)(prof + i)));
+        __m256i n0 = _mm256_add_epi32(
+                        _mm256_loadu_si256((const __m256i*)(vup + i)), vwg);
+        __m256i F = _mm256_loadu_si256((const __m256i*)(f + i));
+        __m256i ext = _mm256_andnot_si256(_mm256_cmpgt_epi32(n0, F), vfc);
+        F = _mm256_add_epi32(_mm256_max_epi32(F, n0), vws);
+        _mm256_storeu_si256((__m256i*)(g + i), G);
+        _mm256_storeu_si256((__m256i*)(f + i), F);
+        _mm256_storeu_si256((__m256i*)(trc + i), ext);
+        __m256i V = _mm256_max_epi32(G, F);
+        _mm256_storeu_si256((__m256i*)(vp + i),
+                            sw? _mm256_max_epi32(V, vzero): V);
+    }
+
+    s_Pass1Scalar(vdiag, vup, prof, f, g, vp, trc, i, n, wg, ws, sw);
+}
+
+
+__attribute__((target("avx2")))
+static void s_Pass3AVX2(const TScore* g, const TScore* f, const TScore* e,
+                        TScore* v, Uint4* trc, size_t n, bool later, bool sw)
+{
+    const __m256i vlater = _mm256_set1_epi32(later? -1: 0);
+    const __m256i ve = _mm256_set1_epi32(SNWRowKernel::fMaskE);
+    const __m256i vd = _mm256_set1_epi32(SNWRowKernel::fMaskD);
+    const __m256i vzero = _mm256_setzero_si256();
+
+    size_t i = 0;
+    for(; i + 8 <= n; i += 8) {
+        __m256i G = _mm256_loadu_si256((const __m256i*)(g + i));
+        __m256i F = _mm256_loadu_si256((const __m256i*)(f + i));
+        __m256i E = _mm256_loadu_si256((const __m256i*)(e + i));
+        __m256i T = _mm256_loadu_si256((const __m256i*)(trc + i));
+
+        __m256i isF = _mm256_or_si256(_mm256_cmpgt_epi32(F, G),
+                        _mm256_and_si256(vlater, _mm256_cmpeq_epi32(G, F)));
+        __m256i eOverF = _mm256_cmpgt_epi32(E, F);
+        __m256i eOverG = _mm256_or_si256(_mm256_cmpgt_epi32(E, G),
+                        _mm256_and_si256(vlater, _mm256_cmpeq_epi32(E, G)));
+        __m256i takeE = _mm256_blendv_epi8(eOverG, eOverF, isF);
+
+        __m256i V = _mm256_blendv_epi8(_mm256_blendv_epi8(G, F, isF),
+                                       E, takeE);
+        T = _mm256_or_si256(T, _mm256_and_si256(takeE, ve));
+        T = _mm256_or_si256(T,
+                _mm256_andnot_si256(_mm256_or_si256(takeE, isF), vd));
+
+        _mm256_storeu_si256((__m256i*)(v + i),
+                            sw? _mm256_max_epi32(V, vzero): V);
+        _mm256_storeu_si256((__m256i*)(trc + i), T);
+    }
+
+    s_Pass3Scalar(g, f, e, v, trc, i, n, later, sw);
+}
+
+
+static const SNWRowKernel s_KernelSSE41 = {
+    s_Pass1SSE41, s_Pass3SSE41, "sse4.1"
+};
+
+static const SNWRowKernel s_KernelAVX2 = {
+    s_Pass1AVX2, s_Pass3AVX2, "avx2"
+};
+
+
+static const SNWRowKernel* s_GetSupportedKernel(ENWRowKernel kernel)
+{
+    __builtin_cpu_init();
+    switch(kernel) {
+    case eNWRowKernel_AVX2:
+        return __builtin_cpu_supports("avx2")? &s_KernelAVX2: 0;
+    case eNWRowKernel_SSE41:
+        return __builtin_cpu_supports("sse4.1")? &s_KernelSSE41: 0;
+    default:
+        return 0;
+    }
+}
+
+
+static const SNWRowKernel* s_SelectRowKernel(void)
+{
+    const char* env = getenv("NCBI_NW_SIMD");
+    if(env  &&  env[0] == '0') {
+        return 0;
+    }
+
+    const SNWRowKernel* kernel = s_GetSupportedKernel(eNWRowKernel_AVX2);
+    return kernel? kernel: s_GetSupportedKernel(eNWRowKernel_SSE41);
+}
+
+#endif // NW_HAVE_SIMD
+
+
+// Kernel requested with NW_SelectRowKernel()
+static atomic<int> s_RowKernelChoice (eNWRowKernel_Auto);
+
+
+const SNWRowKernel* NW_GetRowKernel(void)
+{
+#ifdef NW_HAVE_SIMD
+    const int choice = s_RowKernelChoice.load(memory_order_relaxed);
+    if(choice != eNWRowKernel_Auto) {
+        return s_GetSupportedKernel(ENWRowKernel(choice));
+    }
+
+    // function-local static initialization is thread-safe
+    static const SNWRowKernel* const s_Kernel = s_SelectRowKernel();
+    return s_Kernel;
+#else
+    return 0;
+#endif
+}
+
+
+bool NW_SelectRowKernel(ENWRowKernel kernel)
+{
+    if(kernel != eNWRowKernel_Auto  &&  kernel != eNWRowKernel_Scalar) {
+#ifdef NW_HAVE_SIMD
+        if(s_GetSupportedKernel(kernel) == 0) {
+            return false;
+        }
+#else
+        return false;
+#endif
+    }
+    s_RowKernelChoice.store(kernel, memory_order_relaxed);
+    return true;
+}
+
+
+END_NCBI_SCOPE
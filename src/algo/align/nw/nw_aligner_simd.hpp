@@ -0,0 +1,184 @@
+#ifndef ALGO___NW_ALIGNER_SIMD__HPP
+#define ALGO___NW_ALIGNER_SIMD__HPP
+
+/* $Id: nw_aligner_simd.hpp $
+* ===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE                          
+*               National Center for Biotechnology Information
+*                                                                          
+*  This software/database is a "United States Government Work" under the   
+*  terms of the United States Copyright Act.  It was written as part of    
+*  the author's official duties as a United States Government employee and 
+*  thus cannot be copyrighted.  This software/database is freely available 
+*  to the public for use. The National Library of Medicine and the U.S.    
+*  Government have not placed any restriction on its use or reproduction.  
+*                                                                          
+*  Although all reasonable efforts have been taken to ensure the accuracy  
+*  and reliability of the software and data, the NLM and the U.S.          
+*  Government do not and cannot warrant the performance or results that    
+*  may be obtained by using this software or data. The NLM and the U.S.    
+*  Government disclaim all warranties, express or implied, including       
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.                                                                
+*                                                                          
+*  Please cite the author in any work or product based on this material.   
+*
+* ===========================================================================
+*
+* Author:  Yuri Kapustin
+*
+* File Description:  Vectorized row kernels for CNWAligner
+*
+*/
+
+#include <algo/align/nw/nw_aligner.hpp>
+
+BEGIN_NCBI_SCOPE
+
+
+// Vectorized parts of one row of the CNWAligner dynamic programming.
+//
+// A row is computed in three passes. The first one is vectorized and
+// computes the diagonal (G) and vertical gap (F) scores for the whole row,
+// since they depend on the previous row only. The second one is a short 
+// scalar scan computing the horizontal gap (E) scores, which depend on the
+// left neighbor. The third one is vectorized again and picks the best of 
+// G, E and F for every cell with exactly the same tie breaking as the 
+// scalar code, producing the same backtrace bits.
+//
+// Arrays are indexed by the cell position in the row, not counting
+// the first column.
+struct SNWRowKernel
+{
+    // Backtrace bits, same as in CNWAligner::x_Align()
+    enum {
+        fMaskFc = 0x01,
+        fMaskEc = 0x02,
+        fMaskE  = 0x04,
+        fMaskD  = 0x08
+    };
+
+    // Pass 1.
+    // vdiag[i], vup[i]: scores of the diagonal and upper neighbors
+    // prof[i]: substitution score of the cell
+    // f[i]: vertical gap score of the upper neighbor on input,
+    //       of the cell on output
+    // g[i]: diagonal score; vp[i]: max(g[i], f[i]) (and 0 if sw)
+    // trc[i]: fMaskFc if the vertical gap is extended, 0 otherwise
+    void (*m_Pass1)(const CNWAligner::TScore* vdiag,
+                    const CNWAligner::TScore* vup,
+                    const CNWAligner::TScore* prof,
+                    CNWAligner::TScore* f,
+                    CNWAligner::TScore* g,
+                    CNWAligner::TScore* vp,
+                    Uint4* trc, size_t n,
+                    CNWAligner::TScore wg, CNWAligner::TScore ws, bool sw);
+
+    // Pass 3.
+    // g[i], f[i], e[i]: diagonal, vertical and horizontal gap scores
+    // v[i]: the resulting cell score
+    // trc[i]: backtrace bits, updated with fMaskE and fMaskD
+    void (*m_Pass3)(const CNWAligner::TScore* g,
+                    const CNWAligner::TScore* f,
+                    const CNWAligner::TScore* e,
+                    CNWAligner::TScore* v,
+                    Uint4* trc, size_t n, bool later, bool sw);
+
+    // Kernel name, for diagnostics
+    const char* m_Name;
+};
+
+
+// Return the row kernel to use, or NULL for the scalar code. Unless
+// NW_SelectRowKernel() says otherwise, this is the best kernel supported
+// by the CPU; setting NCBI_NW_SIMD=0 in the environment disables the
+// vectorized kernels.
+NCBI_XALGOALIGN_EXPORT
+const SNWRowKernel* NW_GetRowKernel(void);
+
+
+// Row kernels that can be requested with NW_SelectRowKernel()
+enum ENWRowKernel {
+    eNWRowKernel_Auto,    // best supported by the CPU, unless NCBI_NW_SIMD=0
+    eNWRowKernel_Scalar,  // no row kernel
+    eNWRowKernel_SSE41,
+    eNWRowKernel_AVX2
+};
+
+// Override the row kernel for all aligners started afterwards; meant for
+// tests and benchmarks comparing the kernels with the scalar code.
+// Return false, leaving the selection unchanged, if the kernel is not
+// supported by the build or the CPU.
+NCBI_XALGOALIGN_EXPORT
+bool NW_SelectRowKernel(ENWRowKernel kernel);
+
+
+// Substitution scores of the residues of the first sequence against
+// the second sequence, one row per distinct residue
+class CNWRowProfile
+{
+public:
+    typedef CNWAligner::TScore TScore;
+
+    CNWRowProfile(const TNCBIScore (*sm) [NCBI_FSM_DIM],
+                  const char* seq2, size_t len2)
+        : m_Sm(sm), m_Seq2(seq2), m_Len2(len2), m_Index(256, -1)
+    {}
+
+    const TScore* GetRow(unsigned char c)
+    {
+        int& idx = m_Index[c];
+        if(idx < 0) {
+            idx = int(m_Rows.size() / m_Len2);
+            const TNCBIScore* row_sc = m_Sm[c];
+            for(size_t j = 0; j < m_Len2; ++j) {
+                m_Rows.push_back(row_sc[(unsigned char)m_Seq2[j]]);
+            }
+        }
+        return &m_Rows[idx * m_Len2];
+    }
+
+private:
+    const TNCBIScore (*m_Sm) [NCBI_FSM_DIM];
+    const char*    m_Seq2;
+    size_t         m_Len2;
+    vector<int>    m_Index;
+    vector<TScore> m_Rows;
+};
+
+
+// Run the first pass of a row. rowV and rowF are the full rows of the
+// aligner including the first column. When free_right is set, the last
+// column has no vertical gap penalties.
+inline void NW_RowPass1(const SNWRowKernel* kernel, CNWAligner::TScore* rowV,
+                        CNWAligner::TScore* rowF,
+                        const CNWAligner::TScore* prof,
+                        CNWAligner::TScore* g, CNWAligner::TScore* vp,
+                        Uint4* trc, size_t n,
+                        CNWAligner::TScore wg, CNWAligner::TScore ws,
+                        bool free_right, bool sw)
+{
+    const CNWAligner::TScore Flast (rowF[n]);
+    kernel->m_Pass1(rowV, rowV + 1, prof, rowF + 1, g, vp, trc, n, wg, ws, sw);
+
+    if(free_right) {
+        const CNWAligner::TScore n0 (rowV[n]);
+        CNWAligner::TScore& F (rowF[n]);
+        if(Flast >= n0) {
+            F = Flast;
+            trc[n - 1] = SNWRowKernel::fMaskFc;
+        }
+        else {
+            F = n0;
+            trc[n - 1] = 0;
+        }
+        const CNWAligner::TScore v (max(g[n - 1], F));
+        vp[n - 1] = sw && v < 0? 0: v;
+    }
+}
+
+
+END_NCBI_SCOPE
+
+#endif
@@ -33,6 +33,7 @@
 
 #include <ncbi_pch.hpp>
 #include "messages.hpp"
+#include "nw_aligner_simd.hpp"
 #include <algo/align/nw/nw_spliced_aligner16.hpp>
 #include <algo/align/nw/align_exception.hpp>
 
@@ -281,6 +282,23 @@ CNWAligner::TScore CSplicedAligner16::x_Align (SAlignInOut* data)
         cds_stop -= data->m_offset1;
     }
 
+    // With a vectorized kernel, only the diagonal (G) and vertical gap (F)
+    // scores of each row are computed up front. The horizontal gap, splice
+    // signals and donor/acceptor bookkeeping depend on the cell to the left
+    // and stay scalar; they are most of the work per cell, so expect a
+    // modest gain at best.
+    const SNWRowKernel * kernel (N2 > 1? NW_GetRowKernel(): 0);
+    CNWRowProfile prof (sm, seq2 + 1, kernel? N2 - 1: 0);
+    vector<TScore> stl_G, stl_Vp;
+    vector<Uint4> stl_trc;
+    if(kernel) {
+        stl_G.resize(N2 - 1);
+        stl_Vp.resize(N2 - 1);
+        stl_trc.resize(N2 - 1);
+    }
+    const TScore * NCBI_RESTRICT pG (kernel? &stl_G.front() - 1: 0);
+    const Uint4 * NCBI_RESTRICT pTrc (kernel? &stl_trc.front() - 1: 0);
+
     for(size_t i (0), j(0); i < N1;  ++i, j = 0) {
        
         V = i > 0? (V0 += wsleft2) : 0;
@@ -334,10 +352,20 @@ NWSPL_DETECTDONOR(2)
             wg1 = ws1 = 0;
         }
 
+        if(kernel) {
+            NW_RowPass1(kernel, rowV, rowF, prof.GetRow(ci), &stl_G.front(),
+                        &stl_Vp.front(), &stl_trc.front(), N2 - 1, wg2, ws2,
+                        bFreeGapRight2, false);
+        }
+
         for (j = 1; j < N2; ++j, ++k) {
-            			
 
-            G = pV[j] + sm[ci][(unsigned char)seq2[j]];
+            if(kernel) {
+                G = pG[j];
+            }
+            else {
+                G = pV[j] + sm[ci][(unsigned char)seq2[j]];
+            }
             pV[j] = V;
 
             n0 = V + wg1;
@@ -351,17 +379,23 @@ NWSPL_DETECTDONOR(2)
                 tracer = 0;
             }
 
-            if(j == N2 - 1 && bFreeGapRight2) {
-                wg2 = ws2 = 0;
-            }
-
-            n0 = rowV[j] + wg2;
-            if(rowF[j] >= n0) {
-                rowF[j] += ws2;
-                tracer |= kMaskFc;
+            if(kernel) {
+                tracer |= pTrc[j];
             }
             else {
-                rowF[j] = n0 + ws2;
+
+                if(j == N2 - 1 && bFreeGapRight2) {
+                    wg2 = ws2 = 0;
+                }
+
+                n0 = rowV[j] + wg2;
+                if(rowF[j] >= n0) {
+                    rowF[j] += ws2;
+                    tracer |= kMaskFc;
+                }
+                else {
+                    rowF[j] = n0 + ws2;
+                }
             }
 
             // evaluate the score (V)
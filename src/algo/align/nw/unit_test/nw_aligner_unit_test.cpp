@@ -0,0 +1,217 @@
+/*  $Id: nw_aligner_unit_test.cpp $
+* ===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+* File Description:
+*   Unit tests for CNWAligner: the vectorized row kernels must produce
+*   the same scores and transcripts as the scalar code.
+*
+* ===========================================================================
+*/
+
+#include <ncbi_pch.hpp>
+
+#include <corelib/test_boost.hpp>
+#include <corelib/random.hpp>
+#include <algo/align/nw/nw_aligner.hpp>
+#include <util/tables/raw_scoremat.h>
+
+#include "../nw_aligner_simd.hpp"
+
+#include <common/test_assert.h>  /* This header must go last */
+
+USING_NCBI_SCOPE;
+
+
+// Restores the automatic kernel selection when a test case is done
+struct CRowKernelGuard
+{
+    ~CRowKernelGuard() { NW_SelectRowKernel(eNWRowKernel_Auto); }
+};
+
+
+// Random sequence over the given alphabet
+static string s_RandomSeq(CRandom& rng, const string& alphabet, size_t len)
+{
+    string seq (len, alphabet[0]);
+    for(size_t i = 0; i < len; ++i) {
+        seq[i] = alphabet[rng.GetRand(0, Uint4(alphabet.size() - 1))];
+    }
+    return seq;
+}
+
+
+// A copy of the sequence with substitutions, insertions and deletions,
+// so that the pairs have real alignments with gaps in both sequences
+static string s_Mutate(CRandom& rng, const string& alphabet,
+                       const string& seq)
+{
+    string rv;
+    for(size_t i = 0; i < seq.size(); ++i) {
+        switch(rng.GetRand(0, 19)) {
+        case 0:
+            rv += alphabet[rng.GetRand(0, Uint4(alphabet.size() - 1))];
+            break;
+        case 1:
+            rv += s_RandomSeq(rng, alphabet, rng.GetRand(1, 6));
+            rv += seq[i];
+            break;
+        case 2:
+            i += rng.GetRand(0, 5);
+            break;
+        default:
+            rv += seq[i];
+        }
+    }
+    return rv.empty()? seq: rv;
+}
+
+
+struct SAlignResult
+{
+    CNWAligner::TScore m_Score;
+    string             m_Transcript;
+};
+
+
+static SAlignResult s_Align(const string& seq1, const string& seq2,
+                            const SNCBIPackedScoreMatrix* scoremat,
+                            unsigned esf, bool later, bool sw)
+{
+    CNWAligner aligner (seq1, seq2, scoremat);
+    if(sw) {
+        aligner.SetSmithWaterman(true);
+    }
+    else {
+        aligner.SetEndSpaceFree(esf & 1, esf & 2, esf & 4, esf & 8);
+    }
+    aligner.SetGapPreference(later? CNWAligner::eLater: CNWAligner::eEarlier);
+
+    SAlignResult rv;
+    rv.m_Score = aligner.Run();
+    rv.m_Transcript = aligner.GetTranscriptString();
+    return rv;
+}
+
+
+// Align random pairs with every combination of end gap and gap preference
+// settings, plus Smith-Waterman, once with the scalar code and once with
+// each row kernel the CPU supports, and compare the results
+static void s_CompareKernels(const string& alphabet,
+                             const SNCBIPackedScoreMatrix* scoremat)
+{
+    static const ENWRowKernel kKernels[] = {
+        eNWRowKernel_SSE41, eNWRowKernel_AVX2
+    };
+    const size_t kNumPairs = 40;
+
+    CRowKernelGuard guard;
+    CRandom rng (17);
+    size_t num_kernels = 0;
+
+    for(size_t k = 0; k < sizeof(kKernels) / sizeof(kKernels[0]); ++k) {
+        if( !NW_SelectRowKernel(kKernels[k]) ) {
+            BOOST_TEST_MESSAGE("Row kernel " << int(kKernels[k])
+                               << " is not supported, skipped");
+            continue;
+        }
+        ++num_kernels;
+    }
+    if(num_kernels == 0) {
+        BOOST_TEST_MESSAGE("No row kernel supported, nothing to compare");
+        return;
+    }
+
+    for(size_t pair = 0; pair < kNumPairs; ++pair) {
+
+        // lengths straddle the vector widths, including one-residue rows
+        const size_t len = pair < 8? pair + 1: rng.GetRand(9, 400);
+        const string seq1 (s_RandomSeq(rng, alphabet, len));
+        const string seq2 (pair % 3 == 0?
+                           s_RandomSeq(rng, alphabet, rng.GetRand(1, 400)):
+                           s_Mutate(rng, alphabet, seq1));
+
+        for(unsigned esf = 0; esf < 17; ++esf) {
+            const bool sw = esf == 16;
+            for(int later = 0; later < 2; ++later) {
+
+                BOOST_REQUIRE(NW_SelectRowKernel(eNWRowKernel_Scalar));
+                const SAlignResult expected (s_Align(seq1, seq2, scoremat,
+                                                     esf, later, sw));
+
+                for(size_t k = 0;
+                    k < sizeof(kKernels) / sizeof(kKernels[0]); ++k) {
+                    if( !NW_SelectRowKernel(kKernels[k]) ) {
+                        continue;
+                    }
+                    const SAlignResult actual (s_Align(seq1, seq2, scoremat,
+                                                       esf, later, sw));
+                    BOOST_CHECK_MESSAGE(
+                        actual.m_Score == expected.m_Score  &&
+                        actual.m_Transcript == expected.m_Transcript,
+                        "kernel " << int(kKernels[k]) << ", pair " << pair
+                        << ", end space free " << esf << ", later " << later
+                        << ": score " << actual.m_Score << " vs "
+                        << expected.m_Score << ", transcript "
+                        << actual.m_Transcript << " vs "
+                        << expected.m_Transcript);
+                }
+            }
+        }
+    }
+}
+
+
+BOOST_AUTO_TEST_SUITE(nw_aligner)
+
+BOOST_AUTO_TEST_CASE(RowKernelSelection)
+{
+    CRowKernelGuard guard;
+
+    BOOST_REQUIRE(NW_SelectRowKernel(eNWRowKernel_Scalar));
+    BOOST_CHECK(NW_GetRowKernel() == 0);
+
+    if(NW_SelectRowKernel(eNWRowKernel_SSE41)) {
+        BOOST_REQUIRE(NW_GetRowKernel() != 0);
+        BOOST_CHECK_EQUAL(string(NW_GetRowKernel()->m_Name), "sse4.1");
+    }
+    if(NW_SelectRowKernel(eNWRowKernel_AVX2)) {
+        BOOST_REQUIRE(NW_GetRowKernel() != 0);
+        BOOST_CHECK_EQUAL(string(NW_GetRowKernel()->m_Name), "avx2");
+    }
+
+    BOOST_REQUIRE(NW_SelectRowKernel(eNWRowKernel_Auto));
+}
+
+BOOST_AUTO_TEST_CASE(RowKernelsMatchScalarNucleotide)
+{
+    s_CompareKernels("ACGT", 0);
+}
+
+BOOST_AUTO_TEST_CASE(RowKernelsMatchScalarProtein)
+{
+    s_CompareKernels("ARNDCQEGHILKMFPSTWYV", &NCBISM_Blosum62);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
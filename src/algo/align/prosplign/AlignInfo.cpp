@@ -129,6 +129,17 @@ void CFindGapIntronRow::ClearIIC(void)
     }
 }
 
+void CFindGapIntronRow::ClearIIC(int from, int to)
+{
+    for(int j = from; j <= to; ++j) {
+        wis[j].Clear();
+        vis[j].Clear();
+        h1is[j].Clear();
+        h2is[j].Clear();
+        h3is[j].Clear();
+    }
+}
+
 CAlignRow::CAlignRow(int length, const CProSplignScaledScoring& scoring) {
         m_w.resize(length + scoring.lmin + 4, infinity);
         w = &m_w[0] + scoring.lmin + 4;
@@ -142,5 +153,12 @@ CAlignRow::CAlignRow(int length, const CProSplignScaledScoring& scoring) {
         h3 = &m_h3[0] + scoring.lmin + 1;
 }
 
+void CAlignRow::ClearScores(int from, int to)
+{
+    for(int j = from; j <= to; ++j) {
+        w[j] = v[j] = h1[j] = h2[j] = h3[j] = infinity;
+    }
+}
+
 END_SCOPE(prosplign)
 END_NCBI_SCOPE
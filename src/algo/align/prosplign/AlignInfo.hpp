@@ -75,6 +75,8 @@ class CAlignRow
 {
 public:
     CAlignRow(int length, const CProSplignScaledScoring& scoring);
+    //sets the scores of columns [from, to] back to infinity
+    void ClearScores(int from, int to);
     vector<int> m_w, m_v, m_h1, m_h2, m_h3;
     int *w, *v, *h1, *h2, *h3;
 private:
@@ -89,6 +91,8 @@ public:
     ~CFindGapIntronRow();
     size_t size() const { return m_length; }
     void ClearIIC(void);
+    //clears chains of columns [from, to] only
+    void ClearIIC(int from, int to);
 public:
     CIgapIntronChain *wis, *vis, *h1is, *h2is, *h3is;
 private:
@@ -36,6 +36,8 @@
 
 #include <corelib/ncbi_limits.hpp>
 
+#include <math.h>
+
 BEGIN_NCBI_SCOPE
 BEGIN_SCOPE(prosplign)
 
@@ -78,6 +80,47 @@ public:
 
 typedef CTBackAlignInfo<char> CBackAlignInfo;
 
+//back tracking that keeps DP scores of every 'step'-th row only.
+//Back tracking rows are recomputed a block at a time during back alignment,
+//the memory used is jlen*(ilen/step*2*sizeof(int) + step*sizeof(T))
+//instead of ilen*jlen*sizeof(T). Costs one extra DP pass.
+//jlen is a common factor, so the step minimizing the memory,
+//sqrt(ilen*2*sizeof(int)/sizeof(T)), does not depend on it.
+template<class T>
+class CTCheckpointBackAlignInfo
+{
+public:
+    int ilen; //sequence1 length = number of back tracking rows
+    int jlen; //sequence2 length = number of back tracking columns
+    int maxi, maxj; //indexes to start back alignment from
+    int step; //number of rows in a block
+    vector<vector<int> > w, v; //saved DP rows 0, step, 2*step, ...
+    MATR<T> block; //back tracking rows of the current block
+    int block_beg; //first row in block, -1 if none
+
+    void Init(int oilen, int ojlen)
+    {
+        ilen = oilen;
+        jlen = ojlen;
+        step = (int)ceil(sqrt(ilen*2.*sizeof(int)/sizeof(T)));
+        step = max(1, min(step, ilen));
+        w.clear();
+        v.clear();
+        w.resize((ilen + step - 1)/step);
+        v.resize(w.size());
+        block.Init(step, jlen);
+        block_beg = -1;
+    }
+
+    //bytes used by the saved rows and the block, after Init
+    double GetMemory() const
+    {
+        return (double)jlen*(w.size()*2*sizeof(int) + step*sizeof(T));
+    }
+};
+
+typedef CTCheckpointBackAlignInfo<char> CFrCheckpointBackAlignInfo;
+
 END_SCOPE(prosplign)
 END_NCBI_SCOPE
 
@@ -257,7 +257,88 @@ int   FrAlign(const CProSplignInterrupt& interrupt, CBackAlignInfo& bi, const PS
   return wmax;
 }
 
-int FindFGapIntronNog(const CProSplignInterrupt& interrupt, vector<pair<int, int> >& igi/*to return end gap/intron set*/, const PSEQ& pseq, const CNSeq& nseq, bool& left_gap, bool& right_gap, const CProSplignScaledScoring& scoring, const CSubstMatrix& matrix)
+//band around compartment hits
+namespace {
+//adds columns [from, to] to rows [ifrom, ito]
+void s_AddToBand(vector<int>& band_from, vector<int>& band_to, int ifrom, int ito, int from, int to)
+{
+    int ilast = (int)band_from.size() - 1;
+    for(int i = max(ifrom, 1); i <= min(ito, ilast); ++i) {
+        band_from[i] = min(band_from[i], from);
+        band_to[i] = max(band_to[i], to);
+    }
+}
+
+struct SHitLess {
+    bool operator()(const CHitBand::SHit& a, const CHitBand::SHit& b) const {
+        return a.pfrom < b.pfrom || (a.pfrom == b.pfrom && a.nfrom < b.nfrom);
+    }
+};
+}
+
+void CHitBand::Init(const THits& hits, int width, int plen, int nlen)
+{
+    m_from.clear();
+    m_to.clear();
+    THits h;
+    ITERATE(THits, it, hits) {
+        if(it->pfrom <= it->pto && it->nfrom <= it->nto && it->pfrom < plen && it->nfrom < nlen) {
+            h.push_back(*it);
+        }
+    }
+    if(width <= 0 || h.empty()) return;
+    sort(h.begin(), h.end(), SHitLess());
+
+    m_from.resize(plen + 1, nlen + 1);
+    m_to.resize(plen + 1, -1);
+    const int nw = 3*width;
+    //residues before the first hit and after the last one can be anywhere outside
+    s_AddToBand(m_from, m_to, 1, h.front().pfrom + 1 + width, 0, h.front().nfrom + 3 + nw);
+    s_AddToBand(m_from, m_to, h.back().pto + 1 - width, plen, h.back().nto + 1 - nw, nlen);
+    for(size_t k = 0; k < h.size(); ++k) {
+        const SHit& hit = h[k];
+        //along the hit, row i ends the codon of residue i-1;
+        //gapped hits are followed from one end to the other
+        for(int i = max(hit.pfrom + 1 - width, 1); i <= min(hit.pto + 1 + width, plen); ++i) {
+            int j;
+            if(i <= hit.pfrom) {
+                j = hit.nfrom - 3*(hit.pfrom - i);
+            } else if(i > hit.pto + 1) {
+                j = hit.nto + 1 + 3*(i - hit.pto - 1);
+            } else {
+                j = hit.nfrom + (int)((Int8)(i - hit.pfrom)*(hit.nto + 1 - hit.nfrom)/(hit.pto + 1 - hit.pfrom));
+            }
+            s_AddToBand(m_from, m_to, i, i, j - nw, j + nw);
+        }
+        //between this hit and the next one, room for introns
+        if(k + 1 < h.size()) {
+            const SHit& next = h[k + 1];
+            int end = hit.nto + 1, start = next.nfrom + 3;
+            s_AddToBand(m_from, m_to, min(hit.pto, next.pfrom) + 1 - width, max(hit.pto, next.pfrom) + 1 + width,
+                min(end, start) - nw, max(end, start) + nw);
+        }
+    }
+    for(int i = 1; i <= plen; ++i) {
+        m_from[i] = max(m_from[i], 0);
+        m_to[i] = min(m_to[i], nlen);
+        if(m_from[i] > m_to[i]) {
+            m_from[i] = 0;
+            m_to[i] = nlen;
+        }
+    }
+}
+
+double CHitBand::GetArea(void) const
+{
+    double area = 0;
+    for(size_t i = 1; i < m_from.size(); ++i) {
+        area += m_to[i] - m_from[i] + 1;
+    }
+    return area;
+}
+
+int FindFGapIntronNog(const CProSplignInterrupt& interrupt, vector<pair<int, int> >& igi/*to return end gap/intron set*/, const PSEQ& pseq, const CNSeq& nseq, bool& left_gap, bool& right_gap, const CProSplignScaledScoring& scoring, const CSubstMatrix& matrix,
+                      const CHitBand* band)
 {
 	CIgapIntronPool pool;
 
@@ -308,8 +389,24 @@ int FindFGapIntronNog(const CProSplignInterrupt& interrupt, vector<pair<int, int
 
     // *******  MAIN LOOP ******************
     int jlen_1 = jlen - 1;
+    //with a band, each row is computed in columns [jfrom, jto] only;
+    //the other cells of a row are kept at infinity, so the columns last
+    //written in each row are cleared before the row is reused
+    const bool banded = band && !band->Empty();
+    int cfrom = 1, cto = jlen_1;//written in crow
+    int pfrom = jlen, pto = jlen_1;//written in prow, nothing yet
     for(i=1;i<ilen;++i) {
         swap(crow, prow);
+        swap(cfrom, pfrom);
+        swap(cto, pto);
+        int jfrom = 3, jto = jlen_1;
+        if(banded) {
+            jfrom = max(band->From(i), 3);
+            jto = band->To(i);
+            crow->ClearScores(max(cfrom, 3), cto);
+            cfrom = jfrom;
+            cto = jto;
+        }
         crow->w[0] = 0;
         crow->w[1] = 0;
         crow->w[2] = 0;
@@ -321,20 +418,22 @@ int FindFGapIntronNog(const CProSplignInterrupt& interrupt, vector<pair<int, int
         int h2 = infinity;
         int h3 = infinity;
        //extra init for intron scoring
-        fin.InitRowScores(crow, prow->m_w, 3);
+        fin.InitRowScores(crow, prow->m_w, jfrom);
         fiscore.SetAmin(pseq[i-1], matrix);
+        fiscore.Skip(jfrom - 3);
        // pointers
-        cv = &crow->v[2];
-        ch1 = &crow->h1[2];
-        ch2 = &crow->h2[2];
-        ch3 = &crow->h3[2];
-        cw = &crow->w[2];
-        pw3 =  &prow->w[0];
-        pw1 =  &prow->w[2];
-        pv1 =  &prow->v[2];
-        pv =  &prow->v[0];
+        cv = &crow->v[jfrom-1];
+        ch1 = &crow->h1[jfrom-1];
+        ch2 = &crow->h2[jfrom-1];
+        ch3 = &crow->h3[jfrom-1];
+        cw = &crow->w[jfrom-1];
+        pw3 =  &prow->w[jfrom-3];
+        pw1 =  &prow->w[jfrom-1];
+        pv1 =  &prow->v[jfrom-1];
+        pv =  &prow->v[jfrom-3];
+        int jend = min(jto + 1, jlen_1);
         // *******  INTERNAL LOOP ******************
-    	for(j=3;j<jlen_1;++j) {
+    	for(j=jfrom;j<jend;++j) {
             interrupt.CheckUserInterrupt();
             const CBestI& bei = fin.Step(j, scoring, fiscore);
             //rest
@@ -413,7 +512,7 @@ int FindFGapIntronNog(const CProSplignInterrupt& interrupt, vector<pair<int, int
             *++cw = w0;
         }
         //the last column !
-        if(2 < jlen_1) { //j == jlen_1 
+        if(2 < jlen_1 && jto == jlen_1) { //j == jlen_1 
             const CBestI bei = fin.Step(j, scoring, fiscore);
             //rest
             int w1 = *pw3 + fiscore.GetScore();
@@ -468,7 +567,11 @@ int FindFGapIntronNog(const CProSplignInterrupt& interrupt, vector<pair<int, int
             }
             crow->w[j] = w0;
         }
-        prow->ClearIIC();
+        if(banded) {
+            prow->ClearIIC(pfrom, pto);
+        } else {
+            prow->ClearIIC();
+        }
         //remember the best W in the last column
         if(wmax <= crow->w[jlen - 1]) {
             wmax = crow->w[jlen - 1];
@@ -681,18 +784,20 @@ int FindIGapIntrons(const CProSplignInterrupt& interrupt, vector<pair<int, int>
   return wmax;
 }
 
-void FrBackAlign(CBackAlignInfo& bi, CAli& ali) {
+template<class TRows>
+void s_FrBackAlign(TRows& rows, int ilen, int jlen, int maxi, int maxj, CAli& ali)
+{
   CAliCreator alic(ali);
   int i, j;
-  for(i = bi.ilen-1; i>bi.maxi; --i) {
+  for(i = ilen-1; i>maxi; --i) {
         alic.Add(eVP, 3);
   }
-  for(j = bi.jlen-1; j>bi.maxj; --j) {
+  for(j = jlen-1; j>maxj; --j) {
         alic.Add(eHP, 1);
   }
   int curGAPmode = eD;
   while(i>=0 && j>=0) {
-	char b = bi.b[i][j];
+	char b = rows[i][j];
     char h1mode = b&64;
     char vmode = b&32;
     char hmode = b&16;
@@ -771,52 +876,164 @@ void FrBackAlign(CBackAlignInfo& bi, CAli& ali) {
 
 
 
-int   FrAlignFNog1(const CProSplignInterrupt& interrupt, CBackAlignInfo& bi, const PSEQ& pseq, const CNSeq& nseq,
-                   // int g/*gap opening*/, int e/*one nuc extension cost*/, int f/*frameshift opening cost*/,
-                   const CProSplignScaledScoring& scoring, const CSubstMatrix& matrix,
-                   bool left_gap, bool right_gap)
+//best W in the last column and in the last row
+class CAlignFNogMax
 {
-    int g/*gap opening*/ = scoring.GetGapOpeningCost();
-    int e/*one nuc extension cost*/ = scoring.GetGapExtensionCost();
-    int f/*frameshift opening cost*/ = scoring.GetFrameshiftOpeningCost();
- 
-  if(nseq.size() < 1) return 0;
-  int ilen = (int)pseq.size() + 1;
-  int jlen = nseq.size() + 1;
-  CFrAlignRow row1(jlen), row2(jlen);
-  CFrAlignRow *crow = &row1, *prow = &row2;
-  int i, j;
-  CFastIScore fiscore;
-  fiscore.Init(nseq, matrix);
-  //first row, i.e. i=0
-    for(j=0;j<jlen;j++) {
-      crow->w[j] = 0;
-      crow->v[j] = infinity; 
+public:
+    CAlignFNogMax(int jlen, bool right_gap = false) : wmax(0), imax(0), jmax(jlen - 1), m_jlen(jlen), m_right_gap(right_gap) {}
+    void AddRow(int i, const int *w) {
+        if(m_right_gap) {//regular score for the right v-gap
+            wmax = w[m_jlen - 1];
+            imax = i;
+            jmax = m_jlen - 1;
+        } else if(wmax <= w[m_jlen - 1]) {
+            wmax = w[m_jlen - 1];
+            imax = i;
+        }
     }
-    int wmax = 0;
-    int imax = 0;
-    int jmax = jlen - 1;
-    // ** prepare for main loop
+    void AddLastRow(int i, const int *w) {
+        for(int j=1;j<m_jlen;++j) {
+            if(wmax <= w[j]) {
+                wmax = w[j];
+                imax = i;
+                jmax = j;
+            }
+        }
+    }
+    int wmax, imax, jmax;
+private:
+    int m_jlen;
+    bool m_right_gap;
+};
+
+//forward pass for a checkpointed back tracking. Saves the DP row
+//each block starts from, back tracking rows are not kept
+template<class TRows, class T>
+int s_CheckpointAlign(TRows& rows, CAlignFNogMax& best, CTCheckpointBackAlignInfo<T>& bi)
+{
+  rows.InitFirstRow();
+  bi.block_beg = -1;
+  for(int i=1;i<=bi.ilen;++i) {
+      if((i - 1)%bi.step == 0) {//save the row the next block starts from
+          rows.GetRow(bi.w[(i - 1)/bi.step], bi.v[(i - 1)/bi.step]);
+      }
+      //block is used as a scratch row here, back alignment recomputes it
+      rows.NextRow(i, bi.block[0]);
+      best.AddRow(i, rows.GetW());
+  }
+  best.AddLastRow(bi.ilen, rows.GetW());
+  bi.maxi = best.imax - 1;//shift to back align coord
+  bi.maxj = best.jmax - 1;//shift to back align coord
+  return best.wmax;
+}
+
+//gives back tracking rows of CTCheckpointBackAlignInfo recomputing
+//one block of rows at a time. Back alignment goes from the last row
+//to the first one, so each block is computed once.
+template<class TRows, class T>
+class CCheckpointBackRows
+{
+public:
+    CCheckpointBackRows(CTCheckpointBackAlignInfo<T>& bi, TRows& rows) : m_bi(bi), m_rows(rows) {}
+
+    T *operator[](int i) {
+        if(m_bi.block_beg < 0 || i < m_bi.block_beg || i >= m_bi.block_beg + m_bi.step) {
+            int k = i/m_bi.step;
+            m_bi.block_beg = k*m_bi.step;
+            m_rows.SetRow(m_bi.w[k], m_bi.v[k]);
+            int iend = min(m_bi.block_beg + m_bi.step, m_bi.ilen);
+            for(int r = m_bi.block_beg; r < iend; ++r) {
+                m_rows.NextRow(r + 1, m_bi.block[r - m_bi.block_beg]);
+            }
+        }
+        return m_bi.block[i - m_bi.block_beg];
+    }
+private:
+    CTCheckpointBackAlignInfo<T>& m_bi;
+    TRows& m_rows;
+};
+
+//FrAlignFNog1 computed row by row, see CAlignFNogRows
+class CFrAlignFNog1Rows
+{
+public:
+    CFrAlignFNog1Rows(const CProSplignInterrupt& interrupt, const PSEQ& pseq, const CNSeq& nseq, const CProSplignScaledScoring& scoring, const CSubstMatrix& matrix, bool left_gap, bool right_gap);
+    //row 0
+    void InitFirstRow(void);
+    //makes previously saved row the last computed one
+    void SetRow(const vector<int>& w, const vector<int>& v);
+    void GetRow(vector<int>& w, vector<int>& v) const { w = m_crow->w; v = m_crow->v; }
+    //computes row i, b - back tracking row (i-1)
+    void NextRow(int i, char *b);
+    const int *GetW(void) const { return &m_crow->w[0]; }
+private:
+    const CProSplignInterrupt& m_interrupt;
+    const PSEQ& m_pseq;
+    const CNSeq& m_nseq;
+    const CSubstMatrix& m_matrix;
+    int m_jlen;
+    bool m_left_gap, m_right_gap;
+    CFrAlignRow m_row1, m_row2;
+    CFrAlignRow *m_crow, *m_prow;
+    CFastIScore m_fiscore;
+    int m_g, m_e, m_f;
     //penalties
-    int pev1 =  - g - 3*e;
-    int pev2 = - 3*e;
-    int pe2 =  - f - 2*e;
-    int pe3 =  - (f - g) - 2*e;
-    int pe4 =  - f - e;
-    int pe5 =  - (f - g) - e;
-    int pe6 = f - g - e;
+    int m_pev1, m_pev2, m_pe2, m_pe3, m_pe4, m_pe5, m_pe6;
+
+    CFrAlignFNog1Rows(const CFrAlignFNog1Rows&);
+    CFrAlignFNog1Rows& operator=(const CFrAlignFNog1Rows&);
+};
+
+CFrAlignFNog1Rows::CFrAlignFNog1Rows(const CProSplignInterrupt& interrupt, const PSEQ& pseq, const CNSeq& nseq, const CProSplignScaledScoring& scoring, const CSubstMatrix& matrix, bool left_gap, bool right_gap) :
+    m_interrupt(interrupt), m_pseq(pseq), m_nseq(nseq), m_matrix(matrix), m_jlen(nseq.size() + 1),
+    m_left_gap(left_gap), m_right_gap(right_gap),
+    m_row1(m_jlen), m_row2(m_jlen), m_crow(&m_row1), m_prow(&m_row2)
+{
+    m_fiscore.Init(nseq, matrix);
+    int g = m_g /*gap opening*/ = scoring.GetGapOpeningCost();
+    int e = m_e /*one nuc extension cost*/ = scoring.GetGapExtensionCost();
+    int f = m_f /*frameshift opening cost*/ = scoring.GetFrameshiftOpeningCost();
+    m_pev1 =  - g - 3*e;
+    m_pev2 = - 3*e;
+    m_pe2 =  - f - 2*e;
+    m_pe3 =  - (f - g) - 2*e;
+    m_pe4 =  - f - e;
+    m_pe5 =  - (f - g) - e;
+    m_pe6 = f - g - e;
+}
+
+void CFrAlignFNog1Rows::InitFirstRow(void)
+{
+    for(int j=0;j<m_jlen;j++) {
+      m_crow->w[j] = 0;
+      m_crow->v[j] = infinity; 
+    }
+}
+
+void CFrAlignFNog1Rows::SetRow(const vector<int>& w, const vector<int>& v)
+{
+    _ASSERT(w.size() == m_crow->w.size() && v.size() == m_crow->v.size());
+    copy(w.begin(), w.end(), m_crow->w.begin());
+    copy(v.begin(), v.end(), m_crow->v.begin());
+}
+
+void CFrAlignFNog1Rows::NextRow(int i, char *b)
+{
+    swap(m_crow, m_prow);
+    CFrAlignRow *crow = m_crow, *prow = m_prow;
+    CFastIScore& fiscore = m_fiscore;
+    int g = m_g, e = m_e, f = m_f;
+    int pev1 = m_pev1, pev2 = m_pev2, pe2 = m_pe2, pe3 = m_pe3, pe4 = m_pe4, pe5 = m_pe5, pe6 = m_pe6;
     char *pb, bb;
     int *cv, *cw, *pv, *pv1, *pw1, *pw3;
-  // *******  MAIN LOOP ******************
-  int jlen_1;
-  if(right_gap) {//penalty for end gap because there was a H-gap on the first stage
-    jlen_1 = jlen;
-  } else {
-    jlen_1 = jlen - 1;
-  }
-  for(i=1;i<ilen;++i) {
-    swap(crow, prow);
-    if(left_gap) {//penalty for end gap because there was a H-gap on the first stage
+    int j;
+    int jlen_1;
+    if(m_right_gap) {//penalty for end gap because there was a H-gap on the first stage
+      jlen_1 = m_jlen;
+    } else {
+      jlen_1 = m_jlen - 1;
+    }
+    if(m_left_gap) {//penalty for end gap because there was a H-gap on the first stage
         crow->w[0] = -g -3*e*i;
         crow->w[1] =  - f - (i*3 - 1)*e;
         crow->w[2] =   - f - (i*3 - 2)*e;
@@ -825,23 +1042,23 @@ int   FrAlignFNog1(const CProSplignInterrupt& interrupt, CBackAlignInfo& bi, con
         crow->w[1] = 0;
         crow->w[2] = 0;
     }
-    bi.b[i-1][0] = 3;
-    bi.b[i-1][1] = 5;
+    b[0] = 3;
+    b[1] = 5;
     /**/
     crow->v[1] = crow->v[2]  = infinity;
     int h1 = infinity;
     int h2 = infinity;
     int h3 = infinity;
-    pb = &bi.b[i-1][1];
+    pb = &b[1];
     cv = &crow->v[2];
     cw = &crow->w[2];
     pw3 =  &prow->w[0];
     pw1 =  &prow->w[2];
     pv1 =  &prow->v[2];
     pv =  &prow->v[0];
-    fiscore.SetAmin(pseq[i-1], matrix);
+    fiscore.SetAmin(m_pseq[i-1], m_matrix);
 	for(j=3;j<jlen_1;++j) {
-        interrupt.CheckUserInterrupt();
+        m_interrupt.CheckUserInterrupt();
         bb = 0;
         //rest
         int w1 = *pw3 + fiscore.GetScore();
@@ -880,11 +1097,11 @@ int   FrAlignFNog1(const CProSplignInterrupt& interrupt, CBackAlignInfo& bi, con
         *++pb = bb;
     }
     //the last column !
-    if(!right_gap) {//last column is different if we don't charge for end gap
+    if(!m_right_gap) {//last column is different if we don't charge for end gap
         if(2 < jlen_1) { //j == jlen_1 
             _ASSERT(j == jlen_1);
-            char& b = bi.b[i-1][j-1];
-            b = 0;
+            char& bl = b[j-1];
+            bl = 0;
             //v-gap is not needed
             //best h-gap
             int h12 = h3 + pe5;
@@ -893,89 +1110,151 @@ int   FrAlignFNog1(const CProSplignInterrupt& interrupt, CBackAlignInfo& bi, con
             h1 = crow->w[j-1] + pe4;
             if(h12 > h1) {
                 h1 = h12;
-                b |= 64;
+                bl |= 64;
             }
             //rest
-            int w1 = prow->w[j-3] + matrix.MultScore(nseq[j-3], nseq[j-2], nseq[j-1], pseq[i-1]);
+            int w1 = prow->w[j-3] + m_matrix.MultScore(m_nseq[j-3], m_nseq[j-2], m_nseq[j-1], m_pseq[i-1]);
             int w12 = prow->w[j-1];
             int w13 = prow->w[j-2];
             int w0 = max(w1, max(w12, max(w13, max(h1, max(h2, h3)))));
-            if(w0 == w1) b += 1;
-            else if(w0 == w12) b += 12;
-            else if(w0 == w13) b += 13;
-            else if(w0 == h2) b += 14;
-            else if(w0 == h3) b += 15;
+            if(w0 == w1) bl += 1;
+            else if(w0 == w12) bl += 12;
+            else if(w0 == w13) bl += 13;
+            else if(w0 == h2) bl += 14;
+            else if(w0 == h3) bl += 15;
             //default w=h1, b += 0;
             crow->w[j] = w0;
         }
-        //remember the best W in the last column
-        if(wmax <= crow->w[jlen - 1]) {
-            wmax = crow->w[jlen - 1];
-            imax = i;
-        }
-    } else {//regular score for the right v-gap
-            wmax = crow->w[jlen - 1];
-            imax = i;
-            jmax = jlen - 1;
     }
+}
+
+int   FrAlignFNog1(const CProSplignInterrupt& interrupt, CBackAlignInfo& bi, const PSEQ& pseq, const CNSeq& nseq,
+                   // int g/*gap opening*/, int e/*one nuc extension cost*/, int f/*frameshift opening cost*/,
+                   const CProSplignScaledScoring& scoring, const CSubstMatrix& matrix,
+                   bool left_gap, bool right_gap)
+{
+  if(nseq.size() < 1) return 0;
+  int ilen = (int)pseq.size() + 1;
+  int jlen = nseq.size() + 1;
+  CFrAlignFNog1Rows rows(interrupt, pseq, nseq, scoring, matrix, left_gap, right_gap);
+  CAlignFNogMax best(jlen, right_gap);
+  rows.InitFirstRow();
+  // *******  MAIN LOOP ******************
+  for(int i=1;i<ilen;++i) {
+      rows.NextRow(i, bi.b[i-1]);
+      best.AddRow(i, rows.GetW());
   }
   //at this point wmax - best from the last column
   //find best from the last row
-  for(j=1;j<jlen;++j) {
-      if(wmax <= crow->w[j]) {
-          wmax = crow->w[j];
-          imax = ilen - 1;
-          jmax = j;
-      }
-  }
-  bi.maxi = imax - 1;//shift to back align coord
-  bi.maxj = jmax - 1;//shift to back align coord
-  return wmax;
+  best.AddLastRow(ilen - 1, rows.GetW());
+  bi.maxi = best.imax - 1;//shift to back align coord
+  bi.maxj = best.jmax - 1;//shift to back align coord
+  return best.wmax;
 }
 
-
-int AlignFNog(const CProSplignInterrupt& interrupt, CTBackAlignInfo<CBMode>& bi, const PSEQ& pseq, const CNSeq& nseq, const CProSplignScaledScoring& scoring, const CSubstMatrix& matrix)
+int   FrAlignFNog1(const CProSplignInterrupt& interrupt, CFrCheckpointBackAlignInfo& bi, const PSEQ& pseq, const CNSeq& nseq,
+                   const CProSplignScaledScoring& scoring, const CSubstMatrix& matrix,
+                   bool left_gap, bool right_gap)
 {
   if(nseq.size() < 1) return 0;
-  int ilen = (int)pseq.size() + 1;
-  int jlen = nseq.size() + 1;
-  CAlignRow row1(jlen, scoring), row2(jlen, scoring);
-  CAlignRow *crow = &row1, *prow = &row2;
-  int i, j;
-  CFastIScore fiscore;
-  fiscore.Init(nseq, matrix);
-  CFIntron fin(nseq, scoring);
-  //first row, i.e. i=0
-    for(j=0;j<jlen;j++) {
-      crow->w[j] = 0;
-      crow->v[j] = infinity; 
-    }
-    int wmax = 0;
-    int imax = 0;
-    int jmax = jlen - 1;
-  // ** prepare for main loop
-  //penalties
-    //    CScoring::Init();
+  CFrAlignFNog1Rows rows(interrupt, pseq, nseq, scoring, matrix, left_gap, right_gap);
+  CAlignFNogMax best(nseq.size() + 1, right_gap);
+  return s_CheckpointAlign(rows, best, bi);
+}
+
+void FrBackAlign(CBackAlignInfo& bi, CAli& ali)
+{
+    s_FrBackAlign(bi.b, bi.ilen, bi.jlen, bi.maxi, bi.maxj, ali);
+}
+
+void FrBackAlign(const CProSplignInterrupt& interrupt, CFrCheckpointBackAlignInfo& bi, const PSEQ& pseq, const CNSeq& nseq, const CProSplignScaledScoring& scoring, const CSubstMatrix& matrix, bool left_gap, bool right_gap, CAli& ali)
+{
+    CFrAlignFNog1Rows rows(interrupt, pseq, nseq, scoring, matrix, left_gap, right_gap);
+    CCheckpointBackRows<CFrAlignFNog1Rows, char> back_rows(bi, rows);
+    s_FrBackAlign(back_rows, bi.ilen, bi.jlen, bi.maxi, bi.maxj, ali);
+}
+
+
+//AlignFNog computed row by row. Used by both back tracking storages,
+//the checkpointed one recomputes rows from the saved ones
+class CAlignFNogRows
+{
+public:
+    CAlignFNogRows(const CProSplignInterrupt& interrupt, const PSEQ& pseq, const CNSeq& nseq, const CProSplignScaledScoring& scoring, const CSubstMatrix& matrix);
+    //row 0
+    void InitFirstRow(void);
+    //makes previously saved row the last computed one
+    void SetRow(const vector<int>& w, const vector<int>& v);
+    void GetRow(vector<int>& w, vector<int>& v) const { w = m_crow->m_w; v = m_crow->m_v; }
+    //computes row i, b - back tracking row (i-1)
+    void NextRow(int i, CBMode *b);
+    const int *GetW(void) const { return m_crow->w; }
+private:
+    const CProSplignInterrupt& m_interrupt;
+    const PSEQ& m_pseq;
+    const CSubstMatrix& m_matrix;
+    const CProSplignScaledScoring& m_scoring;
+    int m_jlen;
+    CAlignRow m_row1, m_row2;
+    CAlignRow *m_crow, *m_prow;
+    CFastIScore m_fiscore;
+    CFIntron m_fin;
+    //penalties
+    int m_pev1, m_pev2, m_pe2, m_pe3, m_pe4, m_pe5, m_pe6;
+
+    CAlignFNogRows(const CAlignFNogRows&);
+    CAlignFNogRows& operator=(const CAlignFNogRows&);
+};
+
+CAlignFNogRows::CAlignFNogRows(const CProSplignInterrupt& interrupt, const PSEQ& pseq, const CNSeq& nseq, const CProSplignScaledScoring& scoring, const CSubstMatrix& matrix) :
+    m_interrupt(interrupt), m_pseq(pseq), m_matrix(matrix), m_scoring(scoring), m_jlen(nseq.size() + 1),
+    m_row1(m_jlen, scoring), m_row2(m_jlen, scoring), m_crow(&m_row1), m_prow(&m_row2), m_fin(nseq, scoring)
+{
+    m_fiscore.Init(nseq, matrix);
     int e = scoring.sm_Ine;
     int g = scoring.sm_Ig;
     int f = scoring.sm_If;
-  int pev1 =  - g - 3*e;
-  int pev2 = - 3*e;
-  int pe2 =  - f - 2*e;
-  int pe3 =  - (f - g) - 2*e;
-  int pe4 =  - f - e;
-  int pe5 =  - (f - g) - e;
-  int pe6 =  f - g - e;
-  int *cv, *cw, *pv, *pv1, *pw1, *pw3, *ch1, *ch2, *ch3;
-  // *******  MAIN LOOP ******************
-  for(i=1;i<ilen;++i) {
-    swap(crow, prow);
+    m_pev1 =  - g - 3*e;
+    m_pev2 = - 3*e;
+    m_pe2 =  - f - 2*e;
+    m_pe3 =  - (f - g) - 2*e;
+    m_pe4 =  - f - e;
+    m_pe5 =  - (f - g) - e;
+    m_pe6 =  f - g - e;
+}
+
+void CAlignFNogRows::InitFirstRow(void)
+{
+    for(int j=0;j<m_jlen;j++) {
+      m_crow->w[j] = 0;
+      m_crow->v[j] = infinity; 
+    }
+}
+
+void CAlignFNogRows::SetRow(const vector<int>& w, const vector<int>& v)
+{
+    _ASSERT(w.size() == m_crow->m_w.size() && v.size() == m_crow->m_v.size());
+    copy(w.begin(), w.end(), m_crow->m_w.begin());
+    copy(v.begin(), v.end(), m_crow->m_v.begin());
+}
+
+void CAlignFNogRows::NextRow(int i, CBMode *b)
+{
+    swap(m_crow, m_prow);
+    CAlignRow *crow = m_crow, *prow = m_prow;
+    const CProSplignScaledScoring& scoring = m_scoring;
+    CFastIScore& fiscore = m_fiscore;
+    CFIntron& fin = m_fin;
+    int e = scoring.sm_Ine;
+    int pev1 = m_pev1, pev2 = m_pev2, pe2 = m_pe2, pe3 = m_pe3, pe4 = m_pe4, pe5 = m_pe5, pe6 = m_pe6;
+    int *cv, *cw, *pv, *pv1, *pw1, *pw3, *ch1, *ch2, *ch3;
+    int j;
     //set first few columns
     crow->w[0] = 0;
     crow->w[1] = 0;
-    bi.b[i-1][0].wmode = 4;
+    b[0].wmode = 4;
     crow->w[2] = 0;
-    bi.b[i-1][1].wmode = 6;
+    b[1].wmode = 6;
     crow->v[1] = crow->v[2]  = infinity;
     int h1 = infinity;
     int h2 = infinity;
@@ -983,7 +1262,7 @@ int AlignFNog(const CProSplignInterrupt& interrupt, CTBackAlignInfo<CBMode>& bi,
    //extra init for intron scoring
     fin.InitRowScores(crow, prow->m_w, 3);
    // pointers
-    CBMode *pb = &bi.b[i-1][2];
+    CBMode *pb = &b[2];
     cv = &crow->v[2];
     ch1 = &crow->h1[2];
     ch2 = &crow->h2[2];
@@ -993,11 +1272,11 @@ int AlignFNog(const CProSplignInterrupt& interrupt, CTBackAlignInfo<CBMode>& bi,
     pw1 =  &prow->w[2];
     pv1 =  &prow->v[2];
     pv =  &prow->v[0];
-    fiscore.SetAmin(pseq[i-1], matrix);
-    int jlen_1 = jlen - 1;
+    fiscore.SetAmin(m_pseq[i-1], m_matrix);
+    int jlen_1 = m_jlen - 1;
   // *******  INTERNAL LOOP ******************
 	for(j=3;j<jlen_1;++j) {
-        interrupt.CheckUserInterrupt();
+        m_interrupt.CheckUserInterrupt();
         int bb = 0;
         const CBestI& bei = fin.Step(j, scoring, fiscore);
         //rest
@@ -1070,7 +1349,7 @@ int AlignFNog(const CProSplignInterrupt& interrupt, CTBackAlignInfo<CBMode>& bi,
     }
     //the last column !
     if(2 < jlen_1) { //j == jlen_1 
-        int& bb = bi.b[i-1][j-1].wmode;
+        int& bb = b[j-1].wmode;
         bb = 0;
         const CBestI bei = fin.Step(j, scoring, fiscore);
         //rest
@@ -1120,40 +1399,53 @@ int AlignFNog(const CProSplignInterrupt& interrupt, CTBackAlignInfo<CBMode>& bi,
         }
         crow->w[j] = w0;
     }
-    //remember the best W in the last column
-    if(wmax <= crow->w[jlen - 1]) {
-        wmax = crow->w[jlen - 1];
-        imax = i;
-    }
+}
+
+int AlignFNog(const CProSplignInterrupt& interrupt, CTBackAlignInfo<CBMode>& bi, const PSEQ& pseq, const CNSeq& nseq, const CProSplignScaledScoring& scoring, const CSubstMatrix& matrix)
+{
+  if(nseq.size() < 1) return 0;
+  int ilen = (int)pseq.size() + 1;
+  int jlen = nseq.size() + 1;
+  CAlignFNogRows rows(interrupt, pseq, nseq, scoring, matrix);
+  CAlignFNogMax best(jlen);
+  rows.InitFirstRow();
+  // *******  MAIN LOOP ******************
+  for(int i=1;i<ilen;++i) {
+      rows.NextRow(i, bi.b[i-1]);
+      //remember the best W in the last column
+      best.AddRow(i, rows.GetW());
   }
   //at this point wmax - best from the last column
   //find best from the last row
-  for(j=1;j<jlen;++j) {
-      if(wmax <= crow->w[j]) {
-          wmax = crow->w[j];
-          imax = ilen - 1;
-          jmax = j;
-      }
-  }
-  bi.maxi = imax - 1;//shift to back align coord
-  bi.maxj = jmax - 1;//shift to back align coord
-  return wmax;
+  best.AddLastRow(ilen - 1, rows.GetW());
+  bi.maxi = best.imax - 1;//shift to back align coord
+  bi.maxj = best.jmax - 1;//shift to back align coord
+  return best.wmax;
 }
 
-void BackAlignNog(CTBackAlignInfo<CBMode>& bi, CAli& ali)
+int AlignFNog(const CProSplignInterrupt& interrupt, CCheckpointBackAlignInfo& bi, const PSEQ& pseq, const CNSeq& nseq, const CProSplignScaledScoring& scoring, const CSubstMatrix& matrix)
+{
+  if(nseq.size() < 1) return 0;
+  CAlignFNogRows rows(interrupt, pseq, nseq, scoring, matrix);
+  CAlignFNogMax best(nseq.size() + 1);
+  return s_CheckpointAlign(rows, best, bi);
+}
+
+template<class TRows>
+void s_BackAlignNog(TRows& b, int ilen, int jlen, int maxi, int maxj, CAli& ali)
 {
   CAliCreator alic(ali);
   int i, j;
-  for(i = bi.ilen-1; i>bi.maxi; --i) {
+  for(i = ilen-1; i>maxi; --i) {
         alic.Add(eVP, 3);
   }
-  for(j = bi.jlen-1; j>bi.maxj; --j) {
+  for(j = jlen-1; j>maxj; --j) {
         alic.Add(eHP, 1);
   }
   int curGAPmode = eD;
   int vs, h1s, h2s, h3s, vmode, h1mode, wm;
   while(i>=0 && j>=0) {
-    CBMode bm = bi.b[i][j];
+    CBMode bm = b[i][j];
     wm = bm.wmode;
     vs = wm&32;
     h1s = wm&64;
@@ -1263,5 +1555,17 @@ void BackAlignNog(CTBackAlignInfo<CBMode>& bi, CAli& ali)
 }
 
 
+void BackAlignNog(CTBackAlignInfo<CBMode>& bi, CAli& ali)
+{
+    s_BackAlignNog(bi.b, bi.ilen, bi.jlen, bi.maxi, bi.maxj, ali);
+}
+
+void BackAlignNog(const CProSplignInterrupt& interrupt, CCheckpointBackAlignInfo& bi, const PSEQ& pseq, const CNSeq& nseq, const CProSplignScaledScoring& scoring, const CSubstMatrix& matrix, CAli& ali)
+{
+    CAlignFNogRows rows(interrupt, pseq, nseq, scoring, matrix);
+    CCheckpointBackRows<CAlignFNogRows, CBMode> back_rows(bi, rows);
+    s_BackAlignNog(back_rows, bi.ilen, bi.jlen, bi.maxi, bi.maxj, ali);
+}
+
 END_SCOPE(prosplign)
 END_NCBI_SCOPE
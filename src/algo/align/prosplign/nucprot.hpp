@@ -77,6 +77,9 @@ struct CBMode {//back tracking for one stage fast version (AlignFNog, BackAlignF
     int wlen, vlen, h1len, h2len, h3len; //splice lengths
 };
 
+//memory bounded back tracking for AlignFNog
+typedef CTCheckpointBackAlignInfo<CBMode> CCheckpointBackAlignInfo;
+
 class CTranslationTable : public CObject {
 public:
     CTranslationTable(int gcode, bool allow_alt_starts);
@@ -146,6 +149,7 @@ public:
     void SetAmin(char amin, const CSubstMatrix& matrix);//call before GetScore() and/or GetScore(int n1, int n2, int n3)
     void Init(const CNSeq& seq, const CSubstMatrix& matrix);//call before GetScore()
     inline int GetScore() { return *++m_pos; }
+    inline void Skip(int n) { m_pos += n; }//skips scores of n columns
     inline int GetScore(int n1, int n2, int n3) const { return m_gpos[n1*25+n2*5+n3]; }
     CFastIScore() :  m_size(0), m_init(false) { m_scores.resize(1); }
 private:
@@ -215,14 +219,48 @@ private:
 int   FrAlignFNog1(const CProSplignInterrupt& interrupt, CBackAlignInfo& bi, const PSEQ& pseq, const CNSeq& nseq, const CProSplignScaledScoring& scoring, const CSubstMatrix& matrix, bool left_gap = false, bool right_gap = false);
 //**** good  for FrAlignNog, FrAlignNog1, FrAlign and FrAlignFNog1
 void FrBackAlign(CBackAlignInfo& bi, CAli& ali);
+//same with memory bounded back tracking, FrBackAlign recomputes the DP, so it needs the same input
+int   FrAlignFNog1(const CProSplignInterrupt& interrupt, CFrCheckpointBackAlignInfo& bi, const PSEQ& pseq, const CNSeq& nseq, const CProSplignScaledScoring& scoring, const CSubstMatrix& matrix, bool left_gap = false, bool right_gap = false);
+void FrBackAlign(const CProSplignInterrupt& interrupt, CFrCheckpointBackAlignInfo& bi, const PSEQ& pseq, const CNSeq& nseq, const CProSplignScaledScoring& scoring, const CSubstMatrix& matrix, bool left_gap, bool right_gap, CAli& ali);
 
 // *****   versions without gap/frameshift penalty at the beginning/end ONE STAGE, FAST
 int AlignFNog(const CProSplignInterrupt& interrupt, CTBackAlignInfo<CBMode>& bi, const PSEQ& pseq, const CNSeq& nseq, const CProSplignScaledScoring& scoring, const CSubstMatrix& matrix);
 void BackAlignNog(CTBackAlignInfo<CBMode>& bi, CAli& ali);
+//same with memory bounded back tracking, BackAlignNog recomputes the DP, so it needs the same input
+int AlignFNog(const CProSplignInterrupt& interrupt, CCheckpointBackAlignInfo& bi, const PSEQ& pseq, const CNSeq& nseq, const CProSplignScaledScoring& scoring, const CSubstMatrix& matrix);
+void BackAlignNog(const CProSplignInterrupt& interrupt, CCheckpointBackAlignInfo& bi, const PSEQ& pseq, const CNSeq& nseq, const CProSplignScaledScoring& scoring, const CSubstMatrix& matrix, CAli& ali);
+
+//columns of each row searched by FindFGapIntronNog, a band around compartment hits
+class CHitBand
+{
+public:
+    //hit in protein residues and in nucleotide positions of the aligned
+    //genomic sequence (counted along its strand), all inclusive
+    struct SHit {
+        int pfrom, pto;
+        int nfrom, nto;
+    };
+    typedef vector<SHit> THits;
+
+    //rows are followed along the hits, and from the end of one hit to
+    //the start of the next one to leave room for introns;
+    //width is in residues on each side, 0 or no hits means no band
+    void Init(const THits& hits, int width, int plen, int nlen);
+    bool Empty(void) const { return m_from.empty(); }
+    //row i holds the cells for the first i residues
+    inline int From(int i) const { return m_from[i]; }
+    inline int To(int i) const { return m_to[i]; }
+    //number of cells searched
+    double GetArea(void) const;
+private:
+    vector<int> m_from, m_to;
+};
 
 // *****   versions without gap/frameshift penalty at the beginning/end FAST
+//band is optional, the whole matrix is searched without it
 int FindFGapIntronNog(const CProSplignInterrupt& interrupt, vector<pair<int, int> >& igi/*to return end gap/intron set*/, 
-                      const PSEQ& pseq, const CNSeq& nseq, bool& left_gap, bool& right_gap, const CProSplignScaledScoring& scoring, const CSubstMatrix& matrix);
+                      const PSEQ& pseq, const CNSeq& nseq, bool& left_gap, bool& right_gap, const CProSplignScaledScoring& scoring, const CSubstMatrix& matrix,
+                      const CHitBand* band = NULL);
 
 //*** mixed gap penalty (OLD, aka version 2)
 int FindIGapIntrons(const CProSplignInterrupt& interrupt, vector<pair<int, int> >& igi/*to return end gap/intron set*/, const PSEQ& pseq, const CNSeq& nseq, int g/*gap opening*/, int e/*one nuc extension cost*/,
@@ -164,6 +164,20 @@ void CProSplignScoring::SetupArgDescriptions(CArgDescriptions* arg_desc)
          "intron_extension cost for 1 base = 1/(inverted_intron_extension*3)",
          CArgDescriptions::eInteger,
          NStr::IntToString(CProSplignScoring::default_inverted_intron_extension));
+    arg_desc->AddDefaultKey
+        ("max_back_align_memory",
+         "max_back_align_memory",
+         "Max memory for back tracking in megabytes, bigger problems keep checkpoint rows only "
+         "and recompute the alignment from them, using the least memory they can",
+         CArgDescriptions::eInteger,
+         NStr::IntToString(CProSplignScoring::default_max_back_align_memory));
+    arg_desc->AddDefaultKey
+        ("band_width",
+         "band_width",
+         "Band width in residues around compartment hits for the intron search, "
+         "used when a compartment is given; 0 searches the whole matrix",
+         CArgDescriptions::eInteger,
+         NStr::IntToString(CProSplignScoring::default_band_width));
 }
 ///////////////////////////////////////////////////////////////////////////
 CProSplignScoring::CProSplignScoring() : CProSplignOptions_Base()
@@ -177,6 +191,8 @@ CProSplignScoring::CProSplignScoring() : CProSplignOptions_Base()
     SetATIntronCost(default_intron_AT);
     SetNonConsensusIntronCost(default_intron_non_consensus);
     SetInvertedIntronExtensionCost(default_inverted_intron_extension);
+    SetMaxBackAlignMemory(default_max_back_align_memory);
+    SetBandWidth(default_band_width);
 }
 
 CProSplignScoring::CProSplignScoring(const CArgs& args) : CProSplignOptions_Base(args)
@@ -190,6 +206,8 @@ CProSplignScoring::CProSplignScoring(const CArgs& args) : CProSplignOptions_Base
     SetATIntronCost(args["intron_AT"].AsInteger());
     SetNonConsensusIntronCost(args["intron_non_consensus"].AsInteger());
     SetInvertedIntronExtensionCost(args["inverted_intron_extension"].AsInteger());
+    SetMaxBackAlignMemory(args["max_back_align_memory"].AsInteger());
+    SetBandWidth(args["band_width"].AsInteger());
 }
 void CProSplignOutputOptions::SetupArgDescriptions(CArgDescriptions* arg_desc)
 {
@@ -550,6 +568,26 @@ int CProSplignScoring::GetInvertedIntronExtensionCost() const
     return inverted_intron_extension;
 }
 
+CProSplignScoring& CProSplignScoring::SetMaxBackAlignMemory(int val)
+{
+    max_back_align_memory = val;
+    return *this;
+}
+int CProSplignScoring::GetMaxBackAlignMemory() const
+{
+    return max_back_align_memory;
+}
+
+CProSplignScoring& CProSplignScoring::SetBandWidth(int val)
+{
+    band_width = val;
+    return *this;
+}
+int CProSplignScoring::GetBandWidth() const
+{
+    return band_width;
+}
+
 bool CProSplignOutputOptions::IsPassThrough() const
 {
     return GetTotalPositives() == 0 && GetFlankPositives() == 0;
@@ -814,10 +852,17 @@ public:
         m_Interrupt.SetInterruptCallback(prg_callback, data);
     }
 
+    //hits to band the search around, NULL for none
+    void SetCompartment(const CSeq_annot* compartment)
+    {
+        m_compartment.Reset(compartment);
+    }
+
 
 private:
     virtual int stage1() = 0;
     virtual void stage2(CAli& ali) = 0;
+    void x_InitBand();
 
 protected:
     CProSplignScaledScoring m_scoring;
@@ -829,13 +874,16 @@ protected:
     auto_ptr<CPSeq> m_protseq;
     auto_ptr<CNSeq> m_cnseq;
 
+    CConstRef<CSeq_annot> m_compartment;
+    CHitBand m_band;//empty if not banded
+
     CProSplignInterrupt m_Interrupt;
     
 };
 
 class COneStage : public CProSplign::CImplementation {
 public:
-    COneStage(CProSplignScoring scoring) : CProSplign::CImplementation(scoring) {}
+    COneStage(CProSplignScoring scoring) : CProSplign::CImplementation(scoring), m_checkpoint(false) {}
     virtual COneStage* clone() { return new COneStage(*this); }
 
 private:
@@ -843,17 +891,50 @@ private:
     virtual void stage2(CAli& ali);
 
     CTBackAlignInfo<CBMode> m_bi;
+    CCheckpointBackAlignInfo m_cbi;//used when m_bi would be too big
+    bool m_checkpoint;
 };
 
+//true if the back tracking matrix is too big and should be replaced with a checkpointed one
+static bool s_UseCheckpoint(const CProSplignScoring& scoring, int ilen, int jlen, size_t cell_size)
+{
+    return (double)ilen*jlen*cell_size > scoring.GetMaxBackAlignMemory()*1024.*1024.;
+}
+
+//checkpointed back tracking uses the least memory it can,
+//warn if even that does not fit into max_back_align_memory
+template<class T>
+static void s_InitCheckpoint(CTCheckpointBackAlignInfo<T>& bi, const CProSplignScoring& scoring, int ilen, int jlen)
+{
+    bi.Init(ilen, jlen);
+    const double mem = bi.GetMemory()/(1024.*1024.);
+    if(mem > scoring.GetMaxBackAlignMemory()) {
+        ERR_POST(Warning << "ProSplign back tracking of " << ilen << " x " << jlen
+                 << " needs " << (Int8)ceil(mem) << " MB, more than max_back_align_memory "
+                 << scoring.GetMaxBackAlignMemory() << " MB");
+    }
+}
+
 int COneStage::stage1()
 {
-    m_bi.Init((int)m_protseq->seq.size(), (int)m_cnseq->size());//backtracking
+    int ilen = (int)m_protseq->seq.size();
+    int jlen = (int)m_cnseq->size();
+    m_checkpoint = s_UseCheckpoint(m_scoring, ilen, jlen, sizeof(CBMode));
+    if(m_checkpoint) {
+        s_InitCheckpoint(m_cbi, m_scoring, ilen, jlen);//backtracking
+        return AlignFNog(m_Interrupt, m_cbi, m_protseq->seq, *m_cnseq, m_scoring, m_matrix);
+    }
+    m_bi.Init(ilen, jlen);//backtracking
     return AlignFNog(m_Interrupt, m_bi, m_protseq->seq, *m_cnseq, m_scoring, m_matrix);
 }
 
 void COneStage::stage2(CAli& ali)
 {
-    BackAlignNog(m_bi, ali);
+    if(m_checkpoint) {
+        BackAlignNog(m_Interrupt, m_cbi, m_protseq->seq, *m_cnseq, m_scoring, m_matrix, ali);
+    } else {
+        BackAlignNog(m_bi, ali);
+    }
 }
 
 class CTwoStage : public CProSplign::CImplementation {
@@ -940,31 +1021,40 @@ int CTwoStageNew::stage1()
 {
     if (m_just_second_stage)
         return 0;
-    return FindFGapIntronNog(m_Interrupt, m_igi, m_protseq->seq, *m_cnseq, m_lgap, m_rgap, m_scoring, m_matrix);
+    return FindFGapIntronNog(m_Interrupt, m_igi, m_protseq->seq, *m_cnseq, m_lgap, m_rgap, m_scoring, m_matrix, &m_band);
 }
 
 void CTwoStageNew::stage2(CAli& ali)
 {
     CNSeq cfrnseq;
     cfrnseq.Init(*m_cnseq, m_igi);
-            
-    CBackAlignInfo bi;
-    bi.Init((int)m_protseq->seq.size(), (int)cfrnseq.size()); //backtracking
-        
-    FrAlignFNog1(m_Interrupt, bi, m_protseq->seq, cfrnseq, m_scoring, m_matrix, m_lgap, m_rgap);
 
-    FrBackAlign(bi, ali);
+    int ilen = (int)m_protseq->seq.size();
+    int jlen = (int)cfrnseq.size();
+    if(s_UseCheckpoint(m_scoring, ilen, jlen, sizeof(char))) {
+        CFrCheckpointBackAlignInfo bi;
+        s_InitCheckpoint(bi, m_scoring, ilen, jlen); //backtracking
+        FrAlignFNog1(m_Interrupt, bi, m_protseq->seq, cfrnseq, m_scoring, m_matrix, m_lgap, m_rgap);
+        FrBackAlign(m_Interrupt, bi, m_protseq->seq, cfrnseq, m_scoring, m_matrix, m_lgap, m_rgap, ali);
+    } else {
+        CBackAlignInfo bi;
+        bi.Init(ilen, jlen); //backtracking
+        FrAlignFNog1(m_Interrupt, bi, m_protseq->seq, cfrnseq, m_scoring, m_matrix, m_lgap, m_rgap);
+        FrBackAlign(bi, ali);
+    }
     CAli new_ali(m_igi, m_lgap, m_rgap, ali);
     ali = new_ali;
 }
 
 class CIntronless : public CProSplign::CImplementation {
 public:
-    CIntronless(CProSplignScoring scoring) : CProSplign::CImplementation(scoring) {}
+    CIntronless(CProSplignScoring scoring) : CProSplign::CImplementation(scoring), m_checkpoint(false) {}
 private:
     virtual void stage2(CAli& ali);
 protected:
     CBackAlignInfo m_bi;
+    CFrCheckpointBackAlignInfo m_cbi;//used when m_bi would be too big
+    bool m_checkpoint;
 };
 
 class CIntronlessOld : public CIntronless {
@@ -994,13 +1084,24 @@ int CIntronlessOld::stage1()
 
 int CIntronlessNew::stage1()
 { 
-    m_bi.Init((int)m_protseq->seq.size(), (int)m_cnseq->size());//backtracking
+    int ilen = (int)m_protseq->seq.size();
+    int jlen = (int)m_cnseq->size();
+    m_checkpoint = s_UseCheckpoint(m_scoring, ilen, jlen, sizeof(char));
+    if(m_checkpoint) {
+        s_InitCheckpoint(m_cbi, m_scoring, ilen, jlen);//backtracking
+        return FrAlignFNog1(m_Interrupt, m_cbi, m_protseq->seq, *m_cnseq, m_scoring, m_matrix);
+    }
+    m_bi.Init(ilen, jlen);//backtracking
     return FrAlignFNog1(m_Interrupt, m_bi, m_protseq->seq, *m_cnseq, m_scoring, m_matrix);
 }
 
 void CIntronless::stage2(CAli& ali)
 {
-    FrBackAlign(m_bi, ali);
+    if(m_checkpoint) {
+        FrBackAlign(m_Interrupt, m_cbi, m_protseq->seq, *m_cnseq, m_scoring, m_matrix, false, false, ali);
+    } else {
+        FrBackAlign(m_bi, ali);
+    }
 }
 
 CProSplign::CImplementation* CProSplign::CImplementation::create(CProSplignScoring scoring, bool intronless, bool one_stage, bool just_second_stage, bool old)
@@ -1104,6 +1205,20 @@ void CProSplign::AssignGeneticCode(CScope& scope, const CSeq_id& gid, int gcode)
 }
 
 
+CRef<CSeq_align> CProSplign::FindGlobalAlignment(CScope& scope, const CSeq_id& protein, const CSeq_loc& genomic, const CSeq_annot& compartment)
+{
+    m_implementation->SetCompartment(&compartment);
+    CRef<CSeq_align> result;
+    try {
+        result = FindGlobalAlignment(scope, protein, genomic);
+    } catch (...) {
+        m_implementation->SetCompartment(NULL);
+        throw;
+    }
+    m_implementation->SetCompartment(NULL);
+    return result;
+}
+
 CRef<CSeq_align> CProSplign::FindGlobalAlignment(CScope& scope, const CSeq_id& protein, const CSeq_loc& genomic_orig)
 {
     CRef<CSeq_loc> genomic(new CSeq_loc);
@@ -1193,10 +1308,55 @@ int CProSplign::CImplementation::FindGlobalAlignment_stage1(CScope& scope, const
     m_genomic->Assign(genomic);
     m_protseq.reset(new CPSeq(*m_scope, *m_protein));
     m_cnseq.reset(new CNSeq(*m_scope, *m_genomic));
+    x_InitBand();
 
     return stage1();
 }
 
+//compartment hits on the strand being aligned, counted along that strand from
+//the start of the genomic interval
+void CProSplign::CImplementation::x_InitBand()
+{
+    m_band = CHitBand();
+    if (m_compartment.Empty() || m_scoring.GetBandWidth() <= 0 || !m_compartment->IsAlign())
+        return;
+
+    const CSeq_id& gid = *m_genomic->GetId();
+    const bool minus = IsReverse(m_genomic->GetStrand());
+    const int from = m_genomic->GetTotalRange().GetFrom();
+    const int to = m_genomic->GetTotalRange().GetTo();
+
+    CHitBand::THits hits;
+    ITERATE (CSeq_annot::TData::TAlign, a, m_compartment->GetData().GetAlign()) {
+        if (!(*a)->GetSegs().IsStd())
+            continue;
+        ITERATE (CSeq_align::TSegs::TStd, s, (*a)->GetSegs().GetStd()) {
+            const CStd_seg::TLoc& loc = (*s)->GetLoc();
+            if (loc.size() != 2 || !loc[0]->IsInt() || !loc[1]->IsInt())
+                continue;
+            const CSeq_interval& prot = loc[0]->GetInt();
+            const CSeq_interval& gen = loc[1]->GetInt();
+            if (IsReverse(gen.IsSetStrand() ? gen.GetStrand() : eNa_strand_plus) != minus ||
+                int(gen.GetFrom()) < from || int(gen.GetTo()) > to ||
+                !sequence::IsSameBioseq(prot.GetId(), *m_protein, m_scope) ||
+                !sequence::IsSameBioseq(gen.GetId(), gid, m_scope))
+                continue;
+            CHitBand::SHit hit;
+            hit.pfrom = prot.GetFrom();
+            hit.pto = prot.GetTo();
+            if (minus) {
+                hit.nfrom = to - gen.GetTo();
+                hit.nto = to - gen.GetFrom();
+            } else {
+                hit.nfrom = gen.GetFrom() - from;
+                hit.nto = gen.GetTo() - from;
+            }
+            hits.push_back(hit);
+        }
+    }
+    m_band.Init(hits, m_scoring.GetBandWidth(), (int)m_protseq->seq.size(), m_cnseq->size());
+}
+
 CRef<CSeq_align> CProSplign::CImplementation::FindGlobalAlignment_stage2()
 {
     CAli ali;
@@ -0,0 +1,269 @@
+/*  $Id$
+ * ===========================================================================
+ *
+ *                            PUBLIC DOMAIN NOTICE
+ *               National Center for Biotechnology Information
+ *
+ *  This software/database is a "United States Government Work" under the
+ *  terms of the United States Copyright Act.  It was written as part of
+ *  the author's official duties as a United States Government employee and
+ *  thus cannot be copyrighted.  This software/database is freely available
+ *  to the public for use. The National Library of Medicine and the U.S.
+ *  Government have not placed any restriction on its use or reproduction.
+ *
+ *  Although all reasonable efforts have been taken to ensure the accuracy
+ *  and reliability of the software and data, the NLM and the U.S.
+ *  Government do not and cannot warrant the performance or results that
+ *  may be obtained by using this software or data. The NLM and the U.S.
+ *  Government disclaim all warranties, express or implied, including
+ *  warranties of performance, merchantability or fitness for any particular
+ *  purpose.
+ *
+ *  Please cite the author in any work or product based on this material.
+ *
+ * ===========================================================================
+ *
+ * File Description:
+ *   ProSplign unit test: alignments found with the checkpointed back
+ *   alignment storage must be identical to the ones found with the full one,
+ *   and so must be the ones found with the intron search banded around
+ *   compartment hits
+ *
+ * ===========================================================================
+ */
+
+#include <ncbi_pch.hpp>
+
+#include <corelib/test_boost.hpp>
+
+#include <objmgr/object_manager.hpp>
+#include <objmgr/scope.hpp>
+
+#include <objects/seq/Bioseq.hpp>
+#include <objects/seq/Seq_inst.hpp>
+#include <objects/seq/Seq_data.hpp>
+#include <objects/seq/IUPACaa.hpp>
+#include <objects/seq/IUPACna.hpp>
+#include <objects/seq/Seq_annot.hpp>
+#include <objects/seqloc/Seq_id.hpp>
+#include <objects/seqloc/Seq_loc.hpp>
+#include <objects/seqalign/seqalign__.hpp>
+
+#include <algo/align/prosplign/prosplign.hpp>
+
+#include <util/random_gen.hpp>
+
+USING_NCBI_SCOPE;
+USING_SCOPE(objects);
+
+static const char kAminoAcids[] = "ARNDCQEGHILKMFPSTWYV";
+
+static const char* s_Codon(char aa)
+{
+    switch (aa) {
+    case 'A': return "GCT";
+    case 'R': return "CGT";
+    case 'N': return "AAT";
+    case 'D': return "GAT";
+    case 'C': return "TGT";
+    case 'Q': return "CAA";
+    case 'E': return "GAA";
+    case 'G': return "GGT";
+    case 'H': return "CAT";
+    case 'I': return "ATT";
+    case 'L': return "CTG";
+    case 'K': return "AAA";
+    case 'M': return "ATG";
+    case 'F': return "TTT";
+    case 'P': return "CCT";
+    case 'S': return "TCT";
+    case 'T': return "ACT";
+    case 'W': return "TGG";
+    case 'Y': return "TAT";
+    default:  return "GTT";
+    }
+}
+
+static string s_RandomNa(CRandom& rnd, size_t len)
+{
+    static const char kNa[] = "ACGT";
+    string seq;
+    for (size_t i = 0; i < len; ++i) {
+        seq += kNa[rnd.GetRand(0, 3)];
+    }
+    return seq;
+}
+
+static CRef<CSeq_id> s_AddBioseq(CScope& scope, const string& id,
+                                 const string& seq, bool protein)
+{
+    CRef<CSeq_id> seq_id(new CSeq_id(CSeq_id::e_Local, id));
+    CRef<CBioseq> bioseq(new CBioseq);
+    bioseq->SetId().push_back(seq_id);
+    CSeq_inst& inst = bioseq->SetInst();
+    inst.SetRepr(CSeq_inst::eRepr_raw);
+    inst.SetMol(protein ? CSeq_inst::eMol_aa : CSeq_inst::eMol_dna);
+    inst.SetLength(TSeqPos(seq.size()));
+    if (protein) {
+        inst.SetSeq_data().SetIupacaa().Set(seq);
+    } else {
+        inst.SetSeq_data().SetIupacna().Set(seq);
+    }
+    scope.AddBioseq(*bioseq);
+    return seq_id;
+}
+
+/// A protein and its coding genomic region: three exons (the second
+/// intron splits a codon) with a few substitutions and a frameshift,
+/// and the same coding sequence without introns
+struct SProSplignFixture
+{
+    SProSplignFixture()
+        : m_Scope(new CScope(*CObjectManager::GetInstance()))
+    {
+        CRandom rnd(2020);
+
+        string protein = "M";
+        for (int i = 1; i < 240; ++i) {
+            protein += kAminoAcids[rnd.GetRand(0, 19)];
+        }
+
+        string cds;
+        ITERATE (string, aa, protein) {
+            cds += s_Codon(*aa);
+        }
+        cds += "TAA";
+        // frameshift in the last exon
+        cds.erase(600, 1);
+
+        // the aligned protein differs from the translation here and there
+        string query = protein;
+        for (size_t i = 5; i < query.size(); i += 23) {
+            query[i] = kAminoAcids[rnd.GetRand(0, 19)];
+        }
+
+        string intron1 = "GTAAGT" + s_RandomNa(rnd, 250) + "TTTCAG";
+        string intron2 = "GTGAGT" + s_RandomNa(rnd, 400) + "CCACAG";
+
+        string genomic = s_RandomNa(rnd, 150) +
+            cds.substr(0, 240) + intron1 +
+            cds.substr(240, 241) + intron2 +
+            cds.substr(481) + s_RandomNa(rnd, 150);
+        string mrna = s_RandomNa(rnd, 60) + cds + s_RandomNa(rnd, 60);
+
+        SExon exon1 = { 0, 150, 240 };
+        SExon exon2 = { 240, exon1.genomic_from + 240 + TSeqPos(intron1.size()), 241 };
+        SExon exon3 = { 481, exon2.genomic_from + 241 + TSeqPos(intron2.size()),
+                        TSeqPos(cds.size()) - 481 };
+        m_Exons.push_back(exon1);
+        m_Exons.push_back(exon2);
+        m_Exons.push_back(exon3);
+
+        m_Protein = s_AddBioseq(*m_Scope, "protein", query, true);
+        m_GenomicId = s_AddBioseq(*m_Scope, "genomic", genomic, false);
+        m_Genomic.Reset(new CSeq_loc);
+        m_Genomic->SetWhole(*m_GenomicId);
+        m_Mrna.Reset(new CSeq_loc);
+        m_Mrna->SetWhole(*s_AddBioseq(*m_Scope, "mrna", mrna, false));
+    }
+
+    CRef<CSeq_align> Align(const CSeq_loc& genomic, int max_back_align_memory,
+                           bool intronless, bool one_stage)
+    {
+        CProSplignScoring scoring;
+        scoring.SetMaxBackAlignMemory(max_back_align_memory);
+        CProSplign prosplign(scoring, intronless, one_stage, false, false);
+        return prosplign.FindGlobalAlignment(*m_Scope, *m_Protein, genomic);
+    }
+
+    /// With zero memory allowance the back alignment is always
+    /// checkpointed, the default allowance keeps the full matrix for
+    /// sequences this small
+    void CheckCheckpointed(const CSeq_loc& genomic,
+                           bool intronless, bool one_stage)
+    {
+        CRef<CSeq_align> full =
+            Align(genomic, CProSplignScoring::default_max_back_align_memory,
+                  intronless, one_stage);
+        CRef<CSeq_align> checkpointed =
+            Align(genomic, 0, intronless, one_stage);
+
+        BOOST_REQUIRE(full  &&  full->GetSegs().IsSpliced());
+        BOOST_CHECK( !full->GetSegs().GetSpliced().GetExons().empty() );
+        BOOST_CHECK(full->Equals(*checkpointed));
+    }
+
+    /// Compartment as made by SelectCompartmentsHits, one hit per exon
+    /// over its whole codons, less trim residues at each end
+    CRef<CSeq_annot> MakeCompartment(TSeqPos trim) const
+    {
+        CRef<CSeq_align> align(new CSeq_align);
+        align->SetType(CSeq_align::eType_partial);
+        ITERATE (vector<SExon>, exon, m_Exons) {
+            TSeqPos pfrom = (exon->cds_from + 2)/3 + trim;
+            TSeqPos pto = (exon->cds_from + exon->len)/3 - 1 - trim;
+            TSeqPos gfrom = exon->genomic_from + pfrom*3 - exon->cds_from;
+            CRef<CStd_seg> seg(new CStd_seg);
+            seg->SetLoc().push_back(CRef<CSeq_loc>(
+                new CSeq_loc(*m_Protein, pfrom, pto, eNa_strand_plus)));
+            seg->SetLoc().push_back(CRef<CSeq_loc>(
+                new CSeq_loc(*m_GenomicId, gfrom, gfrom + (pto - pfrom)*3 + 2,
+                             eNa_strand_plus)));
+            align->SetSegs().SetStd().push_back(seg);
+        }
+        CRef<CSeq_annot> compartment(new CSeq_annot);
+        compartment->SetData().SetAlign().push_back(align);
+        return compartment;
+    }
+
+    struct SExon {
+        TSeqPos cds_from;
+        TSeqPos genomic_from;
+        TSeqPos len;
+    };
+
+    CRef<CScope> m_Scope;
+    CRef<CSeq_id> m_Protein;
+    CRef<CSeq_id> m_GenomicId;
+    CRef<CSeq_loc> m_Genomic;
+    CRef<CSeq_loc> m_Mrna;
+    vector<SExon> m_Exons;
+};
+
+BOOST_FIXTURE_TEST_SUITE(ProSplign, SProSplignFixture)
+
+BOOST_AUTO_TEST_CASE(CheckpointedTwoStage)
+{
+    CheckCheckpointed(*m_Genomic, false, false);
+}
+
+BOOST_AUTO_TEST_CASE(CheckpointedOneStage)
+{
+    CheckCheckpointed(*m_Genomic, false, true);
+}
+
+BOOST_AUTO_TEST_CASE(CheckpointedIntronless)
+{
+    CheckCheckpointed(*m_Mrna, true, false);
+}
+
+/// The exons lie well inside the band, with whole or trimmed hits
+BOOST_AUTO_TEST_CASE(BandedTwoStage)
+{
+    CRef<CSeq_align> full =
+        Align(*m_Genomic, CProSplignScoring::default_max_back_align_memory,
+              false, false);
+    BOOST_REQUIRE(full  &&  full->GetSegs().IsSpliced());
+
+    for (TSeqPos trim = 0; trim <= 10; trim += 10) {
+        CProSplignScoring scoring;
+        scoring.SetBandWidth(10);
+        CProSplign prosplign(scoring);
+        CRef<CSeq_align> banded =
+            prosplign.FindGlobalAlignment(*m_Scope, *m_Protein, *m_Genomic,
+                                          *MakeCompartment(trim));
+        BOOST_CHECK(full->Equals(*banded));
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -35,6 +35,7 @@
 
 #include <corelib/ncbi_system.hpp>
 #include <corelib/ncbifile.hpp>
+#include <corelib/ncbithr.hpp>
 #include <util/random_gen.hpp>
 #include <algo/align/util/compartment_finder.hpp>
 #include <objtools/blast/seqdb_reader/seqdb.hpp>
@@ -87,6 +88,99 @@ namespace {
 
     const Uint8  kSeqDbMemBound           (512 * 1024 * 1024);
     const size_t kMapGran                 (512 * 1024 * 1024);
+
+    // min number of elements per thread when sorting
+    const size_t kMinSortChunk            (1024 * 1024);
+
+    // min number of elementary hits per thread when building them
+    const Uint8  kMinFillChunk            (1024 * 1024);
+
+
+    // Sorts a range (middle == 0) or merges its two sorted halves
+    class CSortThread: public CThread
+    {
+    public:
+        CSortThread(Uint8* begin, Uint8* middle, Uint8* end):
+            m_Begin(begin), m_Middle(middle), m_End(end)
+        {}
+
+    protected:
+        virtual void* Main(void) {
+            if(m_Middle) {
+                inplace_merge(m_Begin, m_Middle, m_End);
+            }
+            else {
+                sort(m_Begin, m_End);
+            }
+            return 0;
+        }
+
+    private:
+        Uint8* m_Begin;
+        Uint8* m_Middle;
+        Uint8* m_End;
+    };
+
+
+    void s_RunThreads(vector<CRef<CSortThread> >& threads)
+    {
+        NON_CONST_ITERATE(vector<CRef<CSortThread> >, ii, threads) {
+            (*ii)->Run();
+        }
+        NON_CONST_ITERATE(vector<CRef<CSortThread> >, ii, threads) {
+            (*ii)->Join();
+        }
+        threads.clear();
+    }
+}
+
+
+// Sort the vector using up to num_threads threads: the chunks
+// are sorted independently, then the neighbors are merged pairwise.
+void CElementaryMatching::s_Sort(vector<Uint8>& v, size_t num_threads,
+                                 size_t min_chunk)
+{
+    const size_t dim (v.size());
+    if(min_chunk > 0 && num_threads > dim / min_chunk) {
+        num_threads = dim / min_chunk;
+    }
+
+    if(num_threads < 2) {
+        sort(v.begin(), v.end());
+        return;
+    }
+
+    Uint8* data (&v.front());
+    vector<size_t> bounds;
+    for(size_t i (0); i <= num_threads; ++i) {
+        bounds.push_back(dim * i / num_threads);
+    }
+
+    vector<CRef<CSortThread> > threads;
+    for(size_t i (0); i + 1 < bounds.size(); ++i) {
+        threads.push_back(CRef<CSortThread>(
+            new CSortThread(data + bounds[i], 0, data + bounds[i+1])));
+    }
+    s_RunThreads(threads);
+
+    while(bounds.size() > 2) {
+
+        vector<size_t> merged;
+        size_t i (0);
+        for(; i + 2 < bounds.size(); i += 2) {
+            threads.push_back(CRef<CSortThread>(
+                new CSortThread(data + bounds[i], data + bounds[i+1],
+                                data + bounds[i+2])));
+            merged.push_back(bounds[i]);
+        }
+        if(i + 1 < bounds.size()) {
+            merged.push_back(bounds[i]);
+        }
+        merged.push_back(dim);
+
+        s_RunThreads(threads);
+        bounds.swap(merged);
+    }
 }
 
 
@@ -1184,7 +1278,7 @@ size_t CElementaryMatching::x_WriteIndexFile(
     Uint4 curmer (numeric_limits<Uint4>::max());
     Uint4 curofs (0);
 
-    sort(MersAndCoords.begin(), MersAndCoords.end());
+    s_Sort(MersAndCoords, m_NumThreads, kMinSortChunk);
     
     ITERATE(vector<Uint8>, ii, MersAndCoords) {
 
@@ -1233,6 +1327,126 @@ size_t CElementaryMatching::x_WriteIndexFile(
 }}
 
 
+Uint8 CElementaryMatching::x_FillHits(const string& filename_hit_index,
+                                      size_t cnt_from, size_t cnt_to,
+                                      const string& filename_pos_q,
+                                      const string& filename_pos_s,
+                                      Uint8* hits)
+{
+    // load position files
+            
+    const CFile  file_pos_s (filename_pos_s);
+    const size_t dim_pos_s (file_pos_s.GetLength() / 4);
+ 
+    CMemoryFile mf_pos_s (filename_pos_s);
+    size_t map_offset_s (0);
+    size_t map_length_s (min(kMapGran, 4*dim_pos_s - map_offset_s));
+    const Uint4 * pos_s (reinterpret_cast<const Uint4*>(
+                                   mf_pos_s.Map(map_offset_s, map_length_s)));
+ 
+    const CFile  file_pos_q (filename_pos_q);
+    const size_t dim_pos_q (file_pos_q.GetLength() / 4);
+ 
+    CMemoryFile mf_pos_q (filename_pos_q);
+    size_t map_offset_q (0);
+    size_t map_length_q (min(kMapGran, 4*dim_pos_q - map_offset_q));
+    const Uint4 * pos_q (reinterpret_cast<const Uint4*>(
+                                   mf_pos_q.Map(map_offset_q, map_length_q)));
+
+    Uint8 hidx (0);
+
+    CNcbiIfstream ifstr (filename_hit_index.c_str(), IOS_BASE::binary);
+    ifstr.seekg(cnt_from * sizeof(SHitIndexEntry));
+    for(size_t cnt(cnt_from); cnt < cnt_to; ++cnt) {
+ 
+        SHitIndexEntry hie;
+        ifstr.read((char*) &hie, sizeof(hie));
+ 
+        const size_t idx_s_max (hie.m_SubjOfs + hie.m_SubjCount);
+        const size_t idx_q_max (hie.m_QueryOfs + hie.m_QueryCount);
+        if(idx_s_max > dim_pos_s || idx_q_max > dim_pos_q) {
+            NCBI_THROW(CException, eUnknown, "Coordinate out of scope");
+        }
+ 
+        if(4*idx_s_max >= map_offset_s + map_length_s) {
+
+            map_offset_s = 4 * hie.m_SubjOfs;
+            map_length_s = min(kMapGran, 4*dim_pos_s - map_offset_s);
+            mf_pos_s.Unmap();
+            pos_s = (reinterpret_cast<const Uint4*>
+                     (mf_pos_s.Map(map_offset_s, map_length_s)));
+        }
+
+        if(4*idx_q_max >= map_offset_q + map_length_q) {
+
+            map_offset_q = 4 * hie.m_QueryOfs;
+            map_length_q = min(kMapGran, 4*dim_pos_q - map_offset_q);
+            mf_pos_q.Unmap();
+            pos_q = (reinterpret_cast<const Uint4*>
+                     (mf_pos_q.Map(map_offset_q, map_length_q)));
+        }
+
+        for(size_t idx_s (hie.m_SubjOfs); idx_s < idx_s_max; ++idx_s) {
+
+            Uint8 hiword = pos_s[idx_s - map_offset_s/4];
+            hiword <<= 32;
+            for(size_t idx_q (hie.m_QueryOfs); idx_q < idx_q_max; ++idx_q) {
+
+                const Uint8 loword = pos_q[idx_q - map_offset_q/4];
+                hits[hidx++] = (hiword | loword);
+            }
+        }
+    }
+
+    return hidx;
+}
+
+
+// Builds the hits of a range of the hit index
+class CElementaryMatching::CFillHitsThread: public CThread
+{
+public:
+    CFillHitsThread(const string& filename_hit_index,
+                    size_t cnt_from, size_t cnt_to,
+                    const string& filename_pos_q,
+                    const string& filename_pos_s,
+                    Uint8* hits):
+        m_FileNameHitIndex(filename_hit_index),
+        m_CntFrom(cnt_from), m_CntTo(cnt_to),
+        m_FileNamePosQ(filename_pos_q), m_FileNamePosS(filename_pos_s),
+        m_Hits(hits), m_Count(0)
+    {}
+
+    Uint8         GetCount(void) const { return m_Count; }
+    const string& GetError(void) const { return m_Error; }
+
+protected:
+    virtual void* Main(void) {
+        try {
+            m_Count = x_FillHits(m_FileNameHitIndex, m_CntFrom, m_CntTo,
+                                 m_FileNamePosQ, m_FileNamePosS, m_Hits);
+        }
+        catch(CException& e) {
+            m_Error = e.GetMsg();
+        }
+        catch(exception& e) {
+            m_Error = e.what();
+        }
+        return 0;
+    }
+
+private:
+    string m_FileNameHitIndex;
+    size_t m_CntFrom;
+    size_t m_CntTo;
+    string m_FileNamePosQ;
+    string m_FileNamePosS;
+    Uint8* m_Hits;
+    Uint8  m_Count;
+    string m_Error;
+};
+
+
 void CElementaryMatching::x_Search(bool strand)
 {
     m_Mers.Clear();
@@ -1267,6 +1481,11 @@ void CElementaryMatching::x_Search(bool strand)
             Uint8 hit_index_dim (0), elem_hits_this_pair (0);
             string filename_hit_index;
 
+            // hit index entries and hits where the chunks built
+            // on separate threads start
+            vector<size_t> chunk_cnt;
+            vector<Uint8>  chunk_hits;
+
             {{
 
             // map offset files
@@ -1317,9 +1536,33 @@ void CElementaryMatching::x_Search(bool strand)
                     ++ofs_s;
                     ++ofs_q;
 
-                    elem_hits_this_pair += elem.m_QueryCount * elem.m_SubjCount;
+                    elem_hits_this_pair += Uint8(elem.m_QueryCount) * elem.m_SubjCount;
+                }
+            }
+
+            // split the hit index into chunks of about the same number of hits
+            size_t num_chunks (m_NumThreads);
+            if(num_chunks > elem_hits_this_pair / kMinFillChunk) {
+                num_chunks = elem_hits_this_pair / kMinFillChunk;
+            }
+            if(num_chunks < 1) {
+                num_chunks = 1;
+            }
+
+            chunk_cnt.push_back(0);
+            chunk_hits.push_back(0);
+            Uint8 hits_before (0);
+            for(size_t i (0); i < hit_index.size(); ++i) {
+                if(chunk_cnt.size() < num_chunks && hits_before > chunk_hits.back()
+                   && hits_before >= elem_hits_this_pair * chunk_cnt.size() / num_chunks)
+                {
+                    chunk_cnt.push_back(i);
+                    chunk_hits.push_back(hits_before);
                 }
+                hits_before += Uint8(hit_index[i].m_QueryCount) * hit_index[i].m_SubjCount;
             }
+            chunk_cnt.push_back(hit_index.size());
+            chunk_hits.push_back(elem_hits_this_pair);
 
             // unload offset files; save hit index
             filename_hit_index = g_SaveToTemp(hit_index, m_FilePath);
@@ -1327,78 +1570,48 @@ void CElementaryMatching::x_Search(bool strand)
             elem_hits_total += elem_hits_this_pair;
             }}
 
-            // load position files
-            
-            const CFile  file_pos_s (filename_pos_s);
-            const size_t dim_pos_s (file_pos_s.GetLength() / 4);
- 
-            CMemoryFile mf_pos_s (filename_pos_s);
-            size_t map_offset_s (0);
-            size_t map_length_s (min(kMapGran, 4*dim_pos_s - map_offset_s));
-            const Uint4 * pos_s (reinterpret_cast<const Uint4*>(
-                                           mf_pos_s.Map(map_offset_s, map_length_s)));
- 
-            const CFile  file_pos_q (filename_pos_q);
-            const size_t dim_pos_q (file_pos_q.GetLength() / 4);
- 
-            CMemoryFile mf_pos_q (filename_pos_q);
-            size_t map_offset_q (0);
-            size_t map_length_q (min(kMapGran, 4*dim_pos_q - map_offset_q));
-            const Uint4 * pos_q (reinterpret_cast<const Uint4*>(
-                                           mf_pos_q.Map(map_offset_q, map_length_q)));
-
             // scan hit index file and build hits
             vector<Uint8> hits (elem_hits_this_pair);
-            size_t hidx (0);
+            Uint8 * const phits (hits.empty()? 0: &hits.front());
 
-            CNcbiIfstream ifstr (filename_hit_index.c_str(), IOS_BASE::binary);
-            for(size_t cnt(0); cnt < hit_index_dim; ++cnt) {
- 
-                SHitIndexEntry hie;
-                ifstr.read((char*) &hie, sizeof(hie));
- 
-                const size_t idx_s_max (hie.m_SubjOfs + hie.m_SubjCount);
-                const size_t idx_q_max (hie.m_QueryOfs + hie.m_QueryCount);
-                if(idx_s_max > dim_pos_s || idx_q_max > dim_pos_q) {
-                    NCBI_THROW(CException, eUnknown, "Coordinate out of scope");
+            vector<Uint8> chunk_hidx (chunk_cnt.size() - 1);
+            if(chunk_hidx.size() == 1) {
+                chunk_hidx[0] = x_FillHits(filename_hit_index, 0, hit_index_dim,
+                                           filename_pos_q, filename_pos_s, phits);
+            }
+            else {
+                vector<CRef<CFillHitsThread> > threads;
+                for(size_t i (0); i < chunk_hidx.size(); ++i) {
+                    threads.push_back(CRef<CFillHitsThread>(
+                        new CFillHitsThread(filename_hit_index,
+                                            chunk_cnt[i], chunk_cnt[i+1],
+                                            filename_pos_q, filename_pos_s,
+                                            phits + chunk_hits[i])));
                 }
- 
-                if(4*idx_s_max >= map_offset_s + map_length_s) {
-
-                    map_offset_s = 4 * hie.m_SubjOfs;
-                    map_length_s = min(kMapGran, 4*dim_pos_s - map_offset_s);
-                    mf_pos_s.Unmap();
-                    pos_s = (reinterpret_cast<const Uint4*>
-                             (mf_pos_s.Map(map_offset_s, map_length_s)));
+                NON_CONST_ITERATE(vector<CRef<CFillHitsThread> >, ii, threads) {
+                    (*ii)->Run();
                 }
-
-                if(4*idx_q_max >= map_offset_q + map_length_q) {
-
-                    map_offset_q = 4 * hie.m_QueryOfs;
-                    map_length_q = min(kMapGran, 4*dim_pos_q - map_offset_q);
-                    mf_pos_q.Unmap();
-                    pos_q = (reinterpret_cast<const Uint4*>
-                             (mf_pos_q.Map(map_offset_q, map_length_q)));
+                NON_CONST_ITERATE(vector<CRef<CFillHitsThread> >, ii, threads) {
+                    (*ii)->Join();
                 }
-
-                for(size_t idx_s (hie.m_SubjOfs); idx_s < idx_s_max; ++idx_s) {
-
-                    Uint8 hiword = pos_s[idx_s - map_offset_s/4];
-                    hiword <<= 32;
-                    for(size_t idx_q (hie.m_QueryOfs); idx_q < idx_q_max; ++idx_q) {
-
-                        const Uint8 loword = pos_q[idx_q - map_offset_q/4];
-                        hits[hidx++] = (hiword | loword);
+                for(size_t i (0); i < threads.size(); ++i) {
+                    if(!threads[i]->GetError().empty()) {
+                        NCBI_THROW(CException, eUnknown, threads[i]->GetError());
                     }
+                    chunk_hidx[i] = threads[i]->GetCount();
                 }
             }
 
-            if(hidx != elem_hits_this_pair) {
-                CNcbiOstrstream ostr;
-                ostr << "The number of hits found (" << hidx 
-                     << ") does not match the expected " << elem_hits_this_pair;
-                const string str = CNcbiOstrstreamToString(ostr);
-                NCBI_THROW(CException, eUnknown, str);
+            for(size_t i (0); i < chunk_hidx.size(); ++i) {
+                const Uint8 hidx (chunk_hidx[i]);
+                const Uint8 expected (chunk_hits[i+1] - chunk_hits[i]);
+                if(hidx != expected) {
+                    CNcbiOstrstream ostr;
+                    ostr << "The number of hits found (" << hidx 
+                         << ") does not match the expected " << expected;
+                    const string str = CNcbiOstrstreamToString(ostr);
+                    NCBI_THROW(CException, eUnknown, str);
+                }
             }
 
             // remove the hit index file
@@ -1472,7 +1685,7 @@ void CElementaryMatching::x_CompartVolume(vector<Uint8>* phits)
     }
 
     // sort by the global genomic corrdinate
-    sort(phits->begin(), phits->end());
+    s_Sort(*phits, m_NumThreads, kMinSortChunk);
 
     TSeqInfos::const_iterator ii_genomic_b (m_SeqInfos_Genomic.begin());
     TSeqInfos::const_iterator ii_genomic_e (m_SeqInfos_Genomic.end());
@@ -2045,6 +2258,7 @@ void CElementaryMatching::x_InitBasic(void)
     m_MinQueryLength = 50;
     m_MaxQueryLength = 500000;
     m_MinHitLength = 1;
+    m_NumThreads = 1;
 }
 
 
@@ -39,4 +39,7 @@ const char g_msg_SequenceNotFound[] = "Could not find the proper sequence";
 const char g_msg_CompartmentInconsistent[] = 
      "Compartment inconsistent upon filtering";
 
+const char g_msg_AlignerCannotBeCopied[] = 
+     "Spliced aligner type cannot be copied for batch processing";
+
 #endif
@@ -41,12 +41,15 @@
 #include <algo/align/util/compartment_finder.hpp>
 #include <algo/align/nw/nw_band_aligner.hpp>
 #include <algo/align/nw/nw_spliced_aligner16.hpp>
+#include <algo/align/nw/nw_spliced_aligner32.hpp>
 #include <algo/align/nw/nw_formatter.hpp>
 #include <algo/align/nw/align_exception.hpp>
 #include <algo/align/splign/splign.hpp>
 
 #include <algo/sequence/orf.hpp>
 
+#include <corelib/ncbithr.hpp>
+
 #include <objmgr/scope.hpp>
 #include <objmgr/bioseq_handle.hpp>
 #include <objmgr/seq_vector.hpp>
@@ -1298,6 +1301,148 @@ void CSplign::Run(THitRefs* phitrefs)
 }
 
 
+namespace {
+
+    CRef<CSplicedAligner> s_CopyAligner(const CSplicedAligner& aligner)
+    {
+        CRef<CSplicedAligner> rv;
+        if(const CSplicedAligner16* a16 =
+           dynamic_cast<const CSplicedAligner16*>(&aligner))
+        {
+            rv.Reset(new CSplicedAligner16(*a16));
+        }
+        else if(const CSplicedAligner32* a32 =
+                dynamic_cast<const CSplicedAligner32*>(&aligner))
+        {
+            rv.Reset(new CSplicedAligner32(*a32));
+        }
+        else {
+            NCBI_THROW(CAlgoAlignException, eBadParameter,
+                       g_msg_AlignerCannotBeCopied);
+        }
+        return rv;
+    }
+
+
+    void s_RunBatchItem(CSplign& splign, CSplign::THitRefs& hitrefs,
+                        CSplign::SBatchResult& result)
+    {
+        try {
+            splign.Run(&hitrefs);
+            result.m_Results = splign.GetResult();
+        }
+        catch(CException& e) {
+            result.m_Results.clear();
+            result.m_Error = e.GetMsg();
+        }
+        catch(exception& e) {
+            result.m_Results.clear();
+            result.m_Error = e.what();
+        }
+    }
+
+
+    // Processes the hit sets of a batch one at a time
+    class CSplignBatchThread: public CThread
+    {
+    public:
+        CSplignBatchThread(CRef<CSplign> splign,
+                           vector<CSplign::THitRefs>& batch,
+                           CSplign::TBatchResults& results,
+                           size_t& next, CFastMutex& next_mutex):
+            m_Splign(splign), m_Batch(batch), m_Results(results),
+            m_Next(next), m_NextMutex(next_mutex)
+        {}
+
+    protected:
+        virtual void* Main(void) {
+            while(true) {
+                size_t i;
+                {{
+                    CFastMutexGuard guard (m_NextMutex);
+                    i = m_Next++;
+                }}
+                if(i >= m_Batch.size()) {
+                    break;
+                }
+                s_RunBatchItem(*m_Splign, m_Batch[i], m_Results[i]);
+            }
+            return 0;
+        }
+
+    private:
+        CRef<CSplign>              m_Splign;
+        vector<CSplign::THitRefs>& m_Batch;
+        CSplign::TBatchResults&    m_Results;
+        size_t&                    m_Next;
+        CFastMutex&                m_NextMutex;
+    };
+}
+
+
+void CSplign::RunBatch(vector<THitRefs>& batch, TBatchResults* results,
+                       size_t num_threads)
+{
+    if(!results) {
+        NCBI_THROW(CAlgoAlignException, eInternal, g_msg_NullPointerPassed);
+    }
+
+    if(m_aligner.IsNull()) {
+        NCBI_THROW(CAlgoAlignException, eNotInitialized, g_msg_AlignedNotSpecified);
+    }
+
+    results->clear();
+    results->resize(batch.size());
+
+    if(num_threads > batch.size()) {
+        num_threads = batch.size();
+    }
+
+    const size_t model_id (m_model_id);
+
+    if(num_threads <= 1) {
+        for(size_t i (0); i < batch.size(); ++i) {
+            s_RunBatchItem(*this, batch[i], (*results)[i]);
+        }
+    }
+    else {
+
+        size_t next (0);
+        CFastMutex next_mutex;
+        vector<CRef<CSplignBatchThread> > threads;
+        for(size_t i (0); i < num_threads; ++i) {
+
+            CRef<CSplign> splign (new CSplign(*this));
+            splign->m_aligner = s_CopyAligner(*m_aligner);
+            splign->m_CanResetHistory = false;
+
+            threads.push_back(CRef<CSplignBatchThread>(
+                new CSplignBatchThread(splign, batch, *results,
+                                       next, next_mutex)));
+        }
+
+        NON_CONST_ITERATE(vector<CRef<CSplignBatchThread> >, ii, threads) {
+            (*ii)->Run();
+        }
+        NON_CONST_ITERATE(vector<CRef<CSplignBatchThread> >, ii, threads) {
+            (*ii)->Join();
+        }
+    }
+
+    // number the models in the input order whatever the number of threads;
+    // a hit set on which Run() threw has no results and takes no ids
+    m_model_id = model_id;
+    NON_CONST_ITERATE(TBatchResults, ii, *results) {
+        NON_CONST_ITERATE(TResults, jj, ii->m_Results) {
+            ++m_model_id;
+            if(jj->m_Id != 0) {
+                jj->m_Id = m_model_id;
+            }
+        }
+    }
+}
+
+
 bool CSplign::AlignSingleCompartment(CRef<objects::CSeq_align> compartment,
                                      SAlignedCompartment* result)
 {
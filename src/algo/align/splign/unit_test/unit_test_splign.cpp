@@ -53,6 +53,9 @@
 
 #include <algo/align/splign/splign.hpp>
 #include <algo/align/splign/splign_formatter.hpp>
+#include <algo/align/splign/compart_matching.hpp>
+
+#include <util/random_gen.hpp>
 
 USING_NCBI_SCOPE;
 USING_SCOPE(objects);
@@ -201,6 +204,7 @@ BOOST_AUTO_TEST_CASE(TestUsingArg)
 
                 typedef map<pair<CSeq_id_Handle, CSeq_id_Handle>, CSplign::THitRefs> TAllHits;
                 TAllHits one_seq_annot_hits_in;            
+                TAllHits batch_hits_in; // same hits, to run in a batch
                  
                 CRef<CSeq_align_set> splign_out(new CSeq_align_set);
                 
@@ -211,8 +215,12 @@ BOOST_AUTO_TEST_CASE(TestUsingArg)
                     CSeq_id_Handle idh1 = CSeq_id_Handle::GetHandle(*query_id);
                     CSeq_id_Handle idh2 = CSeq_id_Handle::GetHandle(*subj_id);
                     one_seq_annot_hits_in[make_pair(idh1, idh2)].push_back(tr);
+                    batch_hits_in[make_pair(idh1, idh2)].push_back(
+                        CSplign::THitRef(new CBlastTabular(**AlignIter)));
                 }
 
+                const size_t model_id0 (splign.GetNextModelId());
+
                 //iterate by query/subject pair
 
            /* DEBUG OUTPUT 
@@ -246,6 +254,44 @@ BOOST_AUTO_TEST_CASE(TestUsingArg)
                     CNcbiOstream& ostr = args["mrna-out"].AsOutputFile();                                       
                     ostr << MSerial_AsnText << *splign_out;                        
                 }
+
+                //CHECK IF BATCH RESULT IS THE SAME AS SEQUENTIAL
+
+                //(an empty hit set in the middle makes Run() throw)
+
+                const size_t model_id1 (splign.GetNextModelId());
+                const size_t kBatchThreads[] = { 1, 4 };
+                for(size_t t = 0; t < sizeof(kBatchThreads)/sizeof(kBatchThreads[0]); ++t) {
+                    vector<CSplign::THitRefs> batch;
+                    ITERATE(TAllHits, qsit, batch_hits_in) {
+                        batch.push_back(CSplign::THitRefs());
+                        ITERATE(CSplign::THitRefs, hit, qsit->second) {
+                            batch.back().push_back(CSplign::THitRef(new CBlastTabular(**hit)));
+                        }
+                    }
+                    const size_t empty_pos (batch.size() / 2);
+                    batch.insert(batch.begin() + empty_pos, CSplign::THitRefs());
+
+                    splign.SetStartModelId(model_id0);
+                    CSplign::TBatchResults batch_results;
+                    splign.RunBatch(batch, &batch_results, kBatchThreads[t]);
+                    BOOST_CHECK_EQUAL(splign.GetNextModelId(), model_id1);
+                    BOOST_REQUIRE_EQUAL(batch_results.size(), batch.size());
+                    BOOST_CHECK(!batch_results[empty_pos].m_Error.empty());
+                    BOOST_CHECK(batch_results[empty_pos].m_Results.empty());
+                    batch_results.erase(batch_results.begin() + empty_pos);
+
+                    CRef<CSeq_align_set> batch_out(new CSeq_align_set);
+                    size_t i = 0;
+                    ITERATE(TAllHits, qsit, batch_hits_in) {
+                        const CSplign::SBatchResult& res (batch_results[i++]);
+                        BOOST_CHECK(res.m_Error.empty());
+                        sf.SetSeqIds(qsit->first.first.GetSeqId(), qsit->first.second.GetSeqId());
+                        CRef<CSeq_align_set> sas (sf.AsSeqAlignSet(&res.m_Results, CSplignFormatter::eAF_SplicedSegWithParts));
+                        batch_out->Set().insert(batch_out->Set().end(), sas->Get().begin(), sas->Get().end());
+                    }
+                    BOOST_CHECK ( batch_out->Equals(*splign_out) );
+                }
                 
                 //CHECK IF SPLIGN RESULT IS THE SAME AS EXPECTED    
 
@@ -365,12 +411,33 @@ if(! splign_out->Equals(*expected_out) ) {
         }
         /*END of EST*/
     }
-}                              
-
-
-
-
-
-
+}
 
 
+BOOST_AUTO_TEST_CASE(TestMultiThreadedSort)
+{
+    // small chunks, so that all thread counts, including the odd ones
+    // with an unmerged last chunk, are used
+    const size_t kMinChunk (16);
+    const size_t kSizes[] = { 0, 1, 15, 16, 33, 100, 1000, 4099 };
+    const size_t kThreads[] = { 1, 2, 3, 4, 5, 7, 8 };
+
+    CRandom rnd (1);
+    for(size_t i = 0; i < sizeof(kSizes)/sizeof(kSizes[0]); ++i) {
+
+        vector<Uint8> v (kSizes[i]);
+        NON_CONST_ITERATE(vector<Uint8>, ii, v) {
+            // few distinct low words to have equal keys
+            *ii = (Uint8(rnd.GetRand()) << 32) | rnd.GetRand(0, 7);
+        }
+        vector<Uint8> expected (v);
+        sort(expected.begin(), expected.end());
+
+        for(size_t j = 0; j < sizeof(kThreads)/sizeof(kThreads[0]); ++j) {
+            vector<Uint8> sorted (v);
+            CElementaryMatching::s_Sort(sorted, kThreads[j], kMinChunk);
+            BOOST_CHECK_MESSAGE(sorted == expected,
+                                "size " << kSizes[i] << ", threads " << kThreads[j]);
+        }
+    }
+}
@@ -624,6 +624,43 @@ static void IndexedDbSetQueryInfo(
     idb->SetQueryInfo( locs_wrap );
 }
 
+//------------------------------------------------------------------------------
+/// Check whether index volumes should be paged in completely when loaded.
+/// Index volumes are memory mapped and paged in on demand unless the
+/// BLASTDB_INDEX_PRELOAD environment variable is set to a non-zero value.
+/// @return true if index volumes should be preloaded
+static bool s_PreloadIndex( void )
+{
+    const char * value = getenv( "BLASTDB_INDEX_PRELOAD" );
+    return value != 0 && *value != 0 && string( value ) != "0";
+}
+
+//------------------------------------------------------------------------------
+/// Load an index volume and report its memory usage.
+/// @param name index volume name
+/// @return the loaded index volume
+static CRef< CDbIndex > s_LoadIndexVolume( const string & name )
+{
+    CRef< CDbIndex > result( CDbIndex::Load( name, false, s_PreloadIndex() ) );
+
+    if( result != 0 ) {
+        CDbIndex::SMemoryStats stats( result->GetMemoryStats() );
+
+        if( stats.resident_known ) {
+            ERR_POST( Info << "index volume " << name << ": " 
+                           << stats.mapped << " bytes mapped, " 
+                           << stats.resident << " bytes resident" );
+        }
+        else {
+            ERR_POST( Info << "index volume " << name << ": " 
+                           << stats.mapped << " bytes mapped, "
+                           "resident size unknown" );
+        }
+    }
+
+    return result;
+}
+
 //------------------------------------------------------------------------------
 void CIndexedDb_New::ParseDBNames( 
         const std::string db_spec, TStrVec & db_names )
@@ -829,7 +866,7 @@ void CIndexedDb_New::UpdateIndex( Int4 oid, Int4 * vol_idx_p )
         res.ref_count += n_threads_;
         IDX_TRACE( "loading volume "  << new_vol_idx << ": " << vi->name );
         ASSERT( vi->has_index );
-        CRef< CDbIndex > index( CDbIndex::Load( vi->name ) );
+        CRef< CDbIndex > index( s_LoadIndexVolume( vi->name ) );
         
         if( index == 0 ) {
             std::ostringstream os;
@@ -1027,7 +1064,7 @@ void CIndexedDb_Old::PreSearch(
         CRef< CDbIndex > index;
         string result;
 
-        try { index = CDbIndex::Load( index_names_[v] ); }
+        try { index = s_LoadIndexVolume( index_names_[v] ); }
         catch( CException & e ) { result = e.what(); }
 
         if( index == 0 ) { 
@@ -91,6 +91,28 @@ BLASTUngappedHspListToSeqAlign(EBlastProgramType program,
                                const vector<string> & seqid_list,
                                vector<CRef<CSeq_align > > & sa_vector);
 
+/// Convert the traceback output for a single query of a database search
+/// into a Seq-align-set.
+/// @param hit_list Results of the traceback for this query, may be NULL [in]
+/// @param prog The type of search done [in]
+/// @param query_loc The query Seq-loc [in]
+/// @param query_length Length of the query [in]
+/// @param seqinfo_src Provides sequence identifiers and meta-data [in]
+/// @param is_gapped True if this was a gapped search [in]
+/// @param is_ooframe True if out-of-frame matches are allowed [in]
+/// @param subj_masks Populated with the subject masks that intersect the
+/// HSPs [in|out]
+/// @return Seq-align-set with one discontinuous Seq-align per subject
+CRef<CSeq_align_set>
+BlastHitList2SeqAlign_OMF(const BlastHitList     * hit_list,
+                          EBlastProgramType        prog,
+                          const CSeq_loc         & query_loc,
+                          TSeqPos                  query_length,
+                          const IBlastSeqInfoSrc * seqinfo_src,
+                          bool                     is_gapped,
+                          bool                     is_ooframe,
+                          TSeqLocInfoVector      & subj_masks);
+
 /// Convert traceback output into Seq-align format.
 /// 
 /// This converts the traceback stage output into a standard
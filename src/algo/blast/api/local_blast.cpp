@@ -39,6 +39,12 @@
 #include <objects/scoremat/PssmWithParameters.hpp>
 #include <algo/blast/api/seqinfosrc_seqdb.hpp>
 #include <algo/blast/api/blast_dbindex.hpp>
+#include <algo/blast/core/blast_extend.h>
+#include <corelib/ncbi_system.hpp>
+
+#ifdef NCBI_OS_UNIX
+#  include <unistd.h>
+#endif
 
 /** @addtogroup AlgoBlast
  *
@@ -49,14 +55,232 @@ BEGIN_NCBI_SCOPE
 USING_SCOPE(objects);
 BEGIN_SCOPE(blast)
 
+const char* kAdaptiveQuerySize = "auto";
+
+/// Read a size from a cgroup or sysfs file, e.g. "1073741824" or "32768K"
+/// @param path Name of the file [in]
+/// @param value The size, in bytes [out]
+/// @return false if the file could not be read or holds no limit ("max")
+static bool
+s_ReadSizeFromFile(const string& path, Uint8& value)
+{
+    CNcbiIfstream in(path.c_str());
+    string token;
+    if ( !in || !(in >> token) || token.empty() ) {
+        return false;
+    }
+    Uint8 multiplier = 1;
+    switch (token[token.size() - 1]) {
+    case 'K': multiplier = 1024; break;
+    case 'M': multiplier = 1024 * 1024; break;
+    case 'G': multiplier = 1024 * 1024 * 1024; break;
+    default: break;
+    }
+    if (multiplier > 1) {
+        token.erase(token.size() - 1);
+    }
+    value = NStr::StringToUInt8(token, NStr::fConvErr_NoThrow);
+    value *= multiplier;
+    return value > 0;
+}
+
+/// Find the memory limit and usage of the cgroup this process runs in
+/// @param limit Memory limit of the cgroup, in bytes [out]
+/// @param usage Memory used by the cgroup, in bytes [out]
+/// @return false if there is no cgroup memory limit
+static bool
+s_GetCgroupMemory(Uint8& limit, Uint8& usage)
+{
+#ifdef NCBI_OS_LINUX
+    // Paths of this process' cgroups, from lines such as "0::/user.slice"
+    // (cgroup v2) or "4:memory:/user.slice" (cgroup v1)
+    string v2_path, v1_path;
+    CNcbiIfstream proc("/proc/self/cgroup");
+    string line;
+    while (NcbiGetlineEOL(proc, line)) {
+        vector<string> fields;
+        NStr::Split(line, ":", fields);
+        if (fields.size() < 3) {
+            continue;
+        }
+        if (fields[0] == "0" && fields[1].empty()) {
+            v2_path = fields[2];
+        } else {
+            vector<string> controllers;
+            NStr::Split(fields[1], ",", controllers);
+            if (find(controllers.begin(), controllers.end(), "memory") !=
+                controllers.end()) {
+                v1_path = fields[2];
+            }
+        }
+    }
+
+    // Inside a container the cgroup is usually mounted at its root, so the
+    // root files are tried as well
+    const string kV2Root("/sys/fs/cgroup");
+    const string kV1Root("/sys/fs/cgroup/memory");
+    const string kDirs[] = {
+        kV2Root + v2_path, kV2Root, kV1Root + v1_path, kV1Root
+    };
+    const char* kLimitFiles[] = {
+        "/memory.max", "/memory.max",
+        "/memory.limit_in_bytes", "/memory.limit_in_bytes"
+    };
+    const char* kUsageFiles[] = {
+        "/memory.current", "/memory.current",
+        "/memory.usage_in_bytes", "/memory.usage_in_bytes"
+    };
+    for (size_t i = 0; i < ArraySize(kDirs); i++) {
+        if (s_ReadSizeFromFile(kDirs[i] + kLimitFiles[i], limit)) {
+            if ( !s_ReadSizeFromFile(kDirs[i] + kUsageFiles[i], usage) ) {
+                usage = 0;
+            }
+            return true;
+        }
+    }
+#endif
+    limit = usage = 0;
+    return false;
+}
+
+/// Size of the last level cache, in bytes
+static Uint8
+s_GetCacheSize(void)
+{
+    Uint8 retval = 0;
+#if defined(NCBI_OS_UNIX) && defined(_SC_LEVEL3_CACHE_SIZE)
+    long l3 = sysconf(_SC_LEVEL3_CACHE_SIZE);
+    if (l3 > 0) {
+        retval = l3;
+    }
+#endif
+#ifdef NCBI_OS_LINUX
+    if (retval == 0) {
+        s_ReadSizeFromFile("/sys/devices/system/cpu/cpu0/cache/index3/size",
+                           retval);
+    }
+#endif
+    // Conservative default if the cache size cannot be determined
+    return retval > 0 ? retval : 8 * 1024 * 1024;
+}
+
+SBlastMemoryLimits
+SBlastMemoryLimits::Measure(void)
+{
+    SBlastMemoryLimits retval;
+    const Uint8 kTotal = CSystemInfo::GetTotalPhysicalMemorySize();
+    retval.available_memory = CSystemInfo::GetAvailPhysicalMemorySize();
+    if (retval.available_memory == 0) {
+        retval.available_memory = kTotal;
+    }
+
+    // cgroup v1 reports a huge number when there is no limit
+    Uint8 limit = 0, usage = 0;
+    if (s_GetCgroupMemory(limit, usage) && (kTotal == 0 || limit < kTotal)) {
+        const Uint8 kCgroupAvail = limit > usage ? limit - usage : 0;
+        if (retval.available_memory == 0 ||
+            kCgroupAvail < retval.available_memory) {
+            retval.available_memory = kCgroupAvail;
+        }
+    }
+    retval.cache_size = s_GetCacheSize();
+    return retval;
+}
+
+/// Are the per-letter protein lookup table costs in GetAdaptiveQuerySize
+/// valid for this search?  They were measured with BLOSUM62, word size 3
+/// and threshold 11; the number of neighboring words, and so the table
+/// size, changes quickly with any of these, and with a PSSM.
+static bool
+s_AaLookupCostsApply(const CBlastOptions* options)
+{
+    if (options == NULL) {
+        return false;
+    }
+    const char* matrix = options->GetMatrixName();
+    return options->GetLookupTableType() == eAaLookupTable &&
+        !Blast_QueryIsPssm(options->GetProgramType()) &&
+        matrix != NULL && NStr::EqualNocase(matrix, BLAST_DEFAULT_MATRIX) &&
+        options->GetWordSize() == BLAST_WORDSIZE_PROT &&
+        options->GetWordThreshold() == BLAST_WORD_THRESHOLD_BLASTP;
+}
+
 size_t
-SplitQuery_GetChunkSize(EProgram program)
+GetAdaptiveQuerySize(EProgram program, size_t default_size,
+                     const SBlastMemoryLimits& limits,
+                     const CBlastOptions* options /* = NULL */)
+{
+    // A size of 1 disables query splitting (e.g.: vecscreen)
+    if (default_size <= 1) {
+        return default_size;
+    }
+
+    // Bytes per query letter of the query-dependent part of the lookup
+    // table, which is read for every subject word, and of the search as a
+    // whole.
+    //
+    // Nucleotide tables keep one Int4 query offset per position on each
+    // strand.  Protein tables keep one Int4 for every neighboring word of
+    // a query word; with BLOSUM62, word size 3 and threshold 11 there are
+    // kAaNeighborsPerLetter of them per query letter, and protein tables
+    // built with other settings keep the fixed size.  While a protein
+    // table is built the offsets are also held in growable per-word
+    // lists, and the table then peaks at kAaLookupBuildBytes per letter.
+    // Both constants were measured with LookupTableWrapInit on random
+    // 10^5 and 10^6 letter queries with background residue frequencies;
+    // nucleotide tables measured the predicted 8 bytes per base.
+    //
+    // Besides the lookup table, the search holds the query (one byte per
+    // letter, twice if masked) and a diagonal array of up to twice the
+    // query length.
+    const Uint8 kAaNeighborsPerLetter = 34;
+    const Uint8 kAaLookupBuildBytes = 330;
+    const Uint8 kQueryBytes = 2;
+    const Uint8 kDiagBytes = 2 * sizeof(DiagStruct);
+
+    const EBlastProgramType prog_type(EProgramToEBlastProgramType(program));
+    const bool kTranslated = Blast_QueryIsTranslated(prog_type) ? true : false;
+    Uint8 lookup_bytes, search_bytes;
+    if (Blast_QueryIsNucleotide(prog_type) && !kTranslated) {
+        lookup_bytes = NUM_STRANDS * sizeof(Int4);
+        search_bytes = lookup_bytes + NUM_STRANDS * (kQueryBytes + kDiagBytes);
+    } else {
+        if ( !s_AaLookupCostsApply(options) ) {
+            return default_size;
+        }
+        // each nucleotide contributes two letters to the six frames
+        const Uint8 kLetters = kTranslated ? NUM_FRAMES / CODON_LENGTH : 1;
+        lookup_bytes = kLetters * kAaNeighborsPerLetter * sizeof(Int4);
+        search_bytes =
+            kLetters * (kAaLookupBuildBytes + kQueryBytes + kDiagBytes);
+    }
+
+    // Half of the cache is left for subject data; a quarter of the memory
+    // is left to each of the database, the formatter and other threads.
+    const Uint8 kMaxScale = 4;
+    const Uint8 kMinSize = 1000;
+    Uint8 retval = (limits.cache_size / 2) / lookup_bytes;
+    retval = max(retval, (Uint8)default_size / kMaxScale);
+    retval = min(retval, (Uint8)default_size * kMaxScale);
+    retval = min(retval, (limits.available_memory / 4) / search_bytes);
+    retval = max(retval, kMinSize);
+    if (kTranslated) {
+        retval -= retval % CODON_LENGTH;
+    }
+    return (size_t)retval;
+}
+
+size_t
+SplitQuery_GetChunkSize(EProgram program,
+                        const CBlastOptions* options /* = NULL */)
 {
     size_t retval = 0;
 
     // used for experimentation purposes
     char* chunk_sz_str = getenv("CHUNK_SIZE");
-    if (chunk_sz_str && !NStr::IsBlank(chunk_sz_str)) {
+    const bool kAdaptive = 
+        chunk_sz_str && NStr::EqualNocase(chunk_sz_str, kAdaptiveQuerySize);
+    if (chunk_sz_str && !NStr::IsBlank(chunk_sz_str) && !kAdaptive) {
         retval = NStr::StringToInt(chunk_sz_str);
         _TRACE("Using query chunk size from environment " << retval);
     } else {
@@ -92,6 +316,17 @@ SplitQuery_GetChunkSize(EProgram program)
             retval = 10000;
             break;
         }
+
+        if (kAdaptive) {
+            const SBlastMemoryLimits kLimits = SBlastMemoryLimits::Measure();
+            const size_t kDefaultSize = retval;
+            retval = GetAdaptiveQuerySize(program, retval, kLimits, options);
+            LOG_POST(Info << "Adaptive query chunk size for "
+                     << EProgramToTaskName(program) << ": " << retval
+                     << " (default " << kDefaultSize << ", available memory "
+                     << kLimits.available_memory << " bytes, cache "
+                     << kLimits.cache_size << " bytes)");
+        }
     }
 
     const EBlastProgramType prog_type(EProgramToEBlastProgramType(program));
@@ -223,6 +458,39 @@ CLocalBlast::Run()
          return result_set;
     }
     
+    x_RunPreliminarySearch();
+    CRef<CSearchResultSet> retval = m_TbackSearch->Run();
+    retval->SetFilteredQueryRegions(m_PrelimSearch->GetFilteredQueryRegions());
+    m_Messages = m_TbackSearch->GetSearchMessages();
+
+    return retval;
+}
+
+void
+CLocalBlast::Run(ISearchResultsSink& sink)
+{
+    _ASSERT(m_QueryFactory);
+    _ASSERT(m_PrelimSearch);
+    _ASSERT(m_Opts);
+
+    if (m_PrelimSearch->CheckInternalData() != 0) {
+        // Search is not run, Run() builds the empty results
+        CRef<CSearchResultSet> results = Run();
+        ITERATE(CSearchResultSet, result, *results) {
+            sink.Put(*result);
+        }
+        sink.Finish();
+        return;
+    }
+
+    x_RunPreliminarySearch();
+    m_TbackSearch->Run(sink, m_PrelimSearch->GetFilteredQueryRegions());
+    m_Messages = m_TbackSearch->GetSearchMessages();
+}
+
+void
+CLocalBlast::x_RunPreliminarySearch()
+{
 	try {
 	    m_PrelimSearch->SetNumberOfThreads(GetNumberOfThreads());
 	    m_InternalData = m_PrelimSearch->Run();
@@ -268,11 +536,6 @@ CLocalBlast::Run()
         m_TbackSearch->SetResultType(eSequenceComparison);
     }
     m_TbackSearch->SetNumberOfThreads(GetNumberOfThreads());
-    CRef<CSearchResultSet> retval = m_TbackSearch->Run();
-    retval->SetFilteredQueryRegions(m_PrelimSearch->GetFilteredQueryRegions());
-    m_Messages = m_TbackSearch->GetSearchMessages();
-
-    return retval;
 }
 
 Int4 CLocalBlast::GetNumExtensions()
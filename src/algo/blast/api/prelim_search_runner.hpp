@@ -41,6 +41,7 @@
  */
 
 #include <corelib/ncbithr.hpp>                  // for CThread
+#include <corelib/ncbitime.hpp>                 // for CStopWatch
 #include <algo/blast/api/setup_factory.hpp>
 #include "blast_memento_priv.hpp"
 
@@ -55,8 +56,10 @@ class CPrelimSearchRunner : public CObject
 {
 public:
     CPrelimSearchRunner(SInternalData& internal_data,
-                        const CBlastOptionsMemento* opts_memento)
-        : m_InternalData(internal_data), m_OptsMemento(opts_memento)
+                        const CBlastOptionsMemento* opts_memento,
+                        BlastSubjectSplitQueue* split_queue = NULL)
+        : m_InternalData(internal_data), m_OptsMemento(opts_memento),
+          m_SplitQueue(split_queue)
     {}
     ~CPrelimSearchRunner() {}
     int operator()() {
@@ -68,7 +71,7 @@ public:
         _ASSERT(m_InternalData.m_LookupTable);
         _ASSERT(m_InternalData.m_HspStream);
         SBlastProgressReset(m_InternalData.m_ProgressMonitor->Get());
-        Int2 retval = Blast_RunPreliminarySearchWithInterrupt(m_OptsMemento->m_ProgramType,
+        Int2 retval = Blast_RunPreliminarySearchWithSplitQueue(m_OptsMemento->m_ProgramType,
                                  m_InternalData.m_Queries,
                                  m_InternalData.m_QueryInfo,
                                  m_InternalData.m_SeqSrc->GetPointer(),
@@ -84,7 +87,8 @@ public:
                                  m_InternalData.m_HspStream->GetPointer(),
                                  m_InternalData.m_Diagnostics->GetPointer(),
                                  m_InternalData.m_FnInterrupt,
-                                 m_InternalData.m_ProgressMonitor->Get());
+                                 m_InternalData.m_ProgressMonitor->Get(),
+                                 m_SplitQueue);
 
         return static_cast<int>(retval);
     }
@@ -97,6 +101,9 @@ private:
     /// Pointer to memento which this class doesn't own
     const CBlastOptionsMemento* m_OptsMemento;
 
+    /// Queue for sharing long subjects with the other search threads, not
+    /// owned by this class; NULL if the search is single-threaded
+    BlastSubjectSplitQueue* m_SplitQueue;
 
     /// Prohibit copy constructor
     CPrelimSearchRunner(const CPrelimSearchRunner& rhs);
@@ -109,8 +116,10 @@ class CPrelimSearchThread : public CThread
 {
 public:
     CPrelimSearchThread(SInternalData& internal_data,
-                        const CBlastOptionsMemento* opts_memento)
-        : m_InternalData(internal_data), m_OptsMemento(opts_memento)
+                        const CBlastOptionsMemento* opts_memento,
+                        BlastSubjectSplitQueue* split_queue = NULL)
+        : m_InternalData(internal_data), m_OptsMemento(opts_memento),
+          m_SplitQueue(split_queue), m_BusyTime(0.0)
     {
         // The following fields need to be copied to ensure MT-safety
         BlastSeqSrc* seqsrc =
@@ -128,6 +137,21 @@ public:
         BlastQueryInfo* queryInfo =
                 BlastQueryInfoDup(m_InternalData.m_QueryInfo);
         m_InternalData.m_QueryInfo = queryInfo;
+        // Each thread reports to its own diagnostics structure, so that the
+        // launcher can attribute the work to threads once they are joined
+        m_InternalData.m_Diagnostics.Reset
+            (new TBlastDiagnostics(Blast_DiagnosticsInit(),
+                                   Blast_DiagnosticsFree));
+    }
+
+    /// Wall clock time in seconds this thread spent searching; only
+    /// meaningful after the thread has been joined
+    double GetBusyTime() const { return m_BusyTime; }
+
+    /// Diagnostics collected by this thread; only complete after the
+    /// thread has been joined
+    BlastDiagnostics* GetDiagnostics() {
+        return m_InternalData.m_Diagnostics->GetPointer();
     }
 
 protected:
@@ -136,13 +160,21 @@ protected:
     }
 
     virtual void* Main(void) {
-        return (void*)
-            ((intptr_t) CPrelimSearchRunner(m_InternalData, m_OptsMemento)());
+        CStopWatch sw(CStopWatch::eStart);
+        intptr_t retval =
+            CPrelimSearchRunner(m_InternalData, m_OptsMemento,
+                                m_SplitQueue)();
+        m_BusyTime = sw.Elapsed();
+        return (void*) retval;
     }
 
 private:
     SInternalData m_InternalData;
     const CBlastOptionsMemento* m_OptsMemento;
+    /// Queue shared with the other threads, owned by the launcher
+    BlastSubjectSplitQueue* m_SplitQueue;
+    /// Time spent in the preliminary search, see GetBusyTime()
+    double m_BusyTime;
 };
 
 END_SCOPE(blast)
@@ -57,7 +57,66 @@ BEGIN_NCBI_SCOPE
 USING_SCOPE(objects);
 BEGIN_SCOPE(blast)
 
+/// Mutex of the subject split queue, with the condition variable on which
+/// a thread sleeps while other threads search the chunks of its subject
+struct SSplitQueueSync {
+    CFastMutex         mutex;
+    CConditionVariable cond;
+};
 
+extern "C" {
+
+/** Locking callback for the subject split queue. */
+static int s_SplitQueueLockHandler(void* user_data, EMT_Lock how)
+{
+    SSplitQueueSync* sync = (SSplitQueueSync*) user_data;
+
+    switch ( how ) {
+    case eMT_Lock:
+        sync->mutex.Lock();
+        break;
+    case eMT_Unlock:
+        sync->mutex.Unlock();
+        break;
+    default:
+        break;
+    }
+
+    return 1;
+}
+
+/** Cleanup callback for the subject split queue. */
+static void s_SplitQueueLockCleanup(void* user_data)
+{
+    delete (SSplitQueueSync*) user_data;
+}
+
+/** Sleeps with the queue lock released until s_SplitQueueSignal. */
+static void s_SplitQueueWait(void* data)
+{
+    SSplitQueueSync* sync = (SSplitQueueSync*) data;
+    sync->cond.WaitForSignal(sync->mutex);
+}
+
+/** Wakes all threads sleeping in s_SplitQueueWait. */
+static void s_SplitQueueSignal(void* data)
+{
+    SSplitQueueSync* sync = (SSplitQueueSync*) data;
+    sync->cond.SignalAll();
+}
+
+}
+
+/// Creates the queue through which the preliminary search threads share
+/// the chunks of long subjects
+static BlastSubjectSplitQueue* s_SubjectSplitQueueNew()
+{
+    SSplitQueueSync* sync = new SSplitQueueSync;
+    MT_LOCK lock = MT_LOCK_Create((void*)sync, s_SplitQueueLockHandler,
+                                  s_SplitQueueLockCleanup);
+    return BlastSubjectSplitQueueNew(lock, s_SplitQueueWait,
+                                     s_SplitQueueSignal, sync);
+}
 
 CBlastPrelimSearch::CBlastPrelimSearch(CRef<IQueryFactory> query_factory,
                                        CRef<CBlastOptions> options,
@@ -153,10 +212,21 @@ CBlastPrelimSearch::x_LaunchMultiThreadedSearch(SInternalData& internal_data)
     BlastSeqSrcSetNumberOfThreads(m_InternalData->m_SeqSrc->GetPointer(),
                                   GetNumberOfThreads());
 
+    // Subjects longer than one chunk are searched by all threads together
+    unique_ptr<BlastSubjectSplitQueue,
+               BlastSubjectSplitQueue* (*)(BlastSubjectSplitQueue*)>
+        split_queue(s_SubjectSplitQueueNew(),
+                    BlastSubjectSplitQueueFree);
+    if ( !split_queue ) {
+        NCBI_THROW(CBlastSystemException, eOutOfMemory,
+                   "Failed to allocate the subject split queue");
+    }
+
     // Create the threads ...
     NON_CONST_ITERATE(TBlastThreads, thread, the_threads) {
         thread->Reset(new CPrelimSearchThread(internal_data,
-                                              opts_memento.get()));
+                                              opts_memento.get(),
+                                              split_queue.get()));
         if (thread->Empty()) {
             NCBI_THROW(CBlastSystemException, eOutOfMemory,
                        "Failed to create preliminary search thread");
@@ -175,6 +245,7 @@ CBlastPrelimSearch::x_LaunchMultiThreadedSearch(SInternalData& internal_data)
 
     // ... and wait for the threads to finish
     Uint8 retv(0);
+    double max_busy_time = 0.0;
     NON_CONST_ITERATE(TBlastThreads, thread, the_threads) {
         void * result(0);
         (*thread)->Join(&result);
@@ -183,6 +254,38 @@ CBlastPrelimSearch::x_LaunchMultiThreadedSearch(SInternalData& internal_data)
         	//  retruning an int
             retv = reinterpret_cast<Uint8> (result);
         }
+        max_busy_time = max(max_busy_time, (*thread)->GetBusyTime());
+    }
+
+    // Each thread sits idle from the moment it runs out of subjects until
+    // the slowest thread is done.  The threads' diagnostics are merged in
+    // launch order, so the per-thread entries line up with the threads.
+    BlastDiagnostics* diags = internal_data.m_Diagnostics->GetPointer();
+    const Int4 first_load = (diags && diags->thread_stat)
+        ? diags->thread_stat->num_threads : 0;
+    NON_CONST_ITERATE(TBlastThreads, thread, the_threads) {
+        const double kBusyTime = (*thread)->GetBusyTime();
+        BlastDiagnostics* thread_diags = (*thread)->GetDiagnostics();
+        Blast_DiagnosticsUpdateThreadTimes(thread_diags, kBusyTime,
+                                           max_busy_time - kBusyTime);
+        if (diags) {
+            Blast_DiagnosticsUpdate(diags, thread_diags);
+        }
+    }
+    if (diags && diags->thread_stat) {
+        const BlastThreadStats* thread_stat = diags->thread_stat;
+        CNcbiOstrstream os;
+        os << "Preliminary search threads: busy "
+           << thread_stat->busy_time << "s, idle "
+           << thread_stat->idle_time << "s";
+        for (Int4 i = first_load; i < thread_stat->num_threads; i++) {
+            const BlastThreadLoad& load = thread_stat->loads[i];
+            os << "\n  thread " << i - first_load << ": "
+               << load.num_subjects << " subjects, "
+               << load.num_residues << " residues, busy "
+               << load.busy_time << "s, idle " << load.idle_time << "s";
+        }
+        ERR_POST(Info << (string)CNcbiOstrstreamToString(os));
     }
 
     BlastSeqSrcSetNumberOfThreads(m_InternalData->m_SeqSrc->GetPointer(), 0);
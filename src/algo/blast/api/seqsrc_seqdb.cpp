@@ -493,6 +493,10 @@ s_SeqDbGetNextChunk(void* seqdb_handle, BlastSeqSrcIterator* itr)
             itr->chunk_sz = new_sz;
             for (index = 0; index < new_sz; ++index)
                 itr->oid_list[index] = oid_list[index];
+            // A filtered OID list is scattered over the volume, so the
+            // kernel's sequential readahead does not help; ask for the
+            // chunk's pages up front instead.
+            seqdb.PrefetchSequences(oid_list);
         } else {
             return s_SeqDbGetNextChunk(seqdb_handle, itr);
         }
@@ -718,6 +722,10 @@ s_SeqDbSrcNew(BlastSeqSrc* retval, void* args)
         datap->seqdb->SetIterationRange(seqdb_args->GetFirstOid(),
                                         seqdb_args->GetFinalOid());
 
+        // This object is private to the sequence source and never
+        // written, so sequence retrieval can skip the atlas lock.
+        datap->seqdb->SetImmutableMode();
+
         datap->mask_algo_id = seqdb_args->GetMaskAlgoId();
         datap->mask_type = seqdb_args->GetMaskType();
         datap->isProtein = is_protein;
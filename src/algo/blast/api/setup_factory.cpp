@@ -38,6 +38,10 @@
 #include <algo/blast/api/seqsrc_seqdb.hpp>      // for SeqDbBlastSeqSrcInit
 #include <algo/blast/api/blast_mtlock.hpp>      // for Blast_DiagnosticsInitMT
 #include <algo/blast/api/blast_dbindex.hpp>
+#include <corelib/ncbiapp.hpp>                  // for GetEnvironment
+#include <corelib/ncbifile.hpp>                 // for CMemoryFile
+#include <corelib/ncbi_process.hpp>             // for CCurrentProcess
+#include <corelib/ncbitime.hpp>                 // for CTime
 
 #include "blast_aux_priv.hpp"
 #include "blast_memento_priv.hpp"
@@ -196,6 +200,147 @@ CSetupFactory::CreateScoreBlock(const CBlastOptionsMemento* opts_memento,
     return retval;
 }
 
+/// Environment variable naming a directory where finished lookup tables are
+/// kept as images that concurrent BLAST processes searching the same queries
+/// (e.g. against different database shards) map read-only instead of
+/// building their own copy
+static const char* kLookupTableCacheEnv = "BLAST_LOOKUP_TABLE_CACHE";
+
+/// Environment variable setting the most megabytes of lookup table images
+/// kept in the cache directory; the least recently used images are removed
+/// to make room for a new one
+static const char* kLookupTableCacheSizeEnv = "BLAST_LOOKUP_TABLE_CACHE_MB";
+
+/// Cache size used if kLookupTableCacheSizeEnv is not set
+static const Uint8 kDfltLookupTableCacheMB = 4096;
+
+/// File name prefix of the lookup table images in the cache directory
+static const string kLookupTableImagePrefix("blast_lut_");
+
+/// Unmap a lookup table image when the lookup table using it is freed
+/// @param handle The CMemoryFile holding the image [in]
+static void s_ReleaseLookupTableImage(void* handle)
+{
+    delete static_cast<CMemoryFile*>(handle);
+}
+
+/// Map a lookup table image and attach a lookup table to it
+/// @param path Image file name [in]
+/// @param key Key of the lookup table to attach [in]
+/// @param queries Query sequences the lookup table was built for [in]
+/// @return The lookup table, or NULL if there is no usable image
+static LookupTableWrap*
+s_AttachLookupTableImage(const string& path, Uint8 key,
+                         BLAST_SequenceBlk* queries)
+{
+    LookupTableWrap* retval(0);
+    if ( !CFile(path).Exists() ) {
+        return retval;
+    }
+    try {
+        auto_ptr<CMemoryFile> image(new CMemoryFile(path));
+        if (LookupTableWrapAttachImage(image->GetPtr(), image->GetSize(),
+                                       key, queries,
+                                       s_ReleaseLookupTableImage,
+                                       image.get(), &retval) == 0) {
+            image.release();
+            // mark the image as recently used for s_TrimLookupTableCache
+            CTime now(CTime::eCurrent);
+            CFile(path).SetTime(&now);
+        }
+    } catch (const CException& e) {
+        ERR_POST(Warning << "Cannot map lookup table image " << path
+                 << ": " << e.GetMsg());
+        retval = 0;
+    }
+    return retval;
+}
+
+/// Remove the least recently used images from the lookup table cache
+/// directory until an image of new_size bytes fits within max_size bytes.
+/// Images being written by other processes are left alone. Processes that
+/// have mapped a removed image keep using it.
+/// @param dir The cache directory [in]
+/// @param new_size Size of the image about to be written [in]
+/// @param max_size Maximum total size of the images [in]
+static void
+s_TrimLookupTableCache(const string& dir, Uint8 new_size, Uint8 max_size)
+{
+    typedef pair<time_t, pair<Uint8, string> > TImageInfo;
+    vector<TImageInfo> images;
+    Uint8 total = new_size;
+
+    CDir::TEntries entries(CDir(dir).GetEntries(kLookupTableImagePrefix + "*",
+                                                CDir::fIgnoreRecursive));
+    ITERATE(CDir::TEntries, entry, entries) {
+        const string& kPath = (*entry)->GetPath();
+        time_t mtime = 0;
+        if (NStr::EndsWith(kPath, ".tmp") || !(*entry)->IsFile() ||
+            !(*entry)->GetTimeT(&mtime)) {
+            continue;
+        }
+        const Int8 kLength = CFile(kPath).GetLength();
+        if (kLength < 0) {
+            continue;
+        }
+        total += kLength;
+        images.push_back(TImageInfo(mtime, make_pair((Uint8)kLength, kPath)));
+    }
+    if (total <= max_size) {
+        return;
+    }
+
+    sort(images.begin(), images.end());
+    for (size_t i = 0; i < images.size() && total > max_size; i++) {
+        if (CFile(images[i].second.second).Remove()) {
+            total -= images[i].second.first;
+        }
+    }
+}
+
+/// Save a lookup table as an image for other processes to map. The image is
+/// written under a temporary name and renamed into place, so readers never
+/// see a partial file. Older images are removed first if the cache would
+/// otherwise exceed its size limit; an image larger than the limit is not
+/// saved.
+/// @param path Image file name [in]
+/// @param max_size Maximum total size of the images in the cache [in]
+/// @param key Key of the lookup table [in]
+/// @param lookup The lookup table [in]
+/// @param queries Query sequences the lookup table was built for [in]
+static void
+s_SaveLookupTableImage(const string& path, Uint8 max_size, Uint8 key,
+                       const LookupTableWrap* lookup,
+                       const BLAST_SequenceBlk* queries)
+{
+    const size_t kSize = LookupTableWrapImageSize(lookup, queries);
+    if (kSize == 0 || kSize > max_size) {
+        return;
+    }
+    s_TrimLookupTableCache(CDirEntry(path).GetDir(), kSize, max_size);
+    // Uint8 elements keep the buffer aligned as the image requires
+    vector<Uint8> buffer(kSize / sizeof(Uint8));
+    if (LookupTableWrapWriteImage(lookup, queries, key, &buffer[0],
+                                  kSize) != 0) {
+        return;
+    }
+
+    const string kTmpPath = path + "." +
+        NStr::NumericToString(CCurrentProcess::GetPid()) + ".tmp";
+    {
+        CNcbiOfstream out(kTmpPath.c_str(), IOS_BASE::out | IOS_BASE::binary);
+        out.write((const char*)&buffer[0], kSize);
+        if ( !out ) {
+            out.close();
+            CFile(kTmpPath).Remove();
+            return;
+        }
+    }
+    if ( !CFile(kTmpPath).Rename(path, CFile::fRF_Overwrite) ) {
+        CFile(kTmpPath).Remove();
+    }
+}
+
 LookupTableWrap*
 CSetupFactory::CreateLookupTable(CRef<ILocalQueryData> query_data,
                                  const CBlastOptionsMemento* opts_memento,
@@ -211,6 +356,37 @@ CSetupFactory::CreateLookupTable(CRef<ILocalQueryData> query_data,
 
     BlastSeqLoc * lookup_segments = lookup_segments_wrap->getLocs();
 
+    string image_path;
+    Uint8 image_key = 0;
+    Uint8 cache_size = kDfltLookupTableCacheMB;
+    string cache_dir;
+    if (CNcbiApplication::Instance()) {
+        const CNcbiEnvironment& env =
+            CNcbiApplication::Instance()->GetEnvironment();
+        cache_dir = env.Get(kLookupTableCacheEnv);
+        const string& kCacheSize = env.Get(kLookupTableCacheSizeEnv);
+        if ( !kCacheSize.empty() ) {
+            cache_size = NStr::StringToUInt8(kCacheSize,
+                                             NStr::fConvErr_NoThrow);
+        }
+    }
+    if ( !cache_dir.empty() && !rps_info ) {
+        image_key = LookupTableWrapImageKey(queries, opts_memento->m_LutOpts,
+                                            opts_memento->m_QueryOpts,
+                                            lookup_segments, score_blk);
+    }
+    if (image_key != 0) {
+        image_path = CDirEntry::MakePath(cache_dir, kLookupTableImagePrefix +
+                                NStr::UInt8ToString(image_key, 0, 16));
+        retval = s_AttachLookupTableImage(image_path, image_key, queries);
+        if (retval) {
+            if (seqsrc) {
+                GetDbIndexSetQueryInfoFn()( retval, lookup_segments_wrap);
+            }
+            return retval;
+        }
+    }
+
     Int2 status = LookupTableWrapInit_MT(queries,
                                          opts_memento->m_LutOpts,
                                          opts_memento->m_QueryOpts,
@@ -236,6 +412,11 @@ CSetupFactory::CreateLookupTable(CRef<ILocalQueryData> query_data,
          NCBI_THROW(CBlastException, eCoreBlastError, msg);
     }
 
+    if (image_key != 0) {
+        s_SaveLookupTableImage(image_path, cache_size * 1024 * 1024,
+                               image_key, retval, queries);
+    }
+
     // For PHI BLAST, save information about pattern occurrences in query in
     // the BlastQueryInfo structure
     if (Blast_ProgramIsPhiBlast(opts_memento->m_ProgramType)) {
@@ -291,6 +291,157 @@ CBlastTracebackSearch::Run()
                                      m_ResultType);
 }
 
+/// What CBlastTracebackSearch::x_PutQueryResults needs to turn the core
+/// results of one query into a CSearchResults for the sink
+struct SQueryResultsSinkData {
+    SQueryResultsSinkData(CBlastTracebackSearch& search,
+                          ILocalQueryData& qdata,
+                          ISearchResultsSink& sink,
+                          const TSeqLocInfoVector& query_masks)
+        : m_Search(search), m_QueryData(qdata), m_Sink(sink),
+          m_QueryMasks(query_masks)
+    {}
+
+    CBlastTracebackSearch&   m_Search;
+    ILocalQueryData&         m_QueryData;
+    ISearchResultsSink&      m_Sink;
+    const TSeqLocInfoVector& m_QueryMasks;
+    /// Exception thrown while converting or consuming the results; it can't
+    /// propagate through the core, so it is rethrown once the core returns
+    std::exception_ptr       m_Error;
+};
+
+Int2
+CBlastTracebackSearch::x_PutQueryResults(BlastHSPResults* results,
+                                         Int4 query_index,
+                                         void* user_data)
+{
+    SQueryResultsSinkData* data =
+        static_cast<SQueryResultsSinkData*>(user_data);
+    try {
+        data->m_Sink.Put(data->m_Search.x_MakeQueryResults
+                         (results->hitlist_array[query_index], query_index,
+                          data->m_QueryData, data->m_QueryMasks));
+    } catch (...) {
+        data->m_Error = std::current_exception();
+        return -1;
+    }
+    return 0;
+}
+
+void
+CBlastTracebackSearch::Run(ISearchResultsSink& sink,
+                           const TSeqLocInfoVector& query_masks)
+{
+    _ASSERT(m_OptsMemento);
+
+    // Bl2seq results are arranged per query/subject pair and PHI-BLAST
+    // results per pattern occurrence, so these are converted as a whole
+    if (m_ResultType != eDatabaseSearch ||
+        Blast_ProgramIsPhiBlast(m_OptsMemento->m_ProgramType)) {
+        CRef<CSearchResultSet> results = Run();
+        results->SetFilteredQueryRegions(query_masks);
+        ITERATE(CSearchResultSet, result, *results) {
+            sink.Put(*result);
+        }
+        sink.Finish();
+        return;
+    }
+
+    m_InternalData->m_LookupTable.Reset(NULL);
+
+    // When dealing with PSI-BLAST iterations, we need to keep a larger
+    // alignment for the PSSM engine as to replicate blastpgp's behavior
+    int hitlist_size_backup = m_OptsMemento->m_HitSaveOpts->hitlist_size;
+    if (m_OptsMemento->m_ProgramType == eBlastTypePsiBlast ) {
+        SBlastHitsParameters* bhp = NULL;
+        SBlastHitsParametersNew(m_OptsMemento->m_HitSaveOpts, 
+                                m_OptsMemento->m_ExtnOpts,
+                                m_OptsMemento->m_ScoringOpts,
+                                &bhp);
+        m_OptsMemento->m_HitSaveOpts->hitlist_size = bhp->prelim_hitlist_size;
+        SBlastHitsParametersFree(bhp);
+    }
+
+    auto_ptr<CAutoEnvironmentVariable> omp_env;
+    if (m_NumThreads > kMinNumThreads) {
+        omp_env.reset(new CAutoEnvironmentVariable("OMP_WAIT_POLICY", "passive"));
+    }
+
+    _ASSERT(m_SeqInfoSrc);
+    _ASSERT(m_QueryFactory);
+    CRef<ILocalQueryData> qdata = m_QueryFactory->MakeLocalQueryData(m_Options);
+    const size_t kNumQueries = qdata->GetNumQueries();
+    if (m_Messages.size() < kNumQueries) {
+        m_Messages.resize(kNumQueries);
+    }
+
+    // The core traceback hands over each query's results as soon as they are
+    // final and frees them when x_PutQueryResults returns
+    SQueryResultsSinkData data(*this, *qdata, sink, query_masks);
+    int status =
+        Blast_RunTracebackSearchPerQuery(m_OptsMemento->m_ProgramType,
+                                 m_InternalData->m_Queries,
+                                 m_InternalData->m_QueryInfo,
+                                 m_InternalData->m_SeqSrc->GetPointer(),
+                                 m_OptsMemento->m_ScoringOpts,
+                                 m_OptsMemento->m_ExtnOpts,
+                                 m_OptsMemento->m_HitSaveOpts,
+                                 m_OptsMemento->m_EffLenOpts,
+                                 m_OptsMemento->m_DbOpts,
+                                 m_OptsMemento->m_PSIBlastOpts,
+                                 m_InternalData->m_ScoreBlk->GetPointer(),
+                                 m_InternalData->m_HspStream->GetPointer(),
+                                 m_InternalData->m_RpsData ?
+                                 (*m_InternalData->m_RpsData)() : 0,
+                                 NULL,
+                                 x_PutQueryResults, &data,
+                                 m_InternalData->m_FnInterrupt,
+                                 m_InternalData->m_ProgressMonitor->Get(), m_NumThreads);
+    m_OptsMemento->m_HitSaveOpts->hitlist_size = hitlist_size_backup;
+    if (data.m_Error) {
+        std::rethrow_exception(data.m_Error);
+    }
+    if (status) {
+        NCBI_THROW(CBlastException, eCoreBlastError, "Traceback failed"); 
+    }
+    sink.Finish();
+}
+
+CRef<CSearchResults>
+CBlastTracebackSearch::x_MakeQueryResults(BlastHitList* hit_list,
+                                          int index,
+                                          ILocalQueryData& qdata,
+                                          const TSeqLocInfoVector& query_masks)
+{
+    TSeqLocInfoVector subj_masks;
+    CRef<CSeq_align_set> seq_aligns =
+        BlastHitList2SeqAlign_OMF(hit_list,
+                                  m_OptsMemento->m_ProgramType,
+                                  *qdata.GetSeq_loc(index),
+                                  qdata.GetSeqLength(index),
+                                  m_SeqInfoSrc.GetPointer(),
+                                  m_Options->GetGappedMode(),
+                                  m_Options->GetOutOfFrameMode(),
+                                  subj_masks);
+
+    CRef<CBlastAncillaryData> ancillary_data
+        (new CBlastAncillaryData(m_OptsMemento->m_ProgramType, index,
+                                 m_InternalData->m_ScoreBlk->GetPointer(),
+                                 m_InternalData->m_QueryInfo));
+    CConstRef<CSeq_id> query_id
+        (qdata.GetSeq_loc(index)->GetId());
+    CRef<CSearchResults> result(new CSearchResults(query_id,
+                                                   seq_aligns,
+                                                   m_Messages[index],
+                                                   ancillary_data));
+    result->SetSubjectMasks(subj_masks);
+    if (static_cast<size_t>(index) < query_masks.size()) {
+        result->SetMaskedQueryRegions(query_masks[index]);
+    }
+    return result;
+}
+
 BlastHSPResults*
 CBlastTracebackSearch::RunSimple()
 {
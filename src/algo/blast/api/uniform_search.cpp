@@ -291,6 +291,11 @@ CSearchDatabase::x_InitializeDb() const
         m_SeqDb.Reset(new CSeqDB(m_DbName, seq_type));
 
     }
+
+    // The search only reads this database, so let the search threads
+    // share it without the atlas lock.  Databases supplied through
+    // SetSeqDb are left as the caller configured them.
+    m_SeqDb->SetImmutableMode();
       
     x_ValidateMaskingAlgorithm();
     _ASSERT(m_SeqDb.NotEmpty());
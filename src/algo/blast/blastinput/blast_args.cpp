@@ -2499,7 +2499,9 @@ CFormattingArgs::SetArgumentDescriptions(CArgDescriptions& arg_desc)
     if(m_FormatFlags & eIsSAM) {
     	kOutputFormatDescription += ",\n 17 = Sequence Alignment/Map (SAM)";
     }
-    kOutputFormatDescription += ",\n 18 = Organism Report\n\n";
+    kOutputFormatDescription += ",\n 18 = Organism Report";
+    kOutputFormatDescription += ",\n 20 = Binary columnar tabular "
+        "(blast_formatter -columnar converts it to option 6)\n\n";
     if(m_FormatFlags & eIsSAM) {
     	kOutputFormatDescription +=
                 "Options 6, 7, 10 and 17 "
@@ -3305,14 +3307,28 @@ CStdCmdLineArgs::ExtractAlgorithmOptions(const CArgs& args,
         }
     }
 
+    // binary columnar tabular output must not go through a text mode
+    // stream, which would translate line ends on some platforms
+    CArgValue::TFileFlags output_flags = 0;
+    if (args.Exist(kArgOutputFormat) && args[kArgOutputFormat]) {
+        string fmt_choice =
+            NStr::TruncateSpaces(args[kArgOutputFormat].AsString());
+        fmt_choice.erase(min(fmt_choice.find_first_of(' '),
+                             fmt_choice.size()));
+        if (NStr::StringToInt(fmt_choice, NStr::fConvErr_NoThrow) ==
+            CFormattingArgs::eColumnarTabular) {
+            output_flags = CArgValue::fBinary;
+        }
+    }
+
     if (args.Exist(kArgOutputGzip) && args[kArgOutputGzip]) {
         m_CompressOStream.reset(new CCompressOStream(
-                                              args[kArgOutput].AsOutputFile(),
-                                              CCompressOStream::eGZipFile));
+                                  args[kArgOutput].AsOutputFile(output_flags),
+                                  CCompressOStream::eGZipFile));
         m_OutputStream = m_CompressOStream.get();
     }
     else {
-        m_OutputStream = &args[kArgOutput].AsOutputFile();
+        m_OutputStream = &args[kArgOutput].AsOutputFile(output_flags);
     }
 
     // stream for unaligned reads in magicblast
@@ -34,6 +34,7 @@
 #include <ncbi_pch.hpp>
 #include <algo/blast/blastinput/blast_input_aux.hpp>
 #include <algo/blast/api/blast_exception.hpp>
+#include <algo/blast/api/local_blast.hpp>
 #include <serial/iterator.hpp>  // for CTypeConstIterator
 /* for CBlastFastaInputSource */
 #include <algo/blast/blastinput/blast_fasta_input.hpp>  
@@ -83,7 +84,9 @@ GetQueryBatchSize(EProgram program, bool is_ungapped /* = false */,
 
     // used for experimentation purposes
     char* batch_sz_str = getenv("BATCH_SIZE");
-    if (batch_sz_str) {
+    const bool kAdaptive = 
+        batch_sz_str && NStr::EqualNocase(batch_sz_str, kAdaptiveQuerySize);
+    if (batch_sz_str && !kAdaptive) {
         retval = NStr::StringToInt(batch_sz_str);
         _TRACE("DEBUG: Using query batch size " << retval);
         return retval;
@@ -95,7 +98,7 @@ GetQueryBatchSize(EProgram program, bool is_ungapped /* = false */,
        return retval;
     }
 
-    if (! use_default) return 0;
+    if (! use_default && ! kAdaptive) return 0;
 
     switch (program) {
     case eBlastn:
@@ -129,6 +132,17 @@ GetQueryBatchSize(EProgram program, bool is_ungapped /* = false */,
         break;
     }
 
+    if (kAdaptive) {
+        const SBlastMemoryLimits kLimits = SBlastMemoryLimits::Measure();
+        const int kDefaultSize = retval;
+        retval = (int)GetAdaptiveQuerySize(program, retval, kLimits);
+        LOG_POST(Info << "Adaptive query batch size for "
+                 << EProgramToTaskName(program) << ": " << retval
+                 << " (default " << kDefaultSize << ", available memory "
+                 << kLimits.available_memory << " bytes, cache "
+                 << kLimits.cache_size << " bytes)");
+    }
+
     _TRACE("Using query batch size " << retval);
     return retval;
 }
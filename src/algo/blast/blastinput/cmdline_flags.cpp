@@ -239,6 +239,7 @@ const string kDfltArgCandidateSeqs("1000");
 
 const string kArgRid("rid");
 const string kArgArchive("archive");
+const string kArgColumnarInput("columnar");
 
 const string kArgQueryCovHspPerc("qcov_hsp_perc");
 const string kArgLineLength("line_length");
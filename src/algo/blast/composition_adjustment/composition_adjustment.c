@@ -79,6 +79,10 @@ static const double kFixedReBlosum62 = 0.44;
     composition adjustment */
 static const double kMaximumXscore = -1.0;
 
+/** Number of entries in the cache of adjusted matrices kept by each
+ * Blast_CompositionWorkspace; must be a power of two */
+#define COMPO_MATRIX_CACHE_SIZE 64
+
 /** The BLOSUM62 matrix for the ARND... alphabet, using standard scale */
 static double BLOS62[COMPO_NUM_TRUE_AA][COMPO_NUM_TRUE_AA]=
 {{4, -1, -2, -2, 0, -1, -1, 0, -2, -1, -1, -1, -1, -2, -1, 1, 0, -3, -2, 0},
@@ -416,6 +420,36 @@ Blast_FreqRatioToScore(double ** matrix, int rows, int cols, double Lambda)
 }
 
 
+/**
+ * Convert a matrix of logarithms of frequency ratios to scores at scale
+ * Lambda.  The result is identical to that of Blast_FreqRatioToScore
+ * applied to the frequency ratios themselves, but the loop contains no
+ * calls to log() and so may be vectorized by the compiler.
+ *
+ * @param scores       the matrix of scores [out]
+ * @param log_ratios   the logarithms of the frequency ratios; -HUGE_VAL
+ *                     stands for a frequency ratio of zero [in]
+ * @param rows         the number of rows in the matrix
+ * @param cols         the number of columns in the matrix
+ * @param Lambda       the scale of the new matrix
+ */
+static void
+s_LogFreqRatioToScore(double ** scores, double ** log_ratios,
+                      int rows, int cols, double Lambda)
+{
+    int i;
+    for (i = 0;  i < rows;  i++) {
+        int j;
+        double * score_row = scores[i];
+        const double * log_row = log_ratios[i];
+        for (j = 0;  j < cols;  j++) {
+            double lr = log_row[j];
+            score_row[j] = (lr == -HUGE_VAL) ? COMPO_SCORE_MIN : lr / Lambda;
+        }
+    }
+}
+
+
 /**
  * Convert letter probabilities from the NCBIstdaa alphabet to
  * a 20 letter ARND... amino acid alphabet. (@see alphaConvert)
@@ -967,6 +1001,7 @@ void Blast_MatrixInfoFree(Blast_MatrixInfo ** ss)
         free((*ss)->matrixName);
         Nlm_Int4MatrixFree(&(*ss)->startMatrix);
         Nlm_DenseMatrixFree(&(*ss)->startFreqRatios);
+        Nlm_DenseMatrixFree(&(*ss)->startLogFreqRatios);
         free(*ss);
         *ss = NULL;
     }
@@ -987,6 +1022,7 @@ Blast_MatrixInfoNew(int rows, int cols, int positionBased)
         ss->matrixName = NULL;
         ss->startMatrix = NULL;
         ss->startFreqRatios = NULL;
+        ss->startLogFreqRatios = NULL;
 
         ss->startMatrix  = Nlm_Int4MatrixNew(rows + 1, cols);
         if (ss->startMatrix == NULL)
@@ -1009,6 +1045,28 @@ normal_return:
 }
 
 
+/* Documented in composition_adjustment.h. */
+int
+Blast_MatrixInfoSetLogFreqRatios(Blast_MatrixInfo * ss)
+{
+    int i, j;
+
+    if (ss->startLogFreqRatios == NULL) {
+        ss->startLogFreqRatios = Nlm_DenseMatrixNew(ss->rows, ss->cols);
+        if (ss->startLogFreqRatios == NULL)
+            return -1;
+    }
+    for (i = 0;  i < ss->rows;  i++) {
+        for (j = 0;  j < ss->cols;  j++) {
+            double ratio = ss->startFreqRatios[i][j];
+            ss->startLogFreqRatios[i][j] =
+                (0.0 == ratio) ? -HUGE_VAL : log(ratio);
+        }
+    }
+    return 0;
+}
+
+
 /**
  * Fill in all scores for a PSSM at a given scale Lambda.
  *
@@ -1016,6 +1074,8 @@ normal_return:
  * @param rows         number of positions (rows) in the PSSM
  * @param cols         the number of columns in the PSSM; the alphabet size
  * @param freq_ratios  frequency ratios defining the PSSM
+ * @param log_freq_ratios  logarithms of freq_ratios, or NULL if they
+ *                     have not been computed
  * @param start_matrix an existing PSSM; used to set values for the
  *                     stop character.
  * @param col_prob     letter probabilities
@@ -1023,6 +1083,7 @@ normal_return:
  */
 static void
 s_ScalePSSM(int **matrix, int rows, int cols, double ** freq_ratios,
+            double ** log_freq_ratios,
             int ** start_matrix, const double col_prob[], double Lambda)
 {
     int p;          /* index over matrix rows */
@@ -1035,9 +1096,13 @@ s_ScalePSSM(int **matrix, int rows, int cols, double ** freq_ratios,
 
     for (p = 0;  p < rows;  p++) {
         double Xscore;
-        memcpy(row, freq_ratios[p], cols * sizeof(double));
-
-        Blast_FreqRatioToScore(row_matrix, 1, cols, Lambda);
+        if (log_freq_ratios != NULL) {
+            s_LogFreqRatioToScore(row_matrix, &log_freq_ratios[p], 1, cols,
+                                  Lambda);
+        } else {
+            memcpy(row, freq_ratios[p], cols * sizeof(double));
+            Blast_FreqRatioToScore(row_matrix, 1, cols, Lambda);
+        }
         row[eXchar] = Xscore = s_CalcXScore(row, cols, 1, col_prob);
         /* use Cysteine score for Selenocysteine */
         row[eSelenocysteine] = row[eCchar];
@@ -1058,6 +1123,8 @@ s_ScalePSSM(int **matrix, int rows, int cols, double ** freq_ratios,
  * @param matrix       the newly computed matrix [output]
  * @param alphsize     the alphabet size
  * @param freq_ratios  frequency ratios defining the PSSM
+ * @param log_freq_ratios  logarithms of freq_ratios, or NULL if they
+ *                     have not been computed
  * @param start_matrix an existing matrix; used to set values for the
  *                     stop character.
  * @param row_prob     letter probabilities for the sequence
@@ -1068,7 +1135,8 @@ s_ScalePSSM(int **matrix, int rows, int cols, double ** freq_ratios,
  */
 static int
 s_ScaleSquareMatrix(int **matrix, int alphsize,
-                    double ** freq_ratios, int ** start_matrix,
+                    double ** freq_ratios, double ** log_freq_ratios,
+                    int ** start_matrix,
                     const double row_prob[], const double col_prob[],
                     double Lambda)
 {
@@ -1078,10 +1146,15 @@ s_ScaleSquareMatrix(int **matrix, int alphsize,
     scores = Nlm_DenseMatrixNew(alphsize, alphsize);
     if (scores == 0) return -1;
 
-    for (i = 0;  i < alphsize;  i++) {
-        memcpy(scores[i], freq_ratios[i], alphsize * sizeof(double));
+    if (log_freq_ratios != NULL) {
+        s_LogFreqRatioToScore(scores, log_freq_ratios, alphsize, alphsize,
+                              Lambda);
+    } else {
+        for (i = 0;  i < alphsize;  i++) {
+            memcpy(scores[i], freq_ratios[i], alphsize * sizeof(double));
+        }
+        Blast_FreqRatioToScore(scores, alphsize, alphsize, Lambda);
     }
-    Blast_FreqRatioToScore(scores, alphsize, alphsize, Lambda);
     s_SetXUOScores(scores, alphsize, row_prob, col_prob);
     s_RoundScoreMatrix(matrix, alphsize, alphsize, scores);
     for (i = 0;  i < alphsize;  i++) {
@@ -1144,10 +1217,12 @@ Blast_CompositionBasedStats(int ** matrix, double * LambdaRatio,
         double scaledLambda = ss->ungappedLambda/(*LambdaRatio);
         if (ss->positionBased) {
             s_ScalePSSM(matrix, ss->rows, ss->cols, ss->startFreqRatios,
+                        ss->startLogFreqRatios,
                         ss->startMatrix, resProb, scaledLambda);
         } else {
             s_ScaleSquareMatrix(matrix, ss->cols,
-                                ss->startFreqRatios, ss->startMatrix,
+                                ss->startFreqRatios, ss->startLogFreqRatios,
+                                ss->startMatrix,
                                 queryProb, resProb, scaledLambda);
         }
     }
@@ -1164,18 +1239,32 @@ Blast_ReadAaComposition(Blast_AminoAcidComposition * composition,
                         const Uint1 * sequence, int length)
 {
     int i; /* iteration index */
+    /* Letter counts; the sequence is counted into four interleaved
+       histograms so that consecutive equal letters do not form a chain
+       of dependent increments. */
+    int counts[4][UCHAR_MAX + 1];
 
     /* fields of composition as local variables */
     int numTrueAminoAcids = 0;
     double * prob = composition->prob;
 
+    memset(counts, 0, sizeof(counts));
+    for (i = 0;  i + 4 <= length;  i += 4) {
+        counts[0][sequence[i]]++;
+        counts[1][sequence[i + 1]]++;
+        counts[2][sequence[i + 2]]++;
+        counts[3][sequence[i + 3]]++;
+    }
+    for ( ;  i < length;  i++) {
+        counts[0][sequence[i]]++;
+    }
     for (i = 0;  i < alphsize;  i++) {
         prob[i] = 0.0;
-    }
-    for (i = 0;  i < length;  i++) {
-        if (alphaConvert[sequence[i]] >= 0 || sequence[i] == eSelenocysteine) {
-            prob[sequence[i]]++;
-            numTrueAminoAcids++;
+        if (alphaConvert[i] >= 0 || i == eSelenocysteine) {
+            int count = counts[0][i] + counts[1][i] +
+                        counts[2][i] + counts[3][i];
+            prob[i] = count;
+            numTrueAminoAcids += count;
         }
     }
 
@@ -1248,6 +1337,71 @@ Blast_GetCompositionRange(int * pleft, int * pright,
 }
 
 
+/** A matrix adjusted by Blast_AdjustScores, together with all the inputs
+ * that determined it */
+typedef struct Blast_AdjustedMatrixCacheEntry {
+    int valid;                /**< does this entry hold a matrix */
+    const Blast_MatrixInfo * matrixInfo;    /**< the unadjusted matrix */
+    double (*calc_lambda)(double *,int,int,double);  /**< the function
+                                                          used to find
+                                                          Lambda */
+    int queryLength;          /**< length of the query */
+    int subjectLength;        /**< length of the subject */
+    int queryNumTrue;         /**< true amino acids in the query */
+    int subjectNumTrue;       /**< true amino acids in the subject */
+    int mode;                 /**< composition adjustment mode */
+    int RE_pseudocounts;      /**< pseudocounts for relative entropy */
+    int compositionTestIndex; /**< was the p-value computed */
+    double queryProb[COMPO_LARGEST_ALPHABET];    /**< query composition */
+    double subjectProb[COMPO_LARGEST_ALPHABET];  /**< subject composition */
+    EMatrixAdjustRule matrix_adjust_rule; /**< rule that was applied */
+    double pvalue;            /**< p-value of the composition test */
+    double ratio;             /**< Lambda ratio of the adjustment */
+    int matrix[COMPO_LARGEST_ALPHABET][COMPO_LARGEST_ALPHABET]; /**< the
+                                                          adjusted scores */
+} Blast_AdjustedMatrixCacheEntry;
+
+
+/** A direct-mapped cache of adjusted matrices.  Entries are located by
+ * the letter counts of the compositions, i.e. the probabilities rounded
+ * back to integers, but are only used if all inputs match exactly, so a
+ * cached matrix is always identical to the one that would be computed. */
+struct Blast_AdjustedMatrixCache {
+    Blast_AdjustedMatrixCacheEntry entries[COMPO_MATRIX_CACHE_SIZE];
+};
+
+
+/**
+ * Hash a pair of compositions for lookup in a Blast_AdjustedMatrixCache.
+ *
+ * @param query_composition     composition of the query
+ * @param subject_composition   composition of the subject
+ * @param alphsize              the alphabet size
+ * @return the index of the cache entry for this pair
+ */
+static int
+s_MatrixCacheIndex(const Blast_AminoAcidComposition * query_composition,
+                   const Blast_AminoAcidComposition * subject_composition,
+                   int alphsize)
+{
+    unsigned int hash = 2166136261U;
+    int i;
+
+    for (i = 0;  i < alphsize;  i++) {
+        unsigned int count = (unsigned int)
+            Nint(subject_composition->prob[i] *
+                 subject_composition->numTrueAminoAcids);
+        hash = (hash ^ count) * 16777619U;
+    }
+    hash = (hash ^ (unsigned int) subject_composition->numTrueAminoAcids)
+        * 16777619U;
+    hash = (hash ^ (unsigned int) query_composition->numTrueAminoAcids)
+        * 16777619U;
+
+    return (int) ((hash ^ (hash >> 16)) & (COMPO_MATRIX_CACHE_SIZE - 1));
+}
+
+
 /* Documented in composition_adjustment.h. */
 void
 Blast_CompositionWorkspaceFree(Blast_CompositionWorkspace ** pNRrecord)
@@ -1260,6 +1414,7 @@ Blast_CompositionWorkspaceFree(Blast_CompositionWorkspace ** pNRrecord)
 
         Nlm_DenseMatrixFree(&NRrecord->mat_final);
         Nlm_DenseMatrixFree(&NRrecord->mat_b);
+        free(NRrecord->matrix_cache);
 
         free(NRrecord);
     }
@@ -1282,6 +1437,7 @@ Blast_CompositionWorkspace * Blast_CompositionWorkspaceNew(void)
     NRrecord->second_standard_freq     = NULL;
     NRrecord->mat_final                = NULL;
     NRrecord->mat_b                    = NULL;
+    NRrecord->matrix_cache             = NULL;
 
     NRrecord->first_standard_freq =
         (double *) malloc(COMPO_NUM_TRUE_AA * sizeof(double));
@@ -1299,6 +1455,10 @@ Blast_CompositionWorkspace * Blast_CompositionWorkspaceNew(void)
                                                COMPO_NUM_TRUE_AA);
     if (NRrecord->mat_b == NULL) goto error_return;
 
+    NRrecord->matrix_cache = (Blast_AdjustedMatrixCache *)
+        calloc(1, sizeof(Blast_AdjustedMatrixCache));
+    if (NRrecord->matrix_cache == NULL) goto error_return;
+
     for (i = 0;  i < COMPO_NUM_TRUE_AA;  i++) {
         NRrecord->first_standard_freq[i] =
             NRrecord->second_standard_freq[i] = 0.0;
@@ -1317,6 +1477,9 @@ int
 Blast_CompositionWorkspaceInit(Blast_CompositionWorkspace * NRrecord,
                                const char *matrixName)
 {
+    if (NRrecord->matrix_cache != NULL) {
+        memset(NRrecord->matrix_cache, 0, sizeof(Blast_AdjustedMatrixCache));
+    }
     if (0 == Blast_GetJointProbsForMatrix(NRrecord->mat_b,
                                           NRrecord->first_standard_freq,
                                           NRrecord->second_standard_freq,
@@ -1409,9 +1572,13 @@ Blast_CompositionMatrixAdj(int ** matrix,
 }
 
 
-/* Documented in composition_adjustment.h. */
-int
-Blast_AdjustScores(int ** matrix,
+/**
+ * Compute an adjusted scoring matrix for a pair of compositions; this is
+ * Blast_AdjustScores without the cache of adjusted matrices.  Parameters
+ * are as for Blast_AdjustScores.
+ */
+static int
+s_AdjustScores(int ** matrix,
                    const Blast_AminoAcidComposition * query_composition,
                    int queryLength,
                    const Blast_AminoAcidComposition * subject_composition,
@@ -1529,3 +1696,95 @@ Blast_AdjustScores(int ** matrix,
                                        calc_lambda,
                                        (compositionTestIndex > 0));
 }
+
+
+/* Documented in composition_adjustment.h. */
+int
+Blast_AdjustScores(int ** matrix,
+                   const Blast_AminoAcidComposition * query_composition,
+                   int queryLength,
+                   const Blast_AminoAcidComposition * subject_composition,
+                   int subjectLength,
+                   const Blast_MatrixInfo * matrixInfo,
+                   ECompoAdjustModes composition_adjust_mode,
+                   int RE_pseudocounts,
+                   Blast_CompositionWorkspace *NRrecord,
+                   EMatrixAdjustRule *matrix_adjust_rule,
+                   double calc_lambda(double *,int,int,double),
+                   double *pvalueForThisPair,
+                   int compositionTestIndex,
+                   double *ratioToPassBack)
+{
+    const int alphsize = matrixInfo->cols;
+    Blast_AdjustedMatrixCacheEntry * entry = NULL;
+    int status, i;
+
+    /* Only square matrices are cached; a PSSM is adjusted once per
+     * subject anyway, and would make the entries large. */
+    if (NRrecord != NULL && NRrecord->matrix_cache != NULL &&
+        !matrixInfo->positionBased &&
+        alphsize <= COMPO_LARGEST_ALPHABET &&
+        query_composition->numTrueAminoAcids > 0 &&
+        subject_composition->numTrueAminoAcids > 0) {
+        entry = &NRrecord->matrix_cache->entries[
+            s_MatrixCacheIndex(query_composition, subject_composition,
+                               alphsize)];
+        if (entry->valid &&
+            entry->matrixInfo == matrixInfo &&
+            entry->calc_lambda == calc_lambda &&
+            entry->queryLength == queryLength &&
+            entry->subjectLength == subjectLength &&
+            entry->queryNumTrue == query_composition->numTrueAminoAcids &&
+            entry->subjectNumTrue ==
+                subject_composition->numTrueAminoAcids &&
+            entry->mode == (int) composition_adjust_mode &&
+            entry->RE_pseudocounts == RE_pseudocounts &&
+            entry->compositionTestIndex == compositionTestIndex &&
+            0 == memcmp(entry->subjectProb, subject_composition->prob,
+                        alphsize * sizeof(double)) &&
+            0 == memcmp(entry->queryProb, query_composition->prob,
+                        alphsize * sizeof(double))) {
+            for (i = 0;  i < alphsize;  i++) {
+                memcpy(matrix[i], entry->matrix[i], alphsize * sizeof(int));
+            }
+            *matrix_adjust_rule = entry->matrix_adjust_rule;
+            *ratioToPassBack = entry->ratio;
+            if (compositionTestIndex > 0) {
+                *pvalueForThisPair = entry->pvalue;
+            }
+            return 0;
+        }
+    }
+    status = s_AdjustScores(matrix, query_composition, queryLength,
+                            subject_composition, subjectLength, matrixInfo,
+                            composition_adjust_mode, RE_pseudocounts,
+                            NRrecord, matrix_adjust_rule, calc_lambda,
+                            pvalueForThisPair, compositionTestIndex,
+                            ratioToPassBack);
+    if (entry != NULL) {
+        entry->valid = (status == 0);
+        if (status == 0) {
+            entry->matrixInfo = matrixInfo;
+            entry->calc_lambda = calc_lambda;
+            entry->queryLength = queryLength;
+            entry->subjectLength = subjectLength;
+            entry->queryNumTrue = query_composition->numTrueAminoAcids;
+            entry->subjectNumTrue = subject_composition->numTrueAminoAcids;
+            entry->mode = (int) composition_adjust_mode;
+            entry->RE_pseudocounts = RE_pseudocounts;
+            entry->compositionTestIndex = compositionTestIndex;
+            memcpy(entry->queryProb, query_composition->prob,
+                   alphsize * sizeof(double));
+            memcpy(entry->subjectProb, subject_composition->prob,
+                   alphsize * sizeof(double));
+            entry->matrix_adjust_rule = *matrix_adjust_rule;
+            entry->ratio = *ratioToPassBack;
+            entry->pvalue =
+                (compositionTestIndex > 0) ? *pvalueForThisPair : 0.0;
+            for (i = 0;  i < alphsize;  i++) {
+                memcpy(entry->matrix[i], matrix[i], alphsize * sizeof(int));
+            }
+        }
+    }
+    return status;
+}
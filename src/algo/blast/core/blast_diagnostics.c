@@ -41,6 +41,9 @@ BlastDiagnostics* Blast_DiagnosticsFree(BlastDiagnostics* diagnostics)
       sfree(diagnostics->ungapped_stat);
       sfree(diagnostics->gapped_stat);
       sfree(diagnostics->cutoffs);
+      if (diagnostics->thread_stat)
+         sfree(diagnostics->thread_stat->loads);
+      sfree(diagnostics->thread_stat);
       if (diagnostics->mt_lock)
          diagnostics->mt_lock = MT_LOCK_Delete(diagnostics->mt_lock);
       sfree(diagnostics);
@@ -73,6 +76,21 @@ BlastDiagnostics* Blast_DiagnosticsCopy(const BlastDiagnostics* diagnostics)
     } else {
       sfree(diagnostics->cutoffs);
     }
+    if (diagnostics->thread_stat) {
+        const BlastThreadStats* thread_stat = diagnostics->thread_stat;
+        memcpy((void*)retval->thread_stat, (void*)thread_stat,
+               sizeof(*retval->thread_stat));
+        retval->thread_stat->loads = NULL;
+        if (thread_stat->loads && thread_stat->num_threads > 0) {
+            retval->thread_stat->loads = (BlastThreadLoad*)
+                BlastMemDup(thread_stat->loads,
+                     thread_stat->num_threads * sizeof(BlastThreadLoad));
+            if (!retval->thread_stat->loads)
+                retval->thread_stat->num_threads = 0;
+        }
+    } else {
+      sfree(retval->thread_stat);
+    }
     return retval;
 }
 
@@ -87,6 +105,8 @@ BlastDiagnostics* Blast_DiagnosticsInit()
       (BlastGappedStats*) calloc(1, sizeof(BlastGappedStats));
    diagnostics->cutoffs = 
       (BlastRawCutoffs*) calloc(1, sizeof(BlastRawCutoffs));
+   diagnostics->thread_stat = 
+      (BlastThreadStats*) calloc(1, sizeof(BlastThreadStats));
 
    return diagnostics;
 }
@@ -155,6 +175,96 @@ Blast_DiagnosticsUpdate(BlastDiagnostics* global, BlastDiagnostics* local)
       global->cutoffs->cutoff_score = local->cutoffs->cutoff_score;
    }
 
+   if (global->thread_stat && local->thread_stat) {
+      BlastThreadStats* thread_stat = global->thread_stat;
+      Int4 num_loads = local->thread_stat->num_threads;
+      BlastThreadLoad* loads = NULL;
+
+      /* keep the per-thread entries only if all of them fit */
+      if (num_loads > 0 && local->thread_stat->loads) {
+         loads = (BlastThreadLoad*) realloc(thread_stat->loads,
+                    (thread_stat->num_threads + num_loads) *
+                    sizeof(BlastThreadLoad));
+      }
+      if (loads) {
+         memcpy(loads + thread_stat->num_threads, local->thread_stat->loads,
+                num_loads * sizeof(BlastThreadLoad));
+         thread_stat->loads = loads;
+         thread_stat->num_threads += num_loads;
+      }
+      thread_stat->num_subjects += local->thread_stat->num_subjects;
+      thread_stat->num_residues += local->thread_stat->num_residues;
+      thread_stat->max_thread_residues = 
+         MAX(thread_stat->max_thread_residues,
+             local->thread_stat->max_thread_residues);
+      thread_stat->busy_time += local->thread_stat->busy_time;
+      thread_stat->idle_time += local->thread_stat->idle_time;
+   }
+
    if (global->mt_lock) 
       MT_LOCK_Do(global->mt_lock, eMT_Unlock);
 }
+
+Int2
+Blast_DiagnosticsAddThreadLoad(BlastDiagnostics* diagnostics,
+                               Int8 num_subjects, Int8 num_residues)
+{
+   BlastThreadStats* thread_stat;
+   BlastThreadLoad* loads;
+   Int2 status = 0;
+
+   if (!diagnostics || !diagnostics->thread_stat)
+      return 0;
+
+   if (diagnostics->mt_lock) 
+      MT_LOCK_Do(diagnostics->mt_lock, eMT_Lock);
+
+   thread_stat = diagnostics->thread_stat;
+   loads = (BlastThreadLoad*) realloc(thread_stat->loads,
+              (thread_stat->num_threads + 1) * sizeof(BlastThreadLoad));
+   if (loads) {
+      BlastThreadLoad* load = loads + thread_stat->num_threads;
+      load->num_subjects = num_subjects;
+      load->num_residues = num_residues;
+      load->busy_time = 0.0;
+      load->idle_time = 0.0;
+      thread_stat->loads = loads;
+      thread_stat->num_threads++;
+   } else {
+      status = -1;
+   }
+   thread_stat->num_subjects += num_subjects;
+   thread_stat->num_residues += num_residues;
+   thread_stat->max_thread_residues = 
+      MAX(thread_stat->max_thread_residues, num_residues);
+
+   if (diagnostics->mt_lock) 
+      MT_LOCK_Do(diagnostics->mt_lock, eMT_Unlock);
+   return status;
+}
+
+void
+Blast_DiagnosticsUpdateThreadTimes(BlastDiagnostics* diagnostics,
+                                   double busy_time, double idle_time)
+{
+   BlastThreadStats* thread_stat;
+
+   if (!diagnostics || !diagnostics->thread_stat)
+      return;
+
+   if (diagnostics->mt_lock) 
+      MT_LOCK_Do(diagnostics->mt_lock, eMT_Lock);
+
+   thread_stat = diagnostics->thread_stat;
+   thread_stat->busy_time += busy_time;
+   thread_stat->idle_time += idle_time;
+   if (thread_stat->loads && thread_stat->num_threads > 0) {
+      BlastThreadLoad* load = thread_stat->loads + 
+                              thread_stat->num_threads - 1;
+      load->busy_time += busy_time;
+      load->idle_time += idle_time;
+   }
+
+   if (diagnostics->mt_lock) 
+      MT_LOCK_Do(diagnostics->mt_lock, eMT_Unlock);
+}
@@ -397,6 +397,505 @@ s_RPSOffsetArrayToContextOffsets(BlastQueryInfo    * info,
     OffsetArrayToContextOffsets(info, new_offsets, kProgram);
 }
 
+/** Searches one chunk of a subject sequence: finds the initial word hits,
+ * extends them and returns the HSPs in the chunk coordinates.
+ * @param program_number BLAST program type [in]
+ * @param query Query sequence structure [in]
+ * @param query_info Query information [in]
+ * @param subject The subject chunk [in]
+ * @param orig_length original length of query before translation [in]
+ * @param chunk_offset Offset of the chunk in the subject sequence [in]
+ * @param lookup Lookup table [in]
+ * @param gap_align Structure for gapped alignment information [in]
+ * @param score_params Scoring parameters [in]
+ * @param word_params Initial word finding and ungapped extension
+ *                    parameters [in]
+ * @param ext_params Gapped extension parameters [in]
+ * @param hit_params Hit saving parameters [in]
+ * @param diagnostics Hit counts and other diagnostics [in] [out]
+ * @param aux_struct Structure containing different auxiliary data and memory
+ *                   for the preliminary stage of the BLAST search [in]
+ * @param hsp_list_ptr HSPs found in the chunk, NULL if there are no initial
+ *                   hits [out]
+ */
+static Int2
+s_SearchSubjectChunk(EBlastProgramType program_number,
+        BLAST_SequenceBlk* query, BlastQueryInfo* query_info,
+        BLAST_SequenceBlk* subject, Int4 orig_length, Int4 chunk_offset,
+        LookupTableWrap* lookup, BlastGapAlignStruct* gap_align,
+        const BlastScoringParameters* score_params,
+        const BlastInitialWordParameters* word_params,
+        const BlastExtensionParameters* ext_params,
+        const BlastHitSavingParameters* hit_params,
+        BlastDiagnostics* diagnostics,
+        BlastCoreAuxStruct* aux_struct,
+        BlastHSPList** hsp_list_ptr)
+{
+    Int2 status = 0;
+    BlastHSPList* hsp_list = NULL;
+    BlastInitHitList* init_hitlist = aux_struct->init_hitlist;
+    BlastScoringOptions* score_options = score_params->options;
+    BlastUngappedStats* ungapped_stats = NULL;
+    BlastGappedStats* gapped_stats = NULL;
+    Int4 **matrix = (gap_align->positionBased) ?
+                     gap_align->sbp->psi_matrix->pssm->data :
+                     gap_align->sbp->matrix->data;
+    const Boolean kTranslatedSubject =
+       (Blast_SubjectIsTranslated(program_number) || program_number == eBlastTypeRpsTblastn);
+    const int kScanSubjectOffsetArraySize = GetOffsetArraySize(lookup);
+
+    *hsp_list_ptr = NULL;
+
+    if (diagnostics) {
+        ungapped_stats = diagnostics->ungapped_stat;
+        gapped_stats = diagnostics->gapped_stat;
+    }
+
+    BlastInitHitListReset(init_hitlist);
+
+    if (aux_struct->WordFinder) {
+        aux_struct->WordFinder(subject, query, query_info, lookup, matrix,
+                               word_params, aux_struct->ewp,
+                               aux_struct->offset_pairs,
+                               kScanSubjectOffsetArraySize,
+                               init_hitlist, ungapped_stats);
+
+        if (init_hitlist->total == 0) return 0;
+    }
+
+    if (score_options->gapped_calculation) {
+        Int4 prot_length = 0;
+        if (score_options->is_ooframe) {
+            /* Convert query offsets in all HSPs into the mixed-frame
+               coordinates */
+            s_TranslateHSPsToDNAPCoord(program_number, init_hitlist,
+                   query_info, subject->frame, orig_length, chunk_offset);
+            if (kTranslatedSubject) {
+                prot_length = subject->length;
+                subject->length = orig_length;
+            }
+        }
+    /** NB: If queries are concatenated, HSP offsets must be adjusted
+      * inside the following function call, so coordinates are
+      * relative to the individual contexts (i.e. queries, strands or
+      * frames). Contexts should also be filled in HSPs when they
+      * are saved.
+      */
+    /* fence_hit is null, since this is only for prelim stage. */
+    if (aux_struct->GetGappedScore) {
+        status = aux_struct->GetGappedScore(program_number, query,
+                query_info,
+                subject, gap_align, score_params, ext_params, hit_params,
+                init_hitlist, &hsp_list, gapped_stats, NULL);
+    }
+    else if (aux_struct->JumperGapped) {
+        status = aux_struct->JumperGapped(subject, query, query_info,
+                                          lookup, word_params,
+                                          score_params, hit_params,
+                                          aux_struct->offset_pairs,
+                                          aux_struct->mapper_wordhits,
+                                          kScanSubjectOffsetArraySize,
+                                          gap_align, init_hitlist,
+                                          &hsp_list, ungapped_stats,
+                                          gapped_stats);
+    }
+    if (status) {
+        *hsp_list_ptr = hsp_list;
+        return status;
+    }
+
+    /* No need to do this for short reads */
+    if (aux_struct->GetGappedScore) {
+
+        /* Removes redundant HSPs. */
+        Blast_HSPListPurgeHSPsWithCommonEndpoints(program_number, hsp_list, TRUE);
+
+        /* For nucleotide search, if match score is = 2, the odd scores
+           are rounded down to the nearest even number. */
+#if 0
+        Blast_HSPListAdjustOddBlastnScores(hsp_list, score_options->gapped_calculation, gap_align->sbp);
+#endif
+
+    }
+
+    Blast_HSPListSortByScore(hsp_list);
+
+
+    if (score_options->is_ooframe && kTranslatedSubject)
+        subject->length = prot_length;
+    } else {
+        BLAST_GetUngappedHSPList(init_hitlist, query_info, subject,
+                hit_params->options, &hsp_list);
+    }
+
+    /* The subject ordinal id is not yet filled in this HSP list */
+    if (hsp_list)
+        hsp_list->oid = subject->oid;
+
+    *hsp_list_ptr = hsp_list;
+    return status;
+}
+
+/** One chunk of a long subject sequence; the chunks are searched by whichever
+ * preliminary search thread claims them first */
+typedef struct SSubjectChunkTask {
+    BLAST_SequenceBlk subject; /**< The chunk; shares the sequence data with
+                                    the whole subject, but owns its
+                                    seq_ranges */
+    Int4 offset;            /**< Offset of the chunk in the subject */
+    Int4 overlap;           /**< Overlap with the previous chunk */
+    Int8 residues;          /**< Residues credited to the thread searching
+                                 this chunk */
+    Int2 status;            /**< Return value of the chunk search */
+    BlastHSPList* hsp_list; /**< HSPs found in the chunk */
+} SSubjectChunkTask;
+
+/** All chunks of one context of a long subject sequence */
+typedef struct SSubjectSplitJob {
+    SSubjectChunkTask* tasks;      /**< Chunks in subject order */
+    Int4 num_tasks;                /**< Number of chunks */
+    Int4 next_task;                /**< First chunk not claimed yet */
+    Int4 num_done;                 /**< Number of chunks searched so far */
+    Int8 helper_residues;          /**< Residues searched by the threads
+                                        other than the owner */
+    struct SSubjectSplitJob* next; /**< Next job in the queue */
+} SSubjectSplitJob;
+
+/** Jobs posted by the preliminary search threads */
+struct BlastSubjectSplitQueue {
+    MT_LOCK lock;           /**< Protects the whole queue */
+    SSubjectSplitJob* jobs; /**< Jobs in the order they were posted */
+    TBlastSplitWaitFn wait_fn;     /**< Sleeps until signalled, optional */
+    TBlastSplitSignalFn signal_fn; /**< Wakes the sleeping threads */
+    void* wait_data;        /**< Argument of wait_fn and signal_fn */
+};
+
+/** Everything a thread needs to search a chunk posted by another thread.
+ * All pointers refer to the calling thread's own structures. */
+typedef struct SSubjectSplitContext {
+    BlastSubjectSplitQueue* queue; /**< Queue shared by all threads */
+    EBlastProgramType program_number; /**< BLAST program type */
+    BLAST_SequenceBlk* query;       /**< Query sequence structure */
+    BlastQueryInfo* query_info;     /**< Query information */
+    LookupTableWrap* lookup;        /**< Lookup table */
+    BlastGapAlignStruct* gap_align; /**< Gapped alignment structure */
+    const BlastScoringParameters* score_params; /**< Scoring parameters */
+    const BlastInitialWordParameters* word_params; /**< Word parameters */
+    const BlastExtensionParameters* ext_params; /**< Extension parameters */
+    const BlastHitSavingParameters* hit_params; /**< Hit saving parameters */
+    BlastDiagnostics* diagnostics;  /**< Diagnostics of this thread */
+    BlastCoreAuxStruct* aux_struct; /**< Auxiliary structures */
+    Int4 num_frames;        /**< Frames searched for the current subject */
+    Int8 num_residues;      /**< Residues searched by this thread */
+} SSubjectSplitContext;
+
+BlastSubjectSplitQueue* BlastSubjectSplitQueueNew(MT_LOCK lock,
+                                                  TBlastSplitWaitFn wait_fn,
+                                                  TBlastSplitSignalFn signal_fn,
+                                                  void* wait_data)
+{
+    BlastSubjectSplitQueue* queue =
+        (BlastSubjectSplitQueue*) calloc(1, sizeof(BlastSubjectSplitQueue));
+    ASSERT((wait_fn == NULL) == (signal_fn == NULL));
+    if (queue) {
+        queue->lock = lock;
+        queue->wait_fn = wait_fn;
+        queue->signal_fn = signal_fn;
+        queue->wait_data = wait_data;
+    } else {
+        MT_LOCK_Delete(lock);
+    }
+    return queue;
+}
+
+BlastSubjectSplitQueue* BlastSubjectSplitQueueFree(BlastSubjectSplitQueue* queue)
+{
+    if (!queue)
+        return NULL;
+    /* Every job is removed by its owner before the owner moves on */
+    ASSERT(queue->jobs == NULL);
+    MT_LOCK_Delete(queue->lock);
+    sfree(queue);
+    return NULL;
+}
+
+/** Claims the next chunk nobody has started on, preferring the chunks of
+ * the given job.
+ * @param queue The shared queue [in]
+ * @param job Job to take the chunk from if it still has one [in, optional]
+ * @param task_index Index of the claimed chunk in its job [out]
+ * @return The job the claimed chunk belongs to, NULL if all chunks in the
+ *         queue have been claimed
+ */
+static SSubjectSplitJob*
+s_SubjectSplitQueueClaim(BlastSubjectSplitQueue* queue,
+                         SSubjectSplitJob* job, Int4* task_index)
+{
+    SSubjectSplitJob* found = NULL;
+
+    MT_LOCK_Do(queue->lock, eMT_Lock);
+    if (job && job->next_task < job->num_tasks) {
+        found = job;
+    } else {
+        for (found = queue->jobs; found; found = found->next) {
+            if (found->next_task < found->num_tasks) break;
+        }
+    }
+    if (found) {
+        *task_index = found->next_task++;
+    }
+    MT_LOCK_Do(queue->lock, eMT_Unlock);
+    return found;
+}
+
+/** Checks whether any chunk in the queue is still unclaimed. The caller
+ * must hold the queue lock.
+ * @param queue The shared queue [in]
+ * @return TRUE if a chunk can be claimed
+ */
+static Boolean
+s_SubjectSplitQueueHasWork(const BlastSubjectSplitQueue* queue)
+{
+    const SSubjectSplitJob* job;
+
+    for (job = queue->jobs; job; job = job->next) {
+        if (job->next_task < job->num_tasks) return TRUE;
+    }
+    return FALSE;
+}
+
+/** Wakes the threads sleeping in s_SubjectSplitQueueWait. The caller must
+ * hold the queue lock.
+ * @param queue The shared queue [in]
+ */
+static void
+s_SubjectSplitQueueSignal(BlastSubjectSplitQueue* queue)
+{
+    if (queue->signal_fn) {
+        (*queue->signal_fn)(queue->wait_data);
+    }
+}
+
+/** Searches a claimed chunk and reports it done. The job must not be
+ * touched afterwards, because its owner may free it right away.
+ * @param split Context of the calling thread [in] [out]
+ * @param job The job the chunk belongs to [in] [out]
+ * @param task_index Index of the chunk in the job [in]
+ * @param is_owner TRUE if the calling thread posted the job [in]
+ */
+static void
+s_SearchChunkTask(SSubjectSplitContext* split, SSubjectSplitJob* job,
+                  Int4 task_index, Boolean is_owner)
+{
+    SSubjectChunkTask* task = &job->tasks[task_index];
+
+    task->status =
+        s_SearchSubjectChunk(split->program_number, split->query,
+                             split->query_info, &task->subject,
+                             task->subject.length, task->offset,
+                             split->lookup, split->gap_align,
+                             split->score_params, split->word_params,
+                             split->ext_params, split->hit_params,
+                             split->diagnostics, split->aux_struct,
+                             &task->hsp_list);
+
+    MT_LOCK_Do(split->queue->lock, eMT_Lock);
+    job->num_done++;
+    if (!is_owner) {
+        job->helper_residues += task->residues;
+        split->num_residues += task->residues;
+        if (job->num_done == job->num_tasks) {
+            /* The owner may be sleeping until its last chunk is done */
+            s_SubjectSplitQueueSignal(split->queue);
+        }
+    }
+    MT_LOCK_Do(split->queue->lock, eMT_Unlock);
+}
+
+/** Searches the chunks other threads have posted until none are left
+ * unclaimed. Called between subjects and once a thread runs out of them.
+ * @param split Context of the calling thread [in] [out]
+ */
+static void
+s_HelpSearchSubjectChunks(SSubjectSplitContext* split)
+{
+    SSubjectSplitJob* job;
+    Int4 task_index;
+
+    while ((job = s_SubjectSplitQueueClaim(split->queue, NULL,
+                                           &task_index)) != NULL) {
+        s_SearchChunkTask(split, job, task_index, FALSE);
+    }
+}
+
+/** Splits one context of a long subject into chunks, exactly as the serial
+ * loop in s_BlastSearchEngineOneContext does, and searches the chunks
+ * together with the other threads. The calling thread claims its own chunks
+ * first, helps with other jobs when its own are all claimed, and waits only
+ * for the chunks still being searched elsewhere. The chunk results are then
+ * merged in subject order, so the HSPs are the same as in a serial search.
+ * @param split Context of the calling thread [in] [out]
+ * @param subject Subject sequence, backed up in @a backup [in]
+ * @param backup Backup of the subject used for splitting [in] [out]
+ * @param dbseq_chunk_overlap Overlap between adjacent chunks [in]
+ * @param hsp_list_out_ptr Combined HSPs for the whole context [out]
+ * @param interrupt_search function callback to allow interruption of BLAST
+ *                   search [in, optional]
+ * @param progress_info contains information about the progress of the current
+ *                   BLAST search [in|out]
+ */
+static Int2
+s_SearchSubjectChunksShared(SSubjectSplitContext* split,
+        BLAST_SequenceBlk* subject, SubjectSplitStruct* backup,
+        Int4 dbseq_chunk_overlap, BlastHSPList** hsp_list_out_ptr,
+        TInterruptFnPtr interrupt_search, SBlastProgress* progress_info)
+{
+    Int2 status = 0;
+    BlastHSPList* combined_hsp_list = NULL;
+    SSubjectSplitJob job;
+    SSubjectSplitJob* claimed;
+    SSubjectSplitJob** link;
+    Int4 allocated = 0;
+    Int4 task_index;
+    Int4 i;
+    Boolean waiting = TRUE;
+    const EBlastProgramType kProgram = split->program_number;
+    const BlastScoringOptions* score_options = split->score_params->options;
+    const BlastHitSavingOptions* hit_options = split->hit_params->options;
+    const Boolean kNucleotide = Blast_ProgramIsNucleotide(kProgram);
+    const int kHspNumMax = BlastHspNumMax(score_options->gapped_calculation,
+                                          hit_options);
+
+    memset(&job, 0, sizeof(job));
+
+    while (TRUE) {
+        SSubjectChunkTask* task;
+
+        status = s_GetNextSubjectChunk(subject, backup, kNucleotide,
+                                       dbseq_chunk_overlap);
+        if (status == SUBJECT_SPLIT_DONE) break;
+        if (status == SUBJECT_SPLIT_NO_RANGE) continue;
+        ASSERT(status == SUBJECT_SPLIT_OK);
+
+        if (job.num_tasks == allocated) {
+            SSubjectChunkTask* tasks;
+            allocated = allocated ? 2 * allocated : 8;
+            tasks = (SSubjectChunkTask*)
+                realloc(job.tasks, allocated * sizeof(SSubjectChunkTask));
+            if (!tasks) {
+                status = BLASTERR_MEMORY;
+                break;
+            }
+            job.tasks = tasks;
+        }
+        task = &job.tasks[job.num_tasks];
+        memset(task, 0, sizeof(SSubjectChunkTask));
+        task->subject = *subject;
+        task->subject.seq_ranges = (SSeqRange*)
+            BlastMemDup(subject->seq_ranges,
+                        subject->num_seq_ranges * sizeof(SSeqRange));
+        if (!task->subject.seq_ranges) {
+            status = BLASTERR_MEMORY;
+            break;
+        }
+        task->offset = backup->offset;
+        task->overlap =
+            (backup->offset == backup->hard_ranges[backup->hm_index].left) ?
+            0 : dbseq_chunk_overlap;
+        /* A translated subject is accounted in nucleotides, once for all
+           of its frames */
+        task->residues = Blast_SubjectIsTranslated(kProgram) ?
+            (Int8)subject->length * CODON_LENGTH / MAX(split->num_frames, 1) :
+            subject->length;
+        job.num_tasks++;
+    }
+
+    if (status) {
+        for (i = 0; i < job.num_tasks; i++) {
+            sfree(job.tasks[i].subject.seq_ranges);
+        }
+        sfree(job.tasks);
+        return status;
+    }
+
+    /* Post the job at the end of the queue and claim its first chunk */
+    task_index = 0;
+    MT_LOCK_Do(split->queue->lock, eMT_Lock);
+    job.next_task = (job.num_tasks > 0) ? 1 : 0;
+    for (link = &split->queue->jobs; *link; link = &(*link)->next)
+        ;
+    *link = &job;
+    if (job.num_tasks > 1) {
+        /* Threads sleeping until their own jobs finish can help with it */
+        s_SubjectSplitQueueSignal(split->queue);
+    }
+    MT_LOCK_Do(split->queue->lock, eMT_Unlock);
+    if (job.num_tasks > 0) {
+        s_SearchChunkTask(split, &job, task_index, TRUE);
+    }
+
+    while (waiting) {
+        claimed = s_SubjectSplitQueueClaim(split->queue, &job, &task_index);
+        if (claimed) {
+            s_SearchChunkTask(split, claimed, task_index, claimed == &job);
+            continue;
+        }
+        /* Nothing left to claim: sleep until the chunks of this job that
+           other threads are still searching are done, or until another
+           thread posts chunks this one can help with */
+        MT_LOCK_Do(split->queue->lock, eMT_Lock);
+        if (job.num_done == job.num_tasks) {
+            for (link = &split->queue->jobs; *link != &job;
+                 link = &(*link)->next)
+                ;
+            *link = job.next;
+            waiting = FALSE;
+        } else if (split->queue->wait_fn &&
+                   !s_SubjectSplitQueueHasWork(split->queue)) {
+            (*split->queue->wait_fn)(split->queue->wait_data);
+        }
+        MT_LOCK_Do(split->queue->lock, eMT_Unlock);
+    }
+
+    /* Whatever the other threads searched is not this thread's load */
+    split->num_residues -= job.helper_residues;
+
+    for (i = 0; i < job.num_tasks; i++) {
+        SSubjectChunkTask* task = &job.tasks[i];
+
+        if (status == 0 && task->status) {
+            status = task->status;
+        }
+        if (status == 0 && task->hsp_list && task->hsp_list->hspcnt > 0) {
+            /* check for interrupt */
+            if (interrupt_search &&
+                (*interrupt_search)(progress_info) == TRUE) {
+                combined_hsp_list = Blast_HSPListFree(combined_hsp_list);
+                status = BLASTERR_INTERRUPTED;
+            } else {
+                Blast_HSPListAdjustOffsets(task->hsp_list, task->offset);
+                Blast_HSPListsMerge(&task->hsp_list, &combined_hsp_list,
+                             kHspNumMax, &task->offset, INT4_MIN,
+                             task->overlap, score_options->gapped_calculation,
+                             Blast_ProgramIsMapping(kProgram));
+
+                if ((hit_options->hsp_filt_opt != NULL) &&
+                    (hit_options->hsp_filt_opt->subject_besthit_opts != NULL)) {
+                    Blast_HSPListSubjectBestHit(kProgram,
+                            hit_options->hsp_filt_opt->subject_besthit_opts,
+                            split->query_info, combined_hsp_list);
+                }
+            }
+        }
+        task->hsp_list = Blast_HSPListFree(task->hsp_list);
+        sfree(task->subject.seq_ranges);
+    }
+    sfree(job.tasks);
+
+    *hsp_list_out_ptr = combined_hsp_list;
+    return status;
+}
+
 /** Searches only one context of a database sequence, but does all chunks if it is split.
  * @param program_number BLAST program type [in]
  * @param query Query sequence structure [in]
@@ -413,6 +912,8 @@ s_RPSOffsetArrayToContextOffsets(BlastQueryInfo    * info,
  * @param diagnostics Hit counts and other diagnostics [in] [out]
  * @param aux_struct Structure containing different auxiliary data and memory
  *                   for the preliminary stage of the BLAST search [in]
+ * @param split Context for sharing the chunks of a long subject with other
+ *                   threads, NULL to search all chunks in this thread [in]
  * @param hsp_list_out_ptr List of HSPs found for a given subject sequence [out]
  * @param interrupt_search function callback to allow interruption of BLAST
  *                   search [in, optional]
@@ -431,6 +932,7 @@ s_BlastSearchEngineOneContext(EBlastProgramType program_number,
         const BlastHitSavingParameters* hit_params,
         BlastDiagnostics* diagnostics,
         BlastCoreAuxStruct* aux_struct,
+        SSubjectSplitContext* split,
         BlastHSPList** hsp_list_out_ptr,
         TInterruptFnPtr interrupt_search,
         SBlastProgress* progress_info)
@@ -438,18 +940,9 @@ s_BlastSearchEngineOneContext(EBlastProgramType program_number,
     Int2 status = 0; /* return value */
     BlastHSPList* combined_hsp_list = NULL;
     BlastHSPList* hsp_list = NULL;
-    BlastInitHitList* init_hitlist = aux_struct->init_hitlist;
     BlastScoringOptions* score_options = score_params->options;
-    BlastUngappedStats* ungapped_stats = NULL;
-    BlastGappedStats* gapped_stats = NULL;
-    Int4 **matrix = (gap_align->positionBased) ?
-                     gap_align->sbp->psi_matrix->pssm->data :
-                     gap_align->sbp->matrix->data;
-    const Boolean kTranslatedSubject =
-       (Blast_SubjectIsTranslated(program_number) || program_number == eBlastTypeRpsTblastn);
     const Boolean kNucleotide = Blast_ProgramIsNucleotide(program_number);
     const int kHspNumMax = BlastHspNumMax(score_options->gapped_calculation, hit_params->options);
-    const int kScanSubjectOffsetArraySize = GetOffsetArraySize(lookup);
     Int4 dbseq_chunk_overlap;
     Int4 overlap;
 
@@ -469,13 +962,19 @@ s_BlastSearchEngineOneContext(EBlastProgramType program_number,
         dbseq_chunk_overlap = DBSEQ_CHUNK_OVERLAP;
     }
 
-    if (diagnostics) {
-        ungapped_stats = diagnostics->ungapped_stat;
-        gapped_stats = diagnostics->gapped_stat;
-    }
-
     s_BackupSubject(subject, &backup);
 
+    /* Share the chunks of a long subject with the other threads */
+    if (split && subject->length > MAX_DBSEQ_LEN) {
+        status = s_SearchSubjectChunksShared(split, subject, &backup,
+                                             dbseq_chunk_overlap,
+                                             &combined_hsp_list,
+                                             interrupt_search, progress_info);
+        s_RestoreSubject(subject, &backup);
+        *hsp_list_out_ptr = combined_hsp_list;
+        return status;
+    }
+
     while (TRUE) {
         status = s_GetNextSubjectChunk(subject, &backup, kNucleotide,
                                        dbseq_chunk_overlap);
@@ -489,89 +988,19 @@ s_BlastSearchEngineOneContext(EBlastProgramType program_number,
         /* Delete if not done in last loop iteration to prevent memory leak. */
         hsp_list = Blast_HSPListFree(hsp_list);
 
-        BlastInitHitListReset(init_hitlist);
-
-        if (aux_struct->WordFinder) {
-            aux_struct->WordFinder(subject, query, query_info, lookup, matrix,
-                                   word_params, aux_struct->ewp,
-                                   aux_struct->offset_pairs,
-                                   kScanSubjectOffsetArraySize,
-                                   init_hitlist, ungapped_stats);
-
-            if (init_hitlist->total == 0) continue;
-        }
-
-        if (score_options->gapped_calculation) {
-            Int4 prot_length = 0;
-            if (score_options->is_ooframe) {
-                /* Convert query offsets in all HSPs into the mixed-frame
-                   coordinates */
-                s_TranslateHSPsToDNAPCoord(program_number, init_hitlist,
-                       query_info, subject->frame, orig_length, backup.offset);
-                if (kTranslatedSubject) {
-                    prot_length = subject->length;
-                    subject->length = orig_length;
-                }
-            }
-        /** NB: If queries are concatenated, HSP offsets must be adjusted
-          * inside the following function call, so coordinates are
-          * relative to the individual contexts (i.e. queries, strands or
-          * frames). Contexts should also be filled in HSPs when they
-          * are saved.
-          */
-        /* fence_hit is null, since this is only for prelim stage. */
-        if (aux_struct->GetGappedScore) {
-            status = aux_struct->GetGappedScore(program_number, query,
-                    query_info,
-                    subject, gap_align, score_params, ext_params, hit_params,
-                    init_hitlist, &hsp_list, gapped_stats, NULL);
-        }
-        else if (aux_struct->JumperGapped) {
-            status = aux_struct->JumperGapped(subject, query, query_info,
-                                              lookup, word_params,
-                                              score_params, hit_params,
-                                              aux_struct->offset_pairs,
-                                              aux_struct->mapper_wordhits,
-                                              kScanSubjectOffsetArraySize,
-                                              gap_align, init_hitlist,
-                                              &hsp_list, ungapped_stats,
-                                              gapped_stats);
-        }
+        status = s_SearchSubjectChunk(program_number, query, query_info,
+                                      subject, orig_length, backup.offset,
+                                      lookup, gap_align, score_params,
+                                      word_params, ext_params, hit_params,
+                                      diagnostics, aux_struct, &hsp_list);
         if (status) break;
 
-        /* No need to do this for short reads */
-        if (aux_struct->GetGappedScore) {
-
-            /* Removes redundant HSPs. */
-            Blast_HSPListPurgeHSPsWithCommonEndpoints(program_number, hsp_list, TRUE);
-
-            /* For nucleotide search, if match score is = 2, the odd scores
-               are rounded down to the nearest even number. */
-#if 0
-            Blast_HSPListAdjustOddBlastnScores(hsp_list, score_options->gapped_calculation, gap_align->sbp);
-#endif
-
-        }
-
-        Blast_HSPListSortByScore(hsp_list);
-
-
-        if (score_options->is_ooframe && kTranslatedSubject)
-            subject->length = prot_length;
-        } else {
-            BLAST_GetUngappedHSPList(init_hitlist, query_info, subject,
-                    hit_params->options, &hsp_list);
-        }
-
-        if (hsp_list->hspcnt == 0) continue;
-
-        /* The subject ordinal id is not yet filled in this HSP list */
-        hsp_list->oid = subject->oid;
+        if (!hsp_list || hsp_list->hspcnt == 0) continue;
 
         /* check for interrupt */
         if (interrupt_search && (*interrupt_search)(progress_info) == TRUE) {
             combined_hsp_list = Blast_HSPListFree(combined_hsp_list);
-            BlastInitHitListReset(init_hitlist);
+            BlastInitHitListReset(aux_struct->init_hitlist);
             status = BLASTERR_INTERRUPTED;
             break;
         }
@@ -693,6 +1122,8 @@ s_Blast_HSPListReapByPrelimEvalue(BlastHSPList* hsp_list, const BlastHitSavingPa
  * @param diagnostics Hit counts and other diagnostics [in] [out]
  * @param aux_struct Structure containing different auxiliary data and memory
  *                   for the preliminary stage of the BLAST search [in]
+ * @param split Context for sharing the chunks of a long subject with other
+ *                   threads [in, optional]
  * @param hsp_list_out_ptr List of HSPs found for a given subject sequence [in]
  * @param interrupt_search function callback to allow interruption of BLAST
  *                   search [in, optional]
@@ -713,6 +1144,7 @@ s_BlastSearchEngineCore(EBlastProgramType program_number,
         const BlastDatabaseOptions* db_options,
         BlastDiagnostics* diagnostics,
         BlastCoreAuxStruct* aux_struct,
+        SSubjectSplitContext* split,
         BlastHSPList** hsp_list_out_ptr,
         TInterruptFnPtr interrupt_search,
         SBlastProgress* progress_info)
@@ -792,6 +1224,9 @@ s_BlastSearchEngineCore(EBlastProgramType program_number,
         last_context = 0;
     }
 
+    if (split) {
+        split->num_frames = last_context - first_context + 1;
+    }
 
     /* Substitute query info by concatenated database info for RPS BLAST search */
     if (isRPS) {
@@ -838,7 +1273,8 @@ s_BlastSearchEngineCore(EBlastProgramType program_number,
                                                gap_align, score_params,
                                                word_params, ext_params,
                                                hit_params, diagnostics,
-                                               aux_struct, &hsp_list_for_chunks,
+                                               aux_struct, split,
+                                               &hsp_list_for_chunks,
                                                interrupt_search, progress_info);
         if (status != 0)  break;
 
@@ -1169,7 +1605,7 @@ s_RPSPreliminarySearchEngine(EBlastProgramType program_number,
           s_BlastSearchEngineCore(program_number, &concat_db, one_query_info,
              one_query, lookup_wrap, gap_align, score_params,
              word_params, ext_params, hit_params, NULL,
-             diagnostics, aux_struct, &hsp_list, interrupt_search,
+             diagnostics, aux_struct, NULL, &hsp_list, interrupt_search,
              progress_info);
 
         if (interrupt_search && (*interrupt_search)(progress_info) == TRUE) {
@@ -1329,8 +1765,13 @@ static Int4 s_GetMinimumSubjSeqLen(LookupTableWrap* lookup_wrap)
 }
 
 
-Int4
-BLAST_PreliminarySearchEngine(EBlastProgramType program_number,
+/** Does the work of BLAST_PreliminarySearchEngine.
+ * @param split_queue Queue for sharing the chunks of long subjects with the
+ *                    other threads searching the same database [in, optional]
+ * See BLAST_PreliminarySearchEngine for the other parameters.
+ */
+static Int4
+s_PreliminarySearchEngine(EBlastProgramType program_number,
     BLAST_SequenceBlk* query, BlastQueryInfo* query_info,
     const BlastSeqSrc* seq_src, BlastGapAlignStruct* gap_align,
     BlastScoringParameters* score_params,
@@ -1342,7 +1783,8 @@ BLAST_PreliminarySearchEngine(EBlastProgramType program_number,
     const PSIBlastOptions* psi_options,
     const BlastDatabaseOptions* db_options,
     BlastHSPStream* hsp_stream, BlastDiagnostics* diagnostics,
-    TInterruptFnPtr interrupt_search, SBlastProgress* progress_info)
+    TInterruptFnPtr interrupt_search, SBlastProgress* progress_info,
+    BlastSubjectSplitQueue* split_queue)
 {
     BlastCoreAuxStruct* aux_struct = NULL;
     BlastHSPList* hsp_list = NULL;
@@ -1358,6 +1800,10 @@ BLAST_PreliminarySearchEngine(EBlastProgramType program_number,
     BlastScoreBlk* sbp = gap_align->sbp;
     BlastSeqSrcIterator* itr;
     const Boolean kNucleotide = Blast_ProgramIsNucleotide(program_number);
+    Int8 num_subjects = 0;   /* subjects searched by this thread */
+    Int8 num_residues = 0;   /* subject residues searched by this thread */
+    SSubjectSplitContext split_context;
+    SSubjectSplitContext* split = NULL;
 
     T_MB_IdbCheckOid check_index_oid =
         (T_MB_IdbCheckOid)lookup_wrap->check_index_oid;
@@ -1404,6 +1850,33 @@ BLAST_PreliminarySearchEngine(EBlastProgramType program_number,
 
     db_length = BlastSeqSrcGetTotLen(seq_src);
 
+    /* Long subjects are shared only if every thread searches them with the
+       same parameters and no per-thread state: not in a search against
+       individual subjects, whose parameters are recalculated per subject,
+       not with a database index, and not where the chunk search depends on
+       the whole subject (out-of-frame, mapping, or link cutoffs calculated
+       per subject). */
+    if (split_queue && db_length != 0 && check_index_oid == 0 &&
+        !score_options->is_ooframe &&
+        !Blast_ProgramIsMapping(program_number) &&
+        !(hit_params->link_hsp_params && !kNucleotide &&
+          !gapped_calculation)) {
+        memset((void*) &split_context, 0, sizeof(split_context));
+        split_context.queue = split_queue;
+        split_context.program_number = program_number;
+        split_context.query = query;
+        split_context.query_info = query_info;
+        split_context.lookup = lookup_wrap;
+        split_context.gap_align = gap_align;
+        split_context.score_params = score_params;
+        split_context.word_params = word_params;
+        split_context.ext_params = ext_params;
+        split_context.hit_params = hit_params;
+        split_context.diagnostics = diagnostics;
+        split_context.aux_struct = aux_struct;
+        split = &split_context;
+    }
+
     itr = BlastSeqSrcIteratorNewEx(MAX(BlastSeqSrcGetNumSeqs(seq_src)/100,1));
 
     /* iterate over all subject sequences */
@@ -1442,6 +1915,8 @@ BLAST_PreliminarySearchEngine(EBlastProgramType program_number,
       }
 
       stat_length = seq_arg.seq->length;
+      num_subjects++;
+      num_residues += seq_arg.seq->length;
 
       /* Calculate cutoff scores for linking HSPs. Do this only for
          ungapped protein searches and ungapped translated
@@ -1469,7 +1944,7 @@ BLAST_PreliminarySearchEngine(EBlastProgramType program_number,
                                   seq_arg.seq, lookup_wrap, gap_align,
                                   score_params, word_params, ext_params,
                                   hit_params, db_options, diagnostics,
-                                  aux_struct, &hsp_list,
+                                  aux_struct, split, &hsp_list,
                                   interrupt_search, progress_info);
       if (status) {
           break;
@@ -1579,6 +2054,17 @@ BLAST_PreliminarySearchEngine(EBlastProgramType program_number,
           status = BLASTERR_INTERRUPTED;
           break;
       }
+
+      /* Help with the long subjects of other threads before taking the
+         next subject of our own */
+      if (split) {
+          s_HelpSearchSubjectChunks(split);
+      }
+    }
+
+    /* Out of subjects: help the threads still searching long ones */
+    if (split && status == 0) {
+        s_HelpSearchSubjectChunks(split);
     }
 
     /* Tell the indexing library that this thread is done with
@@ -1599,11 +2085,42 @@ BLAST_PreliminarySearchEngine(EBlastProgramType program_number,
                               ext_params, hit_params);
     }
 
+    /* Report how much of the database this thread searched, including the
+       chunks it searched for other threads and excluding its own chunks
+       searched by them */
+    if (split) {
+        num_residues += split->num_residues;
+    }
+    Blast_DiagnosticsAddThreadLoad(diagnostics, num_subjects, num_residues);
+
     word_params = BlastInitialWordParametersFree(word_params);
     s_BlastCoreAuxStructFree(aux_struct);
     return status;
 }
 
+Int4
+BLAST_PreliminarySearchEngine(EBlastProgramType program_number,
+    BLAST_SequenceBlk* query, BlastQueryInfo* query_info,
+    const BlastSeqSrc* seq_src, BlastGapAlignStruct* gap_align,
+    BlastScoringParameters* score_params,
+    LookupTableWrap* lookup_wrap,
+    const BlastInitialWordOptions* word_options,
+    BlastExtensionParameters* ext_params,
+    BlastHitSavingParameters* hit_params,
+    BlastEffectiveLengthsParameters* eff_len_params,
+    const PSIBlastOptions* psi_options,
+    const BlastDatabaseOptions* db_options,
+    BlastHSPStream* hsp_stream, BlastDiagnostics* diagnostics,
+    TInterruptFnPtr interrupt_search, SBlastProgress* progress_info)
+{
+    return s_PreliminarySearchEngine(program_number, query, query_info,
+                                     seq_src, gap_align, score_params,
+                                     lookup_wrap, word_options, ext_params,
+                                     hit_params, eff_len_params, psi_options,
+                                     db_options, hsp_stream, diagnostics,
+                                     interrupt_search, progress_info, NULL);
+}
+
 Int2
 Blast_RunPreliminarySearch(EBlastProgramType program,
     BLAST_SequenceBlk* query,
@@ -1644,6 +2161,32 @@ Blast_RunPreliminarySearchWithInterrupt(EBlastProgramType program,
     BlastHSPStream* hsp_stream,
     BlastDiagnostics* diagnostics,
     TInterruptFnPtr interrupt_search, SBlastProgress* progress_info)
+{
+    return Blast_RunPreliminarySearchWithSplitQueue(program,
+           query, query_info, seq_src, score_options, sbp, lookup_wrap,
+           word_options, ext_options, hit_options, eff_len_options,
+           psi_options, db_options, hsp_stream, diagnostics,
+           interrupt_search, progress_info, NULL);
+}
+
+Int2
+Blast_RunPreliminarySearchWithSplitQueue(EBlastProgramType program,
+    BLAST_SequenceBlk* query,
+    BlastQueryInfo* query_info,
+    const BlastSeqSrc* seq_src,
+    const BlastScoringOptions* score_options,
+    BlastScoreBlk* sbp,
+    LookupTableWrap* lookup_wrap,
+    const BlastInitialWordOptions* word_options,
+    const BlastExtensionOptions* ext_options,
+    const BlastHitSavingOptions* hit_options,
+    const BlastEffectiveLengthsOptions* eff_len_options,
+    const PSIBlastOptions* psi_options,
+    const BlastDatabaseOptions* db_options,
+    BlastHSPStream* hsp_stream,
+    BlastDiagnostics* diagnostics,
+    TInterruptFnPtr interrupt_search, SBlastProgress* progress_info,
+    BlastSubjectSplitQueue* split_queue)
 {
     Int2 status = 0;
     BlastScoringParameters* score_params = NULL;/**< Scoring parameters */
@@ -1670,13 +2213,13 @@ Blast_RunPreliminarySearchWithInterrupt(EBlastProgramType program,
     }
 
     if ((status=
-        BLAST_PreliminarySearchEngine(program, query, query_info,
-                                      seq_src, gap_align, score_params,
-                                      lookup_wrap, word_options,
-                                      ext_params, hit_params, eff_len_params,
-                                      psi_options, db_options, hsp_stream,
-                                      local_diagnostics, interrupt_search,
-                                      progress_info)) != 0) {
+        s_PreliminarySearchEngine(program, query, query_info,
+                                  seq_src, gap_align, score_params,
+                                  lookup_wrap, word_options,
+                                  ext_params, hit_params, eff_len_params,
+                                  psi_options, db_options, hsp_stream,
+                                  local_diagnostics, interrupt_search,
+                                  progress_info, split_queue)) != 0) {
       gap_align = BLAST_GapAlignStructFree(gap_align);
       score_params = BlastScoringParametersFree(score_params);
       hit_params = BlastHitSavingParametersFree(hit_params);
@@ -34,6 +34,7 @@
 #include <algo/blast/core/blast_gapalign.h>
 #include <algo/blast/core/blast_util.h> /* for NCBI2NA_UNPACK_BASE macros */
 #include <algo/blast/core/greedy_align.h>
+#include <algo/blast/core/blast_sw.h>
 #include "blast_gapalign_priv.h"
 #include "blast_hits_priv.h"
 #include "blast_itree.h"
@@ -280,6 +281,7 @@ BLAST_GapAlignStructFree(BlastGapAlignStruct* gap_align)
       s_BlastGreedyAlignsFree(gap_align->greedy_align_mem);
    GapStateFree(gap_align->state_struct);
    sfree(gap_align->dp_mem);
+   sfree(gap_align->sw_mem);
    JumperGapAlignFree(gap_align->jumper);
 
    sfree(gap_align);
@@ -308,6 +310,7 @@ BLAST_GapAlignStructNew(const BlastScoringParameters* score_params,
    gap_align->gap_x_dropoff = ext_params->gap_x_dropoff;
    gap_align->max_mismatches = ext_params->options->max_mismatches;
    gap_align->mismatch_window = ext_params->options->mismatch_window;
+   gap_align->sw_engine = Blast_SmithWatermanGetEngine();
 
    /* allocate memory either for dynamic programming or jumper */
    if (ext_params->options->ePrelimGapExt != eJumperWithTraceback) {
@@ -2232,6 +2232,11 @@ s_MatrixInfoInit(Blast_MatrixInfo * self,
                                      self->ungappedLambda);
         }
     }
+    if (status == 0) {
+        /* Every subject rescales the matrix from these frequency
+         * ratios; take their logarithms once, up front. */
+        status = Blast_MatrixInfoSetLogFreqRatios(self);
+    }
     return status;
 }
 
@@ -3429,7 +3434,11 @@ Blast_RedoAlignmentCore_MT(EBlastProgramType program_number,
     status_code_tld)
     {
         int b;
-#pragma omp for schedule(static)
+        /* Matches are dealt out one at a time rather than in contiguous
+           blocks: the stream returns them best first, and the best matches
+           are usually the longest to realign, so contiguous blocks would
+           leave most of the work to the first thread */
+#pragma omp for schedule(static, 1)
         for (b = 0; b < numMatches; ++b) {
 #pragma omp flush(interrupt)
             if (!interrupt) {
@@ -29,6 +29,7 @@
  */
 
 #include <algo/blast/core/blast_nalookup.h>
+#include <algo/blast/core/blast_nascan.h>
 #include <algo/blast/core/lookup_util.h>
 #include <algo/blast/core/blast_encoding.h>
 #include <algo/blast/core/blast_util.h>
@@ -395,6 +396,7 @@ Int4 BlastSmallNaLookupTableNew(BLAST_SequenceBlk* query,
     lookup->mask = lookup->backbone_size - 1;
     lookup->overflow = NULL;
     lookup->scan_step = lookup->word_length - lookup->lut_word_length + 1;
+    lookup->scan_avx2 = BlastNaScanHaveAVX2();
 
     thin_backbone = (Int4 **) calloc(lookup->backbone_size, sizeof(Int4 *));
     ASSERT(thin_backbone != NULL);
@@ -1246,6 +1248,7 @@ Int2 BlastMBLookupTableNew(BLAST_SequenceBlk* query, BlastSeqLoc* location,
    mb_lt->stride = lookup_options->stride > 0;
    mb_lt->lut_word_length = lut_width;
    mb_lt->hashsize = 1ULL << (BITS_PER_NUC * mb_lt->lut_word_length);
+   mb_lt->scan_avx2 = BlastNaScanHaveAVX2();
 
    mb_lt->hashtable = (Int4*)calloc(mb_lt->hashsize, sizeof(Int4)); 
    if (mb_lt->hashtable == NULL) {
@@ -32,6 +32,82 @@
 #include <algo/blast/core/blast_nascan.h>
 #include <algo/blast/core/blast_util.h> /* for NCBI2NA_UNPACK_BASE */
 
+#if defined(__GNUC__)  &&  (defined(__x86_64__)  ||  defined(__i386__))  &&  \
+    (__GNUC__ > 4  ||  (__GNUC__ == 4  &&  __GNUC_MINOR__ >= 9)  ||  \
+     defined(__clang__))
+#  define BLAST_NASCAN_HAVE_AVX2
+#  include <immintrin.h>
+#endif
+
+#ifdef BLAST_NASCAN_HAVE_AVX2
+
+/** Number of subject words looked up per iteration of the AVX2 scanners */
+#define NA_SCAN_AVX2_WORDS 32
+
+/** Last subject offset whose four-byte window lies entirely inside the
+ * compressed subject sequence. The AVX2 scanners fetch four bytes per word
+ * regardless of the word size, and leave offsets past this one to the
+ * scalar scanners, which never read beyond the bytes they need.
+ * @param subject The (compressed) subject sequence [in]
+ * @return The last offset the AVX2 scanners may examine
+ */
+static NCBI_INLINE Int4 s_NaScanAVX2LastOffset(const BLAST_SequenceBlk *subject)
+{
+    return ((subject->length - 1) / COMPRESSION_RATIO - 3) * COMPRESSION_RATIO
+           + COMPRESSION_RATIO - 1;
+}
+
+/** Extract the lookup table words at eight evenly spaced subject offsets
+ * @param seq The compressed subject sequence [in]
+ * @param s_off Subject offset of the first word [in]
+ * @param scan_step Distance between successive words [in]
+ * @param lut_word_length Number of bases in a word, at most 12 [in]
+ * @param mask Mask that keeps the low 2*lut_word_length bits [in]
+ * @return The eight words, one per 32-bit lane
+ */
+__attribute__((target("avx2")))
+static NCBI_INLINE __m256i s_NaScanWordsAVX2(const Uint1 *seq, Int4 s_off,
+                                             Int4 scan_step,
+                                             Int4 lut_word_length,
+                                             Int4 mask)
+{
+    const __m256i kByteSwap = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4,
+                                               11, 10, 9, 8, 15, 14, 13, 12,
+                                               3, 2, 1, 0, 7, 6, 5, 4,
+                                               11, 10, 9, 8, 15, 14, 13, 12);
+    __m256i v_off = _mm256_add_epi32(_mm256_set1_epi32(s_off),
+                        _mm256_mullo_epi32(_mm256_set1_epi32(scan_step),
+                            _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)));
+    __m256i v_word = _mm256_shuffle_epi8(
+                        _mm256_i32gather_epi32((const int *)seq,
+                                   _mm256_srli_epi32(v_off, 2), 1),
+                        kByteSwap);
+
+    /* the word ends 2*(16 - (s_off % 4) - lut_word_length) bits
+       from the bottom of the 16 bases just fetched */
+    __m256i v_shift = _mm256_slli_epi32(
+                        _mm256_sub_epi32(
+                            _mm256_set1_epi32(16 - lut_word_length),
+                            _mm256_and_si256(v_off, _mm256_set1_epi32(3))),
+                        1);
+
+    return _mm256_and_si256(_mm256_srlv_epi32(v_word, v_shift),
+                            _mm256_set1_epi32(mask));
+}
+
+#endif /* BLAST_NASCAN_HAVE_AVX2 */
+
+Boolean BlastNaScanHaveAVX2(void)
+{
+#ifdef BLAST_NASCAN_HAVE_AVX2
+    /* libgcc fills in the CPU model before any user code runs, so there
+       is no need for __builtin_cpu_init here */
+    return __builtin_cpu_supports("avx2") ? TRUE : FALSE;
+#else
+    return FALSE;
+#endif
+}
+
 /**
 * Retrieve the number of query offsets associated with this subject word.
 * @param lookup The lookup table to read from. [in]
@@ -1291,6 +1367,95 @@ base_3:
     return total_hits;
 }
 
+#ifdef BLAST_NASCAN_HAVE_AVX2
+
+/** Scan the compressed subject sequence, returning 4-to-8-letter word hits
+ * with a stride that is not a multiple of 4. Words are extracted and looked up in the backbone
+ * NA_SCAN_AVX2_WORDS at a time using AVX2 gathers; hits are reported in
+ * the same order as s_BlastSmallNaScanSubject_Any, which also handles the
+ * last few words of the subject. Assumes a small-query nucleotide lookup 
+ * table
+ * @param lookup_wrap Pointer to the (wrapper to) lookup table [in]
+ * @param subject The (compressed) sequence to be scanned for words [in]
+ * @param offset_pairs Array of query and subject positions where words are 
+ *                found [out]
+ * @param max_hits The allocated size of the above array - how many offsets 
+ *        can be returned [in]
+ * @param scan_range The starting and ending pos to be scanned [in] 
+ *        on exit, scan_range[0] is updated to be the stopping pos [out]
+*/
+__attribute__((target("avx2")))
+static Int4 s_BlastSmallNaScanSubject_AVX2(
+                                const LookupTableWrap * lookup_wrap,
+                                const BLAST_SequenceBlk * subject,
+                                BlastOffsetPair * NCBI_RESTRICT offset_pairs,
+                                Int4 max_hits, Int4 * scan_range)
+{
+    BlastSmallNaLookupTable *lookup = 
+                        (BlastSmallNaLookupTable *) lookup_wrap->lut;
+    const Int4 kStep = lookup->scan_step;
+    const Int4 kLutWordLength = lookup->lut_word_length;
+    Int2 *backbone = lookup->final_backbone;
+    Int2 *overflow = lookup->overflow;
+    Int4 last_off = MIN(scan_range[1], s_NaScanAVX2LastOffset(subject));
+    Int4 total_hits = 0;
+    Int4 max_total = max_hits - lookup->longest_chain;
+
+    ASSERT(lookup_wrap->lut_type == eSmallNaLookupTable);
+    ASSERT(kLutWordLength <= 8);
+    ASSERT(kStep % COMPRESSION_RATIO != 0);
+
+    while (scan_range[0] + (NA_SCAN_AVX2_WORDS - 1) * kStep <= last_off) {
+        Int4 cell[NA_SCAN_AVX2_WORDS];
+        Uint4 hit_mask = 0;
+        Int4 i;
+
+        for (i = 0; i < NA_SCAN_AVX2_WORDS; i += 8) {
+            __m256i v_index = s_NaScanWordsAVX2(subject->sequence,
+                                                scan_range[0] + i * kStep,
+                                                kStep, kLutWordLength,
+                                                lookup->mask);
+            /* the backbone has an even number of cells, so fetching
+               the aligned pair that holds each cell is always safe */
+            __m256i v_cell = _mm256_i32gather_epi32(
+                                (const int *)backbone,
+                                _mm256_srli_epi32(v_index, 1), 4);
+            v_cell = _mm256_srai_epi32(
+                        _mm256_sllv_epi32(v_cell,
+                            _mm256_sub_epi32(_mm256_set1_epi32(16),
+                                _mm256_slli_epi32(_mm256_and_si256(v_index,
+                                            _mm256_set1_epi32(1)), 4))),
+                        16);
+            _mm256_storeu_si256((__m256i *)(cell + i), v_cell);
+            hit_mask |= (Uint4)_mm256_movemask_ps(_mm256_castsi256_ps(
+                            _mm256_cmpeq_epi32(v_cell,
+                                               _mm256_set1_epi32(-1))))
+                        << i;
+        }
+
+        hit_mask = ~hit_mask;
+        while (hit_mask) {
+            Int4 j = __builtin_ctz(hit_mask);
+            hit_mask &= hit_mask - 1;
+            if (total_hits > max_total) {
+                scan_range[0] += j * kStep;
+                return total_hits;
+            }
+            total_hits += s_BlastSmallNaRetrieveHits(offset_pairs, cell[j],
+                                                     scan_range[0] + j * kStep,
+                                                     total_hits, overflow);
+        }
+        scan_range[0] += NA_SCAN_AVX2_WORDS * kStep;
+    }
+
+    return total_hits + 
+           s_BlastSmallNaScanSubject_Any(lookup_wrap, subject,
+                                         offset_pairs + total_hits,
+                                         max_hits - total_hits, scan_range);
+}
+
+#endif /* BLAST_NASCAN_HAVE_AVX2 */
+
 /** Choose the most appropriate function to scan through
  * subject sequences, assuming a small-query blastn lookup table
  * @param lookup_wrap Structure containing lookup table [in][out]
@@ -1375,6 +1540,14 @@ static void s_SmallNaChooseScanSubject(LookupTableWrap *lookup_wrap)
         }
         break;
     }
+
+#ifdef BLAST_NASCAN_HAVE_AVX2
+    /* as in s_MBChooseScanSubject, prefer the AVX2 routine to the
+       general-purpose one when the stride is not a multiple of 4 */
+    if (lookup->scansub_callback == (void *)s_BlastSmallNaScanSubject_Any &&
+        scan_step % COMPRESSION_RATIO != 0 && lookup->scan_avx2)
+        lookup->scansub_callback = (void *)s_BlastSmallNaScanSubject_AVX2;
+#endif
 }
 
 /**
@@ -2595,6 +2768,83 @@ base_3:
    return total_hits;
 }
 
+#ifdef BLAST_NASCAN_HAVE_AVX2
+
+/** Scan the compressed subject sequence, returning 9-to-12 letter word hits
+ * with a stride that is not a multiple of 4. Words are extracted and tested against the 
+ * presence vector NA_SCAN_AVX2_WORDS at a time using AVX2 gathers; hits
+ * are reported in the same order as s_MBScanSubject_Any, which also
+ * handles the last few words of the subject. Assumes a contiguous megablast
+ * lookup table
+ * @param lookup_wrap Pointer to the (wrapper to) lookup table [in]
+ * @param subject The (compressed) sequence to be scanned for words [in]
+ * @param offset_pairs Array of query and subject positions where words are 
+ *                found [out]
+ * @param max_hits The allocated size of the above array - how many offsets 
+ *        can be returned [in]
+ * @param scan_range The starting and ending pos to be scanned [in] 
+ *        on exit, scan_range[0] is updated to be the stopping pos [out]
+*/
+__attribute__((target("avx2")))
+static Int4 s_MBScanSubject_AVX2(const LookupTableWrap* lookup_wrap,
+       const BLAST_SequenceBlk* subject, 
+       BlastOffsetPair* NCBI_RESTRICT offset_pairs, Int4 max_hits,  
+       Int4* scan_range)
+{
+    BlastMBLookupTable* mb_lt = (BlastMBLookupTable*) lookup_wrap->lut;
+    const Int4 kStep = mb_lt->scan_step;
+    const Int4 kLutWordLength = mb_lt->lut_word_length;
+    const Int4 kMask = (Int4)(mb_lt->hashsize - 1);
+    const __m128i kPvShift = _mm_cvtsi32_si128(mb_lt->pv_array_bts);
+    Int4 last_off = MIN(scan_range[1], s_NaScanAVX2LastOffset(subject));
+    Int4 total_hits = 0;
+    Int4 max_total = max_hits - mb_lt->longest_chain;
+
+    ASSERT(lookup_wrap->lut_type == eMBLookupTable);
+    ASSERT(!mb_lt->discontiguous);
+    ASSERT(kLutWordLength >= 9 && kLutWordLength <= 12);
+    ASSERT(kStep % COMPRESSION_RATIO != 0);
+
+    while (scan_range[0] + (NA_SCAN_AVX2_WORDS - 1) * kStep <= last_off) {
+        Int4 index[NA_SCAN_AVX2_WORDS];
+        Uint4 hit_mask = 0;
+        Int4 i;
+
+        for (i = 0; i < NA_SCAN_AVX2_WORDS; i += 8) {
+            __m256i v_index = s_NaScanWordsAVX2(subject->sequence,
+                                                scan_range[0] + i * kStep,
+                                                kStep, kLutWordLength, kMask);
+            __m256i v_pv = _mm256_i32gather_epi32((const int *)mb_lt->pv_array,
+                                       _mm256_srl_epi32(v_index, kPvShift), 
+                                       PV_ARRAY_BYTES);
+            v_pv = _mm256_srlv_epi32(v_pv, _mm256_and_si256(v_index,
+                                        _mm256_set1_epi32(PV_ARRAY_MASK)));
+            _mm256_storeu_si256((__m256i *)(index + i), v_index);
+            hit_mask |= (Uint4)_mm256_movemask_ps(_mm256_castsi256_ps(
+                            _mm256_slli_epi32(v_pv, 31))) << i;
+        }
+
+        while (hit_mask) {
+            Int4 j = __builtin_ctz(hit_mask);
+            hit_mask &= hit_mask - 1;
+            if (total_hits >= max_total) {
+                scan_range[0] += j * kStep;
+                return total_hits;
+            }
+            total_hits += s_BlastMBLookupRetrieve(mb_lt, index[j],
+                                                  offset_pairs + total_hits,
+                                                  scan_range[0] + j * kStep);
+        }
+        scan_range[0] += NA_SCAN_AVX2_WORDS * kStep;
+    }
+
+    return total_hits + 
+           s_MBScanSubject_Any(lookup_wrap, subject, offset_pairs + total_hits,
+                               max_hits - total_hits, scan_range);
+}
+
+#endif /* BLAST_NASCAN_HAVE_AVX2 */
+
 /** Choose the most appropriate function to scan through
  * subject sequences, assuming a megablast lookup table
  * @param lookup_wrap Structure containing lookup table [in][out]
@@ -2676,6 +2926,16 @@ static void s_MBChooseScanSubject(LookupTableWrap *lookup_wrap)
             mb_lt->scansub_callback = (void *)s_MBScanSubject_Any;
             break;
         }
+
+#ifdef BLAST_NASCAN_HAVE_AVX2
+        /* for strides that are not a multiple of 4 the general-purpose
+           routine recomputes the position of every word; the AVX2
+           routine does the same work for many words at once */
+        if (mb_lt->scansub_callback == (void *)s_MBScanSubject_Any &&
+            mb_lt->lut_word_length <= 12 &&
+            scan_step % COMPRESSION_RATIO != 0 && mb_lt->scan_avx2)
+            mb_lt->scansub_callback = (void *)s_MBScanSubject_AVX2;
+#endif
     }
 }
 
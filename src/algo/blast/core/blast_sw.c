@@ -238,6 +238,455 @@ static Int4 s_NuclSmithWaterman(const Uint1 *B, Int4 b_size,
    return final_best_score;
 }
 
+/* Striped Smith-Waterman score-only kernels, after
+ * <PRE>
+ * Michael Farrar, "Striped Smith-Waterman speeds database searches six
+ * times over other SIMD implementations". Bioinformatics, (2007),
+ * 23, pp. 156-161
+ * </PRE>
+ * One of the two sequences (the "striped" sequence) is laid out across
+ * the lanes of a vector register so that lane l of vector k holds
+ * position k + l * seg_len. Scores are kept in saturating 16-bit lanes;
+ * a result that reaches INT2_MAX is reported as an overflow and the
+ * caller recomputes it with the scalar routines above, so the final
+ * score never depends on the engine chosen.
+ */
+
+#if defined(NCBI_SSE)  &&  NCBI_SSE >= 20
+#  define BLAST_SW_HAVE_SSE2
+#  include <emmintrin.h>
+#  if (defined(__GNUC__)  &&  (__GNUC__ > 4  ||  \
+       (__GNUC__ == 4  &&  __GNUC_MINOR__ >= 9)))  ||  defined(__clang__)
+#    define BLAST_SW_HAVE_AVX2
+#    include <immintrin.h>
+#  endif
+#endif
+
+/** Largest vector width (in bytes) used by any striped kernel */
+#define SW_SIMD_MAX_BYTES 32
+
+/** Returned by the striped kernels when 16-bit scores saturate */
+#define SW_SIMD_OVERFLOW (-1)
+
+/** Number of 16-bit lanes in a vector of the given engine
+ * @param engine A SIMD engine [in]
+ * @return The number of lanes
+ */
+static Int4 s_SWLanes(ESmithWatermanEngine engine)
+{
+   return engine == eSWEngineAVX2 ? 16 : 8;
+}
+
+/* See blast_sw.h for details */
+ESmithWatermanEngine Blast_SmithWatermanGetEngine(void)
+{
+   ESmithWatermanEngine engine = eSWEngineScalar;
+#ifdef BLAST_SW_HAVE_SSE2
+   engine = eSWEngineSSE2;
+#endif
+#ifdef BLAST_SW_HAVE_AVX2
+   /* libgcc fills in the CPU model before any user code runs,
+      so __builtin_cpu_init is not needed */
+   if (__builtin_cpu_supports("avx2"))
+      engine = eSWEngineAVX2;
+#endif
+   return engine;
+}
+
+/** Resolve a requested engine to one that can run on this CPU
+ * @param engine The requested engine [in]
+ * @param gap_align Holds the engine chosen at setup [in]
+ * @return The engine to use
+ */
+static ESmithWatermanEngine s_SWResolveEngine(ESmithWatermanEngine engine,
+                                    const BlastGapAlignStruct *gap_align)
+{
+   ESmithWatermanEngine best = (ESmithWatermanEngine)gap_align->sw_engine;
+
+   /* structures not made by BLAST_GapAlignStructNew */
+   if (best == eSWEngineAuto)
+      best = Blast_SmithWatermanGetEngine();
+
+   if (engine == eSWEngineAuto || engine > best)
+      return best;
+   return engine;
+}
+
+#ifdef BLAST_SW_HAVE_SSE2
+
+/** Build the striped score profile of a sequence. Row r of the
+ *  profile holds the scores of residue r against every position of
+ *  the striped sequence, in striped order; positions past the end
+ *  of the sequence score INT2_MIN so they never start an alignment.
+ * @param profile The profile, num_residues rows of seg_len * lanes
+ *             entries each [out]
+ * @param matrix The score matrix, or the PSSM if Q is NULL [in]
+ * @param num_residues Number of residues that can occur in the
+ *             other sequence [in]
+ * @param Q The striped sequence, or NULL if matrix is a PSSM
+ *             whose rows are the positions of the striped sequence [in]
+ * @param q_size Length of the striped sequence [in]
+ * @param seg_len Number of vectors per profile row [in]
+ * @param lanes Number of 16-bit lanes per vector [in]
+ * @return TRUE if every score fits in 16 bits
+ */
+static Boolean s_SWBuildStripedProfile(Int2 *profile, Int4 **matrix,
+                                       Int4 num_residues,
+                                       const Uint1 *Q, Int4 q_size,
+                                       Int4 seg_len, Int4 lanes)
+{
+   Int4 r, k, l;
+
+   for (r = 0; r < num_residues; r++) {
+      Int2 *row = profile + r * seg_len * lanes;
+      for (k = 0; k < seg_len; k++) {
+         for (l = 0; l < lanes; l++) {
+            Int4 pos = k + l * seg_len;
+            Int4 score = INT2_MIN;
+
+            if (pos < q_size) {
+               score = Q ? matrix[r][Q[pos]] : matrix[pos][r];
+               if (score > INT2_MAX)
+                  return FALSE;
+               if (score < INT2_MIN)
+                  score = INT2_MIN;
+            }
+            row[k * lanes + l] = (Int2)score;
+         }
+      }
+   }
+   return TRUE;
+}
+
+/** Striped score-only Smith-Waterman with 128-bit vectors
+ * @param profile Striped profile of the striped sequence [in]
+ * @param seg_len Number of vectors per profile row [in]
+ * @param S The sequence that is walked one residue at a time [in]
+ * @param s_size Length of S [in]
+ * @param s_packed TRUE if S is in ncbi2na format [in]
+ * @param gap_open_extend Cost of a gap of length one [in]
+ * @param gap_extend Gap extension penalty [in]
+ * @param work Scratch space for 3 * seg_len vectors, aligned
+ *             to a vector boundary [in]
+ * @return The best score, or SW_SIMD_OVERFLOW
+ */
+static Int4 s_SWStripedSSE2(const Int2 *profile, Int4 seg_len,
+                            const Uint1 *S, Int4 s_size, Boolean s_packed,
+                            Int4 gap_open_extend, Int4 gap_extend,
+                            void *work)
+{
+   Int4 i, j, k;
+   __m128i *h_store = (__m128i *)work;
+   __m128i *h_load = h_store + seg_len;
+   __m128i *e_vec = h_load + seg_len;
+   const __m128i v_zero = _mm_setzero_si128();
+   const __m128i v_min = _mm_set1_epi16(INT2_MIN);
+   const __m128i v_min_lane0 = _mm_set_epi16(0, 0, 0, 0, 0, 0, 0, INT2_MIN);
+   const __m128i v_gap_oe = _mm_set1_epi16((Int2)gap_open_extend);
+   const __m128i v_gap_e = _mm_set1_epi16((Int2)gap_extend);
+   const __m128i v_no_open = _mm_set1_epi16(gap_open_extend == gap_extend);
+   __m128i v_max = v_zero;
+   Int2 lane_max[8];
+   Int4 best_score = 0;
+
+   for (j = 0; j < 3 * seg_len; j++)
+      h_store[j] = v_zero;
+
+   for (i = 0; i < s_size; i++) {
+      Int4 residue = s_packed ? NCBI2NA_UNPACK_BASE(S[i/4], (3-(i%4)))
+                              : S[i];
+      const __m128i *v_profile = (const __m128i *)profile + residue * seg_len;
+      __m128i v_f = v_min;
+      __m128i v_h = _mm_slli_si128(h_store[seg_len - 1], 2);
+      __m128i *tmp = h_load;
+      Boolean f_done = FALSE;
+
+      h_load = h_store;
+      h_store = tmp;
+
+      for (j = 0; j < seg_len; j++) {
+         __m128i v_e = e_vec[j];
+
+         v_h = _mm_adds_epi16(v_h, v_profile[j]);
+         v_h = _mm_max_epi16(v_h, v_e);
+         v_h = _mm_max_epi16(v_h, v_f);
+         v_h = _mm_max_epi16(v_h, v_zero);
+         v_max = _mm_max_epi16(v_max, v_h);
+         h_store[j] = v_h;
+
+         v_h = _mm_subs_epi16(v_h, v_gap_oe);
+         e_vec[j] = _mm_max_epi16(_mm_subs_epi16(v_e, v_gap_e), v_h);
+         v_f = _mm_max_epi16(_mm_subs_epi16(v_f, v_gap_e), v_h);
+         v_h = h_load[j];
+      }
+
+      /* carry gaps in the striped sequence across segment
+         boundaries until they can no longer change any score.
+         Cells whose score rises here may also open a new gap
+         in S, so the E values are refreshed as well. With a
+         zero gap open penalty a raised cell ties with the gap
+         that raised it, so the loop must also continue on ties */
+      for (k = 0; k < 8 && !f_done; k++) {
+         v_f = _mm_or_si128(_mm_slli_si128(v_f, 2), v_min_lane0);
+         for (j = 0; j < seg_len; j++) {
+            v_h = _mm_max_epi16(h_store[j], v_f);
+            h_store[j] = v_h;
+            v_h = _mm_subs_epi16(v_h, v_gap_oe);
+            e_vec[j] = _mm_max_epi16(e_vec[j], v_h);
+            v_f = _mm_subs_epi16(v_f, v_gap_e);
+            v_h = _mm_subs_epi16(v_h, v_no_open);
+            if (!_mm_movemask_epi8(_mm_cmpgt_epi16(v_f, v_h))) {
+               f_done = TRUE;
+               break;
+            }
+         }
+      }
+   }
+
+   _mm_storeu_si128((__m128i *)lane_max, v_max);
+   for (j = 0; j < 8; j++)
+      best_score = MAX(best_score, lane_max[j]);
+
+   return best_score >= INT2_MAX ? SW_SIMD_OVERFLOW : best_score;
+}
+
+#endif /* BLAST_SW_HAVE_SSE2 */
+
+#ifdef BLAST_SW_HAVE_AVX2
+
+/** Shift a 256-bit vector left by one 16-bit lane, across the
+    128-bit halves, filling lane 0 with zero */
+#define SW_AVX2_SHIFT_LANE(v) \
+   _mm256_alignr_epi8((v), _mm256_permute2x128_si256((v), (v), 0x08), 14)
+
+/** Striped score-only Smith-Waterman with 256-bit vectors. Compiled
+ *  for AVX2 regardless of the compiler flags; only called when the
+ *  CPU reports AVX2 support. Arguments are as in s_SWStripedSSE2.
+ * @return The best score, or SW_SIMD_OVERFLOW
+ */
+__attribute__((target("avx2")))
+static Int4 s_SWStripedAVX2(const Int2 *profile, Int4 seg_len,
+                            const Uint1 *S, Int4 s_size, Boolean s_packed,
+                            Int4 gap_open_extend, Int4 gap_extend,
+                            void *work)
+{
+   Int4 i, j, k;
+   __m256i *h_store = (__m256i *)work;
+   __m256i *h_load = h_store + seg_len;
+   __m256i *e_vec = h_load + seg_len;
+   const __m256i v_zero = _mm256_setzero_si256();
+   const __m256i v_min = _mm256_set1_epi16(INT2_MIN);
+   const __m256i v_min_lane0 = _mm256_set_epi16(0, 0, 0, 0, 0, 0, 0, 0,
+                                                0, 0, 0, 0, 0, 0, 0,
+                                                INT2_MIN);
+   const __m256i v_gap_oe = _mm256_set1_epi16((Int2)gap_open_extend);
+   const __m256i v_gap_e = _mm256_set1_epi16((Int2)gap_extend);
+   const __m256i v_no_open = _mm256_set1_epi16(gap_open_extend == gap_extend);
+   __m256i v_max = v_zero;
+   Int2 lane_max[16];
+   Int4 best_score = 0;
+
+   for (j = 0; j < 3 * seg_len; j++)
+      h_store[j] = v_zero;
+
+   for (i = 0; i < s_size; i++) {
+      Int4 residue = s_packed ? NCBI2NA_UNPACK_BASE(S[i/4], (3-(i%4)))
+                              : S[i];
+      const __m256i *v_profile = (const __m256i *)profile + residue * seg_len;
+      __m256i v_f = v_min;
+      __m256i v_h = SW_AVX2_SHIFT_LANE(h_store[seg_len - 1]);
+      __m256i *tmp = h_load;
+      Boolean f_done = FALSE;
+
+      h_load = h_store;
+      h_store = tmp;
+
+      for (j = 0; j < seg_len; j++) {
+         __m256i v_e = e_vec[j];
+
+         v_h = _mm256_adds_epi16(v_h, v_profile[j]);
+         v_h = _mm256_max_epi16(v_h, v_e);
+         v_h = _mm256_max_epi16(v_h, v_f);
+         v_h = _mm256_max_epi16(v_h, v_zero);
+         v_max = _mm256_max_epi16(v_max, v_h);
+         h_store[j] = v_h;
+
+         v_h = _mm256_subs_epi16(v_h, v_gap_oe);
+         e_vec[j] = _mm256_max_epi16(_mm256_subs_epi16(v_e, v_gap_e), v_h);
+         v_f = _mm256_max_epi16(_mm256_subs_epi16(v_f, v_gap_e), v_h);
+         v_h = h_load[j];
+      }
+
+      /* lazy-F loop; see s_SWStripedSSE2 */
+      for (k = 0; k < 16 && !f_done; k++) {
+         v_f = _mm256_or_si256(SW_AVX2_SHIFT_LANE(v_f), v_min_lane0);
+         for (j = 0; j < seg_len; j++) {
+            v_h = _mm256_max_epi16(h_store[j], v_f);
+            h_store[j] = v_h;
+            v_h = _mm256_subs_epi16(v_h, v_gap_oe);
+            e_vec[j] = _mm256_max_epi16(e_vec[j], v_h);
+            v_f = _mm256_subs_epi16(v_f, v_gap_e);
+            v_h = _mm256_subs_epi16(v_h, v_no_open);
+            if (!_mm256_movemask_epi8(_mm256_cmpgt_epi16(v_f, v_h))) {
+               f_done = TRUE;
+               break;
+            }
+         }
+      }
+   }
+
+   _mm256_storeu_si256((__m256i *)lane_max, v_max);
+   for (j = 0; j < 16; j++)
+      best_score = MAX(best_score, lane_max[j]);
+
+   return best_score >= INT2_MAX ? SW_SIMD_OVERFLOW : best_score;
+}
+
+#endif /* BLAST_SW_HAVE_AVX2 */
+
+/** Run a striped score-only kernel. The striped sequence Q is
+ *  described by a score matrix and sequence, or by a PSSM alone.
+ * @param engine The SIMD engine to use (not eSWEngineAuto or
+ *             eSWEngineScalar) [in]
+ * @param matrix The score matrix, or the PSSM if Q is NULL [in]
+ * @param num_residues Number of residues that can occur in S [in]
+ * @param Q The striped sequence, NULL if matrix is a PSSM [in]
+ * @param q_size Length of the striped sequence [in]
+ * @param S The other sequence [in]
+ * @param s_size Length of S [in]
+ * @param s_packed TRUE if S is in ncbi2na format [in]
+ * @param gap_open Gap open penalty [in]
+ * @param gap_extend Gap extension penalty [in]
+ * @param gap_align Holds the scratch memory for the profile and the
+ *             kernel, grown as needed [in][out]
+ * @return The best score, or SW_SIMD_OVERFLOW if the scalar
+ *         code must be used instead
+ */
+static Int4 s_SmithWatermanStriped(ESmithWatermanEngine engine,
+                                   Int4 **matrix, Int4 num_residues,
+                                   const Uint1 *Q, Int4 q_size,
+                                   const Uint1 *S, Int4 s_size,
+                                   Boolean s_packed,
+                                   Int4 gap_open, Int4 gap_extend,
+                                   BlastGapAlignStruct *gap_align)
+{
+   Int4 score = SW_SIMD_OVERFLOW;
+#ifdef BLAST_SW_HAVE_SSE2
+   Int4 lanes = s_SWLanes(engine);
+   Int4 seg_len = (q_size + lanes - 1) / lanes;
+   Int4 vec_bytes = lanes * (Int4)sizeof(Int2);
+   size_t profile_bytes = (size_t)num_residues * seg_len * vec_bytes;
+   size_t work_bytes = (size_t)3 * seg_len * vec_bytes;
+   size_t mem_bytes = profile_bytes + work_bytes + SW_SIMD_MAX_BYTES;
+   Uint1 *raw_mem;
+   Int2 *profile;
+   void *work;
+
+   if (q_size <= 0 || s_size <= 0)
+      return 0;
+   if (gap_open + gap_extend >= INT2_MAX)
+      return SW_SIMD_OVERFLOW;
+
+   /* allocate space for scratch structures */
+   if (mem_bytes > gap_align->sw_mem_alloc) {
+      gap_align->sw_mem_alloc = MAX(mem_bytes, 2 * gap_align->sw_mem_alloc);
+      sfree(gap_align->sw_mem);
+      gap_align->sw_mem = malloc(gap_align->sw_mem_alloc);
+      if (gap_align->sw_mem == NULL) {
+         gap_align->sw_mem_alloc = 0;
+         return SW_SIMD_OVERFLOW;
+      }
+   }
+   raw_mem = (Uint1 *)gap_align->sw_mem;
+   profile = (Int2 *)(raw_mem + SW_SIMD_MAX_BYTES -
+                      ((size_t)raw_mem % SW_SIMD_MAX_BYTES));
+   work = (Uint1 *)profile + profile_bytes;
+
+   if (s_SWBuildStripedProfile(profile, matrix, num_residues,
+                               Q, q_size, seg_len, lanes)) {
+#ifdef BLAST_SW_HAVE_AVX2
+      if (engine == eSWEngineAVX2) {
+         score = s_SWStripedAVX2(profile, seg_len, S, s_size, s_packed,
+                                 gap_open + gap_extend, gap_extend, work);
+      }
+      else
+#endif
+      {
+         score = s_SWStripedSSE2(profile, seg_len, S, s_size, s_packed,
+                                 gap_open + gap_extend, gap_extend, work);
+      }
+   }
+#endif /* BLAST_SW_HAVE_SSE2 */
+   return score;
+}
+
+/* See blast_sw.h for details */
+Int4 Blast_SmithWatermanScoreOnly(const Uint1 *A, Int4 a_size,
+                                  const Uint1 *B, Int4 b_size,
+                                  Int4 gap_open, Int4 gap_extend,
+                                  BlastGapAlignStruct *gap_align,
+                                  ESmithWatermanEngine engine)
+{
+   Int4 score = SW_SIMD_OVERFLOW;
+
+   engine = s_SWResolveEngine(engine, gap_align);
+   if (engine != eSWEngineScalar) {
+      if (gap_align->positionBased) {
+         /* stripe the PSSM; its rows are the positions of A */
+         SPsiBlastScoreMatrix *psi_matrix = gap_align->sbp->psi_matrix;
+         score = s_SmithWatermanStriped(engine, psi_matrix->pssm->data,
+                                        (Int4)psi_matrix->pssm->nrows,
+                                        NULL, a_size, B, b_size, FALSE,
+                                        gap_open, gap_extend, gap_align);
+      }
+      else {
+         /* the matrix is symmetric, so stripe the shorter
+            sequence to keep the profile small */
+         if (a_size < b_size) {
+            SWAP_SEQS(A, B);
+            SWAP_INT(a_size, b_size);
+         }
+         score = s_SmithWatermanStriped(engine, gap_align->sbp->matrix->data,
+                                        (Int4)gap_align->sbp->matrix->nrows,
+                                        B, b_size, A, a_size, FALSE,
+                                        gap_open, gap_extend, gap_align);
+      }
+   }
+
+   if (score == SW_SIMD_OVERFLOW) {
+      score = s_SmithWatermanScoreOnly(A, a_size, B, b_size,
+                                       gap_open, gap_extend, gap_align);
+   }
+   return score;
+}
+
+/* See blast_sw.h for details */
+Int4 Blast_NuclSmithWatermanScoreOnly(const Uint1 *B, Int4 b_size,
+                                      const Uint1 *A, Int4 a_size,
+                                      Int4 gap_open, Int4 gap_extend,
+                                      BlastGapAlignStruct *gap_align,
+                                      ESmithWatermanEngine engine)
+{
+   Int4 score = SW_SIMD_OVERFLOW;
+
+   engine = s_SWResolveEngine(engine, gap_align);
+   if (engine != eSWEngineScalar) {
+      /* stripe the (unpacked) query and walk the packed
+         subject; only the four ncbi2na rows of the
+         profile are ever used */
+      score = s_SmithWatermanStriped(engine, gap_align->sbp->matrix->data,
+                                     BLAST2NA_SIZE, A, a_size,
+                                     B, b_size, TRUE,
+                                     gap_open, gap_extend, gap_align);
+   }
+
+   if (score == SW_SIMD_OVERFLOW) {
+      score = s_NuclSmithWaterman(B, b_size, A, a_size,
+                                  gap_open, gap_extend, gap_align);
+   }
+   return score;
+}
+
 
 /** Values for the editing script operations in traceback */
 enum {
@@ -692,23 +1141,23 @@ Int2 BLAST_SmithWatermanGetGappedScore (EBlastProgramType program_number,
       }
 
       if (is_prot) {
-         score = s_SmithWatermanScoreOnly(
+         score = Blast_SmithWatermanScoreOnly(
                               query->sequence + curr_ctx->query_offset,
                               curr_ctx->query_length,
                               subject->sequence,
                               subject->length,
                               score_params->gap_open,
                               score_params->gap_extend,
-                              gap_align);
+                              gap_align, eSWEngineAuto);
       }
       else {
-         score = s_NuclSmithWaterman(subject->sequence,
+         score = Blast_NuclSmithWatermanScoreOnly(subject->sequence,
                                      subject->length,
                                      query->sequence + curr_ctx->query_offset,
                                      curr_ctx->query_length,
                                      score_params->gap_open,
                                      score_params->gap_extend,
-                                     gap_align);
+                                     gap_align, eSWEngineAuto);
       }
 
       if (score >= cutoff_score) {
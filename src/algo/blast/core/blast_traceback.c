@@ -1432,6 +1432,337 @@ s_SThreadLocalDataArraySetGapXDropoffFinal(SThreadLocalDataArray* array)
     }
 }
 
+/** Number of HSPs in a batch, used as an estimate of the work needed to
+ * compute its traceback
+ * @param batch HSP lists for a single subject sequence [in]
+ */
+static Int4
+s_BatchNumHSPs(const BlastHSPStreamResultBatch* batch)
+{
+    Int4 i, retval = 0;
+    for (i = 0; i < batch->num_hsplists; i++) {
+        retval += batch->hsplist_array[i]->hspcnt;
+    }
+    return retval;
+}
+
+/** Callback used to sort batches of HSP lists in order of decreasing number
+ * of HSPs, so that the most expensive subject sequences are dispatched to
+ * the threads first; ties are broken by increasing OID
+ * @param v1 First batch [in]
+ * @param v2 Second batch [in]
+ */
+static int
+s_CompareBatchesByWork(const void* v1, const void* v2)
+{
+    const BlastHSPStreamResultBatch* b1 = *(BlastHSPStreamResultBatch**)v1;
+    const BlastHSPStreamResultBatch* b2 = *(BlastHSPStreamResultBatch**)v2;
+    Int4 work1 = s_BatchNumHSPs(b1);
+    Int4 work2 = s_BatchNumHSPs(b2);
+
+    if (work1 != work2) {
+        return BLAST_CMP(work2, work1);
+    }
+    if (b1->num_hsplists == 0 || b2->num_hsplists == 0) {
+        return BLAST_CMP(b2->num_hsplists, b1->num_hsplists);
+    }
+    return BLAST_CMP(b1->hsplist_array[0]->oid, b2->hsplist_array[0]->oid);
+}
+
+/** Callback used to sort HSP lists in order of increasing OID
+ * @param v1 First HSP list [in]
+ * @param v2 Second HSP list [in]
+ */
+static int
+s_CompareHSPListsByOid(const void* v1, const void* v2)
+{
+    const BlastHSPList* h1 = *(BlastHSPList**)v1;
+    const BlastHSPList* h2 = *(BlastHSPList**)v2;
+    return BLAST_CMP(h1->oid, h2->oid);
+}
+
+/** Restore the order in which a single thread would have saved the HSP lists
+ * (increasing OID, the order in which they are read from the HSP stream)
+ * after the results of several threads have been consolidated
+ * @param results Consolidated traceback results [in|out]
+ */
+static void
+s_HSPResultsRestoreOidOrder(BlastHSPResults* results)
+{
+    Int4 i;
+    for (i = 0; i < results->num_queries; i++) {
+        BlastHitList* hit_list = results->hitlist_array[i];
+        if (hit_list && hit_list->hsplist_count > 1) {
+            qsort(hit_list->hsplist_array, hit_list->hsplist_count,
+                  sizeof(BlastHSPList*), s_CompareHSPListsByOid);
+        }
+    }
+}
+
+/** Compute the traceback for the HSP lists of one subject sequence and save
+ * the results in the thread local results structure
+ * @param program_number BLAST program type [in]
+ * @param batch HSP lists for a single subject sequence, emptied on
+ *              return [in|out]
+ * @param tld Data owned by the calling thread [in|out]
+ * @param sbp Scoring block [in]
+ * @param pattern_blk PHI BLAST auxiliary data structure [in]
+ * @param query Query sequence(s) [in]
+ * @param query_info Query information [in]
+ * @param default_db_genetic_code Genetic code used for subjects without
+ *                                their own genetic code [in]
+ * @return zero on success, or the error status
+ */
+static Int2
+s_TracebackBatch(EBlastProgramType program_number,
+                 BlastHSPStreamResultBatch* batch,
+                 SThreadLocalData* tld,
+                 BlastScoreBlk* sbp,
+                 SPHIPatternSearchBlk* pattern_blk,
+                 BLAST_SequenceBlk* query,
+                 BlastQueryInfo* query_info,
+                 Int4 default_db_genetic_code)
+{
+    BlastSeqSrcGetSeqArg seq_arg = {0,0,0,0,NULL,NULL};
+    Int4 hsplist_itr = 0;
+    Int2 status = 0;
+    const EBlastEncoding encoding = Blast_TracebackGetEncoding(program_number);
+    BlastSeqSrc* seqsrc = NULL;
+    BlastGapAlignStruct* gap_align = NULL;
+    BlastScoringParameters* score_params = NULL;
+    const BlastExtensionParameters* ext_params = NULL;
+    BlastHitSavingParameters* hit_params = NULL;
+    Boolean perform_traceback = FALSE;
+    Boolean perform_partial_fetch = FALSE;
+
+    /* Everything modified while aligning this batch, including the
+       gapped alignment scratch space, is owned by this thread */
+    seqsrc = tld->seqsrc;
+    gap_align = tld->gap_align;
+    score_params = tld->score_params;
+    ext_params = tld->ext_params;
+    hit_params = tld->hit_params;
+    perform_traceback = score_params->options->gapped_calculation;
+    perform_partial_fetch = BlastSeqSrcGetSupportsPartialFetching(seqsrc);
+
+    /* setup traceback: will require fetching the subject sequence */
+    if (perform_traceback) {
+
+        /* set up partial fetching */
+    	BlastSeqSrcSetRangesArg* ranges= NULL;
+        if (perform_partial_fetch) {
+            ranges = BLAST_SetupPartialFetching(program_number, seqsrc,
+                                    (const BlastHSPList**)batch->hsplist_array,
+                                    batch->num_hsplists);
+        }
+
+        seq_arg.oid = batch->hsplist_array[0]->oid;
+        seq_arg.encoding = encoding;
+        seq_arg.check_oid_exclusion = TRUE;
+        seq_arg.reset_ranges = FALSE;
+        seq_arg.ranges = ranges;
+
+        if (BlastSeqSrcGetSequence(seqsrc, &seq_arg) < 0) {
+            Blast_HSPStreamResultBatchReset(batch);
+            return 0;
+        }
+
+        /* If the subject is translated and the BlastSeqSrc implementation
+        * doesn't provide a genetic code string, use the default genetic
+        * code for all subjects (as in the C toolkit) */
+        if (Blast_SubjectIsTranslated(program_number) &&
+            seq_arg.seq->gen_code_string == NULL) {
+#pragma omp critical(tback_gen_code)
+            {
+                seq_arg.seq->gen_code_string =
+                    GenCodeSingletonFind(default_db_genetic_code);
+#ifndef _OPENMP
+                ASSERT(seq_arg.seq->gen_code_string);
+#endif
+            }
+        }
+
+        if (BlastSeqSrcGetTotLen(seqsrc) == 0) {
+            BlastQueryInfo* qi = tld->query_info;
+            BlastEffectiveLengthsParameters* elp = tld->eff_len_params;
+            /* This is not a database search, so effective search spaces
+            * need to be recalculated based on this subject sequence
+            * length.
+            * NB: The initial word parameters structure is not available
+            * here, so the small gap cutoff score for linking of HSPs will
+            * not be updated. Since by default linking is done with uneven
+            * gap statistics, this can only influence a corner non-default
+            * case, and is a tradeoff for a benefit of not having to deal
+            * with ungapped extension parameters in the traceback stage.
+            */
+            if ((status = BLAST_OneSubjectUpdateParameters(program_number,
+                        seq_arg.seq->length, score_params->options,
+                        qi, sbp, hit_params, NULL, elp)) != 0) {
+                Blast_HSPStreamResultBatchReset(batch);
+                BlastSeqSrcReleaseSequence(seqsrc, &seq_arg);
+                BlastSequenceBlkFree(seq_arg.seq);
+                return status;
+            }
+        }
+    } /* end of set up for traceback */
+
+    /* process all the hits to this subject sequence, one list at a time */
+    for (hsplist_itr = 0; hsplist_itr < batch->num_hsplists; hsplist_itr++) {
+        BlastHSPList* hsp_list = batch->hsplist_array[hsplist_itr];
+
+        if (perform_traceback) {
+            if (Blast_ProgramIsPhiBlast(program_number)) {
+                s_PHITracebackFromHSPList(program_number, hsp_list, query,
+                                seq_arg.seq, gap_align, sbp,
+                                score_params, hit_params,
+                                query_info, pattern_blk);
+            } else {
+                Boolean fence_hit = FALSE;
+                Blast_TracebackFromHSPList(program_number, hsp_list, query,
+                                 seq_arg.seq, query_info,
+                                 gap_align, sbp, score_params,
+                                 ext_params->options, hit_params,
+                                 seq_arg.seq->gen_code_string,
+                                 &fence_hit);
+
+                if (fence_hit) {
+                    /* Disable range support and refetch the
+                    (whole) subject sequence */
+
+                    seq_arg.reset_ranges = TRUE;
+                    BlastSeqSrcReleaseSequence(seqsrc, &seq_arg);
+                    BlastSeqSrcGetSequence(seqsrc, &seq_arg);
+
+                    /* The C toolkit will erase genetic_code, so do it again */
+                    if (Blast_SubjectIsTranslated(program_number) &&
+                        seq_arg.seq->gen_code_string == NULL) {
+#pragma omp critical(tback_gen_code)
+                        {
+                            seq_arg.seq->gen_code_string =
+                                GenCodeSingletonFind(default_db_genetic_code);
+#ifndef _OPENMP
+                            ASSERT(seq_arg.seq->gen_code_string);
+#endif
+                        }
+                    }
+
+                    /* Retry the alignment with fence_hit set*/
+                    Blast_TracebackFromHSPList(program_number, hsp_list,
+                                        query, seq_arg.seq,
+                                        query_info, gap_align,
+                                        sbp, score_params,
+                                        ext_params->options,
+                                        hit_params,
+                                        seq_arg.seq->gen_code_string,
+                                        &fence_hit);
+#ifndef _OPENMP
+                    ASSERT(fence_hit == FALSE);
+#endif
+                } /* fence_hit */
+            }    /* !phi_blast */
+
+        } else {
+            /* traceback skipped; compute bit scores for searches
+               where the traceback phase is seperated from the
+               preliminary search. */
+            Blast_HSPListGetBitScores(hsp_list, FALSE, sbp);
+        }
+
+        /* Free HSP list if all HSPs have been deleted. */
+
+        batch->hsplist_array[hsplist_itr] = NULL;
+        if (hsp_list->hspcnt == 0) {
+            hsp_list = Blast_HSPListFree(hsp_list);
+        }
+        else {
+            Blast_HSPResultsInsertHSPList(tld->results, hsp_list,
+                          hit_params->options->hitlist_size);
+        }
+    }      /* loop over one HSPList batch */
+    if (perform_traceback) {
+        BlastSeqSrcReleaseSequence(seqsrc, &seq_arg);
+        BlastSequenceBlkFree(seq_arg.seq);
+    }
+    return 0;
+}
+
+/** Apply the filters that need the final traceback results of a query:
+ * masklevel, re-sorting by e-value, the HSP filtering options and the final
+ * hit list size. Only the hit lists present in results are processed, so this
+ * can be applied to all queries at once or to one query at a time.
+ * @param program_number BLAST program type [in]
+ * @param results Traceback results [in|out]
+ * @param query Query sequence(s) [in]
+ * @param query_info Query information [in]
+ * @param seq_src Source of subject sequences [in]
+ * @param hit_params Hit saving parameters [in]
+ */
+static void
+s_PostTracebackFilter(EBlastProgramType program_number,
+                      BlastHSPResults* results,
+                      BLAST_SequenceBlk* query,
+                      BlastQueryInfo* query_info,
+                      const BlastSeqSrc* seq_src,
+                      const BlastHitSavingParameters* hit_params)
+{
+    if (!results) {
+        return;
+    }
+
+    // -RMH-: Apply masklevel filter
+    if (hit_params->mask_level < 101) {
+        // printf("Masklevel being invoked at level: %d\n",
+        // hit_params->mask_level );
+
+        Int4 totalCnt = 0;
+        Int4 rmIdx;
+        Int4 hspIdx;
+        for (rmIdx = 0; rmIdx < results->num_queries; rmIdx++) {
+            if (results->hitlist_array[rmIdx] == NULL)
+                continue;
+            for (hspIdx = 0;
+                 hspIdx < results->hitlist_array[rmIdx]->hsplist_count;
+                 hspIdx++)
+                totalCnt +=
+                    results->hitlist_array[rmIdx]->hsplist_array[hspIdx]->
+                    hspcnt;
+        }
+        // printf("Before masklevel total = %d\n", totalCnt );
+
+        Blast_HSPResultsApplyMasklevel(results, query_info,
+                                       hit_params->mask_level, query->length);
+
+        totalCnt = 0;
+        for (rmIdx = 0; rmIdx < results->num_queries; rmIdx++) {
+            if (results->hitlist_array[rmIdx] == NULL)
+                continue;
+            for (hspIdx = 0;
+                 hspIdx < results->hitlist_array[rmIdx]->hsplist_count;
+                 hspIdx++)
+                totalCnt +=
+                    results->hitlist_array[rmIdx]->hsplist_array[hspIdx]->
+                    hspcnt;
+        }
+        // printf("After masklevel total = %d\n", totalCnt );
+    }
+    // -RMH-: end of change
+
+    /* Re-sort the hit lists according to their best e-values, because they
+       could have changed. Only do this for a database search. */
+    if (BlastSeqSrcGetTotLen(seq_src) > 0) {
+        Blast_HSPResultsSortByEvalue(results);
+    }
+
+    if(hit_params->options->query_cov_hsp_perc > 0 || hit_params->options->max_hsps_per_subject > 0 ||
+       (hit_params->options->hsp_filt_opt != NULL && hit_params->options->hsp_filt_opt->subject_besthit_opts != NULL)) {
+    	s_FilterBlastResults(results, hit_params->options, query_info, program_number);
+    }
+
+    /* Eliminate extra hits from results, if preliminary hit list size is
+       larger than the final hit list size */
+    s_BlastPruneExtraHits(results, hit_params->options->hitlist_size);
+}
+
 Int2
 BLAST_ComputeTraceback_MT(EBlastProgramType program_number,
                           BlastHSPStream * hsp_stream,
@@ -1514,27 +1845,24 @@ BLAST_ComputeTraceback_MT(EBlastProgramType program_number,
         if (actual_num_threads != thread_data->num_elems) {
             SThreadLocalDataArrayTrim(thread_data, actual_num_threads);
         }
+        /* Subjects with the most HSPs go first, so that a few heavily hit
+           subjects do not end up being processed by a single thread after
+           all the others are done */
+        if (actual_num_threads > 1) {
+            qsort(batches->array_of_batches, batches->num_batches,
+                  sizeof(*batches->array_of_batches), s_CompareBatchesByWork);
+        }
 
-#pragma omp parallel for default(none) num_threads(actual_num_threads) schedule(guided) if (actual_num_threads > 1) \
-        shared(retval, thread_data, batches, score_params, program_number, sbp, hit_params, pattern_blk, query, ext_params, query_info, default_db_genetic_code, has_been_interrupted, interrupt_search, progress_info)
+#pragma omp parallel for default(none) num_threads(actual_num_threads) schedule(dynamic) if (actual_num_threads > 1) \
+        shared(retval, thread_data, batches, program_number, sbp, pattern_blk, query, query_info, default_db_genetic_code, has_been_interrupted, interrupt_search, progress_info)
         for (i = 0; i < batches->num_batches; i++) {
-            BlastSeqSrcGetSeqArg seq_arg = {0,0,0,0,NULL,NULL};
-            Int4 hsplist_itr = 0;
             Int2 status = 0;
             int tid = 0;
-            const Boolean perform_traceback = score_params->options->gapped_calculation;
             BlastHSPStreamResultBatch* batch = batches->array_of_batches[i];
-            const EBlastEncoding encoding = Blast_TracebackGetEncoding(program_number);
-            BlastSeqSrc* seqsrc = NULL;
-            BlastGapAlignStruct* gap_align = NULL;
-            Boolean perform_partial_fetch = FALSE;
 
 #ifdef _OPENMP
             tid = omp_get_thread_num();
 #endif
-            seqsrc = thread_data->tld[tid]->seqsrc;
-            gap_align = thread_data->tld[tid]->gap_align;
-            perform_partial_fetch = BlastSeqSrcGetSupportsPartialFetching(seqsrc);
 
             /* check for interrupt */
             if (interrupt_search && (*interrupt_search)(progress_info) == TRUE) {
@@ -1551,149 +1879,15 @@ BLAST_ComputeTraceback_MT(EBlastProgramType program_number,
                 continue;
             }
 
-            /* setup traceback: will require fetching the subject sequence */
-            if (perform_traceback) {
-
-                /* set up partial fetching */
-            	BlastSeqSrcSetRangesArg* ranges= NULL;
-                if (perform_partial_fetch) {
-                    ranges = BLAST_SetupPartialFetching(program_number, seqsrc,
-                                            (const BlastHSPList**)batch->hsplist_array,
-                                            batch->num_hsplists);
-                }
-
-                seq_arg.oid = batch->hsplist_array[0]->oid;
-                seq_arg.encoding = encoding;
-                seq_arg.check_oid_exclusion = TRUE;
-                seq_arg.reset_ranges = FALSE;
-                seq_arg.ranges = ranges;
-
-                if (BlastSeqSrcGetSequence(seqsrc, &seq_arg) < 0) {
-                    batches->array_of_batches[i] = Blast_HSPStreamResultBatchReset(batch);
-                    continue;
-                }
-
-                /* If the subject is translated and the BlastSeqSrc implementation
-                * doesn't provide a genetic code string, use the default genetic
-                * code for all subjects (as in the C toolkit) */
-                if (Blast_SubjectIsTranslated(program_number) &&
-                    seq_arg.seq->gen_code_string == NULL) {
-#pragma omp critical(tback_gen_code)
-                    {
-                        seq_arg.seq->gen_code_string =
-                            GenCodeSingletonFind(default_db_genetic_code);
-#ifndef _OPENMP
-                        ASSERT(seq_arg.seq->gen_code_string);
-#endif
-                    }
-                }
-
-                if (BlastSeqSrcGetTotLen(seqsrc) == 0) {
-                    BlastQueryInfo* qi = thread_data->tld[tid]->query_info;
-                    BlastEffectiveLengthsParameters* elp =
-                        thread_data->tld[tid]->eff_len_params;
-                    BlastHitSavingParameters* hp =
-                        thread_data->tld[tid]->hit_params;
-                    /* This is not a database search, so effective search spaces
-                    * need to be recalculated based on this subject sequence
-                    * length.
-                    * NB: The initial word parameters structure is not available
-                    * here, so the small gap cutoff score for linking of HSPs will
-                    * not be updated. Since by default linking is done with uneven
-                    * gap statistics, this can only influence a corner non-default
-                    * case, and is a tradeoff for a benefit of not having to deal
-                    * with ungapped extension parameters in the traceback stage.
-                    */
-                    if ((status = BLAST_OneSubjectUpdateParameters(program_number,
-                                seq_arg.seq->length, score_params->options,
-                                qi, sbp, hp, NULL, elp)) != 0) {
-                        batches->array_of_batches[i] = Blast_HSPStreamResultBatchReset(batch);
+            status = s_TracebackBatch(program_number, batch, thread_data->tld[tid],
+                                      sbp, pattern_blk, query, query_info,
+                                      default_db_genetic_code);
+            if (status) {
 #pragma omp critical(retval)
-                        {
-                            retval = status;
-                            has_been_interrupted = TRUE;
-                        }
-                        continue;
-                    }
-                }
-            } /* end of set up for traceback */
-
-            /* process all the hits to this subject sequence, one list at a time */
-            for (hsplist_itr = 0; hsplist_itr < batch->num_hsplists; hsplist_itr++) {
-                BlastHSPList* hsp_list = batch->hsplist_array[hsplist_itr];
-
-                if (perform_traceback) {
-                    if (Blast_ProgramIsPhiBlast(program_number)) {
-                        s_PHITracebackFromHSPList(program_number, hsp_list, query,
-                                        seq_arg.seq, gap_align, sbp,
-                                        score_params, hit_params,
-                                        query_info, pattern_blk);
-                    } else {
-                        Boolean fence_hit = FALSE;
-                        Blast_TracebackFromHSPList(program_number, hsp_list, query,
-                                         seq_arg.seq, query_info,
-                                         gap_align, sbp, score_params,
-                                         ext_params->options, hit_params,
-                                         seq_arg.seq->gen_code_string,
-                                         &fence_hit);
-
-                        if (fence_hit) {
-                            /* Disable range support and refetch the
-                            (whole) subject sequence */
-
-                            seq_arg.reset_ranges = TRUE;
-                            BlastSeqSrcReleaseSequence(seqsrc, &seq_arg);
-                            BlastSeqSrcGetSequence(seqsrc, &seq_arg);
-
-                            /* The C toolkit will erase genetic_code, so do it again */
-                            if (Blast_SubjectIsTranslated(program_number) &&
-                                seq_arg.seq->gen_code_string == NULL) {
-#pragma omp critical(tback_gen_code)
-                                {
-                                    seq_arg.seq->gen_code_string =
-                                        GenCodeSingletonFind(default_db_genetic_code);
-#ifndef _OPENMP
-                                    ASSERT(seq_arg.seq->gen_code_string);
-#endif
-                                }
-                            }
-
-                            /* Retry the alignment with fence_hit set*/
-                            Blast_TracebackFromHSPList(program_number, hsp_list,
-                                                query, seq_arg.seq,
-                                                query_info, gap_align,
-                                                sbp, score_params,
-                                                ext_params->options,
-                                                hit_params,
-                                                seq_arg.seq->gen_code_string,
-                                                &fence_hit);
-#ifndef _OPENMP
-                            ASSERT(fence_hit == FALSE);
-#endif
-                        } /* fence_hit */
-                    }    /* !phi_blast */
-
-                } else {
-                    /* traceback skipped; compute bit scores for searches
-                       where the traceback phase is seperated from the
-                       preliminary search. */
-                    Blast_HSPListGetBitScores(hsp_list, FALSE, sbp);
-                }
-
-                /* Free HSP list if all HSPs have been deleted. */
-
-                batch->hsplist_array[hsplist_itr] = NULL;
-                if (hsp_list->hspcnt == 0) {
-                    hsp_list = Blast_HSPListFree(hsp_list);
-                }
-                else {
-                    Blast_HSPResultsInsertHSPList(thread_data->tld[tid]->results, hsp_list,
-                                  hit_params->options->hitlist_size);
+                {
+                    retval = status;
+                    has_been_interrupted = TRUE;
                 }
-            }      /* loop over one HSPList batch */
-            if (perform_traceback) {
-                BlastSeqSrcReleaseSequence(seqsrc, &seq_arg);
-                BlastSequenceBlkFree(seq_arg.seq);
             }
         } /* end of omp parallel for */
         batches = BlastHSPStreamResultsBatchArrayFree(batches);
@@ -1701,71 +1895,232 @@ BLAST_ComputeTraceback_MT(EBlastProgramType program_number,
         /* Reduce results from all threads and continue with business as usual */
         results = SThreadLocalDataArrayConsolidateResults(thread_data);
         ASSERT(results);
+        if (actual_num_threads > 1) {
+            s_HSPResultsRestoreOidOrder(results);
+        }
 
         /* post-traceback pipes */
         BlastHSPStreamTBackClose(hsp_stream, results);
 
     } /* end of else */
 
-    // -RMH-: Apply masklevel filter
-    if (results && hit_params->mask_level < 101) {
-        // printf("Masklevel being invoked at level: %d\n",
-        // hit_params->mask_level );
+    s_PostTracebackFilter(program_number, results, query, query_info,
+                          seq_src, hit_params);
 
-        Int4 totalCnt = 0;
-        Int4 rmIdx;
-        Int4 hspIdx;
-        for (rmIdx = 0; rmIdx < results->num_queries; rmIdx++) {
-            if (results->hitlist_array[rmIdx] == NULL)
-                continue;
-            for (hspIdx = 0;
-                 hspIdx < results->hitlist_array[rmIdx]->hsplist_count;
-                 hspIdx++)
-                totalCnt +=
-                    results->hitlist_array[rmIdx]->hsplist_array[hspIdx]->
-                    hspcnt;
-        }
-        // printf("Before masklevel total = %d\n", totalCnt );
+    if (retval == BLASTERR_INTERRUPTED) {
+        results = Blast_HSPResultsFree(results);
+    }
 
-        Blast_HSPResultsApplyMasklevel(results, query_info,
-                                       hit_params->mask_level, query->length);
+    *results_out = results;
 
-        totalCnt = 0;
-        for (rmIdx = 0; rmIdx < results->num_queries; rmIdx++) {
-            if (results->hitlist_array[rmIdx] == NULL)
-                continue;
-            for (hspIdx = 0;
-                 hspIdx < results->hitlist_array[rmIdx]->hsplist_count;
-                 hspIdx++)
-                totalCnt +=
-                    results->hitlist_array[rmIdx]->hsplist_array[hspIdx]->
-                    hspcnt;
-        }
-        // printf("After masklevel total = %d\n", totalCnt );
+    return retval;
+}
+
+/** Number of subject sequences per thread aligned between two checks for
+ * queries whose results are final in s_ComputeTracebackPerQuery_MT */
+#define TRACEBACK_SUBJECTS_PER_THREAD 32
+
+/** Consolidate the traceback results of one query from all threads, apply
+ * the post-traceback filters, hand them to the callback and free them
+ * @param program_number BLAST program type [in]
+ * @param query_index Index of the query [in]
+ * @param results Results structure used to pass the query's hit list [in|out]
+ * @param query Query sequence(s) [in]
+ * @param query_info Query information [in]
+ * @param thread_data Per thread data structures [in|out]
+ * @param results_fn Callback receiving the results of the query [in]
+ * @param user_data Argument passed to results_fn [in]
+ * @return zero on success, or the error status
+ */
+static Int2
+s_PutQueryResults(EBlastProgramType program_number,
+                  Int4 query_index,
+                  BlastHSPResults* results,
+                  BLAST_SequenceBlk* query,
+                  BlastQueryInfo* query_info,
+                  SThreadLocalDataArray* thread_data,
+                  TBlastQueryResultsFnPtr results_fn,
+                  void* user_data)
+{
+    Int2 retval = 0;
+
+    results->hitlist_array[query_index] =
+        SThreadLocalDataArrayConsolidateQueryResults(thread_data, query_index);
+    if ( !results->hitlist_array[query_index] ) {
+        return BLASTERR_MEMORY;
     }
-    // -RMH-: end of change
+    if (thread_data->num_elems > 1) {
+        s_HSPResultsRestoreOidOrder(results);
+    }
+    s_PostTracebackFilter(program_number, results, query, query_info,
+                          thread_data->tld[0]->seqsrc,
+                          thread_data->tld[0]->hit_params);
 
-    /* Re-sort the hit lists according to their best e-values, because they
-       could have changed. Only do this for a database search. */
-    if (BlastSeqSrcGetTotLen(seq_src) > 0) {
-        Blast_HSPResultsSortByEvalue(results);
+    retval = (*results_fn)(results, query_index, user_data);
+    results->hitlist_array[query_index] =
+        Blast_HitListFree(results->hitlist_array[query_index]);
+    return retval;
+}
+
+/** Compute the traceback of a database search and pass the final results of
+ * each query to a callback as soon as the last subject sequence it hits has
+ * been aligned. As in BLAST_ComputeTraceback_MT every subject sequence is
+ * fetched once and aligned to all the queries that hit it; the subjects are
+ * taken in the order of the HSP stream (increasing OID), a few per thread at
+ * a time, and the queries whose last subject has been aligned are handed
+ * over in query order. A query's hit list is freed once the callback
+ * returns, so only the results of the queries still waiting for one of
+ * their subjects, or for a preceding query, are held.
+ * @param program_number BLAST program type [in]
+ * @param hsp_stream Preliminary results, already closed [in]
+ * @param query Query sequence(s) [in]
+ * @param query_info Query information [in]
+ * @param thread_data Per thread data structures [in|out]
+ * @param pattern_blk PHI BLAST auxiliary data structure [in]
+ * @param default_db_genetic_code Genetic code for subjects without their
+ *                                own one [in]
+ * @param results_fn Callback receiving the results of each query [in]
+ * @param user_data Argument passed to results_fn [in]
+ * @param interrupt_search function callback to allow interruption of BLAST
+ *                         search [in, optional]
+ * @param progress_info contains information about the progress of the
+ *                      current BLAST search [in|out]
+ * @return zero on success, or the first error status
+ */
+static Int2
+s_ComputeTracebackPerQuery_MT(EBlastProgramType program_number,
+                              BlastHSPStream* hsp_stream,
+                              BLAST_SequenceBlk* query,
+                              BlastQueryInfo* query_info,
+                              SThreadLocalDataArray* thread_data,
+                              SPHIPatternSearchBlk* pattern_blk,
+                              Int4 default_db_genetic_code,
+                              TBlastQueryResultsFnPtr results_fn,
+                              void* user_data,
+                              TInterruptFnPtr interrupt_search,
+                              SBlastProgress* progress_info)
+{
+    Int2 retval = 0;
+    Int4 num_queries = query_info->num_queries;
+    Int4 query_index, next_query = 0;
+    Int4 b, start, end, window;
+    Uint4 num_threads = 0;
+    BlastScoreBlk* sbp = thread_data->tld[0]->gap_align->sbp;
+    BlastHSPStreamResultsBatchArray* batches = NULL;
+    Int4* last_batch = NULL;
+    BlastHSPResults* results = NULL;
+    Boolean has_been_interrupted = FALSE;
+
+    if ( (retval = BlastHSPStreamToHSPStreamResultsBatch(hsp_stream, &batches))) {
+        return retval;
+    }
+    ASSERT(batches);
+
+    /* The last subject of each query, -1 for the queries without hits */
+    last_batch = (Int4*) malloc(MAX(1, num_queries) * sizeof(Int4));
+    results = Blast_HSPResultsNew(num_queries);
+    if ( !last_batch || !results ) {
+        sfree(last_batch);
+        Blast_HSPResultsFree(results);
+        BlastHSPStreamResultsBatchArrayFree(batches);
+        return BLASTERR_MEMORY;
+    }
+    for (query_index = 0; query_index < num_queries; query_index++) {
+        last_batch[query_index] = -1;
+    }
+    for (b = 0; b < (Int4)batches->num_batches; b++) {
+        const BlastHSPStreamResultBatch* batch = batches->array_of_batches[b];
+        Int4 j;
+        for (j = 0; j < batch->num_hsplists; j++) {
+            last_batch[batch->hsplist_array[j]->query_index] = b;
+        }
     }
 
-    if(hit_params->options->query_cov_hsp_perc > 0 || hit_params->options->max_hsps_per_subject > 0 ||
-       (hit_params->options->hsp_filt_opt != NULL && hit_params->options->hsp_filt_opt->subject_besthit_opts != NULL)) {
-    	s_FilterBlastResults(results, hit_params->options, query_info, program_number);
+    num_threads = MAX(1, MIN(thread_data->num_elems, batches->num_batches));
+    /* Added for testing purposes only */
+    if (getenv("NCBI_BLAST_DISABLE_OPENMP")) {
+        num_threads = 1;
+    }
+    if (num_threads != thread_data->num_elems) {
+        SThreadLocalDataArrayTrim(thread_data, num_threads);
     }
+    window = num_threads * TRACEBACK_SUBJECTS_PER_THREAD;
 
-    /* Eliminate extra hits from results, if preliminary hit list size is
-       larger than the final hit list size */
-    s_BlastPruneExtraHits(results, hit_params->options->hitlist_size);
+    for (start = 0; start < (Int4)batches->num_batches || next_query < num_queries;
+         start = end) {
+        Int4 i;
+        end = MIN(start + window, (Int4)batches->num_batches);
+
+        /* Within a window the subjects with the most HSPs go first, as in
+           BLAST_ComputeTraceback_MT; this does not change which window a
+           subject belongs to, so the query bookkeeping above still holds */
+        if (num_threads > 1 && end - start > 1) {
+            qsort(batches->array_of_batches + start, end - start,
+                  sizeof(*batches->array_of_batches), s_CompareBatchesByWork);
+        }
 
-    if (retval == BLASTERR_INTERRUPTED) {
-        results = Blast_HSPResultsFree(results);
-    }
+#pragma omp parallel for default(none) num_threads(num_threads) schedule(dynamic) if (num_threads > 1) \
+        shared(retval, thread_data, batches, start, end, program_number, sbp, pattern_blk, query, query_info, default_db_genetic_code, has_been_interrupted, interrupt_search, progress_info)
+        for (i = start; i < end; i++) {
+            Int2 status = 0;
+            int tid = 0;
+            BlastHSPStreamResultBatch* batch = batches->array_of_batches[i];
 
-    *results_out = results;
+#ifdef _OPENMP
+            tid = omp_get_thread_num();
+#endif
+
+            /* check for interrupt */
+            if (interrupt_search && (*interrupt_search)(progress_info) == TRUE) {
+#pragma omp critical(retval)
+                {
+                    retval = BLASTERR_INTERRUPTED;
+                    has_been_interrupted = TRUE;
+                }
+            }
+#pragma omp flush(has_been_interrupted)
+            if (has_been_interrupted) {
+                batches->array_of_batches[i] = Blast_HSPStreamResultBatchReset(batch);
+                continue;
+            }
+
+            status = s_TracebackBatch(program_number, batch, thread_data->tld[tid],
+                                      sbp, pattern_blk, query, query_info,
+                                      default_db_genetic_code);
+            if (status) {
+#pragma omp critical(retval)
+                {
+                    retval = status;
+                    has_been_interrupted = TRUE;
+                }
+            }
+        } /* end of omp parallel for */
+
+        if (retval) {
+            break;
+        }
+        /* Hand over, in query order, the queries whose subjects are done */
+        while (next_query < num_queries && last_batch[next_query] < end) {
+            retval = s_PutQueryResults(program_number, next_query, results,
+                                       query, query_info, thread_data,
+                                       results_fn, user_data);
+            next_query++;
+            if (retval) {
+                break;
+            }
+        }
+        if (retval) {
+            break;
+        }
+    }
 
+    /* After an error, release whatever was not aligned */
+    for (b = 0; b < (Int4)batches->num_batches; b++) {
+        Blast_HSPStreamResultBatchReset(batches->array_of_batches[b]);
+    }
+    BlastHSPStreamResultsBatchArrayFree(batches);
+    sfree(last_batch);
+    Blast_HSPResultsFree(results);
     return retval;
 }
 
@@ -1836,3 +2191,84 @@ Blast_RunTracebackSearchWithInterrupt(EBlastProgramType program,
     thread_data = SThreadLocalDataArrayFree(thread_data);
     return status;
 }
+
+Boolean
+Blast_TracebackCanStreamPerQuery(EBlastProgramType program,
+                                 const BlastExtensionOptions* ext_options,
+                                 const BlastHSPStream* hsp_stream)
+{
+    /* Composition based statistics and Smith-Waterman traceback keep the
+       best matches of each query over all subjects until the end, RPS-BLAST
+       searches the queries as the database and traceback pipes (e.g. for
+       RMBlastN) need all results together */
+    return !Blast_ProgramIsRpsBlast(program) &&
+           ext_options->compositionBasedStats == 0 &&
+           ext_options->eTbackExt != eSmithWatermanTbck &&
+           hsp_stream->tback_pipe == NULL;
+}
+
+Int2
+Blast_RunTracebackSearchPerQuery(EBlastProgramType program,
+   BLAST_SequenceBlk* query, BlastQueryInfo* query_info,
+   const BlastSeqSrc* seq_src, const BlastScoringOptions* score_options,
+   const BlastExtensionOptions* ext_options,
+   const BlastHitSavingOptions* hit_options,
+   const BlastEffectiveLengthsOptions* eff_len_options,
+   const BlastDatabaseOptions* db_options,
+   const PSIBlastOptions* psi_options, BlastScoreBlk* sbp,
+   BlastHSPStream* hsp_stream, const BlastRPSInfo* rps_info,
+   SPHIPatternSearchBlk* pattern_blk,
+   TBlastQueryResultsFnPtr results_fn, void* user_data,
+   TInterruptFnPtr interrupt_search, SBlastProgress* progress_info,
+   size_t num_threads)
+{
+    const int N_T = ((num_threads == 0) ? 1 : num_threads);
+    Int2 status = 0;
+    SThreadLocalDataArray* thread_data = NULL;
+    BlastHSPResults* results = NULL;
+    Int4 query_index;
+
+    if (!query_info || !hsp_stream || !results_fn) {
+        return BLASTERR_INVALIDPARAM;
+    }
+
+    if ( !Blast_TracebackCanStreamPerQuery(program, ext_options, hsp_stream) ) {
+        status = Blast_RunTracebackSearchWithInterrupt(program, query,
+                     query_info, seq_src, score_options, ext_options,
+                     hit_options, eff_len_options, db_options, psi_options,
+                     sbp, hsp_stream, rps_info, pattern_blk, &results,
+                     interrupt_search, progress_info, num_threads);
+        for (query_index = 0; !status && results &&
+             query_index < results->num_queries; query_index++) {
+            status = (*results_fn)(results, query_index, user_data);
+            results->hitlist_array[query_index] =
+                Blast_HitListFree(results->hitlist_array[query_index]);
+        }
+        Blast_HSPResultsFree(results);
+        return status;
+    }
+
+    if ( !(thread_data = SThreadLocalDataArrayNew(N_T)) ) {
+        return BLASTERR_MEMORY;
+    }
+
+    status = SThreadLocalDataArraySetup(thread_data, program,
+                                        score_options, eff_len_options,
+                                        ext_options, hit_options, query_info,
+                                        sbp, (BlastSeqSrc*)seq_src);
+    if ( !status ) {
+        /* Prohibit any subsequent writing to the HSP stream. */
+        BlastHSPStreamClose(hsp_stream);
+
+        s_SThreadLocalDataArraySetGapXDropoffFinal(thread_data);
+        if (progress_info)
+            progress_info->stage = eTracebackSearch;
+
+        status = s_ComputeTracebackPerQuery_MT(program, hsp_stream, query,
+                                   query_info, thread_data, pattern_blk,
+                                   db_options->genetic_code, results_fn,
+                                   user_data, interrupt_search, progress_info);
+    }
+    thread_data = SThreadLocalDataArrayFree(thread_data);
+    return status;
+}
@@ -136,6 +136,57 @@ static Uint4* s_CountHspListsPerQuery(const SThreadLocalDataArray* data, Int4* n
     return retval;
 }
 
+/** Move the non-empty HSP lists found by all threads for one query into a
+ * single hit list
+ * @param array thread local data to take the HSP lists from [in|out]
+ * @param query_idx index of the query [in]
+ * @param num_hsplists number of HSP lists the threads hold for query_idx [in]
+ * @param hitlist_size maximal number of HSP lists to keep [in]
+ * @return the consolidated hit list or NULL if memory allocation failed
+ */
+static BlastHitList*
+s_ConsolidateHitList(SThreadLocalDataArray* array, Int4 query_idx,
+                     Uint4 num_hsplists, Int4 hitlist_size)
+{
+    Uint4 tid = 0;
+    BlastHitList* hits4query = Blast_HitListNew(hitlist_size);
+    if ( !hits4query ) {
+        return NULL;
+    }
+
+    hits4query->hsplist_array = (BlastHSPList**)
+        calloc(num_hsplists, sizeof(BlastHSPList*));
+    if ( !hits4query->hsplist_array ) {
+        return Blast_HitListFree(hits4query);
+    }
+
+    /* Consolidate the results for query_idx from all threads */
+    for (tid = 0; tid < array->num_elems; tid++) {
+        BlastHSPResults* thread_results = array->tld[tid]->results;
+        BlastHitList* thread_hitlist = thread_results->hitlist_array[query_idx];
+        Int4 i;
+
+        if ( !thread_hitlist ) {
+            continue;
+        }
+        /* transfer the BlastHSPList to the consolidated structure */
+        for (i = 0; i < thread_hitlist->hsplist_count; i++) {
+            if ( !Blast_HSPList_IsEmpty(thread_hitlist->hsplist_array[i])) {
+                hits4query->hsplist_array[hits4query->hsplist_count++] =
+                    thread_hitlist->hsplist_array[i];
+                thread_hitlist->hsplist_array[i] = NULL;
+            }
+        }
+        hits4query->worst_evalue = !tid
+            ? thread_hitlist->worst_evalue
+            : MAX(thread_hitlist->worst_evalue, hits4query->worst_evalue);
+        hits4query->low_score = !tid
+            ? thread_hitlist->low_score
+            : MIN(thread_hitlist->low_score, hits4query->low_score);
+    }
+    return hits4query;
+}
+
 BlastHSPResults* SThreadLocalDataArrayConsolidateResults(SThreadLocalDataArray* array)
 {
     BlastHSPResults* retval = NULL;
@@ -154,48 +205,48 @@ BlastHSPResults* SThreadLocalDataArrayConsolidateResults(SThreadLocalDataArray*
     hitlist_size = array->tld[0]->hit_params->options->hitlist_size;
 
     for (query_idx = 0; query_idx < num_queries; query_idx++) {
-        Uint4 tid = 0;
-        BlastHitList* hits4query = retval->hitlist_array[query_idx] =
-            Blast_HitListNew(hitlist_size);
-        if ( !hits4query ) {
+        retval->hitlist_array[query_idx] =
+            s_ConsolidateHitList(array, query_idx,
+                                 num_hsplists_per_query[query_idx],
+                                 hitlist_size);
+        if ( !retval->hitlist_array[query_idx] ) {
             retval = Blast_HSPResultsFree(retval);
             break;
         }
+    }
 
-        hits4query->hsplist_array = (BlastHSPList**)
-            calloc(num_hsplists_per_query[query_idx], sizeof(BlastHSPList*));
-        if ( !hits4query->hsplist_array ) {
-            retval = Blast_HSPResultsFree(retval);
-            break;
-        }
+    sfree(num_hsplists_per_query);
+    return retval;
+}
 
-        /* Consolidate the results for query_idx from all threads */
-        for (tid = 0; tid < array->num_elems; tid++) {
-            BlastHSPResults* thread_results = array->tld[tid]->results;
-            BlastHitList* thread_hitlist = thread_results->hitlist_array[query_idx];
-            Int4 i;
+BlastHitList*
+SThreadLocalDataArrayConsolidateQueryResults(SThreadLocalDataArray* array,
+                                             Int4 query_idx)
+{
+    BlastHitList* retval = NULL;
+    Uint4 num_hsplists = 0, tid = 0;
 
-            if ( !thread_hitlist ) {
-                continue;
-            }
-            /* transfer the BlastHSPList to the consolidated structure */
-            for (i = 0; i < thread_hitlist->hsplist_count; i++) {
-                if ( !Blast_HSPList_IsEmpty(thread_hitlist->hsplist_array[i])) {
-                    hits4query->hsplist_array[hits4query->hsplist_count++] =
-                        thread_hitlist->hsplist_array[i];
-                    thread_hitlist->hsplist_array[i] = NULL;
-                }
-            }
-            hits4query->worst_evalue = !tid
-                ? thread_hitlist->worst_evalue
-                : MAX(thread_hitlist->worst_evalue, hits4query->worst_evalue);
-            hits4query->low_score = !tid
-                ? thread_hitlist->low_score
-                : MIN(thread_hitlist->low_score, hits4query->low_score);
+    if ( !array ) {
+        return retval;
+    }
+
+    for (tid = 0; tid < array->num_elems; tid++) {
+        const BlastHitList* hitlist =
+            array->tld[tid]->results->hitlist_array[query_idx];
+        if (hitlist) {
+            num_hsplists += hitlist->hsplist_count;
         }
     }
 
-    sfree(num_hsplists_per_query);
+    retval = s_ConsolidateHitList(array, query_idx, num_hsplists,
+                          array->tld[0]->hit_params->options->hitlist_size);
+
+    /* What is left in the threads' hit lists are empty HSP lists */
+    for (tid = 0; tid < array->num_elems; tid++) {
+        BlastHSPResults* thread_results = array->tld[tid]->results;
+        thread_results->hitlist_array[query_idx] =
+            Blast_HitListFree(thread_results->hitlist_array[query_idx]);
+    }
     return retval;
 }
 
@@ -142,6 +142,18 @@ Int2 SThreadLocalDataArraySetup(SThreadLocalDataArray* array,
 NCBI_XBLAST_EXPORT
 BlastHSPResults* SThreadLocalDataArrayConsolidateResults(SThreadLocalDataArray* array);
 
+/** Extracts the hit list of a single query from its input, leaving the
+ * threads' results for the other queries untouched. The threads' hit lists
+ * for this query are freed.
+ * @param array structure to inspect and modify [in|out]
+ * @param query_idx index of the query to extract [in]
+ * @return Consolidated hit list or NULL in case of memory allocation failure
+ */
+NCBI_XBLAST_EXPORT
+BlastHitList*
+SThreadLocalDataArrayConsolidateQueryResults(SThreadLocalDataArray* array,
+                                             Int4 query_idx);
+
 /** Identical in function to BLAST_ComputeTraceback, but this performs its task
  * in a multi-threaded manner if OpenMP is available.
  */
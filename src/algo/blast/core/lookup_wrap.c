@@ -38,11 +38,13 @@
 #include <algo/blast/core/lookup_wrap.h>
 #include <algo/blast/core/blast_aalookup.h>
 #include <algo/blast/core/blast_nalookup.h>
+#include <algo/blast/core/blast_nascan.h>
 #include <algo/blast/core/phi_lookup.h>
 #include <algo/blast/core/blast_filter.h>
 #include <algo/blast/core/lookup_util.h>
 #include <algo/blast/core/blast_rps.h>
 #include <algo/blast/core/blast_encoding.h>
+#include <algo/blast/core/blast_util.h>
 
 Int2 LookupTableWrapInit(BLAST_SequenceBlk* query, 
         const LookupTableOptions* lookup_options,	
@@ -194,11 +196,24 @@ Int2 LookupTableWrapInit_MT(BLAST_SequenceBlk* query,
    return status;
 }
 
+/** Release a lookup table created by LookupTableWrapAttachImage. Only the
+ * table structure and its masked locations are owned by the table; the 
+ * arrays belong to the image.
+ * @param lookup The lookup table wrapper [in][out]
+ */
+static void s_LookupTableWrapDetachImage(LookupTableWrap* lookup);
+
 LookupTableWrap* LookupTableWrapFree(LookupTableWrap* lookup)
 {
    if (!lookup)
        return NULL;
 
+   if (lookup->image) {
+      s_LookupTableWrapDetachImage(lookup);
+      sfree(lookup);
+      return NULL;
+   }
+
    switch(lookup->lut_type) {
    case eMBLookupTable:
       lookup->lut = (void*) 
@@ -287,3 +302,453 @@ Int4 GetOffsetArraySize(LookupTableWrap* lookup)
    }
    return offset_array_size;
 }
+
+/*------------------------ Lookup table images ---------------------------*/
+
+/** Identifies a serialized lookup table ("BLUT") */
+#define LOOKUP_IMAGE_MAGIC 0x54554c42
+/** Version of the serialized lookup table layout */
+#define LOOKUP_IMAGE_VERSION 1
+/** Maximum number of arrays in a serialized lookup table */
+#define LOOKUP_IMAGE_MAX_SECTIONS 5
+/** Round a size up to a multiple of 8 bytes, so that every part of an
+    image is suitably aligned for the data it holds */
+#define LOOKUP_IMAGE_ALIGN(x) (((x) + 7) & ~((size_t)7))
+
+/** Header at the start of a serialized lookup table */
+typedef struct SLookupImageHeader {
+   Uint4 magic;           /**< LOOKUP_IMAGE_MAGIC */
+   Uint4 version;         /**< LOOKUP_IMAGE_VERSION */
+   Int4 lut_type;         /**< type of the lookup table (ELookupTableType) */
+   Int4 lut_struct_size;  /**< size of the lookup table structure */
+   Int4 query_length;     /**< length of the query the table was built for */
+   Int4 num_masked;       /**< number of masked locations */
+   Uint8 key;             /**< key from LookupTableWrapImageKey */
+   Uint8 image_size;      /**< total size of the image in bytes */
+} SLookupImageHeader;
+
+/** Add a block of memory to a 64-bit FNV-1a hash
+ * @param hash The hash so far [in]
+ * @param data The data to add [in]
+ * @param len Number of bytes in data [in]
+ * @return The updated hash
+ */
+static Uint8 s_LookupImageHash(Uint8 hash, const void* data, size_t len)
+{
+   const Uint1* p = (const Uint1*) data;
+   size_t i;
+
+   for (i = 0; i < len; i++) {
+      hash ^= p[i];
+      hash *= 0x100000001b3ULL;
+   }
+   return hash;
+}
+
+/** Add a score matrix to a lookup table image key
+ * @param hash The hash so far [in]
+ * @param matrix The score matrix [in]
+ * @return The updated hash
+ */
+static Uint8 s_LookupImageHashMatrix(Uint8 hash, 
+                                     const SBlastScoreMatrix* matrix)
+{
+   size_t i;
+
+   if (!matrix || !matrix->data)
+      return hash;
+   for (i = 0; i < matrix->ncols; i++)
+      hash = s_LookupImageHash(hash, matrix->data[i], 
+                               matrix->nrows * sizeof(int));
+   return hash;
+}
+
+/** Size of the structure behind a lookup table that can be serialized
+ * @param lut_type Type of the lookup table [in]
+ * @return The size in bytes, or 0 if the table cannot be serialized
+ */
+static size_t s_LookupImageStructSize(ELookupTableType lut_type)
+{
+   switch (lut_type) {
+   case eAaLookupTable:      return sizeof(BlastAaLookupTable);
+   case eSmallNaLookupTable: return sizeof(BlastSmallNaLookupTable);
+   case eNaLookupTable:      return sizeof(BlastNaLookupTable);
+   case eMBLookupTable:      return sizeof(BlastMBLookupTable);
+   default:                  return 0;
+   }
+}
+
+/** Locate the masked locations of a lookup table
+ * @param lut_type Type of the lookup table [in]
+ * @param lut The lookup table [in]
+ * @return Address of the masked locations field, or NULL if this type
+ *         of table has none
+ */
+static BlastSeqLoc** s_LookupImageMaskedLocs(ELookupTableType lut_type,
+                                             void* lut)
+{
+   switch (lut_type) {
+   case eSmallNaLookupTable:
+      return &((BlastSmallNaLookupTable*)lut)->masked_locations;
+   case eNaLookupTable:
+      return &((BlastNaLookupTable*)lut)->masked_locations;
+   case eMBLookupTable:
+      return &((BlastMBLookupTable*)lut)->masked_locations;
+   default:
+      return NULL;
+   }
+}
+
+/** Enumerate the arrays of a lookup table that are stored in an image. The
+ * sizes are derived from the scalar fields of the table only, so this also
+ * works on a copy of the table whose pointers are not yet valid.
+ * @param lut_type Type of the lookup table [in]
+ * @param lut The lookup table [in]
+ * @param query_length Length of the query the table was built for [in]
+ * @param fields Addresses of the pointer fields of lut [out]
+ * @param sizes Size in bytes of the array behind each field [out]
+ * @return Number of arrays, or -1 if the table cannot be serialized
+ */
+static Int4 s_LookupImageSections(ELookupTableType lut_type, void* lut,
+                                  Int4 query_length,
+                                  void** fields[LOOKUP_IMAGE_MAX_SECTIONS],
+                                  size_t sizes[LOOKUP_IMAGE_MAX_SECTIONS])
+{
+   Int4 num = 0;
+
+   switch (lut_type) {
+   case eAaLookupTable:
+      {
+         BlastAaLookupTable* lookup = (BlastAaLookupTable*) lut;
+         const Boolean kSmallbone = (lookup->bone_type == eSmallbone);
+         if (lookup->thin_backbone != NULL)
+            return -1;      /* not finalized */
+         fields[num] = &lookup->thick_backbone;
+         sizes[num++] = (size_t)lookup->backbone_size * (kSmallbone ?
+                                   sizeof(AaLookupSmallboneCell) :
+                                   sizeof(AaLookupBackboneCell));
+         fields[num] = &lookup->overflow;
+         sizes[num++] = (size_t)lookup->overflow_size *
+                                   (kSmallbone ? sizeof(Uint2) : sizeof(Int4));
+         fields[num] = (void**) &lookup->pv;
+         sizes[num++] = (size_t)((lookup->backbone_size >> PV_ARRAY_BTS) + 1) *
+                                   sizeof(PV_ARRAY_TYPE);
+      }
+      break;
+
+   case eSmallNaLookupTable:
+      {
+         BlastSmallNaLookupTable* lookup = (BlastSmallNaLookupTable*) lut;
+         fields[num] = (void**) &lookup->final_backbone;
+         sizes[num++] = (size_t)lookup->backbone_size * sizeof(Int2);
+         fields[num] = (void**) &lookup->overflow;
+         sizes[num++] = (size_t)lookup->overflow_size * sizeof(Int2);
+      }
+      break;
+
+   case eNaLookupTable:
+      {
+         BlastNaLookupTable* lookup = (BlastNaLookupTable*) lut;
+         fields[num] = (void**) &lookup->thick_backbone;
+         sizes[num++] = (size_t)lookup->backbone_size * 
+                                   sizeof(NaLookupBackboneCell);
+         fields[num] = (void**) &lookup->overflow;
+         sizes[num++] = (size_t)lookup->overflow_size * sizeof(Int4);
+         fields[num] = (void**) &lookup->pv;
+         sizes[num++] = (size_t)((lookup->backbone_size >> PV_ARRAY_BTS) + 1) *
+                                   sizeof(PV_ARRAY_TYPE);
+      }
+      break;
+
+   case eMBLookupTable:
+      {
+         BlastMBLookupTable* mb_lt = (BlastMBLookupTable*) lut;
+         fields[num] = (void**) &mb_lt->hashtable;
+         sizes[num++] = (size_t)mb_lt->hashsize * sizeof(Int4);
+         fields[num] = (void**) &mb_lt->next_pos;
+         sizes[num++] = (size_t)(query_length + 1) * sizeof(Int4);
+         fields[num] = (void**) &mb_lt->hashtable2;
+         sizes[num++] = mb_lt->two_templates ? 
+                              (size_t)mb_lt->hashsize * sizeof(Int4) : 0;
+         fields[num] = (void**) &mb_lt->next_pos2;
+         sizes[num++] = mb_lt->two_templates ? 
+                              (size_t)(query_length + 1) * sizeof(Int4) : 0;
+         fields[num] = (void**) &mb_lt->pv_array;
+         sizes[num++] = (size_t)(mb_lt->hashsize >> mb_lt->pv_array_bts) *
+                                   sizeof(PV_ARRAY_TYPE);
+      }
+      break;
+
+   default:
+      return -1;
+   }
+
+   ASSERT(num <= LOOKUP_IMAGE_MAX_SECTIONS);
+   return num;
+}
+
+Uint8 LookupTableWrapImageKey(const BLAST_SequenceBlk* query,
+        const LookupTableOptions* lookup_options,
+        const QuerySetUpOptions* query_options,
+        const BlastSeqLoc* lookup_segments,
+        const BlastScoreBlk* sbp)
+{
+   Uint8 hash = 0xcbf29ce484222325ULL;
+   Int4 fields[6];
+   Boolean mask_at_hash = FALSE;
+   const BlastSeqLoc* loc;
+
+   if (!query || !lookup_options)
+      return 0;
+
+   switch (lookup_options->lut_type) {
+   case eAaLookupTable:
+   case eSmallNaLookupTable:
+   case eNaLookupTable:
+   case eMBLookupTable:
+      break;
+   default:
+      return 0;
+   }
+
+   /* the database word counts make the table specific to one database */
+   if (lookup_options->db_filter)
+      return 0;
+
+   if (query_options) {
+      mask_at_hash = 
+         SBlastFilterOptionsMaskAtHash(query_options->filtering_options) ||
+         (query_options->filter_string &&
+          strstr(query_options->filter_string, "m"));
+   }
+
+   fields[0] = lookup_options->lut_type;
+   fields[1] = lookup_options->word_size;
+   fields[2] = lookup_options->mb_template_length;
+   fields[3] = lookup_options->mb_template_type;
+   fields[4] = lookup_options->program_number;
+   fields[5] = (Int4)lookup_options->stride;
+   hash = s_LookupImageHash(hash, fields, sizeof(fields));
+   hash = s_LookupImageHash(hash, &lookup_options->threshold,
+                            sizeof(lookup_options->threshold));
+   hash = s_LookupImageHash(hash, &mask_at_hash, sizeof(mask_at_hash));
+
+   hash = s_LookupImageHash(hash, &query->length, sizeof(query->length));
+   hash = s_LookupImageHash(hash, query->sequence, query->length);
+   for (loc = lookup_segments; loc; loc = loc->next)
+      hash = s_LookupImageHash(hash, loc->ssr, sizeof(SSeqRange));
+
+   if (lookup_options->lut_type == eAaLookupTable && sbp) {
+      if (sbp->psi_matrix && sbp->psi_matrix->pssm)
+         hash = s_LookupImageHashMatrix(hash, sbp->psi_matrix->pssm);
+      else
+         hash = s_LookupImageHashMatrix(hash, sbp->matrix);
+   }
+
+   /* zero is reserved for "cannot be shared" */
+   return hash ? hash : 1;
+}
+
+size_t LookupTableWrapImageSize(const LookupTableWrap* lookup,
+                                const BLAST_SequenceBlk* query)
+{
+   void** fields[LOOKUP_IMAGE_MAX_SECTIONS];
+   size_t sizes[LOOKUP_IMAGE_MAX_SECTIONS];
+   const size_t kStructSize = s_LookupImageStructSize(lookup->lut_type);
+   BlastSeqLoc** masked;
+   BlastSeqLoc* loc;
+   Int4 num_sections, i;
+   size_t retval;
+
+   if (!lookup->lut || lookup->image || kStructSize == 0)
+      return 0;
+   num_sections = s_LookupImageSections(lookup->lut_type, lookup->lut,
+                                        query->length, fields, sizes);
+   if (num_sections < 0)
+      return 0;
+
+   retval = LOOKUP_IMAGE_ALIGN(sizeof(SLookupImageHeader)) +
+            LOOKUP_IMAGE_ALIGN(kStructSize);
+   for (i = 0; i < num_sections; i++)
+      retval += LOOKUP_IMAGE_ALIGN(sizes[i]);
+
+   masked = s_LookupImageMaskedLocs(lookup->lut_type, lookup->lut);
+   for (loc = masked ? *masked : NULL; loc; loc = loc->next)
+      retval += sizeof(SSeqRange);
+
+   return LOOKUP_IMAGE_ALIGN(retval);
+}
+
+Int2 LookupTableWrapWriteImage(const LookupTableWrap* lookup,
+                               const BLAST_SequenceBlk* query, Uint8 key,
+                               void* buffer, size_t buffer_size)
+{
+   void** fields[LOOKUP_IMAGE_MAX_SECTIONS];
+   size_t sizes[LOOKUP_IMAGE_MAX_SECTIONS];
+   const size_t kImageSize = LookupTableWrapImageSize(lookup, query);
+   const size_t kStructSize = s_LookupImageStructSize(lookup->lut_type);
+   SLookupImageHeader* header = (SLookupImageHeader*) buffer;
+   Uint1* cursor = (Uint1*) buffer;
+   BlastSeqLoc** masked;
+   BlastSeqLoc* loc;
+   Int4 num_sections, i;
+
+   if (kImageSize == 0 || !buffer || buffer_size < kImageSize)
+      return -1;
+
+   num_sections = s_LookupImageSections(lookup->lut_type, lookup->lut,
+                                        query->length, fields, sizes);
+   masked = s_LookupImageMaskedLocs(lookup->lut_type, lookup->lut);
+
+   memset(buffer, 0, kImageSize);
+   header->magic = LOOKUP_IMAGE_MAGIC;
+   header->version = LOOKUP_IMAGE_VERSION;
+   header->lut_type = lookup->lut_type;
+   header->lut_struct_size = (Int4) kStructSize;
+   header->query_length = query->length;
+   header->key = key;
+   header->image_size = kImageSize;
+   cursor += LOOKUP_IMAGE_ALIGN(sizeof(SLookupImageHeader));
+
+   memcpy(cursor, lookup->lut, kStructSize);
+   cursor += LOOKUP_IMAGE_ALIGN(kStructSize);
+
+   for (i = 0; i < num_sections; i++) {
+      if (sizes[i] > 0)
+         memcpy(cursor, *fields[i], sizes[i]);
+      cursor += LOOKUP_IMAGE_ALIGN(sizes[i]);
+   }
+
+   for (loc = masked ? *masked : NULL; loc; loc = loc->next) {
+      memcpy(cursor, loc->ssr, sizeof(SSeqRange));
+      cursor += sizeof(SSeqRange);
+      header->num_masked++;
+   }
+
+   return 0;
+}
+
+Int2 LookupTableWrapAttachImage(const void* image, size_t image_size,
+                                Uint8 key, BLAST_SequenceBlk* query,
+                                T_LookupImageRelease release,
+                                void* release_handle,
+                                LookupTableWrap** lookup_wrap_ptr)
+{
+   void** fields[LOOKUP_IMAGE_MAX_SECTIONS];
+   size_t sizes[LOOKUP_IMAGE_MAX_SECTIONS];
+   const SLookupImageHeader* header = (const SLookupImageHeader*) image;
+   const Uint1* cursor = (const Uint1*) image;
+   size_t struct_size, expected_size;
+   LookupTableWrap* lookup_wrap;
+   BlastSeqLoc** masked;
+   BlastSeqLoc* tail = NULL;
+   Int4 num_sections, i;
+   void* lut;
+
+   *lookup_wrap_ptr = NULL;
+
+   if (!image || !query || image_size < sizeof(SLookupImageHeader) ||
+       ((size_t)image & 7) != 0)
+      return -1;
+   if (header->magic != LOOKUP_IMAGE_MAGIC ||
+       header->version != LOOKUP_IMAGE_VERSION ||
+       header->image_size != image_size ||
+       header->key != key ||
+       header->query_length != query->length)
+      return -1;
+
+   struct_size = s_LookupImageStructSize((ELookupTableType)header->lut_type);
+   if (struct_size == 0 || header->lut_struct_size != (Int4)struct_size ||
+       image_size < LOOKUP_IMAGE_ALIGN(sizeof(SLookupImageHeader)) +
+                    LOOKUP_IMAGE_ALIGN(struct_size))
+      return -1;
+
+   cursor += LOOKUP_IMAGE_ALIGN(sizeof(SLookupImageHeader));
+   lut = malloc(struct_size);
+   if (!lut)
+      return -1;
+   memcpy(lut, cursor, struct_size);
+   cursor += LOOKUP_IMAGE_ALIGN(struct_size);
+
+   num_sections = s_LookupImageSections((ELookupTableType)header->lut_type,
+                                        lut, query->length, fields, sizes);
+   masked = s_LookupImageMaskedLocs((ELookupTableType)header->lut_type, lut);
+   if (masked)
+      *masked = NULL;
+
+   /* the scalar fields of the table determine the layout of the rest of
+      the image; make sure it is all there before pointing into it */
+   expected_size = LOOKUP_IMAGE_ALIGN(sizeof(SLookupImageHeader)) +
+                   LOOKUP_IMAGE_ALIGN(struct_size);
+   for (i = 0; i < num_sections; i++)
+      expected_size += LOOKUP_IMAGE_ALIGN(sizes[i]);
+   expected_size += header->num_masked * sizeof(SSeqRange);
+   if (num_sections < 0 || header->num_masked < 0 ||
+       LOOKUP_IMAGE_ALIGN(expected_size) != image_size) {
+      sfree(lut);
+      return -1;
+   }
+
+   for (i = 0; i < num_sections; i++) {
+      *fields[i] = (sizes[i] > 0) ? (void*) cursor : NULL;
+      cursor += LOOKUP_IMAGE_ALIGN(sizes[i]);
+   }
+
+   for (i = 0; i < header->num_masked; i++) {
+      const SSeqRange* range = (const SSeqRange*) cursor;
+      tail = BlastSeqLocNew(tail ? &tail : masked, range->left, range->right);
+      cursor += sizeof(SSeqRange);
+   }
+
+   /* search-time callbacks are chosen by the engine, and the image may
+      come from another host; clear or redo what depends on the process
+      that wrote it */
+   switch (header->lut_type) {
+   case eAaLookupTable:
+      ((BlastAaLookupTable*)lut)->scansub_callback = NULL;
+      break;
+   case eSmallNaLookupTable:
+      ((BlastSmallNaLookupTable*)lut)->scansub_callback = NULL;
+      ((BlastSmallNaLookupTable*)lut)->extend_callback = NULL;
+      ((BlastSmallNaLookupTable*)lut)->scan_avx2 = BlastNaScanHaveAVX2();
+      /* the small table's ungapped extensions need the compressed query,
+         which BlastSmallNaLookupTableNew would have computed */
+      if (query->compressed_nuc_seq_start == NULL)
+         BlastCompressBlastnaSequence(query);
+      break;
+   case eNaLookupTable:
+      ((BlastNaLookupTable*)lut)->scansub_callback = NULL;
+      ((BlastNaLookupTable*)lut)->extend_callback = NULL;
+      break;
+   case eMBLookupTable:
+      ((BlastMBLookupTable*)lut)->scansub_callback = NULL;
+      ((BlastMBLookupTable*)lut)->extend_callback = NULL;
+      ((BlastMBLookupTable*)lut)->scan_avx2 = BlastNaScanHaveAVX2();
+      break;
+   }
+
+   *lookup_wrap_ptr = lookup_wrap = 
+      (LookupTableWrap*) calloc(1, sizeof(LookupTableWrap));
+   lookup_wrap->lut_type = (ELookupTableType) header->lut_type;
+   lookup_wrap->lut = lut;
+   lookup_wrap->image = image;
+   lookup_wrap->image_release = (void*) release;
+   lookup_wrap->image_handle = release_handle;
+
+   return 0;
+}
+
+static void s_LookupTableWrapDetachImage(LookupTableWrap* lookup)
+{
+   BlastSeqLoc** masked;
+
+   if (lookup->lut) {
+      masked = s_LookupImageMaskedLocs(lookup->lut_type, lookup->lut);
+      if (masked)
+         *masked = BlastSeqLocFree(*masked);
+      sfree(lookup->lut);
+   }
+   if (lookup->image_release)
+      ((T_LookupImageRelease)lookup->image_release)(lookup->image_handle);
+   lookup->image = NULL;
+}
@@ -392,6 +392,7 @@ CDbIndex::SOptions CDbIndex::DefaultSOptions()
         DBSEQ_CHUNK_OVERLAP,    // defined by BLAST
         REPORT_NORMAL,          // normal level of progress reporting
         1536,                   // max index size if 1.5 Gb by default
+        1,                      // build offset lists in one thread by default
     };
 
     return result;
@@ -412,7 +413,8 @@ unsigned long GetIndexVersion( CNcbiIstream & is )
 }
 
 //-------------------------------------------------------------------------
-CRef< CDbIndex > CDbIndex::Load( const std::string & fname, bool nomap )
+CRef< CDbIndex > CDbIndex::Load( 
+        const std::string & fname, bool nomap, bool preload )
 {
     CNcbiIfstream index_stream( fname.c_str() );
 
@@ -424,8 +426,8 @@ CRef< CDbIndex > CDbIndex::Load( const std::string & fname, bool nomap )
     index_stream.close();
 
     switch( version ) {
-        case VERSION:     return LoadIndex< true >( fname, nomap );
-        case VERSION + 1: return LoadIndex< false >( fname, nomap );
+        case VERSION:     return LoadIndex< true >( fname, nomap, preload );
+        case VERSION + 1: return LoadIndex< false >( fname, nomap, preload );
         default: 
             
             NCBI_THROW( 
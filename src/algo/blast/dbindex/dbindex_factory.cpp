@@ -36,6 +36,7 @@
 #include <sstream>
 #include <string>
 #include <corelib/ncbi_limits.hpp>
+#include <corelib/ncbithr.hpp>
 
 #include <objmgr/object_manager.hpp>
 #include <objmgr/seq_vector.hpp>
@@ -493,33 +494,43 @@ class CSubjectMap_Factory : public CSubjectMap_Factory_TBase
         */
         bool AddSequenceChunk( bool & overflow );
 
+        /** Information needed to encode the offsets of a sequence chunk. */
+        struct SChunkOffsets
+        {
+            TWord lid_;         /**< Local sequence id, shifted into place. */
+            TSeqPos base_;      /**< Position of the chunk start within the
+                                     local sequence. */
+        };
+
+        /** Find the local sequence containing a chunk.
+            The result does not change once the chunk is added, so the
+            local id map is only searched once per chunk.
+            @param seq start of the chunk data in the compressed sequence store
+            @return information needed to encode offsets within the chunk
+        */
+        SChunkOffsets GetChunkOffsets( const Uint1 * seq ) const;
+
         /** Check if index information should be produced for this offset.
             
             Typically it computes the full offset in way typical for the
             corresponding version of index and checks if it is a multiple
             of stride.
 
-            @param seq Start of the buffer containing the compressed sequence.
-            @param off Offset relative to the start of seq.
+            @param co offset encoding information for the chunk
+            @param off Offset relative to the start of the chunk.
             @return true if information about this offset should be in the index;
                     false otherwise.
         */
-        bool CheckOffset( const Uint1 * seq, TSeqPos off ) const;
-
-        /** Encode an offset given a pointer to the compressed sequence
-            data and relative offset.
-            @param seq start of the buffer containing the compressed sequence
-            @param off offset relative to the start of seq
-            @return encoded offset that can be added to an offset list
-        */
-        TWord MakeOffset( const Uint1 * seq, TSeqPos off ) const;
+        bool CheckOffset( const SChunkOffsets & co, TSeqPos off ) const
+        { return ((co.base_ + off)%this->stride_ == 0); }
 
-        /** Encode an offset given an internal oid and relative offset.
-            @param seq internal oid of a sequence
-            @param off offset relative to the start of seq
+        /** Encode an offset given the chunk information and relative offset.
+            @param co offset encoding information for the chunk
+            @param off offset relative to the start of the chunk
             @return encoded offset that can be added to an offset list
         */
-        TWord MakeOffset( TSeqNum seq, TSeqPos off ) const;
+        TWord MakeOffset( const SChunkOffsets & co, TSeqPos off ) const
+        { return co.lid_ + (co.base_ + off)/this->stride_ + this->min_offset_; }
 
         /** Save the subject map and sequence info.
             @param os output stream open in binary mode
@@ -876,39 +887,26 @@ bool CSubjectMap_Factory::AddSequenceChunk( bool & overflow )
 }
 
 //-------------------------------------------------------------------------
-inline bool CSubjectMap_Factory::CheckOffset( 
-        const Uint1 * seq, TSeqPos off ) const
+CSubjectMap_Factory::SChunkOffsets 
+CSubjectMap_Factory::GetChunkOffsets( const Uint1 * seq ) const
 {
+    // Local sequences are stored in the order of their start in
+    // seq_store; find the last one starting at or before seq.
     TSeqPos soff = seq - &(this->seq_store_[0]);
-    TLIdMap::const_reverse_iterator iter = lid_map_.rbegin();
-    while( iter != lid_map_.rend() && iter->seq_start_ > soff ) ++iter;
-    ASSERT( iter->seq_start_ <= soff );
-    off += (soff - iter->seq_start_)*CR;
-    return (off%stride_ == 0);
-}
+    TLIdMap::size_type lo = 0, hi = lid_map_.size();
 
-//-------------------------------------------------------------------------
-inline TWord CSubjectMap_Factory::MakeOffset(
-        const Uint1 * seq, TSeqPos off ) const
-{
-    TSeqPos soff = seq - &(this->seq_store_[0]);
-    TLIdMap::const_reverse_iterator iter = lid_map_.rbegin();
-    while( iter != lid_map_.rend() && iter->seq_start_ > soff ) ++iter;
-    ASSERT( iter->seq_start_ <= soff );
-    off += (soff - iter->seq_start_)*CR;
-    off /= stride_;
-    off += min_offset_;
-    TWord result = ((lid_map_.rend() - iter - 1)<<offset_bits_) + off;
-    return result;
-}
+    while( lo < hi ) {
+        TLIdMap::size_type mid = (lo + hi)/2;
 
-//-------------------------------------------------------------------------
-inline TWord CSubjectMap_Factory::MakeOffset(
-        TSeqNum seqnum, TSeqPos off ) const
-{
-    const Uint1 * seq = 
-        &(this->seq_store_)[0] + (this->chunks_)[seqnum].seq_start_;
-    return MakeOffset( seq, off );
+        if( lid_map_[mid].seq_start_ <= soff ) lo = mid + 1;
+        else hi = mid;
+    }
+
+    ASSERT( lo > 0 );
+    SChunkOffsets result;
+    result.lid_ = ((TWord)(lo - 1))<<offset_bits_;
+    result.base_ = (soff - lid_map_[lo - 1].seq_start_)*CR;
+    return result;
 }
 
 //-------------------------------------------------------------------------
@@ -956,21 +954,10 @@ class COffsetList
             mult_ = (options.ws_hint - options.hkey_width + 1)/options.stride;
         }
 
-        /** Add an offset to the list. Update the total.
+        /** Add an offset to the list.
             @param item  [I]   offset to be appended to the list
-            @param total [I/O] change in the length of the list will
-                               be applied to this argument
         */
-        void AddData( TWord item, TWord & total );
-
-        /** Truncate the list to the value of offset. Update the total.
-            The function removes the tail of the list corresponding
-            to elements that are at least as great as offset.
-            @param offset [I]   offset value threshold
-            @param total  [I/O] change in the length of the list will
-                                be applied to this argument
-        */
-        void TruncateList( TWord offset, TWord & total );
+        void AddData( TWord item ) { data_.push_back( item ); }
 
         /** Return the size of the offset list in words.
             @return size of the list in words
@@ -1251,43 +1238,18 @@ inline void COffsetList::Save( CNcbiOstream & os) const
     }
 }
 
-//-------------------------------------------------------------------------
-inline void COffsetList::AddData( TWord item, TWord & total )
-{
-    data_.push_back( item );
-    ++total;
-}
-
-//-------------------------------------------------------------------------
-inline void COffsetList::TruncateList( TWord offset, TWord & total )
-{
-    bool flag = false;
-    TData::const_iterator it = data_.begin();
-
-    for( TData::size_type i = 0; i < data_.size(); ++i, ++it ) {
-        if( *it < min_offset_ ) {
-            flag = true;
-            continue;
-        }
-
-        if( *it >= offset ) {
-            if( flag ) {
-                --i; --it;
-            }
-
-            TData::size_type diff = data_.size() - i;
-            data_.resize( i );
-            total -= diff;
-            return;
-        }else {
-            flag = false;
-        }
-    }
-}
-
 //-------------------------------------------------------------------------
 /** A class responsible for creation and management of Nmer
     offset lists.
+
+    While the subject map grows, only the number of words each sequence
+    chunk adds to the offset lists is computed, so that the index size
+    is known without building the lists.  The lists are built once the
+    final set of chunks is known.  With several threads, each thread
+    collects the offsets of a range of chunks into per-thread buckets,
+    one bucket for each group of Nmer values, and the buckets are then
+    merged into the offset lists by the thread owning the group, in
+    chunk order.
 */
 class COffsetData_Factory 
 {
@@ -1302,20 +1264,23 @@ class COffsetData_Factory
         */
         COffsetData_Factory( 
                 TSubjectMap & subject_map, 
-                const CDbIndex::SOptions & options,
-                COffsetList::CDataPool * pool )
+                const CDbIndex::SOptions & options )
             : subject_map_( subject_map ),
               hash_table_( 1<<(2*options.hkey_width) ),
               total_( 0 ),
               hkey_width_( options.hkey_width ),
               last_seq_( 0 ),
               options_( options ),
-              code_bits_( GetCodeBits( options.stride ) )
+              code_bits_( GetCodeBits( options.stride ) ),
+              min_offset_( GetMinOffset( options.stride ) ),
+              pools_( std::max( options.num_threads, 1UL ) )
         {
+            TWord nmer = 0;
+
             for( THashTable::iterator i = hash_table_.begin();
-                    i != hash_table_.end(); ++i ) {
+                    i != hash_table_.end(); ++i, ++nmer ) {
                 i->SetIndexParams( options_ );
-                i->SetDataPool( pool );
+                i->SetDataPool( &pools_[NmerOwner( nmer )] );
             }
         }
 
@@ -1324,11 +1289,16 @@ class COffsetData_Factory
         */
         const TWord total() const { return total_; }
 
-        /** Bring offset lists up to date with the corresponding
+        /** Bring the offset list size up to date with the corresponding
             subject map instance.
         */
         void Update();
 
+        /** Build the offset lists for all sequence chunks added to the
+            subject map.
+        */
+        void BuildLists();
+
         /** Save the offset lists into the binary output stream.
             @param os output stream; must be open in binary mode
         */
@@ -1347,30 +1317,88 @@ class COffsetData_Factory
         */
         typedef std::vector< TOffsetList > THashTable;
 
-        /** Truncate the offset lists according to the information
-            from the subject map.
-            Checks if the last oid for which information is added
-            to the offset lists is more than the last valid oid
-            in the subject map and erases extraenious information.
+        /** Offset data collected by one thread for one group of Nmer
+            values: each Nmer value followed by its offset list data.
         */
-        void Truncate();
+        typedef std::vector< TWord > TBucket;
+
+        /** Buckets of one thread, indexed by Nmer group. */
+        typedef std::vector< TBucket > TBuckets;
+
+        /** Thread running one stage of BuildLists(). */
+        class CBuildThread : public CThread
+        {
+            public:
+
+                /** Object constructor.
+                    @param owner object whose lists are built
+                    @param merge true to merge buckets, false to fill them
+                    @param index index of the thread
+                */
+                CBuildThread( 
+                        COffsetData_Factory & owner, 
+                        bool merge, unsigned long index )
+                    : owner_( owner ), merge_( merge ), index_( index )
+                {}
+
+            protected:
+
+                /** Thread entry point. */
+                virtual void * Main()
+                {
+                    if( merge_ ) owner_.MergeBuckets( index_ );
+                    else owner_.FillBuckets( index_ );
+                    return 0;
+                }
+
+            private:
+
+                COffsetData_Factory & owner_;   /**< Object whose lists are built. */
+                bool merge_;                    /**< Stage run by the thread. */
+                unsigned long index_;           /**< Index of the thread. */
+        };
+
+        /** Number of low bits of an Nmer value ignored when assigning
+            it to a thread, so that each thread owns runs of adjacent
+            offset lists.
+        */
+        static const unsigned long NMER_GROUP_BITS = 10;
+
+        /** Get the thread owning the offset list of an Nmer value.
+            @param nmer the Nmer value
+            @return index of the thread (and of the data pool) used for
+                    the offset list of nmer
+        */
+        unsigned long NmerOwner( TWord nmer ) const
+        { return (nmer>>NMER_GROUP_BITS)%pools_.size(); }
+
+        /** Compute the number of words the given sequence adds to the
+            offset lists.
+            @param sinfo sequence information
+            @return number of offset list words for sinfo
+        */
+        TWord CountSeqInfo( const TSeqInfo & sinfo ) const;
 
         /** Update offset lists with information corresponding to
             the given sequence.
             @param sinfo new sequence information
+            @param buckets if not NULL, buckets to add the data to instead
+                           of the offset lists
         */
-        void AddSeqInfo( const TSeqInfo & sinfo );
+        void AddSeqInfo( const TSeqInfo & sinfo, TBuckets * buckets );
 
         /** Update offset lists with information corresponding to
             the given valid segment of a sequence.
             @param seq points to the start of the sequence
-            @param seqlen length of seq
+            @param co offset encoding information for the sequence
             @param start start of the segment
             @param stop one past the end of the segment
+            @param buckets if not NULL, buckets to add the data to instead
+                           of the offset lists
         */
         void AddSeqSeg( 
-                const Uint1 * seq, TWord seqlen,
-                TSeqPos start, TSeqPos stop );
+                const Uint1 * seq, const TSubjectMap::SChunkOffsets & co,
+                TSeqPos start, TSeqPos stop, TBuckets * buckets );
 
         /** Encode the offset data and add to the offset list 
             corresponding to the given Nmer value.
@@ -1379,11 +1407,30 @@ class COffsetData_Factory
             @param stop one past the end of the current valid segment
             @param curr end of the Nmer within the sequence
             @param offset offset encoded with subject map instance
+            @param buckets if not NULL, buckets to add the data to instead
+                           of the offset lists
         */
         void EncodeAndAddOffset( 
                 TWord nmer,
                 TSeqPos start, TSeqPos stop,
-                TSeqPos curr, TWord offset );
+                TSeqPos curr, TWord offset, TBuckets * buckets );
+
+        /** Collect the offset data of one range of sequences into
+            the buckets of a thread.
+            @param index index of the thread
+        */
+        void FillBuckets( unsigned long index );
+
+        /** Move the data of the buckets for the Nmer values owned by
+            a thread into the offset lists.
+            @param index index of the thread
+        */
+        void MergeBuckets( unsigned long index );
+
+        /** Run one stage of BuildLists() in all threads.
+            @param merge true to merge buckets, false to fill them
+        */
+        void RunThreads( bool merge );
 
         TSubjectMap & subject_map_;     /**< Instance of subject map structure. */
         THashTable hash_table_;         /**< Mapping from Nmer values to the corresponding offset lists. */
@@ -1393,6 +1440,13 @@ class COffsetData_Factory
 
         const CDbIndex::SOptions & options_; /**< Index options. */
         unsigned long code_bits_;            /**< Number of bits to encode special offset prefixes. */
+        unsigned long min_offset_;           /**< Minimum offset value used by the index. */
+
+        std::vector< TWord > seq_words_;     /**< Number of offset list words for each sequence. */
+        std::vector< COffsetList::CDataPool > pools_; /**< Offset list storage, one per thread. */
+        std::vector< TSeqNum > bounds_;      /**< First sequence of each thread's range and
+                                                  one past the last sequence. */
+        std::vector< TBuckets > buckets_;    /**< Buckets of each thread. */
 };
 
 //-------------------------------------------------------------------------
@@ -1449,26 +1503,37 @@ void COffsetData_Factory::Save( CNcbiOstream & os )
 //-------------------------------------------------------------------------
 void COffsetData_Factory::EncodeAndAddOffset(
         TWord nmer, TSeqPos start, TSeqPos stop, 
-        TSeqPos curr, TWord offset )
+        TSeqPos curr, TWord offset, TBuckets * buckets )
 {
     TSeqPos start_diff = curr + 2 - hkey_width_ - start;
     TSeqPos end_diff = stop - curr;
+    bool special = 
+        (start_diff <= options_.stride || end_diff <= options_.stride);
+    TWord code = 0;
 
-    if( start_diff <= options_.stride || end_diff <= options_.stride ) {
+    if( special ) {
         if( start_diff > options_.stride ) start_diff = 0;
         if( end_diff > options_.stride ) end_diff = 0;
-        TWord code = (start_diff<<code_bits_) + end_diff;
-        hash_table_[(THashTable::size_type)nmer].AddData( 
-                code, total_ );
+        code = (start_diff<<code_bits_) + end_diff;
     }
 
-    hash_table_[(THashTable::size_type)nmer].AddData( 
-            offset, total_ );
+    if( buckets == 0 ) {
+        TOffsetList & list = hash_table_[(THashTable::size_type)nmer];
+        if( special ) list.AddData( code );
+        list.AddData( offset );
+    }
+    else {
+        TBucket & bucket = (*buckets)[NmerOwner( nmer )];
+        bucket.push_back( nmer );
+        if( special ) bucket.push_back( code );
+        bucket.push_back( offset );
+    }
 }
 
 //-------------------------------------------------------------------------
 void COffsetData_Factory::AddSeqSeg(
-        const Uint1 * seq, TWord , TSeqPos start, TSeqPos stop )
+        const Uint1 * seq, const TSubjectMap::SChunkOffsets & co,
+        TSeqPos start, TSeqPos stop, TBuckets * buckets )
 {
     const TWord nmer_mask = (((TWord)1)<<(2*hkey_width_)) - 1;
     const Uint1 letter_mask = 0x3;
@@ -1481,52 +1546,157 @@ void COffsetData_Factory::AddSeqSeg(
         nmer = ((nmer<<2)&nmer_mask) + letter;
 
         if( count >= hkey_width_ - 1 ) {
-            if( subject_map_.CheckOffset( seq, curr ) ) {
-                TWord offset = subject_map_.MakeOffset( seq, curr );
-                EncodeAndAddOffset( nmer, start, stop, curr, offset );
+            if( subject_map_.CheckOffset( co, curr ) ) {
+                TWord offset = subject_map_.MakeOffset( co, curr );
+                EncodeAndAddOffset( 
+                        nmer, start, stop, curr, offset, buckets );
             }
         }
     }
 }
 
 //-------------------------------------------------------------------------
-void COffsetData_Factory::AddSeqInfo( const TSeqInfo & sinfo )
+void COffsetData_Factory::AddSeqInfo( 
+        const TSeqInfo & sinfo, TBuckets * buckets )
 {
+    const Uint1 * seq = subject_map_.seq_store_start() + sinfo.seq_start_;
+    TSubjectMap::SChunkOffsets co = subject_map_.GetChunkOffsets( seq );
+
     for( TSeqInfo::TSegs::const_iterator it = sinfo.segs_.begin();
             it != sinfo.segs_.end(); ++it ) {
-        AddSeqSeg( 
-                subject_map_.seq_store_start() + sinfo.seq_start_, 
-                sinfo.len_, it->start_, it->stop_ );
+        AddSeqSeg( seq, co, it->start_, it->stop_, buckets );
     }
 }
 
 //-------------------------------------------------------------------------
-void COffsetData_Factory::Truncate()
+TWord COffsetData_Factory::CountSeqInfo( const TSeqInfo & sinfo ) const
 {
-    last_seq_ = subject_map_.LastGoodSequence();
-    TWord offset = subject_map_.MakeOffset( last_seq_, 0 );
+    // Mirrors AddSeqSeg() and EncodeAndAddOffset(), visiting only the
+    // positions that are stored in the index.
+    const Uint1 * seq = subject_map_.seq_store_start() + sinfo.seq_start_;
+    TSubjectMap::SChunkOffsets co = subject_map_.GetChunkOffsets( seq );
+    TSeqPos stride = options_.stride;
+    TWord result = 0;
 
-    for( THashTable::iterator it = hash_table_.begin();
-            it != hash_table_.end(); ++it ) {
-        it->TruncateList( offset, total_ );
+    for( TSeqInfo::TSegs::const_iterator it = sinfo.segs_.begin();
+            it != sinfo.segs_.end(); ++it ) {
+        TSeqPos start = it->start_, stop = it->stop_;
+        TSeqPos curr = start + hkey_width_ - 1;
+        TSeqPos rem = (co.base_ + curr)%stride;
+        if( rem != 0 ) curr += stride - rem;
+
+        for( ; curr < stop; curr += stride ) {
+            TSeqPos start_diff = curr + 2 - hkey_width_ - start;
+            TSeqPos end_diff = stop - curr;
+            result += (start_diff <= stride || end_diff <= stride) ? 2 : 1;
+        }
     }
+
+    return result;
 }
 
 //-------------------------------------------------------------------------
 void COffsetData_Factory::Update()
 {
-    if( subject_map_.LastGoodSequence() < last_seq_ ) {
-        Truncate();
+    // Forget the sequences the subject map has rolled back.
+    while( subject_map_.LastGoodSequence() < last_seq_ ) {
+        total_ -= seq_words_[--last_seq_];
     }
 
+    seq_words_.resize( last_seq_ );
     const TSeqInfo * sinfo;
 
     while( (sinfo = subject_map_.GetSeqInfo( last_seq_ + 1 )) != 0 ) {
-        AddSeqInfo( *sinfo );
+        TWord words = CountSeqInfo( *sinfo );
+        seq_words_.push_back( words );
+        total_ += words;
         ++last_seq_;
     }
 }
 
+//-------------------------------------------------------------------------
+void COffsetData_Factory::FillBuckets( unsigned long index )
+{
+    TBuckets & buckets = buckets_[index];
+    buckets.resize( pools_.size() );
+
+    for( TSeqNum snum = bounds_[index]; snum < bounds_[index + 1]; ++snum ) {
+        AddSeqInfo( *subject_map_.GetSeqInfo( snum ), &buckets );
+    }
+}
+
+//-------------------------------------------------------------------------
+void COffsetData_Factory::MergeBuckets( unsigned long index )
+{
+    for( unsigned long i = 0; i < buckets_.size(); ++i ) {
+        TBucket & bucket = buckets_[i][index];
+
+        for( TBucket::const_iterator it = bucket.begin(); 
+                it != bucket.end(); ) {
+            TOffsetList & list = hash_table_[(THashTable::size_type)*it++];
+            if( *it < min_offset_ ) list.AddData( *it++ );
+            list.AddData( *it++ );
+        }
+
+        TBucket().swap( bucket );
+    }
+}
+
+//-------------------------------------------------------------------------
+void COffsetData_Factory::RunThreads( bool merge )
+{
+    std::vector< CRef< CBuildThread > > threads;
+
+    for( unsigned long i = 0; i < pools_.size(); ++i ) {
+        threads.push_back( 
+                CRef< CBuildThread >( new CBuildThread( *this, merge, i ) ) );
+        threads.back()->Run();
+    }
+
+    for( unsigned long i = 0; i < threads.size(); ++i ) {
+        threads[i]->Join();
+    }
+}
+
+//-------------------------------------------------------------------------
+void COffsetData_Factory::BuildLists()
+{
+    ASSERT( last_seq_ == subject_map_.LastGoodSequence() );
+    unsigned long num_threads = pools_.size();
+
+    if( num_threads == 1 ) {
+        for( TSeqNum snum = 1; snum <= last_seq_; ++snum ) {
+            AddSeqInfo( *subject_map_.GetSeqInfo( snum ), 0 );
+        }
+
+        return;
+    }
+
+    // Give each thread a range of sequences with about the same
+    // amount of offset data.  The buckets hold two words per offset
+    // until they are merged, so building takes about twice the
+    // memory of the volume; this is not counted against max_index_size,
+    // which keeps the volumes the same for any number of threads.
+    bounds_.assign( 1, 1 );
+    Uint8 done = 0;
+
+    for( TSeqNum snum = 1; 
+            snum <= last_seq_ && bounds_.size() < num_threads; ++snum ) {
+        done += seq_words_[snum - 1];
+
+        if( done*num_threads >= (Uint8)total_*bounds_.size() ) {
+            bounds_.push_back( snum + 1 );
+        }
+    }
+
+    bounds_.resize( num_threads + 1, last_seq_ + 1 );
+    buckets_.resize( num_threads );
+    RunThreads( false );
+    RunThreads( true );
+    buckets_.clear();
+    bounds_.clear();
+}
+
 //-------------------------------------------------------------------------
 /** Index factory implementation.
   */
@@ -1662,11 +1832,8 @@ void CDbIndex_Factory::do_create_1_2(
     typedef CSubjectMap_Factory TSubjectMap;
     typedef COffsetData_Factory TOffsetData;
 
-    std::auto_ptr< COffsetList::CDataPool > pool( 
-            new COffsetList::CDataPool );
-
     TSubjectMap subject_map( options );
-    TOffsetData offset_data( subject_map, options, pool.get() );
+    TOffsetData offset_data( subject_map, options );
 
     TSeqNum i = start;
 
@@ -1741,6 +1908,7 @@ void CDbIndex_Factory::do_create_1_2(
            << " bytes (not counting the hash table)." << std::endl;
     }
 
+    offset_data.BuildLists();
     CNcbiOfstream os( oname.c_str(), IOS_BASE::binary );
     SaveHeader( os, options, start, start_chunk, stop, stop_chunk );
     offset_data.Save( os );
@@ -36,6 +36,11 @@
 #include <algorithm>
 
 #include <corelib/ncbifile.hpp>
+#include <corelib/ncbi_system.hpp>
+
+#ifdef NCBI_OS_UNIX
+#  include <sys/mman.h>
+#endif
 
 #include <algo/blast/core/blast_extend.h>
 #include <algo/blast/core/blast_gapalign.h>
@@ -62,10 +67,13 @@ typedef CDbIndex::TWord TWord;
 
 //-------------------------------------------------------------------------
 /** Memory map a file and return a pointer to the mapped area.
+    The file is mapped read only and shared, so the pages are loaded
+    lazily and the page cache is shared between processes.
     @param fname        [I]     file name
+    @param preload      [I]     if 'true', fault in all pages of the file
     @return pointer to the start of the mapped memory area
 */
-CMemoryFile * MapFile( const std::string & fname )
+CMemoryFile * MapFile( const std::string & fname, bool preload )
 {
     CMemoryFile * result = 0;
 
@@ -79,6 +87,15 @@ CMemoryFile * MapFile( const std::string & fname )
             delete result;
             result = 0;
         }
+        else if( preload ) {
+            result->MemMapAdvise( CMemoryFile::eMMA_WillNeed );
+            const volatile char * p = (const char *)result->GetPtr();
+            size_t len = result->GetSize();
+            size_t page = CSystemInfo::GetVirtualMemoryPageSize();
+            char sum = 0;
+            for( size_t i = 0; i < len; i += page ) sum += p[i];
+            (void)sum;
+        }
     }
 
     if( result == 0 ) {
@@ -92,6 +109,41 @@ CMemoryFile * MapFile( const std::string & fname )
     return result;
 }
 
+//-------------------------------------------------------------------------
+/** Compute the number of bytes of a memory area that are currently
+    resident in physical memory.
+    @param addr         [I]     start of the memory area
+    @param len          [I]     length of the memory area in bytes
+    @param resident     [O]     number of resident bytes; 0 if unknown
+    @return false if the resident size can not be determined on the
+            current platform
+*/
+bool GetResidentSize( const void * addr, size_t len, Uint8 & resident )
+{
+    resident = 0;
+#ifdef NCBI_OS_UNIX
+    if( len == 0 ) return true;
+    size_t page = CSystemInfo::GetVirtualMemoryPageSize();
+    size_t start = (size_t)addr - (size_t)addr%page;
+    size_t end = (size_t)addr + len;
+    size_t npages = (end - start + page - 1)/page;
+#ifdef NCBI_OS_DARWIN
+    std::vector< char > vec( npages );
+#else
+    std::vector< unsigned char > vec( npages );
+#endif
+
+    if( mincore( (void *)start, end - start, &vec[0] ) != 0 ) return false;
+    Uint8 result = 0;
+    for( size_t i = 0; i < npages; ++i ) if( vec[i]&1 ) ++result;
+    result *= page;
+    resident = result < len ? result : len;
+    return true;
+#else
+    return false;
+#endif
+}
+
 //-------------------------------------------------------------------------
 /** Type used to iterate over the consecutive Nmer values of the query
     sequence.
@@ -118,6 +118,12 @@ void CMkIndexApplication::Init()
             "stride", "stride",
             "distance between stored database positions",
             CArgDescriptions::eInteger );
+    arg_desc->AddDefaultKey(
+            "num_threads", "int_value",
+            "number of threads used to build each index volume; "
+            "with more than one, building a volume takes about "
+            "twice -volsize of memory",
+            CArgDescriptions::eInteger, "1" );
     arg_desc->AddDefaultKey(
             "old_style_index", "boolean",
             "Use old style index (deprecated)",
@@ -137,6 +143,9 @@ void CMkIndexApplication::Init()
     arg_desc->SetConstraint(
             "ws_hint",
             new CArgAllow_Integers( 1, kMax_Int ) );
+    arg_desc->SetConstraint(
+            "num_threads",
+            new CArgAllow_Integers( 1, kMax_Int ) );
     arg_desc->SetConstraint(
             "nmer",
             new CArgAllow_Integers( 8, 15 ) );
@@ -176,6 +185,7 @@ int CMkIndexApplication::Run()
 
     options.legacy = GetArgs()["legacy"].AsBoolean();
     options.idmap  = GetArgs()["idmap"].AsBoolean();
+    options.num_threads = GetArgs()["num_threads"].AsInteger();
 
     if( GetArgs()["stride"] ) {
         if( options.legacy ) {
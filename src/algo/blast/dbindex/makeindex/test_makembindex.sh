@@ -0,0 +1,70 @@
+#! /bin/sh
+# $Id$
+#
+# Build the same index with one and with several threads, in both index
+# formats, and check that every volume is byte-identical.  The volume
+# size is small enough for the input to be split into several volumes.
+
+PATH=".:${CFG_BIN}${CFG_BIN:+:}${PATH}"
+makembindex -help >/dev/null 2>&1  ||  {
+    echo "makembindex not found.  Stop."
+    exit 1
+}
+
+dir=test_makembindex.$$
+trap 'rm -rf $dir' 0 1 2 15
+mkdir $dir  ||  exit 1
+
+# 60 pseudo-random sequences of 20-60 kbases, with some repeats so that
+# the offset lists differ in length
+awk 'BEGIN {
+    srand(17); split("A C G T", n, " ");
+    for (s = 1; s <= 60; ++s) {
+        print ">seq" s;
+        len = 20000 + int(rand()*40000); line = "";
+        for (i = 0; i < len; ++i) {
+            if (i >= 1000 && rand() < 0.2) line = line substr(prev, i%1000 + 1, 1);
+            else line = line n[int(rand()*4) + 1];
+            if (length(line) == 80) { print line; prev = prev line; line = ""; }
+            if (length(prev) > 1000) prev = substr(prev, length(prev) - 999);
+        }
+        if (line != "") print line;
+    }
+}' > $dir/input.fa  ||  exit 1
+
+status=0
+
+for legacy in true false; do
+    for threads in 1 4; do
+        makembindex -input $dir/input.fa -iformat fasta \
+            -old_style_index true -legacy $legacy -volsize 1 \
+            -num_threads $threads -output $dir/$legacy.$threads \
+            2>$dir/log  ||  {
+            cat $dir/log
+            echo "makembindex -legacy $legacy -num_threads $threads failed"
+            exit 1
+        }
+    done
+
+    nvol=0
+    for vol in $dir/$legacy.1.*.idx; do
+        nvol=`expr $nvol + 1`
+        other=$dir/$legacy.4.`basename $vol | sed "s/^$legacy\.1\.//"`
+        cmp $vol $other  ||  {
+            echo "-legacy $legacy: $other differs from $vol"
+            status=1
+        }
+    done
+
+    if [ `ls $dir/$legacy.4.*.idx | wc -l` -ne `ls $dir/$legacy.1.*.idx | wc -l` ]; then
+        echo "-legacy $legacy: different number of volumes"
+        status=1
+    fi
+
+    if [ $nvol -lt 2 ]; then
+        echo "-legacy $legacy: expected several volumes, got $nvol"
+        status=1
+    fi
+done
+
+exit $status
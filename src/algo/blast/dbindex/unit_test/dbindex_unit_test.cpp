@@ -0,0 +1,120 @@
+/*  $Id$
+ * ===========================================================================
+ *
+ *                            PUBLIC DOMAIN NOTICE
+ *               National Center for Biotechnology Information
+ *
+ *  This software/database is a "United States Government Work" under the
+ *  terms of the United States Copyright Act.  It was written as part of
+ *  the author's official duties as a United States Government employee and
+ *  thus cannot be copyrighted.  This software/database is freely available
+ *  to the public for use. The National Library of Medicine and the U.S.
+ *  Government have not placed any restriction on its use or reproduction.
+ *
+ *  Although all reasonable efforts have been taken to ensure the accuracy
+ *  and reliability of the software and data, the NLM and the U.S.
+ *  Government do not and cannot warrant the performance or results that
+ *  may be obtained by using this software or data. The NLM and the U.S.
+ *  Government disclaim all warranties, express or implied, including
+ *  warranties of performance, merchantability or fitness for any particular
+ *  purpose.
+ *
+ *  Please cite the author in any work or product based on this material.
+ *
+ * ===========================================================================
+ *
+ * File Description:
+ *   Unit tests for loading megablast database indices.
+ *
+ * ===========================================================================
+ */
+
+#include <ncbi_pch.hpp>
+
+#include <corelib/ncbifile.hpp>
+#include <corelib/test_boost.hpp>
+
+#include <algo/blast/dbindex/dbindex.hpp>
+#include <algo/blast/dbindex/sequence_istream_fasta.hpp>
+
+#include <sstream>
+
+USING_NCBI_SCOPE;
+USING_SCOPE( blastdbindex );
+
+//-------------------------------------------------------------------------
+/** Build a one volume index of a few pseudo-random sequences.
+    @param legacy  [I]  whether to build the legacy index format
+    @return name of the index volume
+*/
+static string s_MakeIndex( bool legacy )
+{
+    string fasta;
+    Uint4 state = 17;
+
+    for( int s = 0; s < 4; ++s ) {
+        fasta += ">seq" + NStr::IntToString( s ) + "\n";
+
+        for( int i = 0; i < 20000; ++i ) {
+            state = state*1103515245 + 12345;
+            fasta += "ACGT"[(state >> 16)&3];
+            if( i%80 == 79 ) fasta += "\n";
+        }
+
+        fasta += "\n";
+    }
+
+    istringstream input( fasta );
+    CSequenceIStreamFasta seqstream( input );
+    CDbIndex::SOptions options = CDbIndex::DefaultSOptions();
+    options.report_level = REPORT_QUIET;
+    options.legacy = legacy;
+
+    string name( CDirEntry::GetTmpName() + ".00.idx" );
+    CDbIndex::TSeqNum stop = kMax_UI4;
+    CDbIndex::MakeIndex( seqstream, name, 0, stop, options );
+    BOOST_REQUIRE_EQUAL( 4U, stop );
+    return name;
+}
+
+BOOST_AUTO_TEST_SUITE( dbindex )
+
+// A memory mapped index loaded with preload is reported as mapped in full
+// and, where mincore() is available, as fully resident.
+BOOST_AUTO_TEST_CASE( PreloadedIndexMemoryStats )
+{
+    for( int legacy = 0; legacy < 2; ++legacy ) {
+        string name( s_MakeIndex( legacy != 0 ) );
+        CFileDeleteAtExit::Add( name );
+        Int8 size = CFile( name ).GetLength();
+        BOOST_REQUIRE( size > 0 );
+
+        CRef< CDbIndex > index( CDbIndex::Load( name, false, true ) );
+        BOOST_REQUIRE( index != 0 );
+        CDbIndex::SMemoryStats stats( index->GetMemoryStats() );
+        BOOST_CHECK_EQUAL( (Uint8)size, stats.mapped );
+#ifdef NCBI_OS_UNIX
+        BOOST_REQUIRE( stats.resident_known );
+        BOOST_CHECK_EQUAL( stats.mapped, stats.resident );
+#else
+        BOOST_CHECK( !stats.resident_known );
+        BOOST_CHECK_EQUAL( 0U, stats.resident );
+#endif
+    }
+}
+
+// An index read into memory is always fully resident.
+BOOST_AUTO_TEST_CASE( ReadIndexMemoryStats )
+{
+    string name( s_MakeIndex( true ) );
+    CFileDeleteAtExit::Add( name );
+
+    CRef< CDbIndex > index( CDbIndex::Load( name, true ) );
+    BOOST_REQUIRE( index != 0 );
+    CDbIndex::SMemoryStats stats( index->GetMemoryStats() );
+    BOOST_CHECK_EQUAL( (Uint8)CFile( name ).GetLength(), stats.mapped );
+    BOOST_CHECK( stats.resident_known );
+    BOOST_CHECK_EQUAL( stats.mapped, stats.resident );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
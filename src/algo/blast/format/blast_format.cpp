@@ -820,6 +820,30 @@ CBlastFormat::x_PrintTabularReport(const blast::CSearchResults& results,
         }
         return;
     }
+
+    if (m_FormatType == CFormattingArgs::eColumnarTabular) {
+        if (m_ColumnarTabular.Empty()) {
+            m_ColumnarTabular.Reset(new CBlastColumnarTabularInfo(m_Outfile));
+            m_ColumnarTabular->SetParseLocalIds(m_BelieveQuery);
+            if((m_IsBl2Seq && (!m_BelieveQuery))|| m_IsRemoteSearch) {
+                m_ColumnarTabular->SetParseSubjectDefline(true);
+            }
+            if (ncbi::NStr::ToLower(m_Program) == string("blastn"))
+                m_ColumnarTabular->SetNoFetch(true);
+        }
+        if (results.HasAlignments()) {
+            CSeq_align_set copy_aln_set;
+            CBlastFormatUtil::PruneSeqalign(*aln_set, copy_aln_set, m_HitlistSize);
+            m_ColumnarTabular->SetQueryRange(m_QueryRange);
+            m_ColumnarTabular->SetQueryGeneticCode(m_QueryGenCode);
+            m_ColumnarTabular->SetDbGeneticCode(m_DbGenCode);
+            ITERATE(CSeq_align_set::Tdata, itr, copy_aln_set.Get()) {
+                m_ColumnarTabular->SetFields(**itr, *m_Scope, &m_ScoringMatrix);
+                m_ColumnarTabular->Print();
+            }
+        }
+        return;
+    }
 }
 
 static void s_SetCloneInfo(const CIgBlastTabularInfo& tabinfo,
@@ -1428,7 +1452,8 @@ CBlastFormat::PrintOneResultSet(const blast::CSearchResults& results,
 
     if (m_FormatType == CFormattingArgs::eTabular ||
         m_FormatType == CFormattingArgs::eTabularWithComments ||
-        m_FormatType == CFormattingArgs::eCommaSeparatedValues) {
+        m_FormatType == CFormattingArgs::eCommaSeparatedValues ||
+        m_FormatType == CFormattingArgs::eColumnarTabular) {
         x_PrintTabularReport(results, itr_num);
         return;
     }
@@ -1997,7 +2022,8 @@ CBlastFormat::PrintPhiResult(const blast::CSearchResultSet& result_set,
 
     if (m_FormatType == CFormattingArgs::eTabular ||
         m_FormatType == CFormattingArgs::eTabularWithComments ||
-        m_FormatType == CFormattingArgs::eCommaSeparatedValues) {
+        m_FormatType == CFormattingArgs::eCommaSeparatedValues ||
+        m_FormatType == CFormattingArgs::eColumnarTabular) {
         ITERATE(CSearchResultSet, result, result_set) {
            x_PrintTabularReport(**result, itr_num);
         }
@@ -2182,6 +2208,11 @@ CBlastFormat::PrintEpilog(const blast::CBlastOptions& options)
         CBlastTabularInfo tabinfo(m_Outfile, m_CustomOutputFormatSpec);
         tabinfo.PrintNumProcessed(m_QueriesFormatted);
         return;
+    } else if (m_FormatType == CFormattingArgs::eColumnarTabular) {
+        if (m_ColumnarTabular.NotEmpty()) {
+            m_ColumnarTabular->Flush();
+        }
+        return;
     } else if (m_FormatType >= CFormattingArgs::eTabular) 
         return;  // No footer for these.
 
@@ -197,6 +197,53 @@ struct AalookupTestFixture {
                       NULL);
     lookup = (BlastAaLookupTable*) lookup_wrap_ptr->lut;
   }
+
+  // to serialize the lookup table, attach a new table to the image and
+  // check that both tables hold the same data
+  void CheckLookupTableImage(){
+    const Uint8 kKey = LookupTableWrapImageKey(query_blk, lookup_options,
+                                               NULL, lookup_segments, sbp);
+    BOOST_REQUIRE(kKey != 0);
+    const size_t kSize = LookupTableWrapImageSize(lookup_wrap_ptr, query_blk);
+    BOOST_REQUIRE(kSize > 0);
+    void* image = malloc(kSize);
+    BOOST_REQUIRE_EQUAL(0, (int)LookupTableWrapWriteImage(lookup_wrap_ptr,
+                                             query_blk, kKey, image, kSize));
+
+    LookupTableWrap* image_wrap_ptr = NULL;
+    BOOST_REQUIRE(LookupTableWrapAttachImage(image, kSize, kKey + 1,
+                              query_blk, free, image, &image_wrap_ptr) != 0);
+    BOOST_REQUIRE(image_wrap_ptr == NULL);
+    BOOST_REQUIRE_EQUAL(0, (int)LookupTableWrapAttachImage(image, kSize, kKey,
+                              query_blk, free, image, &image_wrap_ptr));
+    BOOST_REQUIRE_EQUAL(eAaLookupTable,
+                        (ELookupTableType)image_wrap_ptr->lut_type);
+
+    BlastAaLookupTable* image_lookup = 
+                             (BlastAaLookupTable*) image_wrap_ptr->lut;
+    const bool kSmallbone = (lookup->bone_type == eSmallbone);
+    BOOST_REQUIRE_EQUAL(lookup->bone_type, image_lookup->bone_type);
+    BOOST_REQUIRE_EQUAL(lookup->threshold, image_lookup->threshold);
+    BOOST_REQUIRE_EQUAL(lookup->word_length, image_lookup->word_length);
+    BOOST_REQUIRE_EQUAL(lookup->backbone_size, image_lookup->backbone_size);
+    BOOST_REQUIRE_EQUAL(lookup->longest_chain, image_lookup->longest_chain);
+    BOOST_REQUIRE_EQUAL(lookup->overflow_size, image_lookup->overflow_size);
+    BOOST_REQUIRE(image_lookup->thin_backbone == NULL);
+    BOOST_REQUIRE_EQUAL(0, memcmp(lookup->thick_backbone, 
+                  image_lookup->thick_backbone, lookup->backbone_size *
+                  (kSmallbone ? sizeof(AaLookupSmallboneCell) :
+                                sizeof(AaLookupBackboneCell))));
+    BOOST_REQUIRE_EQUAL(0, memcmp(lookup->overflow, image_lookup->overflow,
+                  lookup->overflow_size *
+                  (kSmallbone ? sizeof(Uint2) : sizeof(Int4))));
+    BOOST_REQUIRE_EQUAL(0, memcmp(lookup->pv, image_lookup->pv,
+                  ((lookup->backbone_size >> PV_ARRAY_BTS) + 1) *
+                  sizeof(PV_ARRAY_TYPE)));
+
+    // the image is released with the table attached to it
+    image_wrap_ptr = LookupTableWrapFree(image_wrap_ptr);
+    BOOST_REQUIRE(image_wrap_ptr == NULL);
+  }
 };
 
 BOOST_FIXTURE_TEST_SUITE(aalookup, AalookupTestFixture)
@@ -291,6 +338,23 @@ BOOST_AUTO_TEST_CASE(BackboneSequenceTest) {
   BOOST_REQUIRE_EQUAL(offset, len-3);
 }
 
+BOOST_AUTO_TEST_CASE(SmallboneImageTest) {
+  // a smallbone table with neighboring words
+  GetSeqBlk("gi|129295");
+  FillLookupTable(true);
+  BOOST_REQUIRE_EQUAL( lookup->bone_type, eSmallbone );
+  BOOST_REQUIRE( lookup->neighbor_matches > 0 );
+  CheckLookupTableImage();
+}
+
+BOOST_AUTO_TEST_CASE(BackboneImageTest) {
+  // a table too large for the smallbone
+  GetSeqBlk(65534);
+  FillLookupTable();
+  BOOST_REQUIRE_EQUAL( lookup->bone_type, eBackbone );
+  CheckLookupTableImage();
+}
+
 BOOST_AUTO_TEST_CASE(SmallboneSequenceTest) {
   // create a trivial sequence
   Int4 len = 65533;
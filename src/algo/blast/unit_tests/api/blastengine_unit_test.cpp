@@ -34,6 +34,9 @@
 #include <corelib/test_boost.hpp>
 
 #include <corelib/ncbitime.hpp>
+#include <corelib/ncbifile.hpp>
+#include <corelib/ncbiapp.hpp>
+#include <corelib/random.hpp>
 #include <objmgr/object_manager.hpp>
 #include <objmgr/scope.hpp>
 #include <objtools/data_loaders/genbank/gbloader.hpp>
@@ -41,6 +44,10 @@
 
 #include <objects/seqloc/Seq_loc.hpp>
 #include <objects/seqloc/Seq_interval.hpp>
+#include <objects/seq/Bioseq.hpp>
+#include <objects/seq/Seq_inst.hpp>
+#include <objects/seq/Seq_data.hpp>
+#include <objects/seq/IUPACna.hpp>
 #include <objects/seqalign/Seq_align.hpp>
 #include <objects/seqalign/Seq_align_set.hpp>
 #include <objects/seqalign/Std_seg.hpp>
@@ -57,6 +64,7 @@
 #include <algo/blast/api/local_blast.hpp>
 #include <algo/blast/api/objmgr_query_data.hpp>
 #include <algo/blast/api/prelim_stage.hpp>
+#include <objtools/blast/seqdb_writer/writedb.hpp>
 #include <blast_objmgr_priv.hpp>
 
 #include <algo/blast/core/blast_options.h>
@@ -484,6 +492,432 @@ BOOST_AUTO_TEST_CASE(testBlastpPrelimSearch)
     }
 }
 
+// Verifies that the work distribution counts reported by the preliminary
+// search threads cover the whole database exactly once
+BOOST_AUTO_TEST_CASE(testBlastpPrelimSearchThreadStats) 
+{
+    const string kDbName("data/seqp");
+    const TGi kQueryGi = GI_CONST(21282798);
+    const size_t kNumThreads = 2;
+
+    CRef<CSeq_loc> query_loc(new CSeq_loc());
+    query_loc->SetWhole().SetGi(kQueryGi);
+    CScope* query_scope = new CScope(CTestObjMgr::Instance().GetObjMgr());
+    query_scope->AddDefaults();
+    m_vQuery.push_back(SSeqLoc(query_loc, query_scope));
+    BlastSeqSrc* seq_src = SeqDbBlastSeqSrcInit(kDbName, true, 0, 0);
+    const Int8 kNumSeqs = BlastSeqSrcGetNumSeqs(seq_src);
+    const Int8 kTotLen = BlastSeqSrcGetTotLen(seq_src);
+
+    CRef<CBlastOptionsHandle> opts_handle(
+        CBlastOptionsFactory::Create(eBlastp));
+    CRef<CBlastOptions> options(&opts_handle->SetOptions());
+
+    CRef<IQueryFactory> query_factory(new CObjMgr_QueryFactory(m_vQuery));
+    CBlastPrelimSearch prelim_search(query_factory, options, seq_src);
+    prelim_search.SetNumberOfThreads(kNumThreads);
+    CRef<SInternalData> id(prelim_search.Run());
+
+    BlastSeqSrcFree(seq_src);
+
+    const BlastThreadStats* thread_stat = 
+        id->m_Diagnostics->GetPointer()->thread_stat;
+    BOOST_REQUIRE(thread_stat);
+    BOOST_REQUIRE_EQUAL((int)kNumThreads, thread_stat->num_threads);
+    BOOST_REQUIRE_EQUAL(kNumSeqs, thread_stat->num_subjects);
+    BOOST_REQUIRE_EQUAL(kTotLen, thread_stat->num_residues);
+    BOOST_REQUIRE(thread_stat->busy_time >= 0.0);
+    BOOST_REQUIRE(thread_stat->idle_time >= 0.0);
+
+    // The per-thread entries add up to the totals, and the slowest thread
+    // never waits
+    BOOST_REQUIRE(thread_stat->loads);
+    Int8 num_subjects = 0, num_residues = 0, max_residues = 0;
+    double busy_time = 0.0, idle_time = 0.0, min_idle_time = -1.0;
+    for (int i = 0; i < thread_stat->num_threads; i++) {
+        const BlastThreadLoad& load = thread_stat->loads[i];
+        num_subjects += load.num_subjects;
+        num_residues += load.num_residues;
+        max_residues = max(max_residues, load.num_residues);
+        busy_time += load.busy_time;
+        idle_time += load.idle_time;
+        if (min_idle_time < 0.0 || load.idle_time < min_idle_time)
+            min_idle_time = load.idle_time;
+    }
+    BOOST_REQUIRE_EQUAL(kNumSeqs, num_subjects);
+    BOOST_REQUIRE_EQUAL(kTotLen, num_residues);
+    BOOST_REQUIRE_EQUAL(thread_stat->max_thread_residues, max_residues);
+    BOOST_REQUIRE(fabs(thread_stat->busy_time - busy_time) < 1e-9);
+    BOOST_REQUIRE(fabs(thread_stat->idle_time - idle_time) < 1e-9);
+    BOOST_REQUIRE_EQUAL(0.0, min_idle_time);
+
+    // Copies of the diagnostics carry their own per-thread entries
+    BlastDiagnostics* copy =
+        Blast_DiagnosticsCopy(id->m_Diagnostics->GetPointer());
+    BOOST_REQUIRE(copy->thread_stat->loads != thread_stat->loads);
+    BOOST_REQUIRE_EQUAL(thread_stat->num_threads,
+                        copy->thread_stat->num_threads);
+    BOOST_REQUIRE_EQUAL(thread_stat->loads[0].num_residues,
+                        copy->thread_stat->loads[0].num_residues);
+    Blast_DiagnosticsFree(copy);
+}
+
+/// Builds a random nucleotide sequence with a local id
+static CRef<CBioseq>
+s_MakeRandomNucleotide(const string& id, TSeqPos length, CRandom& rng)
+{
+    static const char kBases[] = "ACGT";
+    string data(length, 'A');
+    for (TSeqPos i = 0; i < length; i++) {
+        data[i] = kBases[rng.GetRand(0, 3)];
+    }
+
+    CRef<CBioseq> bioseq(new CBioseq);
+    CRef<CSeq_id> seq_id(new CSeq_id);
+    seq_id->SetLocal().SetStr(id);
+    bioseq->SetId().push_back(seq_id);
+    CSeq_inst& inst = bioseq->SetInst();
+    inst.SetRepr(CSeq_inst::eRepr_raw);
+    inst.SetMol(CSeq_inst::eMol_dna);
+    inst.SetLength(length);
+    inst.SetSeq_data().SetIupacna().Set().swap(data);
+    return bioseq;
+}
+
+// Searches a database made of one subject much longer than a chunk and many
+// short ones. The chunks of the long subject are shared between the
+// preliminary search threads, and the alignments must stay those of a
+// single-thread search.
+BOOST_AUTO_TEST_CASE(testBlastnPrelimSearchSkewedDbLoad) 
+{
+    const string kDbName("blastengine_skewed_db");
+    const TSeqPos kLongLength = 6 * MAX_DBSEQ_LEN;
+    const TSeqPos kShortLength = 50000;
+    const int kNumShort = 40;
+    const TSeqPos kQueryFrom = MAX_DBSEQ_LEN - 1000;
+    const TSeqPos kQueryLength = 2000;
+    const size_t kNumThreads = 4;
+
+    CRandom rng(1);
+    CRef<CBioseq> long_subject = s_MakeRandomNucleotide("long", kLongLength, rng);
+    vector<string> files;
+    {
+        CWriteDB db(kDbName, CWriteDB::eNucleotide, "skewed",
+                    CWriteDB::eNoIndex, false);
+        db.AddSequence(*long_subject);
+        for (int i = 0; i < kNumShort; i++) {
+            db.AddSequence(*s_MakeRandomNucleotide
+                           ("short" + NStr::IntToString(i), kShortLength, rng));
+        }
+        db.Close();
+        db.ListFiles(files);
+    }
+
+    // The query crosses the boundary between the first two chunks of the
+    // long subject, so the HSPs of two chunks need merging
+    CRef<CBioseq> query(s_MakeRandomNucleotide("query", kQueryLength, rng));
+    query->SetInst().SetSeq_data().SetIupacna().Set() =
+        long_subject->GetInst().GetSeq_data().GetIupacna().Get()
+        .substr(kQueryFrom, kQueryLength);
+    long_subject.Reset();
+    CScope* query_scope = new CScope(CTestObjMgr::Instance().GetObjMgr());
+    query_scope->AddBioseq(*query);
+    CRef<CSeq_loc> query_loc(new CSeq_loc());
+    query_loc->SetWhole().Assign(*query->GetId().front());
+    m_vQuery.push_back(SSeqLoc(query_loc, query_scope));
+
+    CRef<CBlastOptionsHandle> opts_handle(
+        CBlastOptionsFactory::Create(eMegablast));
+    CRef<CBlastOptions> options(&opts_handle->SetOptions());
+
+    BlastSeqSrc* seq_src = SeqDbBlastSeqSrcInit(kDbName, false, 0, 0);
+    const Int8 kTotLen = BlastSeqSrcGetTotLen(seq_src);
+    BOOST_REQUIRE_EQUAL((Int8)kLongLength + kNumShort * kShortLength, kTotLen);
+
+    CRef<IQueryFactory> query_factory(new CObjMgr_QueryFactory(m_vQuery));
+    CBlastPrelimSearch prelim_search(query_factory, options, seq_src);
+    prelim_search.SetNumberOfThreads(kNumThreads);
+    CRef<SInternalData> id(prelim_search.Run());
+    BlastSeqSrcFree(seq_src);
+
+    // The residues searched by each thread add up to the database. How
+    // evenly they are spread depends on the scheduling of the host, so the
+    // load is only reported.
+    const BlastThreadStats* thread_stat = 
+        id->m_Diagnostics->GetPointer()->thread_stat;
+    BOOST_REQUIRE(thread_stat);
+    BOOST_REQUIRE_EQUAL((int)kNumThreads, thread_stat->num_threads);
+    BOOST_REQUIRE_EQUAL(kNumShort + 1, thread_stat->num_subjects);
+    BOOST_REQUIRE_EQUAL(kTotLen, thread_stat->num_residues);
+    Int8 num_residues = 0;
+    for (int i = 0; i < thread_stat->num_threads; i++) {
+        BOOST_REQUIRE(thread_stat->loads[i].num_residues >= 0);
+        num_residues += thread_stat->loads[i].num_residues;
+        BOOST_TEST_MESSAGE("thread " << i << ": "
+                           << thread_stat->loads[i].num_residues
+                           << " residues");
+    }
+    BOOST_REQUIRE_EQUAL(kTotLen, num_residues);
+    BOOST_TEST_MESSAGE("longest subject: " << kLongLength
+                       << ", busiest thread: "
+                       << thread_stat->max_thread_residues);
+
+    // Splitting the long subject between threads does not change the results
+    CSearchDatabase dbinfo(kDbName, CSearchDatabase::eBlastDbIsNucleotide);
+    query_factory.Reset(new CObjMgr_QueryFactory(m_vQuery));
+    CLocalBlast st_blaster(query_factory, opts_handle, dbinfo);
+    CRef<CSearchResultSet> st_results = st_blaster.Run();
+
+    query_factory.Reset(new CObjMgr_QueryFactory(m_vQuery));
+    CLocalBlast mt_blaster(query_factory, opts_handle, dbinfo);
+    mt_blaster.SetNumberOfThreads(kNumThreads);
+    CRef<CSearchResultSet> mt_results = mt_blaster.Run();
+
+    BOOST_REQUIRE_EQUAL(st_results->size(), mt_results->size());
+    const CSeq_align_set& st_aligns = *(*st_results)[0].GetSeqAlign();
+    const CSeq_align_set& mt_aligns = *(*mt_results)[0].GetSeqAlign();
+    BOOST_REQUIRE( !st_aligns.Get().empty() );
+    BOOST_REQUIRE(mt_aligns.Equals(st_aligns));
+
+    ITERATE(vector<string>, file, files) {
+        CFile(*file).Remove();
+    }
+}
+
+/// Collects the results handed over by a streaming search
+class CTestResultsSink : public ISearchResultsSink
+{
+public:
+    CTestResultsSink() : m_NumFinished(0) {}
+    virtual void Put(CRef<CSearchResults> results) {
+        BOOST_REQUIRE_EQUAL(0, m_NumFinished);
+        m_Results.push_back(results);
+    }
+    virtual void Finish() {
+        m_NumFinished++;
+    }
+    vector< CRef<CSearchResults> > m_Results;
+    int m_NumFinished;
+};
+
+// Verifies that streaming the results of a search query by query produces
+// the same results, in the same order, as materializing the whole batch.
+// Without composition based statistics the traceback runs subject by subject
+// and emits each query after its last subject, which is checked with one and
+// several threads; the first query is repeated so that queries share subjects.
+BOOST_AUTO_TEST_CASE(testBlastpStreamedResults) 
+{
+    const string kDbName("data/seqp");
+    const TGi kQueryGis[] = { GI_CONST(21282798), GI_CONST(129295),
+                              GI_CONST(21282798) };
+
+    for (size_t i = 0; i < sizeof(kQueryGis)/sizeof(*kQueryGis); i++) {
+        CRef<CSeq_loc> query_loc(new CSeq_loc());
+        query_loc->SetWhole().SetGi(kQueryGis[i]);
+        CScope* query_scope = new CScope(CTestObjMgr::Instance().GetObjMgr());
+        query_scope->AddDefaults();
+        m_vQuery.push_back(SSeqLoc(query_loc, query_scope));
+    }
+    CSearchDatabase dbinfo(kDbName, CSearchDatabase::eBlastDbIsProtein);
+
+    for (int cbs = 0; cbs < 2; cbs++) {
+        for (size_t num_threads = 1; num_threads <= 4; num_threads += 3) {
+            CRef<CBlastOptionsHandle> opts_handle(
+                CBlastOptionsFactory::Create(eBlastp));
+            if ( !cbs ) {
+                opts_handle->SetOptions().SetCompositionBasedStats
+                    (eNoCompositionBasedStats);
+            }
+
+            CRef<IQueryFactory> query_factory(new CObjMgr_QueryFactory(m_vQuery));
+            CLocalBlast batch_blaster(query_factory, opts_handle, dbinfo);
+            CRef<CSearchResultSet> batch_results = batch_blaster.Run();
+
+            query_factory.Reset(new CObjMgr_QueryFactory(m_vQuery));
+            CLocalBlast stream_blaster(query_factory, opts_handle, dbinfo);
+            stream_blaster.SetNumberOfThreads(num_threads);
+            CTestResultsSink sink;
+            stream_blaster.Run(sink);
+
+            BOOST_REQUIRE_EQUAL(1, sink.m_NumFinished);
+            BOOST_REQUIRE_EQUAL(batch_results->size(), sink.m_Results.size());
+            for (size_t i = 0; i < sink.m_Results.size(); i++) {
+                const CSearchResults& expected = (*batch_results)[i];
+                const CSearchResults& actual = *sink.m_Results[i];
+                BOOST_REQUIRE(expected.GetSeqId()->Match(*actual.GetSeqId()));
+                BOOST_REQUIRE(actual.HasAlignments());
+                BOOST_REQUIRE(actual.GetSeqAlign()->Equals(*expected.GetSeqAlign()));
+                BOOST_REQUIRE_EQUAL(expected.GetAncillaryData()->GetSearchSpace(),
+                                    actual.GetAncillaryData()->GetSearchSpace());
+            }
+        }
+    }
+}
+
+// Verifies that the multi-threaded traceback produces the same alignments,
+// in the same order, as the single-threaded one
+BOOST_AUTO_TEST_CASE(testBlastnMultiThreadedTraceback) 
+{
+    const string kDbName("data/seqn");
+    const TGi kQueryGi = GI_CONST(14702146); 
+    const size_t kNumThreads = 4;
+
+    CRef<CSeq_loc> query_loc(new CSeq_loc());
+    query_loc->SetWhole().SetGi(kQueryGi);
+    CScope* query_scope = new CScope(CTestObjMgr::Instance().GetObjMgr());
+    query_scope->AddDefaults();
+    m_vQuery.push_back(SSeqLoc(query_loc, query_scope));
+    CSearchDatabase dbinfo(kDbName, CSearchDatabase::eBlastDbIsNucleotide);
+    CRef<CBlastOptionsHandle> opts_handle(
+        CBlastOptionsFactory::Create(eDiscMegablast));
+
+    CRef<IQueryFactory> query_factory(new CObjMgr_QueryFactory(m_vQuery));
+    CLocalBlast st_blaster(query_factory, opts_handle, dbinfo);
+    CRef<CSearchResultSet> st_results = st_blaster.Run();
+
+    query_factory.Reset(new CObjMgr_QueryFactory(m_vQuery));
+    CLocalBlast mt_blaster(query_factory, opts_handle, dbinfo);
+    mt_blaster.SetNumberOfThreads(kNumThreads);
+    CRef<CSearchResultSet> mt_results = mt_blaster.Run();
+
+    BOOST_REQUIRE_EQUAL(st_results->size(), mt_results->size());
+    const CSeq_align_set& st_aligns = *(*st_results)[0].GetSeqAlign();
+    const CSeq_align_set& mt_aligns = *(*mt_results)[0].GetSeqAlign();
+    BOOST_REQUIRE( !st_aligns.Get().empty() );
+    BOOST_REQUIRE(mt_aligns.Equals(st_aligns));
+}
+
+/// Runs a search of one query against a BLAST database
+static CRef<CSearchResultSet>
+s_RunCacheTestSearch(TSeqLocVector& queries, EProgram program,
+                     const CSearchDatabase& dbinfo)
+{
+    CRef<CBlastOptionsHandle> opts_handle(CBlastOptionsFactory::Create(program));
+    CRef<IQueryFactory> query_factory(new CObjMgr_QueryFactory(queries));
+    CLocalBlast blaster(query_factory, opts_handle, dbinfo);
+    return blaster.Run();
+}
+
+/// Lists the lookup table images in a cache directory
+static vector<string> s_GetLookupTableImages(const CDir& dir)
+{
+    vector<string> retval;
+    CDir::TEntries entries(dir.GetEntries("blast_lut_*",
+                                          CDir::fIgnoreRecursive));
+    ITERATE(CDir::TEntries, entry, entries) {
+        retval.push_back((*entry)->GetPath());
+    }
+    sort(retval.begin(), retval.end());
+    return retval;
+}
+
+// Verifies that searches whose lookup table is saved to, or mapped from, the
+// BLAST_LOOKUP_TABLE_CACHE directory find the same alignments as a search
+// building its own table, for blastp, blastn and megablast lookup tables
+BOOST_AUTO_TEST_CASE(testLookupTableCacheSearch) 
+{
+    const struct {
+        EProgram program;
+        const char* db;
+        CSearchDatabase::EMoleculeType mol_type;
+        TGi query_gi;
+    } kSearches[] = {
+        { eBlastp, "data/seqp", CSearchDatabase::eBlastDbIsProtein,
+          GI_CONST(129295) },
+        { eBlastn, "data/seqn", CSearchDatabase::eBlastDbIsNucleotide,
+          GI_CONST(14702146) },
+        { eMegablast, "data/seqn", CSearchDatabase::eBlastDbIsNucleotide,
+          GI_CONST(14702146) }
+    };
+    CNcbiEnvironment& env = CNcbiApplication::Instance()->SetEnvironment();
+    const CTime kOldTime(2000, 1, 1);
+
+    for (size_t i = 0; i < sizeof(kSearches)/sizeof(*kSearches); i++) {
+        m_vQuery.clear();
+        CRef<CSeq_loc> query_loc(new CSeq_loc());
+        query_loc->SetWhole().SetGi(kSearches[i].query_gi);
+        CScope* query_scope = new CScope(CTestObjMgr::Instance().GetObjMgr());
+        query_scope->AddDefaults();
+        m_vQuery.push_back(SSeqLoc(query_loc, query_scope));
+        CSearchDatabase dbinfo(kSearches[i].db, kSearches[i].mol_type);
+
+        env.Unset("BLAST_LOOKUP_TABLE_CACHE");
+        CRef<CSearchResultSet> fresh_results =
+            s_RunCacheTestSearch(m_vQuery, kSearches[i].program, dbinfo);
+        const CSeq_align_set& fresh_aligns = *(*fresh_results)[0].GetSeqAlign();
+        BOOST_REQUIRE( !fresh_aligns.Get().empty() );
+
+        CDir cache_dir(CDirEntry::GetTmpName());
+        BOOST_REQUIRE(cache_dir.Create());
+        env.Set("BLAST_LOOKUP_TABLE_CACHE", cache_dir.GetPath());
+
+        // the first search saves its lookup table...
+        CRef<CSearchResultSet> saved_results =
+            s_RunCacheTestSearch(m_vQuery, kSearches[i].program, dbinfo);
+        vector<string> images = s_GetLookupTableImages(cache_dir);
+        BOOST_REQUIRE_EQUAL(1U, images.size());
+        BOOST_REQUIRE((*saved_results)[0].GetSeqAlign()->Equals(fresh_aligns));
+
+        // ...and the second one maps it, which marks the image as used
+        BOOST_REQUIRE(CFile(images[0]).SetTime(&kOldTime));
+        CRef<CSearchResultSet> mapped_results =
+            s_RunCacheTestSearch(m_vQuery, kSearches[i].program, dbinfo);
+        BOOST_REQUIRE(images == s_GetLookupTableImages(cache_dir));
+        CTime mtime;
+        BOOST_REQUIRE(CFile(images[0]).GetTime(&mtime));
+        BOOST_REQUIRE(mtime > kOldTime);
+        BOOST_REQUIRE((*mapped_results)[0].GetSeqAlign()->Equals(fresh_aligns));
+
+        env.Unset("BLAST_LOOKUP_TABLE_CACHE");
+        cache_dir.Remove();
+    }
+}
+
+// Verifies that the least recently used images are removed from the lookup
+// table cache when a new image would exceed BLAST_LOOKUP_TABLE_CACHE_MB
+BOOST_AUTO_TEST_CASE(testLookupTableCacheSizeLimit) 
+{
+    CRef<CSeq_loc> query_loc(new CSeq_loc());
+    query_loc->SetWhole().SetGi(GI_CONST(129295));
+    CScope* query_scope = new CScope(CTestObjMgr::Instance().GetObjMgr());
+    query_scope->AddDefaults();
+    m_vQuery.push_back(SSeqLoc(query_loc, query_scope));
+    CSearchDatabase dbinfo("data/seqp", CSearchDatabase::eBlastDbIsProtein);
+
+    CDir cache_dir(CDirEntry::GetTmpName());
+    BOOST_REQUIRE(cache_dir.Create());
+
+    // two stale 1MB images, the first one used less recently
+    const string kImages[] = {
+        CDirEntry::MakePath(cache_dir.GetPath(), "blast_lut_1"),
+        CDirEntry::MakePath(cache_dir.GetPath(), "blast_lut_2")
+    };
+    for (int i = 0; i < 2; i++) {
+        {
+            CNcbiOfstream out(kImages[i].c_str(), 
+                              IOS_BASE::out | IOS_BASE::binary);
+            const string kData(1024 * 1024, 'x');
+            out.write(kData.data(), kData.size());
+        }
+        const CTime kTime(2000 + i, 1, 1);
+        BOOST_REQUIRE(CFile(kImages[i]).SetTime(&kTime));
+    }
+
+    CNcbiEnvironment& env = CNcbiApplication::Instance()->SetEnvironment();
+    env.Set("BLAST_LOOKUP_TABLE_CACHE", cache_dir.GetPath());
+    env.Set("BLAST_LOOKUP_TABLE_CACHE_MB", "2");
+    s_RunCacheTestSearch(m_vQuery, eBlastp, dbinfo);
+    env.Unset("BLAST_LOOKUP_TABLE_CACHE");
+    env.Unset("BLAST_LOOKUP_TABLE_CACHE_MB");
+
+    // the new image (well under 1MB) only needs room made by the oldest one
+    const vector<string> kCached = s_GetLookupTableImages(cache_dir);
+    BOOST_REQUIRE_EQUAL(2U, kCached.size());
+    BOOST_REQUIRE( !CFile(kImages[0]).Exists() );
+    BOOST_REQUIRE( CFile(kImages[1]).Exists() );
+    cache_dir.Remove();
+}
+
 BOOST_AUTO_TEST_CASE(testGappedOffsets)
 {
     const unsigned char query[] = {'\016', '\007', '\014', '\024', '\004', '\015', '\011', 
@@ -58,6 +58,12 @@
 #include "dust_filter.hpp"
 #include <objects/seqloc/Seq_interval.hpp>
 #include <objects/seqloc/Packed_seqint.hpp>
+#include <objects/seq/Seq_inst.hpp>
+#include <objects/seq/Seq_data.hpp>
+#include <objects/seq/IUPACna.hpp>
+#include <objects/seq/seqport_util.hpp>
+#include <objmgr/seq_vector.hpp>
+#include <algo/dustmask/symdust.hpp>
 
 #include "test_objmgr.hpp"
 #include "blast_test_util.hpp"
@@ -2184,6 +2190,181 @@ BOOST_AUTO_TEST_CASE(TestBlastSeqLocListReverse)
     BOOST_REQUIRE(mask == NULL);
 }
 
+/// Random nucleotide sequence in IUPACNA with low complexity stretches
+/// and, if with_n is true, runs of N
+static string
+s_RandomDustTestSequence(CRandom& rng, bool with_n)
+{
+    static const char* const kRepeats[] = { "A", "CA", "TTG", "GATC" };
+    static const char kBases[] = "ACGT";
+    string retval;
+    const TSeqPos kLength = 200 + rng.GetRand(0, 3000);
+    while (retval.size() < kLength) {
+        const int kWhat = rng.GetRand(0, 9);
+        if (kWhat < 2) {
+            const string kUnit(kRepeats[rng.GetRand(0, 3)]);
+            for (int i = rng.GetRand(5, 40); i > 0; i--) {
+                retval += kUnit;
+            }
+        } else if (kWhat == 2 && with_n) {
+            retval.append(rng.GetRand(1, 30), 'N');
+        } else {
+            for (int i = rng.GetRand(20, 200); i > 0; i--) {
+                retval += kBases[rng.GetRand(0, 3)];
+            }
+        }
+    }
+    return retval;
+}
+
+/// Add a sequence to the scope, stored in the given encoding
+static CBioseq_Handle
+s_AddDustTestSequence(CScope& scope, const string& iupacna,
+                      CSeq_data::E_Choice coding, int index)
+{
+    CRef<CBioseq> bioseq(new CBioseq);
+    CRef<CSeq_id> id(new CSeq_id(CSeq_id::e_Local,
+                                 "dust" + NStr::IntToString(index)));
+    bioseq->SetId().push_back(id);
+    CSeq_inst& inst = bioseq->SetInst();
+    inst.SetRepr(CSeq_inst::eRepr_raw);
+    inst.SetMol(CSeq_inst::eMol_dna);
+    inst.SetLength((TSeqPos)iupacna.size());
+    CSeq_data iupac_data(iupacna, CSeq_data::e_Iupacna);
+    if (coding == CSeq_data::e_Iupacna) {
+        inst.SetSeq_data().Assign(iupac_data);
+    } else {
+        CSeqportUtil::Convert(iupac_data, &inst.SetSeq_data(), coding);
+    }
+    return scope.AddBioseq(*bioseq);
+}
+
+// Masking a contiguous buffer, alone or in a threaded batch, must give the
+// intervals found by masking the same sequence through a CSeqVector,
+// whichever encoding the sequence is stored in
+BOOST_AUTO_TEST_CASE(SymDustMaskerBuffersMatchSeqVector)
+{
+    typedef CSymDustMasker::TMaskList TMaskList;
+    typedef CSymDustMasker::SSeqBuffer TSeqBuffer;
+    const int kNumSeqs = 16;
+    const CSeq_data::E_Choice kCodings[] = {
+        CSeq_data::e_Iupacna, CSeq_data::e_Ncbi4na, CSeq_data::e_Ncbi2na
+    };
+    const unsigned int kNumThreads[] = { 1, 2, 3, 8 };
+
+    CRandom rng(5);
+    CScope scope(*CObjectManager::GetInstance());
+    vector<string> iupac(kNumSeqs);
+    vector<string> ncbi2na(kNumSeqs);
+    vector<TMaskList> expected(kNumSeqs);
+    size_t num_masked = 0;
+
+    for (int i = 0; i < kNumSeqs; i++) {
+        // NCBI2NA cannot store ambiguities
+        const bool kWithN = (i % 2) == 1;
+        iupac[i] = s_RandomDustTestSequence(rng, kWithN);
+
+        for (size_t c = 0; c < sizeof(kCodings) / sizeof(kCodings[0]); c++) {
+            if (kWithN && kCodings[c] == CSeq_data::e_Ncbi2na) {
+                continue;
+            }
+            CBioseq_Handle bh = s_AddDustTestSequence(scope, iupac[i],
+                                    kCodings[c], i * 10 + (int)c);
+            CSeqVector seq_vector =
+                bh.GetSeqVector(CBioseq_Handle::eCoding_Iupac);
+            CSymDustMasker masker;
+            auto_ptr<TMaskList> res(masker(seq_vector));
+            if (c == 0) {
+                expected[i] = *res;
+                num_masked += res->size();
+            } else {
+                BOOST_REQUIRE(expected[i] == *res);
+            }
+        }
+
+        // the same sequence in a buffer, in both buffer encodings
+        TSeqBuffer iupac_buf = { iupac[i].data(), (TSeqPos)iupac[i].size(),
+                                 CSymDustMasker::eIupacna };
+        CSymDustMasker iupac_masker;
+        BOOST_REQUIRE(expected[i] == *iupac_masker(iupac_buf));
+        if (!kWithN) {
+            ncbi2na[i].resize(iupac[i].size());
+            for (size_t k = 0; k < iupac[i].size(); k++) {
+                ncbi2na[i][k] = (char)(strchr("ACGT", iupac[i][k]) - "ACGT");
+            }
+            TSeqBuffer ncbi2na_buf = { ncbi2na[i].data(),
+                                       (TSeqPos)ncbi2na[i].size(),
+                                       CSymDustMasker::eNcbi2na };
+            CSymDustMasker ncbi2na_masker;
+            BOOST_REQUIRE(expected[i] == *ncbi2na_masker(ncbi2na_buf));
+        }
+    }
+    BOOST_REQUIRE(num_masked > 0);
+
+    // batches masked with different numbers of threads
+    vector<TSeqBuffer> batch;
+    vector<int> batch_index;
+    for (int i = 0; i < kNumSeqs; i++) {
+        TSeqBuffer buf = { iupac[i].data(), (TSeqPos)iupac[i].size(),
+                           CSymDustMasker::eIupacna };
+        batch.push_back(buf);
+        batch_index.push_back(i);
+        if (!ncbi2na[i].empty()) {
+            TSeqBuffer buf2na = { ncbi2na[i].data(),
+                                  (TSeqPos)ncbi2na[i].size(),
+                                  CSymDustMasker::eNcbi2na };
+            batch.push_back(buf2na);
+            batch_index.push_back(i);
+        }
+    }
+    for (size_t t = 0; t < sizeof(kNumThreads) / sizeof(kNumThreads[0]); t++) {
+        CSymDustMasker masker;
+        vector<TMaskList> res;
+        masker.MaskBuffers(batch, res, kNumThreads[t]);
+        BOOST_REQUIRE_EQUAL(batch.size(), res.size());
+        for (size_t k = 0; k < batch.size(); k++) {
+            BOOST_REQUIRE(expected[batch_index[k]] == res[k]);
+        }
+    }
+}
+
+// A CSeqVector is read a chunk at a time; masking a sequence spanning
+// several chunks, whole or in part, must give the intervals found in the
+// same sequence held in one buffer
+BOOST_AUTO_TEST_CASE(SymDustMaskerLongSeqVectorMatchesBuffer)
+{
+    typedef CSymDustMasker::TMaskList TMaskList;
+    typedef CSymDustMasker::SSeqBuffer TSeqBuffer;
+    const size_t kMinLength = 2600000;
+
+    CRandom rng(11);
+    CScope scope(*CObjectManager::GetInstance());
+
+    for (int i = 0; i < 2; i++) {
+        const bool kWithN = (i == 1);
+        string iupac;
+        while (iupac.size() < kMinLength) {
+            iupac += s_RandomDustTestSequence(rng, kWithN);
+        }
+        CBioseq_Handle bh = s_AddDustTestSequence(scope, iupac,
+                                CSeq_data::e_Ncbi4na, 1000 + i);
+        CSeqVector seq_vector = bh.GetSeqVector(CBioseq_Handle::eCoding_Iupac);
+        TSeqBuffer buf = { iupac.data(), (TSeqPos)iupac.size(),
+                           CSymDustMasker::eIupacna };
+
+        CSymDustMasker masker, buf_masker;
+        auto_ptr<TMaskList> res(masker(seq_vector));
+        BOOST_REQUIRE( !res->empty() );
+        BOOST_REQUIRE(*buf_masker(buf) == *res);
+
+        const TSeqPos kStart = 12345;
+        const TSeqPos kStop = (TSeqPos)iupac.size() - 6789;
+        CSymDustMasker part_masker, buf_part_masker;
+        BOOST_REQUIRE(*buf_part_masker(buf, kStart, kStop) ==
+                      *part_masker(seq_vector, kStart, kStop));
+    }
+}
+
 BOOST_AUTO_TEST_CASE(TestGetTaxIdWithWindowMaskerSupport) 
 {
     set<int> taxids;
@@ -835,6 +835,158 @@ BOOST_AUTO_TEST_CASE(testMegablastTableSmallUnmaskedRegion) {
 }
 
 
+/// Counts the lookup table images released by LookupTableWrapFree
+static int s_NumImagesReleased = 0;
+
+/// Release callback for testMegablastLookupTableImage
+static void s_ReleaseTestImage(void* handle)
+{
+    ++s_NumImagesReleased;
+    free(handle);
+}
+
+// Test that a megablast lookup table survives being serialized and attached
+// again, and that images for a different key or query are rejected
+BOOST_AUTO_TEST_CASE(testMegablastLookupTableImage) {
+
+	const int alphabet_size=4;
+	const int word_size=12;
+
+	debruijnInit(word_size, alphabet_size);
+
+	LookupTableOptions* lookup_options;
+	LookupTableOptionsNew(eBlastTypeBlastn, &lookup_options);
+	BLAST_FillLookupTableOptions(lookup_options, eBlastTypeBlastn, 
+                                     TRUE, 0, 0);
+
+    QuerySetUpOptions* query_options = NULL;
+    BlastQuerySetUpOptionsNew(&query_options);
+	LookupTableWrap* lookup_wrap_ptr;
+ 	BOOST_REQUIRE_EQUAL((int)LookupTableWrapInit(query_blk, 
+                              lookup_options, query_options, lookup_segments, 
+                              0, &lookup_wrap_ptr, NULL, NULL, NULL), 0);
+
+    const Uint8 kKey = LookupTableWrapImageKey(query_blk, lookup_options,
+                                               query_options, lookup_segments,
+                                               NULL);
+    BOOST_REQUIRE(kKey != 0);
+    const size_t kSize = LookupTableWrapImageSize(lookup_wrap_ptr, query_blk);
+    BOOST_REQUIRE(kSize > 0);
+    void* image = malloc(kSize);
+    BOOST_REQUIRE_EQUAL(0, (int)LookupTableWrapWriteImage(lookup_wrap_ptr,
+                                             query_blk, kKey, image, kSize));
+
+    LookupTableWrap* image_wrap_ptr = NULL;
+    BOOST_REQUIRE(LookupTableWrapAttachImage(image, kSize, kKey + 1,
+                              query_blk, s_ReleaseTestImage, image,
+                              &image_wrap_ptr) != 0);
+    BOOST_REQUIRE(LookupTableWrapAttachImage(image, kSize - 8, kKey,
+                              query_blk, s_ReleaseTestImage, image,
+                              &image_wrap_ptr) != 0);
+    BOOST_REQUIRE(image_wrap_ptr == NULL);
+    BOOST_REQUIRE_EQUAL(0, (int)LookupTableWrapAttachImage(image, kSize, kKey,
+                              query_blk, s_ReleaseTestImage, image,
+                              &image_wrap_ptr));
+    BOOST_REQUIRE_EQUAL(eMBLookupTable,
+                        (ELookupTableType)image_wrap_ptr->lut_type);
+
+	BlastMBLookupTable* lookup = (BlastMBLookupTable*) lookup_wrap_ptr->lut;
+	BlastMBLookupTable* image_lookup = 
+                               (BlastMBLookupTable*) image_wrap_ptr->lut;
+	BOOST_REQUIRE_EQUAL(lookup->hashsize, image_lookup->hashsize);
+	BOOST_REQUIRE_EQUAL(lookup->longest_chain, image_lookup->longest_chain);
+	BOOST_REQUIRE_EQUAL(lookup->pv_array_bts, image_lookup->pv_array_bts);
+	BOOST_REQUIRE_EQUAL(0, memcmp(lookup->hashtable, image_lookup->hashtable,
+                                      lookup->hashsize * sizeof(Int4)));
+	BOOST_REQUIRE_EQUAL(0, memcmp(lookup->next_pos, image_lookup->next_pos,
+                                  (query_blk->length + 1) * sizeof(Int4)));
+	BOOST_REQUIRE_EQUAL(0, memcmp(lookup->pv_array, image_lookup->pv_array,
+                   (lookup->hashsize >> lookup->pv_array_bts) * 
+                   sizeof(PV_ARRAY_TYPE)));
+
+    s_NumImagesReleased = 0;
+	image_wrap_ptr = LookupTableWrapFree(image_wrap_ptr);
+    BOOST_REQUIRE_EQUAL(1, s_NumImagesReleased);
+
+    query_options = BlastQuerySetUpOptionsFree(query_options);
+	lookup_wrap_ptr = LookupTableWrapFree(lookup_wrap_ptr);
+        BOOST_REQUIRE(lookup_wrap_ptr == NULL);
+	lookup_options = LookupTableOptionsFree(lookup_options);
+        BOOST_REQUIRE(lookup_options == NULL);
+}
+
+// Test that a small nucleotide lookup table survives being serialized and
+// attached again
+BOOST_AUTO_TEST_CASE(testSmallNaLookupTableImage) {
+    SetUpQuery(SMALL_QUERY_GI);
+
+	LookupTableOptions* lookup_options;
+	LookupTableOptionsNew(eBlastTypeBlastn, &lookup_options);
+	BLAST_FillLookupTableOptions(lookup_options, eBlastTypeBlastn, 
+                                     FALSE, 0, 0);
+
+    QuerySetUpOptions* query_options = NULL;
+    BlastQuerySetUpOptionsNew(&query_options);
+	LookupTableWrap* lookup_wrap_ptr;
+ 	BOOST_REQUIRE_EQUAL((int)LookupTableWrapInit(query_blk, 
+                              lookup_options, query_options, lookup_segments, 
+                              0, &lookup_wrap_ptr, NULL, NULL, NULL), 0);
+    BOOST_REQUIRE_EQUAL(eSmallNaLookupTable,
+                        (ELookupTableType)lookup_wrap_ptr->lut_type);
+
+    const Uint8 kKey = LookupTableWrapImageKey(query_blk, lookup_options,
+                                               query_options, lookup_segments,
+                                               NULL);
+    BOOST_REQUIRE(kKey != 0);
+    const size_t kSize = LookupTableWrapImageSize(lookup_wrap_ptr, query_blk);
+    BOOST_REQUIRE(kSize > 0);
+    void* image = malloc(kSize);
+    BOOST_REQUIRE_EQUAL(0, (int)LookupTableWrapWriteImage(lookup_wrap_ptr,
+                                             query_blk, kKey, image, kSize));
+
+    LookupTableWrap* image_wrap_ptr = NULL;
+    BOOST_REQUIRE_EQUAL(0, (int)LookupTableWrapAttachImage(image, kSize, kKey,
+                              query_blk, s_ReleaseTestImage, image,
+                              &image_wrap_ptr));
+    BOOST_REQUIRE_EQUAL(eSmallNaLookupTable,
+                        (ELookupTableType)image_wrap_ptr->lut_type);
+
+	BlastSmallNaLookupTable* lookup = 
+                        (BlastSmallNaLookupTable*) lookup_wrap_ptr->lut;
+	BlastSmallNaLookupTable* image_lookup = 
+                        (BlastSmallNaLookupTable*) image_wrap_ptr->lut;
+	BOOST_REQUIRE_EQUAL(lookup->backbone_size, image_lookup->backbone_size);
+	BOOST_REQUIRE_EQUAL(lookup->longest_chain, image_lookup->longest_chain);
+	BOOST_REQUIRE_EQUAL(lookup->overflow_size, image_lookup->overflow_size);
+	BOOST_REQUIRE_EQUAL(lookup->word_length, image_lookup->word_length);
+	BOOST_REQUIRE_EQUAL(lookup->lut_word_length, 
+                        image_lookup->lut_word_length);
+	BOOST_REQUIRE_EQUAL(lookup->scan_step, image_lookup->scan_step);
+	BOOST_REQUIRE_EQUAL(0, memcmp(lookup->final_backbone, 
+                                  image_lookup->final_backbone,
+                                  lookup->backbone_size * sizeof(Int2)));
+	BOOST_REQUIRE_EQUAL(0, memcmp(lookup->overflow, image_lookup->overflow,
+                                  lookup->overflow_size * sizeof(Int2)));
+
+    BlastSeqLoc* loc = lookup->masked_locations;
+    BlastSeqLoc* image_loc = image_lookup->masked_locations;
+    for ( ; loc && image_loc; loc = loc->next, image_loc = image_loc->next) {
+        BOOST_REQUIRE_EQUAL(loc->ssr->left, image_loc->ssr->left);
+        BOOST_REQUIRE_EQUAL(loc->ssr->right, image_loc->ssr->right);
+    }
+    BOOST_REQUIRE(loc == NULL && image_loc == NULL);
+
+    s_NumImagesReleased = 0;
+	image_wrap_ptr = LookupTableWrapFree(image_wrap_ptr);
+    BOOST_REQUIRE_EQUAL(1, s_NumImagesReleased);
+
+    query_options = BlastQuerySetUpOptionsFree(query_options);
+	lookup_wrap_ptr = LookupTableWrapFree(lookup_wrap_ptr);
+        BOOST_REQUIRE(lookup_wrap_ptr == NULL);
+	lookup_options = LookupTableOptionsFree(lookup_options);
+        BOOST_REQUIRE(lookup_options == NULL);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 /*
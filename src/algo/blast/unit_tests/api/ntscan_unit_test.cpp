@@ -724,6 +724,60 @@ struct TestFixture {
         }
     }
 
+    // Called fifth: the scanner picked for this lookup table must
+    // report exactly the hits the general-purpose scanner reports
+    void ScanMatchesAnyCore(void)
+    {
+        Int4 scan_range[2];
+        Int4 word_length;
+
+        BOOST_REQUIRE(subject_blk != NULL);
+        BOOST_REQUIRE(lookup_wrap_ptr != NULL);
+        BOOST_REQUIRE(offset_pairs != NULL);
+
+        if (lookup_wrap_ptr->lut_type == eMBLookupTable) {
+            BlastMBLookupTable *mb_lt = (BlastMBLookupTable *)
+                                                lookup_wrap_ptr->lut;
+            // the general-purpose scanner handles contiguous words only
+            if (mb_lt->discontiguous)
+                return;
+            word_length = mb_lt->lut_word_length;
+        }
+        else {
+            BlastSmallNaLookupTable *na_lt = (BlastSmallNaLookupTable *)
+                                                lookup_wrap_ptr->lut;
+            word_length = na_lt->lut_word_length;
+        }
+
+        Int4 max_hits = GetOffsetArraySize(lookup_wrap_ptr);
+        vector<BlastOffsetPair> expected, found;
+        TNaScanSubjectFunction any_callback = (TNaScanSubjectFunction)
+                        BlastChooseNucleotideScanSubjectAny(lookup_wrap_ptr);
+
+        scan_range[0] = 0;
+        scan_range[1] = subject_blk->length - word_length;
+        while (scan_range[0] <= scan_range[1]) {
+            Int4 hits = any_callback(lookup_wrap_ptr, subject_blk,
+                                     offset_pairs, max_hits, scan_range);
+            expected.insert(expected.end(), offset_pairs,
+                            offset_pairs + hits);
+        }
+
+        scan_range[0] = 0;
+        while (scan_range[0] <= scan_range[1]) {
+            Int4 hits = RunScanSubject(scan_range, max_hits);
+            found.insert(found.end(), offset_pairs, offset_pairs + hits);
+        }
+
+        BOOST_REQUIRE_EQUAL(expected.size(), found.size());
+        for (size_t i = 0; i < expected.size(); i++) {
+            BOOST_REQUIRE_EQUAL(expected[i].qs_offsets.q_off,
+                                found[i].qs_offsets.q_off);
+            BOOST_REQUIRE_EQUAL(expected[i].qs_offsets.s_off,
+                                found[i].qs_offsets.s_off);
+        }
+    }
+
     // Called fourth
     void SkipMaskedRangesCore(void)
     {
@@ -850,6 +904,7 @@ BOOST_AUTO_TEST_CASE( name##ScanOffsetSize##wordsize ) {                    \
     ScanCheckHitsCore((EDiscWordType)d_type);                               \
     ScanMaxHitsTestCore();                                                  \
     SkipMaskedRangesCore();                                                 \
+    ScanMatchesAnyCore();                                                   \
 }
 
 DECLARE_TEST(Tiny, TINY_GI, 0, 0, 4);
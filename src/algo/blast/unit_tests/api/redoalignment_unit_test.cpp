@@ -65,7 +65,10 @@
 #include <algo/blast/blastinput/blast_fasta_input.hpp>
 
 #include <algo/blast/composition_adjustment/composition_constants.h>
+#include <algo/blast/composition_adjustment/composition_adjustment.h>
 #include <algo/blast/composition_adjustment/matrix_frequency_data.h>
+#include <algo/blast/composition_adjustment/nlm_linear_algebra.h>
+#include <util/random_gen.hpp>
 
 #include "test_objmgr.hpp"
 #include "blast_test_util.hpp"
@@ -972,6 +975,133 @@ BOOST_AUTO_TEST_CASE(testRedoAlignmentUseXdropEvalue) {
 // checkpoint files. QA should be added later 
 
 
+/// Lambda of a score distribution, computed as blast_kappa.c does it
+static double
+s_CalcLambda(double probs[], int min_score, int max_score, double lambda0)
+{
+    double avg = 0.0;
+    for (int i = 0;  i < max_score - min_score + 1;  i++) {
+        avg += (min_score + i) * probs[i];
+    }
+    Blast_ScoreFreq freq;
+    freq.score_min = freq.obs_min = min_score;
+    freq.score_max = freq.obs_max = max_score;
+    freq.sprob0 = probs;
+    freq.sprob = &probs[-min_score];
+    freq.score_avg = avg;
+    return Blast_KarlinLambdaNR(&freq, lambda0);
+}
+
+/// BLOSUM62 information as set up for composition-based statistics
+static Blast_MatrixInfo*
+s_Blosum62MatrixInfo(bool log_freq_ratios)
+{
+    const double kScale = 32.0;
+    Blast_MatrixInfo* info = Blast_MatrixInfoNew(BLASTAA_SIZE, BLASTAA_SIZE,
+                                                 FALSE);
+    BOOST_REQUIRE(info);
+    info->matrixName = strdup("BLOSUM62");
+    SFreqRatios* freq_ratios = _PSIMatrixFrequencyRatiosNew("BLOSUM62");
+    BOOST_REQUIRE(freq_ratios);
+    for (int i = 0;  i < BLASTAA_SIZE;  i++) {
+        for (int j = 0;  j < BLASTAA_SIZE;  j++) {
+            info->startFreqRatios[i][j] = freq_ratios->data[i][j];
+        }
+    }
+    _PSIMatrixFrequencyRatiosFree(freq_ratios);
+    info->ungappedLambda = 0.3176 / kScale;
+    Blast_Int4MatrixFromFreq(info->startMatrix, BLASTAA_SIZE,
+                             info->startFreqRatios, info->ungappedLambda);
+    if (log_freq_ratios) {
+        BOOST_REQUIRE_EQUAL(0, Blast_MatrixInfoSetLogFreqRatios(info));
+    }
+    return info;
+}
+
+// Matrices rescaled with the precomputed log frequency ratios, and matrices
+// returned from the workspace's cache of adjusted matrices, must be
+// identical to the ones computed from scratch
+BOOST_AUTO_TEST_CASE(AdjustedMatricesMatchUncached)
+{
+    const int kNumSubjects = 30;
+    const int kPseudocounts = 20;
+    const char kResidues[] = "ARNDCQEGHILKMFPSTWYV";
+    CRandom rng(17);
+
+    vector< vector<Uint1> > seqs(kNumSubjects + 1);
+    NON_CONST_ITERATE(vector< vector<Uint1> >, seq, seqs) {
+        seq->resize(100 + rng.GetRand(0, 300));
+        NON_CONST_ITERATE(vector<Uint1>, letter, *seq) {
+            *letter = AMINOACID_TO_NCBISTDAA[(int)
+                                             kResidues[rng.GetRand(0, 19)]];
+        }
+    }
+    Blast_AminoAcidComposition query_composition;
+    Blast_ReadAaComposition(&query_composition, BLASTAA_SIZE,
+                            &seqs[0][0], (int)seqs[0].size());
+
+    Blast_MatrixInfo* plain_info = s_Blosum62MatrixInfo(false);
+    Blast_MatrixInfo* log_info = s_Blosum62MatrixInfo(true);
+    int** expected = Nlm_Int4MatrixNew(BLASTAA_SIZE, BLASTAA_SIZE);
+    int** actual = Nlm_Int4MatrixNew(BLASTAA_SIZE, BLASTAA_SIZE);
+
+    const ECompoAdjustModes kModes[] = {
+        eCompositionBasedStats, eCompositionMatrixAdjust
+    };
+    for (size_t m = 0;  m < sizeof(kModes) / sizeof(kModes[0]);  m++) {
+        Blast_CompositionWorkspace* cached = Blast_CompositionWorkspaceNew();
+        BOOST_REQUIRE_EQUAL(0, Blast_CompositionWorkspaceInit(cached,
+                                                              "BLOSUM62"));
+        for (int i = 1;  i <= kNumSubjects;  i++) {
+            const int kLength = (int)seqs[i].size();
+            Blast_AminoAcidComposition subject_composition;
+            Blast_ReadAaComposition(&subject_composition, BLASTAA_SIZE,
+                                    &seqs[i][0], kLength);
+
+            // a fresh workspace has nothing cached
+            Blast_CompositionWorkspace* fresh =
+                Blast_CompositionWorkspaceNew();
+            BOOST_REQUIRE_EQUAL(0, Blast_CompositionWorkspaceInit(fresh,
+                                                                  "BLOSUM62"));
+            EMatrixAdjustRule expected_rule = eDontAdjustMatrix;
+            double expected_ratio = 0.0, pvalue = 0.0;
+            BOOST_REQUIRE_EQUAL(0, Blast_AdjustScores(expected,
+                                   &query_composition, (int)seqs[0].size(),
+                                   &subject_composition, kLength,
+                                   plain_info, kModes[m], kPseudocounts,
+                                   fresh, &expected_rule, s_CalcLambda,
+                                   &pvalue, 0, &expected_ratio));
+            Blast_CompositionWorkspaceFree(&fresh);
+
+            // the first call fills the cache, the second one reads it
+            for (int pass = 0;  pass < 2;  pass++) {
+                EMatrixAdjustRule rule = eDontAdjustMatrix;
+                double ratio = 0.0;
+                BOOST_REQUIRE_EQUAL(0, Blast_AdjustScores(actual,
+                                       &query_composition,
+                                       (int)seqs[0].size(),
+                                       &subject_composition, kLength,
+                                       log_info, kModes[m], kPseudocounts,
+                                       cached, &rule, s_CalcLambda,
+                                       &pvalue, 0, &ratio));
+                BOOST_REQUIRE_EQUAL((int)expected_rule, (int)rule);
+                BOOST_REQUIRE_EQUAL(expected_ratio, ratio);
+                for (int r = 0;  r < BLASTAA_SIZE;  r++) {
+                    for (int c = 0;  c < BLASTAA_SIZE;  c++) {
+                        BOOST_REQUIRE_EQUAL(expected[r][c], actual[r][c]);
+                    }
+                }
+            }
+        }
+        Blast_CompositionWorkspaceFree(&cached);
+    }
+
+    Nlm_Int4MatrixFree(&expected);
+    Nlm_Int4MatrixFree(&actual);
+    Blast_MatrixInfoFree(&plain_info);
+    Blast_MatrixInfoFree(&log_info);
+}
+
 BOOST_AUTO_TEST_CASE(CheckLowerCaseMatrix)
 {
       BOOST_REQUIRE(Blast_FrequencyDataIsAvailable("blosum62") == 1);
@@ -1936,4 +1936,60 @@ BOOST_AUTO_TEST_CASE(InvalidChunkSizeTblastx)
     BOOST_REQUIRE_THROW(SplitQuery_GetChunkSize(blast::eTblastx), CBlastException);
 }
 
+BOOST_AUTO_TEST_CASE(AdaptiveChunkSize)
+{
+    SBlastMemoryLimits limits;
+    limits.available_memory = NCBI_CONST_UINT8(64) * 1024 * 1024 * 1024;
+    limits.cache_size = 32 * 1024 * 1024;
+
+    // The protein lookup table costs are known for BLOSUM62, word size 3
+    // and threshold 11 only
+    CRef<CBlastOptionsHandle> blastp_opts
+        (CBlastOptionsFactory::Create(blast::eBlastp));
+    CRef<CBlastOptionsHandle> blastx_opts
+        (CBlastOptionsFactory::Create(blast::eBlastx));
+    blastx_opts->SetOptions().SetMatrixName("BLOSUM62");
+    blastx_opts->SetOptions().SetWordSize(3);
+    blastx_opts->SetOptions().SetWordThreshold(11);
+    const CBlastOptions* kBlastp = &blastp_opts->GetOptions();
+    const CBlastOptions* kBlastx = &blastx_opts->GetOptions();
+
+    // Plenty of cache: grow, but by no more than a factor of 4
+    BOOST_REQUIRE_EQUAL(40000U,
+                GetAdaptiveQuerySize(blast::eBlastp, 10000, limits, kBlastp));
+    BOOST_REQUIRE_EQUAL(40008U,
+                GetAdaptiveQuerySize(blast::eBlastx, 10002, limits, kBlastx));
+
+    // Other protein settings, or unknown ones, keep the fixed size
+    BOOST_REQUIRE_EQUAL(10000U,
+                        GetAdaptiveQuerySize(blast::eBlastp, 10000, limits));
+    blastp_opts->SetOptions().SetWordThreshold(13);
+    BOOST_REQUIRE_EQUAL(10000U,
+                GetAdaptiveQuerySize(blast::eBlastp, 10000, limits, kBlastp));
+    blastp_opts->SetOptions().SetWordThreshold(11);
+    blastp_opts->SetOptions().SetMatrixName("PAM30");
+    BOOST_REQUIRE_EQUAL(10000U,
+                GetAdaptiveQuerySize(blast::eBlastp, 10000, limits, kBlastp));
+
+    // Little memory caps the size
+    limits.available_memory = 16 * 1024 * 1024;
+    BOOST_REQUIRE_EQUAL(149796U,
+                        GetAdaptiveQuerySize(blast::eBlastn, 1000000, limits));
+
+    // Little cache shrinks the size, keeping translated chunks in frame
+    limits.available_memory = NCBI_CONST_UINT8(64) * 1024 * 1024 * 1024;
+    limits.cache_size = 1024 * 1024;
+    BOOST_REQUIRE_EQUAL(2499U,
+                GetAdaptiveQuerySize(blast::eBlastx, 10002, limits, kBlastx));
+
+    // Splitting stays disabled where it is disabled
+    BOOST_REQUIRE_EQUAL(1U,
+                        GetAdaptiveQuerySize(blast::eVecScreen, 1, limits));
+
+    CAutoEnvironmentVariable tmp_env("CHUNK_SIZE", kAdaptiveQuerySize);
+    const size_t kChunkSize = SplitQuery_GetChunkSize(blast::eTblastx);
+    BOOST_REQUIRE(kChunkSize > 0);
+    BOOST_REQUIRE_EQUAL(0U, kChunkSize % CODON_LENGTH);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
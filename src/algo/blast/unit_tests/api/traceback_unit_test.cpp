@@ -54,6 +54,7 @@
 #include <algo/blast/core/blast_setup.h>
 #include <algo/blast/core/blast_gapalign.h>
 #include <algo/blast/core/blast_traceback.h>
+#include <algo/blast/core/blast_sw.h>
 
 #include <algo/blast/api/blast_options_handle.hpp>
 #include <algo/blast/api/blast_prot_options.hpp>
@@ -1176,6 +1177,140 @@ BOOST_AUTO_TEST_CASE(testPartialFetchingMT) {
     free(hsp_list_array);
 }
 
+/* Checks that every Smith-Waterman score-only engine reproduces the
+   scores of the scalar reference implementation, on whole sequences
+   and on a range of prefixes of them. With use_pssm the protein query
+   is scored through a position-specific matrix */
+static void s_CheckSmithWatermanEngines(CTracebackTestFixture& fixture,
+                                        const CSeq_id& qid,
+                                        const CSeq_id& sid,
+                                        CBlastOptionsHandle& opts_handle,
+                                        bool is_prot,
+                                        bool use_pssm = false)
+{
+    auto_ptr<SSeqLoc> qsl(
+        CTestObjMgr::Instance().CreateSSeqLoc(const_cast<CSeq_id&>(qid),
+            is_prot ? eNa_strand_unknown : eNa_strand_plus));
+    auto_ptr<SSeqLoc> ssl(
+        CTestObjMgr::Instance().CreateSSeqLoc(const_cast<CSeq_id&>(sid),
+            is_prot ? eNa_strand_unknown : eNa_strand_plus));
+
+    CBl2Seq blaster(*qsl, *ssl, opts_handle);
+
+    CBlastQueryInfo query_info;
+    CBLAST_SequenceBlk query_blk;
+    TSearchMessages blast_msg;
+
+    const CBlastOptions& kOpts = blaster.GetOptionsHandle().GetOptions();
+    EBlastProgramType prog = kOpts.GetProgramType();
+    ENa_strand strand_opt = kOpts.GetStrandOption();
+
+    SetupQueryInfo(const_cast<TSeqLocVector&>(blaster.GetQueries()),
+                   prog, strand_opt, &query_info);
+    SetupQueries(const_cast<TSeqLocVector&>(blaster.GetQueries()),
+                 query_info, &query_blk, prog, strand_opt, blast_msg);
+    ITERATE(TSearchMessages, m, blast_msg) {
+        BOOST_REQUIRE(m->empty());
+    }
+
+    BlastSeqSrc* seq_src =
+        MultiSeqBlastSeqSrcInit(
+                const_cast<TSeqLocVector&>(blaster.GetSubjects()), prog);
+    TestUtil::CheckForBlastSeqSrcErrors(seq_src);
+
+    fixture.x_SetupMain(kOpts, query_blk, query_info);
+    fixture.x_SetupGapAlign(kOpts, seq_src, query_info);
+
+    // ncbistdaa for proteins, ncbi2na for nucleotides
+    BlastSeqSrcGetSeqArg seq_arg;
+    memset((void*) &seq_arg, 0, sizeof(seq_arg));
+    seq_arg.oid = 0;
+    seq_arg.encoding = eBlastEncodingProtein;
+    BOOST_REQUIRE_EQUAL(BLAST_SEQSRC_SUCCESS,
+                        BlastSeqSrcGetSequence(seq_src, &seq_arg));
+
+    const BlastContextInfo& ctx = query_info->contexts[0];
+    const Uint1* query = query_blk->sequence + ctx.query_offset;
+    const Uint1* subject = seq_arg.seq->sequence;
+    const Int4 kGapOpen = fixture.m_ScoreParams->gap_open;
+    const Int4 kGapExtend = fixture.m_ScoreParams->gap_extend;
+    const ESmithWatermanEngine kEngines[] = {
+        eSWEngineSSE2, eSWEngineAVX2, eSWEngineAuto
+    };
+
+    if (use_pssm) {
+        // the score matrix row of each query residue, biased by position
+        // so that a PSSM read in the wrong order changes the scores
+        BOOST_REQUIRE(is_prot);
+        SPsiBlastScoreMatrix* psi_matrix =
+            SPsiBlastScoreMatrixNew(ctx.query_length);
+        BOOST_REQUIRE(psi_matrix != NULL);
+        Int4** matrix = fixture.m_ScoreBlk->matrix->data;
+        for (Int4 i = 0; i < ctx.query_length; i++) {
+            for (Int4 r = 0; r < BLASTAA_SIZE; r++) {
+                psi_matrix->pssm->data[i][r] = matrix[query[i]][r] + i % 5 - 2;
+            }
+        }
+        fixture.m_ScoreBlk->psi_matrix = psi_matrix;
+        fixture.m_GapAlign->positionBased = TRUE;
+    }
+
+    for (Int4 q_len = 1; q_len <= ctx.query_length; q_len += 37) {
+        Int4 s_len = MIN(seq_arg.seq->length, 3 * q_len);
+        if (!is_prot) {
+            s_len &= ~3;    // whole ncbi2na bytes only
+        }
+        Int4 ref = is_prot ?
+            Blast_SmithWatermanScoreOnly(query, q_len, subject, s_len,
+                                         kGapOpen, kGapExtend,
+                                         fixture.m_GapAlign,
+                                         eSWEngineScalar) :
+            Blast_NuclSmithWatermanScoreOnly(subject, s_len, query, q_len,
+                                             kGapOpen, kGapExtend,
+                                             fixture.m_GapAlign,
+                                             eSWEngineScalar);
+        for (size_t e = 0; e < sizeof(kEngines)/sizeof(*kEngines); e++) {
+            Int4 score = is_prot ?
+                Blast_SmithWatermanScoreOnly(query, q_len, subject, s_len,
+                                             kGapOpen, kGapExtend,
+                                             fixture.m_GapAlign,
+                                             kEngines[e]) :
+                Blast_NuclSmithWatermanScoreOnly(subject, s_len,
+                                                 query, q_len,
+                                                 kGapOpen, kGapExtend,
+                                                 fixture.m_GapAlign,
+                                                 kEngines[e]);
+            BOOST_REQUIRE_EQUAL(ref, score);
+        }
+    }
+
+    BlastSeqSrcReleaseSequence(seq_src, &seq_arg);
+    BlastSequenceBlkFree(seq_arg.seq);
+    seq_src = BlastSeqSrcFree(seq_src);
+}
+
+BOOST_AUTO_TEST_CASE(testSmithWatermanEnginesProtein) {
+    CSeq_id qid("gi|42734333");
+    CSeq_id sid("gi|30176631");
+    CBlastProteinOptionsHandle opts_handle;
+    s_CheckSmithWatermanEngines(*this, qid, sid, opts_handle, true);
+}
+
+BOOST_AUTO_TEST_CASE(testSmithWatermanEnginesPssm) {
+    CSeq_id qid("gi|42734333");
+    CSeq_id sid("gi|30176631");
+    CBlastProteinOptionsHandle opts_handle;
+    s_CheckSmithWatermanEngines(*this, qid, sid, opts_handle, true, true);
+}
+
+BOOST_AUTO_TEST_CASE(testSmithWatermanEnginesNucleotide) {
+    CSeq_id qid("gi|1945388");
+    CSeq_id sid("gi|1732684");
+    CBlastNucleotideOptionsHandle opts_handle;
+    opts_handle.SetTraditionalBlastnDefaults();
+    s_CheckSmithWatermanEngines(*this, qid, sid, opts_handle, false);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 /*
@@ -38,6 +38,7 @@
 #include <serial/serialbase.hpp>
 #include <objects/seq/seq__.hpp>
 #include <corelib/ncbifile.hpp>
+#include <corelib/ncbithr.hpp>
 #include <util/sequtil/sequtil_convert.hpp>
 #include <objmgr/util/sequence.hpp>
 #include <objtools/blast/seqdb_reader/impl/seqdbisam.hpp>
@@ -2760,6 +2761,273 @@ BOOST_AUTO_TEST_CASE(SharedMemoryMaps)
         seqdb2.RetSequence(& s2);
 }
 
+// What a reader is expected to retrieve for one OID
+struct SImmutableReadRef {
+    int          length;
+    string       seq;
+    string       ambig_na8;
+    string       ambig_blastna8;
+    list< CRef<CSeq_id> > ids;
+};
+
+static void s_ImmutableReadRefs(CSeqDB & db, vector<SImmutableReadRef> & refs)
+{
+    const bool is_nucl = db.GetSequenceType() == CSeqDB::eNucleotide;
+
+    for(int oid = 0; db.CheckOrFindOID(oid); oid++) {
+        SImmutableReadRef ref;
+        const char * buf = 0;
+
+        ref.length = db.GetSequence(oid, & buf);
+        ref.seq.assign(buf, is_nucl ? (ref.length + 3) / 4 : ref.length);
+        db.RetSequence(& buf);
+
+        if (is_nucl) {
+            int len = db.GetAmbigSeq(oid, & buf, kSeqDBNuclNcbiNA8);
+            ref.ambig_na8.assign(buf, len);
+            db.RetAmbigSeq(& buf);
+
+            len = db.GetAmbigSeq(oid, & buf, kSeqDBNuclBlastNA8);
+            ref.ambig_blastna8.assign(buf, len);
+            db.RetAmbigSeq(& buf);
+        }
+
+        ref.ids = db.GetSeqIDs(oid);
+
+        refs.resize(oid + 1);
+        refs[oid] = ref;
+    }
+}
+
+// Reads every OID of a shared immutable CSeqDB and counts the differences
+// from the locked mode; Boost checks are not made from these threads.
+class CImmutableReadThread : public CThread {
+public:
+    CImmutableReadThread(CSeqDB & db, const vector<SImmutableReadRef> & refs,
+                         int start, int passes)
+        : m_Db(db), m_Refs(refs), m_Start(start), m_Passes(passes),
+          m_Reads(0), m_Errors(0)
+    {
+    }
+
+    int GetReads() const { return m_Reads; }
+    int GetErrors() const { return m_Errors; }
+
+protected:
+    virtual void * Main()
+    {
+        const bool is_nucl = m_Db.GetSequenceType() == CSeqDB::eNucleotide;
+        const int num_oids = (int) m_Refs.size();
+
+        for(int pass = 0; pass < m_Passes; pass++) {
+            for(int i = 0; i < num_oids; i++) {
+                // each thread walks the OIDs from a different starting point
+                int oid = (m_Start + i) % num_oids;
+                const SImmutableReadRef & ref = m_Refs[oid];
+                const char * buf = 0;
+
+                int length = m_Db.GetSequence(oid, & buf);
+                x_Check(length == ref.length && m_Db.GetSeqLength(oid) == ref.length
+                        && ref.seq == string(buf, ref.seq.size()));
+                m_Db.RetSequence(& buf);
+
+                if (is_nucl) {
+                    length = m_Db.GetAmbigSeq(oid, & buf, kSeqDBNuclNcbiNA8);
+                    x_Check(ref.ambig_na8 == string(buf, length));
+                    m_Db.RetAmbigSeq(& buf);
+
+                    int begin = ref.length / 4, end = ref.length / 2;
+                    length = m_Db.GetAmbigSeq(oid, & buf, kSeqDBNuclBlastNA8,
+                                              begin, end);
+                    x_Check(ref.ambig_blastna8.substr(begin, end - begin)
+                            == string(buf, length));
+                    m_Db.RetAmbigSeq(& buf);
+                }
+
+                ITERATE(list< CRef<CSeq_id> >, id, ref.ids) {
+                    vector<int> oids;
+                    m_Db.SeqidToOids(**id, oids);
+                    x_Check(find(oids.begin(), oids.end(), oid) != oids.end());
+                }
+                m_Reads++;
+            }
+        }
+        return 0;
+    }
+
+private:
+    void x_Check(bool ok)
+    {
+        if (! ok) {
+            m_Errors++;
+        }
+    }
+
+    CSeqDB & m_Db;
+    const vector<SImmutableReadRef> & m_Refs;
+    int m_Start;
+    int m_Passes;
+    int m_Reads;
+    int m_Errors;
+};
+
+static void s_TestImmutableConcurrentReads(const string & dbname,
+                                           CSeqDB::ESeqType seqtype)
+{
+    vector<SImmutableReadRef> refs;
+    {{
+        CSeqDB locked(dbname, seqtype);
+        s_ImmutableReadRefs(locked, refs);
+    }}
+    BOOST_REQUIRE(! refs.empty());
+
+    CSeqDB db(dbname, seqtype);
+    db.SetImmutableMode();
+
+    const int kNumThreads = 8;
+    const int kPasses = 20;
+
+    vector< CRef<CImmutableReadThread> > threads;
+    for(int i = 0; i < kNumThreads; i++) {
+        int start = (int) (i * refs.size() / kNumThreads);
+        threads.push_back(CRef<CImmutableReadThread>
+                          (new CImmutableReadThread(db, refs, start, kPasses)));
+    }
+    NON_CONST_ITERATE(vector< CRef<CImmutableReadThread> >, thr, threads) {
+        (*thr)->Run();
+    }
+    NON_CONST_ITERATE(vector< CRef<CImmutableReadThread> >, thr, threads) {
+        (*thr)->Join();
+    }
+
+    ITERATE(vector< CRef<CImmutableReadThread> >, thr, threads) {
+        BOOST_REQUIRE_EQUAL((*thr)->GetReads(), (int) refs.size() * kPasses);
+        BOOST_REQUIRE_EQUAL((*thr)->GetErrors(), 0);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ImmutableModeConcurrentReadsN)
+{
+    s_TestImmutableConcurrentReads("data/seqn", CSeqDB::eNucleotide);
+}
+
+BOOST_AUTO_TEST_CASE(ImmutableModeConcurrentReadsP)
+{
+    s_TestImmutableConcurrentReads("data/seqp", CSeqDB::eProtein);
+}
+
+BOOST_AUTO_TEST_CASE(PrefetchSequences)
+{
+    vector<SImmutableReadRef> refs;
+    {{
+        CSeqDB db("data/seqn", CSeqDB::eNucleotide);
+        s_ImmutableReadRefs(db, refs);
+    }}
+    BOOST_REQUIRE(refs.size() > 2);
+
+    // Every other OID, surrounded by OIDs that are out of range
+    vector<int> oids;
+    oids.push_back(-1);
+    for(int oid = 0; oid < (int) refs.size(); oid += 2) {
+        oids.push_back(oid);
+    }
+    oids.push_back((int) refs.size());
+    oids.push_back((int) refs.size() + 10);
+
+    for(int immutable = 0; immutable < 2; immutable++) {
+        CSeqDB db("data/seqn", CSeqDB::eNucleotide);
+        if (immutable) {
+            db.SetImmutableMode();
+        }
+        db.PrefetchSequences(oids);
+
+        vector<SImmutableReadRef> prefetched;
+        s_ImmutableReadRefs(db, prefetched);
+
+        BOOST_REQUIRE_EQUAL(prefetched.size(), refs.size());
+        for(size_t oid = 0; oid < refs.size(); oid++) {
+            BOOST_REQUIRE_EQUAL(prefetched[oid].length, refs[oid].length);
+            BOOST_REQUIRE(prefetched[oid].seq == refs[oid].seq);
+            BOOST_REQUIRE(prefetched[oid].ambig_na8 == refs[oid].ambig_na8);
+            BOOST_REQUIRE(prefetched[oid].ambig_blastna8 == refs[oid].ambig_blastna8);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(GetAmbigSeqBatch)
+{
+    // Two volumes, with sequences long enough for offset ranges to apply
+    CSeqDB db("data/vols_v5", CSeqDB::eNucleotide);
+
+    vector<int> oids;
+    for(int oid = 0; db.CheckOrFindOID(oid); oid++) {
+        oids.push_back(oid);
+    }
+    BOOST_REQUIRE(oids.size() > 2);
+
+    // Sequences shorter than 10240 bases are always decoded whole, so
+    // only the long ones are restricted to a few ranges.
+    map<int, CSeqDB::TRangeList> ranges;
+    ITERATE(vector<int>, oid, oids) {
+        int length = db.GetSeqLength(*oid);
+        if (length > 20000) {
+            CSeqDB::TRangeList & r = ranges[*oid];
+            r.insert(make_pair(100, 2000));
+            r.insert(make_pair(length / 2, length / 2 + 5000));
+            r.insert(make_pair(length - 300, length + 100));
+            db.SetOffsetRanges(*oid, r, false, false);
+        }
+    }
+    BOOST_REQUIRE(! ranges.empty());
+
+    CSeqDB::SSequenceBatch batch;
+    const int codes[] = { kSeqDBNuclNcbiNA8, kSeqDBNuclBlastNA8 };
+
+    for(int pass = 0; pass < 2; pass++) {
+        const int code = codes[pass];
+        const int sentinel = (code == kSeqDBNuclBlastNA8) ? 1 : 0;
+
+        // The batch is reused, replacing the previous contents
+        db.GetAmbigSeqBatch(oids, code, batch);
+        BOOST_REQUIRE_EQUAL(batch.Size(), oids.size());
+
+        for(size_t i = 0; i < batch.Size(); i++) {
+            const int oid = oids[i];
+            BOOST_REQUIRE_EQUAL(batch.oids[i], oid);
+
+            const char * buf = 0;
+            int length = db.GetAmbigSeq(oid, & buf, code);
+            BOOST_REQUIRE_EQUAL(batch.lengths[i], length);
+
+            const char * seq = batch.GetSequence(i);
+            const char * ref = buf + sentinel;
+
+            if (sentinel) {
+                BOOST_REQUIRE_EQUAL((int) seq[-1], 15);
+                BOOST_REQUIRE_EQUAL((int) seq[length], 15);
+            }
+
+            map<int, CSeqDB::TRangeList>::const_iterator r = ranges.find(oid);
+            if (r == ranges.end()) {
+                BOOST_REQUIRE(memcmp(seq, ref, length) == 0);
+            } else {
+                // Outside the ranges no data is guaranteed.
+                ITERATE(CSeqDB::TRangeList, range, r->second) {
+                    int end = min(range->second, length);
+                    BOOST_REQUIRE(memcmp(seq + range->first,
+                                         ref + range->first,
+                                         end - range->first) == 0);
+                }
+            }
+            db.RetAmbigSeq(& buf);
+        }
+    }
+
+    vector<int> bad_oids(1, (int) oids.size());
+    BOOST_REQUIRE_THROW(db.GetAmbigSeqBatch(bad_oids, kSeqDBNuclNcbiNA8, batch),
+                        CSeqDBException);
+}
+
 class CSeqIdList : public CSeqDBGiList {
 public:
     // Takes a NULL-terminated list of null-terminated strings.  If these
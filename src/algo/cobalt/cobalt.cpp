@@ -758,7 +758,8 @@ CMultiAligner::x_FindQueryClusters()
     // distance matrix is need for fining cluster representatives
     auto_ptr<CClusterer::TDistMatrix> dmat
         = TKMethods::ComputeDistMatrix(kmer_counts,
-                                       m_Options->GetKmerDistMeasure());
+                                       m_Options->GetKmerDistMeasure(),
+                                       m_Options->GetNumThreads());
 
     // If the central sequence is set, make the distance between this sequence
     // and all others zero. This will result in a progressive alignment tree
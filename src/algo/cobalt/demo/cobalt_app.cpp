@@ -277,6 +277,10 @@ void CMultiApplication::Init(void)
                      s_GetKmerAlphabetAsString(COBALT_KMER_ALPH));
     arg_desc->SetConstraint("alph", &(*new CArgAllow_Strings, "regular",
                                       "se-v10", "se-b15"));
+    arg_desc->AddDefaultKey("num_threads", "number",
+                     "Number of threads for computing k-mer distances",
+                     CArgDescriptions::eInteger, "1");
+    arg_desc->SetConstraint("num_threads", new CArgAllow_Integers(1, 256));
 
 
     // Output options
@@ -472,6 +476,7 @@ int CMultiApplication::Run(void)
         }
     }
     opts->SetKmerAlphabet(alph);
+    opts->SetNumThreads(args["num_threads"].AsInteger());
 
     // not option of the application
     opts->SetInClustAlnMethod(args["clusters"].AsBoolean() 
@@ -46,6 +46,11 @@ Contents: Implementation of k-mer counting classes
 
 #include <algo/cobalt/kmercounts.hpp>
 
+#if defined(NCBI_SSE)  &&  NCBI_SSE >= 20
+#  define KMER_HAVE_SSE2
+#  include <emmintrin.h>
+#endif
+
 
 USING_NCBI_SCOPE;
 USING_SCOPE(cobalt);
@@ -55,9 +60,30 @@ unsigned int CSparseKmerCounts::sm_KmerLength = 4;
 unsigned int CSparseKmerCounts::sm_AlphabetSize = kAlphabetSize;
 vector<Uint1> CSparseKmerCounts::sm_TransTable;
 bool CSparseKmerCounts::sm_UseCompressed = false;
-CSparseKmerCounts::TCount* CSparseKmerCounts::sm_Buffer = NULL;
 bool CSparseKmerCounts::sm_ForceSmallerMem = false;
 
+// Guards sm_ForceSmallerMem, which is updated while counting if memory
+// for the larger counts array cannot be allocated
+DEFINE_STATIC_FAST_MUTEX(s_ForceSmallerMemMutex);
+
+// Buffer for k-mer counts allocated by CSparseKmerCounts::PreCount()
+struct SKmerCountsBuffer
+{
+    CSparseKmerCounts::TCount* counts;
+    // True if counts are indexed as numbers in system with base alphabet
+    // size, false if as bit vectors
+    bool smaller_mem;
+};
+
+static void s_FreeKmerCountsBuffer(SKmerCountsBuffer* buffer, void*)
+{
+    delete [] buffer->counts;
+    delete buffer;
+}
+
+// Each thread counts k-mers in its own buffer
+static CStaticTls<SKmerCountsBuffer> s_KmerCountsBuffer;
+
 unsigned int CBinaryKmerCounts::sm_KmerLength = 3;
 unsigned int CBinaryKmerCounts::sm_AlphabetSize = kAlphabetSize;
 vector<Uint1> CBinaryKmerCounts::sm_TransTable;
@@ -119,39 +145,44 @@ static void MarkUsed(Uint4 pos, vector<Uint4>& entries, int chunk)
 
 
 CSparseKmerCounts::TCount* CSparseKmerCounts::ReserveCountsMem(
-                                                       unsigned int num_bits)
+                                                       unsigned int num_bits,
+                                                       bool& smaller_mem)
 {
     Uint4 num_elements;
-    TCount* counts = NULL;
+
+    {{
+        CFastMutexGuard guard(s_ForceSmallerMemMutex);
+        smaller_mem = sm_ForceSmallerMem;
+    }}
 
     // Reserve memory for storing counts
     // there are two methods for indexing counts (see the Reset() method)
     // if memory cannot be allocated try to allocate for the second method
     // that requires less memory
-    if (!sm_ForceSmallerMem && sm_KmerLength * num_bits 
-                                  < kLengthBitsThreshold) {
+    if (!smaller_mem && sm_KmerLength * num_bits < kLengthBitsThreshold) {
 
         num_elements = 1 << (num_bits * sm_KmerLength);
         try {
-            counts = new TCount[num_elements];
+            return new TCount[num_elements];
         }
         catch (std::bad_alloc) {
+            CFastMutexGuard guard(s_ForceSmallerMemMutex);
             sm_ForceSmallerMem = true;
-            num_elements = (Uint4)pow((double)sm_AlphabetSize,
-                                      (double)sm_KmerLength);
-
-            try {
-                counts = new TCount[num_elements];
-            }
-            catch (std::bad_alloc) {
-                NCBI_THROW(CKmerCountsException, eMemoryAllocation,
-                           "Memory cannot be allocated for k-mer counting."
-                           " Try using compressed alphabet or smaller k.");
-            }
-                
         }
     }
-    return counts;
+
+    smaller_mem = true;
+    num_elements = (Uint4)pow((double)sm_AlphabetSize,
+                              (double)sm_KmerLength);
+    try {
+        return new TCount[num_elements];
+    }
+    catch (std::bad_alloc) {
+        NCBI_THROW(CKmerCountsException, eMemoryAllocation,
+                   "Memory cannot be allocated for k-mer counting."
+                   " Try using compressed alphabet or smaller k.");
+    }
+    return NULL;
 }
 
 void CSparseKmerCounts::Reset(const objects::CSeq_loc& seq,
@@ -181,6 +212,7 @@ void CSparseKmerCounts::Reset(const objects::CSeq_loc& seq,
 
     m_SeqLength = sv.size();
     m_Counts.clear();
+    m_Positions.clear();
     m_NumCounts = 0;
 
     if (m_SeqLength < kmer_len) {
@@ -197,13 +229,25 @@ void CSparseKmerCounts::Reset(const objects::CSeq_loc& seq,
     }
     const int kNumBits = num;
 
-    TCount* counts = sm_Buffer ? sm_Buffer : ReserveCountsMem(kNumBits); 
+    // Use the buffer allocated by PreCount() in this thread, if any
+    SKmerCountsBuffer* buffer = s_KmerCountsBuffer.GetValue();
+    bool smaller_mem;
+    TCount* counts;
+    if (buffer) {
+        counts = buffer->counts;
+        smaller_mem = buffer->smaller_mem;
+    }
+    else {
+        counts = ReserveCountsMem(kNumBits, smaller_mem);
+    }
+    AutoArray<TCount> own_counts(buffer ? NULL : counts);
 
     // Vecotr of counts is first computed using regular vector that is later
     // converted to the sparse vector (list of position-value pairs).
     // Positions are calculated as binary representations of k-mers, if they
     // fit in 32 bits. Otherwise as numbers in system with base alphabet size.
-    if (!sm_ForceSmallerMem && kmer_len * kNumBits < kLengthBitsThreshold) {
+    if (!smaller_mem) {
+        _ASSERT(kmer_len * kNumBits < kLengthBitsThreshold);
 
         num_elements = 1 << (kNumBits * kmer_len);
         const Uint4 kMask = num_elements - (1 << kNumBits);
@@ -357,10 +401,10 @@ void CSparseKmerCounts::Reset(const objects::CSeq_loc& seq,
         }
     }
 
-    if (!sm_Buffer && counts) {
-        delete [] counts;
+    m_Positions.reserve(m_Counts.size());
+    ITERATE (vector<SVectorElement>, it, m_Counts) {
+        m_Positions.push_back(it->position);
     }
-    
 }
 
 double CSparseKmerCounts::FractionCommonKmersDist(
@@ -411,41 +455,79 @@ unsigned int CSparseKmerCounts::CountCommonKmers(
 {
 
     unsigned int result = 0;
-    TNonZeroCounts_CI it1 = vect1.m_Counts.begin();
-    TNonZeroCounts_CI it2 = vect2.m_Counts.begin();
+    if (vect1.m_Counts.empty() || vect2.m_Counts.empty()) {
+        return result;
+    }
 
-    // Iterating through non zero counts in both vectors
-    do {
-        // For each vector element that is non zero in vect1 and vect2
-        while (it1 != vect1.m_Counts.end() && it2 != vect2.m_Counts.end() 
-               && it1->position == it2->position) {
+    _ASSERT(vect1.m_Positions.size() == vect1.m_Counts.size());
+    _ASSERT(vect2.m_Positions.size() == vect2.m_Counts.size());
+
+    // Both vectors are sorted by position and each position occurs once,
+    // so common k-mers are found by merging them in a single pass.
+    // This is called for all pairs of sequences.
+    const Uint4* pos1 = &vect1.m_Positions[0];
+    const Uint4* pos2 = &vect2.m_Positions[0];
+    const SVectorElement* counts1 = &vect1.m_Counts[0];
+    const SVectorElement* counts2 = &vect2.m_Counts[0];
+    const size_t kSize1 = vect1.m_Positions.size();
+    const size_t kSize2 = vect2.m_Positions.size();
+    size_t i = 0, j = 0;
+
+#ifdef KMER_HAVE_SSE2
+    // Compare blocks of four positions from each vector, all against all,
+    // by rotating the second block. Then skip the block with the smaller
+    // last position, as none of its positions can match any further ones.
+    const size_t kBlock = 4;
+    while (i + kBlock <= kSize1 && j + kBlock <= kSize2) {
+        __m128i block1 = _mm_loadu_si128((const __m128i*)(pos1 + i));
+        __m128i block2 = _mm_loadu_si128((const __m128i*)(pos2 + j));
+        for (size_t r = 0;r < kBlock;r++) {
+            int mask = _mm_movemask_ps(_mm_castsi128_ps(
+                                       _mm_cmpeq_epi32(block1, block2)));
+            for (size_t k = 0;mask != 0;k++, mask >>= 1) {
+                if (mask & 1) {
+                    // after r rotations element k of block2 holds
+                    // element (k + r) % 4 of the original block
+                    TCount val1 = counts1[i + k].value;
+                    TCount val2 = counts2[j + (k + r) % kBlock].value;
+                    result += repetitions ? (val1 < val2 ? val1 : val2) : 1;
+                }
+            }
+            block2 = _mm_shuffle_epi32(block2, _MM_SHUFFLE(0, 3, 2, 1));
+        }
+
+        Uint4 last1 = pos1[i + kBlock - 1];
+        Uint4 last2 = pos2[j + kBlock - 1];
+        if (last1 <= last2) {
+            i += kBlock;
+        }
+        if (last2 <= last1) {
+            j += kBlock;
+        }
+    }
+#endif
 
+    while (i < kSize1 && j < kSize2) {
+        if (pos1[i] == pos2[j]) {
             // Increase number of common kmers found
             if (repetitions) {
-                result += (unsigned)(it1->value < it2->value 
-                                     ? it1->value : it2->value);
+                TCount val1 = counts1[i].value;
+                TCount val2 = counts2[j].value;
+                result += (unsigned)(val1 < val2 ? val1 : val2);
             }
             else {
                 result++;
             }
-            ++it1;
-            ++it2;
+            i++;
+            j++;
         }
-
-        //Finding the next pair of non-zero element in both vect1 and vect2
-
-        while (it1 != vect1.m_Counts.end() && it2 != vect2.m_Counts.end() 
-               && it1->position < it2->position) {
-            ++it1;
+        else if (pos1[i] < pos2[j]) {
+            i++;
         }
-
-        while (it1 != vect1.m_Counts.end() && it2 != vect2.m_Counts.end() 
-               && it2->position < it1->position) {
-            ++it2;
+        else {
+            j++;
         }
-
-
-    } while (it1 != vect1.m_Counts.end() && it2 != vect2.m_Counts.end());
+    }
 
     return result;
 }
@@ -462,15 +544,24 @@ void CSparseKmerCounts::PreCount(void)
         num_bits++;
     }
 
-    sm_Buffer = ReserveCountsMem(num_bits);
+    SKmerCountsBuffer* buffer = new SKmerCountsBuffer;
+    try {
+        buffer->counts = ReserveCountsMem(num_bits, buffer->smaller_mem);
+    }
+    catch (...) {
+        delete buffer;
+        throw;
+    }
+
+    // Replacing the value frees any buffer left by a previous PreCount()
+    s_KmerCountsBuffer.SetValue(buffer, s_FreeKmerCountsBuffer);
 }
 
 void CSparseKmerCounts::PostCount(void)
 {
-    if (sm_Buffer) {
-        delete [] sm_Buffer;
-    }
-    sm_Buffer = NULL;
+    s_KmerCountsBuffer.SetValue(NULL);
+
+    CFastMutexGuard guard(s_ForceSmallerMemMutex);
     sm_ForceSmallerMem = false;
 }
 
@@ -253,6 +253,7 @@ void CMultiAlignerOptions::x_InitParams(TMode mode)
     m_FastAlign = (mode & fFastAlign);
 
     m_Verbose = false;
+    m_NumThreads = 1;
 }
 
 END_SCOPE(cobalt)
@@ -1005,6 +1005,47 @@ BOOST_AUTO_TEST_CASE(TestTwoSequences)
     s_TestResults(*m_Aligner);
 }
 
+// K-mer distances for query clustering may be computed by several threads,
+// query clusters and alignment must be the same as for a single thread
+BOOST_AUTO_TEST_CASE(TestResultsForMultipleThreads)
+{
+    m_Options->SetUseQueryClusters(true);
+    m_Options->SetNumThreads(1);
+    BOOST_REQUIRE(m_Options->Validate());
+
+    CMultiAligner serial(m_Options);
+    serial.SetQueries(m_Sequences, m_Scope);
+    CMultiAligner::TStatus status = serial.Run();
+    BOOST_REQUIRE_EQUAL(status, (CMultiAligner::TStatus)CMultiAligner::eSuccess);
+
+    // serial results are already computed, so the options can be changed
+    m_Options->SetNumThreads(4);
+    BOOST_REQUIRE(m_Options->Validate());
+
+    CMultiAligner threaded(m_Options);
+    threaded.SetQueries(m_Sequences, m_Scope);
+    status = threaded.Run();
+    BOOST_REQUIRE_EQUAL(status, (CMultiAligner::TStatus)CMultiAligner::eSuccess);
+    s_TestResults(threaded);
+
+    // compare query clusters
+    const CClusterer::TClusters& serial_clusters = serial.GetQueryClusters();
+    const CClusterer::TClusters& clusters = threaded.GetQueryClusters();
+    BOOST_REQUIRE(!serial_clusters.empty());
+    BOOST_REQUIRE_EQUAL(clusters.size(), serial_clusters.size());
+    for (size_t i=0;i < clusters.size();i++) {
+        BOOST_CHECK_EQUAL(clusters[i].GetPrototype(),
+                          serial_clusters[i].GetPrototype());
+        BOOST_REQUIRE_EQUAL(clusters[i].size(), serial_clusters[i].size());
+        for (size_t j=0;j < clusters[i].size();j++) {
+            BOOST_CHECK_EQUAL(clusters[i][j], serial_clusters[i][j]);
+        }
+    }
+
+    // compare alignments
+    BOOST_CHECK(threaded.GetResults()->Equals(*serial.GetResults()));
+}
+
 // Test for computing a large alignment for results of BLAST search, good
 // for testing alignments with large query clusters
 BOOST_AUTO_TEST_CASE(TestLargeAlignment)
@@ -35,6 +35,7 @@
 #include <ncbi_pch.hpp>
 
 #include <corelib/ncbi_system.hpp>
+#include <corelib/ncbithr.hpp>
 #include <objmgr/object_manager.hpp>
 #include <objects/seq/Bioseq.hpp>
 #include <objects/seq/Seq_data.hpp>
@@ -189,6 +190,48 @@ BOOST_AUTO_TEST_CASE(TestSparseKmerCounts)
 }
 
 
+// Counts k-mers of given sequences in its own buffer
+class CKmerCountsThread : public CThread
+{
+public:
+    CKmerCountsThread(const vector< CRef<CSeq_loc> >& seqs, CScope& scope)
+        : m_Seqs(seqs), m_Scope(scope)
+    {}
+
+    vector<CSparseKmerCounts> m_Counts;
+
+protected:
+    virtual void* Main(void)
+    {
+        TKmerMethods<CSparseKmerCounts>::ComputeCounts(m_Seqs, m_Scope,
+                                                       m_Counts);
+        return NULL;
+    }
+
+private:
+    const vector< CRef<CSeq_loc> >& m_Seqs;
+    CScope& m_Scope;
+};
+
+
+// Brute force number of common k-mers
+static unsigned int s_CountCommonKmers(const CSparseKmerCounts& v1,
+                                       const CSparseKmerCounts& v2)
+{
+    unsigned int result = 0;
+    for (CSparseKmerCounts::TNonZeroCounts_CI it1 = v1.BeginNonZero();
+         it1 != v1.EndNonZero();++it1) {
+        for (CSparseKmerCounts::TNonZeroCounts_CI it2 = v2.BeginNonZero();
+             it2 != v2.EndNonZero();++it2) {
+            if (it1->position == it2->position) {
+                result += min(it1->value, it2->value);
+            }
+        }
+    }
+    return result;
+}
+
+
 BOOST_AUTO_TEST_CASE(TestKmerMethods)
 {
     typedef TKmerMethods<CSparseKmerCounts> TKMethods;
@@ -211,6 +254,72 @@ BOOST_AUTO_TEST_CASE(TestKmerMethods)
                                                *scope, counts_vect),
                       CKmerCountsException);
 
+    // Distances computed with several threads are the same as computed
+    // with one thread
+    if (seqs.size() > 2) {
+        TKMethods::SetParams(kKmerLen, kAlphabetSize);
+        TKMethods::ComputeCounts(seqs, *scope, counts_vect);
+
+        TKMethods::TDistMatrix dmat_mt;
+        TKMethods::ComputeDistMatrix(counts_vect,
+                                     TKMethods::eFractionCommonKmersGlobal,
+                                     dmat);
+        TKMethods::ComputeDistMatrix(counts_vect,
+                                     TKMethods::eFractionCommonKmersGlobal,
+                                     dmat_mt, 4);
+
+        BOOST_REQUIRE_EQUAL(dmat_mt.GetRows(), dmat.GetRows());
+        for (size_t i=0;i < dmat.GetRows();i++) {
+            for (size_t j=0;j < dmat.GetCols();j++) {
+                BOOST_CHECK_EQUAL(dmat_mt(i, j), dmat(i, j));
+            }
+        }
+
+        // Numbers of common k-mers are the same as found by brute force
+        for (size_t i=0;i < counts_vect.size();i++) {
+            for (size_t j=0;j < counts_vect.size();j++) {
+                BOOST_CHECK_EQUAL(
+                       CSparseKmerCounts::CountCommonKmers(counts_vect[i],
+                                                           counts_vect[j]),
+                       s_CountCommonKmers(counts_vect[i], counts_vect[j]));
+            }
+        }
+
+        // K-mers counted by several threads at the same time are the same
+        // as counted by one thread
+        vector< CRef<CKmerCountsThread> > threads;
+        for (int i=0;i < 4;i++) {
+            threads.push_back(CRef<CKmerCountsThread>(
+                                       new CKmerCountsThread(seqs, *scope)));
+        }
+        NON_CONST_ITERATE (vector< CRef<CKmerCountsThread> >, it, threads) {
+            (*it)->Run();
+        }
+        NON_CONST_ITERATE (vector< CRef<CKmerCountsThread> >, it, threads) {
+            (*it)->Join();
+        }
+        ITERATE (vector< CRef<CKmerCountsThread> >, it, threads) {
+            const vector<CSparseKmerCounts>& counts = (*it)->m_Counts;
+            BOOST_REQUIRE_EQUAL(counts.size(), counts_vect.size());
+            for (size_t i=0;i < counts.size();i++) {
+                BOOST_CHECK_EQUAL(counts[i].GetNumCounts(),
+                                  counts_vect[i].GetNumCounts());
+                BOOST_REQUIRE_EQUAL(counts[i].EndNonZero()
+                                    - counts[i].BeginNonZero(),
+                                    counts_vect[i].EndNonZero()
+                                    - counts_vect[i].BeginNonZero());
+                CSparseKmerCounts::TNonZeroCounts_CI it1
+                    = counts[i].BeginNonZero();
+                CSparseKmerCounts::TNonZeroCounts_CI it2
+                    = counts_vect[i].BeginNonZero();
+                for (;it1 != counts[i].EndNonZero();++it1, ++it2) {
+                    BOOST_CHECK_EQUAL(it1->position, it2->position);
+                    BOOST_CHECK_EQUAL((int)it1->value, (int)it2->value);
+                }
+            }
+        }
+    }
+
     // Distance between a sequence and itself is zero
     seqs.resize(2);
     seqs[1] = seqs[0];
@@ -32,10 +32,104 @@
 
 #include <ncbi_pch.hpp>
 
+#include <corelib/ncbithr.hpp>
+
 #include <algo/dustmask/symdust.hpp>
 
 BEGIN_NCBI_SCOPE
 
+//------------------------------------------------------------------------------
+/** \internal
+    \brief Source of NCBI2NA bases read from a contiguous buffer.
+
+    IUPACNA data is converted to NCBI2NA up front in a branch free loop
+    that the compiler can vectorize. Ambiguous 'N' bases are still
+    resolved by the masker's converter at the time they are read, so
+    that the random values are drawn in the same order as when reading
+    the sequence base by base.
+
+    When reading from a CSeqVector, the data is fetched in chunks of at
+    most CHUNK_SIZE bases. A new chunk starts one DUST window before the
+    requested position, which covers the positions the masker goes back
+    to when it restarts its window, so the chunks are not refetched.
+ */
+class CSymDustMasker::CBufferSource
+{
+    public:
+
+        /**\internal Number of bases fetched at a time from a CSeqVector. */
+        static const size_type CHUNK_SIZE = 1024*1024;
+
+        CBufferSource( const SSeqBuffer & seq, convert_t & converter )
+            : seq_( 0 ), start_( 0 ), stop_( 0 ), overlap_( 0 ),
+              offset_( 0 ), len_( seq.len_ ), converter_( converter )
+        { x_SetData( seq.data_, seq.len_, seq.coding_ ); }
+
+        CBufferSource( const sequence_type & seq, convert_t & converter,
+                       size_type start, size_type stop, size_type overlap )
+            : seq_( &seq ), start_( start ), stop_( stop ), 
+              overlap_( overlap ), offset_( 0 ), len_( 0 ),
+              converter_( converter )
+        { x_Fetch( start ); }
+
+        Uint1 operator()( size_type pos )
+        {
+            if( seq_ != 0 && (pos < offset_ || pos >= offset_ + len_) ) {
+                x_Fetch( pos );
+            }
+
+            pos -= offset_;
+            if( has_n_ && iupac_[pos] == 'N' ) return converter_( 'N' );
+            return data_[pos]&0x3;
+        }
+
+    private:
+
+        void x_SetData( const char * data, size_type len, ECoding coding )
+        {
+            data_ = iupac_ = (const Uint1 *)data;
+            has_n_ = false;
+
+            if( coding == eIupacna ) {
+                codes_.resize( len );
+                Uint1 n_found = 0;
+
+                for( size_type i = 0; i < len; ++i ) {
+                    Uint1 c = data_[i];
+                    Uint1 code = ((c>>1)^(c>>2))&0x3;
+                    Uint1 valid = (c == 'C') | (c == 'G') | (c == 'T');
+                    codes_[i] = code & (Uint1)(0 - valid);
+                    n_found |= (c == 'N');
+                }
+
+                has_n_ = (n_found != 0);
+                if( !codes_.empty() ) data_ = &codes_[0];
+            }
+        }
+
+        void x_Fetch( size_type pos )
+        {
+            offset_ = (pos >= start_ + overlap_) ? pos - overlap_ : start_;
+            size_type end = min( offset_ + CHUNK_SIZE, stop_ + 1 );
+            seq_->GetSeqData( offset_, end, chunk_ );
+            len_ = (size_type)chunk_.size();
+            x_SetData( chunk_.data(), len_, eIupacna );
+        }
+
+        const sequence_type * seq_;
+        size_type start_;
+        size_type stop_;
+        size_type overlap_;
+        std::string chunk_;
+        const Uint1 * data_;
+        const Uint1 * iupac_;
+        size_type offset_;
+        size_type len_;
+        std::vector< Uint1 > codes_;
+        convert_t & converter_;
+        bool has_n_;
+};
+
 //------------------------------------------------------------------------------
 CSymDustMasker::triplets::triplets( 
     size_type window, Uint1 low_k,
@@ -130,12 +224,12 @@ inline void CSymDustMasker::triplets::find_perfect()
     Uint4 max_perfect_score = 0;
     size_type max_len = 0;
     size_type pos = L - 1; // skipping the suffix
-    impl_citer_type it = triplet_list_.begin() + count; // skipping the suffix
-    impl_citer_type iend = triplet_list_.end();
+    Uint4 iend = triplet_list_.size();
 
-    for( ; it != iend; ++it, ++count, --pos ) {
-        Uint1 cnt = counts[*it];
-        add_triplet_info( score, counts, *it );
+    for( ; count != iend; ++count, --pos ) {
+        triplet_type t = triplet_list_[count];
+        Uint1 cnt = counts[t];
+        add_triplet_info( score, counts, t );
 
         if( cnt > 0 && score*10 > thresholds_[count] ) {
             // found the candidate for the perfect interval
@@ -211,58 +305,44 @@ inline void CSymDustMasker::save_masked_regions(
 }
 
 //------------------------------------------------------------------------------
-std::auto_ptr< CSymDustMasker::TMaskList > 
-CSymDustMasker::operator()( const sequence_type & seq, 
-                            size_type start, size_type stop )
+void CSymDustMasker::x_Mask( 
+        CBufferSource & src, size_type start, size_type stop, TMaskList & res )
 {
-    std::auto_ptr< TMaskList > res( new TMaskList );
-
-    if( seq.empty() )
-        return res;
-
-    if( stop >= seq.size() )
-        stop = seq.size() - 1;
-
-    if( start > stop )
-        start = stop;
-
     while( stop > 2 + start )    // there must be at least one triplet
     {
         // initializations
         P.clear();
         triplets w( window_, low_k_, P, thresholds_ );
 
-        seq_citer_type it(seq, start);
-
-        char c1 = *it, c2 = *++it;
-        triplet_type t = (converter_( c1 )<<2) + converter_( c2 );
+        triplet_type t = (src( start )<<2);
+        t += src( start + 1 );
 
-        it.SetPos(start + w.stop() + 2);
+        size_type pos = start + w.stop() + 2;
 
         bool done = false;
-        while( !done && it.GetPos() <= stop )
+        while( !done && pos <= stop )
         {
-            save_masked_regions( *res.get(), w.start(), start );
+            save_masked_regions( res, w.start(), start );
 
             // shift the window
-            t = ((t<<2)&TRIPLET_MASK) + (converter_( *it )&0x3);
-            ++it;
+            t = ((t<<2)&TRIPLET_MASK) + (src( pos )&0x3);
+            ++pos;
 
             if( w.shift_window( t ) ) {
                 if( w.needs_processing() ) {
                     w.find_perfect();
                 }
             }else {
-                while( it.GetPos() <= stop ) {
-                    save_masked_regions( *res.get(), w.start(), start );
-                    t = ((t<<2)&TRIPLET_MASK) + (converter_( *it )&0x3);
+                while( pos <= stop ) {
+                    save_masked_regions( res, w.start(), start );
+                    t = ((t<<2)&TRIPLET_MASK) + (src( pos )&0x3);
 
                     if( w.shift_window( t ) ) {
                         done = true;
                         break;
                     }
 
-                    ++it;
+                    ++pos;
                 }
             }
         }
@@ -272,7 +352,7 @@ CSymDustMasker::operator()( const sequence_type & seq,
             size_type wstart = w.start();
 
             while( !P.empty() ) {
-                save_masked_regions( *res.get(), wstart, start );
+                save_masked_regions( res, wstart, start );
                 ++wstart;
             }
         }
@@ -280,7 +360,28 @@ CSymDustMasker::operator()( const sequence_type & seq,
         if( w.start() > 0 ) start += w.start();
         else break;
     }
+}
+
+//------------------------------------------------------------------------------
+std::auto_ptr< CSymDustMasker::TMaskList > 
+CSymDustMasker::operator()( const sequence_type & seq, 
+                            size_type start, size_type stop )
+{
+    std::auto_ptr< TMaskList > res( new TMaskList );
+
+    if( seq.empty() )
+        return res;
 
+    if( stop >= seq.size() )
+        stop = seq.size() - 1;
+
+    if( start > stop )
+        start = stop;
+
+    // fetch the data in bulk, a chunk at a time, and run the buffer 
+    // based algorithm on it
+    CBufferSource src( seq, converter_, start, stop, window_ );
+    x_Mask( src, start, stop, *res.get() );
     return res;
 }
 
@@ -289,6 +390,112 @@ std::auto_ptr< CSymDustMasker::TMaskList >
 CSymDustMasker::operator()( const sequence_type & seq )
 { return (*this)( seq, 0, seq.size() - 1 ); }
 
+//------------------------------------------------------------------------------
+std::auto_ptr< CSymDustMasker::TMaskList > 
+CSymDustMasker::operator()( const SSeqBuffer & seq, 
+                            size_type start, size_type stop )
+{
+    std::auto_ptr< TMaskList > res( new TMaskList );
+
+    if( seq.len_ == 0 )
+        return res;
+
+    if( stop >= seq.len_ )
+        stop = seq.len_ - 1;
+
+    if( start > stop )
+        start = stop;
+
+    CBufferSource src( seq, converter_ );
+    x_Mask( src, start, stop, *res.get() );
+    return res;
+}
+
+//------------------------------------------------------------------------------
+std::auto_ptr< CSymDustMasker::TMaskList > 
+CSymDustMasker::operator()( const SSeqBuffer & seq )
+{ return (*this)( seq, 0, seq.len_ - 1 ); }
+
+//------------------------------------------------------------------------------
+/** \internal
+    \brief Worker thread masking sequences from a shared batch.
+ */
+class CSymDustMaskThread : public CThread
+{
+    public:
+
+        typedef CSymDustMasker::SSeqBuffer TSeqBuffer;
+        typedef CSymDustMasker::TMaskList TMaskList;
+        typedef CSymDustMasker::size_type size_type;
+
+        CSymDustMaskThread( 
+                Uint4 level, size_type window, size_type linker,
+                const std::vector< TSeqBuffer > & seqs,
+                std::vector< TMaskList > & res,
+                size_t & next, CFastMutex & mtx )
+            : level_( level ), window_( window ), linker_( linker ),
+              seqs_( seqs ), res_( res ), next_( next ), mtx_( mtx )
+        {}
+
+    protected:
+
+        virtual void * Main( void )
+        {
+            while( true ) {
+                size_t i;
+
+                {
+                    CFastMutexGuard guard( mtx_ );
+                    if( next_ >= seqs_.size() ) break;
+                    i = next_++;
+                }
+
+                CSymDustMasker masker( level_, window_, linker_ );
+                std::auto_ptr< TMaskList > r( masker( seqs_[i] ) );
+                res_[i].swap( *r );
+            }
+
+            return 0;
+        }
+
+    private:
+
+        Uint4 level_;
+        size_type window_;
+        size_type linker_;
+        const std::vector< TSeqBuffer > & seqs_;
+        std::vector< TMaskList > & res_;
+        size_t & next_;
+        CFastMutex & mtx_;
+};
+
+//------------------------------------------------------------------------------
+void CSymDustMasker::MaskBuffers( 
+        const std::vector< SSeqBuffer > & seqs,
+        std::vector< TMaskList > & res, unsigned int num_threads )
+{
+    res.clear();
+    res.resize( seqs.size() );
+
+    if( num_threads > seqs.size() ) num_threads = (unsigned int)seqs.size();
+    if( num_threads == 0 ) return;
+
+    size_t next = 0;
+    CFastMutex mtx;
+    std::vector< CRef< CSymDustMaskThread > > threads;
+
+    for( unsigned int i = 0; i < num_threads; ++i ) {
+        threads.push_back( CRef< CSymDustMaskThread >( 
+                    new CSymDustMaskThread( 
+                        level_, window_, linker_, seqs, res, next, mtx ) ) );
+        threads.back()->Run();
+    }
+
+    for( unsigned int i = 0; i < num_threads; ++i ) {
+        threads[i]->Join();
+    }
+}
+
 //------------------------------------------------------------------------------
 void CSymDustMasker::GetMaskedLocs( 
     objects::CSeq_id & seq_id,
@@ -0,0 +1,129 @@
+/*  $Id$
+ * ===========================================================================
+ *
+ *                            PUBLIC DOMAIN NOTICE
+ *               National Center for Biotechnology Information
+ *
+ *  This software/database is a "United States Government Work" under the
+ *  terms of the United States Copyright Act.  It was written as part of
+ *  the author's official duties as a United States Government employee and
+ *  thus cannot be copyrighted.  This software/database is freely available
+ *  to the public for use. The National Library of Medicine and the U.S.
+ *  Government have not placed any restriction on its use or reproduction.
+ *
+ *  Although all reasonable efforts have been taken to ensure the accuracy
+ *  and reliability of the software and data, the NLM and the U.S.
+ *  Government do not and cannot warrant the performance or results that
+ *  may be obtained by using this software or data. The NLM and the U.S.
+ *  Government disclaim all warranties, express or implied, including
+ *  warranties of performance, merchantability or fitness for any particular
+ *  purpose.
+ *
+ *  Please cite the author in any work or product based on this material.
+ *
+ * ===========================================================================
+ *
+ * File Description:
+ *   WindowMasker unit test: unit counts generated with several threads
+ *   must be identical to the ones generated with one thread
+ *
+ * ===========================================================================
+ */
+
+#include <ncbi_pch.hpp>
+
+#include <corelib/test_boost.hpp>
+#include <corelib/ncbifile.hpp>
+
+#include <algo/winmask/win_mask_gen_counts.hpp>
+
+#include <util/random_gen.hpp>
+
+USING_NCBI_SCOPE;
+
+/// Write a random genome to a FASTA file.
+///
+/// One sequence is longer than the 1M base pieces the counts generator
+/// reads, so n-mers spanning a piece boundary are counted. The sequences
+/// contain lower case letters and runs of ambiguous bases.
+static void s_WriteGenome(const string& fname)
+{
+    CRandom rnd(20201017);
+    const TSeqPos lengths[] = { 1100000, 70000, 25, 9, 130000 };
+    CNcbiOfstream out(fname.c_str());
+
+    for (size_t i = 0;  i < sizeof(lengths) / sizeof(lengths[0]);  ++i) {
+        out << ">lcl|seq" << i << "\n";
+        string seq;
+        seq.reserve(lengths[i]);
+        while (seq.size() < lengths[i]) {
+            CRandom::TValue r = rnd.GetRand(0, 999);
+            if (r == 0) {
+                seq.append(rnd.GetRand(1, 50), 'N');
+            } else if (r < 100) {
+                // Repeat a recent stretch, so some n-mers are frequent
+                size_t len = min<size_t>(seq.size(), rnd.GetRand(20, 300));
+                seq.append(seq, seq.size() - len, len);
+            } else {
+                seq += "ACGTacgt"[r % 8];
+            }
+        }
+        seq.resize(lengths[i]);
+        for (size_t pos = 0;  pos < seq.size();  pos += 70) {
+            out << seq.substr(pos, 70) << "\n";
+        }
+    }
+}
+
+static string s_ReadFile(const string& fname)
+{
+    CNcbiIfstream in(fname.c_str(), IOS_BASE::binary);
+    CNcbiOstrstream data;
+    data << in.rdbuf();
+    return CNcbiOstrstreamToString(data);
+}
+
+/// Generate the unit counts of a FASTA file into a string.
+static string s_MakeCounts(const string& input, const string& sformat,
+                           Uint4 num_threads)
+{
+    string output = CDirEntry::GetTmpName();
+    {{
+        // With 1 MB of memory and 10-mers there are four subpasses per
+        // pass, and t_low and t_high are deduced in an extra pass.
+        CWinMaskCountsGenerator gen(input, output, "fasta", sformat,
+                                    "90,99,99.5,99.8", 1, 10, 0, 0, 0,
+                                    false, false, NULL, NULL, false, "",
+                                    num_threads);
+        gen();
+    }}
+    string counts = s_ReadFile(output);
+    CFile(output).Remove();
+    return counts;
+}
+
+BOOST_AUTO_TEST_SUITE(winmask)
+
+BOOST_AUTO_TEST_CASE(CountsIndependentOfThreads)
+{
+    string input = CDirEntry::GetTmpName();
+    s_WriteGenome(input);
+
+    const char* formats[] = { "ascii", "obinary" };
+    for (size_t f = 0;  f < sizeof(formats) / sizeof(formats[0]);  ++f) {
+        string serial = s_MakeCounts(input, formats[f], 1);
+        BOOST_REQUIRE(!serial.empty());
+
+        const Uint4 threads[] = { 2, 4, 7 };
+        for (size_t t = 0;  t < sizeof(threads) / sizeof(threads[0]);  ++t) {
+            string parallel = s_MakeCounts(input, formats[f], threads[t]);
+            BOOST_CHECK_MESSAGE(parallel == serial,
+                                formats[f] << " counts with " << threads[t]
+                                << " threads differ from 1 thread");
+        }
+    }
+
+    CFile(input).Remove();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
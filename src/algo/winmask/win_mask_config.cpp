@@ -92,7 +92,12 @@ void CWinMaskConfig::AddWinMaskArgs(CArgDescriptions &arg_desc,
         arg_desc.AddOptionalKey( "genome_size", "genome_size",
                                   "total size of the genome",
                                   CArgDescriptions::eInteger );
+        arg_desc.AddDefaultKey( "num_threads", "number",
+                                 "number of threads to use for mk_counts option",
+                                 CArgDescriptions::eInteger, "1" );
         arg_desc.SetConstraint( "mem", new CArgAllow_Integers( 1, kMax_Int ) );
+        arg_desc.SetConstraint( "num_threads", 
+                                new CArgAllow_Integers( 1, kMax_Int ) );
         arg_desc.SetConstraint( "unit", new CArgAllow_Integers( 1, 16 ) );
     }
     if(type == eAny || type >= eGenerateMasks){
@@ -204,6 +209,7 @@ void CWinMaskConfig::AddWinMaskArgs(CArgDescriptions &arg_desc,
         if(determine_input)
             arg_desc.CArgDescriptions::SetDependency( "ustat", CArgDescriptions::eExcludes, "fa_list" );
         arg_desc.CArgDescriptions::SetDependency( "ustat", CArgDescriptions::eExcludes, "mem" );
+        arg_desc.CArgDescriptions::SetDependency( "ustat", CArgDescriptions::eExcludes, "num_threads" );
         arg_desc.CArgDescriptions::SetDependency( "ustat", CArgDescriptions::eExcludes, "unit" );
         arg_desc.CArgDescriptions::SetDependency( "ustat", CArgDescriptions::eExcludes, "genome_size" );
         arg_desc.CArgDescriptions::SetDependency( "ustat", CArgDescriptions::eExcludes, "sformat" );
@@ -224,6 +230,7 @@ void CWinMaskConfig::AddWinMaskArgs(CArgDescriptions &arg_desc,
         if(determine_input)
             arg_desc.CArgDescriptions::SetDependency( "convert", CArgDescriptions::eExcludes, "fa_list" );
         arg_desc.CArgDescriptions::SetDependency( "convert", CArgDescriptions::eExcludes, "mem" );
+        arg_desc.CArgDescriptions::SetDependency( "convert", CArgDescriptions::eExcludes, "num_threads" );
         arg_desc.CArgDescriptions::SetDependency( "convert", CArgDescriptions::eExcludes, "unit" );
         arg_desc.CArgDescriptions::SetDependency( "convert", CArgDescriptions::eExcludes, "genome_size" );
         arg_desc.CArgDescriptions::SetDependency( "convert", CArgDescriptions::eExcludes, "dust" );
@@ -321,6 +328,7 @@ CWinMaskConfig::CWinMaskConfig( const CArgs & args, EAppType type, bool determin
       merge_unit_step( 1 ),
       fa_list( app_type == eComputeCounts && determine_input ? args["fa_list"].AsBoolean() : false ),
       mem( app_type == eComputeCounts ? args["mem"].AsInteger() : 0 ),
+      num_threads( app_type == eComputeCounts ? args["num_threads"].AsInteger() : 1 ),
       unit_size( app_type == eComputeCounts && args["unit"] ? args["unit"].AsInteger() : 0 ),
       genome_size( app_type == eComputeCounts && args["genome_size"] ? args["genome_size"].AsInt8() : 0 ),
       input( determine_input ? args[kInput].AsString() : ""),
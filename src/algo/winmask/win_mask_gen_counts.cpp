@@ -48,6 +48,8 @@
 #include <objmgr/bioseq_ci.hpp>
 #include <objmgr/seq_vector.hpp>
 
+#include <corelib/ncbithr.hpp>
+
 #include <algo/winmask/seq_masker_util.hpp>
 
 #include <algo/winmask/win_mask_gen_counts.hpp>
@@ -120,6 +122,230 @@ Uint8 CWinMaskCountsGenerator::fastalen( const string & fname ) const
 static Uint4 reverse_complement( Uint4 seq, Uint1 size )
 { return CSeqMaskerUtil::reverse_complement( seq, size ); }
 
+//------------------------------------------------------------------------------
+/// Max number of bases read from the input between counting rounds.
+static const TSeqPos kChunkSize = 16*1024*1024;
+
+/// Max number of bases in a single piece of a sequence.
+static const TSeqPos kPieceSize = 1024*1024;
+
+/// Sequence pieces of the current input chunk.
+typedef vector< string > TPieces;
+
+/// Suffixes of the n-mers of the current prefix, indexed by piece of the 
+/// input chunk and by slice of the counts table.
+typedef vector< vector< vector< Uint4 > > > TUnits;
+
+//------------------------------------------------------------------------------
+/// Select the n-mers of a sequence piece that start with the given prefix.
+///
+/// The canonical value of an n-mer is the smaller of the n-mer value and 
+/// the value of its reverse complement. Palindromic n-mers are stored 
+/// twice, as they are counted once for each strand. The suffixes of the 
+/// selected canonical values are distributed between the slices of the 
+/// counts table, each slice covering slice_size consecutive suffixes.
+///
+/// @param data the sequence piece in iupacna encoding
+/// @param unit_size the n-mer length
+/// @param prefix the prefix shifted to its position in the n-mer
+/// @param prefix_mask mask selecting the prefix bits of the n-mer
+/// @param suffix_mask mask selecting the suffix bits of the n-mer
+/// @param slice_size number of suffixes in each slice of the counts table
+/// @param units [out] suffixes of the selected n-mers, one list per slice
+///
+static void encode_units( 
+        const string & data, Uint1 unit_size, 
+        Uint4 prefix, Uint4 prefix_mask, Uint4 suffix_mask, 
+        Uint8 slice_size, vector< vector< Uint4 > > & units )
+{
+    Uint4 unit_mask( (unit_size == 16) ? 0xFFFFFFFF 
+                                       : (1<<(2*unit_size)) - 1 );
+    Uint4 shift( 2*(unit_size - 1) );
+    Uint4 count( 0 ), unit( 0 ), runit( 0 );
+
+    for( size_t i( 0 ); i < units.size(); ++i ) {
+        units[i].clear();
+    }
+
+    for( string::const_iterator i( data.begin() ); i != data.end(); ++i ) {
+        if( ambig( *i ) ) {
+            count = 0;
+            unit = runit = 0;
+            continue;
+        }
+
+        Uint4 l( letter( *i ) );
+        unit = ((unit<<2)&unit_mask) + l;
+        runit = (runit>>2) + ((3 - l)<<shift);
+
+        if( count >= unit_size - 1u ) {
+            Uint4 u( unit < runit ? unit : runit );
+
+            if( (u&prefix_mask) == prefix ) {
+                u &= suffix_mask;
+                vector< Uint4 > & slice( units[u/slice_size] );
+                slice.push_back( u );
+                if( unit == runit ) slice.push_back( u );
+            }
+        }
+
+        ++count;
+    }
+}
+
+//------------------------------------------------------------------------------
+/// Add the n-mers of one slice of the counts table.
+///
+/// @param units suffixes of the n-mers of the input chunk
+/// @param slice the index of the slice
+/// @param counts [in/out] counts table indexed by suffix
+///
+static void count_units( const TUnits & units, size_t slice, 
+                         vector< Uint4 > & counts )
+{
+    for( TUnits::const_iterator i( units.begin() ); i != units.end(); ++i ) {
+        const vector< Uint4 > & s( (*i)[slice] );
+
+        for( vector< Uint4 >::const_iterator j( s.begin() ); 
+                j != s.end(); ++j ) {
+            auto & c( counts[*j] );
+
+            if( c < 0xffffffffUL )
+            {
+                ++c;
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+/// Thread encoding a subset of the pieces of the input chunk.
+class CEncodeThread : public CThread
+{
+public:
+
+    CEncodeThread( const TPieces & pieces, TUnits & units, Uint1 unit_size,
+                   Uint4 prefix, Uint4 prefix_mask, Uint4 suffix_mask,
+                   Uint8 slice_size, size_t start, size_t step )
+        : pieces_( pieces ), units_( units ), unit_size_( unit_size ),
+          prefix_( prefix ), prefix_mask_( prefix_mask ), 
+          suffix_mask_( suffix_mask ), slice_size_( slice_size ),
+          start_( start ), step_( step )
+    {}
+
+protected:
+
+    virtual void * Main()
+    {
+        for( size_t i( start_ ); i < pieces_.size(); i += step_ ) {
+            encode_units( pieces_[i], unit_size_, prefix_, prefix_mask_,
+                          suffix_mask_, slice_size_, units_[i] );
+        }
+
+        return 0;
+    }
+
+private:
+
+    const TPieces & pieces_;
+    TUnits & units_;
+    Uint1 unit_size_;
+    Uint4 prefix_;
+    Uint4 prefix_mask_;
+    Uint4 suffix_mask_;
+    Uint8 slice_size_;
+    size_t start_;
+    size_t step_;
+};
+
+//------------------------------------------------------------------------------
+/// Thread counting the n-mers of one slice of the counts table.
+class CCountThread : public CThread
+{
+public:
+
+    CCountThread( const TUnits & units, size_t slice, 
+                  vector< Uint4 > & counts )
+        : units_( units ), slice_( slice ), counts_( counts )
+    {}
+
+protected:
+
+    virtual void * Main()
+    {
+        count_units( units_, slice_, counts_ );
+        return 0;
+    }
+
+private:
+
+    const TUnits & units_;
+    size_t slice_;
+    vector< Uint4 > & counts_;
+};
+
+//------------------------------------------------------------------------------
+/// Encode the current input chunk and add the n-mers with the given prefix
+/// to the counts table.
+///
+/// The pieces of the chunk are encoded in parallel. The counts table is 
+/// split into one slice per thread, and each thread then counts the 
+/// n-mers of its own slice, so no two threads update the same counter.
+///
+/// @param pieces the sequence pieces of the input chunk
+/// @param unit_size the n-mer length
+/// @param prefix the prefix shifted to its position in the n-mer
+/// @param prefix_mask mask selecting the prefix bits of the n-mer
+/// @param suffix_mask mask selecting the suffix bits of the n-mer
+/// @param num_threads the number of threads
+/// @param units [in/out] scratch space for the encoded pieces
+/// @param counts [in/out] counts table indexed by suffix
+///
+static void count_chunk( const TPieces & pieces, Uint1 unit_size,
+                         Uint4 prefix, Uint4 prefix_mask, Uint4 suffix_mask,
+                         Uint4 num_threads, TUnits & units,
+                         vector< Uint4 > & counts )
+{
+    Uint8 slice_size( (counts.size() + num_threads - 1)/num_threads );
+
+    units.resize( pieces.size(), vector< vector< Uint4 > >( num_threads ) );
+
+    if( num_threads == 1 ) {
+        for( size_t i( 0 ); i < pieces.size(); ++i ) {
+            encode_units( pieces[i], unit_size, prefix, prefix_mask, 
+                          suffix_mask, slice_size, units[i] );
+        }
+
+        count_units( units, 0, counts );
+        return;
+    }
+
+    {
+        vector< CRef< CEncodeThread > > threads;
+
+        for( size_t i( 0 ); i < num_threads; ++i ) {
+            threads.push_back( CRef< CEncodeThread >( new CEncodeThread( 
+                            pieces, units, unit_size, prefix, prefix_mask, 
+                            suffix_mask, slice_size, i, num_threads ) ) );
+            threads.back()->Run();
+        }
+
+        for( size_t i( 0 ); i < num_threads; ++i ) threads[i]->Join();
+    }
+
+    {
+        vector< CRef< CCountThread > > threads;
+
+        for( size_t i( 0 ); i < num_threads; ++i ) {
+            threads.push_back( CRef< CCountThread >( 
+                        new CCountThread( units, i, counts ) ) );
+            threads.back()->Run();
+        }
+
+        for( size_t i( 0 ); i < num_threads; ++i ) threads[i]->Join();
+    }
+}
+
 //------------------------------------------------------------------------------
 CWinMaskCountsGenerator::CWinMaskCountsGenerator( 
     const string & arg_input,
@@ -136,7 +362,7 @@ CWinMaskCountsGenerator::CWinMaskCountsGenerator(
     bool arg_use_list,
     const CWinMaskUtil::CIdSet * arg_ids,
     const CWinMaskUtil::CIdSet * arg_exclude_ids,
-    bool use_ba, string const & metadata )
+    bool use_ba, string const & metadata, Uint4 arg_num_threads )
 :   input( arg_input ),
     ustat( CSeqMaskerOstatFactory::create( 
                 sformat, os, use_ba, metadata ) ),
@@ -152,7 +378,8 @@ CWinMaskCountsGenerator::CWinMaskCountsGenerator(
     total_ecodes( 0 ), 
     score_counts( max_count, 0 ),
     ids( arg_ids ), exclude_ids( arg_exclude_ids ),
-    infmt( infmt_arg )
+    infmt( infmt_arg ),
+    num_threads( arg_num_threads == 0 ? 1 : arg_num_threads )
 {
     // Parse arg_th to set up th[].
     string::size_type pos( 0 );
@@ -182,7 +409,7 @@ CWinMaskCountsGenerator::CWinMaskCountsGenerator(
     bool arg_use_list,
     const CWinMaskUtil::CIdSet * arg_ids,
     const CWinMaskUtil::CIdSet * arg_exclude_ids,
-    bool use_ba, string const & metadata )
+    bool use_ba, string const & metadata, Uint4 arg_num_threads )
 :   input( arg_input ),
     ustat( CSeqMaskerOstatFactory::create( 
                 sformat, output, use_ba, metadata ) ),
@@ -198,7 +425,8 @@ CWinMaskCountsGenerator::CWinMaskCountsGenerator(
     total_ecodes( 0 ), 
     score_counts( max_count, 0 ),
     ids( arg_ids ), exclude_ids( arg_exclude_ids ),
-    infmt( infmt_arg )
+    infmt( infmt_arg ),
+    num_threads( arg_num_threads == 0 ? 1 : arg_num_threads )
 {
     // Parse arg_th to set up th[].
     string::size_type pos( 0 );
@@ -272,7 +500,8 @@ void CWinMaskCountsGenerator::operator()()
 
     // Estimate the length of the prefix. 
     // Prefix length is unit_size - suffix length, where suffix length
-    // is max N: (4**N) < max_mem.
+    // is max N: 4**N < max_mem. The counts table of a prefix is shared
+    // by all threads, so the split does not depend on num_threads.
     Uint1 prefix_size( 0 ), suffix_size( unit_size );
     Uint8 n_units( max_mem/sizeof( Uint4 ) );
 
@@ -403,10 +632,8 @@ void CWinMaskCountsGenerator::process( Uint4 prefix,
     Uint1 suffix_size( unit_size - prefix_size );
     Uint8 vector_size( 1ULL<<(2*suffix_size) );
     vector< Uint4 > counts( vector_size, 0 );
-    Uint4 unit_mask( (1<<(2*unit_size)) - 1 );
     Uint4 prefix_mask( ((1<<(2*prefix_size)) - 1)<<(2*suffix_size) );
     Uint4 suffix_mask( (1<<2*suffix_size) - 1 );
-    if( unit_size == 16 ) unit_mask = 0xFFFFFFFF;
 
     if( suffix_size == 16 )
     {
@@ -418,23 +645,19 @@ void CWinMaskCountsGenerator::process( Uint4 prefix,
             "\nprefix_size: " << (int)prefix_size <<
             "\nsuffix_size: " << (int)suffix_size <<
             "\nvector_size: " << vector_size <<
-            "\nunit_mask: " << unit_mask <<
             "\nprefix_mask: " << prefix_mask <<
             "\nsufffix_mask: " << suffix_mask );
 
-    /*
-    std::cerr << "prefix: " << prefix <<
-            "\nprefix_size: " << (int)prefix_size <<
-            "\nsuffix_size: " << (int)suffix_size <<
-            "\nvector_size: " << vector_size <<
-            "\nunit_mask: " << unit_mask <<
-            "\nprefix_mask: " << prefix_mask <<
-            "\nsufffix_mask: " << suffix_mask << std::endl;
-    */
-
     prefix <<= (2*suffix_size);
     CRef<CObjectManager> om(CObjectManager::GetInstance());
 
+    // Read the input in chunks of at most kChunkSize bases. Sequences are
+    // split into overlapping pieces, so that every n-mer is contained in 
+    // exactly one piece. Each chunk is read once and counted by all threads.
+    TPieces pieces;
+    TUnits units;
+    TSeqPos chunk_len( 0 );
+
     for( vector< string >::const_iterator it( input_list.begin() );
          it != input_list.end(); ++it )
     {
@@ -451,69 +674,41 @@ void CWinMaskCountsGenerator::process( Uint4 prefix,
                     continue;
 
                 TSeqPos length( data.size() );
-                Uint4 count( 0 );
-                Uint4 unit( 0 );
-
-                for( Uint4 i( 0 ); i < length; ++i ) {
-                    if( ambig( data[i] ) )
-                    {
-                        count = 0;
-                        unit = 0;
-                        continue;
-                    }
-                    else
-                    {
-                        unit = ((unit<<2)&unit_mask) + letter( data[i] );
-
-                        if( count >= unit_size - 1 )
-                        {
-                            Uint4 runit( reverse_complement( unit, unit_size ) );
-
-                            if( unit <= runit && (unit&prefix_mask) == prefix )
-                            {
-                                auto & c( counts[unit&suffix_mask] );
-
-                                if( c < 0xffffffffUL )
-                                {
-                                    ++c;
-                                }
-                                // ++counts[unit&suffix_mask];
-                            }
-
-                            if( runit <= unit && (runit&prefix_mask) == prefix )
-                            {
-                                auto & c( counts[runit&suffix_mask] );
-
-                                if( c < 0xffffffffUL )
-                                {
-                                    ++c;
-                                }
-                                // ++counts[runit&suffix_mask];
-                            }
-                        }
-
-                        ++count;
+
+                for( TSeqPos start( 0 ); ; 
+                     start += kPieceSize - (unit_size - 1) ) {
+                    TSeqPos stop( min( length, start + kPieceSize ) );
+                    pieces.push_back( string() );
+                    data.GetSeqData( start, stop, pieces.back() );
+                    chunk_len += stop - start;
+
+                    if( chunk_len >= kChunkSize ) {
+                        count_chunk( pieces, unit_size, prefix, prefix_mask, 
+                                     suffix_mask, num_threads, units, counts );
+                        pieces.clear();
+                        chunk_len = 0;
                     }
+
+                    if( stop == length ) break;
                 }
             }
         }
     }
 
-    /*
-    {
-        std::ofstream ofs( "./counts.txt" );
-
-        for( Uint8 i( 0 ); i < vector_size; ++i )
-        {
-            Uint4 u( prefix + i ), ru( 0 );
-            ofs << u << ' ' << counts[i] << '\n';
-        }
-
-        ofs << std::flush;
+    if( !pieces.empty() ) {
+        count_chunk( pieces, unit_size, prefix, prefix_mask, 
+                     suffix_mask, num_threads, units, counts );
     }
-    */
 
-    for( Uint8 i( 0 ); i < vector_size; ++i )
+    save_counts( prefix, counts, do_output );
+}
+
+//------------------------------------------------------------------------------
+void CWinMaskCountsGenerator::save_counts( Uint4 prefix,
+                                           const vector< Uint4 > & counts,
+                                           bool do_output )
+{
+    for( Uint8 i( 0 ); i < counts.size(); ++i )
     {
         Uint4 u( prefix + i ), ru( 0 );
 
@@ -983,4 +983,33 @@ void QueryBatchCleanup()
 
 }
 
+void CBlastFormatterSink::Put(CRef<CSearchResults> results)
+{
+    if (results->HasAlignments()) {
+        m_PendingAligns += results->GetSeqAlign()->Size();
+    }
+    m_Pending.push_back(results);
+    if (m_PendingAligns >= kPrefetchAligns) {
+        x_Flush();
+    }
+}
+
+void CBlastFormatterSink::Finish()
+{
+    x_Flush();
+}
+
+void CBlastFormatterSink::x_Flush()
+{
+    if (m_Pending.empty()) {
+        return;
+    }
+    BlastFormatter_PreFetchSequenceData(m_Pending, m_Scope, m_FormatType);
+    ITERATE(CSearchResultSet, result, m_Pending) {
+        m_Formatter.PrintOneResultSet(**result, m_Queries);
+    }
+    m_Pending.clear();
+    m_PendingAligns = 0;
+}
+
 END_NCBI_SCOPE
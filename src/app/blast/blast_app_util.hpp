@@ -41,6 +41,7 @@
 
 #include <objects/blast/Blast4_request.hpp>
 #include <algo/blast/api/uniform_search.hpp>
+#include <algo/blast/api/sseqloc.hpp>
 #include <algo/blast/api/remote_blast.hpp>
 #include <algo/blast/api/local_db_adapter.hpp>
 #include <algo/blast/dbindex/dbindex.hpp>           // for CDbIndex_Exception
@@ -333,6 +334,51 @@ void PrintErrorArchive(const CArgs & a, const list<CRef<CBlast4_error> > & msg);
 /// Clean up formatter scope and release
 void QueryBatchCleanup();
 
+class CBlastFormat;
+
+/// Formats the results of the queries as the local search hands them over,
+/// so that output starts before the whole batch has been converted and the
+/// results of a query are released once they have been printed. The
+/// sequences aligned to several queries are prefetched in one go: results
+/// are held until they have kPrefetchAligns alignments (or until Finish).
+class CBlastFormatterSink : public blast::ISearchResultsSink
+{
+public:
+    /// Constructor
+    /// @param formatter formatter to print the results with [in]
+    /// @param scope scope to fetch the aligned sequences into [in]
+    /// @param queries queries of the current batch [in]
+    /// @param format_type output format requested [in]
+    CBlastFormatterSink(CBlastFormat& formatter,
+                        CRef<CScope> scope,
+                        CConstRef<blast::CBlastQueryVector> queries,
+                        blast::CFormattingArgs::EOutputFormat format_type)
+        : m_Formatter(formatter), m_Scope(scope), m_Queries(queries),
+          m_FormatType(format_type), m_PendingAligns(0) {}
+
+    /** @inheritDoc */
+    virtual void Put(CRef<blast::CSearchResults> results);
+
+    /** @inheritDoc */
+    virtual void Finish();
+
+    /// Number of alignments whose subject sequences are prefetched together
+    static const size_t kPrefetchAligns = 5000;
+
+private:
+    /// Prefetches the sequences of the pending results and prints them
+    void x_Flush();
+
+    CBlastFormat& m_Formatter;
+    CRef<CScope> m_Scope;
+    CConstRef<blast::CBlastQueryVector> m_Queries;
+    blast::CFormattingArgs::EOutputFormat m_FormatType;
+    /// Results put but not printed yet
+    blast::CSearchResultSet m_Pending;
+    /// Number of alignments in m_Pending
+    size_t m_PendingAligns;
+};
+
 END_NCBI_SCOPE
 
 #endif /* APP__BLAST_APP_UTIL__HPP */
@@ -110,6 +110,14 @@ void CBlastFormatterApp::Init()
     arg_desc->AddOptionalKey(kArgArchive, "ArchiveFile", "File containing BLAST Archive format in ASN.1 (i.e.: output format 11)", 
                      CArgDescriptions::eInputFile);
     arg_desc->SetDependency(kArgRid, CArgDescriptions::eExcludes, kArgArchive);
+    arg_desc->AddOptionalKey(kArgColumnarInput, "ColumnarFile",
+                     "File containing binary columnar tabular output "
+                     "(i.e.: output format 20) to convert to output format 6",
+                     CArgDescriptions::eInputFile, CArgDescriptions::fBinary);
+    arg_desc->SetDependency(kArgColumnarInput, CArgDescriptions::eExcludes,
+                            kArgRid);
+    arg_desc->SetDependency(kArgColumnarInput, CArgDescriptions::eExcludes,
+                            kArgArchive);
 
     CFormattingArgs fmt_args(false, CFormattingArgs::eIsSAM);
     fmt_args.SetArgumentDescriptions(*arg_desc);
@@ -243,12 +251,14 @@ int CBlastFormatterApp::PrintFormattedOutput(void)
     const CArgs& args = GetArgs();
     const string& kRid = args[kArgRid].HasValue() 
         ? args[kArgRid].AsString() : kEmptyStr;
-    CNcbiOstream& out = args[kArgOutput].AsOutputFile();
     CFormattingArgs fmt_args(false, CFormattingArgs::eIsSAM) ;
 
     CRef<CBlastOptionsHandle> opts_handle = m_RmtBlast->GetSearchOptions();
     CBlastOptions& opts = opts_handle->SetOptions();
     fmt_args.ExtractAlgorithmOptions(args, opts);
+    CNcbiOstream& out = args[kArgOutput].AsOutputFile(
+        fmt_args.GetFormattedOutputChoice() == CFormattingArgs::eColumnarTabular
+        ? CArgValue::fBinary : 0);
     {{
         CDebugArgs debug_args;
         debug_args.ExtractAlgorithmOptions(args, opts);
@@ -414,6 +424,12 @@ int CBlastFormatterApp::Run(void)
 
     try {
         SetDiagPostLevel(eDiag_Warning);
+        if (args[kArgColumnarInput].HasValue()) {
+            CBlastColumnarTabularReader
+                reader(args[kArgColumnarInput].AsString());
+            reader.PrintTabular(args[kArgOutput].AsOutputFile());
+            return status;
+        }
         if (args[kArgArchive].HasValue()) {
             CNcbiIstream& istr = args[kArgArchive].AsInputFile();
             try { m_RmtBlast.Reset(new CRemoteBlast(istr)); }
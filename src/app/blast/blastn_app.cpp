@@ -200,7 +200,13 @@ int CBlastnApp::Run(void)
             } else {
                 CLocalBlast lcl_blast(queries, opts_hndl, db_adapter);
                 lcl_blast.SetNumberOfThreads(m_CmdLineArgs->GetNumThreads());
-                results = lcl_blast.Run();
+                if (isArchiveFormat) {
+                    results = lcl_blast.Run();
+                } else {
+                    CBlastFormatterSink sink(formatter, scope, query_batch,
+                                    fmt_args->GetFormattedOutputChoice());
+                    lcl_blast.Run(sink);
+                }
                 if (!batch_size) 
                     input.SetBatchSize(mixer.GetBatchSize(lcl_blast.GetNumExtensions()));
             }
@@ -208,7 +214,7 @@ int CBlastnApp::Run(void)
             if (isArchiveFormat) {
                 formatter.WriteArchive(*queries, *opts_hndl, *results, 0, bah.GetMessages());
                 bah.ResetMessages();
-            } else {
+            } else if (results.NotEmpty()) {
                 BlastFormatter_PreFetchSequenceData(*results, scope,
                 			                        fmt_args->GetFormattedOutputChoice());
                 ITERATE(CSearchResultSet, result, *results) {
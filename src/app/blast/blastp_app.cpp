@@ -181,13 +181,19 @@ int CBlastpApp::Run(void)
             } else {
                 CLocalBlast lcl_blast(queries, opts_hndl, db_adapter);
                 lcl_blast.SetNumberOfThreads(m_CmdLineArgs->GetNumThreads());
-                results = lcl_blast.Run();
+                if (fmt_args->ArchiveFormatRequested(args)) {
+                    results = lcl_blast.Run();
+                } else {
+                    CBlastFormatterSink sink(formatter, scope, query_batch,
+                                    fmt_args->GetFormattedOutputChoice());
+                    lcl_blast.Run(sink);
+                }
             }
 
             if (fmt_args->ArchiveFormatRequested(args)) {
                 formatter.WriteArchive(*queries, *opts_hndl, *results,  0, bah.GetMessages());
                 bah.ResetMessages();
-            } else {
+            } else if (results.NotEmpty()) {
                 BlastFormatter_PreFetchSequenceData(*results, scope,
                 		                            fmt_args->GetFormattedOutputChoice());
                 ITERATE(CSearchResultSet, result, *results) {
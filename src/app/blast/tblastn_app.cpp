@@ -202,13 +202,20 @@ int CTblastnApp::Run(void)
                 } else {
                     CLocalBlast lcl_blast(query_factory, opts_hndl, db_adapter);
                     lcl_blast.SetNumberOfThreads(m_CmdLineArgs->GetNumThreads());
-                    results = lcl_blast.Run();
+                    if (fmt_args->ArchiveFormatRequested(args)) {
+                        results = lcl_blast.Run();
+                    } else {
+                        results.Reset();
+                        CBlastFormatterSink sink(formatter, scope, query,
+                                        fmt_args->GetFormattedOutputChoice());
+                        lcl_blast.Run(sink);
+                    }
                 }
 
                 if (fmt_args->ArchiveFormatRequested(args)) {
                     formatter.WriteArchive(*query_factory, *opts_hndl, *results, 0, bah.GetMessages());
                     bah.ResetMessages();
-                } else {
+                } else if (results.NotEmpty()) {
                     BlastFormatter_PreFetchSequenceData(*results, scope,
                     		                            fmt_args->GetFormattedOutputChoice());
                     ITERATE(CSearchResultSet, result, *results) {
@@ -373,23 +373,77 @@ CBlastDBCmdApp::x_ProcessBatchEntry_NoDup(CBlastDB_Formatter & fmt)
     				oids[i] = gi_oid;
     			}
     		}
-    		if(oids[i] == kSeqDBEntryNotFound) {
-    			err_found ++;
-    			ERR_POST (Error << "Skipped " << ids[i]);
+    	}
+    }
+
+    // The entries are formatted in input order, a chunk at a time; the
+    // sequences of each chunk are first read in one batch, in file order.
+    const Uint8 kMaxBatchResidues = 64 * 1024 * 1024;
+    const size_t kMaxBatchOids = 4096;
+    const bool use_batch = fmt.UsesSequenceBatch();
+    CSeqDB::SSequenceBatch batch;
+    vector<CSeqDB::TOID> batch_oids;
+    unsigned int chunk_start = 0;
+    while(chunk_start < ids.size()) {
+    	unsigned int chunk_end = chunk_start;
+    	Uint8 num_residues = 0;
+    	batch_oids.clear();
+    	for(; (chunk_end < ids.size()) && (batch_oids.size() < kMaxBatchOids); chunk_end++) {
+    		if(oids[chunk_end] == kSeqDBEntryNotFound) {
     			continue;
     		}
+    		if(use_batch) {
+    			Uint8 length = m_BlastDb->GetSeqLength(oids[chunk_end]);
+    			// A sequence longer than the limit gets a batch of its own
+    			if(!batch_oids.empty() && (num_residues + length > kMaxBatchResidues)) {
+    				break;
+    			}
+    			num_residues += length;
+    		}
+    		batch_oids.push_back(oids[chunk_end]);
     	}
-    	if(x_ModifyConfigForBatchEntry(formats[i]))  {
-    		err_found ++;
-    		ERR_POST (Error << "Skipped " << ids[i]);
-    		continue;
+
+    	if(use_batch && !batch_oids.empty()) {
+    		sort(batch_oids.begin(), batch_oids.end());
+    		batch_oids.erase(unique(batch_oids.begin(), batch_oids.end()),
+    		                 batch_oids.end());
+    		try {
+    			m_BlastDb->GetAmbigSeqBatch(batch_oids, kSeqDBNuclNcbiNA8, batch);
+    			fmt.SetSequenceBatch(&batch);
+    		}
+    		catch(const CSeqDBException &) {
+    			// e.g. an empty sequence: read this chunk one sequence at a
+    			// time so that only the failing entry reports the error
+    			fmt.SetSequenceBatch(NULL);
+    		}
     	}
-    	if(m_TargetOnly) {
-    		fmt.Write(oids[i], m_Config, ids[i]);
+
+    	try {
+    		for(unsigned i=chunk_start; i < chunk_end; i++) {
+    			if(oids[i] == kSeqDBEntryNotFound) {
+    				err_found ++;
+    				ERR_POST (Error << "Skipped " << ids[i]);
+    				continue;
+    			}
+    			if(x_ModifyConfigForBatchEntry(formats[i]))  {
+    				err_found ++;
+    				ERR_POST (Error << "Skipped " << ids[i]);
+    				continue;
+    			}
+    			if(m_TargetOnly) {
+    				fmt.Write(oids[i], m_Config, ids[i]);
+    			}
+    			else {
+    				fmt.Write(oids[i], m_Config);
+    			}
+    		}
     	}
-    	else {
-    	   	fmt.Write(oids[i], m_Config);
+    	catch(...) {
+    		fmt.SetSequenceBatch(NULL);
+    		throw;
     	}
+    	fmt.SetSequenceBatch(NULL);
+    	chunk_start = chunk_end;
     }
     return (err_found) ? 1 : 0;
 }
@@ -234,6 +234,20 @@ void CMakeBlastDBApp::Init()
                       "Create index of sequence hash values.",
                       true);
 
+    arg_desc->AddFlag("accession_hash",
+                      "Create a compact hash index from seqids to OIDs "
+                      "for constant time lookups (BLAST database "
+                      "version 4 only)",
+                      true);
+
+    arg_desc->AddDefaultKey(kArgNumThreads, "int_value",
+                            "Number of threads used to prepare sequences "
+                            "(output is identical for any value)",
+                            CArgDescriptions::eInteger,
+                            "1");
+    arg_desc->SetConstraint(kArgNumThreads,
+                            new CArgAllowValuesGreaterThanOrEqual(1));
+
 #if ((!defined(NCBI_COMPILER_WORKSHOP) || (NCBI_COMPILER_VERSION  > 550)) && \
      (!defined(NCBI_COMPILER_MIPSPRO)) )
     arg_desc->SetCurrentGroup("Sequence masking options");
@@ -261,6 +275,7 @@ void CMakeBlastDBApp::Init()
                       "Create GI indexed masking data.", true);
     arg_desc->SetDependency("gi_mask", CArgDescriptions::eExcludes, "mask_id");
     arg_desc->SetDependency("gi_mask", CArgDescriptions::eRequires, "parse_seqids");
+    arg_desc->SetDependency("accession_hash", CArgDescriptions::eRequires, "parse_seqids");
 
     arg_desc->AddOptionalKey("gi_mask_name", "gi_based_mask_names",
                              "Comma-separated list of masking data output files.",
@@ -1127,6 +1142,15 @@ void CMakeBlastDBApp::x_BuildDatabase()
     const EBlastDbVersion dbver =
         static_cast<EBlastDbVersion>(args["blastdb_version"].AsInteger());
 
+    if (args["accession_hash"]) {
+        if (dbver == eBDB_Version4) {
+            indexing |= CWriteDB::eAddAccessionHash;
+        } else {
+            ERR_POST(Warning << "-accession_hash is ignored for BLAST "
+                     "database version 5, which indexes seqids in LMDB");
+        }
+    }
+
     bool limit_defline = false;
 #if _BLAST_DEBUG
     if(args["limit_defline"]) {
@@ -1177,6 +1201,12 @@ void CMakeBlastDBApp::x_BuildDatabase()
 
     m_DB->SetMaxFileSize(bytes);
 
+    int num_threads = args[kArgNumThreads].AsInteger();
+    if (num_threads > 1) {
+        *m_LogFile << "Number of threads: " << num_threads << endl;
+    }
+    m_DB->SetNumberOfThreads(num_threads);
+
     if (args["taxid"].HasValue()) {
         _ASSERT( !args["taxid_map"].HasValue() );
         CRef<CTaxIdSet> taxids(new CTaxIdSet(args["taxid"].AsInteger()));
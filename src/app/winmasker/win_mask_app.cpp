@@ -165,7 +165,8 @@ int CWinMaskApplication::Run (void)
                                         aConfig.Ids(),
                                         aConfig.ExcludeIds(),
                                         aConfig.UseBA(),
-                                        aConfig.GetMetaData() );
+                                        aConfig.GetMetaData(),
+                                        aConfig.NumThreads() );
             cg();
         }
         else {
@@ -184,7 +185,8 @@ int CWinMaskApplication::Run (void)
                                         aConfig.Ids(),
                                         aConfig.ExcludeIds(),
                                         aConfig.UseBA(),
-                                        aConfig.GetMetaData() );
+                                        aConfig.GetMetaData(),
+                                        aConfig.NumThreads() );
             cg();
         }
 
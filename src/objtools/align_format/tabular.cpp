@@ -1282,19 +1282,28 @@ void CBlastTabularInfo::PrintNumProcessed(int num_queries)
     m_Ostream << "# BLAST processed " << num_queries << " queries\n";
 }
 
-void 
-CBlastTabularInfo::SetScores(int score, double bit_score, double evalue)
+/// Format the e-value and bit score the way they are shown in tabular output
+static void
+s_GetTabularScoreStrings(int score, double bit_score, double evalue,
+                         string& evalue_str, string& bit_score_str)
 {
     string total_bit_string, raw_score_string;
-    m_Score = score;
-    CAlignFormatUtil::GetScoreString(evalue, bit_score, 0, score, m_Evalue, 
-                                     m_BitScore, total_bit_string, raw_score_string);
+    CAlignFormatUtil::GetScoreString(evalue, bit_score, 0, score, evalue_str,
+                                     bit_score_str, total_bit_string,
+                                     raw_score_string);
 
     if ((evalue >= 1.0e-180) && (evalue < 0.0009)){
-    	m_Evalue = NStr::DoubleToString(evalue, 2, NStr::fDoubleScientific);
+    	evalue_str = NStr::DoubleToString(evalue, 2, NStr::fDoubleScientific);
     }
 }
 
+void 
+CBlastTabularInfo::SetScores(int score, double bit_score, double evalue)
+{
+    m_Score = score;
+    s_GetTabularScoreStrings(score, bit_score, evalue, m_Evalue, m_BitScore);
+}
+
 void 
 CBlastTabularInfo::SetEndpoints(int q_start, int q_end, int s_start, int s_end)
 {
@@ -2904,5 +2913,438 @@ void CIgBlastTabularInfo::x_PrintIgDomainHtml(const SIgDomain &domain) const
     }
 };
 
+
+const char CBlastColumnarTabularInfo::kMagic[8] =
+    { 'B', 'L', 'A', 'S', 'T', 'C', 'O', 'L' };
+const Uint4 CBlastColumnarTabularInfo::kVersion;
+const Uint4 CBlastColumnarTabularInfo::kByteOrderMark;
+const size_t CBlastColumnarTabularInfo::kRowsPerBlock;
+
+/// Fields the columnar output needs CBlastTabularInfo::SetFields to fill in
+static const string kColumnarTabularFields =
+    "qaccver saccver pident length mismatch gapopen gaps qstart qend sstart "
+    "send evalue bitscore score";
+
+/// Round a section size up to the 8 byte alignment used in columnar files
+static inline size_t s_ColumnarPadding(size_t size)
+{
+    return (8 - (size % 8)) % 8;
+}
+
+/// Width of a column in columnar files
+static inline size_t s_ColumnarWidth(int column)
+{
+    return column < CBlastColumnarTabularInfo::eBitScoreValue
+        ? sizeof(Int4) : sizeof(double);
+}
+
+CBlastColumnarTabularInfo::CBlastColumnarTabularInfo(CNcbiOstream& ostr,
+                                                     bool parse_local_ids)
+    : CBlastTabularInfo(ostr, kColumnarTabularFields, eTab, parse_local_ids),
+      m_QueryIndex(0),
+      m_SubjectIndex(0),
+      m_BitScoreValue(0.0),
+      m_EvalueValue(0.0)
+{
+    SFileHeader header;
+    memcpy(header.magic, kMagic, sizeof(header.magic));
+    header.version = kVersion;
+    header.byte_order = kByteOrderMark;
+    header.num_columns = eNumColumns;
+    header.reserved = 0;
+    m_Ostream.write((const char*)&header, sizeof(header));
+    for (int i = 0; i < eNumColumns; i++) {
+        if (i < eBitScoreValue) {
+            m_IntColumns[i].reserve(kRowsPerBlock);
+        } else {
+            m_DoubleColumns[i - eBitScoreValue].reserve(kRowsPerBlock);
+        }
+    }
+}
+
+CBlastColumnarTabularInfo::~CBlastColumnarTabularInfo()
+{
+    try {
+        Flush();
+    } catch (...) {/*ignore exceptions*/}
+}
+
+void
+CBlastColumnarTabularInfo::SetScores(int score, double bit_score,
+                                     double evalue)
+{
+    CBlastTabularInfo::SetScores(score, bit_score, evalue);
+    m_BitScoreValue = bit_score;
+    m_EvalueValue = evalue;
+}
+
+Int4
+CBlastColumnarTabularInfo::x_GetIdIndex(const string& id,
+                                        map<string, Int4>& dict,
+                                        vector<string>& ids)
+{
+    map<string, Int4>::iterator it = dict.lower_bound(id);
+    if (it == dict.end() || it->first != id) {
+        Int4 index = (Int4) ids.size();
+        it = dict.insert(it, make_pair(id, index));
+        ids.push_back(id);
+    }
+    return it->second;
+}
+
+bool
+CBlastColumnarTabularInfo::x_SetIdIndex(const CSeq_id& id, CScope& scope,
+                                        bool query)
+{
+    CConstRef<CSeq_id>& last = query ? m_LastQuerySeqId : m_LastSubjectSeqId;
+    if (last.NotEmpty() && last->Equals(id)) {
+        return true;
+    }
+
+    bool found = true;
+    try {
+        const CBioseq_Handle& bh = scope.GetBioseqHandle(id);
+        if (query) {
+            SetQueryId(bh);
+        } else {
+            SetSubjectId(bh);
+        }
+    } catch (const CException&) {
+        list<CRef<CSeq_id> > ids;
+        CRef<CSeq_id> copy(new CSeq_id());
+        copy->Assign(id);
+        ids.push_back(copy);
+        if (query) {
+            SetQueryId(ids);
+        } else {
+            m_SubjectId = ids;
+        }
+        found = false;
+    }
+
+    if (query) {
+        m_QueryIndex =
+            x_GetIdIndex(s_GetSeqIdListString(m_QueryId, eAccVersion),
+                         m_QueryIds, m_QueryIdList);
+    } else {
+        m_SubjectIndex =
+            x_GetIdIndex(s_GetSeqIdListString(m_SubjectId, eAccVersion),
+                         m_SubjectIds, m_SubjectIdList);
+    }
+    if (found) {
+        last.Reset(&id);
+    } else {
+        last.Reset();
+    }
+    return found;
+}
+
+int
+CBlastColumnarTabularInfo::SetFields(const CSeq_align& align,
+                                     CScope& scope,
+                                     CNcbiMatrix<int>* matrix)
+{
+    int score = 0, sum_n = 0, num_ident = -1;
+    double bit_score = .0, evalue = .0;
+    list<TGi> use_this_gi;
+    CAlignFormatUtil::GetAlnScores(align, score, bit_score, evalue, sum_n,
+                                   num_ident, use_this_gi);
+
+    // Translated (Std-seg) and ungapped (Dense-diag) alignments, and those
+    // without an identity count, need the sequences or a CAlnVec.
+    if (num_ident < 0 || !align.GetSegs().IsDenseg() ||
+        align.GetSegs().GetDenseg().GetDim() != 2) {
+        m_LastQuerySeqId.Reset();
+        m_LastSubjectSeqId.Reset();
+        int retval = CBlastTabularInfo::SetFields(align, scope, matrix);
+        m_QueryIndex =
+            x_GetIdIndex(s_GetSeqIdListString(m_QueryId, eAccVersion),
+                         m_QueryIds, m_QueryIdList);
+        m_SubjectIndex =
+            x_GetIdIndex(s_GetSeqIdListString(m_SubjectId, eAccVersion),
+                         m_SubjectIds, m_SubjectIdList);
+        return retval;
+    }
+
+    m_Score = score;
+    m_BitScoreValue = bit_score;
+    m_EvalueValue = evalue;
+
+    bool found = x_SetIdIndex(align.GetSeq_id(0), scope, true);
+    found = x_SetIdIndex(align.GetSeq_id(1), scope, false) && found;
+
+    // Same values as CAlignFormatUtil::GetAlignLengths() and the CAlnVec
+    // sequence ranges that CBlastTabularInfo::SetFields() uses
+    const CDense_seg& ds = align.GetSegs().GetDenseg();
+    const CDense_seg::TStarts& starts = ds.GetStarts();
+    const CDense_seg::TLens& lens = ds.GetLens();
+    int align_length = 0, num_gaps = 0, num_gap_opens = 0;
+    TSignedSeqPos q_from = -1, q_to = -1, s_from = -1, s_to = -1;
+    for (CDense_seg::TNumseg seg = 0; seg < ds.GetNumseg(); seg++) {
+        const TSignedSeqPos q = starts[2*seg];
+        const TSignedSeqPos s = starts[2*seg + 1];
+        const TSignedSeqPos len = lens[seg];
+        align_length += len;
+        if (q < 0 || s < 0) {
+            num_gaps += len;
+            ++num_gap_opens;
+        }
+        if (q >= 0) {
+            q_from = (q_from < 0 ? q : min(q_from, q));
+            q_to = max(q_to, q + len - 1);
+        }
+        if (s >= 0) {
+            s_from = (s_from < 0 ? s : min(s_from, s));
+            s_to = max(s_to, s + len - 1);
+        }
+    }
+
+    if (ds.GetSeqStrand(1) == eNa_strand_minus ||
+        ds.GetSeqStrand(0) == eNa_strand_minus) {
+        SetEndpoints(q_from + 1, q_to + 1, s_to + 1, s_from + 1);
+    } else {
+        SetEndpoints(q_from + 1, q_to + 1, s_from + 1, s_to + 1);
+    }
+    SetCounts(num_ident, align_length, num_gaps, num_gap_opens, 0, 1, 1);
+
+    return found ? 0 : -1;
+}
+
+void CBlastColumnarTabularInfo::Print(void)
+{
+    m_IntColumns[eQueryIndex].push_back(m_QueryIndex);
+    m_IntColumns[eSubjectIndex].push_back(m_SubjectIndex);
+    m_IntColumns[eAlignLength].push_back(m_AlignLength);
+    m_IntColumns[eNumIdentical].push_back(m_NumIdent);
+    m_IntColumns[eNumGaps].push_back(m_NumGaps);
+    m_IntColumns[eNumGapOpenings].push_back(m_NumGapOpens);
+    m_IntColumns[eQueryStart].push_back(m_QueryStart);
+    m_IntColumns[eQueryEnd].push_back(m_QueryEnd);
+    m_IntColumns[eSubjectStart].push_back(m_SubjectStart);
+    m_IntColumns[eSubjectEnd].push_back(m_SubjectEnd);
+    m_IntColumns[eRawScore].push_back(m_Score);
+    m_DoubleColumns[eBitScoreValue - eBitScoreValue].push_back(m_BitScoreValue);
+    m_DoubleColumns[eEvalueValue - eBitScoreValue].push_back(m_EvalueValue);
+
+    if (m_IntColumns[eQueryIndex].size() >= kRowsPerBlock) {
+        Flush();
+    }
+}
+
+void CBlastColumnarTabularInfo::Flush(void)
+{
+    const size_t kNumRows = m_IntColumns[eQueryIndex].size();
+    if (kNumRows == 0) {
+        return;
+    }
+
+    string ids;
+    ITERATE(vector<string>, id, m_QueryIdList) {
+        ids.append(*id);
+        ids.push_back('\0');
+    }
+    ITERATE(vector<string>, id, m_SubjectIdList) {
+        ids.append(*id);
+        ids.push_back('\0');
+    }
+    ids.append(s_ColumnarPadding(ids.size()), '\0');
+
+    SBlockHeader header;
+    header.num_rows = (Uint4) kNumRows;
+    header.num_query_ids = (Uint4) m_QueryIdList.size();
+    header.num_subject_ids = (Uint4) m_SubjectIdList.size();
+    header.id_bytes = (Uint4) ids.size();
+    m_Ostream.write((const char*)&header, sizeof(header));
+    m_Ostream.write(ids.data(), ids.size());
+
+    static const char kZeros[8] = { 0 };
+    for (int i = 0; i < eNumColumns; i++) {
+        const size_t kBytes = kNumRows * s_ColumnarWidth(i);
+        if (i < eBitScoreValue) {
+            m_Ostream.write((const char*)&m_IntColumns[i][0], kBytes);
+            m_IntColumns[i].clear();
+        } else {
+            vector<double>& column = m_DoubleColumns[i - eBitScoreValue];
+            m_Ostream.write((const char*)&column[0], kBytes);
+            column.clear();
+        }
+        m_Ostream.write(kZeros, s_ColumnarPadding(kBytes));
+    }
+
+    // Each block has its own dictionaries; the ids of the current HSPs
+    // are looked up again for the next block.
+    m_QueryIds.clear();
+    m_SubjectIds.clear();
+    m_QueryIdList.clear();
+    m_SubjectIdList.clear();
+    m_LastQuerySeqId.Reset();
+    m_LastSubjectSeqId.Reset();
+}
+
+CBlastColumnarTabularReader::CBlastColumnarTabularReader(const string& filename)
+    : m_Next(NULL), m_End(NULL), m_NumRows(0)
+{
+    const string kErrPrefix("Invalid BLAST columnar tabular file " + filename);
+    typedef CBlastColumnarTabularInfo TWriter;
+
+    if (CFile(filename).GetLength() < (Int8) sizeof(TWriter::SFileHeader)) {
+        NCBI_THROW(CException, eInvalid, kErrPrefix + ": file is too short");
+    }
+    m_File.reset(new CMemoryFile(filename));
+    m_Next = (const char*) m_File->GetPtr();
+    m_End = m_Next + m_File->GetSize();
+
+    TWriter::SFileHeader header;
+    memcpy(&header, m_Next, sizeof(header));
+    if (memcmp(header.magic, TWriter::kMagic, sizeof(header.magic)) != 0) {
+        NCBI_THROW(CException, eInvalid, kErrPrefix + ": bad magic number");
+    }
+    if (header.byte_order != TWriter::kByteOrderMark) {
+        NCBI_THROW(CException, eInvalid,
+                   kErrPrefix + ": written with a different byte order");
+    }
+    if (header.version != TWriter::kVersion ||
+        header.num_columns != TWriter::eNumColumns) {
+        NCBI_THROW(CException, eInvalid,
+                   kErrPrefix + ": unsupported version");
+    }
+    m_Next += sizeof(header);
+    memset(m_Columns, 0, sizeof(m_Columns));
+}
+
+const char*
+CBlastColumnarTabularReader::x_ReadIds(const char* p, const char* end,
+                                       Uint4 num_ids, vector<string>& ids)
+{
+    for (Uint4 i = 0; i < num_ids; i++) {
+        const char* nul = (const char*) memchr(p, '\0', end - p);
+        if (nul == NULL) {
+            NCBI_THROW(CException, eInvalid,
+                       "Truncated sequence id in BLAST columnar tabular file");
+        }
+        ids.push_back(string(p, nul));
+        p = nul + 1;
+    }
+    return p;
+}
+
+bool CBlastColumnarTabularReader::NextBlock(void)
+{
+    typedef CBlastColumnarTabularInfo TWriter;
+
+    m_NumRows = 0;
+    if (m_End - m_Next < (ptrdiff_t) sizeof(TWriter::SBlockHeader)) {
+        return false;
+    }
+    TWriter::SBlockHeader header;
+    memcpy(&header, m_Next, sizeof(header));
+    const char* p = m_Next + sizeof(header);
+    if ((size_t)(m_End - p) < header.id_bytes) {
+        NCBI_THROW(CException, eInvalid,
+                   "Truncated block in BLAST columnar tabular file");
+    }
+    const char* ids_end = p + header.id_bytes;
+    m_QueryIds.clear();
+    m_SubjectIds.clear();
+    p = x_ReadIds(p, ids_end, header.num_query_ids, m_QueryIds);
+    x_ReadIds(p, ids_end, header.num_subject_ids, m_SubjectIds);
+
+    p = ids_end;
+    for (int i = 0; i < TWriter::eNumColumns; i++) {
+        const size_t kBytes = header.num_rows * s_ColumnarWidth(i);
+        const size_t kPadded = kBytes + s_ColumnarPadding(kBytes);
+        if ((size_t)(m_End - p) < kPadded) {
+            NCBI_THROW(CException, eInvalid,
+                       "Truncated block in BLAST columnar tabular file");
+        }
+        m_Columns[i] = p;
+        p += kPadded;
+    }
+    m_Next = p;
+    m_NumRows = header.num_rows;
+    return true;
+}
+
+const Int4*
+CBlastColumnarTabularReader::GetIntColumn
+    (CBlastColumnarTabularInfo::EColumn column) const
+{
+    _ASSERT(column < CBlastColumnarTabularInfo::eBitScoreValue);
+    return (const Int4*) m_Columns[column];
+}
+
+const double*
+CBlastColumnarTabularReader::GetDoubleColumn
+    (CBlastColumnarTabularInfo::EColumn column) const
+{
+    _ASSERT(column >= CBlastColumnarTabularInfo::eBitScoreValue &&
+            column < CBlastColumnarTabularInfo::eNumColumns);
+    return (const double*) m_Columns[column];
+}
+
+const string& CBlastColumnarTabularReader::GetQueryId(Int4 index) const
+{
+    return m_QueryIds.at(index);
+}
+
+const string& CBlastColumnarTabularReader::GetSubjectId(Int4 index) const
+{
+    return m_SubjectIds.at(index);
+}
+
+void CBlastColumnarTabularReader::PrintTabular(CNcbiOstream& ostr)
+{
+    typedef CBlastColumnarTabularInfo TWriter;
+
+    string line, evalue, bit_score;
+    while (NextBlock()) {
+        const Int4* query = GetIntColumn(TWriter::eQueryIndex);
+        const Int4* subject = GetIntColumn(TWriter::eSubjectIndex);
+        const Int4* length = GetIntColumn(TWriter::eAlignLength);
+        const Int4* ident = GetIntColumn(TWriter::eNumIdentical);
+        const Int4* gaps = GetIntColumn(TWriter::eNumGaps);
+        const Int4* gap_opens = GetIntColumn(TWriter::eNumGapOpenings);
+        const Int4* q_start = GetIntColumn(TWriter::eQueryStart);
+        const Int4* q_end = GetIntColumn(TWriter::eQueryEnd);
+        const Int4* s_start = GetIntColumn(TWriter::eSubjectStart);
+        const Int4* s_end = GetIntColumn(TWriter::eSubjectEnd);
+        const Int4* score = GetIntColumn(TWriter::eRawScore);
+        const double* bits = GetDoubleColumn(TWriter::eBitScoreValue);
+        const double* evalues = GetDoubleColumn(TWriter::eEvalueValue);
+
+        for (size_t i = 0; i < m_NumRows; i++) {
+            double perc_ident = (length[i] > 0 ?
+                                 ((double)ident[i])/length[i] * 100 : 0);
+            s_GetTabularScoreStrings(score[i], bits[i], evalues[i],
+                                     evalue, bit_score);
+            line = GetQueryId(query[i]);
+            line += '\t';
+            line += GetSubjectId(subject[i]);
+            line += '\t';
+            line += NStr::DoubleToString(perc_ident, 3);
+            line += '\t';
+            line += NStr::IntToString(length[i]);
+            line += '\t';
+            line += NStr::IntToString(length[i] - ident[i] - gaps[i]);
+            line += '\t';
+            line += NStr::IntToString(gap_opens[i]);
+            line += '\t';
+            line += NStr::IntToString(q_start[i]);
+            line += '\t';
+            line += NStr::IntToString(q_end[i]);
+            line += '\t';
+            line += NStr::IntToString(s_start[i]);
+            line += '\t';
+            line += NStr::IntToString(s_end[i]);
+            line += '\t';
+            line += evalue;
+            line += '\t';
+            line += bit_score;
+            line += '\n';
+            ostr.write(line.data(), line.size());
+        }
+    }
+}
+
 END_SCOPE(align_format)
 END_NCBI_SCOPE
@@ -367,6 +367,70 @@ BOOST_AUTO_TEST_CASE(ExtractCorrectSeqIdWhenThereIsSourceObjectInDescription) {
     scope->GetObjectManager().RevokeAllDataLoaders();                
 }
 
+BOOST_AUTO_TEST_CASE(ColumnarOutputConvertsToStandardOutput) {
+
+    const string seqAlignFileName_in = "data/blastn.vs.ecoli.asn";
+    CRef<CSeq_annot> san(new CSeq_annot);
+
+    ifstream in(seqAlignFileName_in.c_str());
+    in >> MSerial_AsnText >> *san;
+    in.close();
+
+    list<CRef<CSeq_align> > seqalign_list = san->GetData().GetAlign();
+
+    const string kDbName("ecoli");
+    const CBlastDbDataLoader::EDbType kDbType(CBlastDbDataLoader::eNucleotide);
+    TestUtil::CBlastOM tmp_data_loader(kDbName, kDbType, CBlastOM::eLocal);
+    CRef<CScope> scope = tmp_data_loader.NewScope();
+
+    CNcbiOstrstream expected_stream;
+    const string kFileName = CFile::GetTmpName();
+    {
+        CBlastTabularInfo ctab(expected_stream);
+        CNcbiOfstream columnar_stream(kFileName.c_str(), IOS_BASE::binary);
+        CBlastColumnarTabularInfo columnar(columnar_stream);
+
+        // Write several blocks, each with its own id dictionaries
+        size_t row = 0;
+        ITERATE(list<CRef<CSeq_align> >, iter, seqalign_list)
+        {
+            ctab.SetFields(**iter, *scope);
+            ctab.Print();
+            columnar.SetFields(**iter, *scope);
+            columnar.Print();
+            if (++row % 7 == 0) {
+                columnar.Flush();
+            }
+        }
+    }
+
+    size_t num_rows = 0, num_blocks = 0;
+    {
+        CBlastColumnarTabularReader reader(kFileName);
+        while (reader.NextBlock()) {
+            num_blocks++;
+            num_rows += reader.GetNumRows();
+            BOOST_REQUIRE_EQUAL(string("AE000111.1"), reader.GetQueryId(
+                reader.GetIntColumn(CBlastColumnarTabularInfo::eQueryIndex)[0]));
+        }
+    }
+    BOOST_REQUIRE_EQUAL(seqalign_list.size(), num_rows);
+    BOOST_REQUIRE_EQUAL((num_rows + 6) / 7, num_blocks);
+
+    CNcbiOstrstream output_stream;
+    {
+        CBlastColumnarTabularReader reader(kFileName);
+        reader.PrintTabular(output_stream);
+    }
+    CFile(kFileName).Remove();
+
+    string expected = CNcbiOstrstreamToString(expected_stream);
+    string output = CNcbiOstrstreamToString(output_stream);
+    BOOST_REQUIRE(output.find("AE000111.1	AE000188.1	97.059	34	1	0	5567	5600	1088") != NPOS);
+    BOOST_REQUIRE_EQUAL(expected, output);
+    scope->GetObjectManager().RevokeAllDataLoaders();                
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 /*
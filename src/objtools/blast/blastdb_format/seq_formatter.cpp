@@ -40,6 +40,7 @@
 #include <numeric>      // for std::accumulate
 #include <objmgr/object_manager.hpp>
 #include <objmgr/scope.hpp>
+#include <util/sequtil/sequtil_convert.hpp>
 
 BEGIN_NCBI_SCOPE
 USING_SCOPE(objects);
@@ -56,6 +57,64 @@ static void s_GetSeqMask(CSeqDB & db, CSeqDB::TOID oid, int algo_id, CSeqDB::TSe
 #endif
 }
 
+int CBlastDB_Formatter::x_FindInBatch(CSeqDB::TOID oid) const
+{
+	if (m_Batch == NULL) {
+		return -1;
+	}
+	vector<int>::const_iterator itr = lower_bound(m_Batch->oids.begin(), m_Batch->oids.end(), oid);
+	if ((itr == m_Batch->oids.end()) || (*itr != oid)) {
+		return -1;
+	}
+	return (int) (itr - m_Batch->oids.begin());
+}
+
+/// Same as CSeqDB::GetSequenceAsString, for a sequence of a batch
+static void s_GetSeqFromBatch(const CSeqDB::SSequenceBatch & batch, int index, bool is_prot,
+                              const TSeqRange & r, string & seq)
+{
+	TSeqPos from = 0;
+	TSeqPos length = batch.lengths[index];
+	if (r.NotEmpty()) {
+		from = r.GetFrom();
+		length = r.GetLength();
+	}
+	CTempString raw(batch.GetSequence(index) + from, length);
+	CSeqConvert::Convert(raw,
+	                     is_prot ? CSeqUtil::e_Ncbistdaa : CSeqUtil::e_Ncbi8na,
+	                     0,
+	                     length,
+	                     seq,
+	                     is_prot ? CSeqUtil::e_Iupacaa : CSeqUtil::e_Iupacna);
+}
+
+/// Set the sequence data of a Seq-inst returned by
+/// CSeqDB::GetBioseqNoData() from a sequence of a batch
+static void s_SetSeqDataFromBatch(const CSeqDB::SSequenceBatch & batch, int index, bool is_prot,
+                                  CSeq_inst & seqinst)
+{
+	const char * buffer = batch.GetSequence(index);
+	TSeqPos length = batch.lengths[index];
+	if (is_prot) {
+		seqinst.SetSeq_data().SetNcbistdaa().Set().assign(buffer, buffer + length);
+	}
+	else {
+		// Pack the ncbi8na residues two per byte, as CSeqDBVol does
+		vector<char> v4;
+		v4.reserve((length+1)/2);
+		TSeqPos length_whole = length & ~TSeqPos(1);
+		for (TSeqPos i = 0; i < length_whole; i += 2) {
+			v4.push_back((buffer[i] << 4) | buffer[i+1]);
+		}
+		if (length_whole != length) {
+			v4.push_back(buffer[length_whole] << 4);
+		}
+		seqinst.SetSeq_data().SetNcbi4na().Set().swap(v4);
+	}
+	seqinst.SetLength(length);
+	seqinst.SetRepr(CSeq_inst::eRepr_raw);
+}
+
 CBlastDB_SeqFormatter::CBlastDB_SeqFormatter(const string& format_spec, CSeqDB& blastdb, CNcbiOstream& out)
     : m_Out(out), m_FmtSpec(format_spec), m_BlastDb(blastdb), m_GetDefline(false), m_OtherFields(0)
 {
@@ -289,7 +348,11 @@ void CBlastDB_SeqFormatter::x_GetSeq(CSeqDB::TOID oid, const CBlastDB_FormatterC
 	    	r.SetTo(length-1);
 	    }
 	}
-	if(r.Empty()) {
+	int batch_index = x_FindInBatch(oid);
+	if(batch_index >= 0) {
+		s_GetSeqFromBatch(*m_Batch, batch_index, m_BlastDb.GetSequenceType() == CSeqDB::eProtein, r, seq);
+	}
+	else if(r.Empty()) {
 	   	m_BlastDb.GetSequenceAsString(oid, seq);
 	}
 	else {
@@ -397,23 +460,32 @@ s_GetMaskSeqLoc(const CSeqDB::TSequenceRanges & mask_ranges, CSeq_loc & seq_loc)
 int CBlastDB_FastaFormatter::Write(CSeqDB::TOID oid, const CBlastDB_FormatterConfig & config, string target_id)
 {
 	int status = -1;
-	CRef<CBioseq> bioseq = m_BlastDb.GetBioseq(oid);
+	// Sequences in the batch only need the headers from the database
+	int batch_index = x_FindInBatch(oid);
+	bool with_data = (batch_index < 0);
+	CRef<CBioseq> bioseq;
 	if(target_id != kEmptyStr) {
 		Int8 num_id = NStr::StringToNumeric<Int8>(target_id, NStr::fConvErr_NoThrow);
 		if(errno) {
 			CSeq_id seq_id(target_id, CSeq_id::fParse_PartialOK | CSeq_id::fParse_Default);
-			bioseq = m_BlastDb.GetBioseq(oid, ZERO_GI, &seq_id);
+			bioseq = with_data ? m_BlastDb.GetBioseq(oid, ZERO_GI, &seq_id)
+			                   : m_BlastDb.GetBioseqNoData(oid, ZERO_GI, &seq_id);
 		}
 		else {
-			bioseq = m_BlastDb.GetBioseq(oid, num_id);
+			bioseq = with_data ? m_BlastDb.GetBioseq(oid, num_id)
+			                   : m_BlastDb.GetBioseqNoData(oid, num_id);
 		}
 	}
 	else {
-		bioseq = m_BlastDb.GetBioseq(oid);
+		bioseq = with_data ? m_BlastDb.GetBioseq(oid) : m_BlastDb.GetBioseqNoData(oid);
 	}
 	if (bioseq.Empty()) {
 		return status;
 	}
+	if (!with_data) {
+		s_SetSeqDataFromBatch(*m_Batch, batch_index, m_BlastDb.GetSequenceType() == CSeqDB::eProtein,
+		                      bioseq->SetInst());
+	}
 
 	if(config.m_Strand == eNa_strand_minus) {
 		m_fasta.SetFlag(CFastaOstream::fReverseStrand);
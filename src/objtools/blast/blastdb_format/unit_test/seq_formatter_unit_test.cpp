@@ -384,6 +384,57 @@ BOOST_AUTO_TEST_CASE(TestMaskedSequenceData)
 }
 
 
+static string s_WriteOids(CBlastDB_Formatter & f, const vector<int> & oids,
+                          const CBlastDB_FormatterConfig & config,
+                          CNcbiOstrstream & out)
+{
+    ITERATE(vector<int>, oid, oids) {
+        f.Write(*oid, config);
+    }
+    return CNcbiOstrstreamToString(out);
+}
+
+BOOST_AUTO_TEST_CASE(TestSequenceBatch)
+{
+    CSeqDB db("data/mask-data-db", CSeqDB::eProtein);
+    vector<int> oids;
+    for (int oid = 0; db.CheckOrFindOID(oid) && oids.size() < 10; oid++) {
+        oids.push_back(oid);
+    }
+    BOOST_REQUIRE( !oids.empty() );
+    CSeqDB::SSequenceBatch batch;
+    db.GetAmbigSeqBatch(oids, kSeqDBNuclNcbiNA8, batch);
+
+    CBlastDB_FormatterConfig config;
+    config.m_SeqRange = TSeqRange(10, 100);
+    config.m_FiltAlgoId = 40;
+
+    {
+        CNcbiOstrstream out, out_batch;
+        CBlastDB_SeqFormatter f("%a %s", db, out);
+        CBlastDB_SeqFormatter f_batch("%a %s", db, out_batch);
+        BOOST_REQUIRE(f_batch.UsesSequenceBatch());
+        f_batch.SetSequenceBatch(&batch);
+        const string expected = s_WriteOids(f, oids, config, out);
+        BOOST_REQUIRE( !expected.empty() );
+        BOOST_REQUIRE_EQUAL(expected, s_WriteOids(f_batch, oids, config, out_batch));
+    }
+    {
+        CNcbiOstrstream out, out_batch;
+        CBlastDB_FastaFormatter f(db, out);
+        CBlastDB_FastaFormatter f_batch(db, out_batch);
+        BOOST_REQUIRE(f_batch.UsesSequenceBatch());
+        f_batch.SetSequenceBatch(&batch);
+        const string expected = s_WriteOids(f, oids, config, out);
+        BOOST_REQUIRE( !expected.empty() );
+        BOOST_REQUIRE_EQUAL(expected, s_WriteOids(f_batch, oids, config, out_batch));
+    }
+    {
+        CNcbiOstrstream out;
+        CBlastDB_SeqFormatter f("%a", db, out);
+        BOOST_REQUIRE( !f.UsesSequenceBatch() );
+    }
+}
 
 BOOST_AUTO_TEST_CASE(TestPDBIds)
 {
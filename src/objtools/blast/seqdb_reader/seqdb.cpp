@@ -562,6 +562,18 @@ void CSeqDB::RetAmbigSeq(const char ** buffer) const
     //m_Impl->Verify();
 }
 
+void CSeqDB::PrefetchSequences(const vector<int> & oids) const
+{
+    m_Impl->PrefetchSequences(oids);
+}
+
+void CSeqDB::GetAmbigSeqBatch(const vector<int> & oids,
+                              int                 nucl_code,
+                              SSequenceBatch    & batch) const
+{
+    m_Impl->GetAmbigSeqBatch(oids, nucl_code, batch);
+}
+
 int CSeqDB::GetAmbigSeq(int           oid,
                         const char ** buffer,
                         int           nucl_code,
@@ -1323,6 +1335,11 @@ void CSeqDB::SetNumberOfThreads(int num_threads, bool force_mt)
     m_Impl->SetNumberOfThreads(num_threads, force_mt);
 }
 
+void CSeqDB::SetImmutableMode(bool immutable)
+{
+    m_Impl->SetImmutableMode(immutable);
+}
+
 string CSeqDB::ESeqType2String(ESeqType type)
 {
     string retval("Unknown");
@@ -522,7 +522,8 @@ void CSeqDBLMDB::GetDBTaxIds(vector<Int4> & tax_ids) const
     	auto dbi(dbi_handle);
     	auto cursor = lmdb::cursor::open(txn, dbi);
     	lmdb::val key;
-        while (cursor.get(key, MDB_NEXT)) {
+        // A tax id has several offsets in an appended database
+        while (cursor.get(key, MDB_NEXT_NODUP)) {
         	Int4 taxid = *((Int4 *)key.data());
         	tax_ids.push_back(taxid);
         }
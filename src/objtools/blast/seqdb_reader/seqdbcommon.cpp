@@ -2656,6 +2656,37 @@ void SeqDB_GetFileExtensions(bool db_is_protein, vector<string>& extn, EBlastDbV
     extn.push_back(kExtnMol + "hd");   // ISAM sequence hash data file
     extn.push_back(kExtnMol + "ti");   // ISAM trace id index file
     extn.push_back(kExtnMol + "td");   // ISAM trace id data file
+    if (dbver == eBDB_Version4) {
+        extn.push_back(kExtnMol + "ai");   // accession hash index file
+    }
+}
+
+Uint8 SeqDB_AccessionHash(const char * key, size_t length)
+{
+    // FNV-1a over the lowercased bytes, followed by a 64 bit mixing
+    // step so that the low bits (used as the table slot) depend on
+    // every input byte.
+
+    Uint8 h = NCBI_CONST_UINT8(14695981039346656037);
+
+    for(size_t i = 0; i < length; i++) {
+        unsigned char ch = (unsigned char) key[i];
+
+        if (ch >= 'A' && ch <= 'Z') {
+            ch += 'a' - 'A';
+        }
+
+        h ^= ch;
+        h *= NCBI_CONST_UINT8(1099511628211);
+    }
+
+    h ^= h >> 30;
+    h *= NCBI_CONST_UINT8(0xbf58476d1ce4e5b9);
+    h ^= h >> 27;
+    h *= NCBI_CONST_UINT8(0x94d049bb133111eb);
+    h ^= h >> 31;
+
+    return h ? h : 1;
 }
 
 
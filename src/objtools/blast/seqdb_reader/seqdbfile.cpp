@@ -150,7 +150,9 @@ CSeqDBIdxFile::CSeqDBIdxFile(CSeqDBAtlas    & atlas,
       m_OffAmb        (0),
       m_EndAmb        (0),
       m_LMDBFile	  (kEmptyStr) ,
-      m_Volume        (0)
+      m_Volume        (0),
+      m_SeqOffsets    (NULL),
+      m_AmbOffsets    (NULL)
 {
     //Verify();
     
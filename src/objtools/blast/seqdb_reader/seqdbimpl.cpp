@@ -78,7 +78,8 @@ CSeqDBImpl::CSeqDBImpl(const string       & db_name_list,
       m_NeedTotalsScan  (false),
       m_UseGiMask       (m_Aliases.HasGiMask()),
       m_MaskDataColumn  (kUnknownTitle),
-      m_NumThreads      (0)
+      m_NumThreads      (0),
+      m_Immutable       (false)
 {
     INIT_CLASS_MARK();
 
@@ -166,7 +167,8 @@ CSeqDBImpl::CSeqDBImpl(bool use_atlas_lock)
       m_NeedTotalsScan  (false),
       m_UseGiMask       (false),
       m_MaskDataColumn  (kUnknownTitle),
-      m_NumThreads      (0)
+      m_NumThreads      (0),
+      m_Immutable       (false)
 {
     INIT_CLASS_MARK();
 
@@ -399,16 +401,18 @@ int CSeqDBImpl::GetSeqLength(int oid) const
 
 int CSeqDBImpl::x_GetSeqLength(int oid, CSeqDBLockHold & locked) const
 {
-    m_Atlas.Lock(locked);
+    if (! m_Immutable) {
+        m_Atlas.Lock(locked);
+    }
 
     int vol_oid = 0;
 
     if ('p' == m_SeqType) {
-        if (const CSeqDBVol * vol = m_VolSet.FindVol(oid, vol_oid)) {
+        if (const CSeqDBVol * vol = x_FindSeqVol(oid, vol_oid)) {
             return vol->GetSeqLengthProt(vol_oid, locked);
         }
     } else {
-        if (const CSeqDBVol * vol = m_VolSet.FindVol(oid, vol_oid)) {
+        if (const CSeqDBVol * vol = x_FindSeqVol(oid, vol_oid)) {
             return vol->GetSeqLengthExact(vol_oid, locked);
         }
     }
@@ -627,7 +631,7 @@ void CSeqDBImpl::RetSequence(const char ** buffer) const
 
     CSeqDBLockHold locked(m_Atlas);
 
-    if (m_NumThreads) {
+    if (m_NumThreads && ! m_Immutable) {
         int cacheID = x_GetCacheID(locked);
         (m_CachedSeqs[cacheID]->checked_out)--;
         *buffer = 0;
@@ -653,6 +657,80 @@ void CSeqDBImpl::RetAmbigSeq(const char ** buffer) const
     *buffer = 0;
 }
 
+void CSeqDBImpl::PrefetchSequences(const vector<int> & oids) const
+{
+    CHECK_MARKER();
+    CSeqDBLockHold locked(m_Atlas);
+
+    x_PrefetchSequences(oids, locked);
+}
+
+void CSeqDBImpl::x_PrefetchSequences(const vector<int> & oids,
+                                     CSeqDBLockHold    & locked) const
+{
+    if (! m_Immutable) {
+        m_Atlas.Lock(locked);
+    }
+
+    // The OIDs are sorted, so each volume's OIDs form one run.
+
+    vector<int> vol_oids;
+    const CSeqDBVol * cur_vol = NULL;
+
+    ITERATE(vector<int>, oid, oids) {
+        int vol_oid = 0;
+        const CSeqDBVol * vol = x_FindSeqVol(*oid, vol_oid);
+
+        if (vol != cur_vol) {
+            if (cur_vol) {
+                cur_vol->PrefetchSequences(vol_oids);
+            }
+            vol_oids.clear();
+            cur_vol = vol;
+        }
+        if (vol) {
+            vol_oids.push_back(vol_oid);
+        }
+    }
+
+    if (cur_vol) {
+        cur_vol->PrefetchSequences(vol_oids);
+    }
+}
+
+void CSeqDBImpl::GetAmbigSeqBatch(const vector<int>      & oids,
+                                  int                      nucl_code,
+                                  CSeqDB::SSequenceBatch & batch) const
+{
+    CHECK_MARKER();
+    CSeqDBLockHold locked(m_Atlas);
+
+    x_PrefetchSequences(oids, locked);
+
+    batch.Clear();
+    batch.oids.reserve(oids.size());
+    batch.offsets.reserve(oids.size());
+    batch.lengths.reserve(oids.size());
+
+    bool sentinel = (m_SeqType == 'n' && nucl_code == kSeqDBNuclBlastNA8);
+
+    ITERATE(vector<int>, oid, oids) {
+        int vol_oid = 0;
+        const CSeqDBVol * vol = x_FindSeqVol(*oid, vol_oid);
+
+        if (! vol) {
+            NCBI_THROW(CSeqDBException, eArgErr, CSeqDB::kOidNotFound);
+        }
+
+        size_t offset = batch.arena.size() + (sentinel ? 1 : 0);
+        int length = vol->AppendAmbigSeq(vol_oid, nucl_code, batch.arena);
+
+        batch.oids.push_back(*oid);
+        batch.offsets.push_back(offset);
+        batch.lengths.push_back(length);
+    }
+}
+
 void CSeqDBImpl::x_RetSeqBuffer(SSeqResBuffer * buffer,
                                 CSeqDBLockHold & locked ) const
 {
@@ -711,6 +789,18 @@ void CSeqDBImpl::x_FillSeqBuffer(SSeqResBuffer  *buffer,
         const char * seq;
         Int8 tot_length = m_Atlas.GetSliceSize() / (4*m_NumThreads) + 1;
 
+        // Guided self-scheduling: as the end of the OID range approaches,
+        // hand out smaller chunks so that the threads run out of work at
+        // about the same time.  The floor keeps runs of short subjects
+        // batched together so the atlas lock is not taken per sequence.
+        if (m_NumOIDs > 0 && m_RestrictEnd > oid) {
+            Int8 avg_length = (Int8)(m_TotalLength / m_NumOIDs) + 1;
+            Int8 remaining = avg_length * (m_RestrictEnd - oid);
+            Int8 guided = remaining / (2*m_NumThreads) + 1;
+            Int8 floor_length = tot_length / 16 + 1;
+            tot_length = max(min(tot_length, guided), floor_length);
+        }
+
         res.length = vol->GetSequence(vol_oid++, &seq, locked);
         if (res.length < 0) return;
         // must return at least one sequence
@@ -734,13 +824,24 @@ int CSeqDBImpl::GetSequence(int oid, const char ** buffer) const
 
     CSeqDBLockHold locked(m_Atlas);
 
+    int vol_oid = 0;
+
+    // Immutable volumes hand out pointers into mappings that live as
+    // long as this object, so neither the lock nor the per-thread
+    // buffers are needed.
+
+    if (m_Immutable) {
+        if (const CSeqDBVol * vol = x_FindSeqVol(oid, vol_oid)) {
+            return vol->GetSequence(vol_oid, buffer, locked);
+        }
+        NCBI_THROW(CSeqDBException, eArgErr, CSeqDB::kOidNotFound);
+    }
+
     if (m_NumThreads) {
         int cacheID = x_GetCacheID(locked);
         return x_GetSeqBuffer(m_CachedSeqs[cacheID], oid, buffer);
     }
 
-    int vol_oid = 0;
-
     m_Atlas.Lock(locked);
     //m_Atlas.MentionOid(oid, m_NumOIDs, locked);
 
@@ -779,11 +880,13 @@ int CSeqDBImpl::GetAmbigSeq(int               oid,
     CHECK_MARKER();
     CSeqDBLockHold locked(m_Atlas);
 
-    m_Atlas.Lock(locked);
+    if (! m_Immutable) {
+        m_Atlas.Lock(locked);
+    }
     //m_Atlas.MentionOid(oid, m_NumOIDs, locked);
 
     int vol_oid = 0;
-    if (const CSeqDBVol * vol = m_VolSet.FindVol(oid, vol_oid)) {
+    if (const CSeqDBVol * vol = x_FindSeqVol(oid, vol_oid)) {
         return vol->GetAmbigSeq(vol_oid,
                                 buffer,
                                 nucl_code,
@@ -1139,6 +1242,10 @@ string CSeqDBImpl::x_FixString(const string & s) const
 
 void CSeqDBImpl::FlushSeqMemory()
 {
+    // Other threads may hold pointers into immutable mappings.
+    if (m_Immutable) {
+        return;
+    }
     m_VolSet.UnLease();
 }
 
@@ -2627,6 +2734,20 @@ void CSeqDBImpl::SetNumberOfThreads(int num_threads, bool force_mt)
     m_NumThreads = num_threads;
 }
 
+void CSeqDBImpl::SetImmutableMode(bool immutable)
+{
+    CSeqDBLockHold locked(m_Atlas);
+    m_Atlas.Lock(locked);
+
+    if (immutable && ! m_Immutable) {
+        for(int vol_idx = 0; vol_idx < m_VolSet.GetNumVols(); vol_idx++) {
+            m_VolSet.GetVolNonConst(vol_idx)->PrepareImmutable();
+        }
+    }
+
+    m_Immutable = immutable;
+}
+
 int CSeqDBImpl::x_GetCacheID(CSeqDBLockHold &locked) const
 {
     int threadID = CThread::GetSelf();
@@ -419,6 +419,24 @@ public:
     ///   A pointer to the sequence data to release.
     void RetAmbigSeq(const char ** buffer) const;
 
+    /// Hint that a set of sequences will be read soon.
+    ///
+    /// @param oids
+    ///   The OIDs to prefetch, sorted in increasing order.
+    void PrefetchSequences(const vector<int> & oids) const;
+
+    /// Fetch a batch of sequences with ambiguities.
+    ///
+    /// @param oids
+    ///   The OIDs to fetch, sorted in increasing order.
+    /// @param nucl_code
+    ///   The encoding to use for nucleotide sequences.
+    /// @param batch
+    ///   The fetched sequences are returned here.
+    void GetAmbigSeqBatch(const vector<int>       & oids,
+                          int                       nucl_code,
+                          CSeqDB::SSequenceBatch  & batch) const;
+
     /// Gets a list of sequence identifiers.
     ///
     /// This returns the list of CSeq_id identifiers associated with
@@ -1053,6 +1071,19 @@ public:
     ///                 internal mmap. [in]
     void SetNumberOfThreads(int num_threads, bool force_mt = false);
 
+    /// Enable or disable immutable (lock-free) read mode
+    ///
+    /// In immutable mode all sequence files are opened and the index
+    /// offset arrays are pinned up front.  GetSequence, GetAmbigSeq,
+    /// GetSeqLength and RetSequence then bypass the atlas lock and
+    /// the per-thread sequence buffers, and FlushSeqMemory no longer
+    /// unmaps anything, so concurrent retrieval scales with the
+    /// number of threads.  This must be called by the master thread
+    /// before other threads access this object.
+    ///
+    /// @param immutable True to enable immutable mode. [in]
+    void SetImmutableMode(bool immutable = true);
+
     /// Set the membership bit of all volumes
     void SetVolsMemBit(int mbit);
 
@@ -1259,6 +1290,36 @@ private:
     ///   The mapped local cache ID
     int x_GetCacheID(CSeqDBLockHold &locked) const;
 
+    /// Issue prefetch hints for a sorted list of OIDs.
+    ///
+    /// The OIDs are split by volume and each volume advises the
+    /// kernel about the ranges it will read.
+    ///
+    /// @param oids
+    ///   The OIDs to prefetch, sorted in increasing order.
+    /// @param locked
+    ///   The lock hold object for this thread.
+    void x_PrefetchSequences(const vector<int> & oids,
+                             CSeqDBLockHold    & locked) const;
+
+    /// Find the volume holding an OID on the sequence retrieval path.
+    ///
+    /// In immutable mode this uses the wait-free volume lookup,
+    /// otherwise the cached lookup which assumes the atlas is locked.
+    ///
+    /// @param oid
+    ///   The global OID to search for.
+    /// @param vol_oid
+    ///   The returned OID within the relevant volume.
+    /// @return
+    ///   A pointer to the volume containing the oid, or NULL.
+    const CSeqDBVol * x_FindSeqVol(int oid, int & vol_oid) const
+    {
+        return m_Immutable
+            ? m_VolSet.FindVolShared(oid, vol_oid)
+            : m_VolSet.FindVol(oid, vol_oid);
+    }
+
     
     /// Memory management layer guard (RIIA) object.
     CSeqDBAtlasHolder m_AtlasHolder;
@@ -1373,6 +1434,9 @@ private:
     /// number of thread clients
     int m_NumThreads;
 
+    /// True if the database is read in immutable (lock-free) mode.
+    bool m_Immutable;
+
     /// mapping thread ID to storage ID
     mutable std::map<int, int> m_CacheID;
     mutable int m_NextCacheID;
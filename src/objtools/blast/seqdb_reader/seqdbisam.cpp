@@ -1149,6 +1149,7 @@ CSeqDBIsam::CSeqDBIsam(CSeqDBAtlas  & atlas,
       m_FileStart      (0),
       m_FirstOffset    (0),
       m_LastOffset     (0),
+      m_KeyVerifier    (NULL),
       m_LongId         (false),
       m_TermSize       (8)
 {
@@ -1187,6 +1188,16 @@ CSeqDBIsam::CSeqDBIsam(CSeqDBAtlas  & atlas,
     }
     m_IndexLease.Init(m_IndexFname);
     m_DataLease.Init(m_DataFname);
+
+    if (ident_type == eStringId &&
+        CSeqDBAccessionHash::Enabled() &&
+        CSeqDBAccessionHash::Exists(dbname, prot_nucl)) {
+
+        m_AccessionHash.Reset(new CSeqDBAccessionHash(atlas,
+                                                      dbname,
+                                                      prot_nucl));
+    }
+
     if(m_Type == eNumeric) {
         m_PageSize = DEFAULT_NISAM_SIZE;
     } else {
@@ -1241,6 +1252,10 @@ void CSeqDBIsam::UnLease()
 {
     m_IndexLease.Clear();
     m_DataLease.Clear();
+
+    if (m_AccessionHash.NotEmpty()) {
+        m_AccessionHash->UnLease();
+    }
 }
 
 bool CSeqDBIsam::x_IdentToOid(Int8 ident, TOid & oid)
@@ -1257,17 +1272,51 @@ bool CSeqDBIsam::x_IdentToOid(Int8 ident, TOid & oid)
     return false;
 }
 
+/// Remove a short numeric version suffix from an accession.
+///
+/// @param acc Accession, possibly with a version. [in]
+/// @param nover Accession without the version. [out]
+/// @return true if acc ended in a version of one to three digits.
+static bool s_StripVersion(const string & acc, string & nover)
+{
+    size_t pos = acc.find(".");
+
+    if (pos == string::npos) {
+        return false;
+    }
+
+    int ver_len = acc.size() - pos - 1;
+
+    if (ver_len > 3 || ver_len < 1) {
+        return false;
+    }
+
+    for(size_t vp = pos+1; vp < acc.size(); vp++) {
+        if (! isdigit(acc[vp])) {
+            return false;
+        }
+    }
+
+    nover.assign(acc, 0, pos);
+    return true;
+}
+
 void CSeqDBIsam::StringToOids(const string   & acc,
                               vector<TOid>   & oids,
                               bool             adjusted,
                               bool           & version_check)
                               
 {
+    _ASSERT(m_IdentType == eStringId);
+
+    if (m_AccessionHash.NotEmpty() && m_KeyVerifier) {
+        x_HashStringToOids(acc, oids, adjusted, version_check);
+        return;
+    }
+
     bool strip_version = version_check;
     version_check = false;
 
-    _ASSERT(m_IdentType == eStringId);
-
     //m_Atlas.Lock(locked);
     
     x_InitLease();//Map files if needed
@@ -1329,26 +1378,9 @@ void CSeqDBIsam::StringToOids(const string   & acc,
     }
 
     if ((! found) && strip_version) {
-        size_t pos = acc.find(".");
-
-        bool is_version = false;
-
-        if (pos != string::npos) {
-            int ver_len = acc.size() - pos - 1;
-
-            is_version = (ver_len <= 3 && ver_len >= 1);
-
-            for(size_t vp = pos+1; vp < acc.size(); vp++) {
-                if (! isdigit(acc[vp])) {
-                    is_version = false;
-                    break;
-                }
-            }
-        }
-
-        if (is_version) {
-            string nover(acc, 0, pos);
+        string nover;
 
+        if (s_StripVersion(acc, nover)) {
             err = x_StringSearch(nover,
                                  keys_out,
                                  data_out,
@@ -1404,6 +1436,89 @@ void CSeqDBIsam::StringToOids(const string   & acc,
     }
 }
 
+bool CSeqDBIsam::x_HashLookup(const string & key, vector<TOid> & oids)
+{
+    vector<TOid> candidates;
+
+    if (! m_AccessionHash->Lookup(key, candidates)) {
+        return false;
+    }
+
+    // The index stores fingerprints, so another key may share this
+    // one's; only OIDs whose Seq-ids produce the key are kept.
+
+    bool found = false;
+
+    ITERATE(vector<TOid>, iter, candidates) {
+        if (m_KeyVerifier->HasStringKey(*iter, key)) {
+            oids.push_back(*iter);
+            found = true;
+        }
+    }
+
+    return found;
+}
+
+void CSeqDBIsam::x_HashStringToOids(const string   & acc,
+                                    vector<TOid>   & oids,
+                                    bool             adjusted,
+                                    bool           & version_check)
+{
+    bool strip_version = version_check;
+    version_check = false;
+
+    if (! adjusted) {
+        if (x_HashLookup("gb|" + acc + "|", oids) ||
+            x_HashLookup("gb||" + acc, oids)) {
+            return;
+        }
+    }
+
+    if (x_HashLookup(acc, oids)) {
+        return;
+    }
+
+    string nover;
+
+    if (strip_version && s_StripVersion(acc, nover)) {
+        if (x_HashLookup(nover, oids)) {
+            version_check = true;
+            return;
+        }
+    }
+
+    // As in StringToOids(), let CSeq_id build a FASTA form for IDs
+    // such as PDBs with chains.
+
+    string id;
+
+    try {
+        CSeq_id seqid(acc, CSeq_id::fParse_RawText | CSeq_id::fParse_AnyLocal);
+        id = seqid.AsFastaString();
+    }
+    catch(CSeqIdException &) {
+    }
+
+    if (id.size()) {
+        x_HashLookup(id, oids);
+    }
+}
+
+void CSeqDBIsam::x_HashTranslateSeqIdList(int            vol_start,
+                                          CSeqDBGiList & ids)
+{
+    int ids_size = ids.GetSize<string>();
+    vector<TOid> oids;
+
+    for(int i = 0; i < ids_size; i++) {
+        oids.clear();
+
+        if (x_HashLookup(ids.GetKey<string>(i), oids)) {
+            ids.SetValue<string>(i, oids.front() + vol_start);
+        }
+    }
+}
+
 bool CSeqDBIsam::x_SparseStringToOids(const string   &,
                                       vector<int>    &,
                                       bool)
@@ -1433,7 +1548,11 @@ void CSeqDBIsam::IdsToOids(int              vol_start,
         break;
 
     case eStringId:
-        x_TranslateGiList<string>(vol_start, ids);
+        if (m_AccessionHash.NotEmpty() && m_KeyVerifier) {
+            x_HashTranslateSeqIdList(vol_start, ids);
+        } else {
+            x_TranslateGiList<string>(vol_start, ids);
+        }
         break;
 
     case ePigId:
@@ -1758,5 +1877,109 @@ void CSeqDBIsam::HashToOids(unsigned         hash,
     }
 }
 
+CSeqDBAccessionHash::CSeqDBAccessionHash(CSeqDBAtlas  & atlas,
+                                         const string & dbname,
+                                         char           prot_nucl)
+    : m_Lease (atlas),
+      m_Mask  (0),
+      m_Keys  (NULL),
+      m_Oids  (NULL)
+{
+    m_Fname = dbname + '.' + prot_nucl + "ai";
+    x_Init();
+}
+
+CSeqDBAccessionHash::~CSeqDBAccessionHash()
+{
+    UnLease();
+}
+
+bool CSeqDBAccessionHash::Exists(const string & dbname, char prot_nucl)
+{
+    return CFile(dbname + '.' + prot_nucl + "ai").Exists();
+}
+
+bool CSeqDBAccessionHash::Enabled()
+{
+    const char * value = getenv("BLASTDB_ACCESSION_HASH");
+    return ! (value && string(value) == "0");
+}
+
+void CSeqDBAccessionHash::x_Init()
+{
+    m_Lease.Init(m_Fname);
+
+    const Int4 * header = (const Int4 *) m_Lease.GetFileDataPtr(0);
+
+    Int4 version = SeqDB_GetStdOrd(header);
+    Int4 slots   = SeqDB_GetStdOrd(header + 2);
+
+    if (version != 1 || slots <= 0 || (slots & (slots - 1))) {
+        NCBI_THROW(CSeqDBException,
+                   eFileErr,
+                   "Error: Invalid accession hash index " + m_Fname);
+    }
+
+    m_Mask = (Uint8) slots - 1;
+    m_Keys = (const Uint8 *) m_Lease.GetFileDataPtr(4 * sizeof(Int4));
+    m_Oids = (const Int4 *) (m_Keys + slots);
+}
+
+void CSeqDBAccessionHash::UnLease()
+{
+    CWriteLockGuard guard(m_Lock);
+
+    m_Lease.Clear();
+    m_Keys = NULL;
+    m_Oids = NULL;
+}
+
+bool CSeqDBAccessionHash::Lookup(const string & key, vector<TOid> & oids)
+{
+    const Uint8 fp = SeqDB_AccessionHash(key.data(), key.size());
+
+    // The table is mapped when the object is created; lookups share the
+    // read lock and only exclude UnLease() and the remap that follows it.
+
+    for(;;) {
+        {
+            CReadLockGuard guard(m_Lock);
+
+            if (m_Keys) {
+                return x_Probe(fp, oids);
+            }
+        }
+
+        CWriteLockGuard guard(m_Lock);
+
+        if (! m_Keys) {
+            x_Init();
+        }
+    }
+}
+
+bool CSeqDBAccessionHash::x_Probe(Uint8 fp, vector<TOid> & oids) const
+{
+    bool found = false;
+
+    // Entries for one key need not be adjacent, so walk the probe
+    // sequence until an empty slot.  The load factor is at most 3/4.
+
+    for(Uint8 slot = fp & m_Mask; ; slot = (slot + 1) & m_Mask) {
+        Uint8 stored = SeqDB_GetStdOrd(m_Keys + slot);
+
+        if (stored == 0) {
+            break;
+        }
+
+        if (stored == fp) {
+            oids.push_back(SeqDB_GetStdOrd(m_Oids + slot));
+            found = true;
+        }
+    }
+
+    return found;
+}
+
 END_NCBI_SCOPE
 
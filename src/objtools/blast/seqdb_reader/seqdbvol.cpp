@@ -36,6 +36,7 @@
 
 #include <objects/general/general__.hpp>
 #include <objects/seqfeat/seqfeat__.hpp>
+#include <objects/seqloc/PDB_seq_id.hpp>
 
 #include <serial/objistr.hpp>
 #include <serial/objostr.hpp>
@@ -43,6 +44,7 @@
 #include <serial/objostrasnb.hpp>
 #include <serial/serial.hpp>
 #include <corelib/ncbimtx.hpp>
+#include <corelib/ncbi_system.hpp>
 
 #include <sstream>
 
@@ -114,6 +116,15 @@ CSeqDBVol::OpenSeqFile(CSeqDBLockHold & locked) const{
     if (!m_SeqFileOpened) x_OpenSeqFile();
 }
 
+void
+CSeqDBVol::PrepareImmutable()
+{
+    if (!m_SeqFileOpened) x_OpenSeqFile();
+    if (m_Idx->GetNumOIDs() != 0) {
+        m_Idx->PinOffsets();
+    }
+}
+
 void
 CSeqDBVol::x_OpenSeqFile(void) const {
     static CFastMutex mtx;
@@ -181,6 +192,7 @@ CSeqDBVol::x_OpenStrFile(void) const{
                            (m_IsAA?'p':'n'),
                            's',
                            eStringId);
+        m_IsamStr->SetKeyVerifier(this);
     }
     m_StrFileOpened = true;
 }
@@ -1589,18 +1601,38 @@ int CSeqDBVol::x_GetAmbigSeq(int                oid,
     if (base_length < 1)
         NCBI_THROW(CSeqDBException, eFileErr, "Error: could not get sequence or range.");
 
+    bool sentinel = (m_Idx->GetSeqType() == 'n' &&
+                     nucl_code == kSeqDBNuclBlastNA8);
+    *buffer = x_AllocType(base_length + (sentinel ? 2 : 0), alloc_type, locked);
+
+    x_DecodeAmbigSeq(oid, tmp, *buffer, nucl_code, region != NULL, range, masks);
+
+    // Clear the masks after consumption
+    if (masks) masks->clear();
+
+    return base_length;
+}
+
+void CSeqDBVol::x_DecodeAmbigSeq(int                       oid,
+                                 const char              * tmp,
+                                 char                    * buffer,
+                                 int                       nucl_code,
+                                 bool                      has_region,
+                                 const SSeqDBSlice       & range,
+                                 CSeqDB::TSequenceRanges * masks) const
+{
+    int base_length = range.end - range.begin;
+
     if (m_Idx->GetSeqType() == 'p') {
 
         tmp += range.begin;
-        *buffer = x_AllocType(base_length, alloc_type, locked);
-        memcpy(*buffer, tmp, base_length);
-        s_SeqDBMaskSequence(*buffer - range.begin, masks, (char)21, range);
+        memcpy(buffer, tmp, base_length);
+        s_SeqDBMaskSequence(buffer - range.begin, masks, (char)21, range);
 
     } else {
 
         bool sentinel = (nucl_code == kSeqDBNuclBlastNA8);
-        *buffer = x_AllocType(base_length + (sentinel ? 2 : 0), alloc_type, locked);
-        char *seq = *buffer - range.begin + (sentinel ? 1 : 0);
+        char *seq = buffer - range.begin + (sentinel ? 1 : 0);
 
         // Get ambiguity characters.
 
@@ -1615,7 +1647,7 @@ int CSeqDBVol::x_GetAmbigSeq(int                oid,
 
         TRangeCache::iterator rciter = m_RangeCache.find(oid);
         bool use_range_set = true;
-        if (region
+        if (has_region
          || rciter == m_RangeCache.end()
          || rciter->second->GetRanges().empty()
          || CSeqDBRangeList::ImmediateLength() >= base_length)
@@ -1629,7 +1661,7 @@ int CSeqDBVol::x_GetAmbigSeq(int                oid,
 
         } else {
 
-            _ASSERT (!region);
+            _ASSERT (!has_region);
             const TRangeList & range_set = rciter->second->GetRanges();
 
             // Place 'fence' sentinel bytes around each range; this is done
@@ -1659,17 +1691,116 @@ int CSeqDBVol::x_GetAmbigSeq(int                oid,
 
         // Put back the sentinel at last
         if (sentinel) {
-            (*buffer)[0] = (char)15;
-            (*buffer)[base_length+1] = (char)15;
+            buffer[0] = (char)15;
+            buffer[base_length+1] = (char)15;
         }
     }
+}
 
-    // Clear the masks after consumption
-    if (masks) masks->clear();
+int CSeqDBVol::AppendAmbigSeq(int            oid,
+                              int            nucl_code,
+                              vector<char> & buffer) const
+{
+    const char * tmp(0);
+    int base_length = x_GetSequence(oid, &tmp, false, false);
+
+    if (base_length < 1)
+        NCBI_THROW(CSeqDBException, eFileErr, "Error: could not get sequence or range.");
+
+    bool sentinel = (m_Idx->GetSeqType() == 'n' &&
+                     nucl_code == kSeqDBNuclBlastNA8);
+
+    size_t offset = buffer.size();
+    buffer.resize(offset + base_length + (sentinel ? 2 : 0));
+
+    x_DecodeAmbigSeq(oid, tmp, & buffer[offset], nucl_code, false,
+                     SSeqDBSlice(0, base_length), NULL);
 
     return base_length;
 }
 
+/// Byte ranges of mapped memory, as [begin, end) address pairs.
+typedef vector< pair<const char *, const char *> > TAddrRanges;
+
+/// Advise the kernel that a set of mapped ranges will be needed.
+///
+/// Ranges closer together than the merge gap are coalesced so that
+/// one madvise() call covers them, which also lets the kernel issue
+/// larger reads; each merged range is widened to page boundaries as
+/// madvise() requires.
+///
+/// @param ranges
+///   The ranges to advise; sorted and merged in place. [in|out]
+static void s_SeqDBAdviseWillNeed(TAddrRanges & ranges)
+{
+    static const size_t kMergeGap = 64 * 1024;
+
+    if (ranges.empty()) return;
+
+    const size_t page = CSystemInfo::GetVirtualMemoryPageSize();
+    std::sort(ranges.begin(), ranges.end());
+
+    size_t out = 0;
+    for (size_t i = 1; i < ranges.size(); i++) {
+        if (ranges[i].first <= ranges[out].second + kMergeGap) {
+            ranges[out].second = max(ranges[out].second, ranges[i].second);
+        } else {
+            ranges[++out] = ranges[i];
+        }
+    }
+    ranges.resize(out + 1);
+
+    ITERATE(TAddrRanges, it, ranges) {
+        size_t begin = (size_t) it->first & ~(page - 1);
+        size_t len   = (size_t) it->second - begin;
+        if (len) {
+            CMemoryFileMap::MemMapAdviseAddr((void *) begin, len,
+                                             CMemoryFileMap::eMMA_WillNeed);
+        }
+    }
+}
+
+void CSeqDBVol::PrefetchSequences(const vector<int> & oids) const
+{
+    if (!m_SeqFileOpened) x_OpenSeqFile();
+    if (m_Seq.Empty() || oids.empty()) return;
+
+    bool is_nucl = (m_Idx->GetSeqType() == 'n');
+    int num_oids = m_Idx->GetNumOIDs();
+
+    TAddrRanges idx_ranges, seq_ranges;
+    idx_ranges.reserve(is_nucl ? 2 * oids.size() : oids.size());
+    seq_ranges.reserve(oids.size());
+
+    const char * seq_base = m_Seq->GetFileDataPtr(0);
+
+    ITERATE(vector<int>, oid, oids) {
+        if (*oid < 0 || *oid >= num_oids) continue;
+
+        const char * off = m_Idx->GetSeqOffsetAddr(*oid);
+        idx_ranges.push_back(make_pair(off, off + 2 * sizeof(Uint4)));
+        if (is_nucl) {
+            off = m_Idx->GetAmbOffsetAddr(*oid);
+            idx_ranges.push_back(make_pair(off, off + sizeof(Uint4)));
+        }
+
+        // The sequence data is followed by its ambiguity data, both
+        // ending at the start of the next sequence.
+        TIndx start = 0, end = 0;
+        m_Idx->GetSeqStartEnd(*oid, start, end);
+        if (is_nucl) {
+            TIndx amb_start = 0;
+            m_Idx->GetAmbStartEnd(*oid, amb_start, end);
+        }
+        if (end > start) {
+            seq_ranges.push_back(make_pair(seq_base + start, seq_base + end));
+        }
+    }
+
+    s_SeqDBAdviseWillNeed(idx_ranges);
+    s_SeqDBAdviseWillNeed(seq_ranges);
+}
+
 void SeqDB_UnpackAmbiguities(const CTempString & sequence,
                              const CTempString & ambiguities,
                              string            & result)
@@ -1823,6 +1954,134 @@ list< CRef<CSeq_id> > CSeqDBVol::GetSeqIDs(int  oid) const
     return seqids;
 }
 
+/// Build the string ISAM keys CWriteDB stores for a Seq-id.
+///
+/// This mirrors CWriteDB_IsamIndex::x_AddStringIds() and includes
+/// the keys that sparse databases omit.
+///
+/// @param seqid The Seq-id. [in]
+/// @param keys  The keys are appended here. [out]
+static void
+s_SeqDBGetStringKeys(const CSeq_id & seqid, vector<string> & keys)
+{
+    switch(seqid.Which()) {
+    case CSeq_id::e_Gi:
+        break;
+
+    case CSeq_id::e_Pdb:
+        {
+            const CPDB_seq_id & pdb = seqid.GetPdb();
+
+            if (pdb.CanGetMol()) {
+                keys.push_back(pdb.GetMol().Get());
+            }
+
+            string full_id = seqid.AsFastaString();
+            keys.push_back(full_id);
+
+            if (full_id.size() > 4) {
+                string short_id(full_id, 4);
+                keys.push_back(short_id);
+
+                size_t len = short_id.size();
+
+                if (len > 2 && short_id[len-2] == '|') {
+                    short_id[len-2] = ' ';
+                    keys.push_back(short_id);
+                } else if (len > 3 && short_id[len-3] == '|') {
+                    short_id[len-3] = ' ';
+                    keys.push_back(short_id);
+                }
+            }
+        }
+        break;
+
+    case CSeq_id::e_Local:
+        keys.push_back(seqid.AsFastaString());
+
+        if (seqid.GetLocal().IsStr()) {
+            keys.push_back(seqid.GetLocal().GetStr());
+        }
+        break;
+
+    case CSeq_id::e_General:
+        {
+            keys.push_back(seqid.AsFastaString());
+
+            const CDbtag & dbt = seqid.GetGeneral();
+
+            if (dbt.CanGetTag() && dbt.GetTag().IsStr()) {
+                keys.push_back(dbt.GetTag().GetStr());
+            }
+        }
+        break;
+
+    default:
+        {
+            const CTextseq_id * textid = seqid.GetTextseq_Id();
+
+            if (! textid) {
+                keys.push_back(seqid.AsFastaString());
+                break;
+            }
+
+            string acc;
+
+            if (textid->CanGetAccession()) {
+                acc = textid->GetAccession();
+            }
+
+            if (! acc.empty()) {
+                keys.push_back(acc);
+            }
+
+            if (textid->CanGetName() && ! textid->GetName().empty()) {
+                keys.push_back(textid->GetName());
+            }
+
+            if (! acc.empty() &&
+                textid->CanGetVersion() &&
+                textid->GetVersion()) {
+
+                keys.push_back(acc + "." +
+                               NStr::IntToString(textid->GetVersion()));
+            }
+        }
+    }
+}
+
+bool CSeqDBVol::HasStringKey(int oid, const string & key) const
+{
+    // The header is read unfiltered: membership bits and user lists
+    // do not change which keys the ISAM holds for the sequence.
+
+    CRef<CBlast_def_line_set> defline_set = x_GetHdrAsn1(oid, false, NULL);
+
+    if (defline_set.Empty() || ! defline_set->CanGet()) {
+        return false;
+    }
+
+    vector<string> keys;
+
+    ITERATE(list< CRef<CBlast_def_line> >, defline, defline_set->Get()) {
+        if (! (*defline)->CanGetSeqid()) {
+            continue;
+        }
+
+        ITERATE(list< CRef<CSeq_id> >, seqid, (*defline)->GetSeqid()) {
+            s_SeqDBGetStringKeys(**seqid, keys);
+        }
+    }
+
+    ITERATE(vector<string>, iter, keys) {
+        if (NStr::EqualNocase(*iter, key)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
 TGi CSeqDBVol::GetSeqGI(int              oid,
                         CSeqDBLockHold & locked) const
 {
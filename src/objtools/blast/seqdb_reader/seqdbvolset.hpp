@@ -225,6 +225,42 @@ public:
         return const_cast<CSeqDBVol*>(FindVol(oid, vol_oid, vol_idx));
     }
     
+    /// Find a volume by OID without touching shared state.
+    ///
+    /// Unlike FindVol(), this does not update the most-recently-used
+    /// volume hint; it binary searches the (ordered) volume list, so
+    /// concurrent calls from many threads neither race nor contend
+    /// for the same cache line.
+    ///
+    /// @param oid
+    ///   The global OID to search for.
+    /// @param vol_oid
+    ///   The returned OID within the relevant volume.
+    /// @return
+    ///   A pointer to the volume containing the oid, or NULL.
+    const CSeqDBVol * FindVolShared(int oid, int & vol_oid) const
+    {
+        int lo = 0;
+        int hi = (int) m_VolList.size();
+        
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            
+            if (m_VolList[mid].OIDEnd() <= oid) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        
+        if (lo < (int) m_VolList.size() && m_VolList[lo].OIDStart() <= oid) {
+            vol_oid = oid - m_VolList[lo].OIDStart();
+            return m_VolList[lo].Vol();
+        }
+        
+        return NULL;
+    }
+    
     /// Find a volume by OID.
     /// 
     /// Many of the CSeqDB methods identify which sequence to use by
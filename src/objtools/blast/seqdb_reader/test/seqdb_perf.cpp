@@ -105,6 +105,11 @@ private:
     /// Processes all requests except printing the BLAST database information
     /// @return 0 on success; 1 if some sequences were not retrieved
     int x_ScanDatabase();
+
+    /// Times CSeqDB::AccessionToOids for each accession in a file
+    /// (handles -lookup_accessions command line option)
+    /// @return 0 on success; 1 if some accessions were not found
+    int x_LookupAccessions();
 };
 
 void
@@ -223,7 +228,11 @@ CSeqDBPerfApp::x_InitApplicationData()
 
         m_DbHandles.reserve(kNumThreads);
         m_DbHandles.push_back(m_BlastDb);
-        if (kNumThreads > 1) {
+        if (args["immutable"]) {
+            // One shared handle, read without the atlas lock
+            m_BlastDb->SetImmutableMode();
+            m_DbHandles.resize(kNumThreads, m_BlastDb);
+        } else if (kNumThreads > 1) {
             for (int i = 1; i < kNumThreads; i++) {
                 m_BlastDb.Reset(new CSeqDBExpert(kDbName, kSeqType));
                 m_DbHandles.push_back(m_BlastDb);
@@ -278,6 +287,51 @@ CSeqDBPerfApp::x_PrintBlastDatabaseInformation()
     return 0;
 }
 
+int
+CSeqDBPerfApp::x_LookupAccessions()
+{
+    _ASSERT(m_BlastDb.NotEmpty());
+    const CArgs& args = GetArgs();
+    CNcbiIstream& in = args["lookup_accessions"].AsInputFile();
+
+    vector<string> accessions;
+    string line;
+    while (NcbiGetlineEOL(in, line)) {
+        NStr::TruncateSpacesInPlace(line);
+        if ( !line.empty() ) {
+            accessions.push_back(line);
+        }
+    }
+
+    const char* hash = getenv("BLASTDB_ACCESSION_HASH");
+    const string kMethod = m_BlastDb->GetBlastDbVersion() == eBDB_Version5
+        ? "LMDB"
+        : ((hash && string(hash) == "0") ? "ISAM (accession hash disabled)"
+                                         : "accession hash if present, else ISAM");
+
+    CStopWatch sw;
+    size_t found = 0, num_oids = 0;
+    vector<int> oids;
+    sw.Start();
+    ITERATE(vector<string>, acc, accessions) {
+        oids.clear();
+        m_BlastDb->AccessionToOids(*acc, oids);
+        found += oids.empty() ? 0 : 1;
+        num_oids += oids.size();
+    }
+    sw.Stop();
+    x_UpdateMemoryUsage();
+
+    cout << "Accession lookups via " << kMethod << ": " << accessions.size()
+         << " accessions, " << found << " found, " << num_oids << " OIDs" << endl;
+    cout << "Time to look up accessions: " << sw.AsSmartString() << endl;
+    if ( !accessions.empty() ) {
+        cout << "Average time per lookup: "
+             << (sw.Elapsed() * 1e6 / accessions.size()) << " us" << endl;
+    }
+    return found == accessions.size() ? 0 : 1;
+}
+
 void CSeqDBPerfApp::Init()
 {
     HideStdArgs(fHideConffile | fHideFullVersion | fHideXmlHelp | fHideDryRun);
@@ -320,6 +374,20 @@ void CSeqDBPerfApp::Init()
                             "get_metadata");
     arg_desc->SetDependency("scan_uncompressed", CArgDescriptions::eExcludes,
                             "get_metadata");
+    arg_desc->AddOptionalKey("lookup_accessions", "input_file",
+                             "Time AccessionToOids for each accession in this "
+                             "file, one per line (set BLASTDB_ACCESSION_HASH=0 "
+                             "to compare against the string ISAM)",
+                             CArgDescriptions::eInputFile);
+    arg_desc->SetDependency("lookup_accessions", CArgDescriptions::eExcludes,
+                            "get_metadata");
+    arg_desc->SetDependency("lookup_accessions", CArgDescriptions::eExcludes,
+                            "scan_compressed");
+    arg_desc->SetDependency("lookup_accessions", CArgDescriptions::eExcludes,
+                            "scan_uncompressed");
+    arg_desc->AddFlag("immutable",
+                      "Share one CSeqDB object in immutable (lock-free) mode "
+                      "among all threads", true);
 
     arg_desc->AddDefaultKey("num_threads", "number",
                             "Number of threads to use (requires OpenMP)",
@@ -346,6 +414,8 @@ int CSeqDBPerfApp::Run(void)
             return status;
         if (args["get_metadata"]) {
             status = x_PrintBlastDatabaseInformation();
+        } else if (args["lookup_accessions"]) {
+            status = x_LookupAccessions();
         } else {
             status = x_ScanDatabase();
         }
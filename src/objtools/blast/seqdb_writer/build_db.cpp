@@ -1522,6 +1522,11 @@ void CBuildDatabase::SetMaxFileSize(Uint8 max_file_size)
     m_OutputDb->SetMaxFileSize(max_file_size);
 }
 
+void CBuildDatabase::SetNumberOfThreads(int num_threads)
+{
+    m_OutputDb->SetNumberOfThreads(num_threads);
+}
+
 int
 CBuildDatabase::RegisterMaskingAlgorithm(EBlast_filter_program program,
                                          const string        & options,
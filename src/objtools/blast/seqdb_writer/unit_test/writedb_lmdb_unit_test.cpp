@@ -145,7 +145,89 @@ BOOST_AUTO_TEST_CASE(CreateLMDBFile)
 	DeleteLMDBFiles(true, base_name);
 }
 
+static void s_BuildLMDB(const string & base_name, CSeqDB & source_db)
+{
+	DeleteLMDBFiles(true, base_name);
+	const string lmdb_name = BuildLMDBFileName(base_name, true);
+	const string tax_lmdb = GetFileNameFromExistingLMDBFile(lmdb_name, ELMDBFileType::eTaxId2Offsets);
+	CWriteDB_LMDB test_db(lmdb_name, 100000);
+	CWriteDB_TaxID taxdb(tax_lmdb, 100000);
+	const int taxids[5] = { 9606, 562, 0, 2, 10239 };
+	for (int i=0; i < source_db.GetNumOIDs(); i++) {
+		list< CRef<CSeq_id> >  ids = source_db.GetSeqIDs(i);
+		test_db.InsertEntries(ids, i);
+		set<int> t;
+		for(int j=0; j < (i % 5 + 1); j++) {
+			t.insert(taxids[j]);
+		}
+		taxdb.InsertEntries(t, i);
+	}
+	test_db.InsertVolumesInfo(vector<string>(1, base_name),
+	                          vector<blastdb::TOid>(1, source_db.GetNumOIDs()));
+}
 
+BOOST_AUTO_TEST_CASE(CreateLMDBFileFromSortedRuns)
+{
+	const string kInMemory = "tmp_lmdb_mem";
+	const string kSpilled = "tmp_lmdb_runs";
+	CSeqDB source_db("data/writedb_prot",CSeqDB::eProtein);
+
+	s_BuildLMDB(kInMemory, source_db);
+
+	// A tiny budget spills every oid into its own sorted run
+	CNcbiEnvironment & env = CNcbiApplication::Instance()->SetEnvironment();
+	env.Set("LMDB_SORT_MEMORY", "1KB");
+	s_BuildLMDB(kSpilled, source_db);
+	env.Unset("LMDB_SORT_MEMORY");
+
+	const string mem_lmdb = BuildLMDBFileName(kInMemory, true);
+	const string run_lmdb = BuildLMDBFileName(kSpilled, true);
+	const ELMDBFileType kLookupFiles[] = { ELMDBFileType::eOid2SeqIds,
+	                                       ELMDBFileType::eOid2TaxIds,
+	                                       ELMDBFileType::eTaxId2Oids };
+	for (auto type: kLookupFiles) {
+		CFile f(GetFileNameFromExistingLMDBFile(mem_lmdb, type));
+		BOOST_REQUIRE(f.Exists());
+		BOOST_REQUIRE(f.Compare(GetFileNameFromExistingLMDBFile(run_lmdb, type)));
+	}
+
+	{
+		CSeqDBLMDB test_db(run_lmdb);
+		for(int i=0; i < source_db.GetNumOIDs(); i++) {
+			vector<string> test_accs;
+			vector<blastdb::TOid> test_oids;
+			list< CRef<CSeq_id> >  ids = source_db.GetSeqIDs(i);
+			ITERATE(list< CRef<CSeq_id> >, itr, ids) {
+				if((*itr)->IsGi()) {
+					continue;
+				}
+				test_accs.push_back((*itr)->GetSeqIdString(true));
+				test_accs.push_back((*itr)->GetSeqIdString(false));
+			}
+			test_db.GetOids(test_accs, test_oids);
+			for(unsigned int j=0; j < test_accs.size(); j++) {
+				BOOST_REQUIRE_EQUAL(test_oids[j], i);
+			}
+		}
+
+		vector<blastdb::TOid> tax_oids;
+		set<Int4> tax_ids;
+		tax_ids.insert(10239);
+		vector<Int4> rv_tax_ids;
+		test_db.GetOidsForTaxIds(tax_ids, tax_oids, rv_tax_ids);
+		BOOST_REQUIRE_EQUAL(tax_oids.size(), (size_t) source_db.GetNumOIDs() / 5);
+		for(unsigned int i=0; i < tax_oids.size(); i++) {
+			BOOST_REQUIRE_EQUAL(tax_oids[i] % 5, 4);
+		}
+	}
+
+	// No temporary run files are left behind
+	CDir::TEntries tmp_files = CDir(".").GetEntries(kSpilled + "*.tmp");
+	BOOST_REQUIRE(tmp_files.empty());
+
+	DeleteLMDBFiles(true, kInMemory);
+	DeleteLMDBFiles(true, kSpilled);
+}
 
 BOOST_AUTO_TEST_SUITE_END()
 
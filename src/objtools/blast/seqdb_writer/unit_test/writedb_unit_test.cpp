@@ -49,6 +49,7 @@
 #include <objtools/blast/seqdb_writer/writedb_isam.hpp>
 #include <objtools/blast/seqdb_writer/seqidlist_writer.hpp>
 #include <objtools/blast/seqdb_reader/impl/seqdbisam.hpp>
+#include <objtools/blast/seqdb_reader/impl/seqdb_lmdb.hpp>
 #include <objtools/blast/seqdb_reader/seqidlist_reader.hpp>
 #include <objects/seqset/Seq_entry.hpp>
 
@@ -1320,6 +1321,179 @@ BOOST_AUTO_TEST_CASE(MultiVolume)
     s_WrapUpFiles(f);
 }
 
+BOOST_AUTO_TEST_CASE(AppendToExisting)
+{
+    const string kDbName("appenddb");
+    CSeqDB wdb("data/writedb_prot", CSeqDB::eProtein);
+
+    int gis[] = { 129295, 129296, 129297, 129299, 0 };
+    Uint8 letter_count = 0;
+
+    // The first two sequences make a single volume database, and the
+    // rest are appended to it as a new volume.
+    for(int pass = 0; pass < 2; pass++) {
+        CWriteDB db(kDbName,
+                    CWriteDB::eProtein,
+                    "title",
+                    CWriteDB::eFullIndex);
+
+        if (pass) {
+            db.AppendToExisting();
+        }
+
+        for(int i = 2*pass; i < 2*pass+2; i++) {
+            int oid(0);
+            wdb.GiToOid(gis[i], oid);
+
+            db.AddSequence(*wdb.GetBioseq(oid));
+            letter_count += wdb.GetSeqLength(oid);
+        }
+        db.Close();
+    }
+
+    CRef<CSeqDB> seqdb(new CSeqDB(kDbName, CSeqDB::eProtein));
+
+    vector<string> v;
+    seqdb->FindVolumePaths(v, false);
+    BOOST_REQUIRE_EQUAL(2, (int) v.size());
+    BOOST_REQUIRE_EQUAL(CDirEntry(v[0]).GetName(), kDbName + ".00");
+    BOOST_REQUIRE_EQUAL(CDirEntry(v[1]).GetName(), kDbName + ".01");
+
+    BOOST_REQUIRE_EQUAL(4, seqdb->GetNumSeqs());
+    BOOST_REQUIRE_EQUAL(letter_count, seqdb->GetTotalLength());
+
+    for(int i = 0; gis[i]; i++) {
+        int oid(-1);
+        BOOST_REQUIRE(seqdb->GiToOid(gis[i], oid));
+        BOOST_REQUIRE_EQUAL(i, oid);
+    }
+
+    seqdb.Reset();
+    DeleteBlastDb(kDbName, CSeqDB::eProtein);
+}
+
+/// Add the sequences of src in [begin, end) to db, with tax ids that
+/// depend on the OID.
+static void s_AddWithTaxIds(CWriteDB & db, CSeqDB & src, int begin, int end)
+{
+    for(int oid = begin; oid < end; oid++) {
+        CRef<CBlast_def_line_set> hdr = src.GetHdr(oid);
+        NON_CONST_ITERATE(CBlast_def_line_set::Tdata, iter, hdr->Set()) {
+            (**iter).SetTaxid(9600 + oid % 7);
+        }
+        db.AddSequence(*src.GetBioseq(oid));
+        db.SetDeflines(*hdr);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(AppendToExistingV5)
+{
+    const string kOnePass("appenddb_v5_one");
+    const string kAppended("appenddb_v5");
+    CSeqDB wdb("data/writedb_prot", CSeqDB::eProtein);
+    const int kNumOids = wdb.GetNumOIDs();
+    const int kSplit = kNumOids / 3;
+
+    // Small transactions and sort memory make the appended entries go
+    // through several commits and spilled sorted runs.
+    CNcbiEnvironment & env = CNcbiApplication::Instance()->SetEnvironment();
+    env.Set("BLASTDB_LMDB_MAP_SIZE", "10000000");
+    env.Set("MAX_LMDB_TXN_ENTRY", "10");
+    env.Set("LMDB_SORT_MEMORY", "2000");
+
+    {
+        CWriteDB db(kOnePass, CWriteDB::eProtein, "title",
+                    CWriteDB::eFullIndex, true, false, false, eBDB_Version5);
+        s_AddWithTaxIds(db, wdb, 0, kNumOids);
+        db.Close();
+    }
+    for(int pass = 0; pass < 2; pass++) {
+        CWriteDB db(kAppended, CWriteDB::eProtein, "title",
+                    CWriteDB::eFullIndex, true, false, false, eBDB_Version5);
+        if (pass) {
+            db.AppendToExisting();
+        }
+        s_AddWithTaxIds(db, wdb, pass ? kSplit : 0, pass ? kNumOids : kSplit);
+        db.Close();
+    }
+
+    env.Unset("MAX_LMDB_TXN_ENTRY");
+    env.Unset("LMDB_SORT_MEMORY");
+
+    // The OID lookup files are extended to what a one pass build makes
+    BOOST_REQUIRE(CFile(kAppended + ".pos").Compare(kOnePass + ".pos"));
+    BOOST_REQUIRE(CFile(kAppended + ".pot").Compare(kOnePass + ".pot"));
+
+    {
+        // The volume information is rewritten for the renamed volume
+        vector<string> vol_names;
+        vector<blastdb::TOid> vol_num_oids;
+        CSeqDBLMDB lmdb(BuildLMDBFileName(kAppended, true));
+        lmdb.GetVolumesInfo(vol_names, vol_num_oids);
+        BOOST_REQUIRE_EQUAL(2, (int) vol_names.size());
+        BOOST_REQUIRE_EQUAL(vol_names[0], kAppended + ".00");
+        BOOST_REQUIRE_EQUAL(vol_names[1], kAppended + ".01");
+        BOOST_REQUIRE_EQUAL(kSplit, vol_num_oids[0]);
+        BOOST_REQUIRE_EQUAL(kNumOids - kSplit, vol_num_oids[1]);
+    }
+
+    CSeqDB one_pass(kOnePass, CSeqDB::eProtein);
+    CSeqDB appended(kAppended, CSeqDB::eProtein);
+    BOOST_REQUIRE_EQUAL(kNumOids, appended.GetNumOIDs());
+
+    // Accessions of both parts are found in the LMDB index updated in place
+    vector<string> accessions;
+    for(int oid = 0; oid < kNumOids; oid++) {
+        list< CRef<CSeq_id> > ids = wdb.GetSeqIDs(oid);
+        ITERATE(list< CRef<CSeq_id> >, id, ids) {
+            if ( !(**id).IsGi() ) {
+                accessions.push_back((**id).GetSeqIdString(true));
+            }
+        }
+    }
+    BOOST_REQUIRE(!accessions.empty());
+    vector<blastdb::TOid> one_pass_oids, appended_oids;
+    one_pass.AccessionsToOids(accessions, one_pass_oids);
+    appended.AccessionsToOids(accessions, appended_oids);
+    BOOST_REQUIRE_EQUAL_COLLECTIONS(one_pass_oids.begin(), one_pass_oids.end(),
+                                    appended_oids.begin(), appended_oids.end());
+    BOOST_REQUIRE(find(appended_oids.begin(), appended_oids.end(),
+                       kSeqDBEntryNotFound) == appended_oids.end());
+
+    // The tax ids of the new OIDs are indexed next to the existing ones
+    set<Int4> one_pass_taxids, appended_taxids;
+    one_pass.GetDBTaxIds(one_pass_taxids);
+    appended.GetDBTaxIds(appended_taxids);
+    BOOST_REQUIRE_EQUAL(7, (int) appended_taxids.size());
+    BOOST_REQUIRE_EQUAL_COLLECTIONS(one_pass_taxids.begin(), one_pass_taxids.end(),
+                                    appended_taxids.begin(), appended_taxids.end());
+    for(Int4 taxid = 9600; taxid < 9600 + 7; taxid++) {
+        set<Int4> one_pass_query, appended_query;
+        one_pass_query.insert(taxid);
+        appended_query.insert(taxid);
+        vector<blastdb::TOid> one_pass_tax_oids, appended_tax_oids;
+        one_pass.TaxIdsToOids(one_pass_query, one_pass_tax_oids);
+        appended.TaxIdsToOids(appended_query, appended_tax_oids);
+        sort(one_pass_tax_oids.begin(), one_pass_tax_oids.end());
+        sort(appended_tax_oids.begin(), appended_tax_oids.end());
+        BOOST_REQUIRE(!appended_tax_oids.empty());
+        BOOST_REQUIRE(appended_tax_oids.back() >= kSplit);
+        BOOST_REQUIRE_EQUAL_COLLECTIONS(one_pass_tax_oids.begin(),
+                                        one_pass_tax_oids.end(),
+                                        appended_tax_oids.begin(),
+                                        appended_tax_oids.end());
+    }
+    for(int oid = 0; oid < kNumOids; oid++) {
+        vector<int> taxids;
+        appended.GetTaxIDs(oid, taxids);
+        BOOST_REQUIRE_EQUAL(1, (int) taxids.size());
+        BOOST_REQUIRE_EQUAL(9600 + oid % 7, taxids.front());
+    }
+
+    DeleteBlastDb(kOnePass, CSeqDB::eProtein);
+    DeleteBlastDb(kAppended, CSeqDB::eProtein);
+}
+
 BOOST_AUTO_TEST_CASE(UsPatId)
 {
 
@@ -2815,6 +2989,434 @@ private:
 	CTypeIterator<CBioseq> m_Bioseq;
 };
 
+/// Number of sequences in s_MakeLargeProtFasta() input; more than two
+/// batches of a multi-threaded build.
+static const int kLargeFastaSeqs = 10000;
+
+/// Make FASTA protein input large enough for a multi-threaded build,
+/// with a taxid mapping for its accessions.
+static void s_MakeLargeProtFasta(string         & fasta,
+                                 string         & taxid_map,
+                                 vector<string> & accessions)
+{
+    static const char kLetters[] = "ACDEFGHIKLMNPQRSTVWY";
+    Uint4 state = 12345;
+    ostringstream seqs, taxids;
+
+    accessions.clear();
+    for(int i = 0; i < kLargeFastaSeqs; i++) {
+        string acc = "XP_" + NStr::IntToString(100000 + i) + ".1";
+        accessions.push_back(acc);
+        seqs << ">gi|" << (2000000 + i) << "|ref|" << acc << "| protein "
+             << i << "\n";
+
+        state = state * 1103515245 + 12345;
+        int length = 30 + (state >> 16) % 120;
+        for(int j = 0; j < length; j++) {
+            state = state * 1103515245 + 12345;
+            seqs << kLetters[(state >> 16) % 20];
+        }
+        seqs << "\n";
+        taxids << acc << " " << (9600 + i % 17) << "\n";
+    }
+    fasta = seqs.str();
+    taxid_map = taxids.str();
+}
+
+/// List the files of a database built by s_BuildMultiVolumeProtDb().
+static vector<string> s_ListDbFiles(const string & dbname)
+{
+    CDir dir(CDirEntry(dbname).GetDir());
+    CDir::TEntries entries =
+        dir.GetEntries(CDirEntry(dbname).GetName() + ".*",
+                       CDir::fIgnoreRecursive | CDir::fIgnorePath);
+    vector<string> files;
+    ITERATE(CDir::TEntries, iter, entries) {
+        files.push_back((*iter)->GetName());
+    }
+    sort(files.begin(), files.end());
+    return files;
+}
+
+static int s_BuildMultiVolumeProtDb(const string   & dbname,
+                                    int              num_threads,
+                                    bool             parse_seqids,
+                                    EBlastDbVersion  dbver)
+{
+    string fasta, taxid_map;
+    vector<string> accessions;
+    s_MakeLargeProtFasta(fasta, taxid_map, accessions);
+    istringstream fasta_file(fasta);
+    istringstream taxid_file(taxid_map);
+
+    ostringstream log;
+    CTaxIdSet taxids;
+    taxids.SetMappingFromFile(taxid_file);
+
+    // Without parsed ids, headers carry the OID, and the small file
+    // size forces volume changes within a batch.
+    CBuildDatabase db(dbname, "threaded build", true, false, parse_seqids,
+                      false, &log, false, dbver);
+    db.SetMaxFileSize(100000);
+    db.SetNumberOfThreads(num_threads);
+    db.SetTaxids(taxids);
+    db.StartBuild();
+    db.AddFasta(fasta_file);
+    db.EndBuild();
+
+    vector<string> files = s_ListDbFiles(dbname);
+    int num_vols = 0;
+    ITERATE(vector<string>, iter, files) {
+        CFileDeleteAtExit::Add(CDirEntry(dbname).GetDir() + *iter);
+        if (NStr::EndsWith(*iter, ".psq")) {
+            num_vols++;
+        }
+    }
+    return num_vols;
+}
+
+/// Build a database with one and with four threads, and check that the
+/// results are the same.
+static void s_TestMultiThreadedBuild(const string   & name,
+                                     bool             parse_seqids,
+                                     EBlastDbVersion  dbver)
+{
+    const string kSerial("data/" + name + "_serial");
+    const string kThreaded("data/" + name + "_four");
+
+    int serial_vols =
+        s_BuildMultiVolumeProtDb(kSerial, 1, parse_seqids, dbver);
+    int threaded_vols =
+        s_BuildMultiVolumeProtDb(kThreaded, 4, parse_seqids, dbver);
+
+    BOOST_REQUIRE(serial_vols > 1);
+    BOOST_REQUIRE_EQUAL(serial_vols, threaded_vols);
+
+    // The same files are built.  Index files hold the creation time and
+    // alias files hold volume names; LMDB environments (pdb, ptf) are
+    // compared through lookups below.  Headers, sequences, ISAM indices
+    // and OID lookup files must match byte for byte.
+    vector<string> serial_files = s_ListDbFiles(kSerial);
+    vector<string> threaded_files = s_ListDbFiles(kThreaded);
+    BOOST_REQUIRE_EQUAL(serial_files.size(), threaded_files.size());
+
+    const string kDir = CDirEntry(kSerial).GetDir();
+    for(size_t i = 0; i < serial_files.size(); i++) {
+        string suffix =
+            serial_files[i].substr(CDirEntry(kSerial).GetName().size());
+        BOOST_REQUIRE_EQUAL(CDirEntry(kThreaded).GetName() + suffix,
+                            threaded_files[i]);
+
+        string ext = CDirEntry(serial_files[i]).GetExt();
+        if (ext == ".pin"  ||  ext == ".pal"  ||  ext == ".pdb"  ||
+            ext == ".ptf") {
+            continue;
+        }
+        BOOST_REQUIRE_MESSAGE(CFile(kDir + serial_files[i])
+                              .Compare(kDir + threaded_files[i]),
+                              serial_files[i] + " differs");
+    }
+
+    CSeqDB serial(kSerial, CSeqDB::eProtein);
+    CSeqDB threaded(kThreaded, CSeqDB::eProtein);
+    BOOST_REQUIRE_EQUAL(serial.GetNumSeqs(), kLargeFastaSeqs);
+    BOOST_REQUIRE_EQUAL(serial.GetNumSeqs(), threaded.GetNumSeqs());
+    BOOST_REQUIRE_EQUAL(serial.GetTotalLength(), threaded.GetTotalLength());
+
+    if ( !parse_seqids ) {
+        return;
+    }
+
+    // Accession lookups use the ISAM indices in version 4 and LMDB in
+    // version 5.
+    string fasta, taxid_map;
+    vector<string> accessions;
+    s_MakeLargeProtFasta(fasta, taxid_map, accessions);
+
+    vector<blastdb::TOid> serial_oids, threaded_oids;
+    serial.AccessionsToOids(accessions, serial_oids);
+    threaded.AccessionsToOids(accessions, threaded_oids);
+    BOOST_REQUIRE_EQUAL(serial_oids.size(), accessions.size());
+    for(size_t i = 0; i < accessions.size(); i++) {
+        BOOST_REQUIRE_EQUAL(serial_oids[i], (blastdb::TOid) i);
+        BOOST_REQUIRE_EQUAL(threaded_oids[i], serial_oids[i]);
+    }
+
+    for(int oid = 0; oid < kLargeFastaSeqs; oid += 97) {
+        TGi gi = ZERO_GI;
+        BOOST_REQUIRE(threaded.OidToGi(oid, gi));
+        BOOST_REQUIRE_EQUAL(GI_TO(int, gi), 2000000 + oid);
+        int gi_oid = -1;
+        BOOST_REQUIRE(threaded.GiToOid(gi, gi_oid));
+        BOOST_REQUIRE_EQUAL(gi_oid, oid);
+    }
+
+    if (dbver != eBDB_Version5) {
+        return;
+    }
+
+    // Taxonomy lookups in LMDB
+    for(Int4 taxid = 9600; taxid < 9600 + 17; taxid++) {
+        set<Int4> serial_taxids, threaded_taxids;
+        serial_taxids.insert(taxid);
+        threaded_taxids.insert(taxid);
+        vector<blastdb::TOid> serial_tax_oids, threaded_tax_oids;
+        serial.TaxIdsToOids(serial_taxids, serial_tax_oids);
+        threaded.TaxIdsToOids(threaded_taxids, threaded_tax_oids);
+        sort(serial_tax_oids.begin(), serial_tax_oids.end());
+        sort(threaded_tax_oids.begin(), threaded_tax_oids.end());
+        BOOST_REQUIRE(!serial_tax_oids.empty());
+        BOOST_REQUIRE_EQUAL_COLLECTIONS(serial_tax_oids.begin(),
+                                        serial_tax_oids.end(),
+                                        threaded_tax_oids.begin(),
+                                        threaded_tax_oids.end());
+    }
+    for(int oid = 0; oid < kLargeFastaSeqs; oid += 97) {
+        vector<int> serial_oid_taxids, threaded_oid_taxids;
+        serial.GetTaxIDs(oid, serial_oid_taxids);
+        threaded.GetTaxIDs(oid, threaded_oid_taxids);
+        BOOST_REQUIRE_EQUAL(serial_oid_taxids.size(), 1u);
+        BOOST_REQUIRE_EQUAL(serial_oid_taxids.front(), 9600 + oid % 17);
+        BOOST_REQUIRE_EQUAL_COLLECTIONS(serial_oid_taxids.begin(),
+                                        serial_oid_taxids.end(),
+                                        threaded_oid_taxids.begin(),
+                                        threaded_oid_taxids.end());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(CBuildDatabase_MultiThreadedBuildIsIdentical)
+{
+    s_TestMultiThreadedBuild("threaded", false, eBDB_Version4);
+}
+
+BOOST_AUTO_TEST_CASE(CBuildDatabase_MultiThreadedBuildIsIdenticalParsedIds)
+{
+    s_TestMultiThreadedBuild("threaded_ids", true, eBDB_Version4);
+}
+
+BOOST_AUTO_TEST_CASE(CBuildDatabase_MultiThreadedBuildIsIdenticalV5)
+{
+    CNcbiApplication::Instance()->SetEnvironment()
+        .Set("BLASTDB_LMDB_MAP_SIZE", "10000000");
+    s_TestMultiThreadedBuild("threaded_v5", true, eBDB_Version5);
+}
+
+BOOST_AUTO_TEST_CASE(CBuildDatabase_AccessionHashMatchesIsam)
+{
+    const string kDbName("data/acc_hash");
+    static const char * const kExtns[] =
+        { ".pin", ".phr", ".psq", ".pni", ".pnd", ".psi", ".psd",
+          ".ppi", ".ppd", ".pog", ".pai" };
+    for (size_t i = 0; i < sizeof(kExtns)/sizeof(*kExtns); i++) {
+        CFileDeleteAtExit::Add(kDbName + kExtns[i]);
+    }
+
+    ostringstream log;
+    CNcbiIfstream fasta_file("data/some_prots.fsa");
+    BOOST_REQUIRE(fasta_file);
+    CBuildDatabase db(kDbName, "accession hash", true,
+                      CWriteDB::eDefault | CWriteDB::eAddAccessionHash,
+                      false, &log, false, eBDB_Version4);
+    db.StartBuild();
+    db.AddFasta(fasta_file);
+    db.EndBuild();
+    BOOST_REQUIRE(CFile(kDbName + ".pai").Exists());
+
+    static const char * const kAccessions[] =
+        { "Q6WNV7.1", "Q6WNV7", "q9pfv5", "sp|C0QKZ6.1|", "RS14_LEGPL",
+          "75550147", "Q6WNV7.9", "XX_NOT_THERE" };
+
+    CNcbiApplication::Instance()->SetEnvironment()
+        .Set("BLASTDB_ACCESSION_HASH", "0");
+    vector< vector<int> > isam_oids;
+    {
+        CSeqDB isam_db(kDbName, CSeqDB::eProtein);
+        for (size_t i = 0; i < sizeof(kAccessions)/sizeof(*kAccessions); i++) {
+            vector<int> oids;
+            isam_db.AccessionToOids(kAccessions[i], oids);
+            sort(oids.begin(), oids.end());
+            isam_oids.push_back(oids);
+        }
+    }
+    CNcbiApplication::Instance()->SetEnvironment()
+        .Set("BLASTDB_ACCESSION_HASH", "1");
+
+    CSeqDB hash_db(kDbName, CSeqDB::eProtein);
+    for (size_t i = 0; i < sizeof(kAccessions)/sizeof(*kAccessions); i++) {
+        vector<int> oids;
+        hash_db.AccessionToOids(kAccessions[i], oids);
+        sort(oids.begin(), oids.end());
+        BOOST_REQUIRE_EQUAL_COLLECTIONS(oids.begin(), oids.end(),
+                                        isam_oids[i].begin(),
+                                        isam_oids[i].end());
+    }
+    BOOST_REQUIRE_EQUAL(1U, isam_oids[0].size());
+    BOOST_REQUIRE(isam_oids.back().empty());
+
+    // Seq-id lists are translated through the hash index too
+    static const char * const kListIds[] =
+        { "q6wnv7.1", "q9pfv5", "rs14_legpl", "xx_not_there" };
+    const size_t kNumListIds = sizeof(kListIds)/sizeof(*kListIds);
+
+    map<string, int> list_oids[2];
+    vector<int> included_oids[2];
+    for (int use_hash = 0; use_hash < 2; use_hash++) {
+        CNcbiApplication::Instance()->SetEnvironment()
+            .Set("BLASTDB_ACCESSION_HASH", use_hash ? "1" : "0");
+
+        CRef<CSeqDBGiList> list(new CSeqDBGiList);
+        for (size_t i = 0; i < kNumListIds; i++) {
+            list->AddSi(kListIds[i]);
+        }
+        CSeqDB list_db(kDbName, CSeqDB::eProtein, &*list);
+        for (int i = 0; i < list->GetNumSis(); i++) {
+            const CSeqDBGiList::SSiOid & si_oid = list->GetSiOid(i);
+            list_oids[use_hash][si_oid.si] = si_oid.oid;
+        }
+        for (int oid = 0; list_db.CheckOrFindOID(oid); oid++) {
+            included_oids[use_hash].push_back(oid);
+        }
+    }
+    CNcbiApplication::Instance()->SetEnvironment()
+        .Set("BLASTDB_ACCESSION_HASH", "1");
+
+    BOOST_REQUIRE_EQUAL(kNumListIds, list_oids[0].size());
+    BOOST_REQUIRE(list_oids[1] == list_oids[0]);
+    BOOST_REQUIRE_EQUAL_COLLECTIONS(included_oids[1].begin(),
+                                    included_oids[1].end(),
+                                    included_oids[0].begin(),
+                                    included_oids[0].end());
+    BOOST_REQUIRE(! included_oids[0].empty());
+}
+
+/// Add an entry to an accession hash index file held in memory, the
+/// way CWriteDB_AccessionHash places entries.
+static void s_AddAccessionHashEntry(string & data, Uint8 fp, Int4 oid)
+{
+    unsigned char * p = (unsigned char *) &data[0];
+
+    Uint4 entries = (p[4] << 24) | (p[5] << 16) | (p[6] << 8) | p[7];
+    Uint4 slots   = (p[8] << 24) | (p[9] << 16) | (p[10] << 8) | p[11];
+    BOOST_REQUIRE(entries + 1 < slots);
+
+    unsigned char * keys = p + 16;
+    unsigned char * oids = keys + 8 * (size_t) slots;
+
+    Uint8 slot = fp & (slots - 1);
+    for (;;) {
+        bool empty = true;
+        for (int i = 0; i < 8; i++) {
+            if (keys[8 * slot + i]) {
+                empty = false;
+            }
+        }
+        if (empty) {
+            break;
+        }
+        slot = (slot + 1) & (slots - 1);
+    }
+
+    for (int i = 0; i < 8; i++) {
+        keys[8 * slot + i] = (unsigned char) (fp >> (56 - 8 * i));
+    }
+    for (int i = 0; i < 4; i++) {
+        oids[4 * slot + i] = (unsigned char) (oid >> (24 - 8 * i));
+    }
+
+    entries++;
+    for (int i = 0; i < 4; i++) {
+        p[4 + i] = (unsigned char) (entries >> (24 - 8 * i));
+    }
+}
+
+// The accession hash index stores key fingerprints, not keys; OIDs
+// found under a fingerprint that another key shares must be rejected.
+BOOST_AUTO_TEST_CASE(CBuildDatabase_AccessionHashCollision)
+{
+    const string kDbName("data/acc_hash_collision");
+    static const char * const kExtns[] =
+        { ".pin", ".phr", ".psq", ".pni", ".pnd", ".psi", ".psd",
+          ".ppi", ".ppd", ".pog", ".pai" };
+    for (size_t i = 0; i < sizeof(kExtns)/sizeof(*kExtns); i++) {
+        CFileDeleteAtExit::Add(kDbName + kExtns[i]);
+    }
+
+    ostringstream log;
+    CNcbiIfstream fasta_file("data/some_prots.fsa");
+    BOOST_REQUIRE(fasta_file);
+    CBuildDatabase db(kDbName, "accession hash collision", true,
+                      CWriteDB::eDefault | CWriteDB::eAddAccessionHash,
+                      false, &log, false, eBDB_Version4);
+    db.StartBuild();
+    db.AddFasta(fasta_file);
+    db.EndBuild();
+
+    const string kStored("Q9PFV5");
+    const string kMissing("XX_NOT_THERE");
+
+    CNcbiApplication::Instance()->SetEnvironment()
+        .Set("BLASTDB_ACCESSION_HASH", "0");
+    int stored_oid = -1;
+    {
+        CSeqDB isam_db(kDbName, CSeqDB::eProtein);
+        vector<int> oids;
+        isam_db.AccessionToOids(kStored, oids);
+        BOOST_REQUIRE_EQUAL(1U, oids.size());
+        stored_oid = oids.front();
+    }
+    CNcbiApplication::Instance()->SetEnvironment()
+        .Set("BLASTDB_ACCESSION_HASH", "1");
+    const int other_oid = stored_oid ? 0 : 1;
+
+    // Give the fingerprints of kStored and kMissing to keys of OIDs
+    // that do not have those accessions.
+    const string kHashFile(kDbName + ".pai");
+    string data;
+    {
+        CNcbiIfstream in(kHashFile.c_str(), IOS_BASE::binary);
+        BOOST_REQUIRE(in);
+        data.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+    }
+    const string kStoredKey  = NStr::ToLower(string(kStored));
+    const string kMissingKey = NStr::ToLower(string(kMissing));
+    s_AddAccessionHashEntry(data,
+                            SeqDB_AccessionHash(kStoredKey.data(),
+                                                kStoredKey.size()),
+                            other_oid);
+    s_AddAccessionHashEntry(data,
+                            SeqDB_AccessionHash(kMissingKey.data(),
+                                                kMissingKey.size()),
+                            stored_oid);
+    {
+        CNcbiOfstream out(kHashFile.c_str(), IOS_BASE::binary);
+        out.write(data.data(), data.size());
+        BOOST_REQUIRE(out);
+    }
+
+    CSeqDB hash_db(kDbName, CSeqDB::eProtein);
+    vector<int> oids;
+    hash_db.AccessionToOids(kStored, oids);
+    BOOST_REQUIRE_EQUAL(1U, oids.size());
+    BOOST_REQUIRE_EQUAL(stored_oid, oids.front());
+
+    oids.clear();
+    hash_db.AccessionToOids(kMissing, oids);
+    BOOST_REQUIRE(oids.empty());
+
+    CRef<CSeqDBGiList> list(new CSeqDBGiList);
+    list->AddSi(kMissingKey);
+    list->AddSi(kStoredKey);
+    CSeqDB list_db(kDbName, CSeqDB::eProtein, &*list);
+    for (int i = 0; i < list->GetNumSis(); i++) {
+        const CSeqDBGiList::SSiOid & si_oid = list->GetSiOid(i);
+        if (si_oid.si == kStoredKey) {
+            BOOST_REQUIRE_EQUAL(stored_oid, si_oid.oid);
+        } else {
+            BOOST_REQUIRE_EQUAL(-1, si_oid.oid);
+        }
+    }
+}
+
 BOOST_AUTO_TEST_CASE(CBuildDatabase_WGS_gap)
 {
 
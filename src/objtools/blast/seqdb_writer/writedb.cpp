@@ -121,6 +121,16 @@ void CWriteDB::SetMaxVolumeLetters(Uint8 sz)
     m_Impl->SetMaxVolumeLetters(sz);
 }
 
+void CWriteDB::SetNumberOfThreads(int num_threads)
+{
+    m_Impl->SetNumberOfThreads(num_threads);
+}
+
+void CWriteDB::AppendToExisting()
+{
+    m_Impl->AppendToExisting();
+}
+
 CRef<CBlast_def_line_set>
 CWriteDB::ExtractBioseqDeflines(const CBioseq & bs, bool parse_ids,
                                 bool long_ids)
@@ -52,6 +52,61 @@ BEGIN_NCBI_SCOPE
 /// Import C++ std namespace.
 USING_SCOPE(std);
 
+/// Number of published sequences that triggers a background batch.
+static const size_t kBatchSequences = 4096;
+
+/// Number of pending letters that triggers a background batch.
+static const Uint8 kBatchLetters = 64 * 1024 * 1024;
+
+/// Background thread cooking and writing one batch of sequences.
+class CWriteDB_BatchThread : public CThread
+{
+public:
+    CWriteDB_BatchThread(CWriteDB_Impl & impl)
+        : m_Impl(impl)
+    {
+    }
+
+protected:
+    virtual void * Main(void)
+    {
+        try {
+            m_Impl.x_CookAndWriteBatch();
+        }
+        catch (...) {
+            m_Impl.m_BatchError = std::current_exception();
+        }
+        return NULL;
+    }
+
+private:
+    CWriteDB_Impl & m_Impl;
+};
+
+/// Helper thread cooking records of the batch being written.
+class CWriteDB_CookThread : public CThread
+{
+public:
+    CWriteDB_CookThread(CWriteDB_Impl                & impl,
+                        CAtomicCounter               & next,
+                        vector<std::exception_ptr>   & errors)
+        : m_Impl(impl), m_Next(next), m_Errors(errors)
+    {
+    }
+
+protected:
+    virtual void * Main(void)
+    {
+        m_Impl.x_CookRecords(m_Next, m_Errors);
+        return NULL;
+    }
+
+private:
+    CWriteDB_Impl              & m_Impl;
+    CAtomicCounter             & m_Next;
+    vector<std::exception_ptr> & m_Errors;
+};
+
 CWriteDB_Impl::CWriteDB_Impl(const string & dbname,
                              bool           protein,
                              const string & title,
@@ -78,7 +133,15 @@ CWriteDB_Impl::CWriteDB_Impl(const string & dbname,
       m_HaveSequence     (false),
       m_LongSeqId        (long_ids),
       m_LmdbOid          (0),
-      m_limitDefline     (protein? limit_defline: false)
+      m_Append           (false),
+      m_BaseVolumes      (0),
+      m_RenameBase       (false),
+      m_BaseOids         (0),
+      m_BaseSeqs         (0),
+      m_BaseLength       (0),
+      m_limitDefline     (protein? limit_defline: false),
+      m_NumThreads       (1),
+      m_PendingLetters   (0)
 {
     CTime now(CTime::eCurrent);
 
@@ -324,11 +387,12 @@ void CWriteDB_Impl::Close()
     m_Closed = true;
 
     x_Publish();
+    x_SyncBatches();
     m_Sequence.erase();
     m_Ambig.erase();
 
     if (! m_Volume.Empty()) {
-        m_Volume->Close();
+        m_Volume->Close(m_NumThreads);
 
         if (m_UseGiMask) {
             for (unsigned int i=0; i<m_GiMasks.size(); ++i) {
@@ -336,9 +400,12 @@ void CWriteDB_Impl::Close()
             }
         }
 
-        if (m_VolumeList.size() == 1) {
+        if (x_NumVolumes() == 1) {
             m_Volume->RenameSingle();
         }
+        if (m_RenameBase) {
+            x_RenameSingleToVolume();
+        }
 
         // disable the check for duplicate ids across volumes
         /*
@@ -362,16 +429,20 @@ void CWriteDB_Impl::Close()
             s_CheckDuplicateIds(nids);
         } */
 
-        if (m_VolumeList.size() > 1 || m_UseGiMask) {
+        if (x_NumVolumes() > 1 || m_UseGiMask) {
             x_MakeAlias();
         }
         if ((m_DbVersion == eBDB_Version5)  &&  m_Lmdbdb) {
-        	vector<string> vol_names(m_VolumeList.size());
-        	vector<blastdb::TOid> vol_num_oids(m_VolumeList.size());
+        	vector<string> vol_names(x_NumVolumes());
+        	vector<blastdb::TOid> vol_num_oids(x_NumVolumes());
+        	for(int i=0; i < m_BaseVolumes; i++) {
+        		vol_names[i] = CDirEntry(CWriteDB_File::MakeShortName(m_Dbname, i)).GetName();
+        		vol_num_oids[i] = m_BaseVolumeOids[i];
+        	}
         	for(unsigned i=0; i < m_VolumeList.size(); i++) {
         		CRef<CWriteDB_Volume> & v = m_VolumeList[i];
-        		vol_names[i] = CDirEntry(v->GetVolumeName()).GetName();
-        		vol_num_oids[i] = v->GetOID();
+        		vol_names[m_BaseVolumes + i] = CDirEntry(v->GetVolumeName()).GetName();
+        		vol_num_oids[m_BaseVolumes + i] = v->GetOID();
         	}
             m_Lmdbdb->InsertVolumesInfo(vol_names, vol_num_oids);
         }
@@ -388,8 +459,8 @@ string CWriteDB_Impl::x_MakeAliasName()
 void CWriteDB_Impl::x_MakeAlias()
 {
     string dblist;
-    if (m_VolumeList.size() > 1) {
-        for(unsigned i = 0; i < m_VolumeList.size(); i++) {
+    if (x_NumVolumes() > 1) {
+        for(int i = 0; i < x_NumVolumes(); i++) {
             if (dblist.size())
                 dblist += " ";
 
@@ -420,6 +491,19 @@ void CWriteDB_Impl::x_MakeAlias()
     if (masklist != "") {
         alias << "MASKLIST " << masklist << "\n";
     }
+
+    if (m_Append) {
+        // Totals of the existing volumes are already known, so spare
+        // readers from opening every volume to compute them.
+        Uint8 num_seqs = m_BaseSeqs;
+        Uint8 length = m_BaseLength;
+        ITERATE(vector< CRef<CWriteDB_Volume> >, iter, m_VolumeList) {
+            num_seqs += (**iter).GetOID();
+            length += (**iter).GetLetters();
+        }
+        alias << "NSEQ "   << num_seqs << "\n"
+              << "LENGTH " << length   << "\n";
+    }
 }
 
 void CWriteDB_Impl::x_GetBioseqBinaryHeader(const CBioseq & bioseq,
@@ -878,60 +962,56 @@ CWriteDB_Impl::x_ExtractDeflines(CConstRef<CBioseq>             & bioseq,
     }
 }
 
-void CWriteDB_Impl::x_CookHeader()
+void CWriteDB_Impl::x_CookHeader(SPendingSeq & rec) const
 {
-    int OID = -1;
-    if (! m_ParseIDs) {
-        OID = (m_Volume ) ? m_Volume->GetOID() : 0;
-    }
-    x_ExtractDeflines(m_Bioseq,
-                      m_Deflines,
-                      m_BinHdr,
-                      m_Memberships,
-                      m_Linkouts,
-                      m_Pig,
-                      m_TaxIds,
-                      OID,
+    x_ExtractDeflines(rec.bioseq,
+                      rec.deflines,
+                      rec.bin_hdr,
+                      rec.memberships,
+                      rec.linkouts,
+                      rec.pig,
+                      rec.tax_ids,
+                      rec.oid,
                       m_ParseIDs,
                       m_LongSeqId,
                       m_limitDefline);
 
-    x_CookIds();
+    x_CookIds(rec);
 }
 
-void CWriteDB_Impl::x_CookIds()
+void CWriteDB_Impl::x_CookIds(SPendingSeq & rec)
 {
-    if (! m_Ids.empty()) {
+    if (! rec.ids.empty()) {
         return;
     }
 
-    if (m_Deflines.Empty()) {
-        if (m_BinHdr.empty()) {
+    if (rec.deflines.Empty()) {
+        if (rec.bin_hdr.empty()) {
             NCBI_THROW(CWriteDBException,
                        eArgErr,
                        "Error: Cannot find IDs or deflines.");
         }
 
-        x_SetDeflinesFromBinary(m_BinHdr, m_Deflines);
+        x_SetDeflinesFromBinary(rec.bin_hdr, rec.deflines);
     }
 
-    ITERATE(list< CRef<CBlast_def_line> >, iter, m_Deflines->Get()) {
+    ITERATE(list< CRef<CBlast_def_line> >, iter, rec.deflines->Get()) {
         const list< CRef<CSeq_id> > & ids = (**iter).GetSeqid();
-        // m_Ids.insert(m_Ids.end(), ids.begin(), ids.end());
+        // rec.ids.insert(rec.ids.end(), ids.begin(), ids.end());
         // Spelled out for WorkShop. :-/
-        m_Ids.reserve(m_Ids.size() + ids.size());
+        rec.ids.reserve(rec.ids.size() + ids.size());
         ITERATE (list<CRef<CSeq_id> >, it, ids) {
-            m_Ids.push_back(*it);
+            rec.ids.push_back(*it);
         }
     }
 }
 
-void CWriteDB_Impl::x_MaskSequence()
+void CWriteDB_Impl::x_MaskSequence(string & sequence) const
 {
     // Scan and mask the sequence itself.
-    for(unsigned i = 0; i < m_Sequence.size(); i++) {
-        if (m_MaskLookup[m_Sequence[i] & 0xFF] != 0) {
-            m_Sequence[i] = m_MaskByte[0];
+    for(unsigned i = 0; i < sequence.size(); i++) {
+        if (m_MaskLookup[sequence[i] & 0xFF] != 0) {
+            sequence[i] = m_MaskByte[0];
         }
     }
 }
@@ -961,52 +1041,52 @@ int CWriteDB_Impl::x_ComputeSeqLength()
     return m_SeqLength;
 }
 
-void CWriteDB_Impl::x_CookSequence()
+void CWriteDB_Impl::x_CookSequence(SPendingSeq & rec) const
 {
-    if (! m_Sequence.empty())
+    if (! rec.sequence.empty())
         return;
 
-    if (! (m_Bioseq.NotEmpty() && m_Bioseq->CanGetInst())) {
+    if (! (rec.bioseq.NotEmpty() && rec.bioseq->CanGetInst())) {
         NCBI_THROW(CWriteDBException,
                    eArgErr,
                    "Need sequence data.");
     }
 
-    const CSeq_inst & si = m_Bioseq->GetInst();
+    const CSeq_inst & si = rec.bioseq->GetInst();
 
-    if (m_Bioseq->GetInst().CanGetSeq_data()) {
+    if (rec.bioseq->GetInst().CanGetSeq_data()) {
         const CSeq_data & sd = si.GetSeq_data();
 
         string msg;
 
         switch(sd.Which()) {
         case CSeq_data::e_Ncbistdaa:
-            WriteDB_StdaaToBinary(si, m_Sequence);
+            WriteDB_StdaaToBinary(si, rec.sequence);
             break;
 
         case CSeq_data::e_Ncbieaa:
-            WriteDB_EaaToBinary(si, m_Sequence);
+            WriteDB_EaaToBinary(si, rec.sequence);
             break;
 
         case CSeq_data::e_Iupacaa:
-            WriteDB_IupacaaToBinary(si, m_Sequence);
+            WriteDB_IupacaaToBinary(si, rec.sequence);
             break;
 
         case CSeq_data::e_Ncbi2na:
-            WriteDB_Ncbi2naToBinary(si, m_Sequence);
+            WriteDB_Ncbi2naToBinary(si, rec.sequence);
             break;
 
         case CSeq_data::e_Ncbi4na:
-            WriteDB_Ncbi4naToBinary(si, m_Sequence, m_Ambig);
+            WriteDB_Ncbi4naToBinary(si, rec.sequence, rec.ambig);
             break;
 
         case CSeq_data::e_Iupacna:
-             WriteDB_IupacnaToBinary(si, m_Sequence, m_Ambig);
+             WriteDB_IupacnaToBinary(si, rec.sequence, rec.ambig);
              break;
 
         default:
             msg = "Unable to process sequence for entry [";
-            msg += (m_Bioseq->GetId().front())->GetSeqIdString(false);
+            msg += (rec.bioseq->GetId().front())->GetSeqIdString(false);
             msg += "].";
         }
 
@@ -1014,7 +1094,7 @@ void CWriteDB_Impl::x_CookSequence()
             NCBI_THROW(CWriteDBException, eArgErr, msg);
         }
     } else {
-        int sz = m_SeqVector.size();
+        int sz = rec.seq_vector.size();
 
         if (sz == 0) {
             NCBI_THROW(CWriteDBException,
@@ -1027,15 +1107,15 @@ void CWriteDB_Impl::x_CookSequence()
             // I add one to the string length to allow the "i+1" in
             // the loop to be done safely.
 
-            m_Sequence.reserve(sz);
-            m_SeqVector.GetSeqData(0, sz, m_Sequence);
+            rec.sequence.reserve(sz);
+            rec.seq_vector.GetSeqData(0, sz, rec.sequence);
         } else {
             // I add one to the string length to allow the "i+1" in the
             // loop to be done safely.
 
             string na8;
             na8.reserve(sz + 1);
-            m_SeqVector.GetSeqData(0, sz, na8);
+            rec.seq_vector.GetSeqData(0, sz, na8);
             na8.resize(sz + 1);
 
             string na4;
@@ -1048,18 +1128,18 @@ void CWriteDB_Impl::x_CookSequence()
             WriteDB_Ncbi4naToBinary(na4.data(),
                                     (int) na4.size(),
                                     (int) si.GetLength(),
-                                    m_Sequence,
-                                    m_Ambig);
+                                    rec.sequence,
+                                    rec.ambig);
         }
     }
 }
 
-void CWriteDB_Impl::x_CookColumns()
+void CWriteDB_Impl::x_CookColumns(SPendingSeq & /*rec*/) const
 {
 }
 
 // The CPU should be kept at 190 degrees for 10 minutes.
-void CWriteDB_Impl::x_CookData()
+void CWriteDB_Impl::x_CookData(SPendingSeq & rec) const
 {
     // We need sequence, ambiguity, and binary deflines.  If any of
     // these is missing, it is created from other data if possible.
@@ -1068,12 +1148,12 @@ void CWriteDB_Impl::x_CookData()
     // I would expect to see sequences from ID1 or similar, and the
     // non-binary case is slightly more complex.
 
-    x_CookHeader();
-    x_CookSequence();
-    x_CookColumns();
+    x_CookHeader(rec);
+    x_CookSequence(rec);
+    x_CookColumns(rec);
 
     if (m_Protein && m_MaskedLetters.size()) {
-        x_MaskSequence();
+        x_MaskSequence(rec.sequence);
     }
 }
 
@@ -1126,35 +1206,112 @@ void CWriteDB_Impl::x_Publish()
         	m_Taxdb.Reset(new CWriteDB_TaxID(
         		          GetFileNameFromExistingLMDBFile(lmdb_fname_w_path, ELMDBFileType::eTaxId2Offsets)));
         }
+        if (m_Append) {
+        	m_Lmdbdb->PrepareAppend(m_BaseOids);
+        	m_Taxdb->PrepareAppend(m_BaseOids);
+        }
     }
 
-    x_CookData();
+    unique_ptr<SPendingSeq> rec(new SPendingSeq);
+    x_TakeSequence(*rec);
+
+    if (m_NumThreads <= 1) {
+        rec->oid = m_ParseIDs ? -1 : (m_Volume ? m_Volume->GetOID() : 0);
+        x_CookData(*rec);
+        x_WriteSequence(*rec);
+        x_RecycleBlobs(*rec);
+        return;
+    }
+
+    if (rec->sequence.empty() && rec->bioseq.NotEmpty() &&
+        rec->bioseq->GetInst().CanGetLength()) {
+        m_PendingLetters += rec->bioseq->GetInst().GetLength();
+    } else {
+        m_PendingLetters += rec->sequence.size();
+    }
+    m_Pending.push_back(std::move(rec));
+
+    if (m_Pending.size() >= kBatchSequences ||
+        m_PendingLetters >= kBatchLetters) {
+        x_StartBatch();
+    }
+}
 
+void CWriteDB_Impl::x_TakeSequence(SPendingSeq & rec)
+{
+    rec.bioseq = m_Bioseq;
+    rec.seq_vector = m_SeqVector;
+    rec.deflines = m_Deflines;
+    rec.ids.swap(m_Ids);
+    rec.linkouts.swap(m_Linkouts);
+    rec.memberships.swap(m_Memberships);
+    rec.pig = m_Pig;
+    rec.hash = m_Hash;
+    rec.sequence.swap(m_Sequence);
+    rec.ambig.swap(m_Ambig);
+    rec.bin_hdr.swap(m_BinHdr);
+    rec.tax_ids.swap(m_TaxIds);
+
+    // The record keeps the column blobs filled in for this sequence;
+    // the next sequence gets a recycled (or new) set.
+
+    rec.blobs.swap(m_Blobs);
+
+    if (! m_FreeBlobs.empty()) {
+        m_Blobs.swap(m_FreeBlobs.back());
+        m_FreeBlobs.pop_back();
+    } else {
+        m_Blobs.reserve(rec.blobs.size());
+        for(size_t i = 0; i < rec.blobs.size(); i++) {
+            m_Blobs.push_back(CRef<CBlastDbBlob>(new CBlastDbBlob));
+        }
+    }
+}
+
+void CWriteDB_Impl::x_RecycleBlobs(SPendingSeq & rec)
+{
+    if (rec.blobs.size() == m_Blobs.size()) {
+        m_FreeBlobs.push_back(vector< CRef<CBlastDbBlob> >());
+        m_FreeBlobs.back().swap(rec.blobs);
+    }
+}
+
+void CWriteDB_Impl::x_WriteSequence(SPendingSeq & rec)
+{
     bool done = false;
 
     if (! m_Volume.Empty()) {
-        done = m_Volume->WriteSequence(m_Sequence,
-                                       m_Ambig,
-                                       m_BinHdr,
-                                       m_Ids,
-                                       m_Pig,
-                                       m_Hash,
-                                       m_Blobs,
+        if ((! m_ParseIDs) && rec.oid != m_Volume->GetOID()) {
+            // The header was cooked for a predicted OID that turned
+            // out wrong (a new volume was started earlier in the
+            // batch); rebuild it, and the ids, for the real OID.
+            rec.oid = m_Volume->GetOID();
+            rec.ids.clear();
+            x_CookHeader(rec);
+        }
+
+        done = m_Volume->WriteSequence(rec.sequence,
+                                       rec.ambig,
+                                       rec.bin_hdr,
+                                       rec.ids,
+                                       rec.pig,
+                                       rec.hash,
+                                       rec.blobs,
                                        m_MaskDataColumn);
         if (done  &&  (m_DbVersion == eBDB_Version5)  &&  m_Lmdbdb) {
         	if (m_ParseIDs) {
-        		m_Lmdbdb->InsertEntries(m_Ids,m_LmdbOid);
+        		m_Lmdbdb->InsertEntries(rec.ids,m_LmdbOid);
         	}
-            m_Taxdb->InsertEntries(m_TaxIds, m_LmdbOid);
+            m_Taxdb->InsertEntries(rec.tax_ids, m_LmdbOid);
             m_LmdbOid++;
         }
     }
 
     if (! done) {
-        int index = (int) m_VolumeList.size();
+        int index = x_NumVolumes();
 
         if (m_Volume.NotEmpty()) {
-            m_Volume->Close();
+            m_Volume->Close(m_NumThreads);
         }
 
         {
@@ -1173,9 +1330,9 @@ void CWriteDB_Impl::x_Publish()
 
 #if ((!defined(NCBI_COMPILER_WORKSHOP) || (NCBI_COMPILER_VERSION  > 550)) && \
      (!defined(NCBI_COMPILER_MIPSPRO)) )
-            _ASSERT(m_Blobs.size() == m_ColumnTitles.size() * 2);
-            _ASSERT(m_Blobs.size() == m_ColumnMetas.size() * 2);
-            _ASSERT(m_Blobs.size() == m_HaveBlob.size() * 2);
+            _ASSERT(rec.blobs.size() == m_ColumnTitles.size() * 2);
+            _ASSERT(rec.blobs.size() == m_ColumnMetas.size() * 2);
+            _ASSERT(rec.blobs.size() == m_HaveBlob.size() * 2);
 
             for(size_t i = 0; i < m_ColumnTitles.size(); i++) {
                 m_Volume->CreateColumn(m_ColumnTitles[i],
@@ -1186,22 +1343,23 @@ void CWriteDB_Impl::x_Publish()
         }
 
         // need to reset OID,  hense recalculate the header and id
-        x_CookHeader();
-
-        done = m_Volume->WriteSequence(m_Sequence,
-                                       m_Ambig,
-                                       m_BinHdr,
-                                       m_Ids,
-                                       m_Pig,
-                                       m_Hash,
-                                       m_Blobs,
+        rec.oid = m_ParseIDs ? -1 : m_Volume->GetOID();
+        x_CookHeader(rec);
+
+        done = m_Volume->WriteSequence(rec.sequence,
+                                       rec.ambig,
+                                       rec.bin_hdr,
+                                       rec.ids,
+                                       rec.pig,
+                                       rec.hash,
+                                       rec.blobs,
                                        m_MaskDataColumn);
 
         if (done  &&  (m_DbVersion == eBDB_Version5)  &&  m_Lmdbdb) {
         	if (m_ParseIDs){
-             m_Lmdbdb->InsertEntries(m_Ids,m_LmdbOid);
+             m_Lmdbdb->InsertEntries(rec.ids,m_LmdbOid);
         	}
-            m_Taxdb->InsertEntries(m_TaxIds, m_LmdbOid);
+            m_Taxdb->InsertEntries(rec.tax_ids, m_LmdbOid);
             m_LmdbOid++;
         }
 
@@ -1213,6 +1371,218 @@ void CWriteDB_Impl::x_Publish()
     }
 }
 
+void CWriteDB_Impl::x_CookRecords(CAtomicCounter             & next,
+                                  vector<std::exception_ptr> & errors)
+{
+    const int num_seqs = (int) m_Writing.size();
+
+    for(;;) {
+        int i = (int) next.Add(1) - 1;
+        if (i >= num_seqs) {
+            break;
+        }
+        try {
+            x_CookData(*m_Writing[i]);
+        }
+        catch (...) {
+            errors[i] = std::current_exception();
+        }
+    }
+}
+
+void CWriteDB_Impl::x_CookAndWriteBatch()
+{
+    // Headers depend on the OID when IDs are not parsed; predict it
+    // from the current volume.  x_WriteSequence() fixes up any record
+    // whose prediction is broken by a volume change.
+
+    const int num_seqs = (int) m_Writing.size();
+    const int base_oid = m_Volume.NotEmpty() ? m_Volume->GetOID() : 0;
+
+    for (int i = 0; i < num_seqs; i++) {
+        m_Writing[i]->oid = m_ParseIDs ? -1 : base_oid + i;
+    }
+
+    vector<std::exception_ptr> errors(num_seqs);
+    CAtomicCounter next;
+    next.Set(0);
+
+    // This thread cooks too, alongside m_NumThreads - 1 helpers.
+    vector< CRef<CThread> > helpers;
+    int num_helpers = min(m_NumThreads, num_seqs) - 1;
+    for (int i = 0; i < num_helpers; i++) {
+        helpers.push_back(CRef<CThread>
+            (new CWriteDB_CookThread(*this, next, errors)));
+        helpers.back()->Run();
+    }
+    x_CookRecords(next, errors);
+    NON_CONST_ITERATE(vector< CRef<CThread> >, iter, helpers) {
+        (*iter)->Join();
+    }
+
+    // Writing is serial and in input order; a sequence that failed to
+    // cook stops the build just as it would in a serial build.
+
+    for (int i = 0; i < num_seqs; i++) {
+        if (errors[i]) {
+            std::rethrow_exception(errors[i]);
+        }
+        x_WriteSequence(*m_Writing[i]);
+    }
+}
+
+void CWriteDB_Impl::x_StartBatch()
+{
+    x_WaitBatch();
+
+    if (m_Pending.empty()) {
+        return;
+    }
+
+    m_Writing.swap(m_Pending);
+    m_PendingLetters = 0;
+
+    m_BatchThread.Reset(new CWriteDB_BatchThread(*this));
+    m_BatchThread->Run();
+}
+
+void CWriteDB_Impl::x_WaitBatch()
+{
+    if (m_BatchThread.Empty()) {
+        return;
+    }
+
+    m_BatchThread->Join();
+    m_BatchThread.Reset();
+
+    NON_CONST_ITERATE(TPendingSeqs, iter, m_Writing) {
+        x_RecycleBlobs(**iter);
+    }
+    m_Writing.clear();
+
+    if (m_BatchError) {
+        std::exception_ptr error = m_BatchError;
+        m_BatchError = std::exception_ptr();
+        m_Pending.clear();
+        std::rethrow_exception(error);
+    }
+}
+
+void CWriteDB_Impl::x_SyncBatches()
+{
+    x_WaitBatch();
+
+    if (! m_Pending.empty()) {
+        m_Writing.swap(m_Pending);
+        m_PendingLetters = 0;
+
+        try {
+            x_CookAndWriteBatch();
+        }
+        catch (...) {
+            m_Writing.clear();
+            throw;
+        }
+
+        NON_CONST_ITERATE(TPendingSeqs, iter, m_Writing) {
+            x_RecycleBlobs(**iter);
+        }
+        m_Writing.clear();
+    }
+}
+
+void CWriteDB_Impl::SetNumberOfThreads(int num_threads)
+{
+    x_SyncBatches();
+    m_NumThreads = max(num_threads, 1);
+}
+
+void CWriteDB_Impl::AppendToExisting()
+{
+    if (x_HaveSequence() || m_VolumeList.size() || m_Pending.size()) {
+        NCBI_THROW(CWriteDBException,
+                   eArgErr,
+                   "Cannot append to a database after sequences were added.");
+    }
+    if (m_UseGiMask) {
+        NCBI_THROW(CWriteDBException,
+                   eArgErr,
+                   "Cannot append to a database with GI based masks.");
+    }
+
+    vector<string> paths;
+    {
+        CSeqDB db(m_Dbname, m_Protein ? CSeqDB::eProtein : CSeqDB::eNucleotide);
+
+        if (db.GetBlastDbVersion() != m_DbVersion) {
+            NCBI_THROW(CWriteDBException,
+                       eArgErr,
+                       "Cannot append to a database of another version.");
+        }
+
+        db.FindVolumePaths(paths, false);
+        m_BaseOids   = db.GetNumOIDs();
+        m_BaseSeqs   = db.GetNumSeqs();
+        m_BaseLength = db.GetTotalLength();
+    }
+
+    // Only volume sets laid out as WriteDB itself would produce them
+    // can be extended.
+    const string base = CDirEntry(m_Dbname).GetName();
+    bool single = (paths.size() == 1) &&
+                  (CDirEntry(paths[0]).GetName() == base);
+
+    for(unsigned i = 0; (! single) && (i < paths.size()); i++) {
+        string vol = CWriteDB_File::MakeShortName(m_Dbname, i);
+        if (CDirEntry(paths[i]).GetName() != CDirEntry(vol).GetName()) {
+            NCBI_THROW(CWriteDBException,
+                       eArgErr,
+                       "Cannot append to database " + m_Dbname +
+                       ": unexpected volume " + paths[i]);
+        }
+    }
+
+    if (m_DbVersion == eBDB_Version5) {
+        vector<string> vol_names;
+        CSeqDBLMDB lmdb(BuildLMDBFileName(m_Dbname, m_Protein));
+        lmdb.GetVolumesInfo(vol_names, m_BaseVolumeOids);
+
+        if (m_BaseVolumeOids.size() != paths.size()) {
+            NCBI_THROW(CWriteDBException,
+                       eArgErr,
+                       "Volume information of " + m_Dbname +
+                       " does not match its volumes.");
+        }
+        m_LmdbOid = m_BaseOids;
+    }
+
+    m_Append = true;
+    m_BaseVolumes = (int) paths.size();
+    m_RenameBase = single;
+}
+
+void CWriteDB_Impl::x_RenameSingleToVolume()
+{
+    // The database-wide files (alias and LMDB files) keep their names.
+    vector<string> exts, shared;
+    SeqDB_GetFileExtensions(m_Protein, exts, m_DbVersion);
+    SeqDB_GetLMDBFileExtensions(m_Protein, shared);
+    shared.push_back(m_Protein ? "pal" : "nal");
+
+    const string vol = CWriteDB_File::MakeShortName(m_Dbname, 0);
+
+    ITERATE(vector<string>, ext, exts) {
+        if (find(shared.begin(), shared.end(), *ext) != shared.end()) {
+            continue;
+        }
+        CFile f(m_Dbname + "." + *ext);
+        if (f.Exists()) {
+            f.Rename(vol + "." + *ext);
+        }
+    }
+    m_RenameBase = false;
+}
+
 void CWriteDB_Impl::SetDeflines(const CBlast_def_line_set & deflines)
 {
     CRef<CBlast_def_line_set>
@@ -1412,6 +1782,7 @@ RegisterMaskAlgorithm(EBlast_filter_program   program,
                       const string          & options,
                       const string          & name)
 {
+    x_SyncBatches();
     int algorithm_id = m_MaskAlgoRegistry.Add(program, options, name);
 
     string key = NStr::IntToString(algorithm_id);
@@ -1440,6 +1811,7 @@ RegisterMaskAlgorithm(const string &id,
                       const string &description,
                       const string &options)
 {
+    x_SyncBatches();
     int algorithm_id = m_MaskAlgoRegistry.Add(id);
 
     string key = NStr::IntToString(algorithm_id);
@@ -1468,6 +1840,11 @@ int CWriteDB_Impl::CreateColumn(const string & title, bool mbo)
 {
     _ASSERT(FindColumn(title) == -1);
 
+    // Written sequences must not see the new column; recycled blob
+    // sets no longer have the right size.
+    x_SyncBatches();
+    m_FreeBlobs.clear();
+
     size_t col_id = m_Blobs.size() / 2;
 
     _ASSERT(m_HaveBlob.size()     == col_id);
@@ -1501,6 +1878,7 @@ void CWriteDB_Impl::AddColumnMetaData(int            col_id,
                    "Error: provided column ID is not valid");
     }
 
+    x_SyncBatches();
     m_ColumnMetas[col_id][key] = value;
 
     if (m_Volume.NotEmpty()) {
@@ -1536,11 +1914,13 @@ void CWriteDB_Impl::SetPig(int pig)
 
 void CWriteDB_Impl::SetMaxFileSize(Uint8 sz)
 {
+    x_SyncBatches();
     m_MaxFileSize = sz;
 }
 
 void CWriteDB_Impl::SetMaxVolumeLetters(Uint8 sz)
 {
+    x_SyncBatches();
     m_MaxVolumeLetters = sz;
 }
 
@@ -1577,6 +1957,7 @@ void CWriteDB_Impl::SetMaskedLetters(const string & masked)
                    "Error: Nucleotide masking not supported.");
     }
 
+    x_SyncBatches();
     m_MaskedLetters = masked;
 
     if (masked.empty()) {
@@ -1626,6 +2007,7 @@ void CWriteDB_Impl::SetMaskedLetters(const string & masked)
 
 void CWriteDB_Impl::ListVolumes(vector<string> & vols)
 {
+    x_SyncBatches();
     vols.clear();
 
     ITERATE(vector< CRef<CWriteDB_Volume> >, iter, m_VolumeList) {
@@ -1635,12 +2017,17 @@ void CWriteDB_Impl::ListVolumes(vector<string> & vols)
 
 void CWriteDB_Impl::ListFiles(vector<string> & files)
 {
+    x_SyncBatches();
     files.clear();
 
     ITERATE(vector< CRef<CWriteDB_Volume> >, iter, m_VolumeList) {
         (**iter).ListFiles(files);
     }
 
+    if (m_Append) {
+        // The alias and LMDB files also describe the existing volumes
+        return;
+    }
     if (m_VolumeList.size() > 1) {
         files.push_back(x_MakeAliasName());
     }
@@ -50,6 +50,10 @@
 
 #include <objmgr/bioseq_handle.hpp>
 #include <objmgr/seq_vector.hpp>
+#include <corelib/ncbithr.hpp>
+
+#include <exception>
+#include <memory>
 
 BEGIN_NCBI_SCOPE
 
@@ -61,6 +65,8 @@ USING_SCOPE(objects);
 /// This manufactures blast database header files from input data.
 
 class CWriteDB_Impl {
+    friend class CWriteDB_BatchThread;
+    friend class CWriteDB_CookThread;
 public:
     /// Whether and what kind of indices to build.
     typedef CWriteDB::EIndexType EIndexType;
@@ -206,6 +212,28 @@ public:
     /// @param sz Maximum sequence letters per volume.
     void SetMaxVolumeLetters(Uint8 sz);
 
+    /// Set the number of threads used to prepare sequences.
+    ///
+    /// With more than one thread, published sequences are collected
+    /// into batches.  Header serialization, ISAM id collection, and
+    /// sequence packing for a batch are done in parallel on a
+    /// background thread while the caller continues to add sequences,
+    /// and the prepared records are written to the volumes in input
+    /// order, so the files produced are identical to those of a
+    /// single threaded build.  Objects provided to WriteDB must not be
+    /// modified after they are added in this mode.
+    ///
+    /// @param num_threads Number of threads to use. [in]
+    void SetNumberOfThreads(int num_threads);
+
+    /// Append to the existing database with this name.
+    ///
+    /// Reads the existing volume list, OID count and totals; renames
+    /// a single volume database to volume 00 so that new volumes can
+    /// be numbered after it.  Must be called before any sequences are
+    /// added.
+    void AppendToExisting();
+
     /// Extract deflines from a CBioseq.
     ///
     /// Given a CBioseq, this method extracts and returns header info
@@ -397,14 +425,80 @@ private:
     vector< CRef<CWriteDB_GiMask> > m_GiMasks;
 #endif
 
+    /// A published sequence waiting to be cooked and written.
+    ///
+    /// When a sequence is published, the accumulated sequence data is
+    /// moved into one of these records; cooking and writing work only
+    /// on the record, so that several records can be cooked at once.
+    struct SPendingSeq {
+        SPendingSeq() : pig(0), hash(0), oid(-1) {}
+
+        CConstRef<CBioseq>             bioseq;      ///< Source Bioseq.
+        CSeqVector                     seq_vector;  ///< Source SeqVector.
+        CConstRef<CBlast_def_line_set> deflines;    ///< Header deflines.
+        vector< CRef<CSeq_id> >        ids;         ///< Ids for ISAM files.
+        vector< vector<int> >          linkouts;    ///< Linkout bits.
+        vector< vector<int> >          memberships; ///< Membership bits.
+        int                            pig;         ///< Protein PIG.
+        int                            hash;        ///< Sequence hash.
+        int                            oid;         ///< OID used for header.
+        string                         sequence;    ///< Packed sequence.
+        string                         ambig;       ///< Packed ambiguities.
+        string                         bin_hdr;     ///< Binary header.
+        set<Int4>                      tax_ids;     ///< Taxids in header.
+        vector< CRef<CBlastDbBlob> >   blobs;       ///< Column blobs.
+    };
+
+    /// Pending sequences, in publication order.
+    typedef vector< unique_ptr<SPendingSeq> > TPendingSeqs;
+
     // Functions
 
     /// Flush accumulated sequence data to volume.
     void x_Publish();
 
+    /// Move the accumulated sequence data into a pending record.
+    void x_TakeSequence(SPendingSeq & rec);
+
+    /// Write a cooked record to the current (or a new) volume.
+    void x_WriteSequence(SPendingSeq & rec);
+
+    /// Return the column blobs of a written record for reuse.
+    void x_RecycleBlobs(SPendingSeq & rec);
+
+    /// Cook records of m_Writing until none are left.
+    /// @param next Index of the next record to cook. [in|out]
+    /// @param errors Exception thrown for each record, if any. [out]
+    void x_CookRecords(CAtomicCounter             & next,
+                       vector<std::exception_ptr> & errors);
+
+    /// Cook and write every record in m_Writing, in order.
+    void x_CookAndWriteBatch();
+
+    /// Hand the pending records to a background batch thread.
+    void x_StartBatch();
+
+    /// Wait for the background batch (if any) to finish.
+    ///
+    /// Any exception thrown while cooking or writing the batch is
+    /// rethrown here.
+    void x_WaitBatch();
+
+    /// Write all published sequences before returning.
+    void x_SyncBatches();
+
     /// Compute name of alias file produced.
     string x_MakeAliasName();
 
+    /// Rename the files of a single volume database to volume 00.
+    void x_RenameSingleToVolume();
+
+    /// Total number of volumes, including existing ones.
+    int x_NumVolumes() const
+    {
+        return m_BaseVolumes + (int) m_VolumeList.size();
+    }
+
     /// Flush accumulated sequence data to volume.
     void x_MakeAlias();
 
@@ -412,25 +506,31 @@ private:
     void x_ResetSequenceData();
 
     /// Convert and compute final data formats.
-    void x_CookData();
+    /// @param rec Sequence to cook. [in|out]
+    void x_CookData(SPendingSeq & rec) const;
 
     /// Convert header data into usable forms.
-    void x_CookHeader();
+    /// @param rec Sequence to cook; rec.oid must be set. [in|out]
+    void x_CookHeader(SPendingSeq & rec) const;
 
     /// Collect ids for ISAM files.
-    void x_CookIds();
+    /// @param rec Sequence to cook. [in|out]
+    static void x_CookIds(SPendingSeq & rec);
 
     /// Compute the length of the current sequence.
     int x_ComputeSeqLength();
 
     /// Convert sequence data into usable forms.
-    void x_CookSequence();
+    /// @param rec Sequence to cook. [in|out]
+    void x_CookSequence(SPendingSeq & rec) const;
 
     /// Prepare column data to be appended to disk.
-    void x_CookColumns();
+    /// @param rec Sequence to cook. [in|out]
+    void x_CookColumns(SPendingSeq & rec) const;
 
     /// Replace masked input letters with m_MaskByte value.
-    void x_MaskSequence();
+    /// @param sequence Protein sequence in blast-aa format. [in|out]
+    void x_MaskSequence(string & sequence) const;
 
     /// Get binary version of deflines from 'user' data in Bioseq.
     ///
@@ -642,7 +742,49 @@ private:
     ///Current oid to use for lmdb
     int m_LmdbOid;
 
+    /// True if appending to an existing database.
+    bool m_Append;
+
+    /// Number of volumes in the database before appending.
+    int m_BaseVolumes;
+
+    /// True if the existing single volume must be renamed to volume 00.
+    bool m_RenameBase;
+
+    /// Number of OIDs in the database before appending.
+    blastdb::TOid m_BaseOids;
+
+    /// Sequence count and total length before appending.
+    blastdb::TOid m_BaseSeqs;
+    Uint8         m_BaseLength;
+
+    /// Number of OIDs in each existing volume (version 5 only).
+    vector<blastdb::TOid> m_BaseVolumeOids;
+
     bool m_limitDefline;
+
+    // Pipelined build
+
+    /// Number of threads used to cook sequences.
+    int m_NumThreads;
+
+    /// Published sequences not yet handed to the batch thread.
+    TPendingSeqs m_Pending;
+
+    /// Approximate number of letters in m_Pending.
+    Uint8 m_PendingLetters;
+
+    /// Sequences being cooked and written by the batch thread.
+    TPendingSeqs m_Writing;
+
+    /// Column blob sets from written sequences, ready for reuse.
+    vector< vector< CRef<CBlastDbBlob> > > m_FreeBlobs;
+
+    /// Background thread cooking and writing m_Writing.
+    CRef<CThread> m_BatchThread;
+
+    /// Exception thrown by the batch thread, if any.
+    std::exception_ptr m_BatchError;
 };
 
 END_NCBI_SCOPE
@@ -34,6 +34,7 @@
 #include <objtools/blast/seqdb_writer/writedb_error.hpp>
 #include <objtools/blast/seqdb_writer/writedb_isam.hpp>
 #include <objtools/blast/seqdb_writer/writedb_convert.hpp>
+#include <objtools/blast/seqdb_reader/seqdbcommon.hpp>
 #include <serial/objistr.hpp>
 #include <serial/objostr.hpp>
 #include <serial/serial.hpp>
@@ -100,7 +101,8 @@ CWriteDB_Isam::CWriteDB_Isam(EIsamType      itype,
                              bool           protein,
                              int            index,
                              Uint8          max_file_size,
-                             bool           sparse)
+                             bool           sparse,
+                             bool           acc_hash)
 {
     m_DFile.Reset(new CWriteDB_IsamData(itype,
                                         dbname,
@@ -108,12 +110,17 @@ CWriteDB_Isam::CWriteDB_Isam(EIsamType      itype,
                                         index,
                                         max_file_size));
 
+    if (acc_hash && itype == eAcc) {
+        m_HFile.Reset(new CWriteDB_AccessionHash(dbname, protein, index));
+    }
+
     m_IFile.Reset(new CWriteDB_IsamIndex(itype,
                                          dbname,
                                          protein,
                                          index,
                                          m_DFile,
-                                         sparse));
+                                         sparse,
+                                         m_HFile));
 }
 
 CWriteDB_Isam::~CWriteDB_Isam()
@@ -148,20 +155,29 @@ void CWriteDB_Isam::Close()
 
     m_IFile->Close();
     m_DFile->Close();
+
+    if (m_HFile.NotEmpty()) {
+        m_HFile->Close();
+    }
 }
 
 void CWriteDB_Isam::RenameSingle()
 {
     m_IFile->RenameSingle();
     m_DFile->RenameSingle();
+
+    if (m_HFile.NotEmpty() && ! m_HFile->Empty()) {
+        m_HFile->RenameSingle();
+    }
 }
 
-CWriteDB_IsamIndex::CWriteDB_IsamIndex(EWriteDBIsamType        itype,
-                                       const string          & dbname,
-                                       bool                    protein,
-                                       int                     index,
-                                       CRef<CWriteDB_IsamData> datafile,
-                                       bool                    sparse)
+CWriteDB_IsamIndex::CWriteDB_IsamIndex(EWriteDBIsamType             itype,
+                                       const string               & dbname,
+                                       bool                         protein,
+                                       int                          index,
+                                       CRef<CWriteDB_IsamData>      datafile,
+                                       bool                         sparse,
+                                       CRef<CWriteDB_AccessionHash> hashfile)
     : CWriteDB_File  (dbname,
                       s_IsamExtension(itype, protein, true),
                       index,
@@ -174,6 +190,7 @@ CWriteDB_IsamIndex::CWriteDB_IsamIndex(EWriteDBIsamType        itype,
       m_DataFileSize (0),
       m_UseInt8      (false),
       m_DataFile     (datafile),
+      m_HashFile     (hashfile),
       m_Oid          (-1)
 {
     // This is the one case where I don't worry about file size; if
@@ -752,6 +769,8 @@ void CWriteDB_IsamIndex::x_AddStringData(int oid, const char * sbuf, int ssize)
         buf[i] = tolower(buf[i]);
     }
 
+    const int key_size = sz;
+
     buf[sz++] = (char) eKeyDelim;
     sz += sprintf(buf + sz, "%d", oid);
     buf[sz++] = (char) eRecordDelim;
@@ -767,6 +786,10 @@ void CWriteDB_IsamIndex::x_AddStringData(int oid, const char * sbuf, int ssize)
     if (rv.second) {
         m_StringSort.Insert(buf, sz);
         m_DataFileSize += sz;
+
+        if (m_HashFile.NotEmpty()) {
+            m_HashFile->AddKey(oid, buf, key_size);
+        }
     }
 }
 
@@ -806,6 +829,82 @@ void CWriteDB_IsamData::x_Flush()
 {
 }
 
+CWriteDB_AccessionHash::CWriteDB_AccessionHash(const string & dbname,
+                                               bool           protein,
+                                               int            index)
+    : CWriteDB_File (dbname,
+                     protein ? "pai" : "nai",
+                     index,
+                     0,
+                     false)
+{
+}
+
+CWriteDB_AccessionHash::~CWriteDB_AccessionHash()
+{
+}
+
+void CWriteDB_AccessionHash::AddKey(int oid, const char * key, int size)
+{
+    m_Entries.push_back(make_pair(SeqDB_AccessionHash(key, size), oid));
+}
+
+void CWriteDB_AccessionHash::x_Flush()
+{
+    if (m_Entries.empty()) {
+        return;
+    }
+
+    // Keep the load factor at or below 3/4 so that unsuccessful
+    // lookups stay short.
+
+    Uint8 slots = 16;
+
+    while (slots * 3 < m_Entries.size() * 4) {
+        slots *= 2;
+    }
+
+    if (slots > kMax_I4) {
+        NCBI_THROW(CWriteDBException,
+                   eArgErr,
+                   "Too many keys for the accession hash index.");
+    }
+
+    const Uint8 mask = slots - 1;
+
+    vector<Uint8> keys((size_t) slots, 0);
+    vector<Int4>  oids((size_t) slots, 0);
+
+    ITERATE(TEntries, iter, m_Entries) {
+        Uint8 slot = iter->first & mask;
+
+        while (keys[(size_t) slot]) {
+            slot = (slot + 1) & mask;
+        }
+
+        keys[(size_t) slot] = iter->first;
+        oids[(size_t) slot] = iter->second;
+    }
+
+    Create();
+
+    WriteInt4(kFormatVersion);
+    WriteInt4((int) m_Entries.size());
+    WriteInt4((int) slots);
+    WriteInt4(0);
+
+    ITERATE(vector<Uint8>, iter, keys) {
+        WriteInt8((Int8) *iter);
+    }
+
+    ITERATE(vector<Int4>, iter, oids) {
+        WriteInt4(*iter);
+    }
+
+    TEntries tmp;
+    m_Entries.swap(tmp);
+}
+
 bool CWriteDB_IsamIndex::CanFit(int num)
 {
     return (m_DataFileSize + (num+1) * m_BytesPerElem) < m_MaxFileSize;
@@ -824,6 +923,10 @@ void CWriteDB_Isam::ListFiles(vector<string> & files) const
         files.push_back(m_IFile->GetFilename());
         files.push_back(m_DFile->GetFilename());
     }
+
+    if (m_HFile.NotEmpty() && ! m_HFile->Empty()) {
+        files.push_back(m_HFile->GetFilename());
+    }
 }
 
 bool CWriteDB_IsamIndex::Empty() const
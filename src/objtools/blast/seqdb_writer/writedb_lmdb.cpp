@@ -46,12 +46,179 @@ BEGIN_NCBI_SCOPE
 #define DEFAULT_MAX_ENTRY_PER_TXN 40000
 #define DEFAULT_MIN_SPLIT_SORT_SIZE 500000000
 #define DEFAULT_MIN_SPLIT_CHUNK_SIZE 25000000
+#define DEFAULT_MAX_SORT_MEMORY (NCBI_CONST_UINT8(4) * 1024 * 1024 * 1024)
 
+/// Memory budget for the entries an LMDB loader keeps in memory
+static Uint8 s_GetMaxSortMemory()
+{
+	Uint8 max_memory = DEFAULT_MAX_SORT_MEMORY;
+	char* max_memory_str = getenv("LMDB_SORT_MEMORY");
+	if (max_memory_str) {
+		max_memory = NStr::StringToUInt8_DataSize(max_memory_str);
+		_TRACE("DEBUG: LMDB_SORT_MEMORY " << max_memory_str);
+	}
+	return max_memory;
+}
+
+/// Name of a temporary file used while loading an LMDB database
+static string s_GetTempFileName(const string & db, const string & suffix)
+{
+	return db + "." + suffix + ".tmp";
+}
+
+/// Merges sorted run files, returning their entries in sort order
+template <class TEntry>
+class CLMDBRunMerger
+{
+public:
+	typedef bool (*TLess)(const TEntry &, const TEntry &);
+
+	CLMDBRunMerger(const vector<string> & runs, TLess less) : m_Less(less)
+	{
+		for(unsigned int i = 0; i < runs.size(); i++) {
+			m_Runs.push_back(unique_ptr<SRun>(new SRun(runs[i])));
+			if (m_Runs.back()->valid) {
+				m_Heap.push_back(i);
+			}
+		}
+		make_heap(m_Heap.begin(), m_Heap.end(), SGreater(*this));
+	}
+
+	bool Next(TEntry & entry)
+	{
+		if (m_Heap.empty()) {
+			return false;
+		}
+		pop_heap(m_Heap.begin(), m_Heap.end(), SGreater(*this));
+		SRun & run = *m_Runs[m_Heap.back()];
+		entry = run.current;
+		run.valid = TEntry::Read(run.in, run.current);
+		if (run.valid) {
+			push_heap(m_Heap.begin(), m_Heap.end(), SGreater(*this));
+		}
+		else {
+			m_Heap.pop_back();
+		}
+		return true;
+	}
+
+private:
+	struct SRun {
+		SRun(const string & filename)
+			: in(filename.c_str(), IOS_BASE::in | IOS_BASE::binary)
+		{
+			if (!in) {
+		 		NCBI_THROW( CSeqDBException, eFileErr, "Cannot open " + filename);
+			}
+			valid = TEntry::Read(in, current);
+		}
+		CNcbiIfstream in;
+		TEntry current;
+		bool valid;
+	};
+
+	/// Orders the heap so that the smallest current entry is on top
+	struct SGreater {
+		SGreater(const CLMDBRunMerger & m) : merger(m) {}
+		bool operator()(unsigned int a, unsigned int b) const {
+			return merger.m_Less(merger.m_Runs[b]->current, merger.m_Runs[a]->current);
+		}
+		const CLMDBRunMerger & merger;
+	};
+
+	TLess m_Less;
+	vector<unique_ptr<SRun> > m_Runs;
+	vector<unsigned int> m_Heap;
+};
+
+/// Loads entries into a dup-sorted LMDB database in key order
+///
+/// Each new key is added with MDB_APPEND and each further value of
+/// the same key with MDB_APPENDDUP, so LMDB never has to search for
+/// the insert position or split pages in the middle of the tree.
+/// Keys must arrive in LMDB (memcmp) order, and the values of one key
+/// in dup order.  When loading into a database that already has
+/// entries, in_place must be set: the entries are then put at their
+/// sorted position, which is slower but keeps the existing data.
+class CLMDBAppendLoader
+{
+public:
+	CLMDBAppendLoader(lmdb::env & env, const string & name, unsigned int max_entry_per_txn,
+	                  bool in_place = false)
+		: m_Env(env), m_Name(name), m_MaxEntryPerTxn(max_entry_per_txn), m_InPlace(in_place),
+		  m_Count(0), m_Txn(nullptr), m_Dbi(0), m_HaveLastKey(false) {}
+
+	bool Append(const void * key, size_t key_size, const void * value, size_t value_size)
+	{
+		if (m_Txn.handle() == nullptr) {
+			m_Txn = lmdb::txn::begin(m_Env);
+			m_Dbi = lmdb::dbi::open(m_Txn, m_Name.c_str(),
+			                        MDB_CREATE | MDB_DUPSORT | MDB_DUPFIXED).handle();
+		}
+		bool same_key = m_HaveLastKey && (key_size == m_LastKey.size()) &&
+		                (memcmp(key, m_LastKey.data(), key_size) == 0);
+		lmdb::val k{key, key_size};
+		lmdb::val v{value, value_size};
+		unsigned int flags = m_InPlace ? 0 : (same_key ? MDB_APPENDDUP : MDB_APPEND);
+		bool rc = lmdb::dbi_put(m_Txn, m_Dbi, k, v, flags);
+		if (!same_key) {
+			m_LastKey.assign((const char *) key, key_size);
+			m_HaveLastKey = true;
+		}
+		if (++m_Count >= m_MaxEntryPerTxn) {
+			Commit();
+		}
+		return rc;
+	}
+
+	void Commit()
+	{
+		if (m_Txn.handle() != nullptr) {
+			m_Txn.commit();
+			m_Count = 0;
+		}
+	}
+
+private:
+	lmdb::env & m_Env;
+	string m_Name;
+	unsigned int m_MaxEntryPerTxn;
+	bool m_InPlace;
+	unsigned int m_Count;
+	lmdb::txn m_Txn;
+	MDB_dbi m_Dbi;
+	string m_LastKey;
+	bool m_HaveLastKey;
+};
+
+void CWriteDB_LMDB::SKeyValuePair::Write(CNcbiOstream & os, const SKeyValuePair & kv)
+{
+	Uint4 id_len = kv.id.size();
+	os.write((const char *) &id_len, sizeof(id_len));
+	os.write(kv.id.data(), id_len);
+	os.write((const char *) &kv.oid, sizeof(kv.oid));
+}
+
+bool CWriteDB_LMDB::SKeyValuePair::Read(CNcbiIstream & is, SKeyValuePair & kv)
+{
+	Uint4 id_len = 0;
+	if (!is.read((char *) &id_len, sizeof(id_len))) {
+		return false;
+	}
+	kv.id.resize(id_len);
+	is.read(&kv.id[0], id_len);
+	is.read((char *) &kv.oid, sizeof(kv.oid));
+	return is.good();
+}
 
 CWriteDB_LMDB::CWriteDB_LMDB(const string& dbname,  Uint8 map_size, Uint8 capacity): m_Db(dbname),
                              m_Env(CBlastLMDBManager::GetInstance().GetWriteEnv(dbname, map_size)),
                              m_ListCapacity(capacity),
-                             m_MaxEntryPerTxn(DEFAULT_MAX_ENTRY_PER_TXN)
+                             m_MaxEntryPerTxn(DEFAULT_MAX_ENTRY_PER_TXN),
+                             m_MaxSortMemory(s_GetMaxSortMemory()),
+                             m_ListBytes(0),
+                             m_Append(false),
+                             m_BaseOid(0)
 {
 	m_list.reserve(m_ListCapacity);
 	char* max_entry_str = getenv("MAX_LMDB_TXN_ENTRY");
@@ -94,10 +261,12 @@ void CWriteDB_LMDB::InsertVolumesInfo(const vector<string> & vol_names, const ve
 int CWriteDB_LMDB::InsertEntries(const list<CRef<CSeq_id>> & seqids, const blastdb::TOid oid)
 {
     int count = 0;
+    size_t first_new_entry = m_list.size();
     ITERATE(list<CRef<CSeq_id>>, itr, seqids) {
     	x_InsertEntry((*itr), oid);
     	count++;
     }
+    x_CheckSortMemory(first_new_entry);
 
     return count;
 }
@@ -106,13 +275,29 @@ int CWriteDB_LMDB::InsertEntries(const list<CRef<CSeq_id>> & seqids, const blast
 int CWriteDB_LMDB::InsertEntries(const vector<CRef<CSeq_id>> & seqids, const blastdb::TOid oid)
 {
     int count = 0;
+    size_t first_new_entry = m_list.size();
     ITERATE(vector<CRef<CSeq_id>>, itr, seqids) {
        x_InsertEntry((*itr), oid);
     	count++;
     }
+    x_CheckSortMemory(first_new_entry);
     return count;
 }
 
+void CWriteDB_LMDB::x_CheckSortMemory(size_t first_new_entry)
+{
+	for(size_t i = first_new_entry; i < m_list.size(); i++) {
+		m_ListBytes += sizeof(SKeyValuePair) + m_list[i].id.capacity();
+	}
+	if (m_MaxSortMemory == 0 || m_ListBytes < m_MaxSortMemory) {
+		return;
+	}
+	// Entries are spilled between oids only, so that each oid's ids
+	// stay together in the oid to seqids data
+	x_AppendOidToSeqids();
+	x_WriteSortedRun();
+}
+
 
 void CWriteDB_LMDB::x_InsertEntry(const CRef<CSeq_id> &seqid, const blastdb::TOid oid)
 {
@@ -214,11 +399,8 @@ void CWriteDB_LMDB::x_Split(vector<SKeyValuePair>::iterator  b, vector<SKeyValue
 #endif
 }
 
-void CWriteDB_LMDB::x_CommitTransaction()
+void CWriteDB_LMDB::x_SortList()
 {
-	if(m_list.size() == 0) {
-		return;
-	}
 #ifdef _OPENMP
 	unsigned int min_split_size = DEFAULT_MIN_SPLIT_SORT_SIZE;
 	unsigned int chunk_size = DEFAULT_MIN_SPLIT_CHUNK_SIZE;
@@ -250,36 +432,82 @@ void CWriteDB_LMDB::x_CommitTransaction()
 #else
 	std::sort (m_list.begin(), m_list.end(), SKeyValuePair::cmp_key);
 #endif
-    unsigned int j=0;
-    while (j < m_list.size()){
-    	lmdb::txn txn = lmdb::txn::begin(m_Env);
-    	lmdb::dbi dbi = lmdb::dbi::open(txn, blastdb::acc2oid_str.c_str(),
-    			                        MDB_CREATE | MDB_DUPSORT | MDB_DUPFIXED);
-    	unsigned int i = j;
-    	j= i+m_MaxEntryPerTxn;
-    	if(j > m_list.size()) {
-    		j = m_list.size();
-    	}
-    	for(; i < j; i++){
-    		if( i > 0) {
-    			if ((m_list[i-1].id == m_list[i].id) &&
-    				(m_list[i-1].oid == m_list[i].oid)){
-    				continue;
-    			}
-    		}
-    		blastdb::TOid & oid = m_list[i].oid;
-    		string & id = m_list[i].id;
-    		//cerr << m_list[i].id << endl;
-			lmdb::val value{&oid, sizeof(oid)};
-			lmdb::val key{id.c_str(), strlen(id.c_str())};
-			bool rc = lmdb::dbi_put(txn, dbi.handle(), key, value, MDB_APPENDDUP);
-			if (!rc) {
+}
+
+void CWriteDB_LMDB::x_WriteSortedRun()
+{
+	if(m_list.size() == 0) {
+		return;
+	}
+	x_SortList();
+
+	string filename = s_GetTempFileName(m_Db, "run" + NStr::NumericToString(m_SortRuns.size()));
+	CNcbiOfstream os(filename.c_str(), IOS_BASE::out | IOS_BASE::binary);
+	m_SortRuns.push_back(filename);
+	for(unsigned int i = 0; i < m_list.size(); i++) {
+		if ((i > 0) && (m_list[i-1].id == m_list[i].id) &&
+			(m_list[i-1].oid == m_list[i].oid)) {
+			continue;
+		}
+		SKeyValuePair::Write(os, m_list[i]);
+	}
+	os.flush();
+	if (!os) {
+ 		NCBI_THROW( CSeqDBException, eFileErr, "Cannot write " + filename);
+	}
+
+	m_list.clear();
+	m_ListBytes = 0;
+}
+
+void CWriteDB_LMDB::x_CommitTransaction()
+{
+	CLMDBAppendLoader loader(m_Env, blastdb::acc2oid_str, m_MaxEntryPerTxn, m_Append);
+
+	if (m_SortRuns.empty()) {
+		if(m_list.size() == 0) {
+			return;
+		}
+		x_SortList();
+		for(unsigned int i = 0; i < m_list.size(); i++){
+			if( i > 0) {
+				if ((m_list[i-1].id == m_list[i].id) &&
+					(m_list[i-1].oid == m_list[i].oid)){
+					continue;
+				}
+			}
+			const blastdb::TOid & oid = m_list[i].oid;
+			const string & id = m_list[i].id;
+			if (!loader.Append(id.data(), id.size(), &oid, sizeof(oid))) {
 		 		NCBI_THROW( CSeqDBException, eArgErr, "acc2oid error for id " + id);
 			}
 		}
-    	txn.commit();
-    }
-    return;
+		loader.Commit();
+		return;
+	}
+
+	// Entries were spilled: merge the sorted runs
+	x_WriteSortedRun();
+	{
+		CLMDBRunMerger<SKeyValuePair> merger(m_SortRuns, SKeyValuePair::cmp_key);
+		SKeyValuePair prev, kv;
+		bool first = true;
+		while (merger.Next(kv)) {
+			if (!first && (prev.id == kv.id) && (prev.oid == kv.oid)) {
+				continue;
+			}
+			if (!loader.Append(kv.id.data(), kv.id.size(), &kv.oid, sizeof(kv.oid))) {
+		 		NCBI_THROW( CSeqDBException, eArgErr, "acc2oid error for id " + kv.id);
+			}
+			swap(prev, kv);
+			first = false;
+		}
+		loader.Commit();
+	}
+	ITERATE(vector<string>, iter, m_SortRuns) {
+		CFile(*iter).Remove();
+	}
+	m_SortRuns.clear();
 }
 
 Uint4 s_WirteIds(CNcbiOfstream & os, vector<string> & ids)
@@ -305,8 +533,170 @@ Uint4 s_WirteIds(CNcbiOfstream & os, vector<string> & ids)
 	return diff;
 }
 
+void CWriteDB_LMDB::x_AppendOidToSeqids()
+{
+	if(m_list.size() == 0) {
+		return;
+	}
+	if (!m_OidToSeqidsBody) {
+		string filename = s_GetTempFileName(m_Db, "oid2seqids");
+		m_OidToSeqidsBody.reset(new CNcbiOfstream(filename.c_str(), IOS_BASE::out | IOS_BASE::binary));
+	}
+	CNcbiOfstream & os = *m_OidToSeqidsBody;
+
+	if(m_list.front().oid != m_BaseOid + (blastdb::TOid) m_OidToSeqidsSizes.size()) {
+ 		NCBI_THROW( CSeqDBException, eArgErr, "Input id list not in ascending oid order");
+	}
+	vector<string> tmp_ids;
+	for(unsigned int i = 0; i < m_list.size(); i++) {
+		if(i > 0 && m_list[i].oid != m_list[i-1].oid ) {
+			if((m_list[i].oid - m_list[i-1].oid) != 1) {
+		 		NCBI_THROW( CSeqDBException, eArgErr, "Input id list not in ascending oid order");
+			}
+			m_OidToSeqidsSizes.push_back(s_WirteIds(os, tmp_ids));
+			tmp_ids.clear();
+		}
+		if(!m_list[i].saveToOidList) {
+			continue;
+		}
+		tmp_ids.push_back(m_list[i].id);
+	}
+	m_OidToSeqidsSizes.push_back(s_WirteIds(os, tmp_ids));
+}
+
+/// Assemble an oid lookup file from per-oid sizes and the data file
+static void s_AssembleOidLookupFile(const string & filename,
+                                    const string & body_name,
+                                    const vector<Uint4> & sizes,
+                                    unique_ptr<CNcbiOfstream> & body)
+{
+	body->flush();
+	if (!*body) {
+ 		NCBI_THROW( CSeqDBException, eFileErr, "Cannot write " + body_name);
+	}
+	body.reset();
+
+	Uint8 total_num_oids = sizes.size();
+	CNcbiOfstream os(filename.c_str(), IOS_BASE::out | IOS_BASE::binary);
+	os.write((char *)&total_num_oids, 8);
+	Uint8 offset = 0;
+	for(unsigned int i = 0; i < total_num_oids; i++) {
+		offset += sizes[i];
+		os.write((char *) &offset, 8);
+	}
+	{
+		CNcbiIfstream is(body_name.c_str(), IOS_BASE::in | IOS_BASE::binary);
+		if (offset > 0) {
+			os << is.rdbuf();
+		}
+	}
+	os.flush();
+	os.close();
+	CFile(body_name).Remove();
+}
+
+/// Extend an oid lookup file holding base_oids oids with the per-oid
+/// sizes and the data file of the oids that follow them.
+/// The existing data is moved up in place to make room for the new
+/// offsets; the existing offsets are not rewritten.
+static void s_ExtendOidLookupFile(const string & filename,
+                                  const string & body_name,
+                                  Uint8 base_oids,
+                                  const vector<Uint4> & sizes,
+                                  unique_ptr<CNcbiOfstream> & body)
+{
+	body->flush();
+	if (!*body) {
+ 		NCBI_THROW( CSeqDBException, eFileErr, "Cannot write " + body_name);
+	}
+	body.reset();
+
+	if (!CFile(filename).Exists()) {
+		// None of the existing oids had an entry
+		CNcbiOfstream os(filename.c_str(), IOS_BASE::out | IOS_BASE::binary);
+		os.write((char *)&base_oids, 8);
+		Uint8 offset = 0;
+		for(Uint8 i = 0; i < base_oids; i++) {
+			os.write((char *) &offset, 8);
+		}
+	}
+
+	CNcbiFstream fs(filename.c_str(), IOS_BASE::in | IOS_BASE::out | IOS_BASE::binary);
+	Uint8 total_num_oids = 0;
+	fs.read((char *)&total_num_oids, 8);
+	if (!fs || total_num_oids != base_oids) {
+ 		NCBI_THROW( CSeqDBException, eFileErr, filename + " does not match the database");
+	}
+	Uint8 last_offset = 0;
+	if (base_oids > 0) {
+		fs.seekg(8 * base_oids);
+		fs.read((char *) &last_offset, 8);
+	}
+
+	const Uint8 data_start = 8 * (base_oids + 1);
+	const Uint8 shift = 8 * (Uint8) sizes.size();
+	vector<char> buf(1024 * 1024);
+	for(Uint8 end = data_start + last_offset; fs && end > data_start;) {
+		Uint8 n = min((Uint8) buf.size(), end - data_start);
+		end -= n;
+		fs.seekg(end);
+		fs.read(&buf[0], n);
+		fs.seekp(end + shift);
+		fs.write(&buf[0], n);
+	}
+
+	fs.seekp(data_start);
+	Uint8 offset = last_offset;
+	for(unsigned int i = 0; i < sizes.size(); i++) {
+		offset += sizes[i];
+		fs.write((char *) &offset, 8);
+	}
+	fs.seekp(data_start + shift + last_offset);
+	{
+		CNcbiIfstream is(body_name.c_str(), IOS_BASE::in | IOS_BASE::binary);
+		if (offset > last_offset) {
+			fs << is.rdbuf();
+		}
+	}
+	total_num_oids += sizes.size();
+	fs.seekp(0);
+	fs.write((char *)&total_num_oids, 8);
+	fs.flush();
+	if (!fs) {
+ 		NCBI_THROW( CSeqDBException, eFileErr, "Cannot write " + filename);
+	}
+	fs.close();
+	CFile(body_name).Remove();
+}
+
+void CWriteDB_LMDB::PrepareAppend(blastdb::TOid num_oids)
+{
+	_ASSERT(m_list.empty() && m_OidToSeqidsSizes.empty());
+	m_Append = true;
+	m_BaseOid = num_oids;
+
+	// The oid to seqids data of the new oids is collected on disk and
+	// appended to the existing file when done.
+	string body_name = s_GetTempFileName(m_Db, "oid2seqids");
+	m_OidToSeqidsBody.reset(new CNcbiOfstream(body_name.c_str(), IOS_BASE::out | IOS_BASE::binary));
+}
+
 void CWriteDB_LMDB::x_CreateOidToSeqidsLookupFile()
 {
+	if (m_OidToSeqidsBody) {
+		// Some entries were spilled; the data is already on disk
+		x_AppendOidToSeqids();
+		string filename = GetFileNameFromExistingLMDBFile(m_Db, ELMDBFileType::eOid2SeqIds);
+		if (m_Append) {
+			s_ExtendOidLookupFile(filename, s_GetTempFileName(m_Db, "oid2seqids"),
+			                      m_BaseOid, m_OidToSeqidsSizes, m_OidToSeqidsBody);
+		}
+		else {
+			s_AssembleOidLookupFile(filename, s_GetTempFileName(m_Db, "oid2seqids"),
+			                        m_OidToSeqidsSizes, m_OidToSeqidsBody);
+		}
+		return;
+	}
 	if(m_list.size() == 0) {
 		return;
 	}
@@ -364,7 +754,11 @@ void CWriteDB_LMDB::x_Resize()
 
 CWriteDB_TaxID::CWriteDB_TaxID(const string& dbname,  Uint8 map_size, Uint8 capacity): m_Db(dbname),
                                m_Env(CBlastLMDBManager::GetInstance().GetWriteEnv(dbname, map_size)),
-                               m_ListCapacity(capacity), m_MaxEntryPerTxn(DEFAULT_MAX_ENTRY_PER_TXN)
+                               m_ListCapacity(capacity), m_MaxEntryPerTxn(DEFAULT_MAX_ENTRY_PER_TXN),
+                               m_MaxSortMemory(s_GetMaxSortMemory()),
+                               m_Append(false),
+                               m_BaseOid(0),
+                               m_TaxIdToOidsBase(0)
 {
 	m_TaxId2OidList.reserve(m_ListCapacity);
 	char* max_entry_str = getenv("MAX_LMDB_TXN_ENTRY");
@@ -390,6 +784,7 @@ int CWriteDB_TaxID::InsertEntries(const set<Int4> & tax_ids, const blastdb::TOid
     	x_Resize();
     	SKeyValuePair<blastdb::TOid>  kv(0, oid);
     	m_TaxId2OidList.push_back(kv);
+    	x_CheckSortMemory();
     	return 1;
     }
 
@@ -399,38 +794,73 @@ int CWriteDB_TaxID::InsertEntries(const set<Int4> & tax_ids, const blastdb::TOid
     	m_TaxId2OidList.push_back(kv);
     	count++;
     }
+    x_CheckSortMemory();
 
     return count;
 }
 
+void CWriteDB_TaxID::PrepareAppend(blastdb::TOid num_oids)
+{
+	_ASSERT(m_TaxId2OidList.empty() && m_OidToTaxIdsSizes.empty());
+	m_Append = true;
+	m_BaseOid = num_oids;
+
+	// The oid lists of the new oids are written after the existing ones,
+	// and indexed next to them; a tax id may then have several offsets.
+	CFile oids_file(GetFileNameFromExistingLMDBFile(m_Db, ELMDBFileType::eTaxId2Oids));
+	if (oids_file.Exists()) {
+		m_TaxIdToOidsBase = oids_file.GetLength();
+	}
+	string body_name = s_GetTempFileName(m_Db, "oid2taxids");
+	m_OidToTaxIdsBody.reset(new CNcbiOfstream(body_name.c_str(), IOS_BASE::out | IOS_BASE::binary));
+}
+
+void CWriteDB_TaxID::x_CheckSortMemory()
+{
+	if (m_MaxSortMemory == 0 ||
+		m_TaxId2OidList.size() * sizeof(SKeyValuePair<blastdb::TOid>) < m_MaxSortMemory) {
+		return;
+	}
+	x_AppendOidToTaxIds();
+	x_WriteSortedRun();
+}
+
+void CWriteDB_TaxID::x_WriteSortedRun()
+{
+	if(m_TaxId2OidList.size() == 0) {
+		return;
+	}
+    sort (m_TaxId2OidList.begin(), m_TaxId2OidList.end(), SKeyValuePair<blastdb::TOid>::cmp_key);
+
+	string filename = s_GetTempFileName(m_Db, "run" + NStr::NumericToString(m_SortRuns.size()));
+	CNcbiOfstream os(filename.c_str(), IOS_BASE::out | IOS_BASE::binary);
+	m_SortRuns.push_back(filename);
+	for(unsigned int i = 0; i < m_TaxId2OidList.size(); i++) {
+		SKeyValuePair<blastdb::TOid>::Write(os, m_TaxId2OidList[i]);
+	}
+	os.flush();
+	if (!os) {
+ 		NCBI_THROW( CSeqDBException, eFileErr, "Cannot write " + filename);
+	}
+
+	m_TaxId2OidList.clear();
+}
+
 void CWriteDB_TaxID::x_CommitTransaction()
 {
 	_ASSERT(m_TaxId2OffsetsList.size());
-    sort (m_TaxId2OffsetsList.begin(), m_TaxId2OffsetsList.end(), SKeyValuePair<Uint8>::cmp_key);
-
-    unsigned int j=0;
-    while (j < m_TaxId2OffsetsList.size()){
-    	lmdb::txn txn = lmdb::txn::begin(m_Env);
-    	lmdb::dbi dbi = lmdb::dbi::open(txn, blastdb::taxid2offset_str.c_str(),
-    			                        MDB_CREATE | MDB_DUPSORT | MDB_DUPFIXED);
-    	unsigned int i = j;
-    	j= i+m_MaxEntryPerTxn;
-    	if(j > m_TaxId2OffsetsList.size()) {
-    		j = m_TaxId2OffsetsList.size();
-    	}
-    	for(; i < j; i++){
-    		Uint8 & offset = m_TaxId2OffsetsList[i].value;
-    		Int4 & tax_id = m_TaxId2OffsetsList[i].tax_id;
-    		//cerr << m_list[i].id << endl;
-			lmdb::val value{&offset, sizeof(offset)};
-			lmdb::val key{&tax_id, sizeof(tax_id)};
-			bool rc = lmdb::dbi_put(txn, dbi.handle(), key, value, MDB_APPENDDUP);
-			if (!rc) {
-		 		NCBI_THROW( CSeqDBException, eArgErr, "taxid2offset error for tax id " + tax_id);
-			}
+	// Keys are raw Int4 values, so LMDB orders them bytewise
+    sort (m_TaxId2OffsetsList.begin(), m_TaxId2OffsetsList.end(), SKeyValuePair<Uint8>::cmp_lmdb_key);
+
+	CLMDBAppendLoader loader(m_Env, blastdb::taxid2offset_str, m_MaxEntryPerTxn, m_Append);
+	for(unsigned int i = 0; i < m_TaxId2OffsetsList.size(); i++){
+		const Uint8 & offset = m_TaxId2OffsetsList[i].value;
+		const Int4 & tax_id = m_TaxId2OffsetsList[i].tax_id;
+		if (!loader.Append(&tax_id, sizeof(tax_id), &offset, sizeof(offset))) {
+	 		NCBI_THROW( CSeqDBException, eArgErr, "taxid2offset error for tax id " + NStr::IntToString(tax_id));
 		}
-    	txn.commit();
-    }
+	}
+	loader.Commit();
     return;
 
 }
@@ -443,8 +873,50 @@ Uint4 s_WirteTaxIds(CNcbiOfstream & os, vector<Int4> & tax_ids)
 	return tax_ids.size();
 }
 
+void CWriteDB_TaxID::x_AppendOidToTaxIds()
+{
+	if(m_TaxId2OidList.size() == 0) {
+		return;
+	}
+	if (!m_OidToTaxIdsBody) {
+		string filename = s_GetTempFileName(m_Db, "oid2taxids");
+		m_OidToTaxIdsBody.reset(new CNcbiOfstream(filename.c_str(), IOS_BASE::out | IOS_BASE::binary));
+	}
+	CNcbiOfstream & os = *m_OidToTaxIdsBody;
+
+	if(m_TaxId2OidList.front().value != m_BaseOid + (blastdb::TOid) m_OidToTaxIdsSizes.size()) {
+ 		NCBI_THROW( CSeqDBException, eArgErr, "Input id list not in ascending oid order");
+	}
+	vector<Int4> tmp_tax_ids;
+	for(unsigned int i = 0; i < m_TaxId2OidList.size(); i++) {
+		if(i > 0 && m_TaxId2OidList[i].value != m_TaxId2OidList[i-1].value ) {
+			if((m_TaxId2OidList[i].value - m_TaxId2OidList[i-1].value) != 1) {
+		 		NCBI_THROW( CSeqDBException, eArgErr, "Input id list not in ascending oid order");
+			}
+			m_OidToTaxIdsSizes.push_back(s_WirteTaxIds(os, tmp_tax_ids));
+			tmp_tax_ids.clear();
+		}
+		tmp_tax_ids.push_back(m_TaxId2OidList[i].tax_id);
+	}
+	m_OidToTaxIdsSizes.push_back(s_WirteTaxIds(os, tmp_tax_ids));
+}
+
 void CWriteDB_TaxID::x_CreateOidToTaxIdsLookupFile()
 {
+	if (m_OidToTaxIdsBody) {
+		// Some entries were spilled; the data is already on disk
+		x_AppendOidToTaxIds();
+		string filename = GetFileNameFromExistingLMDBFile(m_Db, ELMDBFileType::eOid2TaxIds);
+		if (m_Append) {
+			s_ExtendOidLookupFile(filename, s_GetTempFileName(m_Db, "oid2taxids"),
+			                      m_BaseOid, m_OidToTaxIdsSizes, m_OidToTaxIdsBody);
+		}
+		else {
+			s_AssembleOidLookupFile(filename, s_GetTempFileName(m_Db, "oid2taxids"),
+			                        m_OidToTaxIdsSizes, m_OidToTaxIdsBody);
+		}
+		return;
+	}
 	if(m_TaxId2OidList.size() == 0) {
  		NCBI_THROW( CSeqDBException, eArgErr, "No tax info for any oid");
 	}
@@ -489,6 +961,13 @@ void CWriteDB_TaxID::x_CreateOidToTaxIdsLookupFile()
 	os.close();
 }
 
+IOS_BASE::openmode CWriteDB_TaxID::x_TaxIdToOidsOpenMode() const
+{
+	// When appending, the oid lists of the new oids follow the existing ones
+	return m_Append ? (IOS_BASE::out | IOS_BASE::binary | IOS_BASE::app)
+	                : (IOS_BASE::out | IOS_BASE::binary);
+}
+
 Uint4 s_WirteOids(CNcbiOfstream & os, vector<blastdb::TOid> & oids)
 {
 	blastdb::SortAndUnique <blastdb::TOid> (oids);
@@ -502,10 +981,51 @@ Uint4 s_WirteOids(CNcbiOfstream & os, vector<blastdb::TOid> & oids)
 
 void CWriteDB_TaxID::x_CreateTaxIdToOidsLookupFile()
 {
+	if (!m_SortRuns.empty()) {
+		// Some entries were spilled: merge the sorted runs
+		x_WriteSortedRun();
+		string filename = GetFileNameFromExistingLMDBFile(m_Db, ELMDBFileType::eTaxId2Oids);
+		CNcbiOfstream os(filename.c_str(), x_TaxIdToOidsOpenMode());
+		Uint8 offset = m_TaxIdToOidsBase;
+
+		vector<blastdb::TOid> tmp_oids;
+		{
+			CLMDBRunMerger<SKeyValuePair<blastdb::TOid> >
+				merger(m_SortRuns, SKeyValuePair<blastdb::TOid>::cmp_key);
+			SKeyValuePair<blastdb::TOid> kv;
+			Int4 tax_id = 0;
+			bool first = true;
+			while (merger.Next(kv)) {
+				if (!first && kv.tax_id != tax_id) {
+					SKeyValuePair<Uint8> p(tax_id, offset);
+					offset += s_WirteOids(os, tmp_oids);
+					m_TaxId2OffsetsList.push_back(p);
+					tmp_oids.clear();
+				}
+				tmp_oids.push_back(kv.value);
+				tax_id = kv.tax_id;
+				first = false;
+			}
+			if (!first) {
+				SKeyValuePair<Uint8> p(tax_id, offset);
+				s_WirteOids(os, tmp_oids);
+				m_TaxId2OffsetsList.push_back(p);
+			}
+		}
+		os.flush();
+		os.close();
+
+		ITERATE(vector<string>, iter, m_SortRuns) {
+			CFile(*iter).Remove();
+		}
+		m_SortRuns.clear();
+		return;
+	}
+
     sort (m_TaxId2OidList.begin(), m_TaxId2OidList.end(), SKeyValuePair<blastdb::TOid>::cmp_key);
 	string filename = GetFileNameFromExistingLMDBFile(m_Db, ELMDBFileType::eTaxId2Oids);
-	CNcbiOfstream os(filename.c_str(), IOS_BASE::out | IOS_BASE::binary);
-	Uint8 offset =0;
+	CNcbiOfstream os(filename.c_str(), x_TaxIdToOidsOpenMode());
+	Uint8 offset = m_TaxIdToOidsBase;
 
 	vector<blastdb::TOid> tmp_oids;
 	for(unsigned int i = 0; i < m_TaxId2OidList.size(); i++) {
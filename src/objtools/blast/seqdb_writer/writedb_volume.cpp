@@ -33,13 +33,67 @@
 #include <ncbi_pch.hpp>
 #include "writedb_volume.hpp"
 #include <objtools/blast/seqdb_writer/writedb_error.hpp>
+#include <corelib/ncbithr.hpp>
 #include <iostream>
+#include <exception>
 
 BEGIN_NCBI_SCOPE
 
 /// Include C++ std library symbols.
 USING_SCOPE(std);
 
+/// Type used for lists of ISAM indices being closed.
+typedef vector<CWriteDB_Isam *> TIsamList;
+
+/// Close ISAM indices until none is left.
+///
+/// @param isams ISAM indices to close.
+/// @param next Counter giving the next index to close.
+/// @param errors Exception thrown while closing each index, if any.
+static void s_CloseIsams(const TIsamList              & isams,
+                         CAtomicCounter               & next,
+                         vector<std::exception_ptr>   & errors)
+{
+    const int num_isams = (int) isams.size();
+
+    for(;;) {
+        int i = (int) next.Add(1) - 1;
+        if (i >= num_isams) {
+            break;
+        }
+        try {
+            isams[i]->Close();
+        }
+        catch (...) {
+            errors[i] = std::current_exception();
+        }
+    }
+}
+
+/// Helper thread closing ISAM indices of a volume.
+class CWriteDB_IsamCloseThread : public CThread
+{
+public:
+    CWriteDB_IsamCloseThread(const TIsamList            & isams,
+                             CAtomicCounter             & next,
+                             vector<std::exception_ptr> & errors)
+        : m_Isams(isams), m_Next(next), m_Errors(errors)
+    {
+    }
+
+protected:
+    virtual void * Main(void)
+    {
+        s_CloseIsams(m_Isams, m_Next, m_Errors);
+        return NULL;
+    }
+
+private:
+    const TIsamList            & m_Isams;
+    CAtomicCounter             & m_Next;
+    vector<std::exception_ptr> & m_Errors;
+};
+
 CWriteDB_Volume::CWriteDB_Volume(const string & dbname,
                                  bool           protein,
                                  const string & title,
@@ -100,12 +154,16 @@ CWriteDB_Volume::CWriteDB_Volume(const string & dbname,
                                          max_file_size,
                                          false));
         if(m_DbVersion != eBDB_Version5) {
+            bool acc_hash =
+                (m_Indices & CWriteDB::eAddAccessionHash) != 0;
+
             m_AccIsam.Reset(new CWriteDB_Isam(eAcc,
                                           dbname,
                                           protein,
                                           index,
                                           max_file_size,
-                                          sparse));                                          
+                                          sparse,
+                                          acc_hash));
         }
         if (m_Indices & CWriteDB::eAddTrace) {
             m_TraceIsam.Reset(new CWriteDB_Isam(eTrace,
@@ -305,7 +363,7 @@ int CWriteDB_Volume::x_FindNuclLength(const string & seq)
     return WriteDB_FindSequenceLength(m_Protein, seq);
 }
 
-void CWriteDB_Volume::Close()
+void CWriteDB_Volume::Close(int num_threads)
 {
     if (m_Open) {
         m_Open = false;
@@ -316,20 +374,46 @@ void CWriteDB_Volume::Close()
         m_Seq->Close();
 
         if (m_Indices != CWriteDB::eNoIndex) {
+            TIsamList isams;
             if (m_Protein) {
-                m_PigIsam->Close();
+                isams.push_back(m_PigIsam.GetPointer());
             }
-            m_GiIsam->Close();
-            if(m_AccIsam.NotEmpty()) m_AccIsam->Close();
-            m_GiIndex->Close();
+            isams.push_back(m_GiIsam.GetPointer());
+            if(m_AccIsam.NotEmpty()) isams.push_back(m_AccIsam.GetPointer());
 
             if (m_TraceIsam.NotEmpty()) {
-                m_TraceIsam->Close();
+                isams.push_back(m_TraceIsam.GetPointer());
             }
 
             if (m_HashIsam.NotEmpty()) {
-                m_HashIsam->Close();
+                isams.push_back(m_HashIsam.GetPointer());
             }
+
+            // Each index is sorted and written to its own files; this
+            // thread closes indices too, alongside num_threads - 1
+            // helpers.
+            vector<std::exception_ptr> errors(isams.size());
+            CAtomicCounter next;
+            next.Set(0);
+
+            vector< CRef<CThread> > helpers;
+            int num_helpers = min(num_threads, (int) isams.size()) - 1;
+            for (int i = 0; i < num_helpers; i++) {
+                helpers.push_back(CRef<CThread>
+                    (new CWriteDB_IsamCloseThread(isams, next, errors)));
+                helpers.back()->Run();
+            }
+            s_CloseIsams(isams, next, errors);
+            NON_CONST_ITERATE(vector< CRef<CThread> >, iter, helpers) {
+                (*iter)->Join();
+            }
+            ITERATE(vector<std::exception_ptr>, iter, errors) {
+                if (*iter) {
+                    std::rethrow_exception(*iter);
+                }
+            }
+
+            m_GiIndex->Close();
             m_IdSet.clear();
         }
     }
@@ -175,8 +175,12 @@ public:
     /// This method finalizes and closes all files associated with
     /// this volume.  (This is not a trivial operation, because ISAM
     /// indices and the index file (pin or nin) cannot be written
-    /// until all of the data has been seen.)
-    void Close();
+    /// until all of the data has been seen.)  The ISAM indices are
+    /// independent of each other, so up to num_threads of them are
+    /// sorted and written at the same time.
+    ///
+    /// @param num_threads Number of threads building ISAM indices.
+    void Close(int num_threads = 1);
 
     /// Get the name of the volume.
     ///
@@ -202,6 +206,13 @@ public:
         return m_OID;
     }
 
+    /// Get the number of sequence letters in the volume.
+    /// @return the total sequence length
+    Uint8 GetLetters() const
+    {
+        return m_Idx->GetLetters();
+    }
+
     /// List all files associated with this volume.
     /// @param files The filenames will be appended to this vector.
     void ListFiles(vector<string> & files) const;